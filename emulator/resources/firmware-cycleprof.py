@@ -0,0 +1,146 @@
+#!/usr/bin/env python
+#
+# Per-video-mode cycle budget report for the cube firmware.
+#
+# Takes a profile written by 'siftulator -p PROFILE.txt', plus all of the
+# firmware's *.rst files, and reports how many CPU cycles each video mode
+# spends per rendered frame. Each mode's cycles are broken down by module
+# (graphics_*.c, radio_isr.c, sensors_*.c, ...) and by function.
+#
+# Copyright (c) 2012 Sifteo, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+import FirmwareLib
+import bisect
+import sys
+
+# Names for _SYS_VM_* values, from sdk/include/sifteo/abi/vram.h
+MODE_NAMES = {
+    0x00: 'POWERDOWN',
+    0x04: 'BG0_ROM',
+    0x08: 'SOLID',
+    0x0c: 'FB32',
+    0x10: 'FB64',
+    0x14: 'FB128',
+    0x18: 'BG0',
+    0x1c: 'BG0_BG1',
+    0x20: 'BG0_SPR_BG1',
+    0x24: 'BG2',
+    0x28: 'STAMP',
+    0x2c: 'BG0_PATCH',
+    0x3c: 'SLEEP',
+}
+
+# Only list this many functions per mode
+FUNCTION_LIMIT = 15
+
+
+def readProfile(filename):
+    # Returns ({mode: {addr: cycles}}, {mode: frames}) from the
+    # machine-readable records at the end of a profile.
+
+    cycles = {}
+    frames = {}
+
+    for line in open(filename, 'r'):
+        tokens = line.split()
+        if len(tokens) == 4 and tokens[0] == 'mode_cycles':
+            addr, mode = int(tokens[1], 16), int(tokens[2], 16)
+            cycles.setdefault(mode, {})[addr] = int(tokens[3])
+        elif len(tokens) == 3 and tokens[0] == 'mode_frames':
+            frames[int(tokens[1], 16)] = int(tokens[2])
+
+    return cycles, frames
+
+
+class FunctionMap:
+    """Map code addresses to the nearest preceding C-like symbol."""
+
+    def __init__(self, p):
+        kv = [(addr, label) for label, addr in p.symbols.items()
+              if label[0] == '_' and '$' not in label]
+        kv.sort()
+        self.addrs = [addr for addr, label in kv]
+        self.labels = [label for addr, label in kv]
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return '(unknown)'
+        return self.labels[i]
+
+
+def showBudget(d, frames, total, limit=None):
+    # Show cycles-per-frame from a dictionary of (name, cycles) tuples.
+
+    kv = d.items()
+    kv.sort(lambda a,b: cmp(b[1], a[1]))
+    if limit is not None:
+        kv = kv[:limit]
+
+    for name, cycles in kv:
+        print "\t%-30s %10d cycles/frame %6.2f%%" % (
+            name, cycles // frames, cycles * 100.0 / total)
+
+
+def modeReport(p, functions, mode, cycles, frames):
+    total = sum(cycles.values())
+    name = MODE_NAMES.get(mode, 'unknown')
+
+    print "\nMode 0x%02x (%s): %d frames, %d cycles" % (mode, name, frames, total)
+    if not frames:
+        print "\tNo frames rendered in this mode"
+        return
+    print "\t%d cycles/frame total" % (total // frames)
+
+    moduleTotals = {}
+    functionTotals = {}
+    for addr, c in cycles.items():
+        module = p.byteModule.get(addr, '(unknown)')
+        moduleTotals[module] = moduleTotals.get(module, 0) + c
+        function = functions.lookup(addr)
+        functionTotals[function] = functionTotals.get(function, 0) + c
+
+    print "\n    Modules:"
+    showBudget(moduleTotals, frames, total)
+    print "\n    Functions:"
+    showBudget(functionTotals, frames, total, FUNCTION_LIMIT)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.stderr.write("usage: %s PROFILE.txt src/*.rst\n" % sys.argv[0])
+        sys.exit(1)
+
+    p = FirmwareLib.RSTParser()
+    for f in sys.argv[2:]:
+        p.parseFile(f)
+    functions = FunctionMap(p)
+
+    cycles, frames = readProfile(sys.argv[1])
+    if not cycles:
+        sys.stderr.write("No per-mode data found in '%s'\n" % sys.argv[1])
+        sys.exit(1)
+
+    for mode in sorted(cycles.keys()):
+        modeReport(p, functions, mode, cycles[mode], frames.get(mode, 0))
+
+    print
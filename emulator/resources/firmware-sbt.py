@@ -11,6 +11,13 @@
 # Since we need some hints about basic blocks and data vs. code, we
 # take the SDCC ".rst" files as input, rather than the raw hex file.
 #
+# Optionally, a cube profile (written by siftulator's --cube0Profile
+# option) can guide the translation: hot blocks that fall through into
+# other blocks are fused into larger super-blocks, and hot code is
+# emitted first for better I-cache locality.
+#
+#   usage: firmware-sbt.py [--profile PROFILE.txt] FILE.rst...
+#
 # Micah Elizabeth Scott <micah@misc.name>
 # 
 # Copyright (c) 2011 Sifteo, Inc.
@@ -36,8 +43,17 @@
 
 import FirmwareLib
 import sys
+import re
+import bisect
 import bin2c
 
+# Blocks covering this fraction of all profiled cycles are "hot"
+HOT_FRACTION = 0.95
+
+# Limit on the length of a fused super-block. Interrupts are dispatched
+# between blocks, so longer blocks mean more interrupt latency.
+MAX_FUSED_INSTRUCTIONS = 48
+
 
 def fixupImage(p):
     """This contains all the special-case code we apply to the compiled
@@ -61,9 +77,26 @@ def fixupImage(p):
             p.instructions[instrBase] = [p.dataMemory[instrBase : instrBase+2]]
 
 
+def readProfile(filename):
+    """Read a cube profile, as written by Cube::Debug::writeProfile().
+       Returns a dictionary mapping code addresses to total cycle counts.
+       """
+
+    profile = {}
+    lineRE = re.compile(r"^\s*(\d+)\s.*\]\s+([0-9a-fA-F]{4}):")
+
+    for line in open(filename):
+        m = lineRE.match(line)
+        if m:
+            profile[int(m.group(2), 16)] = int(m.group(1))
+
+    return profile
+
+
 class CodeGenerator:
-    def __init__(self, parser):
+    def __init__(self, parser, profile=None):
         self.p = parser
+        self.profile = profile or {}
         self.opTable = FirmwareLib.opcodeTable()
 
     def write(self, f):
@@ -142,38 +175,104 @@ class CodeGenerator:
 
         return False
 
-    def writeCode(self, f):
+    def findBlocks(self):
+        """Split the instruction table into basic blocks. Returns a list of
+           (addr, [instruction bytes], fallsThrough) tuples in address order.
+           """
+
         addrs = self.p.instructions.keys()
         addrs.sort()
-        inBlock = False
-        blockMap = {}
-
-        # Walk our instruction table, and emit translation blocks as functions
+        blocks = []
+        current = None
 
         for addr in addrs:
 
             # Branch targets end a basic block before emitting the instruction
-            if addr in self.p.branchTargets and inBlock:
-                self.endBlock(f)
-                inBlock = False
+            if addr in self.p.branchTargets and current:
+                blocks.append(current + (True,))
+                current = None
 
-            if not inBlock:
-                self.beginBlock(f, addr)
-                blockMap[addr] = True
-                inBlock = True
+            if not current:
+                current = (addr, [])
 
             # Normally there's one instruction per address, but patches can put
             # as many instructions as they like at the same place.
             for bytes in self.p.instructions[addr]:
-                self.writeInstruction(f, bytes)
+                current[1].append(bytes)
                 endsBlock = self.endsBlock(bytes)
 
-            if endsBlock and inBlock:
-                self.endBlock(f)
-                inBlock = False
+            if endsBlock and current:
+                blocks.append(current + (False,))
+                current = None
+
+        if current:
+            blocks.append(current + (False,))
+
+        return blocks
+
+    def blockCycles(self, blocks):
+        """Total profiled cycles spent in each block's address range"""
+        heat = [0] * len(blocks)
+        starts = [b[0] for b in blocks]
+        for addr, cycles in self.profile.items():
+            i = bisect.bisect_right(starts, addr) - 1
+            if i >= 0:
+                heat[i] += cycles
+        return heat
+
+    def fuseBlocks(self, blocks, hot):
+        """Extend each hot block with the blocks it falls through to,
+           producing super-blocks. The original blocks are all still
+           emitted, since other code can branch to them.
+           """
+
+        fused = []
+        for i, (addr, instrs, fallsThrough) in enumerate(blocks):
+            instrs = list(instrs)
+            j = i
+            while (addr in hot and fallsThrough and j + 1 < len(blocks)
+                   and len(instrs) + len(blocks[j + 1][1]) <= MAX_FUSED_INSTRUCTIONS):
+                j += 1
+                instrs += blocks[j][1]
+                fallsThrough = blocks[j][2]
+            fused.append((addr, instrs))
+        return fused
+
+    def writeCode(self, f):
+        blocks = self.findBlocks()
+        hot = set()
+        order = range(len(blocks))
+
+        if self.profile:
+            # Rank blocks by cycle count, and find the smallest set of
+            # blocks that covers HOT_FRACTION of the total.
+
+            heat = self.blockCycles(blocks)
+            order.sort(key=lambda i: -heat[i])
 
-        if inBlock:
+            total = sum(heat)
+            covered = 0
+            for i in order:
+                if covered >= total * HOT_FRACTION or not heat[i]:
+                    break
+                covered += heat[i]
+                hot.add(blocks[i][0])
+
+            blocks = self.fuseBlocks(blocks, hot)
+        else:
+            blocks = [(addr, instrs) for addr, instrs, fallsThrough in blocks]
+
+        # Emit translation blocks as functions. With a profile, the hottest
+        # code comes first so that it's packed together in the binary.
+
+        blockMap = {}
+        for i in order:
+            addr, instrs = blocks[i]
+            self.beginBlock(f, addr)
+            for bytes in instrs:
+                self.writeInstruction(f, bytes)
             self.endBlock(f)
+            blockMap[addr] = True
 
         # Write a table of translated block functions
 
@@ -189,10 +288,16 @@ class CodeGenerator:
 
 
 if __name__ == '__main__':
+    args = sys.argv[1:]
+    profile = None
+    if args[:1] == ['--profile']:
+        profile = readProfile(args[1])
+        args = args[2:]
+
     p = FirmwareLib.RSTParser()
-    for f in sys.argv[1:]:
+    for f in args:
         p.parseFile(f)
 
     fixupImage(p)
-    gen = CodeGenerator(p)
+    gen = CodeGenerator(p, profile)
     gen.write(open('resources/firmware-sbt.cpp', 'w'))
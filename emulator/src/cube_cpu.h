@@ -47,10 +47,21 @@ struct em8051;
 typedef int FASTCALL (*em8051operation)(struct em8051 *aCPU, unsigned &PC, 
                                         uint8_t opcode, uint8_t operand1, uint8_t operand2);
 
+// Predecoded instruction, cached per code address by the interpreter
+struct em8051decoded {
+    em8051operation op;         // NULL if this address isn't decoded yet
+    uint8_t opcode;
+    uint8_t operand1;
+    uint8_t operand2;
+};
+
 // Decodes opcode at position, and fills the buffer with the assembler code. 
 // Returns how many bytes the opcode takes.
 typedef int (*em8051decoder)(struct em8051 *aCPU, int aPosition, char *aBuffer);
 
+// One bucket per video mode, indexed by (_SYS_VA_MODE & _SYS_VM_MASK) >> 2
+#define PROFILE_NUM_MODES   16
+
 struct profile_data
 {
     uint64_t total_cycles;
@@ -58,6 +69,13 @@ struct profile_data
     uint64_t loop_prev;
     uint64_t loop_hits;
     uint64_t flash_idle;
+    uint64_t mode_cycles[PROFILE_NUM_MODES];
+};
+
+struct profile_frames
+{
+    uint32_t lcd_frames;                    // LCD frame count at our last check
+    uint32_t mode_frames[PROFILE_NUM_MODES];
 };
 
 #define NUM_IRQ_LEVELS  4
@@ -102,6 +120,11 @@ struct em8051
     uint16_t rtc2;              // 16-bit RTC2 counter
     unsigned wdtCounter;        // 24-bit watchdog counter
 
+    // Free-running statistics. Only written by this cube's thread.
+    uint32_t tickCount;         // Clock ticks elapsed
+    uint32_t blockCount;        // SBT basic blocks executed
+    uint32_t irqDispatchCount;  // Interrupt handlers entered
+
     void *callbackData;
 
     em8051operation op[256]; // function pointers to opcode handlers
@@ -110,6 +133,10 @@ struct em8051
     uint8_t mExtData[XDATA_SIZE];
     uint8_t mCodeMem[CODE_SIZE];
 
+    // Interpreter's decoded-instruction cache. Anything that writes
+    // mCodeMem must call em8051_invalidate_code() afterwards.
+    em8051decoded mDecoded[CODE_SIZE];
+
     struct {
         // Stored register values for sanity-checking ISRs
         uint8_t a, psw, sp, dpl, dph, dpl1, dph1, dps, r[8];
@@ -128,6 +155,7 @@ struct em8051
 
     // Profiler state
     struct profile_data *mProfileData;
+    struct profile_frames *mProfileFrames;
     VirtualTime *vtime;
 };
 
@@ -147,6 +175,12 @@ int em8051_load(struct em8051 *aCPU, const char *aFilename);
 // Switch to static binary translation mode
 void em8051_init_sbt(struct em8051 *aCPU);
 
+// Discard predecoded instructions, after code memory was modified
+void em8051_invalidate_code(struct em8051 *aCPU);
+
+// Internal: Fill in the decoded-instruction cache entry for one address
+void em8051_predecode(struct em8051 *aCPU, unsigned aPosition);
+
 // Internal: Pushes a value into stack
 void em8051_push(struct em8051 *aCPU, int aValue);
 
@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sifteo/abi/vram.h>
 
 #include "tracer.h"
 #include "cube_debug.h"
@@ -47,8 +48,27 @@ NEVER_INLINE void trace_execution(em8051 *aCPU)
 
 NEVER_INLINE void profile_tick(em8051 *aCPU)
 {
+    /*
+     * Cycles are also bucketed by the video mode that was selected at
+     * the time, and LCD frames are credited to the mode that finished
+     * them. Together, that gives a per-frame cycle budget for every mode.
+     */
+
     struct profile_data *pd = &aCPU->mProfileData[aCPU->mPreviousPC];
+    unsigned mode = (aCPU->mExtData[_SYS_VA_MODE] & _SYS_VM_MASK) >> 2;
+
     pd->total_cycles += aCPU->mTickDelay;
+    pd->mode_cycles[mode] += aCPU->mTickDelay;
+
+    struct profile_frames *pf = aCPU->mProfileFrames;
+    uint32_t lcdFrames = ((Cube::Hardware*) aCPU->callbackData)->lcd.getFrameCount();
+    if (lcdFrames != pf->lcd_frames) {
+        // Counter can go backwards on a state restore; just resync
+        if (lcdFrames > pf->lcd_frames)
+            pf->mode_frames[mode] += lcdFrames - pf->lcd_frames;
+        pf->lcd_frames = lcdFrames;
+    }
+
     if (pd->loop_prev) {
         pd->loop_cycles += aCPU->vtime->clocks - pd->loop_prev;
         pd->loop_hits++;
@@ -156,9 +176,30 @@ void em8051_init_sbt(struct em8051 *aCPU)
      * exec function which executes translated basic-blocks.
      */
     memcpy(aCPU->mCodeMem, sbt_rom_data, sizeof aCPU->mCodeMem);
+    em8051_invalidate_code(aCPU);
     aCPU->sbt = true;
 }
 
+void em8051_invalidate_code(em8051 *aCPU)
+{
+    memset(aCPU->mDecoded, 0, sizeof aCPU->mDecoded);
+}
+
+void em8051_predecode(em8051 *aCPU, unsigned aPosition)
+{
+    /*
+     * Operands are fetched speculatively, wrapping at the end of code
+     * memory, exactly as the interpreter always has. Opcode handlers
+     * ignore whichever operands they don't use.
+     */
+
+    em8051decoded &d = aCPU->mDecoded[aPosition & PC_MASK];
+    d.opcode = aCPU->mCodeMem[aPosition & PC_MASK];
+    d.operand1 = aCPU->mCodeMem[(aPosition + 1) & PC_MASK];
+    d.operand2 = aCPU->mCodeMem[(aPosition + 2) & PC_MASK];
+    d.op = aCPU->op[d.opcode];
+}
+
 int em8051_load(em8051 *aCPU, const char *aFilename)
 {
     FILE *f;    
@@ -168,6 +209,7 @@ int em8051_load(em8051 *aCPU, const char *aFilename)
     if (!f) return -1;
     if (fgetc(f) != ':')
         return -2; // unsupported file format
+    em8051_invalidate_code(aCPU);
     while (!feof(f))
     {
         int recordlength;
@@ -51,14 +51,20 @@ static ALWAYS_INLINE void timer_tick(em8051 *aCPU, unsigned numTicks)
      * The timer code is slow, and we'd really rather not run it every tick.
      */
 
-    aCPU->prescaler12 -= numTicks;
-     
-    if (UNLIKELY(!aCPU->prescaler12)) { 
-        aCPU->prescaler12 = 12;
+    if (UNLIKELY(numTicks >= aCPU->prescaler12)) {
+        /*
+         * Normally batches end exactly on a prescaler edge. Longer batches
+         * only happen while the timers are stopped (see Hardware::idleTicks)
+         * so a single tick12 edge stands in for all the ones we skipped.
+         */
+        aCPU->prescaler12 = 12 - (numTicks - aCPU->prescaler12) % 12;
         timer_tick_work(aCPU, true);
-        
-    } else if (UNLIKELY(aCPU->needTimerEdgeCheck)) {
-        timer_tick_work(aCPU, false);
+
+    } else {
+        aCPU->prescaler12 -= numTicks;
+
+        if (UNLIKELY(aCPU->needTimerEdgeCheck))
+            timer_tick_work(aCPU, false);
     }
 }
 
@@ -67,6 +73,8 @@ static ALWAYS_INLINE void em8051_tick(em8051 *aCPU, unsigned numTicks,
                                       bool sbt, bool isProfiling, bool isTracing, bool hasBreakpoint,
                                       bool *ticked)
 {
+    aCPU->tickCount += numTicks;
+
     if (aCPU->powerDown) {
         // Arbitrary large batch size when we're off.
         aCPU->mTickDelay = 1024;
@@ -122,11 +130,13 @@ static ALWAYS_INLINE void em8051_tick(em8051 *aCPU, unsigned numTicks,
 
             if (sbt) {
                 aCPU->mTickDelay = sbt_rom_code[pc](aCPU);
+                aCPU->blockCount++;
             } else {
-                uint8_t opcode = aCPU->mCodeMem[pc];
-                uint8_t operand1 = aCPU->mCodeMem[(pc + 1) & PC_MASK];
-                uint8_t operand2 = aCPU->mCodeMem[(pc + 2) & PC_MASK];
-                aCPU->mTickDelay = aCPU->op[aCPU->mCodeMem[pc]](aCPU, pc, opcode, operand1, operand2);
+                // Code memory rarely changes, so each address is decoded only once.
+                const em8051decoded &d = aCPU->mDecoded[pc];
+                if (UNLIKELY(!d.op))
+                    em8051_predecode(aCPU, pc);
+                aCPU->mTickDelay = d.op(aCPU, pc, d.opcode, d.operand1, d.operand2);
                 aCPU->mPC = pc & PC_MASK;
             }
             
@@ -187,6 +187,7 @@ int irq_invoke(struct em8051 *cpu, uint8_t priority, uint16_t vector)
     memcpy(cpu->irql[cpu->irq_count].r, cpu->mSFR, 8);
 
     cpu->irq_count++;
+    cpu->irqDispatchCount++;
     return 1;
 }
 
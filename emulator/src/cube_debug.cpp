@@ -30,14 +30,49 @@
 
 #include <curses.h>
 #include "cube_debug.h"
+#include "ostime.h"
 
 namespace Cube {
 namespace Debug {
 
-unsigned char history[HISTORY_SIZE];
+/*
+ * Execution history. Each instruction gets a small entry with its PC,
+ * plus one delta for every byte of IRAM or SFR space that changed since
+ * the previous entry. The deltas are enough to rebuild recent states for
+ * display, and to undo instructions for stepBack().
+ *
+ * Both rings use free-running counters. An entry is dropped once its
+ * deltas have been overwritten.
+ */
+
+static const unsigned HISTORY_ENTRIES = 4096;
+static const unsigned HISTORY_DELTAS = 16384;
+static const unsigned STATE_BYTES = 256 + 128;
+
+struct HistoryEntry {
+    uint32_t firstDelta;
+    uint16_t numDeltas;
+    uint16_t pc;
+};
+
+struct HistoryDelta {
+    uint16_t index;             // mData, then mSFR
+    uint8_t oldValue;
+    uint8_t newValue;
+};
+
+static HistoryEntry historyEntries[HISTORY_ENTRIES];
+static HistoryDelta historyDeltas[HISTORY_DELTAS];
+static uint32_t entryHead, entryTail, deltaHead;
+
+// State after the newest entry
+static HistoryState shadow;
+static bool shadowValid = false;
+
+// While running flat out, the UI is redrawn at this rate instead of per batch
+static const double UI_UPDATE_INTERVAL = 1.0 / 30;
+static double nextUIUpdate = 0;
 
-// current line in the history cyclic buffers
-int historyline = 0;
 // last known columns and rows; for screen resize detection
 int oldcols, oldrows;
 
@@ -181,23 +216,131 @@ void refreshView()
     change_view(&cube->cpu, view);
 }
 
-void recordHistory()
+static uint8_t &stateByte(HistoryState &state, unsigned index)
 {
-    if (speed > 0) {
-        CPU::em8051 *aCPU = &cube->cpu;
+    return index < sizeof state.data ? state.data[index]
+        : state.sfr[index - sizeof state.data];
+}
 
-        icount++;
+static void diffHistory(const uint8_t *current, uint8_t *old, unsigned base, unsigned len)
+{
+    // Most of the state is unchanged, so skip it eight bytes at a time.
+    for (unsigned i = 0; i < len; i += 8) {
+        if (!memcmp(current + i, old + i, 8))
+            continue;
+
+        for (unsigned j = i; j < i + 8; j++)
+            if (current[j] != old[j]) {
+                HistoryDelta &d = historyDeltas[deltaHead++ % HISTORY_DELTAS];
+                d.index = base + j;
+                d.oldValue = old[j];
+                d.newValue = current[j];
+                old[j] = current[j];
+            }
+    }
+}
 
-        historyline = (historyline + 1) % HISTORY_LINES;
+static void undoHistoryEntry(const HistoryEntry &e, HistoryState &state)
+{
+    for (unsigned i = e.numDeltas; i; --i) {
+        const HistoryDelta &d = historyDeltas[(e.firstDelta + i - 1) % HISTORY_DELTAS];
+        stateByte(state, d.index) = d.oldValue;
+    }
+    state.pc = e.pc;
+}
+
+void clearHistory()
+{
+    entryHead = entryTail = deltaHead = 0;
+    shadowValid = false;
+}
+
+void recordHistory()
+{
+    CPU::em8051 *aCPU = &cube->cpu;
+
+    if (speed == 0) {
+        // Not recording; whatever we have is stale now.
+        shadowValid = false;
+        return;
+    }
 
-        memcpy(history + (historyline * (128 + 64 + sizeof(int))), aCPU->mSFR, 128);
-        memcpy(history + (historyline * (128 + 64 + sizeof(int))) + 128, aCPU->mData, 64);
-        memcpy(history + (historyline * (128 + 64 + sizeof(int))) + 128 + 64, &aCPU->mPreviousPC, sizeof(int));
-        
-        uint8_t sp = aCPU->mSFR[REG_SP];
-        if (sp > stackMax)
-            stackMax = sp;
+    if (!shadowValid) {
+        // Start over from the current state. This instruction's
+        // previous state is unknown, so it can't be recorded.
+        clearHistory();
+        memcpy(shadow.data, aCPU->mData, sizeof shadow.data);
+        memcpy(shadow.sfr, aCPU->mSFR, sizeof shadow.sfr);
+        shadow.pc = aCPU->mPC;
+        shadowValid = true;
+        return;
     }
+
+    if (entryHead - entryTail == HISTORY_ENTRIES)
+        entryTail++;
+
+    HistoryEntry &e = historyEntries[entryHead++ % HISTORY_ENTRIES];
+    e.firstDelta = deltaHead;
+    e.pc = aCPU->mPreviousPC;
+
+    diffHistory(aCPU->mData, shadow.data, 0, sizeof shadow.data);
+    diffHistory(aCPU->mSFR, shadow.sfr, sizeof shadow.data, sizeof shadow.sfr);
+    e.numDeltas = deltaHead - e.firstDelta;
+    shadow.pc = aCPU->mPC;
+
+    while (entryTail != entryHead &&
+        deltaHead - historyEntries[entryTail % HISTORY_ENTRIES].firstDelta > HISTORY_DELTAS)
+        entryTail++;
+
+    icount++;
+
+    uint8_t sp = aCPU->mSFR[REG_SP];
+    if (sp > stackMax)
+        stackMax = sp;
+}
+
+bool historyState(unsigned age, HistoryState &state)
+{
+    /*
+     * Rebuild the state just after the instruction 'age' entries back,
+     * where zero is the most recent one. Returns false if that's further
+     * back than the history goes.
+     */
+
+    if (!shadowValid || age >= entryHead - entryTail)
+        return false;
+
+    state = shadow;
+    for (unsigned i = 0; i < age; i++)
+        undoHistoryEntry(historyEntries[(entryHead - 1 - i) % HISTORY_ENTRIES], state);
+    state.pc = historyEntries[(entryHead - 1 - age) % HISTORY_ENTRIES].pc;
+
+    return true;
+}
+
+bool stepBack()
+{
+    /*
+     * Undo the most recent instruction. Only IRAM, SFRs, and the PC are
+     * rewound. XDATA, flash, peripherals, and time carry on as they are.
+     */
+
+    CPU::em8051 *aCPU = &cube->cpu;
+
+    if (!shadowValid || entryHead == entryTail)
+        return false;
+
+    const HistoryEntry &e = historyEntries[--entryHead % HISTORY_ENTRIES];
+    undoHistoryEntry(e, shadow);
+    deltaHead = e.firstDelta;
+    icount--;
+
+    memcpy(aCPU->mData, shadow.data, sizeof shadow.data);
+    memcpy(aCPU->mSFR, shadow.sfr, sizeof shadow.sfr);
+    aCPU->mPC = e.pc;
+    aCPU->mTickDelay = 0;
+
+    return true;
 }
 
 void init()
@@ -229,6 +372,7 @@ void attach(Cube::Hardware *_cube)
 {
     cube = _cube;
     stackMax = 0;
+    clearHistory();
     setSpeed(speed, runmode);
 }
 
@@ -237,6 +381,14 @@ bool updateUI()
     CPU::em8051 *aCPU = &cube->cpu;
     bool step = false;
 
+    if (runmode != 0 && speed < 4) {
+        // Running without a key delay. Don't redraw more often than we need to.
+        double now = OSTime::clock();
+        if (now < nextUIUpdate)
+            return false;
+        nextUIUpdate = now + UI_UPDATE_INTERVAL;
+    }
+
     while (!step) {
         int ch = getch();
 
@@ -381,6 +533,40 @@ void writeProfile(CPU::em8051 *aCPU, const char *filename)
         }
     }    
 
+    /*
+     * Per-mode budget. The summary is for humans; the per-address
+     * records after it let firmware-cycleprof.py attribute each mode's
+     * cycles to firmware modules and functions.
+     */
+
+    CPU::profile_frames *pf = aCPU->mProfileFrames;
+
+    fprintf(f, "\nmode   frames        total_cycles  cycles/frame\n");
+    for (int mode = 0; mode < PROFILE_NUM_MODES; mode++) {
+        uint64_t cycles = 0;
+        for (int addr = 0; addr < CODE_SIZE; addr++)
+            cycles += aCPU->mProfileData[addr].mode_cycles[mode];
+        if (!cycles)
+            continue;
+
+        uint32_t frames = pf->mode_frames[mode];
+        fprintf(f, "0x%02x %8d  %18lld  %12lld\n", mode << 2, frames,
+            (long long)cycles, frames ? (long long)(cycles / frames) : 0LL);
+    }
+
+    fprintf(f, "\nmode_cycles  addr  mode        cycles\n");
+    pd = aCPU->mProfileData;
+    for (int addr = 0; addr < CODE_SIZE; addr++, pd++)
+        for (int mode = 0; mode < PROFILE_NUM_MODES; mode++)
+            if (pd->mode_cycles[mode])
+                fprintf(f, "mode_cycles  %04x  0x%02x  %12lld\n", addr, mode << 2,
+                    (long long)pd->mode_cycles[mode]);
+
+    fprintf(f, "\nmode_frames  mode   frames\n");
+    for (int mode = 0; mode < PROFILE_NUM_MODES; mode++)
+        if (pf->mode_frames[mode])
+            fprintf(f, "mode_frames  0x%02x  %8d\n", mode << 2, pf->mode_frames[mode]);
+
     fclose(f);
     fprintf(stderr, "Profiler output written to '%s'\n", filename);
 }
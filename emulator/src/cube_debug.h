@@ -41,7 +41,6 @@ namespace Cube {
 namespace Debug {
 
 #define HISTORY_LINES  20
-#define HISTORY_SIZE   (HISTORY_LINES * (128 + 64 + sizeof(int)))
 #define FILENAME_SIZE  256
 
 enum EMU_VIEWS
@@ -52,8 +51,12 @@ enum EMU_VIEWS
     NUM_VIEWS,
 };
 
-// binary history buffer
-extern unsigned char history[HISTORY_SIZE];
+// CPU state after one instruction, rebuilt from the execution history
+struct HistoryState {
+    uint8_t data[256];
+    uint8_t sfr[128];
+    unsigned pc;
+};
 
 // last used filename
 extern char filename[FILENAME_SIZE];
@@ -61,9 +64,6 @@ extern char filename[FILENAME_SIZE];
 // instruction count; needed to replay history correctly
 extern unsigned int icount;
 
-// current line in the history cyclic buffers
-extern int historyline;
-
 // last known columns and rows; for screen resize detection
 extern int oldcols, oldrows;
 
@@ -93,6 +93,9 @@ void exit();
 void writeProfile(CPU::em8051 *aCPU, const char *filename);
 bool updateUI();
 void recordHistory();
+void clearHistory();
+bool historyState(unsigned age, HistoryState &state);
+bool stepBack();
 void refreshView();
 void setSpeed(int speed, int runmode);
 
@@ -290,6 +290,12 @@ void mainview_editor_keys(CPU::em8051 *aCPU, int ch)
 
     switch(ch)
     {
+    case 'u':
+    case 'U':
+        // Step back one instruction; the history view redraws itself.
+        if (runmode == 0 && !stepBack())
+            emu_popup(aCPU, "Step back", "No more history.");
+        break;
     case KEY_NEXT:
     case '\t':
         cursorpos = 0;
@@ -413,6 +419,8 @@ void mainview_editor_keys(CPU::em8051 *aCPU, int ch)
             else
                 memarea[memoffset + (memcursorpos / 2)] = (memarea[memoffset + (memcursorpos / 2)] & 0x0f) | (insert_value << 4);
             memcursorpos++;
+            if (memarea == aCPU->mCodeMem)
+                CPU::em8051_invalidate_code(aCPU);
         }
         if (focus == 1)
         {
@@ -503,7 +511,6 @@ void mainview_update(Cube::Hardware *cube)
     int opcode_bytes;
     int stringpos;
     int rx;
-    unsigned int hline;
 
     if ((speed != 0 || !runmode) && lastclock != icount)
     {
@@ -511,21 +518,19 @@ void mainview_update(Cube::Hardware *cube)
         if (icount - lastclock > HISTORY_LINES)
             lastclock = icount - HISTORY_LINES;
 
-        // + HISTORY_LINES to force positive result
-        hline = historyline - (icount - lastclock) + HISTORY_LINES;
-
         while (lastclock != icount)
         {
             char assembly[128];
             char temp[256];
             int old_pc;
-            int hoffs;
-            
-            hline = (hline + 1) % HISTORY_LINES;
+            HistoryState state;
 
-            hoffs = (hline * (128 + 64 + sizeof(int)));
+            if (!historyState(icount - lastclock - 1, state)) {
+                lastclock++;
+                continue;
+            }
 
-            memcpy(&old_pc, history + hoffs + 128 + 64, sizeof(int));
+            old_pc = state.pc;
             opcode_bytes = CPU::em8051_decode(aCPU, old_pc, assembly);
             stringpos = 0;
             stringpos += sprintf(temp + stringpos,"\n%04X  ", old_pc & 0xffff);
@@ -540,57 +545,57 @@ void mainview_update(Cube::Hardware *cube)
 
             wprintw(codeoutput, "%s", temp);
 
-            rx = 8 * ((history[hoffs + REG_PSW] & (PSWMASK_RS0|PSWMASK_RS1))>>PSW_RS0);
+            rx = 8 * ((state.sfr[REG_PSW] & (PSWMASK_RS0|PSWMASK_RS1))>>PSW_RS0);
             
             sprintf(temp, "\n%02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %04X",
-                history[hoffs + REG_ACC],
-                history[hoffs + 128 + 0 + rx],
-                history[hoffs + 128 + 1 + rx],
-                history[hoffs + 128 + 2 + rx],
-                history[hoffs + 128 + 3 + rx],
-                history[hoffs + 128 + 4 + rx],
-                history[hoffs + 128 + 5 + rx],
-                history[hoffs + 128 + 6 + rx],
-                history[hoffs + 128 + 7 + rx],
-                history[hoffs + REG_B],
-                    (history[hoffs + SEL_DPH(history[hoffs + REG_DPS])]<<8) |
-                     history[hoffs + SEL_DPL(history[hoffs + REG_DPS])]);
+                state.sfr[REG_ACC],
+                state.data[0 + rx],
+                state.data[1 + rx],
+                state.data[2 + rx],
+                state.data[3 + rx],
+                state.data[4 + rx],
+                state.data[5 + rx],
+                state.data[6 + rx],
+                state.data[7 + rx],
+                state.sfr[REG_B],
+                    (state.sfr[SEL_DPH(state.sfr[REG_DPS])]<<8) |
+                     state.sfr[SEL_DPL(state.sfr[REG_DPS])]);
             if (focus == 1)
                 refresh_regoutput(aCPU, 0);
             wprintw(regoutput,"%s",temp);
 
             sprintf(temp, "\n%d %d %d %d %d %d %d %d",
-                (history[hoffs + REG_PSW] >> 7) & 1,
-                (history[hoffs + REG_PSW] >> 6) & 1,
-                (history[hoffs + REG_PSW] >> 5) & 1,
-                (history[hoffs + REG_PSW] >> 4) & 1,
-                (history[hoffs + REG_PSW] >> 3) & 1,
-                (history[hoffs + REG_PSW] >> 2) & 1,
-                (history[hoffs + REG_PSW] >> 1) & 1,
-                (history[hoffs + REG_PSW] >> 0) & 1);
+                (state.sfr[REG_PSW] >> 7) & 1,
+                (state.sfr[REG_PSW] >> 6) & 1,
+                (state.sfr[REG_PSW] >> 5) & 1,
+                (state.sfr[REG_PSW] >> 4) & 1,
+                (state.sfr[REG_PSW] >> 3) & 1,
+                (state.sfr[REG_PSW] >> 2) & 1,
+                (state.sfr[REG_PSW] >> 1) & 1,
+                (state.sfr[REG_PSW] >> 0) & 1);
             wprintw(pswoutput,"%s",temp);
 
             sprintf(temp, "\n%02X %02X %02X %02X %02X-%02X %02X",
-                    history[hoffs + REG_P0],
-                    history[hoffs + REG_P1],
-                    history[hoffs + REG_P2],
-                    history[hoffs + REG_P3],
-                    history[hoffs + REG_IEN0],
-                    history[hoffs + REG_IEN1],
-                    history[hoffs + REG_IRCON]);
+                    state.sfr[REG_P0],
+                    state.sfr[REG_P1],
+                    state.sfr[REG_P2],
+                    state.sfr[REG_P3],
+                    state.sfr[REG_IEN0],
+                    state.sfr[REG_IEN1],
+                    state.sfr[REG_IRCON]);
             wprintw(ioregoutput,"%s",temp);
 
             sprintf(temp, "\n%02X   %02X    %02X%02X  %02X%02X  %02X%02X   %02X   %02X",
-                history[hoffs + REG_TMOD],
-                history[hoffs + REG_TCON],
-                history[hoffs + REG_TH0],
-                history[hoffs + REG_TL0],
-                history[hoffs + REG_TH1],
-                history[hoffs + REG_TL1],
-                history[hoffs + REG_TH2],
-                history[hoffs + REG_TL2],
-                history[hoffs + REG_S0CON],
-                history[hoffs + REG_P0CON]);
+                state.sfr[REG_TMOD],
+                state.sfr[REG_TCON],
+                state.sfr[REG_TH0],
+                state.sfr[REG_TL0],
+                state.sfr[REG_TH1],
+                state.sfr[REG_TL1],
+                state.sfr[REG_TH2],
+                state.sfr[REG_TL2],
+                state.sfr[REG_S0CON],
+                state.sfr[REG_P0CON]);
             wprintw(spregoutput, "%s", temp);
 
             lastclock++;
@@ -637,7 +642,7 @@ void mainview_update(Cube::Hardware *cube)
                 radio_rx = cube->spi.radio.getRXCount() / virtual_elapsed;
                 flash_hz = cube->flash.getCycleCount() / virtual_elapsed;
                 clock_ratio = virtual_elapsed / real_elapsed;
-                flash_percent = cube->flash.getBusyPercent();
+                flash_percent = cube->flash.getBusyPercent(cube->time->clocks);
             } else {
                 lcd_fps = 0;
                 radio_b = 0;
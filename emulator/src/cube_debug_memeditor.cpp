@@ -226,6 +226,9 @@ void memeditor_editor_keys(CPU::em8051 *aCPU, int ch)
         eds[focus].cursorpos++;
     }
 
+    if (eds[focus].memarea == aCPU->mCodeMem)
+        CPU::em8051_invalidate_code(aCPU);
+
     while (eds[focus].cursorpos < 0)
     {
         eds[focus].memoffset -= 8;
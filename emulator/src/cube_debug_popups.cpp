@@ -421,6 +421,7 @@ void emu_help(CPU::em8051 *aCPU)
     mvwaddstr(exc, 12, 2, "+ & - - Adjust run speed");
     mvwaddstr(exc, 13, 6, "v - Change views");
     mvwaddstr(exc, 14, 3, "home - Reset (with options)");
+    mvwaddstr(exc, 15, 6, "u - Step back");
 
     mvwaddstr(exc, 8, 32, "shift-q - Quit");
     mvwaddstr(exc, 9, 32, "cursors - Move cursor");
@@ -66,10 +66,11 @@ class Flash {
         storage = _storage;
         
         cycle_count = 0;
+        total_cycle_count = 0;
         write_count = 0;
         erase_count = 0;
         busy_ticks = 0;
-        idle_ticks = 0;
+        busy_window_start = 0;
         busy_status = BF_IDLE;
         latched_addr = 0;
         busy_timer = 0;
@@ -78,14 +79,23 @@ class Flash {
         prev_we = 0;
         prev_oe = 0;
         status_byte = 0;
-        previous_clocks = 0;
         buffer_counter = 0;
     }
 
+    void setFastTiming(bool fast) {
+        // Finish program/erase operations almost immediately
+        fast_timing = fast;
+    }
+
     FlashStorage::CubeRecord *getStorage() const {
         return storage;
     }
 
+    void setStorage(FlashStorage::CubeRecord *_storage) {
+        // Re-bind to a storage record without resetting any state
+        storage = _storage;
+    }
+
     uint32_t getCycleCount() {
         uint32_t c = cycle_count;
         cycle_count = 0;
@@ -94,19 +104,28 @@ class Flash {
 
     enum busy_flag getBusyFlag() {
         // These busy flags are only reset after they're read.
-        enum busy_flag f = busy_status;
+        enum busy_flag f = (enum busy_flag) (busy_status | busy);
         busy_status = BF_IDLE;
         return f;
     }
 
-    unsigned getBusyPercent() {
-        uint32_t total_ticks = busy_ticks + idle_ticks;
-        unsigned percent = total_ticks ? busy_ticks * 100 / total_ticks : 0;
+    unsigned getBusyPercent(uint64_t now) {
+        /*
+         * Busy time is counted when each operation starts, so a long
+         * erase is charged entirely to the window it began in.
+         */
+        uint64_t total_ticks = now - busy_window_start;
+        unsigned percent = total_ticks ? MIN(100, busy_ticks * 100 / total_ticks) : 0;
         busy_ticks = 0;
-        idle_ticks = 0;
+        busy_window_start = now;
         return percent;
     }
 
+    uint32_t getTotalCycleCount() const {
+        // Like getCycleCount(), but never reset. Safe to poll from any thread.
+        return total_cycle_count;
+    }
+
     uint32_t getWriteCount() {
         return write_count;
     }
@@ -121,78 +140,38 @@ class Flash {
 
     ALWAYS_INLINE void tick(TickDeadline &deadline, CPU::em8051 *cpu) {
         /*
-         * March time forward on the current operation, if any.
+         * Nothing to do unless a program/erase operation is in progress.
+         * Its completion time was scheduled in beginBusy(), so we only
+         * get here again once it's due, or when other hardware ticks.
          */
 
-        uint64_t elapsed = deadline.clock() - previous_clocks;
-        previous_clocks = deadline.clock();
-
-        if (UNLIKELY(busy)) {
-            // Latch any busy flags long enough for the UI to see them.
-            busy_status = (enum busy_flag) (busy_status | busy);
-
-            if (busy_timer == 0) {
-                /*
-                 * We just became busy, and haven't set the timer yet.
-                 */
-
-                cpu->needHardwareTick = true;
-                
-                switch (busy) {
-                case BF_PROGRAM_BYTE:
-                    busy_timer = deadline.setRelative(VirtualTime::usec(FlashModel::PROGRAM_BYTE_TIME_US));
-                    break;
-                case BF_PROGRAM_BUFFER:
-                    busy_timer = deadline.setRelative(VirtualTime::usec(FlashModel::PROGRAM_BUFFER_TIME_US));
-                    break;
-                case BF_ERASE_SECTOR:
-                    busy_timer = deadline.setRelative(VirtualTime::usec(FlashModel::ERASE_SECTOR_TIME_US));
-                    break;
-                case BF_ERASE_CHIP:
-                    busy_timer = deadline.setRelative(VirtualTime::usec(FlashModel::ERASE_CHIP_TIME_US));
-                    break;
-                default:
-                    break;
-                }
+        if (LIKELY(!busy))
+            return;
 
-            } else if (deadline.hasPassed(busy_timer)) {
-                /*
-                 * Just finished our operation
-                 */
-
-                Tracer::log(cpu, "FLASH: no longer busy");
-
-                busy = BF_IDLE;
-                busy_timer = 0;
-                
-                /*
-                 * For performance tuning, it's useful to know where the
-                 * flash first became idle.  If it was while we were
-                 * waiting, great. If it was during flash decoding, we're
-                 * wasting time!
-                 */
-                if (cpu->mProfileData) {
-                    unsigned pc = cpu->mPC & PC_MASK;
-                    CPU::profile_data *pd = &cpu->mProfileData[pc];
-                    pd->flash_idle++;
-                }
+        if (!deadline.hasPassed(busy_timer)) {
+            deadline.set(busy_timer);
+            return;
+        }
 
-            } else {
-                /*
-                 * Still busy...
-                 */
+        Tracer::log(cpu, "FLASH: no longer busy");
 
-                deadline.set(busy_timer);
-            }
-
-            busy_ticks += elapsed;
+        busy = BF_IDLE;
+        busy_timer = 0;
 
-        } else {
-            idle_ticks += elapsed;
+        /*
+         * For performance tuning, it's useful to know where the
+         * flash first became idle.  If it was while we were
+         * waiting, great. If it was during flash decoding, we're
+         * wasting time!
+         */
+        if (cpu->mProfileData) {
+            unsigned pc = cpu->mPC & PC_MASK;
+            CPU::profile_data *pd = &cpu->mProfileData[pc];
+            pd->flash_idle++;
         }
     }
 
-    ALWAYS_INLINE void cycle(Pins *pins, CPU::em8051 *cpu) {
+    ALWAYS_INLINE void cycle(Pins *pins, CPU::em8051 *cpu, TickDeadline &deadline) {
         if (pins->ce || !pins->power) {
             // Chip disabled
             pins->data_drv = 0;
@@ -208,11 +187,12 @@ class Flash {
 
             if (!pins->we && prev_we) {
                 cycle_count++;
+                total_cycle_count++;
                 latched_addr = addr;
 
                 cmd_fifo[cmd_fifo_head].addr = addr;
                 cmd_fifo[cmd_fifo_head].data = pins->data_in;
-                matchCommands(cpu);
+                matchCommands(cpu, deadline);
                 cmd_fifo_head = CMD_FIFO_MASK & (cmd_fifo_head + 1);
             }
 
@@ -242,6 +222,7 @@ class Flash {
                 pins->data_drv = 1;
                 if (addr != latched_addr || prev_oe) {
                     cycle_count++;
+                    total_cycle_count++;
                     latched_addr = addr;
 
                     Tracer::log(cpu, "FLASH: read addr [%06x] -> %02x (busy=%d)",
@@ -297,7 +278,7 @@ class Flash {
             storage->eraseCounts[s]++;
     }
 
-    void handleBufferWrite(CPU::em8051 *cpu) {
+    void handleBufferWrite(CPU::em8051 *cpu, TickDeadline &deadline) {
         /*
          * Validate the contents of the command buffer, and start the write if it's okay.
          *
@@ -362,10 +343,33 @@ class Flash {
         }
 
         write_count += buffer_bytes;
-        busy = BF_PROGRAM_BUFFER;
+        beginBusy(BF_PROGRAM_BUFFER, deadline);
     }
 
-    void matchCommands(CPU::em8051 *cpu) {
+    void beginBusy(enum busy_flag flag, TickDeadline &deadline) {
+        /*
+         * Start a self-timed operation, and schedule the hardware tick
+         * that will end it.
+         */
+
+        uint64_t duration;
+        switch (flag) {
+        case BF_PROGRAM_BYTE:   duration = VirtualTime::usec(FlashModel::PROGRAM_BYTE_TIME_US); break;
+        case BF_PROGRAM_BUFFER: duration = VirtualTime::usec(FlashModel::PROGRAM_BUFFER_TIME_US); break;
+        case BF_ERASE_SECTOR:   duration = VirtualTime::usec(FlashModel::ERASE_SECTOR_TIME_US); break;
+        case BF_ERASE_CHIP:     duration = VirtualTime::usec(FlashModel::ERASE_CHIP_TIME_US); break;
+        default:                return;
+        }
+
+        if (fast_timing)
+            duration = VirtualTime::usec(FAST_BUSY_TIME_US);
+
+        busy = flag;
+        busy_ticks += duration;
+        busy_timer = deadline.setRelative(duration);
+    }
+
+    void matchCommands(CPU::em8051 *cpu, TickDeadline &deadline) {
         struct cmd_state *st = &cmd_fifo[cmd_fifo_head];
 
         // Busy? (In a self-timed program/erase operation)
@@ -381,7 +385,7 @@ class Flash {
             if (buffer_sa == sectorAddr(st->addr)) {
                 if (!--buffer_counter) {
                     // Finished buffer.
-                    handleBufferWrite(cpu);
+                    handleBufferWrite(cpu, deadline);
                 }
                 return;
             } else {
@@ -416,7 +420,7 @@ class Flash {
 
             storage->ext[st->addr] &= st->data;
             status_byte = FlashModel::STATUS_DATA_INV & ~st->data;
-            busy = BF_PROGRAM_BYTE;
+            beginBusy(BF_PROGRAM_BYTE, deadline);
             write_count++;
 
         } else if (matchCommand(FlashModel::cmd_sector_erase)) {
@@ -424,7 +428,7 @@ class Flash {
 
             erase(st->addr, FlashModel::SECTOR_SIZE);
             status_byte = 0;
-            busy = BF_ERASE_SECTOR;
+            beginBusy(BF_ERASE_SECTOR, deadline);
             erase_count++;
 
         } else if (matchCommand(FlashModel::cmd_chip_erase)) {
@@ -432,7 +436,7 @@ class Flash {
 
             erase(st->addr, FlashModel::SIZE);
             status_byte = 0;
-            busy = BF_ERASE_CHIP;
+            beginBusy(BF_ERASE_CHIP, deadline);
             erase_count++;
         }
     }
@@ -458,6 +462,10 @@ class Flash {
 
     // Power of two, and large enough to hold the longest possible buffer-program op
     static const uint8_t CMD_FIFO_MASK = 0x3F;
+
+    // Busy time for any operation, with setFastTiming(). Still long enough
+    // that firmware sees at least one status poll report busy.
+    static const unsigned FAST_BUSY_TIME_US = 1;
  
     struct cmd_state {
         uint32_t addr;
@@ -468,17 +476,18 @@ class Flash {
 
     // For clock speed / power metrics
     uint32_t cycle_count;
+    uint32_t total_cycle_count;
     uint32_t write_count;
     uint32_t erase_count;
-    uint32_t busy_ticks;
-    uint32_t idle_ticks;
+    uint64_t busy_ticks;
+    uint64_t busy_window_start;
     enum busy_flag busy_status;
-    uint64_t previous_clocks;
 
     // Command state
     uint32_t latched_addr;
     uint64_t busy_timer;
     enum busy_flag busy;
+    bool fast_timing;
     uint8_t cmd_fifo_head;
     uint8_t buffer_counter;
     uint8_t buffer_bytes;
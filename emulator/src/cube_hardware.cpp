@@ -27,6 +27,7 @@
 #include "cube_hardware.h"
 #include "cube_debug.h"
 #include "cube_cpu_callbacks.h"
+#include "latencytracer.h"
 
 namespace Cube {
 
@@ -67,7 +68,7 @@ bool Hardware::init(VirtualTime *masterTimer, const char *firmwareFile,
     rng.init();
     neighbors.init();
     
-    setTouch(false);
+    applyTouch(false);
     
     // XXX: Simulated battery level
     i2c.accel.setADC1(0x8760);
@@ -75,6 +76,53 @@ bool Hardware::init(VirtualTime *masterTimer, const char *firmwareFile,
     return true;
 }
 
+void Hardware::restoreState(const Hardware &saved)
+{
+    /*
+     * Everything in this object is plain simulation state, except for a
+     * few pointers which bind us to the rest of the process: our clock,
+     * flash storage, peers, profiler, and function tables. Copy the state
+     * wholesale, then put those back. Flash contents are not part of
+     * this object; they're restored separately by FlashStorage. The
+     * decoded-instruction cache holds handler pointers too, so it's
+     * simply discarded.
+     */
+
+    VirtualTime *boundTime = time;
+    void *boundCallback = cpu.callbackData;
+    FILE *boundTraceFile = cpu.traceFile;
+    CPU::profile_data *boundProfile = cpu.mProfileData;
+    CPU::profile_frames *boundFrames = cpu.mProfileFrames;
+    FlashStorage::CubeRecord *boundStorage = flash.getStorage();
+    Hardware *boundPeers = neighbors.getPeers();
+
+    // The sensor mailbox and queue belong to their producers, not the simulation
+    TripleBuffer<Sensors> boundMailbox = sensorMailbox;
+    Sensors boundInputs = sensorInputs;
+    SPSCQueue<SensorEvent, SENSOR_QUEUE_SIZE> boundQueue = sensorQueue;
+
+    memcpy(this, &saved, sizeof *this);
+
+    sensorMailbox = boundMailbox;
+    sensorInputs = boundInputs;
+    sensorQueue = boundQueue;
+
+    time = boundTime;
+    cpu.vtime = boundTime;
+    hwDeadline.setTimeBase(boundTime);
+    cpu.callbackData = boundCallback;
+    cpu.traceFile = boundTraceFile;
+    cpu.mProfileData = boundProfile;
+    cpu.mProfileFrames = boundFrames;
+    flash.setStorage(boundStorage);
+    neighbors.attachCubes(boundPeers);
+    spi.attachCPU(&cpu);
+
+    CPU::disasm_setptrs(&cpu);
+    CPU::op_setptrs(&cpu);
+    CPU::em8051_invalidate_code(&cpu);
+}
+
 uint64_t Hardware::getHWID() const
 {
     /*
@@ -110,6 +158,7 @@ void CPU::except(CPU::em8051 *cpu, int exc)
     self->incExceptionCount();
 
     Tracer::log(cpu, "@%04x EXCEPTION: %s", cpu->mPC, name);
+    Tracer::trigger("cube exception");
 
     if (self == Cube::Debug::cube && Cube::Debug::stopOnException)
         Cube::Debug::emu_exception(cpu, exc);
@@ -199,9 +248,12 @@ void Hardware::graphicsTick()
         /* data_in */ bus,
     };
 
-    flash.cycle(&flashp, &cpu);
+    flash.cycle(&flashp, &cpu, hwDeadline);
     lcd.cycle(&lcdp);
 
+    if (UNLIKELY(LatencyTracer::isEnabled()))
+        LatencyTracer::lcdUpdate(*this);
+
     /* Backlight latch */
     if ((ctrl_port & CTRL_FLASH_LAT1) && !(prev_ctrl_port & CTRL_FLASH_LAT1)) {
         const uint8_t mask = CTRL_3V3_EN | CTRL_LCD_DCX;
@@ -241,27 +293,35 @@ void Hardware::setAcceleration(float xG, float yG, float zG)
      * the firmware has it configured for a full scale of +/- 2g).
      */
 
-    i2c.accel.setVector(scaleAccelAxis(xG), scaleAccelAxis(yG), scaleAccelAxis(zG));
+    sensorInputs.accel[0] = scaleAccelAxis(xG);
+    sensorInputs.accel[1] = scaleAccelAxis(yG);
+    sensorInputs.accel[2] = scaleAccelAxis(zG);
+
+    sensorMailbox.write() = sensorInputs;
+    sensorMailbox.publish();
 }
 
-int16_t Hardware::scaleAccelAxis(float g)
+int16_t Hardware::scaleAccelAxis(float g, bool noisy)
 {
     /*
      * Scale a raw acceleration, in G's, and return the corresponding
      * two's complement accelerometer reading.
      *
      * Simulates some of our non-ideal behavior, such as saturation at
-     * the extremes, and a little bit of noise.
+     * the extremes, and (optionally) a little bit of noise.
      */
 
     const int range = 1 << 15;
     const float fullScale = 2.0f;
     const int noiseAmount = 0x60;  // A little less than 1 LSB after truncation
 
-    unsigned randomBits = rand();
-    int noise = ((randomBits & 0xFFFF) * noiseAmount) >> 16;
-    if ((randomBits >> 16) & 1)
-        noise = -noise;
+    int noise = 0;
+    if (noisy) {
+        unsigned randomBits = rand();
+        noise = ((randomBits & 0xFFFF) * noiseAmount) >> 16;
+        if ((randomBits >> 16) & 1)
+            noise = -noise;
+    }
 
     int scaled = g * (range / fullScale) + noise;
     int16_t truncated = scaled;
@@ -279,6 +339,8 @@ NEVER_INLINE void Hardware::hwDeadlineWork()
     cpu.needHardwareTick = false;
     hwDeadline.reset();
 
+    applySensorEvents();
+
     lcd.tick(hwDeadline, &cpu);
     adc.tick(hwDeadline, &cpu);
     spi.tick(hwDeadline, cpu.mSFR + REG_SPIRCON0, &cpu);
@@ -289,10 +351,81 @@ NEVER_INLINE void Hardware::hwDeadlineWork()
 
 void Hardware::setTouch(bool touching)
 {
+    sensorInputs.touch = touching;
+
+    sensorMailbox.write() = sensorInputs;
+    sensorMailbox.publish();
+}
+
+void Hardware::pollSensors()
+{
+    // Apply the frontend's latest sensor inputs, if they've changed
+
+    if (sensorMailbox.consume()) {
+        const Sensors &s = sensorMailbox.read();
+        i2c.accel.setVector(s.accel[0], s.accel[1], s.accel[2]);
+        LatencyTracer::tilt(*this, s.accel);
+        applyTouch(s.touch);
+    }
+
+    // Notice newly scheduled inputs, and set a deadline for them
+    applySensorEvents();
+}
+
+bool Hardware::scheduleAcceleration(uint64_t clock, float xG, float yG, float zG)
+{
+    SensorEvent e;
+    e.clock = clock;
+    e.accel[0] = scaleAccelAxis(xG, false);
+    e.accel[1] = scaleAccelAxis(yG, false);
+    e.accel[2] = scaleAccelAxis(zG, false);
+    e.isTouch = false;
+    e.touch = false;
+    return sensorQueue.push(e);
+}
+
+bool Hardware::scheduleTouch(uint64_t clock, bool touching)
+{
+    SensorEvent e;
+    e.clock = clock;
+    e.isTouch = true;
+    e.touch = touching;
+    return sensorQueue.push(e);
+}
+
+void Hardware::applySensorEvents()
+{
+    /*
+     * Apply every scheduled input that's due, and make sure we're
+     * back here on the tick the next one is due.
+     */
+
+    const SensorEvent *e;
+    while ((e = sensorQueue.peek()) && e->clock <= time->clocks) {
+        if (e->isTouch)
+            applyTouch(e->touch);
+        else {
+            i2c.accel.setVector(e->accel[0], e->accel[1], e->accel[2]);
+            LatencyTracer::tilt(*this, e->accel);
+        }
+        sensorQueue.pop();
+    }
+
+    if (e)
+        hwDeadline.set(e->clock);
+}
+
+void Hardware::applyTouch(bool touching)
+{
+    bool wasTouching = (cpu.mSFR[MISC_PORT] & MISC_TOUCH) != 0;
+
     if (touching)
         cpu.mSFR[MISC_PORT] |= MISC_TOUCH;
     else
         cpu.mSFR[MISC_PORT] &= ~MISC_TOUCH;
+
+    if (touching != wasTouching)
+        LatencyTracer::touch(*this);
 }
 
 bool Hardware::isDebugging()
@@ -300,6 +433,15 @@ bool Hardware::isDebugging()
     return this == Cube::Debug::cube;
 }
 
+void Hardware::getCounters(Counters &c) const
+{
+    c.ticks = cpu.tickCount;
+    c.sbtBlocks = cpu.blockCount;
+    c.irqDispatches = cpu.irqDispatchCount;
+    c.flashCycles = flash.getTotalCycleCount();
+    c.lcdPixels = lcd.getPixelCount();
+}
+
 uint32_t Hardware::getExceptionCount()
 {
     return exceptionCount;
@@ -46,6 +46,7 @@
 #include "vtime.h"
 #include "tracer.h"
 #include "flash_storage.h"
+#include "mailbox.h"
 
 
 namespace Cube {
@@ -83,6 +84,8 @@ static const uint8_t RFCON_RFCE      = 0x01;
 
 class Hardware {
  public:
+    static const unsigned MAX_IDLE_TICKS = 16384;   // About 1ms
+
     CPU::em8051 cpu;
     VirtualTime *time;
     LCD lcd;
@@ -102,6 +105,9 @@ class Hardware {
     void reset();
     void fullReset();
 
+    /// Load state from a raw copy of a Hardware object, saved by this same build
+    void restoreState(const Hardware &saved);
+
     ALWAYS_INLINE unsigned id() const {
         return cpu.id;
     }
@@ -140,13 +146,77 @@ class Hardware {
                         (unsigned)hwDeadline.remaining());
     }
 
+    ALWAYS_INLINE unsigned idleTicks() const {
+        /*
+         * If the CPU is powered down with its timers stopped, nothing can
+         * happen until our next hardware deadline, a neighbor pulse, or a
+         * wake-up pin. Returns the number of ticks the caller may skip before
+         * the next tickFastSBT(), as long as needTimerEdgeCheck stays clear.
+         * Zero if we aren't idle. Pins are polled at least every
+         * MAX_IDLE_TICKS.
+         */
+
+        if (!cpu.powerDown || cpu.needTimerEdgeCheck || cpu.needHardwareTick)
+            return 0;
+
+        switch (cpu.mSFR[REG_PWRDWN] & PWRDWN_MODE_MASK) {
+            case PWRDWN_DEEP_SLEEP:
+            case PWRDWN_MEMORY:
+                return std::min<uint64_t>(MAX_IDLE_TICKS, hwDeadline.remaining());
+            default:
+                return 0;
+        }
+    }
+
+    ALWAYS_INLINE void setTimeBase(VirtualTime *t) {
+        /*
+         * Switch to a different clock, which must currently read the same
+         * as our existing clock. Used by the parallel cube tick loop.
+         */
+        time = t;
+        cpu.vtime = t;
+        hwDeadline.setTimeBase(t);
+    }
+
+    void setFastPeripherals(bool fast) {
+        /*
+         * Trade timing accuracy for speed: flash program/erase and I2C
+         * sensor transfers finish almost immediately, so firmware spends
+         * far less virtual time polling them. Bus protocols are still
+         * checked exactly. The radio SPI keeps real timing, since the
+         * master depends on it.
+         */
+        flash.setFastTiming(fast);
+        i2c.setFastTiming(fast);
+    }
+
     void lcdPulseTE() {
         if (time != NULL)
             lcd.pulseTE(hwDeadline);
     }
 
+    /*
+     * Sensor inputs. These are set by the frontend, on its own thread,
+     * and only published to a lock-free mailbox. The cube thread applies
+     * them to the simulated hardware in pollSensors().
+     */
+
     void setAcceleration(float xG, float yG, float zG);
     void setTouch(bool touching);
+    void pollSensors();
+
+    /*
+     * Scripted sensor inputs. These go through a lock-free queue, and the
+     * cube thread applies each one on exactly the tick given, or as soon
+     * as it can if that tick has already gone by. There's no simulated
+     * accelerometer noise, so a script replays the same way every time.
+     *
+     * Only one thread may schedule inputs. Returns false if the queue is
+     * full.
+     */
+
+    bool scheduleAcceleration(uint64_t clock, float xG, float yG, float zG);
+    bool scheduleTouch(uint64_t clock, bool touching);
 
     bool isDebugging();
     void initVCD(VCDWriter &vcd);
@@ -165,6 +235,23 @@ class Hardware {
         return rfcken && !cpu.powerDown;
     }
 
+    /*
+     * Free-running hot-path counters. Each one wraps at 32 bits, and is
+     * only written by the cube's own thread. Other threads may poll them
+     * without locking, and measure rates from the difference between
+     * two snapshots.
+     */
+
+    struct Counters {
+        uint32_t ticks;
+        uint32_t sbtBlocks;
+        uint32_t irqDispatches;
+        uint32_t flashCycles;
+        uint32_t lcdPixels;
+    };
+
+    void getCounters(Counters &c) const;
+
     uint32_t getExceptionCount();
     void incExceptionCount();
     void logWatchdogReset();
@@ -202,10 +289,30 @@ class Hardware {
             CPU::wake_from_sleep(&cpu, 0x80);
     }
 
-    int16_t scaleAccelAxis(float g);
+    struct Sensors {
+        int16_t accel[3];
+        bool touch;
+    };
+
+    struct SensorEvent {
+        uint64_t clock;
+        int16_t accel[3];
+        bool isTouch;
+        bool touch;
+    };
+
+    static const unsigned SENSOR_QUEUE_SIZE = 64;
+
+    int16_t scaleAccelAxis(float g, bool noise = true);
+    void applyTouch(bool touching);
+    void applySensorEvents();
     void hwDeadlineWork();
     TickDeadline hwDeadline;
 
+    TripleBuffer<Sensors> sensorMailbox;
+    Sensors sensorInputs;       // Frontend thread only
+    SPSCQueue<SensorEvent, SENSOR_QUEUE_SIZE> sensorQueue;
+
     uint8_t lat1;
     uint8_t lat2;
     uint8_t bus;
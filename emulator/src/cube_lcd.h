@@ -44,6 +44,9 @@ class LCD {
     static const unsigned FB_MASK = FB_SIZE - 1;
     static const unsigned FB_ROW_SHIFT = 7;
 
+    // One bit per row, in dirty_rows[]
+    static const unsigned DIRTY_WORDS = HEIGHT / 32;
+
     struct Pins {
         /* Configured for an 8-bit parallel bus, in 80-system mode */
         
@@ -63,6 +66,7 @@ class LCD {
         uint32_t i;
         for (i = 0; i < FB_SIZE; i++)
             fb_mem[i] = 31337 * (1+i);
+        memset(dirty_rows, 0xFF, sizeof dirty_rows);
 
         current_cmd = 0;
         cmd_bytecount = 0;
@@ -123,11 +127,27 @@ class LCD {
         return frame_count;
     }
     
-    uint32_t getPixelCount() {
+    uint32_t getPixelCount() const {
         // Number of pixels written
         return pixel_count;
     }
 
+    bool collectDirtyRows(uint32_t rows[DIRTY_WORDS]) {
+        /*
+         * Fetch and clear the set of rows written since the last call.
+         * Returns true if any row is dirty.
+         *
+         * This runs on the GUI thread, while writePixel() sets bits
+         * without any locking. The atomic swap means we can only see
+         * extra dirty rows, never miss one.
+         */
+
+        uint32_t any = 0;
+        for (unsigned i = 0; i < DIRTY_WORDS; i++)
+            any |= rows[i] = __sync_fetch_and_and(&dirty_rows[i], 0);
+        return any != 0;
+    }
+
     bool isVisible() {  
         return mode_awake && mode_display_on;
     }
@@ -142,15 +162,22 @@ class LCD {
     ALWAYS_INLINE void tick(TickDeadline &deadline, CPU::em8051 *cpu) {
         /*
          * We have a separate entry point for ticking the TE timer,
-         * since it really does need to happen every tick rather than
-         * just when there's a graphics pin state change.
+         * since it needs to end on time rather than waiting for a
+         * graphics pin state change. Between pulses there's nothing
+         * to do. pulseTE() runs on another thread, so rather than
+         * clearing te_timestamp we remember which pulse we've ended.
          */
-    
-        if (deadline.hasPassed(te_timestamp)) {
+
+        uint64_t ts = te_timestamp;
+        if (LIKELY(ts == te_ended))
+            return;
+
+        if (deadline.hasPassed(ts)) {
             cpu->mSFR[CTRL_PORT] &= ~CTRL_LCD_TE;
+            te_ended = ts;
         } else {
             cpu->mSFR[CTRL_PORT] |= CTRL_LCD_TE;
-            deadline.set(te_timestamp);
+            deadline.set(ts);
         }
     }
 
@@ -187,8 +214,10 @@ class LCD {
         if (model.order == model.SWAP_BEFORE_MIRROR)
             applyMirroring(m, vRow, vCol);
 
-        unsigned addr = vCol + (vRow << FB_ROW_SHIFT);
-        fb_mem[addr & FB_MASK] = pixel;
+        unsigned addr = (vCol + (vRow << FB_ROW_SHIFT)) & FB_MASK;
+        unsigned fbRow = addr >> FB_ROW_SHIFT;
+        fb_mem[addr] = pixel;
+        dirty_rows[fbRow >> 5] |= 1 << (fbRow & 31);
 
         if (++col > xe) {
             col = xs;
@@ -419,7 +448,9 @@ class LCD {
 
     uint32_t frame_count;
     uint32_t pixel_count;
+    uint32_t dirty_rows[DIRTY_WORDS];
     uint64_t te_timestamp;
+    uint64_t te_ended;          // te_timestamp of the last pulse we ended
 
     /* Hardware interface */
     uint8_t prev_wrx;
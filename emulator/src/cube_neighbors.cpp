@@ -34,8 +34,14 @@ void Neighbors::attachCubes(Cube::Hardware *cubes)
 {
     /*
      * The system is giving us a pointer to the other cubes, so
-     * that we can scan their neighbor state on demand.
-     */ 
+     * that we can deliver pulses to them.
+     *
+     * We never scan all of these cubes. Finding which sensors are in
+     * range is the frontend's job: each side has a Box2D sensor fixture,
+     * and Box2D's broadphase (a dynamic AABB tree) reports only the
+     * overlapping pairs. Those arrive here via setContact() and
+     * clearContact(), so a transmit only visits the cubes in mySides[].
+     */
     otherCubes = cubes;
 }
 
@@ -120,6 +126,18 @@ void Neighbors::transmitPulse(CPU::em8051 &cpu, unsigned otherCube, uint8_t othe
 {
     Hardware &dest = otherCubes[otherCube];
 
+    /*
+     * Cubes running on a different clock belong to a different group of
+     * the parallel tick loop. The groups are rebuilt from our contact
+     * matrix on every epoch, so this can only happen immediately after
+     * a new contact is made. Drop the pulse rather than race with the
+     * other cube's thread.
+     */
+    if (dest.cpu.vtime != cpu.vtime) {
+        Tracer::log(&cpu, "NEIGHBOR: Pulse to %d.%d deferred, not yet in our group", otherCube, otherSide);
+        return;
+    }
+
     if (dest.neighbors.isSideReceiving(otherSide)) {
         Tracer::log(&cpu, "NEIGHBOR: Sending pulse to %d.%d", otherCube, otherSide);
         receivedPulse(dest.cpu);
@@ -78,6 +78,10 @@ class Neighbors {
     
     void attachCubes(Hardware *cubes);
 
+    Hardware *getPeers() const {
+        return otherCubes;
+    }
+
     void setContact(unsigned mySide, unsigned otherSide, unsigned otherCube) {
         /* Mark two neighbor sensors as in-range. ONLY called by the UI thread. */
         mySides[mySide].otherSides[otherSide] |= 1 << otherCube;
@@ -103,6 +107,15 @@ class Neighbors {
         cpu.needTimerEdgeCheck = true;
     }
 
+    uint32_t contactMask() const {
+        /* Bitmap of all cubes we're touching, on any side. */
+        uint32_t mask = 0;
+        for (unsigned mySide = 0; mySide < NUM_SIDES; mySide++)
+            for (unsigned otherSide = 0; otherSide < NUM_SIDES; otherSide++)
+                mask |= mySides[mySide].otherSides[otherSide];
+        return mask;
+    }
+
     bool isSideReceiving(unsigned side) {
         return 1 & (inputMask >> side);
     }
@@ -50,6 +50,11 @@ class Radio {
         uint8_t payload[PAYLOAD_MAX];
     };
 
+    void attachCPU(CPU::em8051 *_cpu) {
+        // Re-bind to a CPU without resetting any state
+        cpu = _cpu;
+    }
+
     void init(CPU::em8051 *_cpu) {
         memset(debug, 0, DEBUG_REG_SIZE);
         cpu = _cpu;
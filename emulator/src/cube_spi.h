@@ -81,6 +81,12 @@ class SPIBus {
     // Peripheral devices
     Radio radio;
 
+    void attachCPU(CPU::em8051 *_cpu) {
+        // Re-bind to a CPU without resetting any state
+        cpu = _cpu;
+        radio.attachCPU(_cpu);
+    }
+
     void init(CPU::em8051 *_cpu) {
         cpu = _cpu;
         tx_count = 0;
@@ -27,6 +27,7 @@
 #ifndef _DEADLINE_SYNCHRONIZER_H
 #define _DEADLINE_SYNCHRONIZER_H
 
+#include <algorithm>
 #include "tinythread.h"
 #include "macros.h"
 #include "vtime.h"
@@ -48,6 +49,7 @@ public:
     void init(const VirtualTime *vtime, bool *tickRunFlag)
     {
         mThreadWaiting = false;
+        mExternalWaiting = false;
         mInEvent = false;
         mTickRunFlag = tickRunFlag;
 
@@ -97,9 +99,11 @@ public:
         mInEvent = true;
 
         while (!mThreadWaiting && runFlag) {
+            mExternalWaiting = true;
             wake();
             mCond.wait(mMutex);
         }
+        mExternalWaiting = false;
 
         DEBUG_LOG(("SYNC: -beginEvent(%"PRIu64") run=%d\n", deadline, runFlag));
     }
@@ -153,6 +157,52 @@ public:
         DEBUG_LOG(("SYNC: -endEvent(%"PRIu64")\n", nextDeadline));
     }
 
+    /**
+     * Move the deadline later without starting an event. For use by the
+     * external thread when it knows it won't need to touch the
+     * simulation at the current deadline. Never waits for the simulation
+     * thread; if it was already halted at the old deadline, it resumes.
+     */
+    void extendDeadline(uint64_t nextDeadline)
+    {
+        DEBUG_LOG(("SYNC: extendDeadline(%"PRIu64")\n", nextDeadline));
+
+        tthread::lock_guard<tthread::mutex> guard(mMutex);
+        ASSERT(!mInEvent);
+        ASSERT(nextDeadline >= mDeadline.clock());
+        mDeadline.resetTo(nextDeadline);
+
+        if (mThreadWaiting) {
+            mThreadWaiting = false;
+            mCond.notify_all();
+        }
+    }
+
+    /**
+     * Bring the whole simulation to a standstill. Only valid while the
+     * simulation thread is stopped: waits for the external thread to
+     * block in beginEvent(), where it stays until the simulation thread
+     * starts ticking again.
+     */
+    void waitForExternalHalt()
+    {
+        tthread::lock_guard<tthread::mutex> guard(mMutex);
+        while (!mExternalWaiting)
+            mCond.wait(mMutex);
+    }
+
+    /**
+     * Forget the current deadline, as if we were just init()'ed.
+     * The simulation thread must be stopped, and the external
+     * thread must not be in an event.
+     */
+    void reset()
+    {
+        ASSERT(!mInEvent);
+        mThreadWaiting = false;
+        mDeadline.resetTo(0);
+    }
+
     /**
      * Tick handler for the simulation thread
      */
@@ -169,6 +219,34 @@ public:
     {
         return mDeadline.remaining();
     }
+
+    /**
+     * Epoch API, a batched alternative to calling tick() after every step.
+     *
+     * The external thread publishes "run until tick T" via endEvent().
+     * The simulation thread calls beginEpoch() once, runs free for exactly
+     * the returned number of ticks without touching the synchronizer at
+     * all, then calls endEpoch() to rally if T has arrived.
+     *
+     * This is safe because the deadline can only move later while the
+     * simulation thread is running: beginEvent() is never called with an
+     * earlier deadline than the last endEvent(). An epoch computed from a
+     * stale deadline just ends early.
+     */
+    ALWAYS_INLINE unsigned beginEpoch(unsigned limit)
+    {
+        return (unsigned) std::min<uint64_t>(limit, mDeadline.remaining());
+    }
+
+    /**
+     * End of an epoch started with beginEpoch(). Identical to tick(),
+     * but only needs to be called once per epoch.
+     */
+    ALWAYS_INLINE void endEpoch()
+    {
+        if (mDeadline.hasPassed())
+            deadlineWork();
+    }
     
 private:
     NEVER_INLINE void deadlineWork()
@@ -194,6 +272,9 @@ private:
 
     // Set to 'true' by tick thread, 'false' by external thread
     bool mThreadWaiting;
+
+    // External thread is blocked in beginEvent()
+    bool mExternalWaiting;
     
     // Between begin and end? For ASSERTs only.
     bool mInEvent;
@@ -38,6 +38,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <vector>
 #include "macros.h"
 #include "flash_device.h"
 #include "flash_storage.h"
@@ -50,6 +53,18 @@
 // Compiled launcher ELF binary, installed in new volumes.
 extern const uint8_t launcher[];
 
+static bool isSparseFile(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    uint64_t magic = 0;
+    if (f) {
+        if (fread(&magic, sizeof magic, 1, f) != 1)
+            magic = 0;
+        fclose(f);
+    }
+    return magic == FlashStorage::SparseHeader::MAGIC;
+}
+
 
 FlashStorage::FlashStorage()
     : data(NULL), isInitialized(false) {}
@@ -63,12 +78,30 @@ FlashStorage::~FlashStorage()
     }
 }
 
-bool FlashStorage::init(const char *filename)
+bool FlashStorage::init(const char *filename, bool copyOnWrite,
+    const char *deltaFilename, Format format)
 {
     ASSERT(isInitialized == false);
     isFileBacked = filename != NULL;
+    isCopyOnWrite = isFileBacked && copyOnWrite;
+    isSparse = isFileBacked && (format != F_PLAIN || isSparseFile(filename));
+    compressSparse = format == F_SPARSE_COMPRESSED;
+    this->deltaFilename = (isCopyOnWrite && deltaFilename) ? deltaFilename : "";
+
+    if (isSparse && isCopyOnWrite) {
+        LOG(("FLASH: Copy-on-write is not supported for sparse files\n"));
+        return false;
+    }
 
-    if (isFileBacked) {
+    if (isSparse) {
+        // RAM-backed, loaded from and saved to a sparse file
+        if (!loadSparse(filename))
+            return false;
+        if (!checkData()) {
+            free(data);
+            return false;
+        }
+    } else if (isFileBacked) {
         // Disk-backed flash memory
         if (!mapFile(filename))
             return false;
@@ -90,10 +123,14 @@ void FlashStorage::exit()
 {
     ASSERT(isInitialized == true);
 
-    if (isFileBacked)
+    if (isSparse) {
+        saveSparse();
+        free(data);
+    } else if (isFileBacked) {
         unmapFile();
-    else
+    } else {
         delete data;
+    }
 
     data = NULL;
     isInitialized = false;
@@ -238,10 +275,19 @@ bool FlashStorage::checkData()
 
 bool FlashStorage::mapFile(const char *filename)
 {
+    /*
+     * In copy-on-write mode, the base image is never modified. It must
+     * already exist, since we have no way to initialize it.
+     */
+
+    baseFilename = filename;
+
 #ifdef _WIN32
 
-    HANDLE fh = CreateFile(filename, GENERIC_READ | GENERIC_WRITE,
-        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+    HANDLE fh = CreateFile(filename,
+        isCopyOnWrite ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE),
+        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        isCopyOnWrite ? OPEN_EXISTING : OPEN_ALWAYS,
         FILE_ATTRIBUTE_NORMAL, NULL);
     if (fh == INVALID_HANDLE_VALUE) {
         LOG(("FLASH: Can't open backing file '%s' (%08x)\n",
@@ -252,7 +298,14 @@ bool FlashStorage::mapFile(const char *filename)
     fileHandle = (uintptr_t) fh;
     bool newFile = GetFileSize(fh, NULL) == (DWORD)0;
 
-    HANDLE mh = CreateFileMapping(fh, NULL, PAGE_READWRITE, 0, sizeof *data, NULL);
+    if (isCopyOnWrite && GetFileSize(fh, NULL) < (DWORD)sizeof *data) {
+        CloseHandle(fh);
+        LOG(("FLASH: Copy-on-write backing file '%s' is not a complete image\n", filename));
+        return false;
+    }
+
+    HANDLE mh = CreateFileMapping(fh, NULL, isCopyOnWrite ? PAGE_WRITECOPY : PAGE_READWRITE,
+        0, sizeof *data, NULL);
     if (mh == NULL) {
         CloseHandle(fh);
         LOG(("FLASH: Can't create mapping for file '%s' (%08x)\n",
@@ -261,7 +314,8 @@ bool FlashStorage::mapFile(const char *filename)
     }
     mappingHandle = (uintptr_t) mh;
 
-    LPVOID mapping = MapViewOfFile(mh, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof *data);
+    LPVOID mapping = MapViewOfFile(mh, isCopyOnWrite ? FILE_MAP_COPY : (FILE_MAP_READ | FILE_MAP_WRITE),
+        0, 0, sizeof *data);
     if (mapping == NULL) {
         CloseHandle(mh);
         CloseHandle(fh);
@@ -272,7 +326,7 @@ bool FlashStorage::mapFile(const char *filename)
 
 #else
 
-    int fh = open(filename, O_RDWR | O_CREAT, 0777);
+    int fh = isCopyOnWrite ? open(filename, O_RDONLY) : open(filename, O_RDWR | O_CREAT, 0777);
     struct stat st;
 
     if (fh < 0 || fstat(fh, &st)) {
@@ -285,6 +339,13 @@ bool FlashStorage::mapFile(const char *filename)
     fileHandle = fh;
 
     bool newFile = (unsigned)st.st_size == (unsigned)0;
+
+    if (isCopyOnWrite && (unsigned)st.st_size < (unsigned)sizeof *data) {
+        close(fileHandle);
+        LOG(("FLASH: Copy-on-write backing file '%s' is not a complete image\n", filename));
+        return false;
+    }
+
     if ((unsigned)st.st_size < (unsigned)sizeof *data && ftruncate(fileHandle, sizeof *data)) {
         close(fileHandle);
         LOG(("FLASH: Can't resize backing file '%s' (%s)\n",
@@ -292,7 +353,8 @@ bool FlashStorage::mapFile(const char *filename)
         return false;
     }
 
-    void *mapping = mmap(NULL, sizeof *data, PROT_READ | PROT_WRITE, MAP_SHARED, fileHandle, 0);
+    void *mapping = mmap(NULL, sizeof *data, PROT_READ | PROT_WRITE,
+        isCopyOnWrite ? MAP_PRIVATE : MAP_SHARED, fileHandle, 0);
     if (mapping == MAP_FAILED) {
         close(fileHandle);
         LOG(("FLASH: Can't memory-map backing file '%s' (%s)\n",
@@ -311,18 +373,246 @@ bool FlashStorage::mapFile(const char *filename)
 
 void FlashStorage::unmapFile()
 {
+    if (!deltaFilename.empty())
+        writeDelta();
+
 #ifdef _WIN32
 
-    FlushViewOfFile(data, sizeof *data);
+    if (!isCopyOnWrite)
+        FlushViewOfFile(data, sizeof *data);
     UnmapViewOfFile(data);
     CloseHandle((HANDLE) mappingHandle);
     CloseHandle((HANDLE) fileHandle);
 
 #else
 
-    fsync(fileHandle);
+    if (!isCopyOnWrite)
+        fsync(fileHandle);
     munmap(data, sizeof *data);
     close(fileHandle);
 
 #endif
 }
+
+void FlashStorage::writeDelta()
+{
+    /*
+     * Save the pages that differ from our copy-on-write base image.
+     * We can't portably ask the OS which pages we've privately copied,
+     * so just compare against the base file. This only reads the file,
+     * which is most likely still in the page cache.
+     */
+
+    const unsigned pageSize = DeltaHeader::PAGE_SIZE;
+    const unsigned numPages = (sizeof *data + pageSize - 1) / pageSize;
+    const uint8_t *mapped = reinterpret_cast<const uint8_t*>(data);
+
+    FILE *base = fopen(baseFilename.c_str(), "rb");
+    FILE *delta = fopen(deltaFilename.c_str(), "wb");
+    if (!base || !delta) {
+        LOG(("FLASH: Can't write delta file '%s'\n", deltaFilename.c_str()));
+        if (base) fclose(base);
+        if (delta) fclose(delta);
+        return;
+    }
+
+    DeltaHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = DeltaHeader::MAGIC;
+    hdr.version = DeltaHeader::CURRENT_VERSION;
+    hdr.pageSize = pageSize;
+    hdr.uniqueID = data->header.uniqueID;
+    fwrite(&hdr, sizeof hdr, 1, delta);
+
+    uint8_t buffer[pageSize];
+    bool success = true;
+
+    for (uint32_t index = 0; success && index < numPages; ++index) {
+        unsigned offset = index * pageSize;
+        unsigned len = std::min<unsigned>(pageSize, sizeof *data - offset);
+
+        if (fread(buffer, len, 1, base) != 1) {
+            success = false;
+            break;
+        }
+        if (!memcmp(buffer, mapped + offset, len))
+            continue;
+
+        memset(buffer, 0xFF, sizeof buffer);
+        memcpy(buffer, mapped + offset, len);
+        success = fwrite(&index, sizeof index, 1, delta) == 1
+            && fwrite(buffer, pageSize, 1, delta) == 1;
+        hdr.numPages++;
+    }
+
+    success = success && !fseek(delta, 0, SEEK_SET)
+        && fwrite(&hdr, sizeof hdr, 1, delta) == 1;
+    success = !fclose(delta) && success;
+    fclose(base);
+
+    if (success)
+        LOG(("FLASH: Saved %d modified pages to '%s'\n", hdr.numPages, deltaFilename.c_str()));
+    else
+        LOG(("FLASH: Error writing delta file '%s'\n", deltaFilename.c_str()));
+}
+
+bool FlashStorage::loadSparse(const char *filename)
+{
+    /*
+     * Allocate zeroed memory without touching it, so that runs of zero
+     * bytes (which includes most erase counts) never need physical pages.
+     * A missing or empty file is a new image. We can also import a plain
+     * image file, converting it to the sparse format on exit.
+     */
+
+    baseFilename = filename;
+    data = (FileRecord*) calloc(1, sizeof *data);
+    if (!data) {
+        LOG(("FLASH: Out of memory\n"));
+        return false;
+    }
+
+    FILE *f = fopen(filename, "rb");
+    uint64_t magic;
+
+    if (!f || fread(&magic, sizeof magic, 1, f) != 1) {
+        if (f)
+            fclose(f);
+        initData();
+        return true;
+    }
+
+    rewind(f);
+    bool success = magic == SparseHeader::MAGIC ? readSparse(f)
+        : fread(data, sizeof *data, 1, f) == 1;
+    fclose(f);
+
+    if (!success) {
+        LOG(("FLASH: Can't read storage file '%s'\n", filename));
+        free(data);
+    }
+    return success;
+}
+
+bool FlashStorage::readSparse(FILE *f)
+{
+    SparseHeader hdr;
+    if (fread(&hdr, sizeof hdr, 1, f) != 1
+        || hdr.version != SparseHeader::CURRENT_VERSION
+        || hdr.imageSize > sizeof *data
+        || hdr.imageSize < sizeof data->header
+        || hdr.chunkSize == 0
+        || hdr.numChunks != (hdr.imageSize + hdr.chunkSize - 1) / hdr.chunkSize)
+        return false;
+
+    std::vector<SparseIndexEntry> index(hdr.numChunks);
+    if (fread(&index[0], sizeof index[0], index.size(), f) != index.size())
+        return false;
+
+    uint8_t *image = reinterpret_cast<uint8_t*>(data);
+    std::vector<uint8_t> stored;
+
+    for (unsigned i = 0; i < hdr.numChunks; ++i) {
+        const SparseIndexEntry &entry = index[i];
+        unsigned offset = i * hdr.chunkSize;
+        unsigned len = std::min<unsigned>(hdr.chunkSize, hdr.imageSize - offset);
+
+        if (entry.type == SparseIndexEntry::CHUNK_FILL) {
+            if (entry.fill)
+                memset(image + offset, entry.fill, len);
+            continue;
+        }
+
+        stored.resize(entry.length);
+        if (!entry.length || fseek(f, entry.offset, SEEK_SET)
+            || fread(&stored[0], entry.length, 1, f) != 1)
+            return false;
+
+        if (entry.type == SparseIndexEntry::CHUNK_RAW) {
+            if (entry.length != len)
+                return false;
+            memcpy(image + offset, &stored[0], len);
+
+        } else if (entry.type == SparseIndexEntry::CHUNK_ZLIB) {
+            unsigned char *out = NULL;
+            size_t outSize = 0;
+            unsigned error = LodePNG_zlib_decompress(&out, &outSize, &stored[0],
+                entry.length, &LodePNG_defaultDecompressSettings);
+            bool ok = !error && outSize == len;
+            if (ok)
+                memcpy(image + offset, out, len);
+            free(out);
+            if (!ok)
+                return false;
+
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FlashStorage::saveSparse()
+{
+    const unsigned chunkSize = SparseHeader::CHUNK_SIZE;
+    const uint8_t *image = reinterpret_cast<const uint8_t*>(data);
+
+    SparseHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = SparseHeader::MAGIC;
+    hdr.version = SparseHeader::CURRENT_VERSION;
+    hdr.chunkSize = chunkSize;
+    hdr.imageSize = sizeof *data;
+    hdr.numChunks = (hdr.imageSize + chunkSize - 1) / chunkSize;
+
+    FILE *f = fopen(baseFilename.c_str(), "wb");
+    if (!f) {
+        LOG(("FLASH: Can't write storage file '%s' (%s)\n",
+            baseFilename.c_str(), strerror(errno)));
+        return;
+    }
+
+    std::vector<SparseIndexEntry> index(hdr.numChunks);
+    memset(&index[0], 0, index.size() * sizeof index[0]);
+
+    uint32_t fileOffset = sizeof hdr + index.size() * sizeof index[0];
+    bool success = !fseek(f, fileOffset, SEEK_SET);
+
+    for (unsigned i = 0; success && i < hdr.numChunks; ++i) {
+        SparseIndexEntry &entry = index[i];
+        const uint8_t *chunk = image + i * chunkSize;
+        unsigned len = std::min<unsigned>(chunkSize, hdr.imageSize - i * chunkSize);
+
+        if (!memcmp(chunk, chunk + 1, len - 1)) {
+            entry.type = SparseIndexEntry::CHUNK_FILL;
+            entry.fill = chunk[0];
+            continue;
+        }
+
+        unsigned char *compressed = NULL;
+        size_t compressedSize = 0;
+        if (compressSparse && !LodePNG_zlib_compress(&compressed, &compressedSize,
+                chunk, len, &LodePNG_defaultCompressSettings) && compressedSize < len) {
+            entry.type = SparseIndexEntry::CHUNK_ZLIB;
+            entry.length = compressedSize;
+            success = fwrite(compressed, compressedSize, 1, f) == 1;
+        } else {
+            entry.type = SparseIndexEntry::CHUNK_RAW;
+            entry.length = len;
+            success = fwrite(chunk, len, 1, f) == 1;
+        }
+        free(compressed);
+
+        entry.offset = fileOffset;
+        fileOffset += entry.length;
+    }
+
+    success = success && !fseek(f, 0, SEEK_SET)
+        && fwrite(&hdr, sizeof hdr, 1, f) == 1
+        && fwrite(&index[0], sizeof index[0], index.size(), f) == index.size();
+    success = !fclose(f) && success;
+
+    if (!success)
+        LOG(("FLASH: Error writing storage file '%s'\n", baseFilename.c_str()));
+}
@@ -29,6 +29,15 @@
  *
  * All of this storage is defined in a fixed-layout structure, which
  * can be backed either by anonymous RAM or by a mapped file.
+ *
+ * A file can also be mapped copy-on-write, so that many emulator
+ * instances can share one golden image. Our changes are private, but
+ * they can optionally be saved to a delta file on exit.
+ *
+ * Finally, files may use a sparse format, in which chunks that are
+ * entirely one byte value (usually erased or zeroed memory) take no
+ * space, and other chunks may be zlib-compressed. Sparse files are
+ * loaded into RAM and written back on exit.
  */
 
 #ifndef _FLASH_STORAGE_H
@@ -36,6 +45,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
 #include <sifteo/abi.h>
 #include "cube_flash_model.h"
 #include "flash_device.h"
@@ -88,23 +98,90 @@ class FlashStorage {
         CubeRecord     cubes[_SYS_NUM_CUBE_SLOTS];
     };
 
+    /*
+     * Delta files are this header, followed by 'numPages' records, each
+     * a 32-bit page index and PAGE_SIZE bytes of data. Pages are relative
+     * to the start of the FileRecord.
+     */
+    struct DeltaHeader {
+        uint64_t    magic;
+        uint32_t    version;
+        uint32_t    pageSize;
+        uint32_t    uniqueID;       // Copied from the base image's header
+        uint32_t    numPages;
+
+        static const uint64_t MAGIC             = 0x544c447974666953LLU;
+        static const uint32_t CURRENT_VERSION   = 1;
+        static const uint32_t PAGE_SIZE         = 4096;
+    };
+
+    /*
+     * Sparse files are this header, followed by an index of 'numChunks'
+     * SparseIndexEntry records, followed by chunk data at arbitrary offsets.
+     * Chunks cover the FileRecord in order, and the last one may be short.
+     * The image itself may be short too: 'swiss backup' stops after the
+     * master flash, and leaves cube data to be reinitialized.
+     */
+    struct SparseHeader {
+        uint64_t    magic;
+        uint32_t    version;
+        uint32_t    chunkSize;
+        uint32_t    numChunks;
+        uint32_t    imageSize;      // Up to sizeof(FileRecord), the rest is zeroed
+
+        static const uint64_t MAGIC             = 0x5250537974666953LLU;
+        static const uint32_t CURRENT_VERSION   = 1;
+        static const uint32_t CHUNK_SIZE        = FlashDevice::ERASE_BLOCK_SIZE;
+    };
+
+    struct SparseIndexEntry {
+        uint32_t    offset;         // File offset of the chunk's data, if any
+        uint32_t    length;         // Stored length of that data
+        uint8_t     type;
+        uint8_t     fill;           // For CHUNK_FILL, the repeated byte
+        uint16_t    reserved;
+
+        enum Type {
+            CHUNK_FILL = 0,
+            CHUNK_RAW,
+            CHUNK_ZLIB,
+        };
+    };
+
+    enum Format {
+        F_PLAIN = 0,                // Must be first, used by default
+        F_SPARSE,
+        F_SPARSE_COMPRESSED,
+    };
+
     FileRecord *data;
 
     FlashStorage();
     ~FlashStorage();
 
-    bool init(const char *filename=NULL);
+    bool init(const char *filename=NULL, bool copyOnWrite=false,
+        const char *deltaFilename=NULL, Format format=F_PLAIN);
     bool installLauncher(const char *filename=NULL);
     void exit();
 
  private:
     bool isInitialized;
     bool isFileBacked;
+    bool isCopyOnWrite;
+    bool isSparse;
+    bool compressSparse;
     uintptr_t fileHandle;
     uintptr_t mappingHandle;
+    std::string baseFilename;
+    std::string deltaFilename;
 
     bool mapFile(const char *filename);
     void unmapFile();
+    void writeDelta();
+
+    bool loadSparse(const char *filename);
+    bool readSparse(FILE *f);
+    void saveSparse();
 
     void initData();
     bool checkData();
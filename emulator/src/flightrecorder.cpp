@@ -0,0 +1,49 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "flightrecorder.h"
+
+
+void FlightRecorder::dump(FILE *f) const
+{
+    uint64_t first = count > CAPACITY ? count - CAPACITY : 0;
+
+    for (uint64_t i = first; i != count; ++i) {
+        const Entry &e = ring[i & (CAPACITY - 1)];
+
+        fprintf(f, "[%02d t=%"PRIu64"] ", e.cube, e.clock);
+
+        if (e.numArgs < 0)
+            fputs(e.text, f);
+        else if (e.numArgs == 0)
+            fputs(e.fmt, f);
+        else
+            fprintf(f, e.fmt, e.args[0], e.args[1], e.args[2], e.args[3],
+                e.args[4], e.args[5], e.args[6], e.args[7]);
+
+        fputc('\n', f);
+    }
+}
@@ -0,0 +1,76 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Flight recorder for trace logging. Instead of writing trace events to
+ * disk as they happen, we keep the most recent events in a fixed-size ring.
+ * Formatting is deferred where possible, so recording an event is just a
+ * few stores. The ring is only written out when something interesting
+ * happens (see Tracer::trigger).
+ */
+
+#ifndef _FLIGHTRECORDER_H
+#define _FLIGHTRECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "macros.h"
+
+
+class FlightRecorder {
+public:
+    static const unsigned CAPACITY = 1 << 16;   // Must be a power of two
+    static const unsigned MAX_ARGS = 8;
+    static const unsigned TEXT_SIZE = 88;
+
+    struct Entry {
+        uint64_t clock;
+        const char *fmt;    // Static format string, if numArgs >= 0
+        uint8_t cube;
+        int8_t numArgs;     // -1 means 'text' was formatted at record time
+        union {
+            int args[MAX_ARGS];
+            char text[TEXT_SIZE];
+        };
+    };
+
+    FlightRecorder() : count(0) {
+        STATIC_ASSERT((CAPACITY & (CAPACITY - 1)) == 0);
+    }
+
+    ALWAYS_INLINE Entry &append() {
+        return ring[count++ & (CAPACITY - 1)];
+    }
+
+    /// Write all retained entries as text, oldest first
+    void dump(FILE *f) const;
+
+private:
+    uint64_t count;
+    Entry ring[CAPACITY];
+};
+
+#endif
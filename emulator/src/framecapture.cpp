@@ -0,0 +1,280 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "framecapture.h"
+#include "cube_hardware.h"
+#include "tinythread.h"
+#include "lodepng.h"
+#include "color.h"
+
+namespace {
+
+    static const unsigned NUM_SLOTS = 32;
+
+    struct Slot {
+        enum Type {
+            T_PNG,
+            T_STREAM,
+        } type;
+
+        FrameCapture::FrameHeader header;
+        std::string filename;
+        uint16_t pixels[Cube::LCD::FB_SIZE];
+    };
+
+    /*
+     * Ring state. Slots in [tail, head) are waiting for the writer thread.
+     * The writer owns the slot at 'tail' while 'busy' is set.
+     */
+
+    std::vector<Slot> slots;
+    unsigned head, tail;
+    bool busy;
+    bool running;
+    FILE *stream;
+
+    tthread::thread *thread;
+    tthread::mutex lock;
+    tthread::condition_variable cond;
+
+    void writePNG(const Slot &slot)
+    {
+        std::vector<uint8_t> pixels;
+        pixels.reserve(Cube::LCD::FB_SIZE * 4);
+
+        for (unsigned i = 0; i < Cube::LCD::FB_SIZE; i++) {
+            RGB565 color = slot.pixels[i];
+            pixels.push_back(color.red());
+            pixels.push_back(color.green());
+            pixels.push_back(color.blue());
+            pixels.push_back(0xFF);
+        }
+
+        LodePNG::Encoder encoder;
+        std::vector<uint8_t> pngData;
+        encoder.encode(pngData, pixels, Cube::LCD::WIDTH, Cube::LCD::HEIGHT);
+        LodePNG::saveFile(pngData, slot.filename);
+    }
+
+    void writeStream(const Slot &slot)
+    {
+        if (stream) {
+            fwrite(&slot.header, sizeof slot.header, 1, stream);
+            fwrite(slot.pixels, sizeof slot.pixels, 1, stream);
+        }
+    }
+
+    void threadFn(void *)
+    {
+        tthread::lock_guard<tthread::mutex> guard(lock);
+
+        while (running || head != tail) {
+            if (head == tail) {
+                cond.wait(lock);
+                continue;
+            }
+
+            // Nobody else touches this slot until we advance 'tail'
+            Slot &slot = slots[tail % NUM_SLOTS];
+            busy = true;
+            lock.unlock();
+
+            if (slot.type == Slot::T_PNG)
+                writePNG(slot);
+            else
+                writeStream(slot);
+
+            lock.lock();
+            busy = false;
+            tail++;
+            cond.notify_all();
+        }
+    }
+
+    Slot &beginSlot(Slot::Type type)
+    {
+        /*
+         * Claim the next free slot, starting the writer thread if needed.
+         * If the writer has fallen a whole ring behind, we wait for it.
+         * Must be called with the lock held.
+         */
+
+        if (!thread) {
+            slots.resize(NUM_SLOTS);
+            head = tail = 0;
+            busy = false;
+            running = true;
+            thread = new tthread::thread(threadFn, NULL);
+        }
+
+        while (head - tail >= NUM_SLOTS)
+            cond.wait(lock);
+
+        Slot &slot = slots[head % NUM_SLOTS];
+        slot.type = type;
+        return slot;
+    }
+
+    void endSlot()
+    {
+        head++;
+        cond.notify_all();
+    }
+}
+
+
+void FrameCapture::savePNG(const uint16_t *fb, const char *filename)
+{
+    tthread::lock_guard<tthread::mutex> guard(lock);
+
+    Slot &slot = beginSlot(Slot::T_PNG);
+    slot.filename = filename;
+    memcpy(slot.pixels, fb, sizeof slot.pixels);
+    endSlot();
+}
+
+bool FrameCapture::openStream(const char *filename)
+{
+    closeStream();
+
+    FILE *f = fopen(filename, "wb");
+    if (!f)
+        return false;
+
+    StreamHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = StreamHeader::MAGIC;
+    hdr.version = StreamHeader::CURRENT_VERSION;
+    hdr.width = Cube::LCD::WIDTH;
+    hdr.height = Cube::LCD::HEIGHT;
+    fwrite(&hdr, sizeof hdr, 1, f);
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    stream = f;
+    return true;
+}
+
+void FrameCapture::closeStream()
+{
+    flush();
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    if (stream) {
+        fclose(stream);
+        stream = NULL;
+    }
+}
+
+bool FrameCapture::isStreamOpen()
+{
+    return stream != NULL;
+}
+
+void FrameCapture::streamFrame(const uint16_t *fb, unsigned cube, uint32_t frameCount)
+{
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    if (!stream)
+        return;
+
+    Slot &slot = beginSlot(Slot::T_STREAM);
+    slot.header.cube = cube;
+    slot.header.frameCount = frameCount;
+    slot.header.hash = perceptualHash(fb);
+    memcpy(slot.pixels, fb, sizeof slot.pixels);
+    endSlot();
+}
+
+void FrameCapture::flush()
+{
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    while (head != tail)
+        cond.wait(lock);
+    if (stream)
+        fflush(stream);
+}
+
+void FrameCapture::close()
+{
+    closeStream();
+
+    if (thread) {
+        lock.lock();
+        running = false;
+        cond.notify_all();
+        lock.unlock();
+
+        thread->join();
+        delete thread;
+        thread = NULL;
+    }
+}
+
+uint64_t FrameCapture::perceptualHash(const uint16_t *fb)
+{
+    // Sum of luminance in each 16x16 pixel cell, of an 8x8 grid
+
+    const unsigned GRID = 8;
+    const unsigned CELL = Cube::LCD::WIDTH / GRID;
+    uint32_t cells[GRID * GRID];
+    uint32_t total = 0;
+
+    memset(cells, 0, sizeof cells);
+
+    for (unsigned y = 0; y < Cube::LCD::HEIGHT; y++)
+        for (unsigned x = 0; x < Cube::LCD::WIDTH; x++) {
+            RGB565 color = fb[x + y * Cube::LCD::WIDTH];
+            uint32_t luma = 77 * color.red() + 150 * color.green() + 29 * color.blue();
+            cells[x / CELL + (y / CELL) * GRID] += luma;
+        }
+
+    for (unsigned i = 0; i < GRID * GRID; i++)
+        total += cells[i];
+
+    // Compare each cell against the mean, scaled to avoid a division
+    uint64_t hash = 0;
+    for (unsigned i = 0; i < GRID * GRID; i++)
+        if (uint64_t(cells[i]) * (GRID * GRID) > total)
+            hash |= uint64_t(1) << i;
+
+    return hash;
+}
+
+unsigned FrameCapture::hashDistance(uint64_t a, uint64_t b)
+{
+    uint64_t diff = a ^ b;
+    unsigned count = 0;
+
+    while (diff) {
+        diff &= diff - 1;
+        count++;
+    }
+
+    return count;
+}
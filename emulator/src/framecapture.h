@@ -0,0 +1,96 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Asynchronous LCD frame capture, for scripted visual tests.
+ *
+ * Capturing a frame just copies the raw RGB565 framebuffer into a ring
+ * of slots. A background thread does the slow part: encoding PNG files,
+ * or appending raw frames to a stream that an external tool can consume.
+ * The stream can be a named pipe.
+ *
+ * Stream layout:
+ *
+ *   StreamHeader
+ *   Frames: FrameHeader, then WIDTH * HEIGHT little-endian RGB565 pixels
+ *
+ * We also provide a cheap perceptual hash of a frame, to test for
+ * near-matches without going through PNG at all.
+ */
+
+#ifndef _FRAMECAPTURE_H
+#define _FRAMECAPTURE_H
+
+#include <stdint.h>
+
+
+class FrameCapture {
+public:
+    struct StreamHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint16_t width;
+        uint16_t height;
+
+        static const uint64_t MAGIC = 0x4d52467974666953LLU;   // "SiftyFRM"
+        static const uint32_t CURRENT_VERSION = 1;
+    };
+
+    struct FrameHeader {
+        uint32_t cube;
+        uint32_t frameCount;    // LCD frame count at capture time
+        uint64_t hash;          // perceptualHash() of this frame
+    };
+
+    /// Queue a frame to be written as a PNG file. Returns immediately.
+    static void savePNG(const uint16_t *fb, const char *filename);
+
+    /// Open or close the raw frame stream
+    static bool openStream(const char *filename);
+    static void closeStream();
+
+    static bool isStreamOpen();
+
+    /// Queue a frame for the raw stream, if one is open.
+    static void streamFrame(const uint16_t *fb, unsigned cube, uint32_t frameCount);
+
+    /// Wait until all queued frames have been written
+    static void flush();
+
+    /// Flush, close the stream, and stop the background thread
+    static void close();
+
+    /*
+     * Average hash: the frame is divided into an 8x8 grid, and each bit
+     * says whether that cell is brighter than the frame's mean. Small
+     * changes in color or a few stray pixels leave most bits alone.
+     */
+    static uint64_t perceptualHash(const uint16_t *fb);
+
+    static unsigned hashDistance(uint64_t a, uint64_t b);
+};
+
+#endif
@@ -28,6 +28,7 @@
 #include "ostime.h"
 #include "mc_homebutton.h"
 #include "mc_neighbor.h"
+#include "inputlog.h"
 #include "mc_volume.h"
 #include <time.h>
 #include "batterylevel.h"
@@ -1114,7 +1115,10 @@ void Frontend::ContactListener::updateSensors(b2Contact *contact, bool touching)
      */
     if (fdatA->type == fdatA->T_CUBE_NEIGHBOR && fdatB->type == fdatB->T_MC_NEIGHBOR) {
         unsigned cubeA = frontend.cubeID(fdatA->ptr.cube);
-        MCNeighbor::updateNeighbor(touching, fdatB->side, cubeA, fdatA->side);
+        if (!InputLog::isReplaying()) {
+            InputLog::recordMCNeighbor(touching, fdatB->side, cubeA, fdatA->side);
+            MCNeighbor::updateNeighbor(touching, fdatB->side, cubeA, fdatA->side);
+        }
     }
 }
 
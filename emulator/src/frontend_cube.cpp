@@ -25,6 +25,7 @@
  */
 
 #include "frontend.h"
+#include "inputlog.h"
 
 FrontendCube::FrontendCube()
     : body(0) {}
@@ -33,7 +34,7 @@ void FrontendCube::init(unsigned _id, Cube::Hardware *_hw, b2World &world, float
 {
     id = _id;
     hw = _hw;
-    lastLcdCookie = 0;
+    lastLcdVisible = false;
     flipped = false;
 
     initBody(world, x, y);
@@ -118,30 +119,40 @@ bool FrontendCube::draw(GLRenderer &r)
 {
     /*
      * We only want to upload a new framebuffer image to the GPU if the LCD
-     * has actually been written to. Use the LCD hardware's pixel counter as
-     * a cookie to quickly do this test.
+     * has actually been written to, and then only the rows that changed.
+     * The LCD keeps a bitmap of rows touched by any pixel write since we
+     * last asked.
      *
-     * Note that we must use the pixel count instead of the write count- the
-     * pixel count tells us when *any* pixel has been touched, whereas the write
-     * count usually only tells us enough to know when a frame has begun.
+     * Note that we can't use the frame count for this- it only tells us
+     * enough to know when a frame has begun, and modes that re-address
+     * the LCD several times per frame would be missed.
      *
      * Additionally, if the LCD is invisible, send the renderer a blank black
-     * texture. To capture all of this state, we build a single 32-bit cookie
-     * that combines a 31-bit pixel count and a blanking bit.
+     * texture. Any change in visibility is a full re-upload.
      *
      * Returns true if and only if the display has changed. Always draws the
      * cube.
      */
-     
-    uint32_t cookie = hw->lcd.isVisible() ? (hw->lcd.getPixelCount() & 0x7FFFFFFF) : ((uint32_t)-1);
-    bool framebufferChanged = cookie != lastLcdCookie;
-    lastLcdCookie = cookie;
-    
+
+    bool visible = hw->lcd.isVisible();
+    uint32_t dirtyRows[Cube::LCD::DIRTY_WORDS];
+    const uint32_t *dirty = dirtyRows;
+    bool framebufferChanged;
+
+    if (visible != lastLcdVisible) {
+        hw->lcd.collectDirtyRows(dirtyRows);
+        lastLcdVisible = visible;
+        framebufferChanged = true;
+        dirty = NULL;
+    } else {
+        framebufferChanged = visible && hw->lcd.collectDirtyRows(dirtyRows);
+    }
+
     static const uint16_t blackness[128 * 128] = { 0 };
-    const uint16_t *framebuffer = hw->lcd.isVisible() ? hw->lcd.fb_mem : blackness;
+    const uint16_t *framebuffer = visible ? hw->lcd.fb_mem : blackness;
 
     r.drawCube(id, body->GetPosition(), body->GetAngle(),
-               hover, tiltVector, framebuffer, framebufferChanged,
+               hover, tiltVector, framebuffer, framebufferChanged, dirty,
                hw->backlight.getBrightness(), modelMatrix);
 
     return framebufferChanged;
@@ -179,12 +190,25 @@ void FrontendCube::setHoverTarget(float h)
 void FrontendCube::updateNeighbor(bool touching, unsigned mySide,
                                   unsigned otherSide, unsigned otherCube)
 {
+    // During --replay, the log is the only source of input
+    if (InputLog::isReplaying())
+        return;
+    InputLog::recordNeighbor(touching, id, mySide, otherCube, otherSide);
+
     if (touching)
         hw->neighbors.setContact(mySide, otherSide, otherCube);
     else
         hw->neighbors.clearContact(mySide, otherSide, otherCube);
 }
 
+void FrontendCube::setTouch(float amount)
+{
+    if (InputLog::isReplaying())
+        return;
+    InputLog::recordTouch(id, amount);
+    hw->setTouch(amount);
+}
+
 void FrontendCube::animate()
 {
     /* Adjusted tilt target which accounts for flip too */
@@ -226,7 +250,10 @@ void FrontendCube::animate()
      */
 
     b2Vec3 accelLocal = modelMatrix.Solve33(accelG);
-    hw->setAcceleration(accelLocal.x, accelLocal.y, accelLocal.z);
+    if (!InputLog::isReplaying()) {
+        InputLog::recordAcceleration(id, accelLocal.x, accelLocal.y, accelLocal.z);
+        hw->setAcceleration(accelLocal.x, accelLocal.y, accelLocal.z);
+    }
 }
 
 void FrontendCube::computeAABB(b2AABB &aabb)
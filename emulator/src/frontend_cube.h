@@ -122,10 +122,8 @@ class FrontendCube {
     void setRotationLock(bool isRotationFixed);
     void toggleFlip();
     
-    void setTouch(float amount) {
-        hw->setTouch(amount);
-    }
-    
+    void setTouch(float amount);
+
     bool isHovering() {
         return hoverTarget > CubeConstants::HEIGHT;
     }
@@ -168,7 +166,7 @@ public:
     unsigned id;
     Cube::Hardware *hw;
     
-    uint32_t lastLcdCookie;
+    bool lastLcdVisible;
 };
 
 #endif
@@ -56,8 +56,11 @@ void FrontendOverlay::init(GLRenderer *_renderer, System *_sys)
     filteredTimeRatio = 1.0f;
     realTimeMessage[0] = '\0';
 
-    for (unsigned i = 0; i < System::MAX_CUBES; i++)
+    for (unsigned i = 0; i < System::MAX_CUBES; i++) {
         cubes[i].fps[0] = '\0';
+        cubes[i].cpuStats[0][0] = '\0';
+        cubes[i].cpuStats[1][0] = '\0';
+    }
 }
 
 void FrontendOverlay::draw()
@@ -72,9 +75,14 @@ void FrontendOverlay::draw()
     if (slowTimer.realSeconds() > statsInterval) {
         float rtPercent = slowTimer.virtualRatio() * 100.0f;
 
-        // Percent of real-time
-        snprintf(realTimeMessage, sizeof realTimeMessage,
-                 "%.1f%% real-time", rtPercent);
+        // Percent of real-time, and how far the time governor has drifted
+        if (sys->opt_turbo)
+            snprintf(realTimeMessage, sizeof realTimeMessage,
+                     "%.1f%% real-time", rtPercent);
+        else
+            snprintf(realTimeMessage, sizeof realTimeMessage,
+                     "%.1f%% real-time, %+.0f ms", rtPercent,
+                     sys->getTimeGovernor().getDrift() * 1e3);
 
         // Color-coded time percentage
         if (rtPercent > 90.0f)
@@ -108,6 +116,28 @@ void FrontendOverlay::draw()
                 p += snprintf(p, end-p, "#%d - ", nbID & 0x1F);
 
             p += snprintf(p, end-p, "%.1f FPS", fps);
+
+            // Hot-path counters, for the inspector
+            Cube::Hardware::Counters c;
+            sys->cubes[i].getCounters(c);
+            const uint32_t any = 0xFFFFFFFF;
+
+            cubes[i].ticks.update(slowTimer, c.ticks, any);
+            cubes[i].sbtBlocks.update(slowTimer, c.sbtBlocks, any);
+            cubes[i].irqDispatches.update(slowTimer, c.irqDispatches, any);
+            cubes[i].flashCycles.update(slowTimer, c.flashCycles, any);
+            cubes[i].lcdPixels.update(slowTimer, c.lcdPixels, any);
+
+            snprintf(cubes[i].cpuStats[0], sizeof cubes[i].cpuStats[0],
+                "%.2f MHz, %.0fk blk/s",
+                cubes[i].ticks.getHZ() * 1e-6f,
+                cubes[i].sbtBlocks.getHZ() * 1e-3f);
+
+            snprintf(cubes[i].cpuStats[1], sizeof cubes[i].cpuStats[1],
+                "%.0f irq/s, %.0fk flash/s, %.0fk px/s",
+                cubes[i].irqDispatches.getHZ(),
+                cubes[i].flashCycles.getHZ() * 1e-3f,
+                cubes[i].lcdPixels.getHZ() * 1e-3f);
         }
 
         slowTimer.start();
@@ -172,11 +202,17 @@ void FrontendOverlay::drawCubeInspector(FrontendCube *fe,
     // Force the box to be wide enough for all our text
     for (unsigned i = 0; headings[i]; i++)
         width = std::max(width, renderer->measureText(headings[i]) + margin*2);
+    for (unsigned i = 0; i < arraysize(cubes[id].cpuStats); i++)
+        width = std::max(width, renderer->measureText(cubes[id].cpuStats[i]) + margin*2);
 
     // Background rectangle
     renderer->overlayRect(left, top, width, height, inspectorBgColor.v);
     moveTo(left + margin, top + margin);
 
+    // CPU hot-path rates
+    for (unsigned i = 0; i < arraysize(cubes[id].cpuStats); i++)
+        text(inspectorTextColor, cubes[id].cpuStats[i]);
+
     // Flash memory state
     {
         text(inspectorTextColor, headings[0]);
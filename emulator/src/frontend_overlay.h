@@ -107,7 +107,13 @@ private:
     
     struct {
         char fps[64];
+        char cpuStats[2][48];
         EventRateProbe lcd_wr;
+        EventRateProbe ticks;
+        EventRateProbe sbtBlocks;
+        EventRateProbe irqDispatches;
+        EventRateProbe flashCycles;
+        EventRateProbe lcdPixels;
         uint32_t flashModifyCount;
     } cubes[System::MAX_CUBES];
 };
@@ -48,6 +48,9 @@ bool GLRenderer::init()
         fprintf(stderr, "Error: Shader support not available\n");
         return false;
     }
+
+    // Optional, for asynchronous LCD texture uploads
+    hasPixelBuffers = HAS_GL_ENTRY(glMapBuffer) && HAS_GL_ENTRY(glUnmapBuffer);
         
     /*
      * Compile our shaders
@@ -500,6 +503,9 @@ void GLRenderer::initCubeFB(unsigned id)
     glGenTextures(NUM_LCD_TEXTURES, &cube.texAccurate[0]);
     cube.currentLcdTexture = 0;
 
+    if (hasPixelBuffers)
+        glGenBuffers(1, &cube.pixelBuffer);
+
     /*
      * To reduce GL state thrashing, plus to work around a specific
      * GPU driver bug (pivotal 23521255) we use separate textures for
@@ -676,11 +682,13 @@ void GLRenderer::cubeTransform(b2Vec2 center, float angle, float hover,
 
 void GLRenderer::drawCube(unsigned id, b2Vec2 center, float angle, float hover,
                           b2Vec2 tilt, const uint16_t *framebuffer, bool framebufferChanged,
-                          float backlight, b2Mat33 &modelMatrix)
+                          const uint32_t *dirtyRows, float backlight, b2Mat33 &modelMatrix)
 {
     /*
      * Draw one cube, and place its modelview matrix in 'modelmatrix'.
-     * If framebuffer==NULL, don't reupload the framebuffer, it hasn't changed.
+     * If !framebufferChanged, don't reupload the framebuffer. Otherwise,
+     * 'dirtyRows' is a bitmap of the rows that changed, or NULL if they
+     * all did.
      */
 
     if (!cubes[id].fbInitialized) {
@@ -688,6 +696,7 @@ void GLRenderer::drawCube(unsigned id, b2Vec2 center, float angle, float hover,
         
         // Re-upload framebuffer, even if the LCD hasn't changed
         framebufferChanged = true;
+        dirtyRows = NULL;
     }
 
     if (currentFrame.pixelZoomMode) {
@@ -719,11 +728,12 @@ void GLRenderer::drawCube(unsigned id, b2Vec2 center, float angle, float hover,
           * name.)
           */
         framebufferChanged = true;
+        dirtyRows = NULL;
         cubes[id].pixelAccurate = pixelAccurate;
         cubes[id].isTilted = tState.isTilted;
     }
 
-    drawCubeFace(id, framebufferChanged ? framebuffer : NULL, backlight);
+    drawCubeFace(id, framebufferChanged ? framebuffer : NULL, dirtyRows, backlight);
 
     glRotatef(180.f, 0,0,1);
     drawCubeBody();
@@ -773,7 +783,8 @@ void GLRenderer::drawCubeBody()
     drawModel(cubeBody);
 }
 
-void GLRenderer::drawCubeFace(unsigned id, const uint16_t *framebuffer, float backlight)
+void GLRenderer::drawCubeFace(unsigned id, const uint16_t *framebuffer,
+                              const uint32_t *dirtyRows, float backlight)
 {
     GLCube &cube = cubes[id];
     GLhandleARB program = cube.pixelAccurate ? cubeFaceProgUnfiltered : cubeFaceProgFiltered;
@@ -799,8 +810,16 @@ void GLRenderer::drawCubeFace(unsigned id, const uint16_t *framebuffer, float ba
          * By avoiding reuploading a texture every frame, we can keep our
          * graphics pipeline stalls down to a minimum. GPU drivers hate it
          * when we touch a resource that the GPU might still be using :)
+         *
+         * Each texture in the ring remembers which rows it's missing, so
+         * we only need to upload the rows that changed since that
+         * particular texture was last used.
          */
 
+        for (unsigned i = 0; i < NUM_LCD_TEXTURES; i++)
+            for (unsigned w = 0; w < Cube::LCD::DIRTY_WORDS; w++)
+                cube.dirtyRows[i][w] |= dirtyRows ? dirtyRows[w] : (uint32_t)-1;
+
         cube.currentLcdTexture = (cube.currentLcdTexture + 1) % NUM_LCD_TEXTURES;
     }
 
@@ -816,9 +835,7 @@ void GLRenderer::drawCubeFace(unsigned id, const uint16_t *framebuffer, float ba
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, cube.isTilted ? 5.0f : 0.0f);
         }
 
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-                        Cube::LCD::WIDTH, Cube::LCD::HEIGHT,
-                        GL_RGB, GL_UNSIGNED_SHORT_5_6_5, framebuffer);
+        uploadCubeFB(id, framebuffer);
     }
 
     if (!pendingScreenshotName.empty()) {
@@ -847,6 +864,67 @@ void GLRenderer::drawCubeFace(unsigned id, const uint16_t *framebuffer, float ba
     glDisable(GL_TEXTURE_2D);
 }
 
+static bool nextDirtySpan(const uint32_t *rows, unsigned &first, unsigned &count)
+{
+    // Find the next run of dirty rows at or after 'first'
+
+    unsigned y = first;
+    while (y < Cube::LCD::HEIGHT && !(rows[y >> 5] & (1 << (y & 31))))
+        y++;
+    if (y == Cube::LCD::HEIGHT)
+        return false;
+
+    first = y;
+    while (y < Cube::LCD::HEIGHT && (rows[y >> 5] & (1 << (y & 31))))
+        y++;
+    count = y - first;
+    return true;
+}
+
+void GLRenderer::uploadCubeFB(unsigned id, const uint16_t *framebuffer)
+{
+    /*
+     * Upload the dirty rows of the current LCD texture, which must be bound.
+     *
+     * If we have pixel buffer objects, copy the dirty spans into a freshly
+     * orphaned PBO and let the driver transfer them asynchronously.
+     * Otherwise, upload the spans directly from the framebuffer.
+     */
+
+    GLCube &cube = cubes[id];
+    uint32_t *rows = cube.dirtyRows[cube.currentLcdTexture];
+    const unsigned rowSize = Cube::LCD::WIDTH * sizeof framebuffer[0];
+    const uint8_t *source = (const uint8_t *) framebuffer;
+    unsigned first, count;
+
+    if (hasPixelBuffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, cube.pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, Cube::LCD::HEIGHT * rowSize, NULL, GL_STREAM_DRAW);
+
+        uint8_t *mapped = (uint8_t *) glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (mapped) {
+            for (first = 0; nextDirtySpan(rows, first, count); first += count)
+                memcpy(mapped + first * rowSize, source + first * rowSize, count * rowSize);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            // Texture uploads now take offsets into the PBO
+            source = NULL;
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+
+    for (first = 0; nextDirtySpan(rows, first, count); first += count)
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first,
+                        Cube::LCD::WIDTH, count,
+                        GL_RGB, GL_UNSIGNED_SHORT_5_6_5, source + first * rowSize);
+
+    if (!source)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    memset(rows, 0, sizeof cube.dirtyRows[0]);
+}
+
 void GLRenderer::loadModel(const uint8_t *data, Model &model)
 {
     model.data.init(data);
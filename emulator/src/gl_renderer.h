@@ -51,6 +51,10 @@
 #   define GL_UNSIGNED_SHORT_5_6_5 0x8363
 #endif
 
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#   define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+
 #include <Box2D/Box2D.h>
 #include <vector>
 #include <string>
@@ -71,7 +75,7 @@ class GLRenderer {
 
     void drawCube(unsigned id, b2Vec2 center, float angle, float hover,
                   b2Vec2 tilt, const uint16_t *framebuffer, bool framebufferChanged,
-                  float backlight, b2Mat33 &modelMatrix);
+                  const uint32_t *dirtyRows, float backlight, b2Mat33 &modelMatrix);
     void drawMC(b2Vec2 center, float angle, const float led[3], float volume);
 
     void beginOverlay();
@@ -116,7 +120,9 @@ class GLRenderer {
                        b2Vec2 tilt, CubeTransformState &tState);
 
     void drawCubeBody();
-    void drawCubeFace(unsigned id, const uint16_t *framebuffer, float backlight);
+    void drawCubeFace(unsigned id, const uint16_t *framebuffer,
+                      const uint32_t *dirtyRows, float backlight);
+    void uploadCubeFB(unsigned id, const uint16_t *framebuffer);
 
     void loadModel(const uint8_t *data, Model &model);
     void drawModel(Model &model);
@@ -130,6 +136,7 @@ class GLRenderer {
     void saveColorBufferPNG(std::string name);
 
     int viewportWidth, viewportHeight;
+    bool hasPixelBuffers;
 
     Model cubeBody;
     Model cubeFace;
@@ -178,6 +185,10 @@ class GLRenderer {
         uint8_t currentLcdTexture;
         GLuint texFiltered[NUM_LCD_TEXTURES];
         GLuint texAccurate[NUM_LCD_TEXTURES];
+        GLuint pixelBuffer;
+
+        // Rows each ring texture is missing, one bit per row
+        uint32_t dirtyRows[NUM_LCD_TEXTURES][Cube::LCD::DIRTY_WORDS];
         GLuint flashTex;
     } cubes[System::MAX_CUBES];
 
@@ -0,0 +1,352 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "inputlog.h"
+#include "system.h"
+#include "system_mc.h"
+#include "mc_homebutton.h"
+#include "mc_neighbor.h"
+#include "btprotocol.h"
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+
+#define LOG_PREFIX  "Input Log: "
+
+InputLog InputLog::instance;
+
+
+bool InputLog::startRecording(System *sys, const char *filename)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, LOG_PREFIX "Can't open '%s' for writing\n", filename);
+        return false;
+    }
+
+    // Impossible values, so the first tilt of each cube is always logged
+    for (unsigned i = 0; i < arraysize(instance.lastAccel); ++i)
+        for (unsigned j = 0; j < 3; ++j)
+            instance.lastAccel[i][j] = 1e9f;
+
+    instance.sys = sys;
+    fprintf(f, "# Siftulator input log, %u cubes\n", sys->opt_numCubes);
+
+    tthread::lock_guard<tthread::mutex> guard(instance.recordLock);
+    instance.recordFile = f;
+    return true;
+}
+
+bool InputLog::startReplay(System *sys, const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, LOG_PREFIX "Can't open '%s'\n", filename);
+        return false;
+    }
+
+    bool success = instance.load(f);
+    fclose(f);
+    if (!success) {
+        fprintf(stderr, LOG_PREFIX "Can't parse '%s'\n", filename);
+        return false;
+    }
+
+    instance.sys = sys;
+    instance.nextEvent = 0;
+    instance.replaying = true;
+    return true;
+}
+
+void InputLog::stop()
+{
+    if (isRecording()) {
+        instance.write("%" PRIu64 " end\n", instance.now());
+
+        tthread::lock_guard<tthread::mutex> guard(instance.recordLock);
+        fclose(instance.recordFile);
+        instance.recordFile = 0;
+    }
+
+    instance.replaying = false;
+}
+
+uint64_t InputLog::now()
+{
+    // Inputs from the MC thread land on its own clock; anything else, the cubes'.
+    if (SystemMC::isSimulationThread())
+        return SystemMC::currentTicks();
+    return sys->time.clocks;
+}
+
+void InputLog::write(const char *fmt, ...)
+{
+    tthread::lock_guard<tthread::mutex> guard(recordLock);
+    if (!recordFile)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(recordFile, fmt, ap);
+    va_end(ap);
+}
+
+void InputLog::recordAcceleration(unsigned cube, float xG, float yG, float zG)
+{
+    // The frontend reports tilt every frame. Only log changes.
+    if (!isRecording() || cube >= arraysize(instance.lastAccel))
+        return;
+
+    float *last = instance.lastAccel[cube];
+    if (last[0] == xG && last[1] == yG && last[2] == zG)
+        return;
+    last[0] = xG;
+    last[1] = yG;
+    last[2] = zG;
+
+    instance.write("%" PRIu64 " accel %u %.9g %.9g %.9g\n", instance.now(), cube, xG, yG, zG);
+}
+
+void InputLog::recordTouch(unsigned cube, bool touching)
+{
+    if (isRecording())
+        instance.write("%" PRIu64 " touch %u %d\n", instance.now(), cube, touching);
+}
+
+void InputLog::recordNeighbor(bool touching, unsigned cube, unsigned side,
+                              unsigned otherCube, unsigned otherSide)
+{
+    if (isRecording())
+        instance.write("%" PRIu64 " neighbor %d %u %u %u %u\n", instance.now(),
+            touching, cube, side, otherCube, otherSide);
+}
+
+void InputLog::recordMCNeighbor(bool touching, unsigned mcSide, unsigned cube, unsigned cubeSide)
+{
+    if (isRecording())
+        instance.write("%" PRIu64 " mcneighbor %d %u %u %u\n", instance.now(),
+            touching, mcSide, cube, cubeSide);
+}
+
+void InputLog::recordButton(bool pressed)
+{
+    if (isRecording())
+        instance.write("%" PRIu64 " button %d\n", instance.now(), pressed);
+}
+
+void InputLog::recordBluetoothLink(bool connected)
+{
+    if (isRecording())
+        instance.write("%" PRIu64 " btlink %d\n", instance.now(), connected);
+}
+
+void InputLog::recordBluetoothData(const uint8_t *bytes, unsigned length)
+{
+    if (!isRecording())
+        return;
+
+    char hex[MAX_DATA_BYTES * 2 + 1];
+    length = std::min(length, MAX_DATA_BYTES);
+    for (unsigned i = 0; i < length; ++i)
+        sprintf(hex + i*2, "%02x", bytes[i]);
+    hex[length * 2] = '\0';
+
+    instance.write("%" PRIu64 " btdata %s\n", instance.now(), hex);
+}
+
+bool InputLog::load(FILE *f)
+{
+    /*
+     * Read the whole log up front. Inputs from the frontend and the MC
+     * thread can be logged slightly out of order, so sort them by clock.
+     * The sort is stable, so inputs on the same tick keep their order.
+     */
+
+    char line[256];
+    events.clear();
+
+    while (fgets(line, sizeof line, f)) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        Event e;
+        if (!parseLine(line, e))
+            return false;
+        events.push_back(e);
+    }
+
+    std::stable_sort(events.begin(), events.end());
+    return true;
+}
+
+bool InputLog::parseLine(const char *line, Event &e)
+{
+    char type[16];
+    int pos = 0;
+    unsigned a[5];
+
+    memset(&e, 0, sizeof e);
+    if (sscanf(line, "%" SCNu64 " %15s %n", &e.clock, type, &pos) < 2)
+        return false;
+    const char *args = line + pos;
+
+    if (!strcmp(type, "accel")) {
+        e.type = Accel;
+        if (sscanf(args, "%u %f %f %f", &a[0], &e.accel[0], &e.accel[1], &e.accel[2]) != 4)
+            return false;
+        e.args[0] = a[0];
+        return a[0] < _SYS_NUM_CUBE_SLOTS;
+    }
+
+    if (!strcmp(type, "touch")) {
+        e.type = Touch;
+        if (sscanf(args, "%u %u", &a[0], &a[1]) != 2)
+            return false;
+        e.args[0] = a[0];
+        e.flag = a[1];
+        return a[0] < _SYS_NUM_CUBE_SLOTS;
+    }
+
+    if (!strcmp(type, "neighbor")) {
+        e.type = Neighbor;
+        if (sscanf(args, "%u %u %u %u %u", &a[0], &a[1], &a[2], &a[3], &a[4]) != 5)
+            return false;
+        e.flag = a[0];
+        for (unsigned i = 0; i < 4; ++i)
+            e.args[i] = a[i+1];
+        return a[1] < _SYS_NUM_CUBE_SLOTS && a[3] < _SYS_NUM_CUBE_SLOTS
+            && a[2] < Cube::Neighbors::NUM_SIDES && a[4] < Cube::Neighbors::NUM_SIDES;
+    }
+
+    if (!strcmp(type, "mcneighbor")) {
+        e.type = BaseNeighbor;
+        if (sscanf(args, "%u %u %u %u", &a[0], &a[1], &a[2], &a[3]) != 4)
+            return false;
+        e.flag = a[0];
+        for (unsigned i = 0; i < 3; ++i)
+            e.args[i] = a[i+1];
+        return a[1] < 2 && a[2] < _SYS_NUM_CUBE_SLOTS
+            && a[3] < Cube::Neighbors::NUM_SIDES;
+    }
+
+    if (!strcmp(type, "button") || !strcmp(type, "btlink")) {
+        e.type = type[0] == 'b' && type[1] == 'u' ? Button : BluetoothLink;
+        if (sscanf(args, "%u", &a[0]) != 1)
+            return false;
+        e.flag = a[0];
+        return true;
+    }
+
+    if (!strcmp(type, "btdata")) {
+        e.type = BluetoothData;
+        while (e.length < MAX_DATA_BYTES && sscanf(args, "%2x", &a[0]) == 1) {
+            e.data[e.length++] = a[0];
+            args += 2;
+        }
+        return e.length > 0;
+    }
+
+    if (!strcmp(type, "end")) {
+        e.type = End;
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t InputLog::nextDeadline()
+{
+    InputLog &self = instance;
+    if (!self.replaying || self.nextEvent >= self.events.size())
+        return uint64_t(-1);
+    return self.events[self.nextEvent].clock;
+}
+
+bool InputLog::replayUntil(uint64_t clock)
+{
+    InputLog &self = instance;
+
+    while (self.replaying && self.nextEvent < self.events.size()
+           && self.events[self.nextEvent].clock <= clock) {
+        const Event &e = self.events[self.nextEvent++];
+        self.apply(e, clock);
+    }
+
+    return self.replaying;
+}
+
+void InputLog::apply(const Event &e, uint64_t clock)
+{
+    /*
+     * The cubes are halted on 'clock'. Sensor inputs go through their
+     * scheduled input queue for this same tick; everything else can be
+     * changed directly.
+     */
+
+    switch (e.type) {
+
+    case Accel:
+        sys->cubes[e.args[0]].scheduleAcceleration(clock, e.accel[0], e.accel[1], e.accel[2]);
+        break;
+
+    case Touch:
+        sys->cubes[e.args[0]].scheduleTouch(clock, e.flag);
+        break;
+
+    case Neighbor:
+        if (e.flag)
+            sys->cubes[e.args[0]].neighbors.setContact(e.args[1], e.args[3], e.args[2]);
+        else
+            sys->cubes[e.args[0]].neighbors.clearContact(e.args[1], e.args[3], e.args[2]);
+        break;
+
+    case BaseNeighbor:
+        MCNeighbor::updateNeighbor(e.flag, e.args[0], e.args[1], e.args[2]);
+        break;
+
+    case Button:
+        HomeButton::setPressed(e.flag);
+        break;
+
+    case BluetoothLink:
+        if (e.flag)
+            BTProtocolCallbacks::onConnect();
+        else
+            BTProtocolCallbacks::onDisconnect();
+        break;
+
+    case BluetoothData: {
+        uint8_t packet[MAX_DATA_BYTES];
+        memcpy(packet, e.data, e.length);
+        BTProtocolCallbacks::onReceiveData(packet, e.length);
+        break;
+    }
+
+    case End:
+        fprintf(stderr, LOG_PREFIX "Replay finished\n");
+        replaying = false;
+        break;
+    }
+}
@@ -0,0 +1,151 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _INPUT_LOG_H
+#define _INPUT_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "tinythread.h"
+#include "sifteo/abi/types.h"
+
+class System;
+
+
+/**
+ * Session recording (--record FILE) and replay (--replay FILE).
+ *
+ * Recording logs every external input as it reaches the simulation,
+ * stamped with the virtual clock: tilt and touch from the frontend,
+ * neighbor contacts between cubes and with the base, the home button,
+ * and the Bluetooth host's link state and packets. The log is plain
+ * text, one input per line:
+ *
+ *   CLOCK accel CUBE X Y Z
+ *   CLOCK touch CUBE 0|1
+ *   CLOCK neighbor 0|1 CUBE SIDE OTHERCUBE OTHERSIDE
+ *   CLOCK mcneighbor 0|1 MCSIDE CUBE CUBESIDE
+ *   CLOCK button 0|1
+ *   CLOCK btlink 0|1
+ *   CLOCK btdata HEXBYTES
+ *   CLOCK end
+ *
+ * Replay feeds the same inputs back from the MC thread, each one during
+ * a cube sync event on exactly its recorded tick, and exits when it
+ * reaches "end". Accelerometer noise isn't recorded, so every replay of
+ * a log runs the same way, which makes it useful as a benchmark with
+ * --headless and -T. The launcher, flash, and cube count must match the
+ * recording, and replay shouldn't be mixed with scripted inputs.
+ */
+class InputLog {
+public:
+    static bool startRecording(System *sys, const char *filename);
+    static bool startReplay(System *sys, const char *filename);
+    static void stop();
+
+    static bool isRecording() {
+        return instance.recordFile != 0;
+    }
+
+    static bool isReplaying() {
+        return instance.replaying;
+    }
+
+    // Recording hooks. Callable on any thread; no-ops unless recording.
+    static void recordAcceleration(unsigned cube, float xG, float yG, float zG);
+    static void recordTouch(unsigned cube, bool touching);
+    static void recordNeighbor(bool touching, unsigned cube, unsigned side,
+                               unsigned otherCube, unsigned otherSide);
+    static void recordMCNeighbor(bool touching, unsigned mcSide, unsigned cube, unsigned cubeSide);
+    static void recordButton(bool pressed);
+    static void recordBluetoothLink(bool connected);
+    static void recordBluetoothData(const uint8_t *bytes, unsigned length);
+
+    /// MC thread: virtual clock of the next replayed input, or ~0 if none
+    static uint64_t nextDeadline();
+
+    /**
+     * MC thread, with the cubes halted: apply every input due by 'clock'.
+     * Returns false once the log's "end" has been reached.
+     */
+    static bool replayUntil(uint64_t clock);
+
+private:
+    InputLog() {}
+    static InputLog instance;
+
+    // One Bluetooth packet, as BluetoothBridge::MAX_PACKET_BYTES
+    static const unsigned MAX_DATA_BYTES = _SYS_BT_PACKET_BYTES + 1;
+
+    enum Type {
+        Accel,
+        Touch,
+        Neighbor,
+        BaseNeighbor,
+        Button,
+        BluetoothLink,
+        BluetoothData,
+        End
+    };
+
+    struct Event {
+        uint64_t clock;
+        uint8_t type;
+        uint8_t flag;
+        uint8_t args[4];
+        uint8_t length;
+        float accel[3];
+        uint8_t data[MAX_DATA_BYTES];
+
+        bool operator< (const Event &other) const {
+            return clock < other.clock;
+        }
+
+        // Settles std::swap() vs. swap() from macros.h, for std::stable_sort
+        friend void swap(Event &a, Event &b) {
+            Event t = a;
+            a = b;
+            b = t;
+        }
+    };
+
+    System *sys;
+    FILE *recordFile;
+    tthread::mutex recordLock;
+    float lastAccel[_SYS_NUM_CUBE_SLOTS][3];     // Frontend thread only
+
+    bool replaying;
+    std::vector<Event> events;
+    unsigned nextEvent;
+
+    uint64_t now();
+    void write(const char *fmt, ...);
+    bool load(FILE *f);
+    static bool parseLine(const char *line, Event &e);
+    void apply(const Event &e, uint64_t clock);
+};
+
+#endif
@@ -0,0 +1,316 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "latencytracer.h"
+#include "system.h"
+#include "system_mc.h"
+#include "cube_hardware.h"
+#include "cubeslots.h"
+#include "cube.h"
+#include <string.h>
+
+#define LOG_PREFIX  "LATENCY: "
+
+LatencyTracer LatencyTracer::instance;
+
+static const char *stageNames[] = {
+    "input", "ack", "dispatch", "paint", "radio", "render", "lcd",
+};
+
+
+void LatencyTracer::start(System *sys)
+{
+    STATIC_ASSERT(arraysize(stageNames) == NUM_STAGES);
+
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+
+    memset(instance.probes, 0, sizeof instance.probes);
+    for (unsigned i = 0; i < MAX_CUBES; ++i)
+        instance.probes[i].next = NUM_STAGES;
+
+    memset(&instance.stats, 0, sizeof instance.stats);
+    instance.stats.minTicks = uint64_t(-1);
+
+    instance.sys = sys;
+    instance.enabled = true;
+}
+
+void LatencyTracer::stop()
+{
+    instance.enabled = false;
+}
+
+const char *LatencyTracer::stageName(unsigned stage)
+{
+    return stage < NUM_STAGES ? stageNames[stage] : "idle";
+}
+
+void LatencyTracer::getStats(Stats &stats)
+{
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+    stats = instance.stats;
+}
+
+uint64_t LatencyTracer::mcClock()
+{
+    return SystemMC::currentTicks();
+}
+
+void LatencyTracer::touch(Cube::Hardware &cube)
+{
+    if (isEnabled())
+        instance.begin(cube, true);
+}
+
+void LatencyTracer::tilt(Cube::Hardware &cube, const int16_t accel[3])
+{
+    /*
+     * Physics and noise move the accelerometer a little all the time.
+     * Only count it as an input once it has moved far enough from where
+     * it was at the last input.
+     */
+
+    if (!isEnabled())
+        return;
+
+    Probe &p = instance.probes[cube.id()];
+    bool moved = false;
+
+    for (unsigned i = 0; i < 3; ++i) {
+        int delta = accel[i] - p.tiltRef[i];
+        if (delta >= TILT_THRESHOLD || delta <= -TILT_THRESHOLD)
+            moved = true;
+    }
+
+    if (!p.tiltValid || moved) {
+        memcpy(p.tiltRef, accel, sizeof p.tiltRef);
+        if (p.tiltValid)
+            instance.begin(cube, false);
+        p.tiltValid = true;
+    }
+}
+
+void LatencyTracer::begin(Cube::Hardware &cube, bool isTouch)
+{
+    Probe &p = probes[cube.id()];
+    uint64_t now = cube.time->clocks;
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+
+    if (p.next != NUM_STAGES) {
+        if (now - p.clocks[Input] < VirtualTime::msec(TIMEOUT_MS))
+            return;
+        stats.dropped++;
+    }
+
+    p.isTouch = isTouch;
+    p.radioAddr = cube.spi.radio.getPackedRXAddr();
+    p.rendering = false;
+    p.clocks[Input] = now;
+    p.next = Ack;
+}
+
+LatencyTracer::Probe *LatencyTracer::probeForSlot(_SYSCubeID cid)
+{
+    // Find the cube on the other end of a CubeSlot's radio link
+    uint64_t addr = CubeSlots::instances[cid].getRadioAddress()->pack();
+
+    for (unsigned i = 0; i < sys->opt_numCubes; ++i)
+        if (probes[i].next != NUM_STAGES && probes[i].radioAddr == addr)
+            return &probes[i];
+
+    return NULL;
+}
+
+void LatencyTracer::ack(_SYSCubeID cid, bool isTouch)
+{
+    if (!isEnabled())
+        return;
+
+    Probe *p = instance.probeForSlot(cid);
+    if (p && p->next == Ack && p->isTouch == isTouch)
+        instance.advance(*p, Ack, mcClock());
+}
+
+void LatencyTracer::dispatch(_SYSCubeIDVector cv, bool isTouch)
+{
+    if (!isEnabled())
+        return;
+
+    while (cv) {
+        _SYSCubeID cid = Intrinsic::CLZ(cv);
+        cv ^= Intrinsic::LZ(cid);
+
+        Probe *p = instance.probeForSlot(cid);
+        if (p && p->next == Dispatch && p->isTouch == isTouch)
+            instance.advance(*p, Dispatch, mcClock());
+    }
+}
+
+void LatencyTracer::paint(_SYSCubeID cid)
+{
+    if (!isEnabled())
+        return;
+
+    Probe *p = instance.probeForSlot(cid);
+    if (p && p->next == Paint)
+        instance.advance(*p, Paint, mcClock());
+}
+
+void LatencyTracer::vramFlushed(_SYSCubeID cid)
+{
+    if (!isEnabled())
+        return;
+
+    Probe *p = instance.probeForSlot(cid);
+    if (p && p->next == Radio)
+        instance.advance(*p, Radio, mcClock());
+}
+
+void LatencyTracer::lcdUpdate(Cube::Hardware &cube)
+{
+    /*
+     * Called on every graphics bus update while we're enabled, so this
+     * avoids the lock unless a stage is done. The LCD counts a frame at
+     * the DISPON command the firmware sends after each one. If a frame
+     * was already being drawn when the VRAM arrived, it can't include
+     * the new VRAM, so we wait for the next one.
+     */
+
+    Probe &p = instance.probes[cube.id()];
+    uint32_t frames = cube.lcd.getFrameCount();
+    uint32_t pixels = cube.lcd.getPixelCount();
+    bool frameEnded = frames != p.lastFrames;
+
+    if (frameEnded) {
+        p.lastFrames = frames;
+        p.frameEndPixels = pixels;
+    }
+
+    switch (p.next) {
+
+    case Render:
+        if (!p.rendering) {
+            p.rendering = true;
+            p.skipFrame = pixels != p.frameEndPixels;
+        }
+        if (p.skipFrame) {
+            if (frameEnded)
+                p.skipFrame = false;
+        } else if (pixels != p.frameEndPixels) {
+            p.renderFrames = frames;
+            instance.advance(p, Render, cube.time->clocks);
+        }
+        break;
+
+    case LCD:
+        if (frames != p.renderFrames)
+            instance.advance(p, LCD, cube.time->clocks);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void LatencyTracer::advance(Probe &p, Stage stage, uint64_t clock)
+{
+    tthread::lock_guard<tthread::mutex> guard(lock);
+
+    if (p.next != stage)
+        return;
+
+    // The MC and cube clocks may be slightly out of step
+    p.clocks[stage] = MAX(clock, p.clocks[stage - 1]);
+
+    if (stage == LCD)
+        complete(p);
+    else
+        p.next = stage + 1;
+}
+
+void LatencyTracer::complete(Probe &p)
+{
+    uint64_t total = p.clocks[LCD] - p.clocks[Input];
+    unsigned bucket = total / VirtualTime::msec(BUCKET_MS);
+
+    stats.completed++;
+    stats.minTicks = MIN(stats.minTicks, total);
+    stats.maxTicks = MAX(stats.maxTicks, total);
+    stats.histogram[MIN(bucket, NUM_BUCKETS - 1)]++;
+
+    for (unsigned s = Ack; s < NUM_STAGES; ++s)
+        stats.stageTicks[s] += p.clocks[s] - p.clocks[s - 1];
+
+    p.next = NUM_STAGES;
+}
+
+void LatencyTracer::report()
+{
+    /*
+     * Log a summary: the mean time spent in each stage, and a histogram
+     * of total latency, drawn with one '#' per trace up to a width of 50.
+     */
+
+    Stats s;
+    getStats(s);
+
+    LOG((LOG_PREFIX "%u inputs traced to the LCD, %u dropped\n",
+        s.completed, s.dropped));
+    if (!s.completed)
+        return;
+
+    double msPerTick = 1e3 / VirtualTime::HZ;
+    uint64_t totalTicks = 0;
+
+    for (unsigned i = Ack; i < NUM_STAGES; ++i) {
+        LOG((LOG_PREFIX "  %-9s %8.2f ms mean\n", stageNames[i],
+            s.stageTicks[i] * msPerTick / s.completed));
+        totalTicks += s.stageTicks[i];
+    }
+
+    LOG((LOG_PREFIX "  %-9s %8.2f ms mean, %.2f min, %.2f max\n", "total",
+        totalTicks * msPerTick / s.completed,
+        s.minTicks * msPerTick, s.maxTicks * msPerTick));
+
+    uint32_t peak = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+        peak = MAX(peak, s.histogram[i]);
+
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+        if (!s.histogram[i])
+            continue;
+
+        unsigned width = peak > 50 ? (s.histogram[i] * 50 + peak - 1) / peak : s.histogram[i];
+
+        if (i == NUM_BUCKETS - 1)
+            LOG((LOG_PREFIX "  %3u+    ms %6u ", i * BUCKET_MS, s.histogram[i]));
+        else
+            LOG((LOG_PREFIX "  %3u-%-3u ms %6u ", i * BUCKET_MS, (i + 1) * BUCKET_MS, s.histogram[i]));
+        while (width--)
+            LOG(("#"));
+        LOG(("\n"));
+    }
+}
@@ -0,0 +1,145 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _LATENCY_TRACER_H
+#define _LATENCY_TRACER_H
+
+#include <stdint.h>
+#include "macros.h"
+#include "tinythread.h"
+#include "sifteo/abi/types.h"
+
+class System;
+namespace Cube { class Hardware; }
+
+
+/**
+ * Input-to-photon latency tracing (--latency, or System:setLatencyTrace()
+ * from Lua).
+ *
+ * Follows one touch or tilt at a time per cube through the whole pipeline,
+ * stamping each stage with the virtual clock:
+ *
+ *   input     Cube::Hardware applies a touch edge, or a tilt of 1/8 g or more
+ *   ack       The base parses an ACK that reports it
+ *   dispatch  Event::dispatch() calls the game's touch or accel handler
+ *   paint     The game has written VRAM, and calls System::paint()
+ *   radio     CubeCodec has sent all of that VRAM to the cube
+ *   render    The cube's graphics_render starts writing the next frame to the LCD
+ *   lcd       The cube finishes writing that frame
+ *
+ * Completed traces are added to a histogram of total latency, and to a
+ * per-stage breakdown. A new input is ignored while one is already in
+ * flight on that cube, unless that one is over a second old, in which case
+ * it's counted as dropped. (Games don't have to redraw on every input.)
+ *
+ * Master stages use SystemMC's clock, and cube stages use the cube's. The
+ * two are kept within a radio packet of each other.
+ */
+class LatencyTracer {
+public:
+    enum Stage {
+        Input,
+        Ack,
+        Dispatch,
+        Paint,
+        Radio,
+        Render,
+        LCD,
+        NUM_STAGES,
+    };
+
+    static const unsigned BUCKET_MS = 2;
+    static const unsigned NUM_BUCKETS = 50;     // Last bucket is open-ended
+
+    struct Stats {
+        uint32_t completed;
+        uint32_t dropped;
+        uint64_t minTicks;
+        uint64_t maxTicks;
+        uint64_t stageTicks[NUM_STAGES];        // Sum of time since previous stage
+        uint32_t histogram[NUM_BUCKETS];        // Total latency, BUCKET_MS per bucket
+    };
+
+    static void start(System *sys);
+    static void stop();
+
+    static ALWAYS_INLINE bool isEnabled() {
+        return instance.enabled;
+    }
+
+    static void getStats(Stats &stats);
+    static void report();
+    static const char *stageName(unsigned stage);
+
+    // Cube thread hooks
+    static void touch(Cube::Hardware &cube);
+    static void tilt(Cube::Hardware &cube, const int16_t accel[3]);
+    static void lcdUpdate(Cube::Hardware &cube);
+
+    // MC thread hooks, from the firmware
+    static void ack(_SYSCubeID cid, bool isTouch);
+    static void dispatch(_SYSCubeIDVector cv, bool isTouch);
+    static void paint(_SYSCubeID cid);
+    static void vramFlushed(_SYSCubeID cid);
+
+private:
+    LatencyTracer() {}
+    static LatencyTracer instance;
+
+    static const unsigned MAX_CUBES = _SYS_NUM_CUBE_SLOTS;
+    static const int16_t TILT_THRESHOLD = 0x1000;       // 1/8 g, at +/- 2 g full scale
+    static const unsigned TIMEOUT_MS = 1000;
+
+    struct Probe {
+        volatile uint8_t next;          // Stage we're waiting for, NUM_STAGES if idle
+        bool isTouch;
+        uint64_t radioAddr;             // Cube's packed RX address, at input
+        uint64_t clocks[NUM_STAGES];
+
+        // Cube thread only
+        int16_t tiltRef[3];
+        bool tiltValid;
+        bool rendering;                 // Seen the LCD since the radio stage
+        bool skipFrame;                 // A frame was mid-draw at the radio stage
+        uint32_t lastFrames;
+        uint32_t frameEndPixels;
+        uint32_t renderFrames;
+    };
+
+    System *sys;
+    volatile bool enabled;
+    tthread::mutex lock;
+    Probe probes[MAX_CUBES];
+    Stats stats;
+
+    void begin(Cube::Hardware &cube, bool isTouch);
+    void advance(Probe &p, Stage stage, uint64_t clock);
+    void complete(Probe &p);
+    Probe *probeForSlot(_SYSCubeID cid);
+    static uint64_t mcClock();
+};
+
+#endif
@@ -74,8 +74,116 @@ void LoadstreamDecoder::write8(uint8_t value)
 
 void LoadstreamDecoder::write16(uint16_t value)
 {
-    write8(value);
-    write8(value >> 8);
+    writeRun(value, 1);
+}
+
+void LoadstreamDecoder::writeRun(uint16_t value, unsigned count)
+{
+    /*
+     * Equivalent to 'count' calls to write16(), but a sector at a time.
+     * Pixels are always word aligned, except in the middle of a P16
+     * pixel, which is written with write8() anyway.
+     */
+
+    const unsigned SECTOR_SIZE = Cube::FlashModel::SECTOR_SIZE;
+    uint8_t low = value;
+    uint8_t high = value >> 8;
+
+    if (flashAddr & 1) {
+        write8(low);
+        write8(high);
+        count--;
+    }
+
+    while (count) {
+        ASSERT(flashAddr < bufferSize);
+
+        // Auto-erase
+        unsigned sectorOffset = flashAddr % SECTOR_SIZE;
+        if (sectorOffset == 0)
+            memset(buffer + flashAddr, 0xFF, SECTOR_SIZE);
+
+        unsigned chunk = MIN(count, (SECTOR_SIZE - sectorOffset) / 2);
+        uint8_t *ptr = buffer + flashAddr;
+        uint8_t *end = ptr + chunk * 2;
+
+        // Endian swap
+        for (; ptr != end; ptr += 2) {
+            ptr[0] &= high;
+            ptr[1] &= low;
+        }
+
+        count -= chunk;
+        flashAddr += chunk * 2;
+        if (flashAddr == bufferSize)
+            flashAddr = 0;
+    }
+}
+
+void LoadstreamDecoder::decode(const uint8_t *bytes, uint32_t count)
+{
+    /*
+     * Equivalent to calling handleByte() on each byte, but opcodes that
+     * arrive whole are handled right here, without going through the state
+     * machine a byte at a time. Anything else, including opcodes that are
+     * split across calls, falls back on handleByte().
+     */
+
+    const uint8_t *end = bytes + count;
+
+    while (bytes != end) {
+        unsigned avail = end - bytes;
+
+        if (state == S_OPCODE) {
+            uint8_t op = bytes[0];
+
+            switch (op & OP_MASK) {
+
+            case OP_LUT1:
+                if (avail >= 3) {
+                    lut[op & 0x0F] = bytes[1] | (bytes[2] << 8);
+                    bytes += 3;
+                    continue;
+                }
+                break;
+
+            case OP_LUT16:
+                if (avail >= 3) {
+                    uint16_t vec = bytes[1] | (bytes[2] << 8);
+                    unsigned len = 3;
+                    for (unsigned v = vec; v; v >>= 1)
+                        len += (v & 1) * 2;
+
+                    if (avail >= len) {
+                        const uint8_t *color = bytes + 3;
+                        for (unsigned i = 0; vec; vec >>= 1, i++)
+                            if (vec & 1) {
+                                lut[i] = color[0] | (color[1] << 8);
+                                color += 2;
+                            }
+                        bytes += len;
+                        continue;
+                    }
+                }
+                break;
+
+            case OP_TILE_P0:
+                // Trivial solid-color tile, no repeats
+                writeRun(lut[op & 0x0F], 64);
+                bytes++;
+                continue;
+
+            case OP_SPECIAL:
+                if (op == OP_NOP) {
+                    bytes++;
+                    continue;
+                }
+                break;
+            }
+        }
+
+        handleByte(*(bytes++));
+    }
 }
 
 void LoadstreamDecoder::handleByte(uint8_t byte)
@@ -96,10 +204,7 @@ void LoadstreamDecoder::handleByte(uint8_t byte)
 
         case OP_TILE_P0: {
             // Trivial solid-color tile, no repeats
-            uint8_t i;
-            uint16_t color = lut[byte & 0x0F];
-            for (i = 0; i < 64; i++)
-                write16(color);
+            writeRun(lut[byte & 0x0F], 64);
             return;
         }
 
@@ -43,11 +43,13 @@ public:
 
     void reset();
     void handleByte(uint8_t b);
+    void decode(const uint8_t *bytes, uint32_t count);
     void setAddress(uint32_t addr);
 
 private:
     void write8(uint8_t value);
     void write16(uint16_t value);
+    void writeRun(uint16_t value, unsigned count);
     
     uint8_t *buffer;
     uint32_t bufferSize;
@@ -25,6 +25,9 @@
  */
  
 #include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
 #include "lua_script.h"
 #include "lua_cube.h"
 #include "lua_system.h"
@@ -33,6 +36,8 @@
 #include "svmmemory.h"
 #include "cubeslots.h"
 #include "ostime.h"
+#include "framecapture.h"
+#include "simevents.h"
 
 const char LuaCube::className[] = "Cube";
 
@@ -40,13 +45,22 @@ Lunar<LuaCube>::RegType LuaCube::methods[] = {
     LUNAR_DECLARE_METHOD(LuaCube, reset),
     LUNAR_DECLARE_METHOD(LuaCube, isDebugging),
     LUNAR_DECLARE_METHOD(LuaCube, lcdFrameCount),
+    LUNAR_DECLARE_METHOD(LuaCube, waitForFrames),
     LUNAR_DECLARE_METHOD(LuaCube, lcdPixelCount),
+    LUNAR_DECLARE_METHOD(LuaCube, counters),
     LUNAR_DECLARE_METHOD(LuaCube, exceptionCount),
     LUNAR_DECLARE_METHOD(LuaCube, getNeighborID),
+    LUNAR_DECLARE_METHOD(LuaCube, setAcceleration),
+    LUNAR_DECLARE_METHOD(LuaCube, setTouch),
     LUNAR_DECLARE_METHOD(LuaCube, getRadioAddress),
     LUNAR_DECLARE_METHOD(LuaCube, handleRadioPacket),
     LUNAR_DECLARE_METHOD(LuaCube, saveScreenshot),
     LUNAR_DECLARE_METHOD(LuaCube, testScreenshot),
+    LUNAR_DECLARE_METHOD(LuaCube, waitForScreenshot),
+    LUNAR_DECLARE_METHOD(LuaCube, captureScreenshot),
+    LUNAR_DECLARE_METHOD(LuaCube, captureFrame),
+    LUNAR_DECLARE_METHOD(LuaCube, lcdHash),
+    LUNAR_DECLARE_METHOD(LuaCube, testHash),
     LUNAR_DECLARE_METHOD(LuaCube, testSetEnabled),
     LUNAR_DECLARE_METHOD(LuaCube, testGetACK),
     LUNAR_DECLARE_METHOD(LuaCube, testWrite),
@@ -62,6 +76,10 @@ Lunar<LuaCube>::RegType LuaCube::methods[] = {
     LUNAR_DECLARE_METHOD(LuaCube, fbPeek),
     LUNAR_DECLARE_METHOD(LuaCube, nbPoke),
     LUNAR_DECLARE_METHOD(LuaCube, nbPeek),
+    LUNAR_DECLARE_METHOD(LuaCube, xRead),
+    LUNAR_DECLARE_METHOD(LuaCube, xWrite),
+    LUNAR_DECLARE_METHOD(LuaCube, fRead),
+    LUNAR_DECLARE_METHOD(LuaCube, fWrite),
     {0,0}
 };
 
@@ -98,12 +116,64 @@ int LuaCube::lcdFrameCount(lua_State *L)
     return 1;
 }
 
+namespace {
+
+    struct FrameCondition : public SimEvents::Condition {
+        Cube::LCD *lcd;
+        uint32_t target;
+        bool test() { return int32_t(lcd->getFrameCount() - target) >= 0; }
+    };
+
+} // end anonymous namespace
+
+int LuaCube::waitForFrames(lua_State *L)
+{
+    /*
+     * Wait until this cube's LCD finishes this many more frames.
+     * Returns true, or false on timeout.
+     */
+
+    FrameCondition cond;
+    cond.lcd = &LuaSystem::sys->cubes[id].lcd;
+    cond.target = cond.lcd->getFrameCount() + luaL_checkinteger(L, 1);
+
+    lua_pushboolean(L, SimEvents::wait(cond, LuaSystem::sys->time.clocks,
+        LuaSystem::vdeadline(L, 2)));
+    return 1;
+}
+
 int LuaCube::lcdPixelCount(lua_State *L)
 {
     lua_pushinteger(L, LuaSystem::sys->cubes[id].lcd.getPixelCount());
     return 1;
 }
 
+int LuaCube::counters(lua_State *L)
+{
+    /*
+     * Takes no arguments. Returns a table with a snapshot of this
+     * cube's free-running hot-path counters.
+     */
+
+    Cube::Hardware::Counters c;
+    LuaSystem::sys->cubes[id].getCounters(c);
+
+    lua_newtable(L);
+
+    lua_pushnumber(L, c.ticks);
+    lua_setfield(L, -2, "ticks");
+    lua_pushnumber(L, c.sbtBlocks);
+    lua_setfield(L, -2, "sbtBlocks");
+    lua_pushnumber(L, c.irqDispatches);
+    lua_setfield(L, -2, "irqDispatches");
+    lua_pushnumber(L, c.flashCycles);
+    lua_setfield(L, -2, "flashCycles");
+    lua_pushnumber(L, c.lcdPixels);
+    lua_setfield(L, -2, "lcdPixels");
+
+    return 1;
+}
+
 int LuaCube::exceptionCount(lua_State *L)
 {
     lua_pushinteger(L, LuaSystem::sys->cubes[id].getExceptionCount());
@@ -116,6 +186,29 @@ int LuaCube::getNeighborID(lua_State *L)
     return 1;
 }
 
+static uint64_t inputClock(lua_State *L, int index)
+{
+    // Optional absolute virtual time, in seconds. Defaults to right now.
+    if (lua_isnoneornil(L, index))
+        return LuaSystem::sys->time.clocks;
+    return luaL_checknumber(L, index) * VirtualTime::HZ;
+}
+
+int LuaCube::setAcceleration(lua_State *L)
+{
+    lua_pushboolean(L, LuaSystem::sys->cubes[id].scheduleAcceleration(
+        inputClock(L, 4), luaL_checknumber(L, 1),
+        luaL_checknumber(L, 2), luaL_checknumber(L, 3)));
+    return 1;
+}
+
+int LuaCube::setTouch(lua_State *L)
+{
+    lua_pushboolean(L, LuaSystem::sys->cubes[id].scheduleTouch(
+        inputClock(L, 2), lua_toboolean(L, 1)));
+    return 1;
+}
+
 int LuaCube::xbPoke(lua_State *L)
 {
     uint8_t *mem = &LuaSystem::sys->cubes[id].cpu.mExtData[0];
@@ -200,6 +293,188 @@ int LuaCube::nbPoke(lua_State *L)
     return 0;
 }
 
+static int readBytes(lua_State *L, const uint8_t *mem, unsigned memSize)
+{
+    unsigned addr = luaL_checkinteger(L, 1);
+    unsigned size = luaL_checkinteger(L, 2);
+
+    if (addr > memSize || size > memSize - addr)
+        return luaL_error(L, "address and/or size out of range");
+
+    lua_pushlstring(L, (const char *) mem + addr, size);
+    return 1;
+}
+
+static int writeBytes(lua_State *L, uint8_t *mem, unsigned memSize)
+{
+    size_t size;
+    unsigned addr = luaL_checkinteger(L, 1);
+    const char *data = luaL_checklstring(L, 2, &size);
+
+    if (addr > memSize || size > memSize - addr)
+        return luaL_error(L, "address and/or size out of range");
+
+    memcpy(mem + addr, data, size);
+    return 0;
+}
+
+int LuaCube::xRead(lua_State *L)
+{
+    return readBytes(L, &LuaSystem::sys->cubes[id].cpu.mExtData[0], XDATA_SIZE);
+}
+
+int LuaCube::xWrite(lua_State *L)
+{
+    return writeBytes(L, &LuaSystem::sys->cubes[id].cpu.mExtData[0], XDATA_SIZE);
+}
+
+int LuaCube::fRead(lua_State *L)
+{
+    uint8_t *mem = (uint8_t*) &LuaSystem::sys->cubes[id].flash.getStorage()->ext;
+    return readBytes(L, mem, Cube::FlashModel::SIZE);
+}
+
+int LuaCube::fWrite(lua_State *L)
+{
+    uint8_t *mem = (uint8_t*) &LuaSystem::sys->cubes[id].flash.getStorage()->ext;
+    return writeBytes(L, mem, Cube::FlashModel::SIZE);
+}
+
+namespace {
+
+    /*
+     * Reference screenshots, decoded once to RGB565 and kept by filename.
+     * Tests tend to compare against the same images over and over.
+     */
+    typedef std::map<std::string, std::vector<uint16_t> > ScreenshotCache;
+    ScreenshotCache screenshotCache;
+
+    struct ScreenRect {
+        unsigned x, y, w, h;
+    };
+
+    struct ScreenMismatch {
+        unsigned x, y;
+        RGB565 lcdColor, refColor;
+        int error;
+
+        int push(lua_State *L) {
+            // Return (x, y, lcdPixel, refPixel, error)
+            lua_pushinteger(L, x);
+            lua_pushinteger(L, y);
+            lua_pushinteger(L, lcdColor.value);
+            lua_pushinteger(L, refColor.value);
+            lua_pushinteger(L, error);
+            return 5;
+        }
+    };
+
+    const uint16_t *loadReference(lua_State *L, const char *filename)
+    {
+        ScreenshotCache::iterator I = screenshotCache.find(filename);
+        if (I != screenshotCache.end())
+            return &I->second[0];
+
+        std::vector<uint8_t> pngData;
+        std::vector<uint8_t> pixels;
+        LodePNG::Decoder decoder;
+
+        LodePNG::loadFile(pngData, filename);
+        if (!pngData.empty())
+            decoder.decode(pixels, pngData);
+
+        if (pixels.empty() || decoder.getWidth() != Cube::LCD::WIDTH
+            || decoder.getHeight() != Cube::LCD::HEIGHT) {
+            lua_pushfstring(L, "error loading PNG file \"%s\"", filename);
+            lua_error(L);
+        }
+
+        std::vector<uint16_t> &ref = screenshotCache[filename];
+        ref.resize(Cube::LCD::FB_SIZE);
+        for (unsigned i = 0; i < Cube::LCD::FB_SIZE; i++)
+            ref[i] = RGB565(&pixels[i*4]).value;
+
+        return &ref[0];
+    }
+
+    void getScreenRect(lua_State *L, int index, ScreenRect &r)
+    {
+        // Optional (x, y, width, height) arguments. Default is the whole LCD.
+
+        r.x = luaL_optinteger(L, index, 0);
+        r.y = luaL_optinteger(L, index + 1, 0);
+        r.w = luaL_optinteger(L, index + 2, Cube::LCD::WIDTH - r.x);
+        r.h = luaL_optinteger(L, index + 3, Cube::LCD::HEIGHT - r.y);
+
+        if (r.x > Cube::LCD::WIDTH || r.w > Cube::LCD::WIDTH - r.x ||
+            r.y > Cube::LCD::HEIGHT || r.h > Cube::LCD::HEIGHT - r.y)
+            luaL_error(L, "screen region is out of range");
+    }
+
+    bool compareScreen(const uint16_t *fb, const uint16_t *ref,
+        const ScreenRect &r, int tolerance, ScreenMismatch &m)
+    {
+        /*
+         * Identical rows are the common case, and memcmp() is about as
+         * fast as a vectorized compare gets. Only rows that differ get
+         * the per-pixel error calculation.
+         */
+
+        for (unsigned y = r.y; y < r.y + r.h; ++y) {
+            const uint16_t *fbRow = fb + y * Cube::LCD::WIDTH;
+            const uint16_t *refRow = ref + y * Cube::LCD::WIDTH;
+
+            if (!memcmp(fbRow + r.x, refRow + r.x, r.w * sizeof(uint16_t)))
+                continue;
+
+            for (unsigned x = r.x; x < r.x + r.w; ++x) {
+                if (fbRow[x] == refRow[x])
+                    continue;
+
+                RGB565 fbColor = fbRow[x];
+                RGB565 refColor = refRow[x];
+
+                int dR = int(fbColor.red()) - int(refColor.red());
+                int dG = int(fbColor.green()) - int(refColor.green());
+                int dB = int(fbColor.blue()) - int(refColor.blue());
+                int error = dR*dR + dG*dG + dB*dB;
+
+                if (error > tolerance) {
+                    m.x = x;
+                    m.y = y;
+                    m.lcdColor = fbColor;
+                    m.refColor = refColor;
+                    m.error = error;
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    struct ScreenCondition : public SimEvents::Condition {
+        Cube::LCD *lcd;
+        const uint16_t *ref;
+        ScreenRect rect;
+        int tolerance;
+        bool compared;
+        uint32_t lastFrame;
+        ScreenMismatch mismatch;
+
+        bool test() {
+            // Only bother comparing once per completed LCD frame
+            uint32_t frame = lcd->getFrameCount();
+            if (compared && frame == lastFrame)
+                return false;
+            compared = true;
+            lastFrame = frame;
+            return compareScreen(lcd->fb_mem, ref, rect, tolerance, mismatch);
+        }
+    };
+
+} // end anonymous namespace
+
 int LuaCube::saveScreenshot(lua_State *L)
 {    
     const char *filename = luaL_checkstring(L, 1);
@@ -219,6 +494,7 @@ int LuaCube::saveScreenshot(lua_State *L)
     encoder.encode(pngData, pixels, lcd.WIDTH, lcd.HEIGHT);
     
     LodePNG::saveFile(pngData, filename);
+    screenshotCache.erase(filename);
     
     return 0;
 }
@@ -228,40 +504,112 @@ int LuaCube::testScreenshot(lua_State *L)
     const char *filename = luaL_checkstring(L, 1);
     const lua_Integer tolerance = lua_tointeger(L, 2);
 
+    ScreenRect rect;
+    getScreenRect(L, 3, rect);
+
+    const uint16_t *ref = loadReference(L, filename);
+    ScreenMismatch mismatch;
+
+    if (compareScreen(LuaSystem::sys->cubes[id].lcd.fb_mem, ref, rect, tolerance, mismatch))
+        return 0;
+    return mismatch.push(L);
+}
+
+int LuaCube::waitForScreenshot(lua_State *L)
+{
+    /*
+     * Like testScreenshot, but waits (with an optional virtual-time
+     * timeout) until the LCD matches. Returns the last mismatch on timeout.
+     */
+
+    ScreenCondition cond;
+    const char *filename = luaL_checkstring(L, 1);
+    cond.tolerance = lua_tointeger(L, 2);
+    uint64_t deadline = LuaSystem::vdeadline(L, 3);
+    getScreenRect(L, 4, cond.rect);
+
+    cond.ref = loadReference(L, filename);
+    cond.lcd = &LuaSystem::sys->cubes[id].lcd;
+    cond.compared = false;
+
+    if (SimEvents::wait(cond, LuaSystem::sys->time.clocks, deadline))
+        return 0;
+
+    // Timed out. Make sure the mismatch is current.
+    if (compareScreen(cond.lcd->fb_mem, cond.ref, cond.rect, cond.tolerance, cond.mismatch))
+        return 0;
+    return cond.mismatch.push(L);
+}
+
+int LuaCube::captureScreenshot(lua_State *L)
+{
+    // Like saveScreenshot, but the PNG is written in the background
+    const char *filename = luaL_checkstring(L, 1);
+    FrameCapture::savePNG(LuaSystem::sys->cubes[id].lcd.fb_mem, filename);
+    screenshotCache.erase(filename);
+    return 0;
+}
+
+int LuaCube::captureFrame(lua_State *L)
+{
     Cube::LCD &lcd = LuaSystem::sys->cubes[id].lcd;
-    std::vector<uint8_t> pngData;
-    std::vector<uint8_t> pixels;
-    LodePNG::Decoder decoder;
-    
-    LodePNG::loadFile(pngData, filename);
-    if (!pngData.empty())
-        decoder.decode(pixels, pngData);
-    
-    if (pixels.empty()) {
-        lua_pushfstring(L, "error loading PNG file \"%s\"", filename);
+
+    if (!FrameCapture::isStreamOpen()) {
+        lua_pushfstring(L, "no frame capture stream is open");
         lua_error(L);
     }
-    
-    for (unsigned i = 0; i < lcd.FB_SIZE; i++) {
-        RGB565 fbColor = lcd.fb_mem[i];
-        RGB565 refColor = &pixels[i*4];
-
-        int dR = int(fbColor.red()) - int(refColor.red());
-        int dG = int(fbColor.green()) - int(refColor.green());
-        int dB = int(fbColor.blue()) - int(refColor.blue());
-        int error = dR*dR + dG*dG + dB*dB;
-
-        if (error > tolerance) {
-            // Image mismatch. Return (x, y, lcdPixel, refPixel, error)
-            lua_pushinteger(L, i % lcd.WIDTH);
-            lua_pushinteger(L, i / lcd.WIDTH);
-            lua_pushinteger(L, fbColor.value);
-            lua_pushinteger(L, refColor.value);
-            lua_pushinteger(L, error);
-            return 5;
+
+    FrameCapture::streamFrame(lcd.fb_mem, id, lcd.getFrameCount());
+    return 0;
+}
+
+int LuaCube::lcdHash(lua_State *L)
+{
+    // Perceptual hash of the current LCD contents, as a hex string
+    uint64_t hash = FrameCapture::perceptualHash(LuaSystem::sys->cubes[id].lcd.fb_mem);
+
+    char buf[20];
+    snprintf(buf, sizeof buf, "%08x%08x", unsigned(hash >> 32), unsigned(hash));
+    lua_pushstring(L, buf);
+    return 1;
+}
+
+int LuaCube::testHash(lua_State *L)
+{
+    /*
+     * Compare the LCD with a hash from lcdHash(). Returns nothing if
+     * they differ by at most 'tolerance' bits, otherwise returns the
+     * number of differing bits.
+     */
+
+    const char *refString = luaL_checkstring(L, 1);
+    const lua_Integer tolerance = lua_tointeger(L, 2);
+
+    uint64_t ref = 0;
+    for (const char *p = refString; *p; p++) {
+        unsigned digit;
+        if (*p >= '0' && *p <= '9')
+            digit = *p - '0';
+        else if (*p >= 'a' && *p <= 'f')
+            digit = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F')
+            digit = *p - 'A' + 10;
+        else {
+            lua_pushfstring(L, "invalid hash \"%s\"", refString);
+            lua_error(L);
+            return 0;
         }
+        ref = (ref << 4) | digit;
     }
-    
+
+    uint64_t hash = FrameCapture::perceptualHash(LuaSystem::sys->cubes[id].lcd.fb_mem);
+    unsigned distance = FrameCapture::hashDistance(hash, ref);
+
+    if (distance > tolerance) {
+        lua_pushinteger(L, distance);
+        return 1;
+    }
+
     return 0;
 }
 
@@ -42,9 +42,13 @@ private:
     int reset(lua_State *L);
     int isDebugging(lua_State *L);
     int lcdFrameCount(lua_State *L);
+    int waitForFrames(lua_State *L);
     int lcdPixelCount(lua_State *L);
+    int counters(lua_State *L);
     int exceptionCount(lua_State *L);
     int getNeighborID(lua_State *L);
+    int setAcceleration(lua_State *L);
+    int setTouch(lua_State *L);
 
     /*
      * Radio
@@ -64,6 +68,18 @@ private:
      
     int saveScreenshot(lua_State *L);
     int testScreenshot(lua_State *L);
+    int waitForScreenshot(lua_State *L);
+
+    /*
+     * Asynchronous frame capture. PNGs and raw frame streams are
+     * written by a background thread. The perceptual hash is a quick
+     * way to test for near-matches without any PNG at all.
+     */
+
+    int captureScreenshot(lua_State *L);
+    int captureFrame(lua_State *L);
+    int lcdHash(lua_State *L);
+    int testHash(lua_State *L);
 
     /*
      * Factory test interface
@@ -101,6 +117,16 @@ private:
     // nvm
     int nbPoke(lua_State *L);
     int nbPeek(lua_State *L);
+
+    /*
+     * Bulk access to xram and flash, as Lua strings.
+     * (address, length) -> data, and (address, data).
+     */
+
+    int xRead(lua_State *L);
+    int xWrite(lua_State *L);
+    int fRead(lua_State *L);
+    int fWrite(lua_State *L);
 };
 
 #endif
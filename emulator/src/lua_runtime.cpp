@@ -30,6 +30,7 @@
 #include "svmruntime.h"
 #include "svmloader.h"
 #include "svmdebugpipe.h"
+#include <string.h>
 
 const char LuaRuntime::className[] = "Runtime";
 const char LuaRuntime::callbackHostField[] = "__runtime_callbackHost";
@@ -40,6 +41,8 @@ Lunar<LuaRuntime>::RegType LuaRuntime::methods[] = {
     LUNAR_DECLARE_METHOD(LuaRuntime, formatAddress),
     LUNAR_DECLARE_METHOD(LuaRuntime, poke),
     LUNAR_DECLARE_METHOD(LuaRuntime, peek),
+    LUNAR_DECLARE_METHOD(LuaRuntime, read),
+    LUNAR_DECLARE_METHOD(LuaRuntime, write),
     LUNAR_DECLARE_METHOD(LuaRuntime, getPC),
     LUNAR_DECLARE_METHOD(LuaRuntime, getSP),
     LUNAR_DECLARE_METHOD(LuaRuntime, getFP),
@@ -156,6 +159,47 @@ int LuaRuntime::peek(lua_State *L)
     return 1;
 }
 
+int LuaRuntime::read(lua_State *L)
+{
+    /*
+     * Bulk RAM read. (address, size) -> (data)
+     */
+
+    SvmMemory::VirtAddr va = luaL_checkinteger(L, 1);
+    uint32_t size = luaL_checkinteger(L, 2);
+    SvmMemory::PhysAddr pa;
+
+    if (!SvmMemory::mapRAM(va, size, pa)) {
+        lua_pushfstring(L, "invalid RAM address");
+        lua_error(L);
+        return 0;
+    }
+
+    lua_pushlstring(L, (const char *) pa, size);
+    return 1;
+}
+
+int LuaRuntime::write(lua_State *L)
+{
+    /*
+     * Bulk RAM write. (address, data)
+     */
+
+    size_t size;
+    SvmMemory::VirtAddr va = luaL_checkinteger(L, 1);
+    const char *data = luaL_checklstring(L, 2, &size);
+    SvmMemory::PhysAddr pa;
+
+    if (!SvmMemory::mapRAM(va, size, pa)) {
+        lua_pushfstring(L, "invalid RAM address");
+        lua_error(L);
+        return 0;
+    }
+
+    memcpy(pa, data, size);
+    return 0;
+}
+
 int LuaRuntime::getPC(lua_State *L)
 {
     lua_pushinteger(L, SvmRuntime::reconstructCodeAddr(SvmCpu::reg(REG_PC)));
@@ -50,6 +50,8 @@ private:
 
     int poke(lua_State *L);
     int peek(lua_State *L);
+    int read(lua_State *L);
+    int write(lua_State *L);
 
     int getPC(lua_State *L);
     int getSP(lua_State *L);
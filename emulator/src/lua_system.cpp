@@ -28,6 +28,12 @@
 #include "lua_system.h"
 #include "ostime.h"
 #include "assetloader.h"
+#include "framecapture.h"
+#include "simevents.h"
+#include "svmcpu.h"
+#include "flash_blockcache.h"
+#include "system_mc.h"
+#include "latencytracer.h"
 
 System *LuaSystem::sys = NULL;
 const char LuaSystem::className[] = "System";
@@ -39,11 +45,25 @@ Lunar<LuaSystem>::RegType LuaSystem::methods[] = {
     LUNAR_DECLARE_METHOD(LuaSystem, exit),
     LUNAR_DECLARE_METHOD(LuaSystem, setOptions),
     LUNAR_DECLARE_METHOD(LuaSystem, setTraceMode),
+    LUNAR_DECLARE_METHOD(LuaSystem, traceTrigger),
+    LUNAR_DECLARE_METHOD(LuaSystem, captureOpen),
+    LUNAR_DECLARE_METHOD(LuaSystem, captureClose),
+    LUNAR_DECLARE_METHOD(LuaSystem, captureFlush),
     LUNAR_DECLARE_METHOD(LuaSystem, setAssetLoaderBypass),
     LUNAR_DECLARE_METHOD(LuaSystem, vclock),
+    LUNAR_DECLARE_METHOD(LuaSystem, timing),
+    LUNAR_DECLARE_METHOD(LuaSystem, counters),
+    LUNAR_DECLARE_METHOD(LuaSystem, setLatencyTrace),
+    LUNAR_DECLARE_METHOD(LuaSystem, latency),
     LUNAR_DECLARE_METHOD(LuaSystem, vsleep),
+    LUNAR_DECLARE_METHOD(LuaSystem, vsleepUntil),
+    LUNAR_DECLARE_METHOD(LuaSystem, waitForLog),
+    LUNAR_DECLARE_METHOD(LuaSystem, waitForRadioAcks),
     LUNAR_DECLARE_METHOD(LuaSystem, sleep),
     LUNAR_DECLARE_METHOD(LuaSystem, numCubes),
+    LUNAR_DECLARE_METHOD(LuaSystem, crc32),
+    LUNAR_DECLARE_METHOD(LuaSystem, saveSnapshot),
+    LUNAR_DECLARE_METHOD(LuaSystem, restoreSnapshot),
     {0,0}
 };
 
@@ -76,6 +96,9 @@ int LuaSystem::setOptions(lua_State *L)
     if (LuaScript::argMatch(L, "cube0Profile"))
         sys->opt_cube0Profile = lua_tostring(L, -1);
 
+    if (LuaScript::argMatch(L, "svmProfile"))
+        sys->opt_svmProfile = lua_tostring(L, -1);
+
     if (LuaScript::argMatch(L, "paintTrace"))
         sys->opt_paintTrace = lua_toboolean(L, -1);
 
@@ -106,12 +129,109 @@ int LuaSystem::numCubes(lua_State *L)
     return 1;
 }
 
+int LuaSystem::crc32(lua_State *L)
+{
+    /*
+     * Standard (zlib-compatible) CRC-32 of a string, computed natively.
+     * Takes an optional previous CRC, to continue a running checksum.
+     * We can't borrow the firmware's Crc32, since the MC owns it.
+     */
+
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (unsigned n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (unsigned k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+
+    size_t size;
+    const uint8_t *data = (const uint8_t *) luaL_checklstring(L, 1, &size);
+    uint32_t crc = ~uint32_t(luaL_optnumber(L, 2, 0));
+
+    while (size--)
+        crc = table[(crc ^ *(data++)) & 0xff] ^ (crc >> 8);
+
+    // As a number, so the result is never negative
+    lua_pushnumber(L, uint32_t(~crc));
+    return 1;
+}
+
+int LuaSystem::saveSnapshot(lua_State *L)
+{
+    /*
+     * Save the cube and flash state to a file. Meant to be called once,
+     * after a test suite has booted and paired its cubes.
+     */
+
+    const char *filename = luaL_checkstring(L, 1);
+    if (!sys->saveSnapshot(filename)) {
+        lua_pushfstring(L, "failed to save snapshot '%s'", filename);
+        lua_error(L);
+    }
+    return 0;
+}
+
+int LuaSystem::restoreSnapshot(lua_State *L)
+{
+    /*
+     * Restore state saved by saveSnapshot(). The cubes pick up right
+     * where they left off, and the master reboots from restored flash.
+     */
+
+    const char *filename = luaL_checkstring(L, 1);
+    if (!sys->restoreSnapshot(filename)) {
+        lua_pushfstring(L, "failed to restore snapshot '%s'", filename);
+        lua_error(L);
+    }
+    return 0;
+}
+
 int LuaSystem::setTraceMode(lua_State *L)
 {
     sys->tracer.setEnabled(lua_toboolean(L, 1));
     return 0;
 }
 
+int LuaSystem::traceTrigger(lua_State *L)
+{
+    /*
+     * Dump the flight recorder trace (-Q), if it's enabled.
+     * Takes an optional string describing the reason.
+     */
+
+    Tracer::trigger(lua_isstring(L, 1) ? lua_tostring(L, 1) : "Lua");
+    return 0;
+}
+
+int LuaSystem::captureOpen(lua_State *L)
+{
+    // Start a raw frame stream, for Cube:captureFrame()
+    const char *filename = luaL_checkstring(L, 1);
+
+    if (!FrameCapture::openStream(filename)) {
+        lua_pushfstring(L, "error opening frame capture stream \"%s\"", filename);
+        lua_error(L);
+    }
+
+    return 0;
+}
+
+int LuaSystem::captureClose(lua_State *L)
+{
+    FrameCapture::closeStream();
+    return 0;
+}
+
+int LuaSystem::captureFlush(lua_State *L)
+{
+    // Wait for all captured screenshots and frames to be written
+    FrameCapture::flush();
+    return 0;
+}
+
 int LuaSystem::setAssetLoaderBypass(lua_State *L)
 {
     AssetLoader::simBypass = lua_toboolean(L, 1);
@@ -127,27 +247,196 @@ int LuaSystem::vclock(lua_State *L)
     return 1;
 }
 
+int LuaSystem::timing(lua_State *L)
+{
+    /*
+     * Return the time governor's drift, lag, host speed, and timestep.
+     * All times are in seconds.
+     */
+
+    const TimeGovernor &gov = sys->getTimeGovernor();
+    lua_pushnumber(L, gov.getDrift());
+    lua_pushnumber(L, gov.getLag());
+    lua_pushnumber(L, gov.getHostSpeed());
+    lua_pushnumber(L, sys->time.getTimestepUS() * 1e-6);
+    return 4;
+}
+
+int LuaSystem::counters(lua_State *L)
+{
+    /*
+     * Takes no arguments. Returns a table with a snapshot of the base's
+     * free-running counters, for benchmarks. Like Cube:counters(), take
+     * the difference between two snapshots.
+     */
+
+    uint64_t accesses, misses;
+    FlashBlock::getTotals(accesses, misses);
+
+    lua_newtable(L);
+
+    lua_pushnumber(L, SvmCpu::instructionCount());
+    lua_setfield(L, -2, "svmInstructions");
+    lua_pushnumber(L, accesses);
+    lua_setfield(L, -2, "cacheAccesses");
+    lua_pushnumber(L, misses);
+    lua_setfield(L, -2, "cacheMisses");
+    lua_pushnumber(L, SimEvents::radioAckCount());
+    lua_setfield(L, -2, "radioAcks");
+    lua_pushnumber(L, SystemMC::audioUnderrunCount());
+    lua_setfield(L, -2, "audioUnderruns");
+
+    return 1;
+}
+
+int LuaSystem::setLatencyTrace(lua_State *L)
+{
+    // Start tracing input-to-LCD latency from scratch, or stop tracing
+    if (lua_toboolean(L, 1))
+        LatencyTracer::start(sys);
+    else
+        LatencyTracer::stop();
+    return 0;
+}
+
+int LuaSystem::latency(lua_State *L)
+{
+    /*
+     * Takes no arguments. Returns a table summarizing the inputs traced
+     * since setLatencyTrace(true): 'completed' and 'dropped' counts, 'min'
+     * and 'max' total latency, a 'stages' table with the mean time spent
+     * reaching each stage, and a 'histogram' array counting total latency
+     * in steps of 'bucket'. The last bucket also counts anything longer.
+     * All times are in seconds.
+     */
+
+    LatencyTracer::Stats s;
+    LatencyTracer::getStats(s);
+
+    lua_newtable(L);
+
+    lua_pushnumber(L, s.completed);
+    lua_setfield(L, -2, "completed");
+    lua_pushnumber(L, s.dropped);
+    lua_setfield(L, -2, "dropped");
+    lua_pushnumber(L, s.completed ? VirtualTime::toSeconds(s.minTicks) : 0);
+    lua_setfield(L, -2, "min");
+    lua_pushnumber(L, VirtualTime::toSeconds(s.maxTicks));
+    lua_setfield(L, -2, "max");
+    lua_pushnumber(L, LatencyTracer::BUCKET_MS * 1e-3);
+    lua_setfield(L, -2, "bucket");
+
+    lua_newtable(L);
+    for (unsigned i = LatencyTracer::Ack; i < LatencyTracer::NUM_STAGES; ++i) {
+        lua_pushnumber(L, s.completed ?
+            VirtualTime::toSeconds(s.stageTicks[i]) / s.completed : 0);
+        lua_setfield(L, -2, LatencyTracer::stageName(i));
+    }
+    lua_setfield(L, -2, "stages");
+
+    lua_newtable(L);
+    for (unsigned i = 0; i < LatencyTracer::NUM_BUCKETS; ++i) {
+        lua_pushnumber(L, s.histogram[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "histogram");
+
+    return 1;
+}
+
 int LuaSystem::sleep(lua_State *L)
 {
     OSTime::sleep(luaL_checknumber(L, 1));
     return 0;
 }
     
+namespace {
+
+    struct NeverCondition : public SimEvents::Condition {
+        bool test() { return false; }
+    };
+
+    struct LogCondition : public SimEvents::Condition {
+        uint32_t seq;
+        const char *substr;
+        std::string line;
+        bool test() { return SimEvents::findLog(seq, substr, line); }
+    };
+
+    struct AckCondition : public SimEvents::Condition {
+        uint32_t target;
+        bool test() { return int32_t(SimEvents::radioAckCount() - target) >= 0; }
+    };
+
+} // end anonymous namespace
+
+uint64_t LuaSystem::vdeadline(lua_State *L, int index)
+{
+    /*
+     * Optional virtual-time timeout argument, in seconds from now.
+     * Returns an absolute clock value, or "never" if omitted.
+     */
+
+    if (lua_isnoneornil(L, index))
+        return uint64_t(-1);
+    return sys->time.clocks + luaL_checknumber(L, index) * VirtualTime::HZ;
+}
+
 int LuaSystem::vsleep(lua_State *L)
 {
     /*
-     * Sleep, in virtual time
+     * Sleep, in virtual time. We wake up as the cube thread passes our
+     * deadline, rather than polling the clock in real time.
      */
 
-    double deadline = sys->time.elapsedSeconds() + luaL_checknumber(L, 1);
-    double remaining;
-    
-    while ((remaining = deadline - sys->time.elapsedSeconds()) > 0)
-        OSTime::sleep(remaining * 0.1);
+    NeverCondition never;
+    SimEvents::wait(never, sys->time.clocks, vdeadline(L, 1));
+    return 0;
+}
 
+int LuaSystem::vsleepUntil(lua_State *L)
+{
+    /*
+     * Sleep until an absolute virtual time, in seconds (as from vclock)
+     */
+
+    NeverCondition never;
+    SimEvents::wait(never, sys->time.clocks, luaL_checknumber(L, 1) * VirtualTime::HZ);
     return 0;
 }
 
+int LuaSystem::waitForLog(lua_State *L)
+{
+    /*
+     * Wait for a log line containing the given string, logged after
+     * we were called. Returns the whole line, or nil on timeout.
+     */
+
+    LogCondition cond;
+    cond.substr = luaL_checkstring(L, 1);
+    cond.seq = SimEvents::logSequence();
+
+    if (!SimEvents::wait(cond, sys->time.clocks, vdeadline(L, 2)))
+        return 0;
+
+    lua_pushstring(L, cond.line.c_str());
+    return 1;
+}
+
+int LuaSystem::waitForRadioAcks(lua_State *L)
+{
+    /*
+     * Wait for this many more radio packets to be ACKed by any cube.
+     * Returns true, or false on timeout.
+     */
+
+    AckCondition cond;
+    cond.target = SimEvents::radioAckCount() + luaL_checkinteger(L, 1);
+
+    lua_pushboolean(L, SimEvents::wait(cond, sys->time.clocks, vdeadline(L, 2)));
+    return 1;
+}
+
 int LuaSystem::init(lua_State *L)
 {
     /*
@@ -37,6 +37,9 @@ public:
 
     LuaSystem(lua_State *L);
     static System *sys;
+
+    /// Optional timeout argument, as an absolute virtual clock deadline
+    static uint64_t vdeadline(lua_State *L, int index);
     
 private:
     int init(lua_State *L);
@@ -45,12 +48,27 @@ private:
     
     int setOptions(lua_State *L);
     int setTraceMode(lua_State *L);
+    int traceTrigger(lua_State *L);
+    int captureOpen(lua_State *L);
+    int captureClose(lua_State *L);
+    int captureFlush(lua_State *L);
     int setAssetLoaderBypass(lua_State *L);
 
     int numCubes(lua_State *L);
+    int crc32(lua_State *L);
+
+    int saveSnapshot(lua_State *L);
+    int restoreSnapshot(lua_State *L);
 
     int vclock(lua_State *L);
+    int timing(lua_State *L);
+    int counters(lua_State *L);
+    int setLatencyTrace(lua_State *L);
+    int latency(lua_State *L);
     int vsleep(lua_State *L);
+    int vsleepUntil(lua_State *L);
+    int waitForLog(lua_State *L);
+    int waitForRadioAcks(lua_State *L);
     int sleep(lua_State *L);
 };
 
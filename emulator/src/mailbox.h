@@ -0,0 +1,136 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Lock-free handoffs between exactly one producer thread and one
+ * consumer thread.
+ *
+ * TripleBuffer hands over the latest value of some state.
+ *
+ * Neither side ever waits. The producer always has a private buffer to
+ * fill, and publish() swaps it with the shared middle buffer. The consumer
+ * swaps its own buffer with the middle one only when something new was
+ * published. Intermediate values may be skipped, but the consumer always
+ * sees a complete one.
+ */
+
+#ifndef _MAILBOX_H
+#define _MAILBOX_H
+
+#include <stdint.h>
+
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : state(1), writeIndex(0), readIndex(2) {
+        for (unsigned i = 0; i < 3; i++)
+            buffers[i] = T();
+    }
+
+    /// Producer only: the buffer to fill before publish()
+    T &write() {
+        return buffers[writeIndex];
+    }
+
+    /// Producer only: make the write() buffer visible to the consumer
+    void publish() {
+        __sync_synchronize();
+        uint32_t prev = __sync_lock_test_and_set(&state, writeIndex | FRESH);
+        writeIndex = prev & INDEX_MASK;
+    }
+
+    /// Consumer only: pick up the latest published buffer, if any
+    bool consume() {
+        if (!(state & FRESH))
+            return false;
+        uint32_t prev = __sync_lock_test_and_set(&state, readIndex);
+        readIndex = prev & INDEX_MASK;
+        __sync_synchronize();
+        return true;
+    }
+
+    /// Consumer only: the buffer most recently picked up by consume()
+    const T &read() const {
+        return buffers[readIndex];
+    }
+
+private:
+    static const uint32_t INDEX_MASK = 3;
+    static const uint32_t FRESH = 4;
+
+    // Index of the middle buffer, plus the FRESH flag
+    volatile uint32_t state;
+
+    uint8_t writeIndex;
+    uint8_t readIndex;
+    T buffers[3];
+};
+
+
+/*
+ * SPSCQueue hands over every item, in order. Nothing is ever skipped or
+ * overwritten; push() fails if the consumer has fallen 'tSize' items
+ * behind.
+ */
+
+template <typename T, unsigned tSize>
+class SPSCQueue {
+public:
+    SPSCQueue() : head(0), tail(0) {}
+
+    /// Producer only: append an item. Returns false if the queue is full.
+    bool push(const T &item) {
+        uint32_t t = tail;
+        if (t - head == tSize)
+            return false;
+        items[t % tSize] = item;
+        __sync_synchronize();
+        tail = t + 1;
+        return true;
+    }
+
+    /// Consumer only: the oldest item, or NULL if the queue is empty
+    const T *peek() const {
+        if (head == tail)
+            return 0;
+        __sync_synchronize();
+        return &items[head % tSize];
+    }
+
+    /// Consumer only: discard the item returned by peek()
+    void pop() {
+        __sync_synchronize();
+        head = head + 1;
+    }
+
+private:
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    T items[tSize];
+};
+
+#endif
@@ -43,8 +43,10 @@
 
 #include "frontend.h"
 #include "system.h"
+#include "audiobench.h"
 #include "ostime.h"
 #include "lua_script.h"
+#include "testserver.h"
 
 
 static void message(const char *fmt, ...);
@@ -61,6 +63,8 @@ static void usage()
      *  -d                Launch firmware debugger (first cube only)
      *  -c                Continue executing on exception, rather than stopping the debugger.
      *  -R                Cube trace enabled at startup.
+     *  -B                Write cube traces in binary, to trace.bin
+     *  -Q                Keep a flight recorder trace, dumped on exceptions and faults
      */
 
     message("\n"
@@ -77,16 +81,32 @@ static void usage()
             "  -e SCRIPT.lua         Execute a Lua script instead of the default frontend\n"
             "  -l LAUNCHER.elf       Start the supplied binary as the system launcher\n"
             "\n"
+            "  --audio-bench         Time the firmware's audio mixer and tracker, and exit\n"
+            "  --bluetooth PORT      Emulate a Bluetooth LE link, bridged to a TCP port\n"
+            "  --bluetooth-log FILE  Log per-packet Bluetooth timing to FILE, as CSV\n"
+            "  --cube-threads=NUM    Simulate cubes on NUM threads (default 1)\n"
+            "  --fast-peripherals    Skip cube flash and sensor bus delays, for faster tests\n"
+            "  --flash-cow           Map the -F file copy-on-write, never modifying it\n"
+            "  --flash-compress      Like --flash-sparse, also zlib-compressing the file\n"
+            "  --flash-delta FILE    With --flash-cow, save modified pages to FILE on exit\n"
+            "  --flash-sparse        Save the -F file in sparse format, skipping blank space\n"
             "  --headless            Run without graphics or sound output\n"
+            "  --latency             Trace input-to-LCD latency, and report it on exit\n"
             "  --lock-rotation       Lock rotation by default\n"
+            "  --metrics PORT        Serve Prometheus-style metrics over HTTP on a TCP port\n"
             "  --mute                Mute the Base's volume control by default\n"
             "  --paint-trace         Trace the state of the repaint controller\n"
             "  --radio-trace         Trace all radio packet contents\n"
             "  --radio-noise FLOAT   Simulated radio noise, arbitrary units.\n"     
+            "  --record FILE         Log all cube, button, and Bluetooth inputs to FILE\n"
+            "  --replay FILE         Replay inputs from a --record log, then exit\n"
+            "  --server PORT         Stay resident, running test jobs sent to a TCP port\n"
             "  --stdout FILENAME     Redirect output to FILENAME\n"
             "  --svm-trace           Trace SVM instruction execution\n"
             "  --svm-stack           Monitor SVM stack usage\n"
             "  --svm-flash-stats     Dump statistics about flash memory usage\n"
+            "  --svm-profile FILE    Write a sampling profile of SVM code to FILE\n"
+            "  --svm-translate       Run SVM code as translated basic blocks (faster)\n"
             "  --waveout FILE.wav    Log all audio output to LOG.wav\n"
             "  --white-bg            Force the UI to use a plain white background\n"
             "  --window WxH          Initial window size (default 800x600)\n"
@@ -101,6 +121,11 @@ static void usage()
             APP_COPYRIGHT_ASCII "\n");
 }
 
+static void reportAudioBench(const AudioBench::Result &r)
+{
+    printf("%-18s %8.2f us each\n", r.name, r.nsPerBlock() / 1000.0);
+}
+
 static void getConsole()
 {
     /*
@@ -206,10 +231,26 @@ static int runScript(System &sys, const char *file)
     return result;
 }
 
+static int runServer(System &sys, int port)
+{
+    // No frontend at all; jobs come from TestServer
+    sys.opt_headless = true;
+
+    if (!sys.init()) {
+        message("Emulator failed to initialize");
+        return 1;
+    }
+
+    int result = TestServer::run(sys, port);
+    sys.exit();
+    return result;
+}
+
 int main(int argc, char **argv)
 {
     System& sys = System::getInstance();
     const char *scriptFile = NULL;
+    int serverPort = 0;
 
     // Attach an existing console, if it's already handy
     getConsole();
@@ -249,6 +290,21 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "-B")) {
+            sys.opt_traceBinary = true;
+            continue;
+        }
+
+        if (!strcmp(arg, "-Q")) {
+            sys.opt_traceFlightRecorder = true;
+            continue;
+        }
+
+        if (!strcmp(arg, "--fast-peripherals")) {
+            sys.opt_fastPeripherals = true;
+            continue;
+        }
+
         if (!strcmp(arg, "--lock-rotation")) {
             sys.opt_lockRotationByDefault = true;
             continue;
@@ -269,6 +325,17 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "--svm-profile") && argv[c+1]) {
+            sys.opt_svmProfile = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--svm-translate")) {
+            sys.opt_svmTranslate = true;
+            continue;
+        }
+
         if (!strcmp(arg, "--radio-trace")) {
             sys.opt_radioTrace = true;
             continue;
@@ -278,12 +345,43 @@ int main(int argc, char **argv)
             sys.opt_paintTrace = true;
             continue;
         }
+
+        if (!strcmp(arg, "--latency")) {
+            sys.opt_latencyTrace = true;
+            continue;
+        }
         
+        if (!strcmp(arg, "--audio-bench")) {
+            AudioBench::run(reportAudioBench);
+            return 0;
+        }
+
         if (!strcmp(arg, "--headless")) {
             sys.opt_headless = true;
             continue;
         }
 
+        if (!strcmp(arg, "--flash-cow")) {
+            sys.opt_flashCopyOnWrite = true;
+            continue;
+        }
+
+        if (!strcmp(arg, "--flash-sparse")) {
+            sys.opt_flashFormat = FlashStorage::F_SPARSE;
+            continue;
+        }
+
+        if (!strcmp(arg, "--flash-compress")) {
+            sys.opt_flashFormat = FlashStorage::F_SPARSE_COMPRESSED;
+            continue;
+        }
+
+        if (!strcmp(arg, "--flash-delta") && argv[c+1]) {
+            sys.opt_flashDeltaFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
         if (!strcmp(arg, "--white-bg")) {
             sys.opt_whiteBackground = true;
             continue;
@@ -330,6 +428,18 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "--record") && argv[c+1]) {
+            sys.opt_recordFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--replay") && argv[c+1]) {
+            sys.opt_replayFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
         if (!strcmp(arg, "-f") && argv[c+1]) {
             sys.opt_cubeFirmware = argv[c+1];
             c++;
@@ -370,12 +480,45 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strncmp(arg, "--cube-threads=", 15)) {
+            sys.opt_cubeThreads = atoi(arg + 15);
+            if (sys.opt_cubeThreads < 1 || sys.opt_cubeThreads > sys.MAX_CUBES) {
+                message("Error: Unsupported number of cube threads (Minimum 1, maximum %d)", sys.MAX_CUBES);
+                return 1;
+            }
+            continue;
+        }
+
         if (!strcmp(arg, "-P") && argv[c+1]) {
             sys.opt_gdbServerPort = atoi(argv[c+1]);
             c++;
             continue;
         }
 
+        if (!strcmp(arg, "--bluetooth") && argv[c+1]) {
+            sys.opt_bluetoothPort = atoi(argv[c+1]);
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--bluetooth-log") && argv[c+1]) {
+            sys.opt_bluetoothLogFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--metrics") && argv[c+1]) {
+            sys.opt_metricsPort = atoi(argv[c+1]);
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--server") && argv[c+1]) {
+            serverPort = atoi(argv[c+1]);
+            c++;
+            continue;
+        }
+
         if (!strncmp(arg, "-psn_", 5)) {
             // Used by Mac OS app bundles; ignore it.
             continue;
@@ -391,6 +534,14 @@ int main(int argc, char **argv)
         SystemMC::installGame(arg);
     }
 
+    if (!sys.opt_recordFilename.empty() && !sys.opt_replayFilename.empty()) {
+        message("Error: --record and --replay can't be used together");
+        return 1;
+    }
+
+    if (serverPort)
+        return runServer(sys, serverPort);
+
     return scriptFile ? runScript(sys, scriptFile) : run(sys);
 }
 
@@ -77,7 +77,7 @@ bool AssetLoader::loaderBypass(_SYSCubeID id, AssetGroupInfo &group)
      *
      * So, to reuse as much non-simulator code as possible, we'll
      * use AssetFIFO to read this data out of our AssetGroupInfo,
-     * then we'll shuttle data from that FIFO to lsdec.
+     * then we'll shuttle data from that FIFO to lsdec a FIFO-full at a time.
      */
 
     uint32_t offset = 0;
@@ -88,9 +88,13 @@ bool AssetLoader::loaderBypass(_SYSCubeID id, AssetGroupInfo &group)
         offset += AssetFIFO::fetchFromGroup(buffer, group, offset);
 
         AssetFIFO fifo(buffer);
-        while (fifo.readAvailable())
-            lsdec.handleByte(fifo.read());
+        uint8_t bytes[_SYS_ASSETLOAD_BUF_SIZE];
+        unsigned count = fifo.readAvailable();
+        for (unsigned i = 0; i != count; ++i)
+            bytes[i] = fifo.read();
         fifo.commitReads();
+
+        lsdec.decode(bytes, count);
     }
 
     LOG(("ASSET[%d]: Installed asset group %s at base address "
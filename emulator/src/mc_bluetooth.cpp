@@ -24,19 +24,333 @@
  * THE SOFTWARE.
  */
 
+// Must be before other headers
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define WINVER WindowsXP
+#   define _WIN32_WINNT 0x502
+#   include <windows.h>
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <netinet/tcp.h>
+#   include <netinet/in.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   define closesocket(_s) close(_s)
+#endif
+
+#include "mc_bluetooth.h"
 #include "btprotocol.h"
+#include "systime.h"
+#include "macros.h"
+#include "inputlog.h"
+#include <string.h>
+
+#define LOG_PREFIX  "Bluetooth: "
+
+BluetoothBridge BluetoothBridge::instance;
 
-/*
- * Siftulator doesn't yet support Bluetooth. This file contains stubs which
- * implement a fake Bluetooth device that's never available.
- */
 
 bool BTProtocolHardware::isAvailable()
 {
-    return false;
+    return BluetoothBridge::isRunning();
 }
 
 void BTProtocolHardware::requestProduceData()
 {
-    // Nothing to do.
+    if (BluetoothBridge::isRunning())
+        BluetoothBridge::dataRequested();
+}
+
+void BluetoothBridge::start(int port, const char *logFilename)
+{
+    /*
+     * Spawn a thread which listens for a host connection. The link
+     * itself is driven by connectionEvent() on the MC thread.
+     */
+
+    ASSERT(instance.running == false);
+    ASSERT(instance.thread == NULL);
+
+    instance.logFile = NULL;
+    if (logFilename && logFilename[0]) {
+        instance.logFile = fopen(logFilename, "w");
+        if (instance.logFile)
+            fprintf(instance.logFile, "time_us,dir,length,type,wait_us\n");
+        else
+            fprintf(stderr, LOG_PREFIX "Can't open log file '%s'\n", logFilename);
+    }
+
+    instance.port = port;
+    instance.clientFD = -1;
+    instance.hostConnected = false;
+    instance.linkUp = false;
+    instance.txRequestTime = 0;
+    instance.running = true;
+    instance.thread = new tthread::thread(threadEntry, (void*) &instance);
+}
+
+void BluetoothBridge::stop()
+{
+    /*
+     * Ask the background thread to stop at its next convenience,
+     * asynchronously. Does not wait for the thread.
+     */
+
+    instance.running = false;
+
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+    if (instance.logFile) {
+        fclose(instance.logFile);
+        instance.logFile = NULL;
+    }
+}
+
+void BluetoothBridge::threadEntry(void *param)
+{
+    BluetoothBridge *self = (BluetoothBridge *) param;
+    self->threadMain();
+}
+
+void BluetoothBridge::threadMain()
+{
+    #ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    #endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = 0x0100007f;
+    addr.sin_port = htons(port);
+
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+
+    unsigned long arg = 1;
+    setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, (const char *)&arg, sizeof arg);
+
+    if (bind(listenFD, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't bind to port!\n");
+        return;
+    }
+
+    if (listen(listenFD, 1) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't listen on socket\n");
+        return;
+    }
+
+    fprintf(stderr, LOG_PREFIX "Listening on port %d\n", port);
+
+    while (running) {
+        struct sockaddr_in addr;
+        socklen_t addrSize = sizeof addr;
+        int fd = accept(listenFD, (struct sockaddr *) &addr, &addrSize);
+        if (fd < 0)
+            break;
+
+        unsigned long arg;
+        #ifdef SO_NOSIGPIPE
+            arg = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &arg, sizeof arg);
+        #endif
+        arg = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&arg, sizeof arg);
+
+        lock.lock();
+        clientFD = fd;
+        hostConnected = true;
+        lock.unlock();
+
+        fprintf(stderr, LOG_PREFIX "Host connected\n");
+        handleClient();
+        fprintf(stderr, LOG_PREFIX "Host disconnected\n");
+
+        lock.lock();
+        clientFD = -1;
+        hostConnected = false;
+        rxQueue.clear();
+        lock.unlock();
+
+        closesocket(fd);
+    }
+
+    closesocket(listenFD);
+}
+
+void BluetoothBridge::handleClient()
+{
+    /*
+     * Reassemble packets from the socket into rxQueue. When the queue
+     * is full we stop reading, and TCP pushes back on the host just like
+     * a central that's run out of buffers.
+     */
+
+    uint8_t buffer[1024];
+    unsigned len = 0;
+
+    while (running) {
+        fd_set rfds;
+        struct timeval pollInterval = { 0, 20000 };  // 20ms
+
+        lock.lock();
+        bool full = rxQueue.size() >= RX_QUEUE_LIMIT;
+        lock.unlock();
+
+        if (full) {
+            tthread::this_thread::sleep_for(tthread::chrono::milliseconds(1));
+            continue;
+        }
+
+        FD_ZERO(&rfds);
+        FD_SET(clientFD, &rfds);
+        if (select(clientFD + 1, &rfds, NULL, NULL, &pollInterval) < 1)
+            continue;
+
+        int ret = recv(clientFD, (char *) buffer + len, sizeof buffer - len, 0);
+        if (ret <= 0)
+            return;
+        len += ret;
+
+        if (!rxBytes(buffer, len)) {
+            fprintf(stderr, LOG_PREFIX "Bad packet length from host\n");
+            return;
+        }
+    }
+}
+
+bool BluetoothBridge::rxBytes(uint8_t *buffer, unsigned &len)
+{
+    /*
+     * Queue every complete packet at the front of 'buffer', and shift
+     * the remainder down. Returns false on a framing error.
+     */
+
+    uint8_t *p = buffer;
+    uint8_t *end = buffer + len;
+    uint64_t now = SysTime::ticks();
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+
+    while (p < end) {
+        unsigned length = p[0];
+        if (length < 1 || length > MAX_PACKET_BYTES)
+            return false;
+        if (end - p < int(length + 1))
+            break;
+
+        Packet packet;
+        packet.arrival = now;
+        packet.length = length;
+        memcpy(packet.bytes, p + 1, length);
+        rxQueue.push_back(packet);
+        p += length + 1;
+    }
+
+    len = end - p;
+    memmove(buffer, p, len);
+    return true;
+}
+
+void BluetoothBridge::dataRequested()
+{
+    // Remember the oldest outstanding request, for latency logging
+    if (!instance.txRequestTime)
+        instance.txRequestTime = SysTime::ticks();
+}
+
+void BluetoothBridge::connectionEvent()
+{
+    /*
+     * One BLE connection event. Connection state changes and data in
+     * either direction all happen here, in the same order the nRF8001
+     * would report them: host writes first, then our notifications.
+     */
+
+    BluetoothBridge &self = instance;
+    uint64_t now = SysTime::ticks();
+
+    self.lock.lock();
+    bool connected = self.hostConnected;
+    self.lock.unlock();
+
+    if (connected != self.linkUp) {
+        self.linkUp = connected;
+        InputLog::recordBluetoothLink(connected);
+        if (connected) {
+            BTProtocolCallbacks::onConnect();
+        } else {
+            BTProtocolCallbacks::onDisconnect();
+            self.txRequestTime = 0;
+        }
+    }
+    if (!self.linkUp)
+        return;
+
+    for (unsigned i = 0; i < RX_PACKETS_PER_EVENT; ++i) {
+        Packet packet;
+
+        self.lock.lock();
+        bool available = !self.rxQueue.empty();
+        if (available) {
+            packet = self.rxQueue.front();
+            self.rxQueue.pop_front();
+        }
+        self.lock.unlock();
+
+        if (!available)
+            break;
+
+        self.logPacket(now, "rx", packet.bytes, packet.length, now - packet.arrival);
+        InputLog::recordBluetoothData(packet.bytes, packet.length);
+        BTProtocolCallbacks::onReceiveData(packet.bytes, packet.length);
+    }
+
+    unsigned credits = TX_CREDITS;
+    while (BTProtocolCallbacks::isDataPending()) {
+        if (!credits) {
+            BTProtocolCallbacks::onTransmitStalled();
+            break;
+        }
+
+        uint8_t bytes[MAX_PACKET_BYTES];
+        unsigned length = BTProtocolCallbacks::onProduceData(bytes);
+        if (!length)
+            break;
+        credits--;
+
+        ASSERT(length <= MAX_PACKET_BYTES);
+        self.logPacket(now, "tx", bytes, length,
+            self.txRequestTime ? now - self.txRequestTime : 0);
+        self.sendPacket(bytes, length);
+    }
+
+    if (!BTProtocolCallbacks::isDataPending())
+        self.txRequestTime = 0;
+}
+
+void BluetoothBridge::sendPacket(const uint8_t *bytes, unsigned length)
+{
+    uint8_t frame[MAX_PACKET_BYTES + 1];
+    frame[0] = length;
+    memcpy(frame + 1, bytes, length);
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    if (clientFD >= 0)
+        send(clientFD, (const char *) frame, length + 1, 0);
+}
+
+void BluetoothBridge::logPacket(uint64_t now, const char *dir,
+    const uint8_t *bytes, unsigned length, uint64_t waited)
+{
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    if (logFile)
+        fprintf(logFile, "%llu,%s,%u,0x%02x,%llu\n",
+            (unsigned long long) (now / SysTime::usTicks(1)), dir, length,
+            bytes[0], (unsigned long long) (waited / SysTime::usTicks(1)));
 }
@@ -0,0 +1,117 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MC_BLUETOOTH_H_
+#define MC_BLUETOOTH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+#include "tinythread.h"
+#include "sifteo/abi/types.h"
+
+
+/**
+ * Emulated Bluetooth LE link (--bluetooth PORT), bridged to a local TCP
+ * socket so a companion app or test harness can talk to the running game.
+ *
+ * Only one host can be connected at a time. While it is, the firmware sees
+ * a connected peer. Each packet on the socket is a length byte followed by
+ * that many bytes of BTProtocol packet, starting with its type byte. The
+ * length must be between 1 and MAX_PACKET_BYTES.
+ *
+ * Traffic only moves at connection events, spaced CONNECTION_INTERVAL
+ * apart in virtual time, with the same per-event limits as the nRF8001:
+ * the base spends at most TX_CREDITS data credits, and the host delivers
+ * at most RX_PACKETS_PER_EVENT packets.
+ *
+ * With --bluetooth-log FILE, every packet is recorded as one CSV line with
+ * its virtual timestamp, direction, length, type, and how long it waited.
+ */
+class BluetoothBridge {
+public:
+    // One BTProtocol packet: type byte plus payload, one ATT write
+    static const unsigned MAX_PACKET_BYTES = _SYS_BT_PACKET_BYTES + 1;
+
+    // 18.75 ms in MC ticks, where iOS tends to settle given our 10-20 ms request
+    static const unsigned CONNECTION_INTERVAL = 300000;
+
+    // The nRF8001 grants two data credits, returned after each event
+    static const unsigned TX_CREDITS = 2;
+
+    // Typical write-without-response limit per event on the central side
+    static const unsigned RX_PACKETS_PER_EVENT = 4;
+
+    // Stop reading the socket when this many packets are waiting
+    static const unsigned RX_QUEUE_LIMIT = 256;
+
+    static void start(int port, const char *logFilename);
+    static void stop();
+
+    static bool isRunning() {
+        return instance.running;
+    }
+
+    /// Called on the MC thread once per connection interval
+    static void connectionEvent();
+
+    /// Called on the MC thread when the firmware has data to send
+    static void dataRequested();
+
+private:
+    BluetoothBridge() {}
+    static BluetoothBridge instance;
+
+    struct Packet {
+        uint64_t arrival;       // SysTime, stamped by the socket thread
+        uint8_t length;
+        uint8_t bytes[MAX_PACKET_BYTES];
+    };
+
+    tthread::thread *thread;
+    tthread::mutex lock;
+    std::deque<Packet> rxQueue;
+    FILE *logFile;
+
+    int port;
+    int clientFD;
+    bool running;
+    bool hostConnected;         // Socket thread's view, under 'lock'
+
+    // MC thread only
+    bool linkUp;
+    uint64_t txRequestTime;
+
+    static void threadEntry(void *param);
+    void threadMain();
+    void handleClient();
+    bool rxBytes(uint8_t *buffer, unsigned &len);
+
+    void sendPacket(const uint8_t *bytes, unsigned length);
+    void logPacket(uint64_t now, const char *dir,
+        const uint8_t *bytes, unsigned length, uint64_t waited);
+};
+
+#endif  // MC_BLUETOOTH_H_
@@ -169,6 +169,16 @@ void Crc32::add(uint32_t word)
     gCrc = (gCrcTable[((gCrc >> 24) ^ (word      )) & 0xff] ^ (gCrc << 8));
 }
 
+void Crc32::addWords(const uint32_t *words, uint32_t count)
+{
+    // No DMA in emulation, just the table.
+    while (count) {
+        add(*words);
+        words++;
+        count--;
+    }
+}
+
 void Crc32::addUniqueness()
 {
     /*
@@ -24,7 +24,6 @@
  * THE SOFTWARE.
  */
 
-#include <cxxabi.h>
 #include "mc_elfdebuginfo.h"
 #include <string.h>
 #include <stdlib.h>
@@ -34,6 +33,8 @@ void ELFDebugInfo::clear()
 {
     sections.clear();
     sectionMap.clear();
+    symbols.clear();
+    romCache.clear();
 }
 
 bool ELFDebugInfo::copyProgramBytes(FlashMapSpan::ByteOffset byteOffset,
@@ -81,6 +82,33 @@ void ELFDebugInfo::init(const Elf::Program &program)
             sectionMap[readString(strTab, pHdr->sh_name)] = pHdr;
         }
     }
+
+    initSymbols();
+}
+
+void ELFDebugInfo::initSymbols()
+{
+    /*
+     * Copy the symbol and string tables out of flash once, and index them.
+     * Lookups are frequent (every formatted address in traces, profiles,
+     * and fault reports) so they must not touch flash at all.
+     */
+
+    const Elf::SectionHeader *symTab = findSection(".symtab");
+    const Elf::SectionHeader *strTab = findSection(".strtab");
+    if (!symTab || !strTab)
+        return;
+
+    std::vector<Elf::Symbol> symBuf(symTab->sh_size / sizeof(Elf::Symbol));
+    std::vector<char> strBuf(strTab->sh_size);
+
+    if (symBuf.empty() || strBuf.empty() ||
+        !copyProgramBytes(symTab->sh_offset, (uint8_t*) &symBuf[0],
+            symBuf.size() * sizeof(Elf::Symbol)) ||
+        !copyProgramBytes(strTab->sh_offset, (uint8_t*) &strBuf[0], strBuf.size()))
+        return;
+
+    symbols.init(&symBuf[0], symBuf.size(), &strBuf[0], strBuf.size());
 }
 
 const Elf::SectionHeader *ELFDebugInfo::findSection(const std::string &name) const
@@ -121,36 +149,11 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     // If nothing is found, we still fill in the output buffer and name
     // with "(unknown)" and zeroes, but 'false' is returned.
 
-    const Elf::SectionHeader *SI = findSection(".symtab");
-    if (SI) {
-        Elf::Symbol currentSym;
-        const uint32_t worstOffset = (uint32_t) -1;
-        uint32_t bestOffset = worstOffset;
-
-        for (unsigned index = 0;; index++) {
-            uint32_t tableOffset = index * sizeof currentSym;
-
-            if (tableOffset + sizeof currentSym > SI->sh_size ||
-                !copyProgramBytes(
-                    SI->sh_offset + tableOffset,
-                    (uint8_t*) &currentSym, sizeof currentSym))
-                break;
-
-            // Strip the Thumb bit from function symbols.
-            if ((currentSym.st_info & 0xF) == Elf::STT_FUNC)
-                currentSym.st_value &= ~1;
-
-            uint32_t addrOffset = address - currentSym.st_value;
-            if (addrOffset < currentSym.st_size && addrOffset < bestOffset) {
-                symbol = currentSym;
-                bestOffset = addrOffset;
-            }
-        }
-
-        if (bestOffset != worstOffset) {
-            name = readString(".strtab", symbol.st_name);
-            return true;
-        }
+    const ELFSymbolIndex::Entry *entry = symbols.find(address);
+    if (entry) {
+        symbol = entry->symbol;
+        name = entry->name;
+        return true;
     }
 
     memset(&symbol, 0, sizeof symbol);
@@ -160,12 +163,9 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
 
 std::string ELFDebugInfo::formatAddress(uint32_t address) const
 {
-    Elf::Symbol symbol;
-    std::string name;
-
-    findNearestSymbol(address, symbol, name);
-    demangle(name);
-    uint32_t offset = address - symbol.st_value;
+    const ELFSymbolIndex::Entry *entry = symbols.find(address);
+    std::string name = entry ? entry->demangledName : "(unknown)";
+    uint32_t offset = entry ? address - entry->symbol.st_value : address;
 
     if (offset != 0) {
         char buf[16];
@@ -176,17 +176,15 @@ std::string ELFDebugInfo::formatAddress(uint32_t address) const
     return name;
 }
 
-void ELFDebugInfo::demangle(std::string &name)
+std::string ELFDebugInfo::formatFunction(uint32_t address) const
 {
-    // This uses the demangler built into GCC's libstdc++.
-    // It uses the same name mangling style as clang.
-
-    int status;
-    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
-    if (status == 0) {
-        name = result;
-        free(result);
-    }
+    // Like formatAddress(), but without the offset. Empty if unknown.
+
+    const ELFSymbolIndex::Entry *entry = symbols.find(address);
+    if (!entry)
+        return std::string();
+
+    return entry->demangledName;
 }
 
 bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const
@@ -195,6 +193,10 @@ bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) co
      * Try to read from read-only data in the ELF file. If the read can be
      * satisfied locally, from the ELF data, returns true and fills in 'buffer'.
      * If not, returns false.
+     *
+     * Debuggers read code and constants over and over (disassembly,
+     * backtraces, string formatting), so each section is copied out of
+     * flash once and served from memory after that.
      */
 
     for (sections_t::const_iterator I = sections.begin(), E = sections.end(); I != E; ++I) {
@@ -214,8 +216,22 @@ bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) co
         if (offset > I->sh_size || offset + bytes > I->sh_size)
             continue;
 
+        unsigned index = I - sections.begin();
+        std::map<unsigned, std::vector<uint8_t> >::iterator C = romCache.find(index);
+        if (C == romCache.end()) {
+            std::vector<uint8_t> &data = romCache[index];
+            data.resize(I->sh_size);
+            if (!data.empty() && !copyProgramBytes(I->sh_offset, &data[0], data.size())) {
+                romCache.erase(index);
+                return false;
+            }
+            C = romCache.find(index);
+        }
+
         // Success, we can read from the ELF
-        return copyProgramBytes(offset, buffer, bytes);
+        if (bytes)
+            memcpy(buffer, &C->second[offset], bytes);
+        return true;
     }
 
     return false;
@@ -50,9 +50,19 @@ void FlashBlock::verify()
 
 void FlashBlock::resetStats()
 {
+    stats.totalAccesses += stats.periodic.blockTotal;
+    stats.totalMisses += stats.periodic.blockMiss;
     memset(&stats.periodic, 0, sizeof stats.periodic);
 }
 
+void FlashBlock::getTotals(uint64_t &accesses, uint64_t &misses)
+{
+    // Includes the interval in progress. Sampled from another thread,
+    // so this is only approximate while the cache is busy.
+    accesses = stats.totalAccesses + stats.periodic.blockTotal;
+    misses = stats.totalMisses + stats.periodic.blockMiss;
+}
+
 void FlashBlock::countBlockMiss(uint32_t blockAddr)
 {
     stats.periodic.blockMiss++;
@@ -82,7 +92,7 @@ void FlashBlock::dumpStats()
         return;
 
     double dt = tickDiff / (double) SysTime::sTicks(1);
-    uint32_t totalBytes = stats.periodic.blockMiss * BLOCK_SIZE;
+    uint32_t totalBytes = (stats.periodic.blockMiss + stats.periodic.blockPreload) * BLOCK_SIZE;
     double effectiveMHZ = totalBytes / dt * bytesToMBits;
 
     /*
@@ -90,12 +100,13 @@ void FlashBlock::dumpStats()
      */
 
     LOG(("\nFLASH: %9.1f acc/s, %8.1f same/s, "
-        "%8.1f cached/s, %8.1f miss/s, "
+        "%8.1f cached/s, %8.1f miss/s, %8.1f preload/s, "
         "%8.2f%% bus utilization\n",
         stats.periodic.blockTotal / dt,
         stats.periodic.blockHitSame / dt,
         stats.periodic.blockHitOther / dt,
         stats.periodic.blockMiss / dt,
+        stats.periodic.blockPreload / dt,
         effectiveMHZ / flashBusMHZ * 100.0));
 
     /*
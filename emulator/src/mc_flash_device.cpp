@@ -67,10 +67,44 @@ void FlashDevice::read(uint32_t address, uint8_t *buf, unsigned len)
 
     if (!gStealthIOCounter) {
         LuaFilesystem::onRawRead(address, buf, len);
-        SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_MISS);
+        SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_MISS, SvmProfiler::Flash);
     }
 }
 
+bool FlashDevice::readAsync(uint32_t address, uint8_t *buf, unsigned len)
+{
+    /*
+     * Our simulated reads complete instantly. On hardware, the CPU keeps
+     * running while DMA fetches the data, so don't charge for the bus time.
+     */
+
+    FlashStorage::MasterRecord &storage = SystemMC::getSystem()->flash.data->master;
+
+    if (address <= sizeof storage.bytes &&
+        len <= sizeof storage.bytes &&
+        address + len <= sizeof storage.bytes) {
+
+        memcpy(buf, storage.bytes + address, len);
+    } else {
+        ASSERT(0 && "MC flash readAsync() out of range");
+    }
+
+    if (!gStealthIOCounter)
+        LuaFilesystem::onRawRead(address, buf, len);
+
+    return true;
+}
+
+bool FlashDevice::asyncDone()
+{
+    return true;
+}
+
+bool FlashDevice::finishAsync()
+{
+    return true;
+}
+
 void FlashDevice::verify(uint32_t address, const uint8_t *buf, unsigned len)
 {
     FlashStorage::MasterRecord &storage = SystemMC::getSystem()->flash.data->master;
@@ -92,7 +126,7 @@ void FlashDevice::write(uint32_t address, const uint8_t *buf, unsigned len)
 
         if (!gStealthIOCounter) {
             LuaFilesystem::onRawWrite(address, buf, len);
-            SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_WRITE);
+            SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_WRITE, SvmProfiler::Flash);
         }
 
         // Program bits from 1 to 0 only.
@@ -121,7 +155,7 @@ void FlashDevice::eraseBlock(uint32_t address)
             LOG(("FLASH: Erasing block %08x\n", address));
 
             LuaFilesystem::onRawErase(address);
-            SystemMC::elapseTicks(MCTiming::TICKS_PER_BLOCK_ERASE);
+            SystemMC::elapseTicks(MCTiming::TICKS_PER_BLOCK_ERASE, SvmProfiler::Flash);
         }
 
         memset(storage.bytes + sector, 0xFF, FlashDevice::ERASE_BLOCK_SIZE);
@@ -55,6 +55,25 @@ using namespace Svm;
 
 #define LOG_PREFIX  "GDB Server: "
 
+/*
+ * Served over qXfer so GDB knows which addresses are worth touching, and
+ * that flash is read-only. Matches the SVM layout in SvmMemory.
+ */
+static const char gdbMemoryMap[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
+        "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
+    "<memory-map>"
+    "<memory type=\"ram\" start=\"0x10000\" length=\"0x8000\"/>"
+    "<memory type=\"rom\" start=\"0x80000000\" length=\"0x40000000\"/>"
+    "<memory type=\"rom\" start=\"0xc0000000\" length=\"0x40000000\"/>"
+    "</memory-map>";
+
+static const char gdbTargetXML[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target><architecture>arm</architecture></target>";
+
 GDBServer GDBServer::instance;
 
 void GDBServer::setDebugInfo(const ELFDebugInfo *info)
@@ -365,6 +384,16 @@ void GDBServer::txHexByte(uint8_t byte)
     txByte(digitToHex(byte));
 }
 
+void GDBServer::txBinaryByte(uint8_t byte)
+{
+    // Binary data escapes the framing characters with 0x7d, then XOR 0x20
+    if (byte == '#' || byte == '$' || byte == '}' || byte == '*') {
+        txByte('}');
+        byte ^= 0x20;
+    }
+    txByte(byte);
+}
+
 void GDBServer::txHexWord(uint32_t word)
 {
     txHexByte(word >> 0);
@@ -394,6 +423,14 @@ uint8_t GDBServer::rxHexByte(uint32_t &offset)
     return (high << 4) | low;
 }
 
+uint8_t GDBServer::rxBinaryByte(uint32_t &offset)
+{
+    uint8_t byte = rxByte(offset);
+    if (byte == '}')
+        byte = rxByte(offset) ^ 0x20;
+    return byte;
+}
+
 uint32_t GDBServer::rxHexWord(uint32_t &offset)
 {
     uint8_t byte0 = rxHexByte(offset);
@@ -422,6 +459,29 @@ void GDBServer::txPacketString(const char *str)
     txPacketEnd();
 }
 
+void GDBServer::txXferReply(const char *document, const char *args)
+{
+    /*
+     * Reply to a qXfer read of a static document. 'args' is the
+     * "offset,length" tail of the request. The 'm' prefix means there's
+     * more to read, 'l' means this is the last piece.
+     */
+
+    unsigned offset = 0, length = 0;
+    if (sscanf(args, "%x,%x", &offset, &length) != 2)
+        return txPacketString("E01");
+
+    unsigned total = strlen(document);
+    offset = MIN(offset, total);
+    length = MIN(length, total - offset);
+
+    txPacketBegin();
+    txByte(offset + length < total ? 'm' : 'l');
+    for (unsigned i = 0; i < length; ++i)
+        txBinaryByte(document[offset + i]);
+    txPacketEnd();
+}
+
 uint32_t GDBServer::message(uint32_t words)
 {
     /*
@@ -440,7 +500,16 @@ void GDBServer::handlePacket()
     switch (rxPacket[0])
     {
         case 'q': {
-            if (packetStartsWith("qSupported")) return txPacketString("PacketSize=100");
+            if (packetStartsWith("qSupported")) {
+                char buf[128];
+                snprintf(buf, sizeof buf, "PacketSize=%x;qXfer:memory-map:read+;"
+                    "qXfer:features:read+", RX_PACKET_SIZE);
+                return txPacketString(buf);
+            }
+            if (packetStartsWith("qXfer:memory-map:read::"))
+                return txXferReply(gdbMemoryMap, rxPacket + strlen("qXfer:memory-map:read::"));
+            if (packetStartsWith("qXfer:features:read:target.xml:"))
+                return txXferReply(gdbTargetXML, rxPacket + strlen("qXfer:features:read:target.xml:"));
             if (packetStartsWith("qOffsets"))   return txPacketString("Text=0;Data=0;Bss=0");
             break;
         }
@@ -505,13 +574,14 @@ void GDBServer::handlePacket()
             txPacketBegin();
             if (sscanf(rxPacket, "m%x,%x", &addr, &size) == 2)
                 while (size > 0) {
-                    uint8_t buffer[128];
+                    uint8_t buffer[1024];
                     int chunk = MIN((int) sizeof buffer, size);
                     if (!readMemory(addr, buffer, chunk))
                         break;
                     for (int i = 0; i < chunk; ++i)
                         txHexByte(buffer[i]);
                     size -= chunk;
+                    addr += chunk;
                 }
             return txPacketEnd();
         }
@@ -524,7 +594,21 @@ void GDBServer::handlePacket()
             int addr = 0, size = 0;
             if (delim && sscanf(rxPacket, "M%x,%x", &addr, &size) == 2) {
                 uint32_t offset = (delim - rxPacket) + 1;
-                if (writeMemory(addr, size, offset))
+                if (writeMemory(addr, size, offset, false))
+                    txString("OK");
+            }
+            return txPacketEnd();
+        }
+
+        case 'X': {
+            // Write memory, binary (RAM only)
+            // Xaddr,length:bytes...
+            txPacketBegin();
+            char *delim = (char*) memchr(rxPacket, ':', rxPacketLen);
+            int addr = 0, size = 0;
+            if (delim && sscanf(rxPacket, "X%x,%x", &addr, &size) == 2) {
+                uint32_t offset = (delim - rxPacket) + 1;
+                if (writeMemory(addr, size, offset, true))
                     txString("OK");
             }
             return txPacketEnd();
@@ -645,7 +729,7 @@ bool GDBServer::readMemory(uint32_t addr, uint8_t *buffer, uint32_t bytes)
     return true;
 }
 
-bool GDBServer::writeMemory(uint32_t addr, uint32_t bytes, uint32_t packetOffset)
+bool GDBServer::writeMemory(uint32_t addr, uint32_t bytes, uint32_t packetOffset, bool binary)
 {
     while (bytes) {
         uint32_t chunk = MIN(bytes, Debugger::MAX_CMD_BYTES - sizeof(uint32_t));
@@ -658,7 +742,7 @@ bool GDBServer::writeMemory(uint32_t addr, uint32_t bytes, uint32_t packetOffset
         uint8_t *cmdBytes = reinterpret_cast<uint8_t*>(&msgCmd[2]);
 
         for (uint32_t i = 0; i < chunk; i++)
-            cmdBytes[i] = rxHexByte(packetOffset);
+            cmdBytes[i] = binary ? rxBinaryByte(packetOffset) : rxHexByte(packetOffset);
 
         message((chunk + 3) / 4 + 2);
 
@@ -48,6 +48,9 @@ private:
     GDBServer() {}
     static GDBServer instance;
 
+    // Largest packet payload we accept, advertised in qSupported
+    static const unsigned RX_PACKET_SIZE = 0x4000;
+
     tthread::thread *thread;
     const ELFDebugInfo *debugInfo;
     MessageCallback messageCb;
@@ -63,7 +66,7 @@ private:
     uint8_t rxChecksum;
     uint8_t txChecksum;
     char txBuffer[2048];
-    char rxPacket[1024];
+    char rxPacket[RX_PACKET_SIZE + 1];
 
     uint32_t msgCmd[Svm::Debugger::MAX_CMD_WORDS];
     uint32_t msgReply[Svm::Debugger::MAX_REPLY_WORDS];
@@ -96,10 +99,13 @@ private:
     void txPacketString(const char *str);
     void txHexByte(uint8_t byte);
     void txHexWord(uint32_t word);
+    void txBinaryByte(uint8_t byte);
+    void txXferReply(const char *document, const char *args);
     
     uint8_t rxByte(uint32_t &offset);
     uint8_t rxHexByte(uint32_t &offset);
     uint32_t rxHexWord(uint32_t &offset);
+    uint8_t rxBinaryByte(uint32_t &offset);
 
     static char digitToHex(int i);
     static int digitFromHex(char c);
@@ -113,7 +119,7 @@ private:
     void removeBreakpoint(uint32_t addr);
 
     bool readMemory(uint32_t addr, uint8_t *buffer, uint32_t bytes);
-    bool writeMemory(uint32_t addr, uint32_t bytes, uint32_t packetOffset);
+    bool writeMemory(uint32_t addr, uint32_t bytes, uint32_t packetOffset, bool binary);
 };
 
 #endif  // GDB_SERVER_H
@@ -27,6 +27,7 @@
 #include "tasks.h"
 #include "macros.h"
 #include "pause.h"
+#include "inputlog.h"
 
 namespace HomeButton
 {
@@ -43,6 +44,7 @@ void setPressed(bool value)
 {
     if (state != value) {
         state = value;
+        InputLog::recordButton(value);
         HomeButton::update();
         Pause::taskWork.atomicMark(Pause::ButtonPress);
         Tasks::trigger(Tasks::Pause);
@@ -29,19 +29,21 @@
 #include "mc_logdecoder.h"
 #include <cstdio>
 #include "system.h"
+#include "simevents.h"
 
 void LogDecoder::init()
 {
     scriptType = _SYS_SCRIPT_NONE;
     scriptBuffer.clear();
     handlers.clear();
+    formats.clear();
 }
 
-void LogDecoder::formatLog(ELFDebugInfo &DI,
-    char *out, size_t outSize, char *fmt, uint32_t *args, size_t argCount)
+void LogDecoder::compileFormat(const char *fmt, FormatPlan &plan)
 {
-    // This is a simple printf()-like formatter, used to format log entries.
-    // It differs from printf() in two important ways:
+    // Format strings are parsed once, into runs of literal text and
+    // conversions, by a simple printf()-like parser. It differs from
+    // printf() in two important ways:
     //
     //   - We enforce a subset of functionality which is both safe and
     //     does not require runtime memory access. This means only int, float,
@@ -54,31 +56,37 @@ void LogDecoder::formatLog(ELFDebugInfo &DI,
     // format string should have already been validated by slinky. We only
     // perform the minimum checks necessary to ensure runtime safety.
 
-    char *outEnd = out + outSize - 1;
-    *outEnd = '\0';
+    FormatStep literal;
+    literal.type = FormatStep::LITERAL;
+
+    plan.found = fmt[0] != '\0';
+    plan.steps.clear();
 
-    while (out < outEnd) {
-        char *segment = fmt;
+    while (*fmt) {
+        const char *segment = fmt;
         char c = *(fmt++);
 
         if (c != '%') {
-            *(out++) = c;
-            if (c)
-                continue;
-            break;
+            literal.text += c;
+            continue;
         }
 
+        FormatStep step;
+        step.type = FormatStep::NONE;
+        step.width = 0;
+        step.leadingZero = false;
+
+        // Only a zero flag and a width, which formatInt() can handle
+        bool simple = true;
+
         bool done = false;
-        bool dot = false;
-        bool leadingZero = false;
-        int width = 0;
         do {
             char spec = *(fmt++);
-            char saved = *fmt;
-            *fmt = '\0';  // NUL terminate the current segment
-            
+            done = true;
+            step.conv = spec;
+
             switch (spec) {
-                
+
                 // Prefix characters
                 case '0':
                 case '1':
@@ -90,76 +98,53 @@ void LogDecoder::formatLog(ELFDebugInfo &DI,
                 case '7':
                 case '8':
                 case '9':
-                    if (width == 0 && spec == '0')
-                        leadingZero = true;
-                    width = (width * 10) + (spec - '0');
+                    if (step.width == 0 && spec == '0')
+                        step.leadingZero = true;
+                    step.width = (step.width * 10) + (spec - '0');
+                    done = false;
                     break;
 
                 case ' ':
                 case '-':
                 case '+':
-                    break;
-
                 case '.':
-                    dot = true;
+                    simple = false;
+                    done = false;
                     break;
 
                 // Literal '%'
                 case '%':
-                    *(out++) = '%';
-                    done = true;
+                    literal.text += '%';
                     break;
 
                 // Pointers, formatted as 32-bit hex values
                 case 'p':
-                    done = true;
-                    ASSERT(argCount && "Too few arguments in format string");
-                    out += snprintf(out, outEnd - out, "0x%08x", *args);
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::POINTER;
                     break;
 
                 // Pointer, formatted as a resolved symbol
                 case 'P':
-                    done = true;
-                    ASSERT(argCount && "Too few arguments in format string");
-                    out += snprintf(out, outEnd - out, "%s", DI.formatAddress(*args).c_str());
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::SYMBOL;
                     break;
 
                 // Binary integers
                 case 'b':
-                    done = true;
-                    ASSERT(argCount && "Too few arguments in format string");
-                    for (int i = 31; i >= 0 && out != outEnd; --i) {
-                        unsigned bits = (*args) >> i;
-
-                        if (bits != 0) {
-                            // There's a '1' at or to the left of the current bit
-                            out += snprintf(out, outEnd - out, "%d", bits & 1);
-                        } else if (i < width) {
-                            // Pad with blanks or zeroes
-                            *(out++) = leadingZero ? '0' : ' ';
-                        }
-                    }
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::BINARY;
                     break;
 
-                // Integer parameters, passed to printf()
+                // Integer parameters, formatted by formatInt() if possible
                 case 'd':
                 case 'i':
-                case 'o':
                 case 'u':
                 case 'X':
                 case 'x':
+                    step.type = simple ? FormatStep::INTEGER : FormatStep::PRINTF_INT;
+                    break;
+
+                // Integer parameters, passed to printf()
+                case 'o':
                 case 'c':
-                    done = true;
-                    ASSERT(argCount && "Too few arguments in format string");
-                    out += snprintf(out, outEnd - out, segment, *args);
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::PRINTF_INT;
                     break;
 
                 // 32-bit float parameters, passed to printf()
@@ -169,40 +154,173 @@ void LogDecoder::formatLog(ELFDebugInfo &DI,
                 case 'E':
                 case 'g':
                 case 'G':
-                    done = true;
-                    ASSERT(argCount && "Too few arguments in format string");
-                    out += snprintf(out, outEnd - out, segment,
-                        (double) reinterpret_cast<float&>(*args));
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::PRINTF_FLOAT;
                     break;
 
                 // 'C' specifier: Four characters packed into a 32-bit int.
-                // Stops when it hits a NUL.
                 case 'C':
-                    done = true;
-                    for (unsigned i = 0; outEnd != out && i < 4; i++) {
-                        char c = (*args) >> (i * 8);
-                        if (!c)
-                            break;
-                        *(out++) = c;
-                    }
-                    argCount--;
-                    args++;
+                    step.type = FormatStep::CHARS;
                     break;
 
                 case 0:
                     ASSERT(0 && "Premature end of format string");
+                    fmt--;
                     break;
 
                 default:
                     ASSERT(0 && "Unsupported character in format string");
-                    return;
+                    fmt = "";
+                    break;
             }
-            
-            *fmt = saved;   // Restore next character
         } while (!done);
+
+        if (step.type != FormatStep::NONE) {
+            if (!literal.text.empty()) {
+                plan.steps.push_back(literal);
+                literal.text.clear();
+            }
+            step.text.assign(segment, fmt - segment);
+            plan.steps.push_back(step);
+        }
+    }
+
+    if (!literal.text.empty())
+        plan.steps.push_back(literal);
+}
+
+const LogDecoder::FormatPlan &LogDecoder::getFormat(ELFDebugInfo &DI, uint32_t offset)
+{
+    /*
+     * Plans are cached by the format string's offset in .debug_logstr,
+     * so each string is read and parsed only the first time it's logged.
+     */
+
+    std::map<uint32_t, FormatPlan>::iterator I = formats.find(offset);
+    if (I != formats.end())
+        return I->second;
+
+    FormatPlan &plan = formats[offset];
+    compileFormat(DI.readString(".debug_logstr", offset).c_str(), plan);
+    return plan;
+}
+
+char *LogDecoder::formatInt(char *out, char *outEnd, const FormatStep &step, uint32_t value)
+{
+    // Equivalent to snprintf() with the step's format, for the common
+    // case of %d, %i, %u, %x, or %X with at most a zero flag and width.
+
+    const char *lut = step.conv == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+    unsigned base = (step.conv == 'x' || step.conv == 'X') ? 16 : 10;
+    bool negative = false;
+
+    if ((step.conv == 'd' || step.conv == 'i') && int32_t(value) < 0) {
+        negative = true;
+        value = -value;
+    }
+
+    char digits[16];
+    char *digitsEnd = digits + sizeof digits;
+    char *d = digitsEnd;
+    do {
+        *(--d) = lut[value % base];
+        value /= base;
+    } while (value);
+
+    int padding = step.width - (digitsEnd - d) - negative;
+
+    if (negative && step.leadingZero && out != outEnd)
+        *(out++) = '-';
+    for (; padding > 0 && out != outEnd; padding--)
+        *(out++) = step.leadingZero ? '0' : ' ';
+    if (negative && !step.leadingZero && out != outEnd)
+        *(out++) = '-';
+    while (d != digitsEnd && out != outEnd)
+        *(out++) = *(d++);
+
+    return out;
+}
+
+void LogDecoder::formatLog(ELFDebugInfo &DI, char *out, size_t outSize,
+    const FormatPlan &plan, uint32_t *args, size_t argCount)
+{
+    char *outEnd = out + outSize - 1;
+
+    for (std::vector<FormatStep>::const_iterator I = plan.steps.begin(), E = plan.steps.end();
+        I != E && out < outEnd; ++I) {
+        const FormatStep &step = *I;
+
+        if (step.type == FormatStep::LITERAL) {
+            size_t len = MIN(step.text.size(), size_t(outEnd - out));
+            memcpy(out, step.text.data(), len);
+            out += len;
+            continue;
+        }
+
+        ASSERT(argCount && "Too few arguments in format string");
+        uint32_t arg = 0;
+        if (argCount) {
+            arg = *(args++);
+            argCount--;
+        }
+
+        int len = 0;
+        switch (step.type) {
+
+            case FormatStep::POINTER:
+                len = snprintf(out, outEnd - out, "0x%08x", arg);
+                break;
+
+            case FormatStep::SYMBOL:
+                len = snprintf(out, outEnd - out, "%s", DI.formatAddress(arg).c_str());
+                break;
+
+            case FormatStep::BINARY:
+                for (int i = 31; i >= 0 && out != outEnd; --i) {
+                    unsigned bits = arg >> i;
+
+                    if (bits != 0) {
+                        // There's a '1' at or to the left of the current bit
+                        *(out++) = '0' + (bits & 1);
+                    } else if (i < step.width) {
+                        // Pad with blanks or zeroes
+                        *(out++) = step.leadingZero ? '0' : ' ';
+                    }
+                }
+                break;
+
+            case FormatStep::INTEGER:
+                out = formatInt(out, outEnd, step, arg);
+                break;
+
+            case FormatStep::PRINTF_INT:
+                len = snprintf(out, outEnd - out, step.text.c_str(), arg);
+                break;
+
+            case FormatStep::PRINTF_FLOAT:
+                len = snprintf(out, outEnd - out, step.text.c_str(),
+                    (double) reinterpret_cast<float&>(arg));
+                break;
+
+            // Stops when it hits a NUL.
+            case FormatStep::CHARS:
+                for (unsigned i = 0; outEnd != out && i < 4; i++) {
+                    char c = arg >> (i * 8);
+                    if (!c)
+                        break;
+                    *(out++) = c;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        // snprintf() returns the untruncated length
+        if (len > 0)
+            out += MIN(len, int(outEnd - out));
     }
+
+    *out = '\0';
 }
 
 size_t LogDecoder::decode(ELFDebugInfo &DI, SvmLogTag tag, uint32_t *buffer)
@@ -214,14 +332,14 @@ size_t LogDecoder::decode(ELFDebugInfo &DI, SvmLogTag tag, uint32_t *buffer)
         // Stow all arguments, plus the log tag. The post-processor
         // will do some printf()-like formatting on the stored arguments.
         case _SYS_LOGTYPE_FMT: {
-            std::string fmt = DI.readString(".debug_logstr", tag.getParam());
-            if (fmt.empty()) {
+            const FormatPlan &plan = getFormat(DI, tag.getParam());
+            if (!plan.found) {
                 LOG(("SVMLOG: No symbol table found. Raw data:\n"
                      "\t[%08x] %08x %08x %08x %08x %08x %08x %08x\n",
                      tag.getValue(), buffer[0], buffer[1], buffer[2],
                      buffer[3], buffer[4], buffer[5], buffer[6]));
             } else {
-                formatLog(DI, outBuffer, sizeof outBuffer, (char*) fmt.c_str(),
+                formatLog(DI, outBuffer, sizeof outBuffer, plan,
                     buffer, tag.getArity());
                 writeLog(outBuffer);
             }
@@ -272,6 +390,7 @@ void LogDecoder::writeLog(const char *str)
         if (System::getInstance().opt_flushLogs) {
             fflush(stdout);
         }
+        SimEvents::logLine(str);
     } else {
         scriptBuffer += str;
     }
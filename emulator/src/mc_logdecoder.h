@@ -30,6 +30,7 @@
 #include "mc_elfdebuginfo.h"
 #include "svmdebugpipe.h"
 #include <string>
+#include <vector>
 #include <map>
 
 class LogDecoder {
@@ -42,6 +43,11 @@ public:
     // Reset the internal state of the decoder
     void init();
 
+    // Forget cached format strings, when the program's ELF changes
+    void invalidateFormats() {
+        formats.clear();
+    }
+
     // Add a handler for a new kind of script
     void setScriptHandler(unsigned type, ScriptHandler handler);
 
@@ -50,8 +56,37 @@ public:
     size_t decode(ELFDebugInfo &DI, SvmLogTag tag, uint32_t *buffer);
 
 private:
+    // One piece of a parsed format string
+    struct FormatStep {
+        enum Type {
+            NONE,
+            LITERAL,        // Copy 'text'
+            POINTER,        // %p
+            SYMBOL,         // %P
+            BINARY,         // %b
+            INTEGER,        // formatInt()
+            PRINTF_INT,     // snprintf() with 'text'
+            PRINTF_FLOAT,   // snprintf() with 'text', single-precision argument
+            CHARS,          // %C
+        } type;
+
+        char conv;
+        bool leadingZero;
+        int width;
+        std::string text;
+    };
+
+    struct FormatPlan {
+        bool found;
+        std::vector<FormatStep> steps;
+    };
+
+    const FormatPlan &getFormat(ELFDebugInfo &DI, uint32_t offset);
+    static void compileFormat(const char *fmt, FormatPlan &plan);
+    static char *formatInt(char *out, char *outEnd, const FormatStep &step, uint32_t value);
+
     void formatLog(ELFDebugInfo &DI, char *out, size_t outSize,
-        char *fmt, uint32_t *args, size_t argCount);
+        const FormatPlan &plan, uint32_t *args, size_t argCount);
 
     void writeLog(const char *str);
     void runScript();
@@ -59,6 +94,7 @@ private:
     unsigned scriptType;
     std::string scriptBuffer;
     std::map<unsigned, ScriptHandler> handlers;
+    std::map<uint32_t, FormatPlan> formats;
 };
 
 #endif  // LOG_DECODER_H
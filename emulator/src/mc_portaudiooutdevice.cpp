@@ -33,7 +33,7 @@
 
 
 PortAudioOutDevice::PortAudioOutDevice() :
-    outStream(0), upsampleCounter(0), endOfStream(false) {}
+    outStream(0), upsampleCounter(0), endOfStream(false), stretchCounter(0) {}
 
 void PortAudioOutDevice::pullFromMixer()
 {
@@ -98,6 +98,7 @@ int PortAudioOutDevice::portAudioCallback(const void *inputBuffer, void *outputB
 
         int lastSample = self->lastSample;
         unsigned upsampleCounter = self->upsampleCounter;
+        bool stretch = ring.readAvailable() < self->bufferThreshold / 4;
 
         while (outputRemaining) {
             if (upsampleCounter == 0) {
@@ -129,6 +130,11 @@ int PortAudioOutDevice::portAudioCallback(const void *inputBuffer, void *outputB
                 self->endOfStream = false;
                 lastSample = sample;
                 upsampleCounter = kUpsampleFactor;
+
+                if (stretch && ++self->stretchCounter >= STRETCH_INTERVAL) {
+                    self->stretchCounter = 0;
+                    upsampleCounter++;
+                }
             }
             upsampleCounter--;
 
@@ -75,7 +75,63 @@ private:
      * buffer will quickly fill to its capacity and we want the upper-limit
      * on audio outout latency not to be too astronomical.
      */
-    typedef RingBuffer<0x10000, int16_t> SimBuffer_t;
+    class SimBuffer_t {
+    public:
+        /*
+         * Single-producer single-consumer ring, shared between the MC
+         * thread (writer, in pullFromMixer) and the PortAudio callback
+         * (reader). Each side owns one index, and publishes it with a
+         * barrier after touching the samples, so no locks are needed.
+         */
+
+        static const unsigned SIZE = 0x10000;   // Must be a power of two
+
+        void init() {
+            head = tail = 0;
+        }
+
+        unsigned capacity() const {
+            return SIZE - 1;
+        }
+
+        unsigned readAvailable() {
+            return (Atomic::Load(tail) - Atomic::Load(head)) & capacity();
+        }
+
+        bool empty() {
+            return readAvailable() == 0;
+        }
+
+        int16_t dequeue() {
+            ASSERT(!empty());
+            uint32_t h = head;
+            int16_t c = buf[h];
+            Atomic::Store(head, (h + 1) & capacity());
+            return c;
+        }
+
+        // Move samples from 'src' until we hold 'fillThreshold' of them
+        template <typename T>
+        void pull(T &src, unsigned fillThreshold) {
+            ASSERT(fillThreshold <= capacity());
+            unsigned fill = readAvailable();
+            if (fill >= fillThreshold)
+                return;
+
+            unsigned count = MIN(src.readAvailable(), fillThreshold - fill);
+            uint32_t t = tail;
+            while (count--) {
+                buf[t] = src.dequeue();
+                t = (t + 1) & capacity();
+            }
+            Atomic::Store(tail, t);
+        }
+
+    private:
+        uint32_t head;      // Written only by the consumer
+        uint32_t tail;      // Written only by the producer
+        int16_t buf[SIZE];
+    };
 
     /*
      * How long do we wait (in number of audio samples) before deciding
@@ -92,6 +148,16 @@ private:
      */
     static const unsigned FILL_THRESHOLD = 128;
 
+    /*
+     * Adaptive rate, for riding out MC thread hiccups. While the buffer is
+     * under a quarter of bufferThreshold, every STRETCH_INTERVAL'th sample
+     * is held for one extra output frame. That plays about 1% slower, so
+     * the MC thread can catch up before we'd have to underrun, and it's
+     * far less audible than a dropout.
+     */
+    static const unsigned STRETCH_INTERVAL = 32;
+    unsigned stretchCounter;
+
     SimBuffer_t simBuffer;
     uint32_t bufferFilling;     // Must be 32-bit (atomic access)
     uint32_t bufferThreshold;   // Number of samples we'd like to keep buffered
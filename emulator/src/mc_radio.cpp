@@ -37,6 +37,7 @@
 #include "mc_timing.h"
 #include "bits.h"
 #include "noise.h"
+#include "simevents.h"
 
 namespace RadioMC {
 
@@ -50,7 +51,30 @@ namespace RadioMC {
         unsigned triesRemaining;
     };
 
+    /*
+     * Our picture of the radio medium: the addresses that had a cube
+     * listening as of our last sync with the cube thread. A packet to
+     * any other address can't be received, so we can time it out
+     * without stopping the cubes at all.
+     *
+     * A cube may start listening on a new address between syncs. To
+     * bound how long we can miss that, we force a real sync after at
+     * most MAX_UNSYNCED_PACKETS packets. To the firmware, this looks
+     * just like a cube that took slightly longer to reconfigure its
+     * radio. The same limit keeps us from running too far ahead while
+     * the cube thread is halted.
+     */
+
+    struct Medium {
+        uint64_t listening[System::MAX_CUBES];
+        unsigned numListening;
+        unsigned unsyncedPackets;
+    };
+
+    static const unsigned MAX_UNSYNCED_PACKETS = 16;
+
     static Buffer buf;
+    static Medium medium;
     static double bitErrorRates[MAX_RF_CHANNEL + 1];
     static SysTime::Ticks lastNoiseUpdate;
 
@@ -58,6 +82,8 @@ namespace RadioMC {
     unsigned retryCount();
     bool testPacketLoss(unsigned bytes, unsigned channel);
     void updateRadioNoise(double noiseAmount);
+    void updateMedium(System *sys);
+    bool canSkipSync(bool enabled, const RadioAddress *addr);
 
     // total transmission attempts
     unsigned maxTries() {
@@ -133,6 +159,44 @@ void RadioMC::updateRadioNoise(double noiseAmount)
     }
 }
 
+void RadioMC::updateMedium(System *sys)
+{
+    /*
+     * Snapshot the set of listening cube addresses. Only valid between
+     * beginEvent() and endEvent().
+     */
+
+    medium.numListening = 0;
+    medium.unsyncedPackets = 0;
+
+    for (unsigned i = 0; i < sys->opt_numCubes; i++) {
+        Cube::Hardware &cube = sys->cubes[i];
+        if (cube.isRadioClockRunning())
+            medium.listening[medium.numListening++] = cube.spi.radio.getPackedRXAddr();
+    }
+}
+
+bool RadioMC::canSkipSync(bool enabled, const RadioAddress *addr)
+{
+    /*
+     * Can we skip synchronizing with the cubes for this packet slot?
+     * Yes if the radio is off, or nobody is listening on 'addr'.
+     */
+
+    if (medium.unsyncedPackets >= MAX_UNSYNCED_PACKETS)
+        return false;
+
+    if (!enabled)
+        return true;
+
+    uint64_t packed = addr->pack();
+    for (unsigned i = 0; i < medium.numListening; i++)
+        if (medium.listening[i] == packed)
+            return false;
+
+    return true;
+}
+
 void RadioMC::trace()
 {
     LOG(("RADIO: %6dms %02x/%02x%02x%02x%02x%02x -- TX[%2d] ",
@@ -253,9 +317,24 @@ void SystemMC::doRadioPacket()
 
     RadioMC::updateRadioNoise(sys->opt_radioNoise);
 
-    sys->getCubeSync().beginEventAt(radioPacketDeadline, mThreadRunning);
+    bool enabled = RadioManager::isRadioEnabled();
+
+    if (RadioMC::canSkipSync(enabled, buf.ptx.dest)) {
+        /*
+         * Nobody to deliver to. Let the cubes keep running through this
+         * packet slot, without a round trip to the cube thread.
+         */
+
+        buf.ack = false;
+        buf.ackCube = -1;
+        RadioMC::medium.unsyncedPackets++;
+
+        radioPacketDeadline += MCTiming::TICKS_PER_PACKET;
+        sys->getCubeSync().extendDeadline(cubeSyncDeadline());
+
+    } else {
+        sys->getCubeSync().beginEventAt(radioPacketDeadline, mThreadRunning);
 
-    if (RadioManager::isRadioEnabled()) {
         bool dropped = sys->opt_radioNoise &&
             RadioMC::testPacketLoss(buf.packet.len, buf.ptx.dest->channel);
 
@@ -264,14 +343,17 @@ void SystemMC::doRadioPacket()
         buf.ack = cube && cube->isRadioClockRunning()
             && !dropped && cube->spi.radio.handlePacket(buf.packet, buf.reply);
         buf.ackCube = cube ? cube->id() : -1;
-    }
 
-    radioPacketDeadline += MCTiming::TICKS_PER_PACKET;
-    sys->getCubeSync().endEvent(radioPacketDeadline);
+        RadioMC::updateMedium(sys);
+
+        radioPacketDeadline += MCTiming::TICKS_PER_PACKET;
+        sys->getCubeSync().endEvent(cubeSyncDeadline());
+    }
 
-    if (RadioManager::isRadioEnabled()) {
+    if (enabled) {
 
         --buf.triesRemaining;
+        radioPackets++;
 
         if (sys->opt_radioTrace)
             RadioMC::trace();
@@ -279,6 +361,8 @@ void SystemMC::doRadioPacket()
         if (buf.ack) {
             // Send response, and we're done
 
+            SimEvents::radioAck();
+
             if (buf.reply.len) {
                 buf.prx.len = buf.reply.len;
                 RadioManager::ackWithPacket(buf.prx, RadioMC::retryCount());
@@ -32,6 +32,7 @@
 #include "system.h"
 #include "system_mc.h"
 #include "svmmemory.h"
+#include "flash_blockcache.h"
 
 #include <string.h>
 
@@ -47,24 +48,46 @@ UserRegs userRegs;
 
 /*
  * First-level cycle counter. During instruction emulation, we increment this
- * as appropriate. Periodically (on every taken branch or SVC, currently)
- * we forward any whole clock ticks to SystemMC::elapseTicks() via
- * calculateElapsedTicks().
+ * as appropriate. Values in here are pre-multiplied by the
+ * CPU_RATE_DENOMINATOR. To convert to system ticks, we just need to divide
+ * by CPU_RATE_NUMERATOR and save the remainder.
  *
- * Values in here are pre-multiplied by the CPU_RATE_DENOMINATOR. To convert
- * to system ticks, we just need to divide by CPU_RATE_NUMERATOR and save
- * the remainder.
+ * We only forward whole clock ticks to SystemMC::elapseTicks() when they're
+ * needed: after every SVC, and when the counter reaches svmCycleBudget.
+ * SystemMC sets the budget via setTickBudget() so that it expires right
+ * when the next asynchronous event (radio packet, heartbeat) is due. On
+ * taken branches, calculateElapsedTicks() just compares the two.
  */
 static unsigned svmCyclesElapsed;
+static unsigned svmCycleBudget;
 
-static void calculateElapsedTicks()
+// Instructions retired, for benchmarking. Never reset.
+static uint64_t svmInstructions;
+
+uint64_t instructionCount()
+{
+    return svmInstructions;
+}
+
+void setTickBudget(uint64_t ticks)
+{
+    // Limit the budget so that svmCyclesElapsed can never overflow
+    const uint64_t maxTicks = 0x10000000 / MCTiming::CPU_RATE_NUMERATOR;
+    svmCycleBudget = MIN(ticks, maxTicks) * MCTiming::CPU_RATE_NUMERATOR;
+}
+
+static void flushElapsedTicks()
 {
     unsigned elapsed = svmCyclesElapsed;
-    if (elapsed >= MCTiming::CPU_THRESHOLD) {
-        unsigned ticks = elapsed / MCTiming::CPU_RATE_NUMERATOR;
-        svmCyclesElapsed = elapsed % MCTiming::CPU_RATE_NUMERATOR;
-        SystemMC::elapseTicks(ticks);
-    }
+    unsigned ticks = elapsed / MCTiming::CPU_RATE_NUMERATOR;
+    svmCyclesElapsed = elapsed % MCTiming::CPU_RATE_NUMERATOR;
+    SystemMC::elapseTicks(ticks);
+}
+
+static ALWAYS_INLINE void calculateElapsedTicks()
+{
+    if (UNLIKELY(svmCyclesElapsed >= svmCycleBudget))
+        flushElapsedTicks();
 }
 
 
@@ -249,7 +272,7 @@ static void restoreUserRegs()
     regs[11] = userRegs.irq.r11;
 }
 
-static void emulateSVC(uint16_t instr)
+static void emulateSVC(uint32_t instr)
 {
     reg_t nextInstruction = regs[REG_PC];    // already incremented in fetch()
     emulateEnterException(nextInstruction);
@@ -260,9 +283,9 @@ static void emulateSVC(uint16_t instr)
 
     restoreUserRegs();
     emulateExitException();
-    calculateElapsedTicks();
+    flushElapsedTicks();
 
-    SystemMC::elapseTicks(MCTiming::TICKS_PER_SVC);
+    SystemMC::elapseTicks(MCTiming::TICKS_PER_SVC, SvmProfiler::SVC);
 }
 
 static void emulateFault(FaultCode code)
@@ -281,6 +304,8 @@ static void emulateFault(FaultCode code)
     emulateEnterException(nextInstruction);
     saveUserRegs();
 
+    Tracer::trigger("SVM fault");
+
     // Faults occur inside exception context too, just like SVCs.
     SvmRuntime::fault(code);
 
@@ -294,7 +319,7 @@ static void emulateFault(FaultCode code)
  ***************************************************************************/
 
 // left shift
-static void emulateLSLImm(uint16_t inst)
+static void emulateLSLImm(uint32_t inst)
 {
     unsigned imm5 = (inst >> 6) & 0x1f;
     unsigned Rm = (inst >> 3) & 0x7;
@@ -303,7 +328,7 @@ static void emulateLSLImm(uint16_t inst)
     regs[Rd] = opLSL(regs[Rm], imm5);
 }
 
-static void emulateLSRImm(uint16_t inst)
+static void emulateLSRImm(uint32_t inst)
 {
     unsigned imm5 = (inst >> 6) & 0x1f;
     unsigned Rm = (inst >> 3) & 0x7;
@@ -315,7 +340,7 @@ static void emulateLSRImm(uint16_t inst)
     regs[Rd] = opLSR(regs[Rm], imm5);
 }
 
-static void emulateASRImm(uint16_t instr)
+static void emulateASRImm(uint32_t instr)
 {
     unsigned imm5 = (instr >> 6) & 0x1f;
     unsigned Rm = (instr >> 3) & 0x7;
@@ -327,7 +352,7 @@ static void emulateASRImm(uint16_t instr)
     regs[Rd] = opASR(regs[Rm], imm5);
 }
 
-static void emulateADDReg(uint16_t instr)
+static void emulateADDReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 6) & 0x7;
     unsigned Rn = (instr >> 3) & 0x7;
@@ -336,7 +361,7 @@ static void emulateADDReg(uint16_t instr)
     regs[Rd] = opADD(regs[Rn], regs[Rm], 0);
 }
 
-static void emulateSUBReg(uint16_t instr)
+static void emulateSUBReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 6) & 0x7;
     unsigned Rn = (instr >> 3) & 0x7;
@@ -345,7 +370,7 @@ static void emulateSUBReg(uint16_t instr)
     regs[Rd] = opADD(regs[Rn], ~regs[Rm], 1);
 }
 
-static void emulateADD3Imm(uint16_t instr)
+static void emulateADD3Imm(uint32_t instr)
 {
     reg_t imm3 = (instr >> 6) & 0x7;
     unsigned Rn = (instr >> 3) & 0x7;
@@ -354,7 +379,7 @@ static void emulateADD3Imm(uint16_t instr)
     regs[Rd] = opADD(regs[Rn], imm3, 0);
 }
 
-static void emulateSUB3Imm(uint16_t instr)
+static void emulateSUB3Imm(uint32_t instr)
 {
     reg_t imm3 = (instr >> 6) & 0x7;
     unsigned Rn = (instr >> 3) & 0x7;
@@ -363,7 +388,7 @@ static void emulateSUB3Imm(uint16_t instr)
     regs[Rd] = opADD(regs[Rn], ~imm3, 1);
 }
 
-static void emulateMovImm(uint16_t instr)
+static void emulateMovImm(uint32_t instr)
 {
     unsigned Rd = (instr >> 8) & 0x7;
     unsigned imm8 = instr & 0xff;
@@ -371,7 +396,7 @@ static void emulateMovImm(uint16_t instr)
     regs[Rd] = imm8;
 }
 
-static void emulateCmpImm(uint16_t instr)
+static void emulateCmpImm(uint32_t instr)
 {
     unsigned Rn = (instr >> 8) & 0x7;
     reg_t imm8 = instr & 0xff;
@@ -379,7 +404,7 @@ static void emulateCmpImm(uint16_t instr)
     reg_t result = opADD(regs[Rn], ~imm8, 1);
 }
 
-static void emulateADD8Imm(uint16_t instr)
+static void emulateADD8Imm(uint32_t instr)
 {
     unsigned Rdn = (instr >> 8) & 0x7;
     reg_t imm8 = instr & 0xff;
@@ -387,7 +412,7 @@ static void emulateADD8Imm(uint16_t instr)
     regs[Rdn] = opADD(regs[Rdn], imm8, 0);
 }
 
-static void emulateSUB8Imm(uint16_t instr)
+static void emulateSUB8Imm(uint32_t instr)
 {
     unsigned Rdn = (instr >> 8) & 0x7;
     reg_t imm8 = instr & 0xff;
@@ -399,7 +424,7 @@ static void emulateSUB8Imm(uint16_t instr)
 // D A T A   P R O C E S S I N G
 ///////////////////////////////////
 
-static void emulateANDReg(uint16_t instr)
+static void emulateANDReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -407,7 +432,7 @@ static void emulateANDReg(uint16_t instr)
     regs[Rdn] = opAND(regs[Rdn], regs[Rm]);
 }
 
-static void emulateEORReg(uint16_t instr)
+static void emulateEORReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -415,7 +440,7 @@ static void emulateEORReg(uint16_t instr)
     regs[Rdn] = opEOR(regs[Rdn], regs[Rm]);
 }
 
-static void emulateLSLReg(uint16_t instr)
+static void emulateLSLReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -424,7 +449,7 @@ static void emulateLSLReg(uint16_t instr)
     regs[Rdn] = opLSL(regs[Rdn], shift);
 }
 
-static void emulateLSRReg(uint16_t instr)
+static void emulateLSRReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -433,7 +458,7 @@ static void emulateLSRReg(uint16_t instr)
     regs[Rdn] = opLSR(regs[Rdn], shift);
 }
 
-static void emulateASRReg(uint16_t instr)
+static void emulateASRReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -442,7 +467,7 @@ static void emulateASRReg(uint16_t instr)
     regs[Rdn] = opASR(regs[Rdn], shift);
 }
 
-static void emulateADCReg(uint16_t instr)
+static void emulateADCReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -450,7 +475,7 @@ static void emulateADCReg(uint16_t instr)
     regs[Rdn] = opADD(regs[Rdn], regs[Rm], getCarry());
 }
 
-static void emulateSBCReg(uint16_t instr)
+static void emulateSBCReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -458,7 +483,7 @@ static void emulateSBCReg(uint16_t instr)
     regs[Rdn] = opADD(regs[Rdn], ~regs[Rm], getCarry());
 }
 
-static void emulateRORReg(uint16_t instr)
+static void emulateRORReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -466,7 +491,7 @@ static void emulateRORReg(uint16_t instr)
     regs[Rdn] = Intrinsic::ROR(regs[Rdn], regs[Rm]);
 }
 
-static void emulateTSTReg(uint16_t instr)
+static void emulateTSTReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -474,7 +499,7 @@ static void emulateTSTReg(uint16_t instr)
     opAND(regs[Rdn], regs[Rm]);
 }
 
-static void emulateRSBImm(uint16_t instr)
+static void emulateRSBImm(uint32_t instr)
 {
     unsigned Rn = (instr >> 3) & 0x7;
     unsigned Rd = instr & 0x7;
@@ -482,7 +507,7 @@ static void emulateRSBImm(uint16_t instr)
     regs[Rd] = opADD(~regs[Rn], 0, 1);
 }
 
-static void emulateCMPReg(uint16_t instr)
+static void emulateCMPReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -490,7 +515,7 @@ static void emulateCMPReg(uint16_t instr)
     opADD(regs[Rdn], ~regs[Rm], 1);
 }
 
-static void emulateCMNReg(uint16_t instr)
+static void emulateCMNReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -498,7 +523,7 @@ static void emulateCMNReg(uint16_t instr)
     opADD(regs[Rdn], regs[Rm], 0);
 }
 
-static void emulateORRReg(uint16_t instr)
+static void emulateORRReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -508,7 +533,7 @@ static void emulateORRReg(uint16_t instr)
     setNZ(result);
 }
 
-static void emulateMUL(uint16_t instr)
+static void emulateMUL(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -521,7 +546,7 @@ static void emulateMUL(uint16_t instr)
     setZero(result == 0);
 }
 
-static void emulateBICReg(uint16_t instr)
+static void emulateBICReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -529,7 +554,7 @@ static void emulateBICReg(uint16_t instr)
     regs[Rdn] = (uint32_t) (regs[Rdn] & ~(regs[Rm]));
 }
 
-static void emulateMVNReg(uint16_t instr)
+static void emulateMVNReg(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -541,7 +566,7 @@ static void emulateMVNReg(uint16_t instr)
 // M I S C   I N S T R U C T I O N S
 /////////////////////////////////////
 
-static void emulateSXTH(uint16_t instr)
+static void emulateSXTH(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -549,7 +574,7 @@ static void emulateSXTH(uint16_t instr)
     regs[Rdn] = (uint32_t) signExtend(regs[Rm], 16);
 }
 
-static void emulateSXTB(uint16_t instr)
+static void emulateSXTB(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -557,7 +582,7 @@ static void emulateSXTB(uint16_t instr)
     regs[Rdn] = (uint32_t) signExtend(regs[Rm], 8);
 }
 
-static void emulateUXTH(uint16_t instr)
+static void emulateUXTH(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -565,7 +590,7 @@ static void emulateUXTH(uint16_t instr)
     regs[Rdn] = regs[Rm] & 0xFFFF;
 }
 
-static void emulateUXTB(uint16_t instr)
+static void emulateUXTB(uint32_t instr)
 {
     unsigned Rm = (instr >> 3) & 0x7;
     unsigned Rdn = instr & 0x7;
@@ -573,7 +598,7 @@ static void emulateUXTB(uint16_t instr)
     regs[Rdn] = regs[Rm] & 0xFF;
 }
 
-static void emulateMOV(uint16_t instr)
+static void emulateMOV(uint32_t instr)
 {
     // Thumb T5 encoding, does not affect flags.
     // This subset does not support high register access.
@@ -589,7 +614,7 @@ static void emulateMOV(uint16_t instr)
 // B R A N C H I N G   I N S T R U C T I O N S
 ///////////////////////////////////////////////
 
-static void emulateB(uint16_t instr)
+static void emulateB(uint32_t instr)
 {
     reg_t oldPC = regs[REG_PC];
     reg_t newPC = branchTargetB(instr, oldPC);
@@ -602,7 +627,7 @@ static void emulateB(uint16_t instr)
 }
 
 
-static void emulateCondB(uint16_t instr)
+static void emulateCondB(uint32_t instr)
 {
     reg_t oldPC = regs[REG_PC];
     reg_t newPC = branchTargetCondB(instr, oldPC, regs[REG_CPSR]);
@@ -614,7 +639,7 @@ static void emulateCondB(uint16_t instr)
     }
 }
 
-static void emulateCBZ_CBNZ(uint16_t instr)
+static void emulateCBZ_CBNZ(uint32_t instr)
 {
     unsigned Rn = instr & 0x7;
     reg_t oldPC = regs[REG_PC];
@@ -632,7 +657,7 @@ static void emulateCBZ_CBNZ(uint16_t instr)
 // M E M O R Y  I N S T R U C T I O N S
 /////////////////////////////////////////
 
-static void emulateSTRSPImm(uint16_t instr)
+static void emulateSTRSPImm(uint32_t instr)
 {
     // encoding T2 only
     unsigned Rt = (instr >> 8) & 0x7;
@@ -649,7 +674,7 @@ static void emulateSTRSPImm(uint16_t instr)
     svmCyclesElapsed += MCTiming::CPU_LOAD_STORE;
 }
 
-static void emulateLDRSPImm(uint16_t instr)
+static void emulateLDRSPImm(uint32_t instr)
 {
     // encoding T2 only
     unsigned Rt = (instr >> 8) & 0x7;
@@ -666,7 +691,7 @@ static void emulateLDRSPImm(uint16_t instr)
     svmCyclesElapsed += MCTiming::CPU_LOAD_STORE;
 }
 
-static void emulateADDSpImm(uint16_t instr)
+static void emulateADDSpImm(uint32_t instr)
 {
     // encoding T1 only
     unsigned Rd = (instr >> 8) & 0x7;
@@ -698,7 +723,7 @@ static void emulateADDSpImm(uint16_t instr)
     regs[Rd] = SvmMemory::squashPhysicalAddr(regs[REG_SP]) + (imm8 << 2);
 }
 
-static void emulateLDRLitPool(uint16_t instr)
+static void emulateLDRLitPool(uint32_t instr)
 {
     unsigned Rt = (instr >> 8) & 0x7;
     unsigned imm8 = instr & 0xFF;
@@ -901,47 +926,36 @@ static void traceFetch(uint16_t *pc)
         reinterpret_cast<void*>(regs[REG_FP])));
 }
 
-static uint16_t fetch()
+static void emulateNop(uint32_t instr)
 {
-    /*
-     * Fetch the next instruction.
-     * We can return 16bit values unconditionally, since all our instructions are Thumb,
-     * and the first nibble of a 32-bit instruction must be checked regardless
-     * in order to determine its bitness.
-     */
+    // nothing to do
+}
 
-    svmCyclesElapsed += MCTiming::CPU_FETCH;
+static void emulateInvalid16(uint32_t instr)
+{
+    LOG(("SVMCPU: invalid 16bit instruction: 0x%x\n", instr));
+    return emulateFault(F_CPU_SIM);
+}
 
-    if (!SvmMemory::isAddrValid(regs[REG_PC])) {
-        emulateFault(F_CODE_FETCH);
-        return Nop;
-    }
-    if (!SvmMemory::isAddrAligned(regs[REG_PC], 2)) {
-        emulateFault(F_LOAD_ALIGNMENT);
-        return Nop;
-    }
+static void emulateInvalid32(uint32_t instr)
+{
+    LOG(("SVMCPU: invalid 32bit instruction: 0x%x\n", instr));
+    return emulateFault(F_CPU_SIM);
+}
 
-    /*
-     * As we execute, check that each address we hit is
-     * part of a valid bundle according to SvmValidator. This
-     * serves to double-check both the validator and this runtime.
-     */
-    DEBUG_ONLY({
-        SvmMemory::VirtAddr bundleVA = SvmRuntime::reconstructCodeAddr(regs[REG_PC]);
-        SvmMemory::PhysAddr pa;
-        FlashBlockRef ref;
-        bundleVA &= ~(Svm::BUNDLE_SIZE - 1);
-        ASSERT(SvmMemory::mapROCode(ref, bundleVA, pa));
-    });
 
-    uint16_t *pc = reinterpret_cast<uint16_t*>(regs[REG_PC]);
-    TRACING_ONLY(traceFetch(pc));
+/***************************************************************************
+ * Instruction Decoding
+ ***************************************************************************/
 
-    regs[REG_PC] += sizeof(uint16_t);
-    return *pc;
-}
+/*
+ * Decoding maps an instruction to the function which emulates it. All
+ * handlers take a 32-bit argument, so the 16-bit and 32-bit instructions
+ * can share one Handler type in the decode cache below.
+ */
+typedef void (*Handler)(uint32_t instr);
 
-static void execute16(uint16_t instr)
+static Handler decode16(uint16_t instr)
 {
     if ((instr & AluMask) == AluTest) {
         // lsl, lsr, asr, add, sub, mov, cmp
@@ -949,158 +963,358 @@ static void execute16(uint16_t instr)
         uint8_t prefix = (instr >> 11) & 0x7;
         switch (prefix) {
         case 0: // 0b000 - LSL
-            emulateLSLImm(instr);
-            return;
+            return emulateLSLImm;
         case 1: // 0b001 - LSR
-            emulateLSRImm(instr);
-            return;
+            return emulateLSRImm;
         case 2: // 0b010 - ASR
-            emulateASRImm(instr);
-            return;
+            return emulateASRImm;
         case 3: { // 0b011 - ADD/SUB reg/imm
             uint8_t subop = (instr >> 9) & 0x3;
             switch (subop) {
             case 0:
-                emulateADDReg(instr);
-                return;
+                return emulateADDReg;
             case 1:
-                emulateSUBReg(instr);
-                return;
+                return emulateSUBReg;
             case 2:
-                emulateADD3Imm(instr);
-                return;
+                return emulateADD3Imm;
             case 3:
-                emulateADD8Imm(instr);
-                return;
+                return emulateADD8Imm;
             }
         }
         case 4: // 0b100 - MOV
-            emulateMovImm(instr);
-            return;
+            return emulateMovImm;
         case 5: // 0b101
-            emulateCmpImm(instr);
-            return;
+            return emulateCmpImm;
         case 6: // 0b110 - ADD 8bit
-            emulateADD8Imm(instr);
-            return;
+            return emulateADD8Imm;
         case 7: // 0b111 - SUB 8bit
-            emulateSUB8Imm(instr);
-            return;
+            return emulateSUB8Imm;
         }
         ASSERT(0 && "unhandled ALU instruction!");
     }
     if ((instr & DataProcMask) == DataProcTest) {
         uint8_t opcode = (instr >> 6) & 0xf;
         switch (opcode) {
-        case 0:  emulateANDReg(instr); return;
-        case 1:  emulateEORReg(instr); return;
-        case 2:  emulateLSLReg(instr); return;
-        case 3:  emulateLSRReg(instr); return;
-        case 4:  emulateASRReg(instr); return;
-        case 5:  emulateADCReg(instr); return;
-        case 6:  emulateSBCReg(instr); return;
-        case 7:  emulateRORReg(instr); return;
-        case 8:  emulateTSTReg(instr); return;
-        case 9:  emulateRSBImm(instr); return;
-        case 10: emulateCMPReg(instr); return;
-        case 11: emulateCMNReg(instr); return;
-        case 12: emulateORRReg(instr); return;
-        case 13: emulateMUL(instr);    return;
-        case 14: emulateBICReg(instr); return;
-        case 15: emulateMVNReg(instr); return;
+        case 0:  return emulateANDReg;
+        case 1:  return emulateEORReg;
+        case 2:  return emulateLSLReg;
+        case 3:  return emulateLSRReg;
+        case 4:  return emulateASRReg;
+        case 5:  return emulateADCReg;
+        case 6:  return emulateSBCReg;
+        case 7:  return emulateRORReg;
+        case 8:  return emulateTSTReg;
+        case 9:  return emulateRSBImm;
+        case 10: return emulateCMPReg;
+        case 11: return emulateCMNReg;
+        case 12: return emulateORRReg;
+        case 13: return emulateMUL;
+        case 14: return emulateBICReg;
+        case 15: return emulateMVNReg;
         }
     }
     if ((instr & MiscMask) == MiscTest) {
         uint8_t opcode = (instr >> 5) & 0x7f;
         if ((opcode & 0x78) == 0x2) {   // bits [6:3] of opcode identify this group
             switch (opcode & 0x6) {     // bits [2:1] of the opcode identify the instr
-            case 0: emulateSXTH(instr); return;
-            case 1: emulateSXTB(instr); return;
-            case 2: emulateUXTH(instr); return;
-            case 3: emulateUXTB(instr); return;
+            case 0: return emulateSXTH;
+            case 1: return emulateSXTB;
+            case 2: return emulateUXTH;
+            case 3: return emulateUXTB;
             }
         }
     }
     if ((instr & MovMask) == MovTest) {
-        emulateMOV(instr);
-        return;
+        return emulateMOV;
     }    
     if ((instr & SvcMask) == SvcTest) {
-        emulateSVC(instr);
-        return;
+        return emulateSVC;
     }
     if ((instr & PcRelLdrMask) == PcRelLdrTest) {
-        emulateLDRLitPool(instr);
-        return;
+        return emulateLDRLitPool;
     }
     if ((instr & SpRelLdrStrMask) == SpRelLdrStrTest) {
         uint16_t isLoad = instr & (1 << 11);
         if (isLoad)
-            emulateLDRSPImm(instr);
+            return emulateLDRSPImm;
         else
-            emulateSTRSPImm(instr);
-        return;
+            return emulateSTRSPImm;
     }
     if ((instr & SpRelAddMask) == SpRelAddTest) {
-        emulateADDSpImm(instr);
-        return;
+        return emulateADDSpImm;
     }
     if ((instr & UncondBranchMask) == UncondBranchTest) {
-        emulateB(instr);
-        return;
+        return emulateB;
     }
     if ((instr & CompareBranchMask) == CompareBranchTest) {
-        emulateCBZ_CBNZ(instr);
-        return;
+        return emulateCBZ_CBNZ;
     }
     if ((instr & CondBranchMask) == CondBranchTest) {
-        emulateCondB(instr);
-        return;
+        return emulateCondB;
     }
     if (instr == Nop) {
         // nothing to do
-        return;
+        return emulateNop;
     }
 
     // should never get here since we should only be executing validated instructions
-    LOG(("SVMCPU: invalid 16bit instruction: 0x%x\n", instr));
-    return emulateFault(F_CPU_SIM);
+    return emulateInvalid16;
 }
 
-static void execute32(uint32_t instr)
+static Handler decode32(uint32_t instr)
 {
     if ((instr & StrMask) == StrTest) {
-        emulateSTR(instr);
-        return;
+        return emulateSTR;
     }
     if ((instr & StrBhMask) == StrBhTest) {
-        emulateSTRBH(instr);
-        return;
+        return emulateSTRBH;
     }
     if ((instr & LdrBhMask) == LdrBhTest) {
-        emulateLDRBH(instr);
-        return;
+        return emulateLDRBH;
     }
     if ((instr & LdrMask) == LdrTest) {
-        emulateLDR(instr);
-        return;
+        return emulateLDR;
     }
     if ((instr & MovWtMask) == MovWtTest) {
-        emulateMOVWT(instr);
-        return;
+        return emulateMOVWT;
     }
     if ((instr & DivMask) == DivTest) {
-        emulateDIV(instr);
-        return;
+        return emulateDIV;
     }
     if ((instr & ClzMask) == ClzTest) {
-        emulateCLZ(instr);
-        return;
+        return emulateCLZ;
     }
 
     // should never get here since we should only be executing validated instructions
-    LOG(("SVMCPU: invalid 32bit instruction: 0x%x\n", instr));
-    return emulateFault(F_CPU_SIM);
+    return emulateInvalid32;
+}
+
+
+
+/***************************************************************************
+ * Predecoded Instruction Cache
+ ***************************************************************************/
+
+/*
+ * All code executes from the flash block cache, so we keep one decoded
+ * instruction for every halfword in that cache. Entries are decoded lazily,
+ * the first time each address executes, and a block's entries are cleared
+ * by invalidateDecodeCache() whenever FlashBlock changes its contents.
+ *
+ * The entry for a 32-bit instruction lives at the address of its first
+ * halfword, and holds both halves.
+ */
+
+struct DecodedInstr {
+    Handler handler;        // NULL if not yet decoded
+    uint32_t instr;
+    uint8_t size;           // Size in bytes
+    uint8_t blockLength;    // Instructions in the basic block starting here
+    uint8_t blockHalfwords; // Total size of that basic block, in halfwords
+};
+
+static const unsigned DECODED_PER_BLOCK = FlashBlock::BLOCK_SIZE / sizeof(uint16_t);
+static DecodedInstr decodeCache[FlashBlock::NUM_CACHE_BLOCKS * DECODED_PER_BLOCK];
+
+void invalidateDecodeCache(unsigned blockID)
+{
+    ASSERT(blockID < FlashBlock::NUM_CACHE_BLOCKS);
+    memset(&decodeCache[blockID * DECODED_PER_BLOCK], 0,
+        DECODED_PER_BLOCK * sizeof decodeCache[0]);
+}
+
+static void decode(DecodedInstr &d, const uint16_t *pc)
+{
+    uint16_t instr = pc[0];
+    if (instructionSize(instr) == InstrBits16) {
+        d.instr = instr;
+        d.size = sizeof(uint16_t);
+        d.handler = decode16(instr);
+    } else {
+        d.instr = instr << 16 | pc[1];
+        d.size = sizeof(uint32_t);
+        d.handler = decode32(d.instr);
+    }
+}
+
+static const DecodedInstr &fetch()
+{
+    /*
+     * Fetch and decode the next instruction, advancing the PC past it.
+     * Each halfword is charged as a separate fetch, as it would be on
+     * hardware. Decoding normally comes from the cache.
+     */
+
+    static const DecodedInstr faulted = { emulateNop, Nop, sizeof(uint16_t), 0, 0 };
+    static DecodedInstr uncached;
+
+    svmCyclesElapsed += MCTiming::CPU_FETCH;
+    svmInstructions++;
+
+    if (!SvmMemory::isAddrValid(regs[REG_PC])) {
+        emulateFault(F_CODE_FETCH);
+        return faulted;
+    }
+    if (!SvmMemory::isAddrAligned(regs[REG_PC], 2)) {
+        emulateFault(F_LOAD_ALIGNMENT);
+        return faulted;
+    }
+
+    /*
+     * As we execute, check that each address we hit is
+     * part of a valid bundle according to SvmValidator. This
+     * serves to double-check both the validator and this runtime.
+     */
+    DEBUG_ONLY({
+        SvmMemory::VirtAddr bundleVA = SvmRuntime::reconstructCodeAddr(regs[REG_PC]);
+        SvmMemory::PhysAddr pa;
+        FlashBlockRef ref;
+        bundleVA &= ~(Svm::BUNDLE_SIZE - 1);
+        ASSERT(SvmMemory::mapROCode(ref, bundleVA, pa));
+    });
+
+    uint16_t *pc = reinterpret_cast<uint16_t*>(regs[REG_PC]);
+    uintptr_t index = FlashBlock::cacheOffset(regs[REG_PC]) / sizeof(uint16_t);
+    DecodedInstr *d;
+
+    if (LIKELY(index < arraysize(decodeCache))) {
+        d = &decodeCache[index];
+        if (UNLIKELY(!d->handler))
+            decode(*d, pc);
+    } else {
+        // Not in the block cache. Shouldn't happen, but it's harmless.
+        d = &uncached;
+        decode(*d, pc);
+    }
+
+    TRACING_ONLY(traceFetch(pc));
+    regs[REG_PC] += sizeof(uint16_t);
+
+    if (d->size != sizeof(uint16_t)) {
+        svmCyclesElapsed += MCTiming::CPU_FETCH;
+        TRACING_ONLY(traceFetch(pc + 1));
+        regs[REG_PC] += sizeof(uint16_t);
+    }
+
+    return *d;
+}
+
+
+/***************************************************************************
+ * Basic Block Translation
+ ***************************************************************************/
+
+/*
+ * Optionally, with --svm-translate, we translate runs of straight-line
+ * code into basic blocks of predecoded instructions. A block covers
+ * everything from its first instruction to the next branch or SVC, or
+ * the end of its flash block, whichever comes first. Blocks are executed
+ * without per-instruction fetch checks, and all fetch cycles are charged
+ * up-front.
+ *
+ * Only the block terminator calls calculateElapsedTicks(), so the cycle
+ * count it sees is exactly what the interpreter would have seen. If we
+ * leave a block early (due to a fault), fetch cycles for the instructions
+ * we didn't run are refunded.
+ *
+ * Translations live in the decode cache, and are discarded with it.
+ * Tracing always uses the interpreter.
+ */
+
+static bool endsBlock(Handler h)
+{
+    return h == emulateB || h == emulateCondB || h == emulateCBZ_CBNZ
+        || h == emulateSVC || h == emulateInvalid16 || h == emulateInvalid32;
+}
+
+static void translate(uintptr_t index, const uint16_t *pc)
+{
+    DecodedInstr &first = decodeCache[index];
+    uintptr_t blockEnd = (index | (DECODED_PER_BLOCK - 1)) + 1;
+    unsigned length = 0;
+    unsigned halfwords = 0;
+
+    while (index + halfwords < blockEnd) {
+        DecodedInstr &d = decodeCache[index + halfwords];
+
+        if (!d.handler) {
+            // 32-bit instructions must not straddle the end of the block
+            if (index + halfwords + 1 == blockEnd
+                && instructionSize(pc[halfwords]) != InstrBits16)
+                break;
+
+            decode(d, pc + halfwords);
+        }
+
+        length++;
+        halfwords += d.size / sizeof(uint16_t);
+
+        if (endsBlock(d.handler))
+            break;
+    }
+
+    first.blockLength = length;
+    first.blockHalfwords = halfwords;
+}
+
+static DecodedInstr *fetchBlock()
+{
+    /*
+     * Look up (or create) the basic block at the current PC. Returns NULL
+     * if this PC should go through the normal fetch() path instead.
+     */
+
+    reg_t pc = regs[REG_PC];
+    if (!SvmMemory::isAddrValid(pc) || !SvmMemory::isAddrAligned(pc, 2))
+        return NULL;
+
+    uintptr_t index = FlashBlock::cacheOffset(pc) / sizeof(uint16_t);
+    if (UNLIKELY(index >= arraysize(decodeCache)))
+        return NULL;
+
+    DEBUG_ONLY({
+        SvmMemory::VirtAddr bundleVA = SvmRuntime::reconstructCodeAddr(pc);
+        SvmMemory::PhysAddr pa;
+        FlashBlockRef ref;
+        bundleVA &= ~(Svm::BUNDLE_SIZE - 1);
+        ASSERT(SvmMemory::mapROCode(ref, bundleVA, pa));
+    });
+
+    DecodedInstr *d = &decodeCache[index];
+    if (UNLIKELY(!d->blockLength)) {
+        translate(index, reinterpret_cast<const uint16_t*>(pc));
+        if (!d->blockLength)
+            return NULL;
+    }
+
+    return d;
+}
+
+static void runBlock(DecodedInstr *d)
+{
+    unsigned remaining = d->blockLength;
+    unsigned halfwords = d->blockHalfwords;
+
+    svmCyclesElapsed += halfwords * MCTiming::CPU_FETCH;
+
+    for (;;) {
+        reg_t nextPC = regs[REG_PC] + d->size;
+        halfwords -= d->size / sizeof(uint16_t);
+        regs[REG_PC] = nextPC;
+
+        d->handler(d->instr);
+        svmInstructions++;
+
+        if (!--remaining)
+            return;
+
+        // Left the block, or its translation was invalidated?
+        d += d->size / sizeof(uint16_t);
+        if (UNLIKELY(regs[REG_PC] != nextPC || !d->handler)) {
+            svmCyclesElapsed -= halfwords * MCTiming::CPU_FETCH;
+            return;
+        }
+    }
 }
 
 
@@ -1110,18 +1324,22 @@ static void execute32(uint32_t instr)
 
 void run(reg_t sp, reg_t pc)
 {
+    const System *sys = SystemMC::getSystem();
+
     regs[REG_SP] = sp;
     regs[REG_PC] = pc;
 
     for (;;) {
-        uint16_t instr = fetch();
-        if (instructionSize(instr) == InstrBits16) {
-            execute16(instr);
-        }
-        else {
-            uint16_t instrLow = fetch();
-            execute32(instr << 16 | instrLow);
+        if (sys->opt_svmTranslate && !sys->opt_svmTrace) {
+            DecodedInstr *block = fetchBlock();
+            if (block) {
+                runBlock(block);
+                continue;
+            }
         }
+
+        const DecodedInstr &d = fetch();
+        d.handler(d.instr);
     }
 }
 
@@ -34,6 +34,7 @@
 #include "mc_elfdebuginfo.h"
 #include "mc_gdbserver.h"
 #include "mc_logdecoder.h"
+#include "mc_svmprofiler.h"
 #include "lua_runtime.h"
 #include "tinythread.h"
 #include "tasks.h"
@@ -148,6 +149,11 @@ std::string SvmDebugPipe::formatAddress(uint32_t address)
     return gELFDebugInfo.formatAddress(address);
 }
 
+std::string SvmDebugPipe::formatFunction(uint32_t address)
+{
+    return gELFDebugInfo.formatFunction(address);
+}
+
 std::string SvmDebugPipe::formatAddress(void *address)
 {
     return gELFDebugInfo.formatAddress(SvmMemory::physToVirtRAM((uint8_t*)address));
@@ -239,6 +245,8 @@ static uint32_t debuggerMsgCallback(const uint32_t *cmd,
 void SvmDebugPipe::setSymbolSource(const Elf::Program &program)
 {
     gELFDebugInfo.init(program);
+    gLogDecoder.invalidateFormats();
+    SvmProfiler::invalidateSymbols();
     GDBServer::setDebugInfo(&gELFDebugInfo);
     GDBServer::setMessageCallback(debuggerMsgCallback);
 }
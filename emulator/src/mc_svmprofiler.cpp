@@ -0,0 +1,115 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include "mc_svmprofiler.h"
+#include "svm.h"
+#include "svmcpu.h"
+#include "svmmemory.h"
+#include "svmruntime.h"
+#include "svmdebugpipe.h"
+using namespace Svm;
+
+bool SvmProfiler::running;
+std::map<std::string, uint64_t> SvmProfiler::stacks;
+std::map<uint32_t, std::string> SvmProfiler::symbols;
+
+
+void SvmProfiler::start()
+{
+    stacks.clear();
+    symbols.clear();
+    running = true;
+}
+
+void SvmProfiler::invalidateSymbols()
+{
+    symbols.clear();
+}
+
+const std::string &SvmProfiler::symbolize(uint32_t va)
+{
+    std::map<uint32_t, std::string>::iterator I = symbols.find(va);
+    if (I != symbols.end())
+        return I->second;
+
+    std::string &name = symbols[va];
+    name = SvmDebugPipe::formatFunction(va);
+    if (name.empty()) {
+        char buf[16];
+        snprintf(buf, sizeof buf, "0x%08x", va);
+        name = buf;
+    }
+    return name;
+}
+
+void SvmProfiler::sample(SubSystem s, unsigned weight)
+{
+    static const char *subsystemNames[NUM_SUBSYSTEMS] = {
+        "user", "svc", "flash", "tasks", "idle"
+    };
+
+    /*
+     * Walk the SVM frame pointer chain, innermost first. Each CallFrame
+     * holds the return address into its caller.
+     */
+
+    uint32_t pcs[MAX_DEPTH];
+    unsigned depth = 0;
+
+    pcs[depth++] = SvmRuntime::reconstructCodeAddr(SvmCpu::reg(REG_PC));
+
+    SvmMemory::VirtAddr fpVA = SvmCpu::reg(REG_FP);
+    SvmMemory::PhysAddr fpPA;
+    while (depth < MAX_DEPTH && SvmMemory::mapRAM(fpVA, sizeof(CallFrame), fpPA)) {
+        CallFrame *frame = reinterpret_cast<CallFrame*>(fpPA);
+        pcs[depth++] = frame->pc;
+        fpVA = frame->fp;
+    }
+
+    // Folded stacks are written outermost first
+    std::string key = subsystemNames[s];
+    while (depth) {
+        key += ';';
+        key += symbolize(pcs[--depth]);
+    }
+
+    stacks[key] += weight;
+}
+
+bool SvmProfiler::write(const char *filename)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return false;
+
+    for (std::map<std::string, uint64_t>::iterator I = stacks.begin(), E = stacks.end();
+        I != E; ++I)
+        fprintf(f, "%s %llu\n", I->first.c_str(), (unsigned long long) I->second);
+
+    fclose(f);
+    return true;
+}
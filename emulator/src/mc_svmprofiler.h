@@ -0,0 +1,87 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Statistical sampling profiler for SVM code, driven by the emulated
+ * master's virtual clock. This is the simulator's counterpart to the
+ * hardware SampleProfiler, cheap enough to leave running at full speed.
+ *
+ * Every 1/SAMPLE_HZ seconds of virtual time, we record the SVM call stack
+ * along with the subsystem responsible for the time that just elapsed.
+ * Stacks are symbolized immediately (the symbol source changes when a new
+ * program is launched) and written out as folded stacks, one per line:
+ *
+ *   subsystem;outer_function;...;inner_function count
+ *
+ * This is the input format for flamegraph.pl and most profile viewers.
+ */
+
+#ifndef _MC_SVMPROFILER_H
+#define _MC_SVMPROFILER_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+
+class SvmProfiler {
+public:
+    enum SubSystem {
+        UserCode,
+        SVC,
+        Flash,
+        Tasks,
+        Idle,
+        NUM_SUBSYSTEMS
+    };
+
+    // Prime, so we don't alias with periodic events like the heartbeat
+    static const unsigned SAMPLE_HZ = 997;
+
+    static void start();
+    static bool write(const char *filename);
+
+    static bool isRunning() {
+        return running;
+    }
+
+    /// Record 'weight' samples, attributed to 's' and the current SVM stack
+    static void sample(SubSystem s, unsigned weight);
+
+    /// Forget cached symbol names. Call when a new program is loaded.
+    static void invalidateSymbols();
+
+private:
+    static const unsigned MAX_DEPTH = 64;
+
+    static bool running;
+    static std::map<std::string, uint64_t> stacks;
+    static std::map<uint32_t, std::string> symbols;
+
+    static const std::string &symbolize(uint32_t va);
+};
+
+#endif
@@ -47,9 +47,13 @@ struct MCTiming {
 
     // XXX: Arbitrary time for Tasks::work(), necessary so simulator
     // can make forward progress in cases where Tasks are polling for
-    // time to elapse. (For example, audio output with --headless)
+    // time to elapse.
     static const unsigned TICKS_PER_TASKS_WORK = 10;
 
+    // Virtual audio clock for --headless, standing in for the audio
+    // device's interrupts: ask the mixer for more data every 32 samples.
+    static const unsigned TICKS_PER_HEADLESS_AUDIO = TICK_HZ / 16000 * 32;
+
     // XXX: Arbitrary unverified time for flash cache miss, in ticks
     // (Based on theoretical 18 MHz / 1.8 MBps bus speed and 256-byte pages,
     // including some generous padding)
@@ -71,10 +75,6 @@ struct MCTiming {
     static const unsigned CPU_PIPELINE_RELOAD = CPU_RATE_DENOMINATOR * 2;
     static const unsigned CPU_LOAD_STORE = CPU_RATE_DENOMINATOR * 1;
     static const unsigned CPU_DIVIDE = CPU_RATE_DENOMINATOR * 11;  // Worst case
-
-    // Minimum number of cycles that we bother forwarding to SystemMC in one
-    // batch. Pre-multiplied by CPU_RATE_DENOMINATOR.
-    static const unsigned CPU_THRESHOLD = CPU_RATE_DENOMINATOR * 100;
 };
 
 #endif
@@ -0,0 +1,309 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Must be before other headers
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define WINVER WindowsXP
+#   define _WIN32_WINNT 0x502
+#   include <windows.h>
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <netinet/in.h>
+#   include <unistd.h>
+#   define closesocket(_s) close(_s)
+#endif
+
+#include "metricsserver.h"
+#include "system_mc.h"
+#include "simevents.h"
+#include "ostime.h"
+#include "svmcpu.h"
+#include "flash_blockcache.h"
+#include <string.h>
+#include <stdio.h>
+
+#define LOG_PREFIX  "Metrics Server: "
+
+MetricsServer MetricsServer::instance;
+
+
+void MetricsServer::start(System *sys, int port)
+{
+    /*
+     * Spawn a thread which samples our counters, and answers scrapes.
+     */
+
+    ASSERT(instance.running == false);
+    ASSERT(instance.thread == NULL);
+
+    memset(instance.cubes, 0, sizeof instance.cubes);
+    memset(&instance.radioAcks, 0, sizeof instance.radioAcks);
+
+    instance.sys = sys;
+    instance.port = port;
+    instance.running = true;
+    instance.lastSampleTime = OSTime::clock();
+    instance.thread = new tthread::thread(threadEntry, (void*) &instance);
+}
+
+void MetricsServer::stop()
+{
+    /*
+     * Ask the background thread to stop at its next sample.
+     * Does not wait for the thread.
+     */
+
+    instance.running = false;
+}
+
+void MetricsServer::Counter32::update(uint32_t value)
+{
+    /*
+     * Counters only go backwards when they wrap, or when their owner is
+     * reset. A jump of more than half the range between samples can only
+     * be a reset, so count from zero again in that case.
+     */
+
+    uint32_t delta = value - last;
+    total += (delta & 0x80000000) ? value : delta;
+    last = value;
+}
+
+void MetricsServer::threadEntry(void *param)
+{
+    MetricsServer *self = (MetricsServer *) param;
+    self->threadMain();
+}
+
+void MetricsServer::threadMain()
+{
+    #ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    #endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = 0;
+    addr.sin_port = htons(port);
+
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+
+    unsigned long arg = 1;
+    setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, (const char *)&arg, sizeof arg);
+
+    if (bind(listenFD, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't bind to port!\n");
+        return;
+    }
+
+    if (listen(listenFD, 4) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't listen on socket\n");
+        return;
+    }
+
+    fprintf(stderr, LOG_PREFIX "Listening on port %d\n", port);
+
+    while (running) {
+        /*
+         * Wait for a client, but wake up often enough to keep sampling.
+         */
+
+        fd_set readFDs;
+        FD_ZERO(&readFDs);
+        FD_SET(listenFD, &readFDs);
+
+        struct timeval tv;
+        tv.tv_sec = SAMPLE_INTERVAL_MS / 1000;
+        tv.tv_usec = (SAMPLE_INTERVAL_MS % 1000) * 1000;
+
+        int ret = select(listenFD + 1, &readFDs, NULL, NULL, &tv);
+        if (ret < 0)
+            break;
+
+        if (OSTime::clock() - lastSampleTime >= SAMPLE_INTERVAL_MS * 1e-3)
+            sample();
+
+        if (ret > 0 && FD_ISSET(listenFD, &readFDs)) {
+            struct sockaddr_in addr;
+            socklen_t addrSize = sizeof addr;
+            int clientFD = accept(listenFD, (struct sockaddr *) &addr, &addrSize);
+            if (clientFD < 0)
+                break;
+
+            handleClient(clientFD);
+            closesocket(clientFD);
+        }
+    }
+
+    closesocket(listenFD);
+}
+
+void MetricsServer::sample()
+{
+    double now = OSTime::clock();
+    double dt = now - lastSampleTime;
+    lastSampleTime = now;
+
+    for (unsigned i = 0; i < sys->opt_numCubes; i++) {
+        CubeSample &cs = cubes[i];
+        Cube::Hardware::Counters c;
+        sys->cubes[i].getCounters(c);
+
+        uint64_t before = cs.ticks.total;
+        cs.ticks.update(c.ticks);
+        cs.ticksPerSecond = dt > 0 ? (cs.ticks.total - before) / dt : 0;
+    }
+
+    radioAcks.update(SimEvents::radioAckCount());
+}
+
+void MetricsServer::handleClient(int fd)
+{
+    /*
+     * Read the request headers, up to the blank line that ends them.
+     * We don't care what was asked for; there's only one page.
+     */
+
+    char buffer[2048];
+    unsigned len = 0;
+
+    while (len < sizeof buffer - 1) {
+        int ret = recv(fd, buffer + len, sizeof buffer - 1 - len, 0);
+        if (ret <= 0)
+            return;
+        len += ret;
+        buffer[len] = '\0';
+        if (strstr(buffer, "\r\n\r\n") || strstr(buffer, "\n\n"))
+            break;
+    }
+
+    // Include everything up to this instant
+    sample();
+
+    std::string body;
+    format(body);
+
+    char header[128];
+    int headerLen = snprintf(header, sizeof header,
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %u\r\n"
+        "\r\n", (unsigned) body.size());
+
+    send(fd, header, headerLen, 0);
+    send(fd, body.data(), body.size(), 0);
+}
+
+namespace {
+
+    void metric(std::string &out, const char *name, const char *type, const char *help)
+    {
+        char buf[256];
+        snprintf(buf, sizeof buf, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+        out += buf;
+    }
+
+    void value(std::string &out, const char *name, double v)
+    {
+        char buf[128];
+        snprintf(buf, sizeof buf, "%s %.17g\n", name, v);
+        out += buf;
+    }
+
+    void cubeValue(std::string &out, const char *name, unsigned cube, double v)
+    {
+        char buf[128];
+        snprintf(buf, sizeof buf, "%s{cube=\"%u\"} %.17g\n", name, cube, v);
+        out += buf;
+    }
+
+}
+
+void MetricsServer::format(std::string &out)
+{
+    /*
+     * Counters from other threads are read without locking, so they may
+     * be a little stale, but never more than a sample interval out.
+     */
+
+    unsigned numCubes = sys->opt_numCubes;
+    const TimeGovernor &gov = sys->getTimeGovernor();
+
+    uint64_t cacheAccesses, cacheMisses;
+    FlashBlock::getTotals(cacheAccesses, cacheMisses);
+
+    metric(out, "siftulator_cubes", "gauge", "Number of simulated cubes.");
+    value(out, "siftulator_cubes", numCubes);
+
+    metric(out, "siftulator_cube_ticks_total", "counter", "Cube CPU clock ticks simulated.");
+    for (unsigned i = 0; i < numCubes; i++)
+        cubeValue(out, "siftulator_cube_ticks_total", i, cubes[i].ticks.total);
+
+    metric(out, "siftulator_cube_ticks_per_second", "gauge",
+        "Cube CPU clock ticks per real second, over the last sample interval.");
+    for (unsigned i = 0; i < numCubes; i++)
+        cubeValue(out, "siftulator_cube_ticks_per_second", i, cubes[i].ticksPerSecond);
+
+    metric(out, "siftulator_virtual_seconds_total", "counter", "Virtual time elapsed.");
+    value(out, "siftulator_virtual_seconds_total", sys->time.elapsedSeconds());
+
+    metric(out, "siftulator_svm_instructions_total", "counter", "SVM instructions executed by the base.");
+    value(out, "siftulator_svm_instructions_total", SvmCpu::instructionCount());
+
+    metric(out, "siftulator_radio_packets_total", "counter", "Radio transmission attempts by the base.");
+    value(out, "siftulator_radio_packets_total", SystemMC::radioPacketCount());
+
+    metric(out, "siftulator_radio_acks_total", "counter", "Radio packets acknowledged by a cube.");
+    value(out, "siftulator_radio_acks_total", radioAcks.total);
+
+    metric(out, "siftulator_flash_cache_accesses_total", "counter", "Flash block cache lookups.");
+    value(out, "siftulator_flash_cache_accesses_total", cacheAccesses);
+
+    metric(out, "siftulator_flash_cache_misses_total", "counter", "Flash block cache misses.");
+    value(out, "siftulator_flash_cache_misses_total", cacheMisses);
+
+    metric(out, "siftulator_audio_underruns_total", "counter",
+        "Times the headless audio mixer fell a full buffer behind.");
+    value(out, "siftulator_audio_underruns_total", SystemMC::audioUnderrunCount());
+
+    metric(out, "siftulator_governor_lag_seconds_total", "counter",
+        "Seconds the time governor has fallen behind real-time and given up on.");
+    value(out, "siftulator_governor_lag_seconds_total", gov.getLag());
+
+    metric(out, "siftulator_governor_drift_seconds", "gauge",
+        "Seconds ahead (positive) or behind (negative) real-time.");
+    value(out, "siftulator_governor_drift_seconds", gov.getDrift());
+
+    metric(out, "siftulator_governor_host_speed", "gauge",
+        "Recent simulation speed relative to real-time, excluding sleeps.");
+    value(out, "siftulator_governor_host_speed", gov.getHostSpeed());
+}
@@ -0,0 +1,89 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _METRICS_SERVER_H
+#define _METRICS_SERVER_H
+
+#include <stdint.h>
+#include <string>
+#include "system.h"
+#include "tinythread.h"
+
+
+/**
+ * Metrics mode (--metrics PORT) serves a snapshot of the simulator's
+ * counters over HTTP, in the Prometheus text format, so farms of
+ * siftulators can be watched for slow or stalled instances.
+ *
+ * Every request gets the same plain-text reply, regardless of its path.
+ * A background thread also samples the counters once per second, to
+ * widen the 32-bit ones that would otherwise wrap between scrapes, and
+ * to compute per-cube tick rates. Nothing is done on the simulation
+ * threads, so it's cheap enough to leave on.
+ *
+ * Unlike the debug servers, this listens on all interfaces, so a farm's
+ * instances can be scraped from elsewhere.
+ */
+class MetricsServer {
+public:
+    static void start(System *sys, int port);
+    static void stop();
+
+private:
+    MetricsServer() {}
+    static MetricsServer instance;
+
+    static const unsigned SAMPLE_INTERVAL_MS = 1000;
+
+    // Widens a free-running 32-bit counter, given samples at least once per wrap
+    struct Counter32 {
+        uint32_t last;
+        uint64_t total;
+
+        void update(uint32_t value);
+    };
+
+    struct CubeSample {
+        Counter32 ticks;
+        double ticksPerSecond;
+    };
+
+    System *sys;
+    tthread::thread *thread;
+    int port;
+    bool running;
+
+    double lastSampleTime;
+    CubeSample cubes[System::MAX_CUBES];
+    Counter32 radioAcks;
+
+    static void threadEntry(void *param);
+    void threadMain();
+    void sample();
+    void handleClient(int fd);
+    void format(std::string &out);
+};
+
+#endif
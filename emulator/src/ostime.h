@@ -40,6 +40,9 @@ public:
     static double clock();
     static void sleep(double seconds);
 
+    /// Like sleep(), but spins at the end if the OS tends to oversleep
+    static void sleepPrecise(double seconds);
+
 private:
     static OSTimeData data;
 };
@@ -57,3 +57,9 @@ inline void OSTime::sleep(double seconds)
 {
     mach_wait_until(mach_absolute_time() + seconds / data.toSeconds);
 }
+
+inline void OSTime::sleepPrecise(double seconds)
+{
+    // mach_wait_until() is already precise
+    sleep(seconds);
+}
@@ -35,19 +35,19 @@
 class OSTimeData
 {
 public:
-    struct timeval epoch;
+    struct timespec epoch;
 
     OSTimeData() {
-        gettimeofday(&epoch, 0);
+        clock_gettime(CLOCK_MONOTONIC, &epoch);
     }
 };
 
 inline double OSTime::clock()
 {
-    struct timeval now;
-    gettimeofday(&now, 0);
-    return (now.tv_sec - data.epoch.tv_usec) +
-        1e-6 * (now.tv_usec - data.epoch.tv_usec);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - data.epoch.tv_sec) +
+        1e-9 * (now.tv_nsec - data.epoch.tv_nsec);
 }
 
 inline void OSTime::sleep(double seconds)
@@ -57,3 +57,20 @@ inline void OSTime::sleep(double seconds)
     tv.tv_nsec = (seconds - tv.tv_sec) * 1e9;
     nanosleep(&tv, 0);
 }
+
+inline void OSTime::sleepPrecise(double seconds)
+{
+    /*
+     * nanosleep() usually wakes up late by the timer slack (50us by
+     * default on Linux) plus however long the scheduler takes to get
+     * back to us. Sleep through most of the interval, and spin for the
+     * rest.
+     */
+
+    static const double spinSeconds = 0.0005;
+    double deadline = clock() + seconds;
+
+    if (seconds > spinSeconds)
+        sleep(seconds - spinSeconds);
+    while (clock() < deadline);
+}
@@ -71,3 +71,11 @@ inline void OSTime::sleep(double seconds)
     if (ms >= 1)
         Sleep(ms);
 }
+
+inline void OSTime::sleepPrecise(double seconds)
+{
+    // sleep() always stops short, by at least a millisecond. Spin for the rest.
+    double deadline = clock() + seconds;
+    sleep(seconds);
+    while (clock() < deadline);
+}
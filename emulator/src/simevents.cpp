@@ -0,0 +1,100 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "simevents.h"
+#include <string.h>
+
+SimEvents SimEvents::instance;
+
+
+bool SimEvents::wait(Condition &cond, const volatile uint64_t &clocks, uint64_t deadline)
+{
+    /*
+     * A notify() that races with us registering as a waiter may be
+     * missed, but the cube thread notifies again after its next tick
+     * batch, so we're never more than one batch late.
+     */
+
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+    instance.waiters++;
+
+    bool result;
+    while (!(result = cond.test()) && clocks < deadline)
+        instance.cond.wait(instance.lock);
+
+    instance.waiters--;
+    return result;
+}
+
+void SimEvents::wake()
+{
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+    instance.cond.notify_all();
+}
+
+void SimEvents::radioAck()
+{
+    // Only ever incremented on the MC thread
+    instance.acks = instance.acks + 1;
+    notify();
+}
+
+void SimEvents::logLine(const char *str)
+{
+    /*
+     * Always keep the recent history, even with no waiters, so that a
+     * script can't miss a line logged just as it starts waiting.
+     */
+
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+
+    instance.log.push_back(str);
+    if (instance.log.size() > LOG_HISTORY)
+        instance.log.pop_front();
+    instance.logEnd++;
+
+    if (instance.waiters)
+        instance.cond.notify_all();
+}
+
+uint32_t SimEvents::logSequence()
+{
+    tthread::lock_guard<tthread::mutex> guard(instance.lock);
+    return instance.logEnd;
+}
+
+bool SimEvents::findLog(uint32_t seq, const char *substr, std::string &line)
+{
+    uint32_t first = instance.logEnd - instance.log.size();
+    unsigned i = int32_t(seq - first) > 0 ? seq - first : 0;
+
+    for (; i < instance.log.size(); ++i)
+        if (strstr(instance.log[i].c_str(), substr)) {
+            line = instance.log[i];
+            return true;
+        }
+
+    return false;
+}
@@ -0,0 +1,99 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SIM_EVENTS_H
+#define _SIM_EVENTS_H
+
+#include <stdint.h>
+#include <string>
+#include <deque>
+#include "macros.h"
+#include "tinythread.h"
+
+
+/**
+ * Lets a script thread block until something happens in the simulation,
+ * instead of polling with real-time sleeps.
+ *
+ * The cube thread calls notify() after every tick batch, which covers
+ * anything derived from cube state or the virtual clock. The MC thread
+ * reports radio ACKs and log lines as they happen. Nobody takes a lock
+ * unless a waiter is actually registered.
+ */
+class SimEvents {
+public:
+    struct Condition {
+        /// Called with the SimEvents lock held
+        virtual bool test() = 0;
+    };
+
+    /**
+     * Block until cond.test() is true, or until the virtual clock
+     * reaches 'deadline'. Returns false on timeout. The simulation
+     * must be running, or this never returns.
+     */
+    static bool wait(Condition &cond, const volatile uint64_t &clocks,
+        uint64_t deadline = uint64_t(-1));
+
+    static ALWAYS_INLINE void notify() {
+        if (instance.waiters)
+            wake();
+    }
+
+    static void radioAck();
+    static void logLine(const char *str);
+
+    /// Count of ACKed radio packets. Wraps around.
+    static uint32_t radioAckCount() {
+        return instance.acks;
+    }
+
+    /// Sequence number of the next log line
+    static uint32_t logSequence();
+
+    /**
+     * Look for a log line containing 'substr', numbered 'seq' or later.
+     * Only the most recent LOG_HISTORY lines are searched. Must be
+     * called with the lock held, i.e. from Condition::test().
+     */
+    static bool findLog(uint32_t seq, const char *substr, std::string &line);
+
+private:
+    SimEvents() {}
+    static SimEvents instance;
+    static const unsigned LOG_HISTORY = 64;
+
+    static NEVER_INLINE void wake();
+
+    tthread::mutex lock;
+    tthread::condition_variable cond;
+    volatile unsigned waiters;
+    volatile uint32_t acks;
+
+    std::deque<std::string> log;
+    uint32_t logEnd;
+};
+
+#endif
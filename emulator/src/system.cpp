@@ -26,26 +26,89 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "system.h"
 #include "cube_debug.h"
 #include "mc_gdbserver.h"
+#include "mc_bluetooth.h"
+#include "metricsserver.h"
+#include "inputlog.h"
+#include "latencytracer.h"
+#include "mc_neighbor.h"
+#include "flash_stack.h"
+#include "framecapture.h"
+
+namespace {
+
+    /*
+     * Snapshot file layout: This header, followed by page-aligned raw
+     * sections that can be memory-mapped directly. First one Cube::Hardware
+     * record per cube, then a prefix of the FlashStorage::FileRecord which
+     * includes only as many CubeRecords as we have cubes.
+     */
+    struct SnapshotHeader {
+        uint64_t    magic;
+        uint32_t    version;
+        uint32_t    numCubes;
+        uint64_t    clocks;
+        uint32_t    cubeOffset;
+        uint32_t    cubeStride;
+        uint32_t    cubeSize;
+        uint32_t    flashOffset;
+        uint32_t    flashSize;
+
+        static const uint64_t MAGIC             = 0x70616e5374666953LLU;
+        static const uint32_t CURRENT_VERSION   = 1;
+        static const uint32_t SECTION_ALIGN     = 4096;
+
+        static uint32_t align(uint32_t offset) {
+            return (offset + SECTION_ALIGN - 1) & ~(SECTION_ALIGN - 1);
+        }
+
+        void init(unsigned n, uint64_t clk) {
+            memset(this, 0, sizeof *this);
+            magic = MAGIC;
+            version = CURRENT_VERSION;
+            numCubes = n;
+            clocks = clk;
+            cubeSize = sizeof(Cube::Hardware);
+            cubeStride = align(cubeSize);
+            cubeOffset = align(sizeof *this);
+            flashOffset = align(cubeOffset + n * cubeStride);
+            flashSize = offsetof(FlashStorage::FileRecord, cubes)
+                + n * sizeof(FlashStorage::CubeRecord);
+        }
+    };
+
+} // end anonymous namespace
+
 
 
 System::System()
         : opt_headless(false),
         opt_numCubes(DEFAULT_CUBES),
+        opt_cubeThreads(1),
+        opt_flashCopyOnWrite(false),
+        opt_flashFormat(FlashStorage::F_PLAIN),
         opt_whiteBackground(false),
         opt_windowWidth(800),
         opt_windowHeight(600),
         opt_continueOnException(false),
         opt_turbo(false),
+        opt_fastPeripherals(false),
         opt_lockRotationByDefault(false),
+        opt_traceBinary(false),
+        opt_traceFlightRecorder(false),
         opt_noCubeReconnect(false),
         opt_flushLogs(false),
         opt_paintTrace(false),
+        opt_latencyTrace(false),
         opt_svmTrace(false),
         opt_svmFlashStats(false),
+        opt_svmTranslate(false),
         opt_gdbServerPort(0),
+        opt_metricsPort(0),
+        opt_bluetoothPort(0),
         opt_cube0Debug(false),
         opt_mute(false),
         opt_radioNoise(0),
@@ -59,7 +122,10 @@ bool System::init()
     if (mIsInitialized)
         return true;
 
-    if (!flash.init(opt_flashFilename.empty() ? NULL : opt_flashFilename.c_str()))
+    if (!flash.init(opt_flashFilename.empty() ? NULL : opt_flashFilename.c_str(),
+                    opt_flashCopyOnWrite,
+                    opt_flashDeltaFilename.empty() ? NULL : opt_flashDeltaFilename.c_str(),
+                    opt_flashFormat))
         return false;
 
     if (!sc.init(this))
@@ -70,6 +136,14 @@ bool System::init()
 
     time.init();
 
+    if (!opt_recordFilename.empty() &&
+        !InputLog::startRecording(this, opt_recordFilename.c_str()))
+        return false;
+
+    if (!opt_replayFilename.empty() &&
+        !InputLog::startReplay(this, opt_replayFilename.c_str()))
+        return false;
+
     mIsInitialized = true;
     return true;
 }
@@ -114,13 +188,167 @@ void System::start()
         return;
     mIsStarted = true;
 
+    tracer.setBinary(opt_traceBinary);
+    tracer.setFlightRecorder(opt_traceFlightRecorder && isTraceAllowed());
     tracer.setEnabled(opt_traceEnabledAtStartup && isTraceAllowed());
 
+    // Before the MC thread, so it schedules connection events
+    if (opt_bluetoothPort)
+        BluetoothBridge::start(opt_bluetoothPort, opt_bluetoothLogFilename.c_str());
+
     sc.start();
     smc.start();
 
     if (opt_gdbServerPort)
         GDBServer::start(opt_gdbServerPort);
+
+    if (opt_metricsPort)
+        MetricsServer::start(this, opt_metricsPort);
+
+    if (opt_latencyTrace)
+        LatencyTracer::start(this);
+}
+
+bool System::haltForSnapshot()
+{
+    /*
+     * Bring the simulation to a standstill, if it's running at all.
+     * The MC thread keeps running until it needs the cubes again, then
+     * waits in a deadlineSync event until the cube thread restarts.
+     */
+
+    if (!mIsInitialized || SystemMC::isSimulationThread())
+        return false;
+
+    if (mIsStarted) {
+        sc.stop();
+        sc.deadlineSync.waitForExternalHalt();
+    }
+
+    return true;
+}
+
+bool System::saveSnapshot(const char *filename)
+{
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        LOG(("SNAPSHOT: Can't open '%s' for writing\n", filename));
+        return false;
+    }
+
+    bool success = saveSnapshot(f);
+    success = !fclose(f) && success;
+    if (!success)
+        LOG(("SNAPSHOT: Error writing '%s'\n", filename));
+    return success;
+}
+
+bool System::saveSnapshot(FILE *f)
+{
+    if (!haltForSnapshot())
+        return false;
+
+    rewind(f);
+    bool success = writeSnapshot(f) && !fflush(f);
+
+    if (mIsStarted)
+        sc.start();
+
+    return success;
+}
+
+bool System::restoreSnapshot(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        LOG(("SNAPSHOT: Can't open '%s'\n", filename));
+        return false;
+    }
+
+    bool success = restoreSnapshot(f);
+    fclose(f);
+    if (!success)
+        LOG(("SNAPSHOT: Can't restore from '%s'\n", filename));
+    return success;
+}
+
+bool System::restoreSnapshot(FILE *f)
+{
+    if (!haltForSnapshot())
+        return false;
+
+    // The MC can't be restored, only rebooted.
+    if (mIsStarted)
+        smc.stop();
+
+    rewind(f);
+    bool success = readSnapshot(f);
+
+    /*
+     * Cubes wait for the new MC's first sync event. Also drop any
+     * MCNeighbor transmit deadline from the old MC.
+     */
+    sc.deadlineSync.reset();
+    MCNeighbor::cubeInit(&time);
+
+    if (mIsStarted) {
+        sc.start();
+        smc.start();
+    }
+
+    return success;
+}
+
+bool System::writeSnapshot(FILE *f)
+{
+    SnapshotHeader hdr;
+    hdr.init(opt_numCubes, time.clocks);
+    bool success = fwrite(&hdr, sizeof hdr, 1, f) == 1;
+
+    for (unsigned i = 0; success && i < hdr.numCubes; i++)
+        success = !fseek(f, hdr.cubeOffset + i * hdr.cubeStride, SEEK_SET)
+            && fwrite(&cubes[i], hdr.cubeSize, 1, f) == 1;
+
+    return success
+        && !fseek(f, hdr.flashOffset, SEEK_SET)
+        && fwrite(flash.data, hdr.flashSize, 1, f) == 1;
+}
+
+bool System::readSnapshot(FILE *f)
+{
+    SnapshotHeader hdr, expected;
+
+    if (fread(&hdr, sizeof hdr, 1, f) != 1 || hdr.magic != hdr.MAGIC
+        || hdr.version != hdr.CURRENT_VERSION || hdr.numCubes > MAX_CUBES)
+        return false;
+
+    // All layout details must match this build exactly
+    expected.init(hdr.numCubes, hdr.clocks);
+    if (memcmp(&hdr, &expected, sizeof hdr))
+        return false;
+
+    if (fseek(f, hdr.flashOffset, SEEK_SET)
+        || fread(flash.data, hdr.flashSize, 1, f) != 1)
+        return false;
+    FlashStack::invalidateCache();
+
+    sc.setNumCubes(hdr.numCubes);
+    if (opt_numCubes != hdr.numCubes)
+        return false;
+
+    Cube::Hardware *saved = new Cube::Hardware;
+    bool success = true;
+
+    for (unsigned i = 0; success && i < hdr.numCubes; i++) {
+        success = !fseek(f, hdr.cubeOffset + i * hdr.cubeStride, SEEK_SET)
+            && fread((void*) saved, hdr.cubeSize, 1, f) == 1;
+        if (success)
+            cubes[i].restoreState(*saved);
+    }
+
+    delete saved;
+    time.clocks = hdr.clocks;
+    return success;
 }
 
 void System::exit()
@@ -132,6 +360,10 @@ void System::exit()
     if (mIsStarted) {
         if (opt_gdbServerPort)
             GDBServer::stop();
+        if (opt_metricsPort)
+            MetricsServer::stop();
+        if (opt_bluetoothPort)
+            BluetoothBridge::stop();
 
         smc.stop();
         sc.stop();
@@ -139,8 +371,13 @@ void System::exit()
         mIsStarted = false;
     }
 
+    InputLog::stop();
+    if (opt_latencyTrace)
+        LatencyTracer::report();
+    LatencyTracer::stop();
     smc.exit();
     sc.exit();
     flash.exit();
     tracer.close();
+    FrameCapture::close();
 }
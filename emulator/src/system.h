@@ -59,10 +59,16 @@ class System {
     // Static Options; can be set prior to init only
     bool opt_headless;
     unsigned opt_numCubes;
+    unsigned opt_cubeThreads;
     std::string opt_cubeFirmware;
     std::string opt_flashFilename;
+    std::string opt_flashDeltaFilename;
+    bool opt_flashCopyOnWrite;
+    FlashStorage::Format opt_flashFormat;
     std::string opt_launcherFilename;
     std::string opt_waveoutFilename;
+    std::string opt_recordFilename;
+    std::string opt_replayFilename;
 
     // UI options
     bool opt_whiteBackground;
@@ -72,24 +78,33 @@ class System {
     // Global debug options
     bool opt_continueOnException;
     bool opt_turbo;
+    bool opt_fastPeripherals;
     bool opt_lockRotationByDefault;
     bool opt_radioTrace;
     bool opt_traceEnabledAtStartup;
+    bool opt_traceBinary;
+    bool opt_traceFlightRecorder;
     bool opt_noCubeReconnect;
     bool opt_flushLogs;
 
     // Master firmware debug options
     bool opt_paintTrace;
+    bool opt_latencyTrace;
 
     // SVM options
     bool opt_svmTrace;
     bool opt_svmFlashStats;
     bool opt_svmStackMonitor;
+    bool opt_svmTranslate;
     unsigned opt_gdbServerPort;
+    unsigned opt_metricsPort;
+    unsigned opt_bluetoothPort;
+    std::string opt_bluetoothLogFilename;
 
     // Debug options, applicable to cube 0 only
     bool opt_cube0Debug;
     std::string opt_cube0Profile;
+    std::string opt_svmProfile;
 
     // Other options
     bool opt_mute;
@@ -108,6 +123,23 @@ class System {
 
     bool isTraceAllowed();
 
+    /**
+     * Snapshots capture the virtual clock, every cube's hardware state, and
+     * the FlashStorage image, in a file that only this same build can read.
+     *
+     * The master's native firmware state can't be captured, so restoring a
+     * snapshot reboots the master against the restored flash. The cubes
+     * resume exactly where they left off, with their assets still installed.
+     *
+     * Must not be called from inside the simulation (e.g. a SCRIPT block).
+     * The FILE versions rewind 'f' and leave it open, for snapshots that
+     * never need a name on disk.
+     */
+    bool saveSnapshot(const char *filename);
+    bool restoreSnapshot(const char *filename);
+    bool saveSnapshot(FILE *f);
+    bool restoreSnapshot(FILE *f);
+
     DeadlineSynchronizer &getCubeSync() {
         return sc.deadlineSync;
     }
@@ -116,18 +148,34 @@ class System {
         sc.stop();
     }
 
+    const TimeGovernor &getTimeGovernor() const {
+        return sc.governor;
+    }
+
  private:
     System();
     
     bool mIsInitialized;
     bool mIsStarted;
 
+    bool haltForSnapshot();
+    bool writeSnapshot(FILE *f);
+    bool readSnapshot(FILE *f);
+
     SystemCubes sc;
     SystemMC smc;
 
 public:
 
     inline static System& getInstance() {
+        /*
+         * There is exactly one System per process. The master firmware
+         * runs natively inside SystemMC, and it keeps its state in
+         * ordinary globals and class statics (CubeSlots, SvmRuntime,
+         * FlashLFS, and friends). A second base in the same address space
+         * would share all of them. To run several bases, run several
+         * processes; the OS already shares their read-only pages.
+         */
         static System sys;
         return sys;
     }
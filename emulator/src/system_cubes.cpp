@@ -29,11 +29,14 @@
 #include "ostime.h"
 #include "system_cubes.h"
 #include "mc_neighbor.h"
+#include "simevents.h"
 
 
 bool SystemCubes::init(System *sys)
 {
     this->sys = sys;
+    mNumWorkers = 1;
+    mWorkersRunning = false;
     deadlineSync.init(&sys->time, &mThreadRunning);
 
     MCNeighbor::cubeInit(&sys->time);
@@ -121,6 +124,7 @@ bool SystemCubes::initCube(unsigned id)
         return false;
 
     sys->cubes[id].cpu.id = id;
+    sys->cubes[id].setFastPeripherals(sys->opt_fastPeripherals);
     
     if (id == 0 && !sys->opt_cube0Profile.empty()) {
         Cube::CPU::profile_data *pd;
@@ -128,6 +132,11 @@ bool SystemCubes::initCube(unsigned id)
         pd = (Cube::CPU::profile_data *) malloc(s);
         memset(pd, 0, s);
         sys->cubes[0].cpu.mProfileData = pd;
+
+        Cube::CPU::profile_frames *pf;
+        pf = (Cube::CPU::profile_frames *) malloc(sizeof *pf);
+        memset(pf, 0, sizeof *pf);
+        sys->cubes[0].cpu.mProfileFrames = pf;
     }
 
     sys->cubes[id].neighbors.attachCubes(sys->cubes);
@@ -142,6 +151,8 @@ void SystemCubes::start()
         Cube::Debug::stopOnException = !sys->opt_continueOnException;
     }
 
+    startWorkers();
+
     mThreadRunning = true;
     __asm__ __volatile__ ("" : : : "memory");
     mThread = new tthread::thread(threadFn, this);
@@ -159,6 +170,8 @@ void SystemCubes::stop()
     delete mThread;
     mThread = 0;
 
+    stopWorkers();
+
     if (sys->opt_cube0Debug)
         Cube::Debug::exit();
 }
@@ -183,7 +196,7 @@ void SystemCubes::threadFn(void *param)
     SystemCubes *self = (SystemCubes *) param;
     System *sys = self->sys;
 
-    TimeGovernor gov;
+    TimeGovernor &gov = self->governor;
     gov.start(&sys->time);
     
     if (sys->opt_cube0Debug && sys->opt_numCubes)
@@ -202,25 +215,36 @@ void SystemCubes::threadFn(void *param)
          */
 
         self->mBigCubeLock.lock();
+
+        for (unsigned i = 0; i < sys->opt_numCubes; i++)
+            sys->cubes[i].pollSensors();
+
         if (sys->opt_numCubes == 0) {
             self->tickLoopEmpty();
         } else if (sys->opt_cube0Debug) {
             self->tickLoopDebug();
         } else if (!sys->cubes[0].cpu.sbt || sys->cubes[0].cpu.mProfileData || Tracer::isEnabled()) {
             self->tickLoopGeneral();
+        } else if (self->mNumWorkers > 1) {
+            self->tickLoopParallel();
         } else {
             self->tickLoopFastSBT();
         }
         self->mBigCubeLock.unlock();
 
+        // Let any scripts waiting on the simulation re-check
+        SimEvents::notify();
+
         /*
          * Use TimeGovernor to keep us running no faster than real-time.
          * It keeps a running total of how far ahead or behind we are,
          * so that on average we can track real-time accurately assuming
-         * we have the CPU power to do so.
+         * we have the CPU power to do so. It also sizes the next batch.
          */
 
-        if (!sys->opt_turbo)
+        if (sys->opt_turbo)
+            gov.unthrottled();
+        else
             gov.step();
     }
 }
@@ -228,8 +252,23 @@ void SystemCubes::threadFn(void *param)
 ALWAYS_INLINE void SystemCubes::tick(unsigned count)
 {
     sys->time.tick(count);
+    endEpoch();
+}
+
+ALWAYS_INLINE void SystemCubes::endEpoch()
+{
     MCNeighbor::cubeTick();
-    deadlineSync.tick();
+    deadlineSync.endEpoch();
+}
+
+ALWAYS_INLINE unsigned SystemCubes::nextEpoch(unsigned batch)
+{
+    /*
+     * How far can every cube run before we need to check in with
+     * deadlineSync or MCNeighbor again? Limited to the rest of our batch.
+     */
+    batch = std::min(batch, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+    return deadlineSync.beginEpoch(batch);
 }
 
 NEVER_INLINE void SystemCubes::tickLoopDebug()
@@ -289,57 +328,282 @@ NEVER_INLINE void SystemCubes::tickLoopFastSBT()
     /*
      * Fastest path: No debugging, no tracing, SBT only,
      * and advance by more than one tick when we can.
+     *
+     * Cubes run free for an entire epoch, only checking in with
+     * deadlineSync and MCNeighbor once at the end.
      */
 
     System *sys = this->sys;
     unsigned batch = sys->time.timestepTicks();
-    unsigned nCubes = sys->opt_numCubes;
-    unsigned stepSize = 1;
+    uint32_t allCubes = (1 << sys->opt_numCubes) - 1;
+    unsigned epoch = 1;
 
     /*
      * Run until our batch is empty, or someone tells us to stop.
      *
-     * Note: stepSize is only equal to 0 in exceptional cases, such as
+     * Note: epoch is only equal to 0 in exceptional cases, such as
      *       if our thread is exiting and deadlineSync is halted on the same
      *       clock tick, preventing us from making forward progress.
      */
 
-    while (batch && stepSize) {
-        unsigned nextStep;
+    while (batch && epoch) {
+        batch -= epoch;
+        tickGroupFastSBT(allCubes, sys->time, epoch);
+        endEpoch();
+        epoch = nextEpoch(batch);
+    }
+}
 
-        batch -= stepSize;
-        nextStep = batch;
+NEVER_INLINE void SystemCubes::tickLoopEmpty()
+{
+    /*
+     * Special-case tick loop for when the cube emulator is emulating no cubes.
+     * We still need to advance the clock, and operate deadlineSync.
+     */
 
-        for (unsigned i = 0; i < nCubes; i++) {
-            Cube::Hardware &cube = sys->cubes[i];
-            nextStep = std::min(nextStep, sys->cubes[i].tickFastSBT(stepSize));
+    System *sys = this->sys;
+    unsigned batch = sys->time.timestepTicks();
+    unsigned epoch = 1;
+
+    while (batch && epoch) {
+        batch -= epoch;
+        tick(epoch);
+        epoch = nextEpoch(batch);
+    }
+}
+
+NEVER_INLINE void SystemCubes::tickLoopParallel()
+{
+    /*
+     * Same assumptions as tickLoopFastSBT, but the cubes are split into
+     * groups that tick concurrently on our worker pool. Each epoch is
+     * run by every worker, so all interaction with the MC thread still
+     * happens at the exact same clock tick it would in the serial loop.
+     */
+
+    System *sys = this->sys;
+    unsigned batch = sys->time.timestepTicks();
+    unsigned nCubes = sys->opt_numCubes;
+    unsigned epoch = 1;
+
+    while (batch && epoch) {
+        batch -= epoch;
+        runEpoch(epoch);
+        tick(epoch);
+        epoch = nextEpoch(batch);
+    }
+
+    // Outside of this loop, all cubes run on the shared system clock.
+    for (unsigned i = 0; i < nCubes; i++)
+        sys->cubes[i].setTimeBase(&sys->time);
+}
+
+void SystemCubes::startWorkers()
+{
+    mNumWorkers = std::max(1U, std::min(sys->opt_cubeThreads, MAX_WORKERS));
+    mEpochGeneration = 0;
+    mWorkersBusy = 0;
+    mWorkersRunning = true;
+
+    for (unsigned i = 0; i < mNumWorkers; i++) {
+        Worker &w = mWorkers[i];
+        w.owner = this;
+        w.cubeMask = 0;
+        w.clock.init();
+        w.thread = i ? new tthread::thread(workerFn, &w) : 0;
+    }
+}
+
+void SystemCubes::stopWorkers()
+{
+    if (!mWorkersRunning)
+        return;
+
+    mWorkerLock.lock();
+    mWorkersRunning = false;
+    mEpochGeneration++;
+    mWorkerCond.notify_all();
+    mWorkerLock.unlock();
+
+    for (unsigned i = 1; i < mNumWorkers; i++) {
+        mWorkers[i].thread->join();
+        delete mWorkers[i].thread;
+        mWorkers[i].thread = 0;
+    }
+
+    mNumWorkers = 1;
+}
+
+void SystemCubes::workerFn(void *param)
+{
+    /*
+     * Worker threads spin briefly between epochs, since epochs are usually
+     * only one radio packet long. If we're idle for longer than that (paused,
+     * or throttled by the TimeGovernor) fall back on the condition variable.
+     */
+
+    Worker *w = (Worker *) param;
+    SystemCubes *self = w->owner;
+    uint32_t generation = 0;
+
+    srand(OSTime::clock() * 1e6);
+
+    while (1) {
+        for (unsigned spin = 0; spin < 1000; spin++) {
+            if (generation != *(volatile uint32_t*) &self->mEpochGeneration)
+                break;
+            tthread::this_thread::yield();
         }
 
-        tick(stepSize);
+        self->mWorkerLock.lock();
+        while (generation == self->mEpochGeneration)
+            self->mWorkerCond.wait(self->mWorkerLock);
+        generation = self->mEpochGeneration;
+        bool running = self->mWorkersRunning;
+        self->mWorkerLock.unlock();
+
+        if (!running)
+            break;
 
-        stepSize = std::min(nextStep, (unsigned)deadlineSync.remaining());
-        stepSize = std::min(stepSize, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+        self->tickGroupFastSBT(w->cubeMask, w->clock, self->mEpochTicks);
+        __sync_sub_and_fetch(&self->mWorkersBusy, 1);
     }
 }
 
-NEVER_INLINE void SystemCubes::tickLoopEmpty()
+void SystemCubes::partitionCubes()
 {
     /*
-     * Special-case tick loop for when the cube emulator is emulating no cubes.
-     * We still need to advance the clock, and operate deadlineSync.
+     * Group cubes that are in neighbor contact, so that neighbor pulses
+     * never cross between threads. Then assign each group to the least
+     * loaded worker. This is a pure function of the neighbor matrix, so
+     * the partitioning (and therefore the simulation) is deterministic.
      */
 
     System *sys = this->sys;
-    unsigned batch = sys->time.timestepTicks();
+    unsigned nCubes = sys->opt_numCubes;
+    uint32_t adjacent[MAX_WORKERS];
+
+    for (unsigned i = 0; i < nCubes; i++)
+        adjacent[i] = 1 << i;
+
+    for (unsigned i = 0; i < nCubes; i++) {
+        uint32_t contacts = sys->cubes[i].neighbors.contactMask() & ((1 << nCubes) - 1);
+        adjacent[i] |= contacts;
+        for (uint32_t m = contacts; m; m &= m - 1)
+            adjacent[__builtin_ctz(m)] |= 1 << i;
+    }
+
+    for (unsigned w = 0; w < mNumWorkers; w++) {
+        mWorkers[w].cubeMask = 0;
+        mWorkers[w].clock.clocks = sys->time.clocks;
+    }
+
+    uint32_t unassigned = (1 << nCubes) - 1;
+    while (unassigned) {
+        uint32_t group = unassigned & -unassigned;
+        uint32_t prev;
+        do {
+            prev = group;
+            for (uint32_t m = prev; m; m &= m - 1)
+                group |= adjacent[__builtin_ctz(m)];
+        } while (group != prev);
+        unassigned &= ~group;
+
+        Worker *best = &mWorkers[0];
+        for (unsigned w = 1; w < mNumWorkers; w++)
+            if (__builtin_popcount(mWorkers[w].cubeMask) < __builtin_popcount(best->cubeMask))
+                best = &mWorkers[w];
+
+        best->cubeMask |= group;
+        for (uint32_t m = group; m; m &= m - 1)
+            sys->cubes[__builtin_ctz(m)].setTimeBase(&best->clock);
+    }
+}
+
+void SystemCubes::runEpoch(unsigned ticks)
+{
+    partitionCubes();
+
+    mEpochTicks = ticks;
+    mWorkersBusy = mNumWorkers - 1;
+
+    mWorkerLock.lock();
+    mEpochGeneration++;
+    mWorkerCond.notify_all();
+    mWorkerLock.unlock();
+
+    Worker &w = mWorkers[0];
+    tickGroupFastSBT(w.cubeMask, w.clock, ticks);
+
+    while (*(volatile uint32_t*) &mWorkersBusy)
+        tthread::this_thread::yield();
+    __sync_synchronize();
+}
+
+void SystemCubes::tickGroupFastSBT(uint32_t cubeMask, VirtualTime &clock, unsigned ticks)
+{
+    /*
+     * Run a group of cubes for exactly 'ticks' clock cycles, all on the
+     * given clock. Steps are as large as the cubes themselves allow.
+     * No synchronization happens here, that's up to the caller.
+     */
+
+    System *sys = this->sys;
+    uint64_t end = clock.clocks + ticks;
     unsigned stepSize = 1;
 
-    while (batch && stepSize) {
-        unsigned nextStep;
-        batch -= stepSize;
-        nextStep = batch;
-        tick(stepSize);
+    if (!cubeMask) {
+        clock.clocks = end;
+        return;
+    }
+
+    /*
+     * Idle cubes (see Hardware::idleTicks) aren't stepped at all. They owe
+     * us the ticks we skipped, and catch up in one batch when their idle
+     * period runs out, when a neighbor pulse arrives, or when we're done.
+     */
+
+    unsigned idle[System::MAX_CUBES];
+    unsigned owed[System::MAX_CUBES];
+
+    for (uint32_t m = cubeMask; m; m &= m - 1) {
+        unsigned i = __builtin_ctz(m);
+        idle[i] = 0;
+        owed[i] = 0;
+    }
+
+    while (1) {
+        unsigned nextStep = ticks;
+
+        for (uint32_t m = cubeMask; m; m &= m - 1) {
+            unsigned i = __builtin_ctz(m);
+            Cube::Hardware &cube = sys->cubes[i];
+            unsigned batch = owed[i] + stepSize;
+
+            if (batch < idle[i] && !cube.cpu.needTimerEdgeCheck) {
+                owed[i] = batch;
+                nextStep = std::min(nextStep, idle[i] - batch);
+                continue;
+            }
+
+            unsigned next = cube.tickFastSBT(batch);
+            owed[i] = 0;
+
+            // Idle cubes are bounded by their idle period, not by CPU timing
+            idle[i] = cube.idleTicks();
+            nextStep = std::min(nextStep, idle[i] ? idle[i] : next);
+        }
+
+        clock.tick(stepSize);
+        if (clock.clocks >= end)
+            break;
+
+        stepSize = std::max(1U, std::min(nextStep, unsigned(end - clock.clocks)));
+    }
 
-        stepSize = std::min(nextStep, (unsigned)deadlineSync.remaining());
-        stepSize = std::min(stepSize, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+    for (uint32_t m = cubeMask; m; m &= m - 1) {
+        unsigned i = __builtin_ctz(m);
+        if (owed[i])
+            sys->cubes[i].tickFastSBT(owed[i]);
     }
 }
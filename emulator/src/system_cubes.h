@@ -30,6 +30,8 @@
 #include "tinythread.h"
 #include "macros.h"
 #include "deadlinesynchronizer.h"
+#include "vtime.h"
+#include <sifteo/abi.h>
 
 class System;
 
@@ -53,20 +55,59 @@ class SystemCubes {
     // Allow other threads to synchronize with cube execution
     DeadlineSynchronizer deadlineSync;
 
+    // Paces the cube thread. Other threads may read its statistics.
+    TimeGovernor governor;
+
  private: 
     static void threadFn(void *param);
     bool initCube(unsigned id);
 
     ALWAYS_INLINE void tick(unsigned count=1);
+    ALWAYS_INLINE void endEpoch();
+    ALWAYS_INLINE unsigned nextEpoch(unsigned batch);
     NEVER_INLINE void tickLoopDebug();
     NEVER_INLINE void tickLoopGeneral();
     NEVER_INLINE void tickLoopFastSBT();
     NEVER_INLINE void tickLoopEmpty();
+    NEVER_INLINE void tickLoopParallel();
+
+    /*
+     * Optional worker pool, for --cube-threads. Each worker ticks a group
+     * of cubes against its own copy of the virtual clock. Workers only
+     * rally with the cube thread at epoch boundaries, where tick() runs
+     * deadlineSync and MCNeighbor with every cube halted.
+     *
+     * Worker 0 is always the cube thread itself.
+     */
+    struct Worker {
+        SystemCubes *owner;
+        tthread::thread *thread;
+        VirtualTime clock;
+        uint32_t cubeMask;
+    };
+
+    static const unsigned MAX_WORKERS = _SYS_NUM_CUBE_SLOTS;
+
+    static void workerFn(void *param);
+    void startWorkers();
+    void stopWorkers();
+    void partitionCubes();
+    void runEpoch(unsigned ticks);
+    void tickGroupFastSBT(uint32_t cubeMask, VirtualTime &clock, unsigned ticks);
 
     System *sys;
     tthread::thread *mThread;
     tthread::mutex mBigCubeLock;
     bool mThreadRunning;
+
+    Worker mWorkers[MAX_WORKERS];
+    unsigned mNumWorkers;
+    unsigned mEpochTicks;
+    uint32_t mEpochGeneration;
+    uint32_t mWorkersBusy;
+    bool mWorkersRunning;
+    tthread::mutex mWorkerLock;
+    tthread::condition_variable mWorkerCond;
 };
 
 #endif
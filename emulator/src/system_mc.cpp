@@ -46,6 +46,7 @@
 #include "svmcpu.h"
 #include "svmruntime.h"
 #include "cube.h"
+#include "vram.h"
 #include "protocol.h"
 #include "tasks.h"
 #include "mc_timing.h"
@@ -57,6 +58,9 @@
 #include "cubeconnector.h"
 #include "neighbor_tx.h"
 #include "led.h"
+#include "inputlog.h"
+#include "testserver.h"
+#include "mc_bluetooth.h"
 
 SystemMC *SystemMC::instance;
 std::vector< std::vector<uint8_t> > SystemMC::pendingGameInstalls;
@@ -67,6 +71,12 @@ bool SystemMC::init(System *sys)
 {
     this->sys = sys;
     instance = this;
+    nullAudioSamples = 0;
+    nullAudioUnderruns = 0;
+    radioPackets = 0;
+
+    if (!sys->opt_svmProfile.empty())
+        SvmProfiler::start();
 
     if (!sys->opt_waveoutFilename.empty() &&
         !waveOut.open(sys->opt_waveoutFilename.c_str(), AudioMixer::SAMPLE_HZ)) {
@@ -111,6 +121,11 @@ void SystemMC::exit()
         AudioOutDevice::stop();
 
     waveOut.close();
+
+    if (SvmProfiler::isRunning()) {
+        if (!SvmProfiler::write(sys->opt_svmProfile.c_str()))
+            LOG(("PROFILE: Can't write SVM profile '%s'\n", sys->opt_svmProfile.c_str()));
+    }
 }
 
 void SystemMC::autoInstall()
@@ -192,10 +207,17 @@ void SystemMC::threadFn(void *param)
     // Start the master at some point shortly after the cubes come up
     instance->ticks = instance->sys->time.clocks + MCTiming::STARTUP_DELAY;
     instance->radioPacketDeadline = instance->ticks + MCTiming::TICKS_PER_PACKET;
+    instance->replayDeadline = MAX(InputLog::nextDeadline(), instance->ticks);
     instance->heartbeatDeadline = instance->ticks;
+    instance->profileDeadline = SvmProfiler::isRunning() ?
+        instance->ticks + MCTiming::TICK_HZ / SvmProfiler::SAMPLE_HZ : uint64_t(-1);
+    instance->audioDeadline = instance->sys->opt_headless ?
+        instance->ticks + MCTiming::TICKS_PER_HEADLESS_AUDIO : uint64_t(-1);
+    instance->bluetoothDeadline = BluetoothBridge::isRunning() ?
+        instance->ticks + BluetoothBridge::CONNECTION_INTERVAL : uint64_t(-1);
 
     instance->sys->getCubeSync().beginEventAt(instance->ticks, instance->mThreadRunning);
-    instance->sys->getCubeSync().endEvent(instance->radioPacketDeadline);
+    instance->sys->getCubeSync().endEvent(instance->cubeSyncDeadline());
 
     /*
      * Emulator magic: Automatically install games and pair cubes
@@ -246,7 +268,13 @@ void Tasks::waitForInterrupt()
 
     SystemMC *self = SystemMC::instance;
     self->ticks = self->radioPacketDeadline;
-    self->elapseTicks(0);
+    self->elapseTicks(0, SvmProfiler::Idle);
+}
+
+bool SystemMC::isSimulationThread()
+{
+    return instance && instance->mThread &&
+        instance->mThread->get_id() == tthread::this_thread::get_id();
 }
 
 Cube::Hardware *SystemMC::getCubeForSlot(CubeSlot *slot)
@@ -254,6 +282,45 @@ Cube::Hardware *SystemMC::getCubeForSlot(CubeSlot *slot)
     return instance->getCubeForAddress(slot->getRadioAddress());
 }
 
+void SystemMC::checkQuiescentVRAM(CubeSlot *slot)
+{
+    /*
+     * Called when a cube should be caught up with its VideoBuffer: every
+     * word that isn't still marked in the changemap must match the cube's
+     * own copy of VRAM. Dirty runs are skipped a cm1 word at a time, so
+     * a mostly-clean buffer costs very little to check.
+     */
+
+    Cube::Hardware *cube = getCubeForSlot(slot);
+    _SYSVideoBuffer *vbuf = slot->getVBuf();
+    if (!cube || !vbuf)
+        return;
+
+    const uint16_t *cubeVRAM = reinterpret_cast<const uint16_t*>(&cube->cpu.mExtData[0]);
+    unsigned mismatches = 0;
+    uint16_t addr = 0;
+
+    while (addr < _SYS_VRAM_WORDS) {
+        uint16_t dirty = addr;
+        unsigned runLength = VRAM::findDirtyRun(*vbuf, dirty);
+        uint16_t cleanEnd = runLength ? dirty : _SYS_VRAM_WORDS;
+
+        for (; addr < cleanEnd; ++addr) {
+            if (cubeVRAM[addr] != vbuf->vram.words[addr]) {
+                if (!mismatches)
+                    LOG(("VRAM[%d]: Cube out of sync at %03x, expected %04x, found %04x\n",
+                        slot->id(), addr, vbuf->vram.words[addr], cubeVRAM[addr]));
+                mismatches++;
+            }
+        }
+
+        addr = cleanEnd + runLength;
+    }
+
+    if (mismatches)
+        LOG(("VRAM[%d]: %d clean words out of sync\n", slot->id(), mismatches));
+}
+
 bool SystemMC::installGame(const char *path)
 {
     bool success = true;
@@ -280,25 +347,73 @@ bool SystemMC::installGame(const char *path)
     return success;
 }
 
-void SystemMC::elapseTicks(unsigned n)
+void SystemMC::elapseTicks(unsigned n, SvmProfiler::SubSystem subsystem)
 {
     SystemMC *self = instance;
 
     self->ticks += n;
 
+    // Sampling profiler, weighted by the number of sample periods that passed
+    if (UNLIKELY(self->ticks >= self->profileDeadline)) {
+        const unsigned period = MCTiming::TICK_HZ / SvmProfiler::SAMPLE_HZ;
+        unsigned weight = 1 + (self->ticks - self->profileDeadline) / period;
+        self->profileDeadline += uint64_t(weight) * period;
+        SvmProfiler::sample(subsystem, weight);
+    }
+
     // Asynchronous exit
     if (!self->mThreadRunning)
         longjmp(self->mThreadExitJmp, 1);
 
-    // Asynchronous radio packets
-    while (self->ticks >= self->radioPacketDeadline)
-        self->doRadioPacket();
+    // Asynchronous radio packets and replayed inputs, in order
+    while (self->ticks >= self->cubeSyncDeadline()) {
+        if (self->replayDeadline <= self->radioPacketDeadline)
+            self->doReplayEvent();
+        else
+            self->doRadioPacket();
+    }
 
     // Asynchronous task heartbeat
     while (self->ticks >= self->heartbeatDeadline) {
         Tasks::heartbeatISR();
         self->heartbeatDeadline += MCTiming::TICK_HZ / Tasks::HEARTBEAT_HZ;
     }
+
+    // Headless audio clock. The mixer catches up on however many samples are due.
+    if (self->ticks >= self->audioDeadline) {
+        Tasks::trigger(Tasks::AudioPull);
+        do {
+            self->audioDeadline += MCTiming::TICKS_PER_HEADLESS_AUDIO;
+        } while (self->ticks >= self->audioDeadline);
+    }
+
+    // Bluetooth LE connection events, on their own fixed interval
+    while (self->ticks >= self->bluetoothDeadline) {
+        BluetoothBridge::connectionEvent();
+        self->bluetoothDeadline += BluetoothBridge::CONNECTION_INTERVAL;
+    }
+
+    // CPU can run without checking in until the next event
+    SvmCpu::setTickBudget(MIN(MIN(MIN(MIN(self->cubeSyncDeadline(),
+        self->heartbeatDeadline), self->profileDeadline), self->audioDeadline),
+        self->bluetoothDeadline) - self->ticks);
+}
+
+void SystemMC::doReplayEvent()
+{
+    /*
+     * Halt the cubes on the next recorded input (--replay) and apply
+     * everything that's due. Cube-side inputs take effect on exactly
+     * this tick, so a replay runs the same way every time.
+     */
+
+    sys->getCubeSync().beginEventAt(replayDeadline, mThreadRunning);
+    bool more = InputLog::replayUntil(replayDeadline);
+    replayDeadline = MAX(InputLog::nextDeadline(), replayDeadline);
+    sys->getCubeSync().endEvent(cubeSyncDeadline());
+
+    if (!more)
+        exit(0);
 }
 
 unsigned SystemMC::suggestAudioSamplesToMix()
@@ -312,8 +427,29 @@ unsigned SystemMC::suggestAudioSamplesToMix()
         unsigned prevSamples = instance->waveOut.getSampleCount();
         if (currentSample > prevSamples)
             return currentSample - prevSamples;
+        return 0;
     }
-    return 0;
+
+    /*
+     * Null device: keep our own position. Time that passes while the
+     * mixer is idle and not asking is dropped rather than caught up,
+     * so a newly started sound doesn't skip ahead.
+     */
+
+    uint64_t currentSample = SysTime::ticks() / SysTime::hzTicks(AudioMixer::SAMPLE_HZ);
+    uint64_t elapsed = currentSample - instance->nullAudioSamples;
+    instance->nullAudioSamples = currentSample;
+
+    unsigned capacity = AudioMixer::output.capacity();
+    if (elapsed > capacity && AudioMixer::instance.active())
+        instance->nullAudioUnderruns++;
+
+    return MIN(elapsed, uint64_t(capacity));
+}
+
+bool SystemMC::isAudioDiscarded()
+{
+    return instance->sys->opt_headless && !instance->waveOut.isOpen();
 }
 
 void SystemMC::exit(int result)
@@ -331,8 +467,17 @@ void SystemMC::exit(int result)
      * We do *not* want to just ask System to stop everything,
      * since trying to stop the MC simulation from inside the
      * simulation itself would cause a deadlock.
+     *
+     * In server mode we report the result instead, and idle until the
+     * server reboots us for its next job.
      */
 
+    if (TestServer::isRunning()) {
+        TestServer::jobFinished(result);
+        while (1)
+            Tasks::waitForInterrupt();
+    }
+
     getSystem()->stopCubesOnly();
     ::exit(result);
 }
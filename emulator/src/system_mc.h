@@ -31,6 +31,7 @@
 #include <vector>
 #include "tinythread.h"
 #include "wavefile.h"
+#include "mc_svmprofiler.h"
 
 class System;
 class Radio;
@@ -61,6 +62,9 @@ class SystemMC {
         return instance->sys;
     }
 
+    /// Are we running on the MC simulation thread right now?
+    static bool isSimulationThread();
+
     // Exit from Siftulator entirely, from within the System simulation thread.
     static void exit(int result);
 
@@ -68,9 +72,11 @@ class SystemMC {
      * Cause some time to pass in the MC simulation, and service any
      * asynchronous events that occurred during this elapsed time.
      *
-     * Must only be called from the MC thread.
+     * Must only be called from the MC thread. 'subsystem' is what the
+     * sampling profiler (--svm-profile) blames for this time.
      */
-    static void elapseTicks(unsigned n);
+    static void elapseTicks(unsigned n,
+        SvmProfiler::SubSystem subsystem = SvmProfiler::UserCode);
 
     /**
      * Log some audio data. Has no effect unless --waveout was
@@ -87,14 +93,46 @@ class SystemMC {
      */
     static unsigned suggestAudioSamplesToMix();
 
+    /**
+     * In headless mode without --waveout, nobody hears our audio. The
+     * mixer still advances every channel (so playback positions and the
+     * tracker clock behave as usual) but may skip generating samples.
+     */
+    static bool isAudioDiscarded();
+
+    /**
+     * Headless null device only: how many times the mixer was running
+     * but fell more than a full buffer behind, where real hardware
+     * would have played silence.
+     */
+    static uint32_t audioUnderrunCount() {
+        return instance ? instance->nullAudioUnderruns : 0;
+    }
+
+    /// Current MC clock. Only meaningful on the MC thread.
+    static uint64_t currentTicks() {
+        return instance->ticks;
+    }
+
+    /// Radio transmission attempts, including retries.
+    static uint64_t radioPacketCount() {
+        return instance ? instance->radioPackets : 0;
+    }
+
  private:
     static void threadFn(void *);
     void doRadioPacket();
+    void doReplayEvent();
     void autoInstall();
     void pairCube(unsigned cubeID, unsigned pairingID);
 
     Cube::Hardware *getCubeForAddress(const RadioAddress *addr);
 
+    /// How far the cubes may run before the MC next needs to touch them
+    uint64_t cubeSyncDeadline() const {
+        return radioPacketDeadline < replayDeadline ? radioPacketDeadline : replayDeadline;
+    }
+
     friend class Radio;
     friend struct SysTime;
     friend class Tasks;
@@ -105,7 +143,14 @@ class SystemMC {
 
     uint64_t ticks;
     uint64_t radioPacketDeadline;
+    uint64_t replayDeadline;
     uint64_t heartbeatDeadline;
+    uint64_t profileDeadline;
+    uint64_t audioDeadline;
+    uint64_t bluetoothDeadline;
+    uint64_t nullAudioSamples;
+    uint32_t nullAudioUnderruns;
+    uint64_t radioPackets;
 
     System *sys;
     WaveWriter waveOut;
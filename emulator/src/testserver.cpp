@@ -0,0 +1,216 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Must be before other headers
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define WINVER WindowsXP
+#   define _WIN32_WINNT 0x502
+#   include <windows.h>
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <unistd.h>
+#   define closesocket(_s) close(_s)
+#endif
+
+#include "testserver.h"
+#include "system.h"
+#include "lua_script.h"
+#include <string.h>
+#include <stdio.h>
+
+#define LOG_PREFIX  "Test Server: "
+
+TestServer TestServer::instance;
+
+
+int TestServer::run(System &sys, int port)
+{
+    #ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    #endif
+
+    // Every job starts over from the freshly initialized system.
+    instance.baseline = tmpfile();
+    if (!instance.baseline || !sys.saveSnapshot(instance.baseline)) {
+        fprintf(stderr, LOG_PREFIX "Can't save the initial snapshot\n");
+        return 1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = 0x0100007f;
+    addr.sin_port = htons(port);
+
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+
+    unsigned long arg = 1;
+    setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, (const char *)&arg, sizeof arg);
+
+    if (bind(listenFD, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't bind to port!\n");
+        return 1;
+    }
+
+    if (listen(listenFD, 1) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't listen on socket\n");
+        return 1;
+    }
+
+    fprintf(stderr, LOG_PREFIX "Listening on port %d\n", port);
+
+    LuaScript lua(sys);
+    instance.lua = &lua;
+    instance.sys = &sys;
+
+    bool running = true;
+    while (running) {
+        struct sockaddr_in addr;
+        socklen_t addrSize = sizeof addr;
+        instance.clientFD = accept(listenFD, (struct sockaddr *) &addr, &addrSize);
+        if (instance.clientFD < 0)
+            break;
+
+        running = instance.handleClient();
+        closesocket(instance.clientFD);
+    }
+
+    closesocket(listenFD);
+    fclose(instance.baseline);
+    return 0;
+}
+
+bool TestServer::handleClient()
+{
+    /*
+     * Read newline-terminated commands until the client disconnects.
+     * Returns false if we were asked to quit.
+     */
+
+    char buffer[4096];
+    unsigned len = 0;
+
+    while (1) {
+        int ret = recv(clientFD, buffer + len, sizeof buffer - 1 - len, 0);
+        if (ret <= 0)
+            return true;
+        len += ret;
+
+        char *end;
+        while ((end = (char*) memchr(buffer, '\n', len)) != NULL) {
+            unsigned used = end + 1 - buffer;
+            *end = '\0';
+            if (end > buffer && end[-1] == '\r')
+                end[-1] = '\0';
+
+            if (!handleCommand(buffer))
+                return false;
+
+            len -= used;
+            memmove(buffer, buffer + used, len);
+        }
+
+        if (len == sizeof buffer - 1) {
+            // Nowhere to put the rest of this line. Discard it.
+            reply("error line too long");
+            len = 0;
+        }
+    }
+}
+
+bool TestServer::handleCommand(char *line)
+{
+    if (!strncmp(line, "run ", 4)) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "exit %d", runJob(line + 4));
+        reply(buf);
+        return true;
+    }
+
+    if (!strncmp(line, "lua ", 4)) {
+        reply(lua->runString(line + 4) ? "error" : "ok");
+        return true;
+    }
+
+    if (!strcmp(line, "quit")) {
+        reply("ok");
+        return false;
+    }
+
+    reply("error unknown command");
+    return true;
+}
+
+int TestServer::runJob(const char *filename)
+{
+    /*
+     * Boot a fresh system with 'filename' as its launcher, and wait for
+     * the launcher to exit. The MC thread re-reads opt_launcherFilename
+     * when it (re)starts, and installs that launcher to the blank flash.
+     */
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, LOG_PREFIX "Can't open '%s'\n", filename);
+        return -1;
+    }
+    fclose(f);
+
+    jobLock.lock();
+    jobRunning = true;
+    jobLock.unlock();
+
+    sys->opt_launcherFilename = filename;
+
+    if (!sys->isRunning())
+        sys->start();
+    else if (!sys->restoreSnapshot(baseline))
+        return -1;
+
+    tthread::lock_guard<tthread::mutex> guard(jobLock);
+    while (jobRunning)
+        jobCond.wait(jobLock);
+    return jobResult;
+}
+
+void TestServer::jobFinished(int result)
+{
+    tthread::lock_guard<tthread::mutex> guard(instance.jobLock);
+    instance.jobResult = result;
+    instance.jobRunning = false;
+    instance.jobCond.notify_all();
+}
+
+void TestServer::reply(const char *str)
+{
+    send(clientFD, str, strlen(str), 0);
+    send(clientFD, "\n", 1, 0);
+}
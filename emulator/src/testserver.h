@@ -0,0 +1,84 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _TEST_SERVER_H
+#define _TEST_SERVER_H
+
+#include <stdio.h>
+#include "tinythread.h"
+
+class System;
+class LuaScript;
+
+
+/**
+ * Server mode (--server PORT) keeps one headless siftulator resident, and
+ * runs jobs sent to it over a local TCP socket. This saves each unit test
+ * the cost of process startup, SBT ROM loading, and flash setup.
+ *
+ * The protocol is plain text, one command per line:
+ *
+ *   run GAME.elf    Reset the system, and run GAME.elf as the launcher.
+ *                   Replies "exit N" with the launcher's exit status.
+ *   lua CHUNK       Run a line of Lua in the server's interpreter.
+ *                   Replies "ok" or "error".
+ *   quit            Shut down the server. Replies "ok".
+ *
+ * Each "run" starts from a snapshot taken right after System::init(), so
+ * every job sees blank flash and freshly reset cubes.
+ */
+class TestServer {
+public:
+    /// Serve jobs on the main thread until "quit". System must be initialized.
+    static int run(System &sys, int port);
+
+    static bool isRunning() {
+        return instance.sys != 0;
+    }
+
+    /// Called on the MC thread when the launcher exits
+    static void jobFinished(int result);
+
+private:
+    TestServer() {}
+    static TestServer instance;
+
+    System *sys;
+    LuaScript *lua;
+    FILE *baseline;
+    int clientFD;
+
+    tthread::mutex jobLock;
+    tthread::condition_variable jobCond;
+    bool jobRunning;
+    int jobResult;
+
+    bool handleClient();
+    bool handleCommand(char *line);
+    int runJob(const char *filename);
+    void reply(const char *str);
+};
+
+#endif
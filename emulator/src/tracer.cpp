@@ -27,14 +27,29 @@
 #include "macros.h"
 #include "tracer.h"
 #include "vtime.h"
+#include <string.h>
+#include <algorithm>
+#include <string>
 
 bool Tracer::enabled;
+bool Tracer::recording;
+bool Tracer::dumpRequested;
 Tracer *Tracer::instance;
 
 
 void Tracer::setEnabled(bool b)
 {
-    if (b) {
+    if (b && binary) {
+        instance = this;
+
+        if (!binaryTrace.isOpen())
+            binaryTrace.open("trace.bin", vcd.getHeader(), vcd.getSignalTable());
+
+        enabled = binaryTrace.isOpen();
+        if (!enabled)
+            fprintf(stderr, "Tracer: Error opening output file!\n");
+
+    } else if (b) {
         instance = this;
         
         if (!textTraceFile) {
@@ -54,14 +69,88 @@ void Tracer::setEnabled(bool b)
     } else {
         enabled = false;
 
-        fflush(textTraceFile);
-        fflush(vcdTraceFile);
+        if (textTraceFile)
+            fflush(textTraceFile);
+        if (vcdTraceFile)
+            fflush(vcdTraceFile);
+    }
+}
+
+void Tracer::setFlightRecorder(bool b)
+{
+    if (b) {
+        instance = this;
+        if (!flight)
+            flight = new FlightRecorder;
+    }
+    recording = b;
+}
+
+void Tracer::trigger(const char *reason)
+{
+    if (!isRecording())
+        return;
+
+    strncpy(instance->triggerReason, reason, sizeof instance->triggerReason - 1);
+    instance->triggerReason[sizeof instance->triggerReason - 1] = '\0';
+
+    // The cube thread picks this up on its next tick()
+    __sync_synchronize();
+    dumpRequested = true;
+}
+
+void Tracer::dumpFlightRecorder()
+{
+    dumpRequested = false;
+    __sync_synchronize();
+
+    char filename[32];
+    snprintf(filename, sizeof filename, "flight-%03u.txt", flightDumpCount++);
+
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Tracer: Error opening output file!\n");
+        return;
     }
+
+    fprintf(f, "# Flight recorder, triggered by: %s\n", triggerReason);
+    flight->dump(f);
+    fclose(f);
+
+    fprintf(stderr, "Tracer: Flight recorder written to '%s' (%s)\n",
+        filename, triggerReason);
+}
+
+void Tracer::record(const Cube::CPU::em8051 *cpu, const char *fmt, int numArgs,
+    int a, int b, int c, int d, int e, int f, int g, int h)
+{
+    FlightRecorder::Entry &entry = instance->flight->append();
+
+    entry.clock = instance->getLocalClock(*cpu->vtime);
+    entry.fmt = fmt;
+    entry.cube = cpu->id;
+    entry.numArgs = numArgs;
+    entry.args[0] = a;
+    entry.args[1] = b;
+    entry.args[2] = c;
+    entry.args[3] = d;
+    entry.args[4] = e;
+    entry.args[5] = f;
+    entry.args[6] = g;
+    entry.args[7] = h;
 }
 
 void Tracer::close()
 {
     setEnabled(false);
+
+    if (flight) {
+        if (dumpRequested)
+            dumpFlightRecorder();
+        recording = false;
+        delete flight;
+        flight = NULL;
+    }
     
     if (textTraceFile) {
         fclose(textTraceFile);
@@ -72,6 +161,8 @@ void Tracer::close()
         fclose(vcdTraceFile);
         vcdTraceFile = NULL;
     }
+
+    binaryTrace.close();
 }
 
 void Tracer::logWork(const Cube::CPU::em8051 *cpu)
@@ -79,8 +170,44 @@ void Tracer::logWork(const Cube::CPU::em8051 *cpu)
     fprintf(textTraceFile, "[%02d t=%"PRIu64"] ", cpu->id, getLocalClock(*cpu->vtime));
 }
 
+void Tracer::logBinary(const Cube::CPU::em8051 *cpu, const char *text, unsigned length)
+{
+    binaryTrace.writeText(getLocalClock(*cpu->vtime), cpu->id, text, length);
+}
+
+void Tracer::logText(const Cube::CPU::em8051 *cpu, const char *text)
+{
+    // Log preformatted text, in either binary or flight recorder mode
+
+    if (isEnabled()) {
+        logBinary(cpu, text, strlen(text));
+    } else {
+        FlightRecorder::Entry &entry = flight->append();
+        entry.clock = getLocalClock(*cpu->vtime);
+        entry.fmt = NULL;
+        entry.cube = cpu->id;
+        entry.numArgs = -1;
+        strncpy(entry.text, text, sizeof entry.text - 1);
+        entry.text[sizeof entry.text - 1] = '\0';
+    }
+}
+
 void Tracer::logWork(const Cube::CPU::em8051 *cpu, const char *fmt, va_list ap)
 {
+    if (!isEnabled()) {
+        char buf[FlightRecorder::TEXT_SIZE];
+        vsnprintf(buf, sizeof buf, fmt, ap);
+        logText(cpu, buf);
+        return;
+    }
+
+    if (binary) {
+        char buf[1024];
+        int len = vsnprintf(buf, sizeof buf, fmt, ap);
+        logBinary(cpu, buf, std::min<unsigned>(std::max(len, 0), sizeof buf - 1));
+        return;
+    }
+
     logWork(cpu);
     vfprintf(textTraceFile, fmt, ap);
     fprintf(textTraceFile, "\n");
@@ -88,6 +215,19 @@ void Tracer::logWork(const Cube::CPU::em8051 *cpu, const char *fmt, va_list ap)
 
 void Tracer::logHexWork(const Cube::CPU::em8051 *cpu, const char *msg, size_t len, void *data)
 {
+    if (binary || !isEnabled()) {
+        std::string text = msg;
+        char buf[16];
+        snprintf(buf, sizeof buf, " [%u]", (unsigned)len);
+        text += buf;
+        for (uint8_t *bytes = (uint8_t*) data; len; len--, bytes++) {
+            snprintf(buf, sizeof buf, " %02x", *bytes);
+            text += buf;
+        }
+        logText(cpu, text.c_str());
+        return;
+    }
+
     logWork(cpu);
 
     fprintf(textTraceFile, "%s [%u]", msg, (unsigned)len);
@@ -27,6 +27,9 @@
 /*
  * Trace logging support, for development use only.
  * Requires a firmware image. (Intentionally disabled with SBT)
+ *
+ * Traces normally go to trace.txt and trace.vcd. In binary mode, both are
+ * written to trace.bin instead, via TraceWriter.
  */
 
 #ifndef _TRACER_H
@@ -36,27 +39,56 @@
 #include <stdarg.h>
 #include "macros.h"
 #include "vcdwriter.h"
+#include "tracewriter.h"
+#include "flightrecorder.h"
 #include "cube_cpu.h"
 
 
 class Tracer {
  public:
     Tracer()
-        : epochIsSet(false), textTraceFile(NULL), vcdTraceFile(NULL) {}
+        : flight(NULL), flightDumpCount(0), epochIsSet(false), binary(false),
+          textTraceFile(NULL), vcdTraceFile(NULL) {}
 
     VCDWriter vcd;
      
     void setEnabled(bool b);     
     void close();
 
+    // Must be set before the first setEnabled(true)
+    void setBinary(bool b) {
+        binary = b;
+    }
+
     ALWAYS_INLINE void tick(const VirtualTime &vtime) {
-        if (isEnabled())
-            vcd.writeTick(vcdTraceFile, getLocalClock(vtime));
+        if (isEnabled()) {
+            if (binary)
+                vcd.writeTick(binaryTrace, getLocalClock(vtime));
+            else
+                vcd.writeTick(vcdTraceFile, getLocalClock(vtime));
+        } else if (UNLIKELY(dumpRequested)) {
+            dumpFlightRecorder();
+        }
     }
 
     ALWAYS_INLINE static bool isEnabled() {
         return UNLIKELY(enabled);
     }
+
+    /*
+     * Flight recorder mode. Log events are kept in memory, but the VCD and
+     * instruction traces are off. The recent history is written to a
+     * numbered flight-NNN.txt file after each trigger().
+     */
+
+    void setFlightRecorder(bool b);
+
+    ALWAYS_INLINE static bool isRecording() {
+        return UNLIKELY(recording);
+    }
+
+    /// Request a flight recorder dump. Safe to call from any thread.
+    static void trigger(const char *reason);
     
     /*
      * Note that some versions of GCC can't inline variatic functions.
@@ -67,7 +99,7 @@ class Tracer {
     static void logV(const Cube::CPU::em8051 *cpu, const char *fmt, ...)
         __attribute__ ((format(printf,2,3)))
     {
-        if (isEnabled()) {
+        if (isEnabled() || isRecording()) {
             va_list ap;
             va_start(ap, fmt);
             instance->logWork(cpu, fmt, ap);
@@ -85,6 +117,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, "%s", fmt);
+        else if (isRecording())
+            record(cpu, fmt, 0);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -92,6 +126,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a);
+        else if (isRecording())
+            record(cpu, fmt, 1, a);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -99,12 +135,14 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b);
+        else if (isRecording())
+            record(cpu, fmt, 2, a, b);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
                                   int a, const char *b)
     {
-        if (isEnabled())
+        if (isEnabled() || isRecording())
             logV(cpu, fmt, a, b);
     }
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -112,6 +150,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c);
+        else if (isRecording())
+            record(cpu, fmt, 3, a, b, c);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -119,6 +159,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c, d);
+        else if (isRecording())
+            record(cpu, fmt, 4, a, b, c, d);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -126,6 +168,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c, d, e);
+        else if (isRecording())
+            record(cpu, fmt, 5, a, b, c, d, e);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -133,6 +177,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c, d, e, f);
+        else if (isRecording())
+            record(cpu, fmt, 6, a, b, c, d, e, f);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -140,6 +186,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c, d, e, f, g);
+        else if (isRecording())
+            record(cpu, fmt, 7, a, b, c, d, e, f, g);
     }
 
     static ALWAYS_INLINE void log(const Cube::CPU::em8051 *cpu, const char *fmt,
@@ -147,6 +195,8 @@ class Tracer {
     {
         if (isEnabled())
             logV(cpu, fmt, a, b, c, d, e, f, g, h);
+        else if (isRecording())
+            record(cpu, fmt, 8, a, b, c, d, e, f, g, h);
     }
     
     /*
@@ -155,19 +205,27 @@ class Tracer {
 
     static ALWAYS_INLINE void logHex(const Cube::CPU::em8051 *cpu, const char *msg, size_t len, void *data)
     {
-        if (isEnabled())
+        if (isEnabled() || isRecording())
             instance->logHexWork(cpu, msg, len, data);
     }
     
  private:
     static bool enabled;
+    static bool recording;
+    static bool dumpRequested;
     static Tracer *instance;
+
+    FlightRecorder *flight;
+    unsigned flightDumpCount;
+    char triggerReason[64];
      
     bool epochIsSet;
     uint64_t epoch;
 
+    bool binary;
     FILE *textTraceFile;
     FILE *vcdTraceFile;
+    TraceWriter binaryTrace;
     
     uint64_t getLocalClock(const VirtualTime &vtime)
     {
@@ -186,6 +244,12 @@ class Tracer {
     
     void logWork(const Cube::CPU::em8051 *cpu);
     void logWork(const Cube::CPU::em8051 *cpu, const char *fmt, va_list ap);
+    void logBinary(const Cube::CPU::em8051 *cpu, const char *text, unsigned length);
+    void logText(const Cube::CPU::em8051 *cpu, const char *text);
+
+    static void record(const Cube::CPU::em8051 *cpu, const char *fmt, int numArgs,
+        int a=0, int b=0, int c=0, int d=0, int e=0, int f=0, int g=0, int h=0);
+    void dumpFlightRecorder();
     void logHexWork(const Cube::CPU::em8051 *cpu, const char *msg, size_t len, void *data);
 };
 
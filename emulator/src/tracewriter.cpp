@@ -0,0 +1,184 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "tracewriter.h"
+#include "lodepng.h"
+
+
+TraceWriter::TraceWriter()
+    : file(NULL), thread(NULL), running(false) {}
+
+bool TraceWriter::open(const char *filename, const std::string &vcdHeader,
+    const std::string &signalTable)
+{
+    ASSERT(!file);
+
+    file = fopen(filename, "wb");
+    if (!file)
+        return false;
+
+    FileHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = FileHeader::MAGIC;
+    hdr.version = FileHeader::CURRENT_VERSION;
+    hdr.vcdHeaderSize = vcdHeader.size();
+    hdr.signalTableSize = signalTable.size();
+
+    fwrite(&hdr, sizeof hdr, 1, file);
+    fwrite(vcdHeader.data(), vcdHeader.size(), 1, file);
+    fwrite(signalTable.data(), signalTable.size(), 1, file);
+
+    lastClock = 0;
+    buffer.resize(BUFFER_RECORDS);
+    pending.resize(BUFFER_RECORDS);
+    bufferCount = 0;
+    pendingCount = 0;
+
+    running = true;
+    thread = new tthread::thread(threadFn, this);
+    return true;
+}
+
+void TraceWriter::close()
+{
+    if (!file)
+        return;
+
+    // Hand off our last buffer, and wait for the writer to finish it
+    flush();
+
+    lock.lock();
+    running = false;
+    cond.notify_all();
+    lock.unlock();
+
+    thread->join();
+    delete thread;
+    thread = NULL;
+
+    fclose(file);
+    file = NULL;
+}
+
+void TraceWriter::writeText(uint64_t clock, unsigned cube, const char *text, unsigned length)
+{
+    unsigned numRecords = 1 + (length + sizeof(Record) - 1) / sizeof(Record);
+
+    // Very long lines are truncated to what fits in one buffer
+    if (numRecords + 1 > BUFFER_RECORDS) {
+        numRecords = BUFFER_RECORDS - 1;
+        length = (numRecords - 1) * sizeof(Record);
+    }
+
+    if (bufferCount + numRecords + 1 > BUFFER_RECORDS)
+        flush();
+
+    Record *r = beginRecord(clock, Record::T_TEXT);
+    r->cube = cube;
+    r->value = length;
+
+    char *dest = reinterpret_cast<char*>(&buffer[bufferCount]);
+    unsigned padded = (numRecords - 1) * sizeof(Record);
+    memcpy(dest, text, length);
+    memset(dest + length, 0, padded - length);
+    bufferCount += numRecords - 1;
+}
+
+void TraceWriter::slowBeginRecord(uint64_t clock)
+{
+    if (bufferCount + 2 > BUFFER_RECORDS)
+        flush();
+
+    if (clock - lastClock > 0xFFFFFFFFu) {
+        Record *r = &buffer[bufferCount++];
+        memset(r, 0, sizeof *r);
+        r->type = Record::T_CLOCK;
+        r->value = clock;
+        lastClock = clock;
+    }
+}
+
+void TraceWriter::flush()
+{
+    /*
+     * Swap buffers with the writer thread. If it hasn't finished with
+     * the previous buffer yet, we have to wait.
+     */
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+
+    while (pendingCount)
+        cond.wait(lock);
+
+    buffer.swap(pending);
+    pendingCount = bufferCount;
+    bufferCount = 0;
+    cond.notify_all();
+}
+
+void TraceWriter::writeChunk(const Record *records, unsigned count)
+{
+    const unsigned char *raw = reinterpret_cast<const unsigned char*>(records);
+    uint32_t sizes[2] = { count * sizeof(Record), 0 };
+    unsigned char *compressed = NULL;
+    size_t compressedSize = 0;
+
+    if (LodePNG_zlib_compress(&compressed, &compressedSize, raw, sizes[0],
+            &LodePNG_defaultCompressSettings)) {
+        fprintf(stderr, "Tracer: Error compressing binary trace\n");
+    } else {
+        sizes[1] = compressedSize;
+        fwrite(sizes, sizeof sizes, 1, file);
+        fwrite(compressed, compressedSize, 1, file);
+    }
+
+    free(compressed);
+}
+
+void TraceWriter::threadFn(void *param)
+{
+    TraceWriter *self = static_cast<TraceWriter*>(param);
+    tthread::lock_guard<tthread::mutex> guard(self->lock);
+
+    for (;;) {
+        while (self->running && !self->pendingCount)
+            self->cond.wait(self->lock);
+
+        if (!self->pendingCount)
+            break;
+
+        // Compress and write without holding the lock
+        unsigned count = self->pendingCount;
+        self->lock.unlock();
+        self->writeChunk(&self->pending[0], count);
+        self->lock.lock();
+
+        self->pendingCount = 0;
+        self->cond.notify_all();
+    }
+}
@@ -0,0 +1,136 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Binary trace output. This is a much faster and more compact alternative
+ * to writing VCD and text traces directly, intended for long traces.
+ *
+ * The trace is a stream of fixed-size records: VCD signal changes (as the
+ * XOR of old and new value) and text log lines. Records are buffered in
+ * memory, and whole buffers are compressed and written by a background
+ * thread. tools/trace-convert.py turns the result back into VCD and text.
+ *
+ * File layout:
+ *
+ *   FileHeader
+ *   VCD header text                   (FileHeader::vcdHeaderSize bytes)
+ *   Signal table, one "bits id\n" per signal   (signalTableSize bytes)
+ *   Chunks: uint32 rawSize, uint32 compressedSize, zlib data
+ */
+
+#ifndef _TRACEWRITER_H
+#define _TRACEWRITER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "tinythread.h"
+#include "macros.h"
+
+
+class TraceWriter {
+public:
+    struct FileHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t vcdHeaderSize;
+        uint32_t signalTableSize;
+        uint32_t reserved;
+
+        static const uint64_t MAGIC = 0x4352547974666953LLU;   // "SiftyTRC"
+        static const uint32_t CURRENT_VERSION = 1;
+    };
+
+    struct Record {
+        uint8_t type;
+        uint8_t cube;           // T_TEXT only
+        uint16_t signal;        // T_SIGNAL only
+        uint32_t clockDelta;    // Ticks since the previous record
+        uint64_t value;         // See below
+
+        enum Type {
+            T_SIGNAL = 0,       // value is (old XOR new) signal value
+            T_TEXT,             // value is text length, text follows, padded to a full Record
+            T_CLOCK,            // value is the absolute clock, for deltas that don't fit
+        };
+    };
+
+    TraceWriter();
+
+    bool open(const char *filename, const std::string &vcdHeader,
+        const std::string &signalTable);
+    void close();
+
+    bool isOpen() const {
+        return file != NULL;
+    }
+
+    ALWAYS_INLINE void writeSignal(uint64_t clock, unsigned signal, uint64_t delta) {
+        Record *r = beginRecord(clock, Record::T_SIGNAL);
+        r->signal = signal;
+        r->value = delta;
+    }
+
+    void writeText(uint64_t clock, unsigned cube, const char *text, unsigned length);
+
+private:
+    static const unsigned BUFFER_SIZE = 1024 * 1024;
+    static const unsigned BUFFER_RECORDS = BUFFER_SIZE / sizeof(Record);
+
+    FILE *file;
+    uint64_t lastClock;
+
+    // Producer side. 'buffer' is being filled, 'pending' is waiting for the writer.
+    std::vector<Record> buffer;
+    std::vector<Record> pending;
+    unsigned bufferCount;
+    unsigned pendingCount;
+
+    tthread::thread *thread;
+    tthread::mutex lock;
+    tthread::condition_variable cond;
+    bool running;
+
+    ALWAYS_INLINE Record *beginRecord(uint64_t clock, unsigned type) {
+        if (UNLIKELY(clock - lastClock > 0xFFFFFFFFu || bufferCount + 2 > BUFFER_RECORDS))
+            slowBeginRecord(clock);
+
+        Record *r = &buffer[bufferCount++];
+        r->type = type;
+        r->cube = 0;
+        r->signal = 0;
+        r->clockDelta = clock - lastClock;
+        lastClock = clock;
+        return r;
+    }
+
+    void slowBeginRecord(uint64_t clock);
+    void flush();
+    void writeChunk(const Record *records, unsigned count);
+    static void threadFn(void *param);
+};
+
+#endif
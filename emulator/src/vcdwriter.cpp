@@ -59,8 +59,36 @@ void VCDWriter::define(const std::string name, void *var, unsigned numBits, unsi
 
 void VCDWriter::writeHeader(FILE *f)
 {
-    fprintf(f, "$timescale\n  %"PRIu64" fs\n$end\n%s$enddefinitions $end\n",
-        ((uint64_t)1e15) / VirtualTime::HZ, defs.str().c_str());
+    fputs(getHeader().c_str(), f);
+}
+
+std::string VCDWriter::getHeader()
+{
+    std::stringstream header;
+    header << "$timescale\n  " << ((uint64_t)1e15) / VirtualTime::HZ << " fs\n$end\n"
+        << defs.str() << "$enddefinitions $end\n";
+    return header.str();
+}
+
+std::string VCDWriter::getSignalTable()
+{
+    std::stringstream table;
+    for (unsigned id = 0; id < sources.size(); id++)
+        table << (unsigned)sources[id].numBits << " " << identifiers[id] << "\n";
+    return table.str();
+}
+
+void VCDWriter::writeTick(TraceWriter &w, uint64_t clock)
+{
+    for (unsigned id = 0; id < sources.size(); id++) {
+        SignalSource &source = sources[id];
+        uint64_t newValue = source.sample();
+
+        if (newValue != source.value) {
+            w.writeSignal(clock, id, newValue ^ source.value);
+            source.value = newValue;
+        }
+    }
 }
 
 void VCDWriter::writeTick(FILE *f, uint64_t clock)
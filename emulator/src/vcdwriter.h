@@ -42,6 +42,7 @@
 
 #include "macros.h"
 #include "vtime.h"
+#include "tracewriter.h"
 
 
 class VCDWriter {
@@ -57,6 +58,11 @@ public:
     void writeHeader(FILE *f);
     void writeTick(FILE *f, uint64_t clock);
 
+    // Binary trace support, see TraceWriter
+    std::string getHeader();
+    std::string getSignalTable();
+    void writeTick(TraceWriter &w, uint64_t clock);
+
 private:
     struct SignalSource {
         SignalSource(void *var, unsigned numBits, unsigned firstBit)
@@ -47,6 +47,9 @@ class VirtualTime {
     // Timestep size for simulation, in real milliseconds
     static const unsigned TIMESTEP = 10;
 
+    // Smallest timestep TimeGovernor will pick, in real microseconds
+    static const unsigned MIN_TIMESTEP_US = 1000;
+
     uint64_t clocks;
 
     static uint64_t msec(uint64_t u) {       
@@ -75,6 +78,7 @@ class VirtualTime {
     
     void init() {
         clocks = 0;
+        timestepUS = TIMESTEP * 1000;
         run();
     }
         
@@ -103,12 +107,25 @@ class VirtualTime {
     }
 
     unsigned timestepTicks() const {
-        unsigned t = TIMESTEP * targetRate / 1000;
+        unsigned t = uint64_t(timestepUS) * targetRate / 1000000;
         return t ? t : 1;
     }
 
+    unsigned getTimestepUS() const {
+        return timestepUS;
+    }
+
+    void setTimestepUS(double us) {
+        if (us > TIMESTEP * 1000)
+            us = TIMESTEP * 1000;
+        if (us < MIN_TIMESTEP_US)
+            us = MIN_TIMESTEP_US;
+        timestepUS = us;
+    }
+
 private:
     unsigned targetRate;
+    unsigned timestepUS;
 };
 
 
@@ -175,13 +192,24 @@ class TimeGovernor {
      * The time governor slows us down if we're running faster than
      * real-time, by keeping a long-term average of how many seconds
      * ahead or behind we are.
+     *
+     * It also picks the timestep. A batch runs in a burst, then we sleep,
+     * so events inside a batch land early by up to the batch's length
+     * times (1 - 1/speed), where speed is how much faster than real-time
+     * the host simulates. Audio and frame pacing feel that. So on a fast
+     * host we use shorter batches, and on a slow one, full-size batches
+     * to keep the per-batch overhead down.
      */
 
  public:
-    void start(const VirtualTime *vtime) {
+    void start(VirtualTime *vtime) {
+        this->vtime = vtime;
         et.init(vtime);
         et.start();
         secondsAhead = 0.0;
+        lagSeconds = 0.0;
+        hostSpeed = 1.0;
+        lastSleep = 0.0;
     }
 
     void step() {
@@ -197,29 +225,81 @@ class TimeGovernor {
          */
 
         static const double maxDeviation = 0.75;
-        static const double minSleep = 0.01;
+        static const double minSleep = 0.001;
+        static const double jitterTarget = 0.002;
 
         et.capture();
 
-        secondsAhead += et.virtualSeconds() - et.realSeconds();
+        double virtualS = et.virtualSeconds();
+        double realS = et.realSeconds();
+        secondsAhead += virtualS - realS;
+
+        // Simulation speed, not counting the time we spent asleep
+        double busyS = realS - lastSleep;
+        if (busyS > 0 && virtualS > 0)
+            hostSpeed += 0.1 * (virtualS / busyS - hostSpeed);
 
         /*
          * Fully reset if we're lagging/leading too much, rather than clamping to our limit.
          * (Among other things, this avoids catch-up delay when coming out of Turbo)
          */        
 
+        if (secondsAhead < -maxDeviation)
+            lagSeconds -= secondsAhead;
         if (secondsAhead < -maxDeviation || secondsAhead > maxDeviation)
             secondsAhead = 0;
 
-        if (secondsAhead > minSleep)
-            OSTime::sleep(secondsAhead);
+        if (hostSpeed > 1.0)
+            vtime->setTimestepUS(1e6 * jitterTarget / (1.0 - 1.0 / hostSpeed));
+        else
+            vtime->setTimestepUS(VirtualTime::TIMESTEP * 1000);
+
+        /*
+         * The next interval includes however long we actually sleep,
+         * so any oversleep comes back out of secondsAhead.
+         */
+
+        lastSleep = 0.0;
+        if (secondsAhead > minSleep) {
+            double before = OSTime::clock();
+            OSTime::sleepPrecise(secondsAhead);
+            lastSleep = OSTime::clock() - before;
+        }
        
         et.start();
     }
 
+    void unthrottled() {
+        // Running flat out (turbo). Use the largest batches, and forget our timing.
+        vtime->setTimestepUS(VirtualTime::TIMESTEP * 1000);
+        et.capture();
+        et.start();
+        secondsAhead = 0.0;
+        lastSleep = 0.0;
+    }
+
+    /// Seconds ahead (positive) or behind (negative) of real-time
+    double getDrift() const {
+        return secondsAhead;
+    }
+
+    /// Total seconds we've fallen behind real-time and given up on
+    double getLag() const {
+        return lagSeconds;
+    }
+
+    /// Recent simulation speed, relative to real-time, excluding sleeps
+    double getHostSpeed() const {
+        return hostSpeed;
+    }
+
  private:
+    VirtualTime *vtime;
     ElapsedTime et;
     double secondsAhead;
+    double lagSeconds;
+    double hostSpeed;
+    double lastSleep;
 };
 
 
@@ -255,6 +335,11 @@ class TickDeadline {
         ticks = latest;
     }
 
+    void setTimeBase(const VirtualTime *_vtime) {
+        // Switch clocks without moving the deadline. Clocks must agree.
+        vtime = _vtime;
+    }
+
     uint64_t setRelative(uint64_t diff) {
         uint64_t absolute = vtime->clocks + diff;
         set(absolute);
@@ -39,6 +39,7 @@
 #include "power.h"
 
 extern __bit disc_battery_draw;     // 0 = drawing logo, 1 = drawing battery and score/icon
+extern __bit disc_logo_drawn;       // BG0 map already holds the logo, no need to redraw it
 
 #define BATTERY_HEIGHT  20          // Number of scanlines at the top of the display reserved for battery
 #define FP_BITS         4           // Fixed point precision, in bits
@@ -62,6 +63,9 @@ extern __bit disc_battery_draw;     // 0 = drawing logo, 1 = drawing battery and
 // Absolute accel value at which we unlock accelerometer input
 #define ACCEL_DEAD_ZONE  5 
 
+// Tick counter bits which select a frame of the "disconnected" animation
+#define ANIM_TICK_MASK  0xC0
+
 #define X_MIN_FP        (X_MIN << FP_BITS)
 #define X_MAX_FP        (X_MAX << FP_BITS)
 #define Y_MIN_FP        (Y_MIN << FP_BITS)
@@ -79,6 +83,7 @@ extern uint8_t disc_score;
 extern __bit disc_bounce_type;
 extern __bit disc_has_trophy;
 extern uint8_t disc_sleep_timer;
+extern uint8_t disc_status_tick;    // ANIM_TICK_MASK bits at last status redraw, 1 = stale
 
 // Idle radio state
 extern uint8_t disc_hop_timer;
@@ -97,6 +102,18 @@ extern const __code uint8_t img_disconnected_2[];
 extern const __code uint8_t img_disconnected_3[];
 extern const __code uint8_t img_disconnected_4[];
 
+/*
+ * Frames of the "disconnected" animation, indexed by the ANIM_TICK_MASK
+ * bits of sensor_tick_counter. The status area is only redrawn when this
+ * index changes (or the score does), so playback costs nothing per frame.
+ */
+static const __code uint8_t * const __code disc_anim_frames[] = {
+    img_disconnected_1,
+    img_disconnected_2,
+    img_disconnected_3,
+    img_disconnected_4,
+};
+
 
 static void draw_logo(void) __naked
 {
@@ -252,6 +269,7 @@ static void fp_bounce_axis(void) __naked
         mov     _disc_has_trophy, c         ; Acquire trophy after rollover from 99
 
 2$:     mov     _disc_score, a
+        mov     _disc_status_tick, #1       ; Redraw the score
 1$:
         ajmp    fp_bounce_axis_ret
     __endasm ;
@@ -391,6 +409,7 @@ void disconnected_init(void)
     disc_logo_dy = 0;
     disc_score = 0;
     disc_nb_base = 0;
+    disc_status_tick = 1;
 
     disc_reset_sleep_timer();
     disc_reset_radio_state();
@@ -404,6 +423,7 @@ void disconnected_init(void)
     draw_clear();
     draw_logo();
     vram.num_lines = 128;
+    disc_logo_drawn = 1;
 
     return graphics_render();
 }
@@ -427,15 +447,21 @@ void disconnected_poll(void)
         movx    @dptr, a
     __endasm ;
 
-    if (disc_battery_draw) {
+    if (disc_battery_draw && disc_status_tick != (sensor_tick_counter & ANIM_TICK_MASK)) {
         /*
          * Update battery indicator (and the scoreboard, if it's visible)
          *
          * We don't draw the battery indicator at all until we've finished
          * sampling (battery_v is nonzero).
+         *
+         * Nothing up here moves between animation steps, so most of the
+         * time we skip this pass entirely and keep the logo's map intact.
+         * The battery level is picked up on the next step.
          */
 
         disc_battery_draw = 0;
+        disc_logo_drawn = 0;
+        disc_status_tick = sensor_tick_counter & ANIM_TICK_MASK;
 
         draw_clear();
         vram.num_lines = BATTERY_HEIGHT;
@@ -511,23 +537,20 @@ void disconnected_poll(void)
 
             DRAW_XY (2, 0)
 
-            ; Jump tree, pick an animation frame based on bits from the tick counter
-
-            mov     a, _sensor_tick_counter
-            jb      acc.7, 21$
-            jb      acc.6, 22$
-            mov     dptr, #_img_disconnected_1
-            sjmp    20$
-        22$:
-            mov     dptr, #_img_disconnected_2
-            sjmp    20$
-        21$:
-            jb      acc.6, 23$
-            mov     dptr, #_img_disconnected_3
-            sjmp    20$
-        23$:
-            mov     dptr, #_img_disconnected_4
-        20$:
+            ; Look up the animation frame for the tick bits we latched above
+
+            mov     a, _disc_status_tick
+            rl      a                                   ; Bits 7:6 to 2:1, a table offset
+            rl      a
+            rl      a
+            mov     r0, a
+            mov     dptr, #_disc_anim_frames
+            movc    a, @a+dptr                          ; Frame pointer, low byte
+            xch     a, r0
+            inc     a
+            movc    a, @a+dptr                          ; Frame pointer, high byte
+            mov     dph, a
+            mov     dpl, r0
 
             acall   _draw_image
 
@@ -546,8 +569,11 @@ void disconnected_poll(void)
 
     disc_battery_draw = 1;
 
-    draw_clear();
-    draw_logo();
+    if (!disc_logo_drawn) {
+        disc_logo_drawn = 1;
+        draw_clear();
+        draw_logo();
+    }
 
     __asm
 
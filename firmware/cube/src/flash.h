@@ -50,6 +50,7 @@ extern __bit flash_addr_a21;            // Bank selection bit
 
 void flash_buffer_begin(void);
 void flash_buffer_word(void) __naked;   // Assembly-callable only
-void flash_buffer_commit(void);
+void flash_buffer_commit(void);         // Returns while the write is still running
+void flash_program_wait(void);
 
 #endif
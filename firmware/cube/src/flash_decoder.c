@@ -51,6 +51,11 @@
  * exactly 32 bytes, so we handle this by waiting until we have enough
  * data in our input FIFO to yield 32 bytes of output, even with
  * worst-case compression ratios.
+ *
+ * The wait overlaps with decoding: the RLE codes decode a whole buffer
+ * of pixels into fls_pixels while the previous buffer is programming,
+ * then copy it to the flash in one burst. Before returning to the main
+ * loop we wait for the last buffer, so nobody else sees a busy bus.
  */
 
 #include "flash.h"
@@ -107,6 +112,9 @@ extern uint8_t fls_tail;
 
 // State-specific temporaries
 extern uint8_t fls_st[5];
+
+// One buffer of decoded pixels, as LUT pointers. Overlaid, only valid in flash_tile_r4.
+extern uint8_t fls_pixels[16];
 __bit fls_bit0;
 __bit fls_bit1;
 __bit fls_bit2;
@@ -277,6 +285,14 @@ void flash_handle_fifo() __naked
 {
     __asm
 
+        ; Run the decoder, then make sure the last buffer has finished
+        ; programming before the main loop uses the bus again.
+
+        acall   flash_decode
+        ljmp    _flash_program_wait
+
+flash_decode:
+
         ; Handle reset requests with a tailcall to init
 
         jb      _flash_reset_request, _flash_init
@@ -307,6 +323,7 @@ flash_loop:
 4$:     mov     R_BYTE_COUNT, a             ; Save byte count
 
         setb    _global_busy_flag           ; System is definitely not idle now
+        clr     _vram_unchanged             ; Tiles may change under the current frame
 
         mov     a, R_DEADLINE               ; Check for deadline
         cjne    a, _sensor_tick_counter, 2$
@@ -583,6 +600,8 @@ static void flash_query_crc() __naked
         ; Setup
         ;--------------------------------------------------------------------
 
+        lcall   _flash_program_wait ; We need to read the flash
+
         mov     c, _flash_addr_a21
         mov     _i2c_a21_target, c
         lcall   _i2c_a21_wait
@@ -924,12 +943,13 @@ static void flash_tile_r4() __naked
         add     a, #(256 - FLS_MIN_TILE_R4)
         jnc     fls_ret
 
-        ; Guaranteed to produce 16 pixels now. Begin the buffer,
-        ; and use R_COUNT1 to count the number of pixels left.
-        ; Note that 16 pixels is always a multiple of 1 nybble,
-        ; in any of our supported bit depths.
+        ; Guaranteed to produce 16 pixels now. Decode them all into
+        ; fls_pixels, while the last buffer may still be programming.
+        ; R_TMP0 points to the next pixel, and R_COUNT1 counts the
+        ; number of pixels left. Note that 16 pixels is always a
+        ; multiple of 1 nybble, in any of our supported bit depths.
 
-        acall   _flash_buffer_begin
+        mov     R_TMP0, #_fls_pixels
         mov     R_COUNT1, #16
 flr4_pixel_loop:
 
@@ -1003,7 +1023,8 @@ flr4_out_1bpp:
         mov     R_BYTE, a       ; Output least significant pixel
         anl     a, #1
         acall   _flash_addr_lut
-        acall   _flash_buffer_word
+        mov     @R_TMP0, a
+        inc     R_TMP0
 
         mov     a, R_BYTE       ; Next pixel
         rr      a
@@ -1024,7 +1045,8 @@ flr4_out_2bpp:
         mov     R_BYTE, a       ; Output least significant pixel
         anl     a, #3
         acall   _flash_addr_lut
-        acall   _flash_buffer_word
+        mov     @R_TMP0, a
+        inc     R_TMP0
 
         mov     a, R_BYTE       ; Next pixel
         rr      a
@@ -1042,7 +1064,8 @@ flr4_out_4bpp:
 
         mov     a, _fls_st+1    ; Whole nybble is color index
         acall   _flash_addr_lut
-        acall   _flash_buffer_word
+        mov     @R_TMP0, a
+        inc     R_TMP0
 
         dec     R_COUNT1
 
@@ -1061,6 +1084,17 @@ flr4_next_pixel:
         mov     a, R_COUNT1
         jnz     flr4_pixel_loop
 
+        ; Decoded a whole buffer. Program it.
+
+        acall   _flash_buffer_begin
+        mov     R_TMP0, #_fls_pixels
+        mov     R_COUNT1, #16
+1$:     mov     a, @R_TMP0
+        mov     R_PTR, a
+        acall   _flash_buffer_word
+        inc     R_TMP0
+        djnz    R_COUNT1, 1$
+
         ; Done with this buffer. If we still have more,
         ; stay in this state. Otherwise, look for the next opcode.
         ; This code fragment is shared by P16.
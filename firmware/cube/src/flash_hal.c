@@ -47,11 +47,11 @@
  *
  * There is no longer any distinction between beginning/ending one
  * buffer vs. beginning/ending a higher-level programming "operation".
- * Calling flash_buffer_commit() always waits for the write to complete.
- * This takes approximately 96us (1500 cycles) on the W29GL032C.
- * Because this delay is so long, any useful work we'd have to do between
- * buffers would be short compared to the time we spend waiting, so it's
- * not worth the code size and complexity.
+ * A write takes approximately 96us (1500 cycles) on the W29GL032C.
+ * flash_buffer_commit() starts the write and returns right away, so the
+ * decoder can work on the next buffer in the mean time. The next
+ * flash_buffer_begin() waits for it to finish. Anyone else who needs the
+ * bus must call flash_program_wait() first.
  */
 
 #include "flash.h"
@@ -61,6 +61,7 @@ uint8_t flash_addr_low;      // Low 7 bits of address, left-justified
 uint8_t flash_addr_lat1;     // Middle 7 bits of address, left-justified
 uint8_t flash_addr_lat2;     // High 7 bits of address, left-justified
 __bit flash_addr_a21;        // Bank selection bit
+__bit flash_busy;            // Last buffer may still be programming
 
 
 void flash_strobe();
@@ -149,6 +150,21 @@ static void flash_wait()
     CTRL_PORT = CTRL_IDLE;
 }
 
+void flash_program_wait(void)
+{
+    /*
+     * Finish the write started by flash_buffer_commit(), if any,
+     * and release the bus.
+     *
+     * Callers expect us not to clobber any of R0-R7 or DPTR!
+     */
+
+    if (flash_busy) {
+        flash_busy = 0;
+        flash_wait();
+    }
+}
+
 void flash_buffer_begin(void)
 {
     /*
@@ -160,6 +176,9 @@ void flash_buffer_begin(void)
      * Callers expect us not to clobber any of R0-R7 or DPTR!
      */
 
+    // The previous buffer has to finish before we can issue new commands
+    flash_program_wait();
+
     // Set up A21
     i2c_a21_target = flash_addr_a21;
     i2c_a21_wait();
@@ -220,14 +239,11 @@ void flash_buffer_commit(void)
     flash_strobe();
 
     /*
-     * Anything we do here is effectively free, as far as CPU time goes.
-     * Unfortunately there isn't much we can do on the main thread
-     * without flash, unless we feel like rendering part of a scanline
-     * and we don't need flash to do that.
-     *
-     * So.. for now, all we have to do is update our address counter.
+     * Anything we do until the next flash_program_wait() is effectively
+     * free, as far as CPU time goes. Update our address counter, and
+     * let the caller get on with decoding the next buffer.
      */
-     
+    
     __asm
         mov     a, _flash_addr_low      ; 32 bytes
         add     a, #64
@@ -244,6 +260,5 @@ void flash_buffer_commit(void)
 1$:
     __endasm ;
 
-    // Wait for the program to finish, and release the bus.
-    flash_wait();
+    flash_busy = 1;
 }
@@ -58,6 +58,7 @@ void vm_bg0() __naked;
 void vm_bg0_bg1() __naked;
 void vm_bg0_spr_bg1() __naked;
 void vm_bg2() __naked;
+void vm_bg0_patch() __naked;
 
 /*
  * Shared internal definitions
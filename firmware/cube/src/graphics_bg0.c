@@ -99,6 +99,14 @@ void vm_bg0_setup(void)
         pan_y = vram.bg0_y;
     });
 
+    if (vram.flags & _SYS_VF_PARTIAL) {
+        // Partial redraw, start at the window's own line of BG0
+        uint16_t y = pan_y + vram.first_line;
+        if (y >= _SYS_VRAM_BG0_WIDTH * 8)
+            y -= _SYS_VRAM_BG0_WIDTH * 8;
+        pan_y = y;
+    }
+
     tile_pan_x = pan_x >> 3;
     tile_pan_y = pan_y >> 3;
 
@@ -73,7 +73,8 @@ extern uint16_t y_bg1_map;              // Map address for the first tile on thi
 extern __bit y_bg1_empty;               // Current line of the bitmap is empty. Set during setup/next.
 
 extern __bit x_bg1_rshift, x_bg1_lshift;
-__sfr __at 0xC6 x_bg1_shift;
+__sfr __at 0xC6 x_bg1_shift;            // ARCON value for the per-line bitmap shift
+extern uint16_t x_bg1_skip_mask;        // Bitmap bits that pass off the left edge, for rshift
 
 // Scanline bitmap in MD3..MD0
 
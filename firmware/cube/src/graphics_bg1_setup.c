@@ -97,26 +97,33 @@ static void vm_bg1_begin_line(void) __naked
         ; Now perform the shift, if we need to.
         ;
         ; This is a bit convoluted, since the timing requirements differ
-        ; depending on whether we are shifting right (using our loop) or left
-        ; (with the MDU), so e.g. we reorder our load of DPTR1.
+        ; depending on whether we are shifting right (after counting the
+        ; tiles we skip) or left, so e.g. we reorder our load of DPTR1.
         
-        jnb     _x_bg1_rshift, 3$           ; Right shift, one step at a time
+        jnb     _x_bg1_rshift, 3$           ; Right shift, skipping tiles as we go
         
-        mov     _DPL1, _y_bg1_map           ; Load BG1 tile address _before_ shifting
-        mov     _DPH1, (_y_bg1_map+1)
+        ; Every '1' bit we shift out is a tile we need to step over.
+        ; Count them all at once, using the mask from vm_bg1_setup(),
+        ; rather than shifting one bit at a time.
+        
+        movx    a, @dptr                    ; High byte
+        anl     a, (_x_bg1_skip_mask+1)
+        mov     b, a
+        dec     dpl
+        movx    a, @dptr                    ; Low byte
+        anl     a, _x_bg1_skip_mask
+        mov     dpl, a
+        mov     dph, b
+        acall   _bitcount16_x2
         
-        mov     r0, _x_bg1_shift            ; Loop iterator
-        inc     _DPS                        ; Select DPTR1, for fast increments
-5$:
-        mov     a, _MD0                     ; Examine the LSB
-        mov     _MD0, a                     ;    dummy write to reset the MDU state
-        mov     _ARCON, #0x21               ;    Begin right shift by one
-        jnb     acc.0, 6$                   ;    continue if we are about to skip a zero
-        inc     dptr                        ;    skip a tile if we are skipping a zero
-        inc     dptr
-6$:     djnz    r0, 5$                      ; Next bit...
-        dec     _DPS                        ; Back to original DPTR
-        anl     _DPH1, #3                   ; Mask DPTR to keep it inside of xram
+        mov     _ARCON, _x_bg1_shift        ; Begin right shift, asynchronously
+        
+        add     a, _y_bg1_map               ; Load BG1 tile address, past skipped tiles
+        mov     _DPL1, a
+        clr     a
+        addc    a, (_y_bg1_map+1)
+        anl     a, #3                       ; Mask DPTR to keep it inside of xram
+        mov     _DPH1, a
         
         sjmp    8$
         
@@ -133,7 +140,8 @@ static void vm_bg1_begin_line(void) __naked
         ; We need the results of the shift. Do some other work while we wait.
         ; The maximum shift is 16 bits, or 11 clock cycles of MDU activity.
         ; The code above has been padded so that this takes long enough in
-        ; the worst case.
+        ; the worst case. (The right shift is at most 15 bits, and has the
+        ; tile address arithmetic to cover it.)
                 
         clr     _y_bg1_empty                ; For now, remember that this line has BG1 tiles
         
@@ -233,6 +241,9 @@ void vm_bg1_setup(void)
             pan_x = vram.bg1_x;
             pan_y = vram.bg1_y;
         });
+
+        if (vram.flags & _SYS_VF_PARTIAL)
+            pan_y += vram.first_line;
         
         tile_pan_x = pan_x >> 3;
         tile_pan_y = pan_y >> 3;
@@ -268,11 +279,13 @@ void vm_bg1_setup(void)
         } else if (tile_pan_x) {
             /*
             * Starting inside the BG1 bitmap. Shift right, according to the number
-            * of tiles we've passed. Since we may be skipping '1' bits here, we need
-            * to do the shift one step at a time.
+            * of tiles we've passed. Since we may be skipping '1' bits here, each
+            * line also counts the bits under x_bg1_skip_mask and steps over
+            * that many tiles.
             */
 
-            x_bg1_shift = tile_pan_x;
+            x_bg1_shift = 0x20 | tile_pan_x;
+            x_bg1_skip_mask = (1 << tile_pan_x) - 1;
             x_bg1_rshift = 1;
         }
     }
@@ -309,31 +322,38 @@ static void vm_bg1_next(void)
     y_bg1_addr_l += 32;
     if (!y_bg1_addr_l) {
         /*
-         * Next bitmap word
+         * Next bitmap word. Step y_bg1_map over every tile in the word we're
+         * leaving, whether or not the scanline renderer got to them. Words
+         * outside the bitmap have no tiles.
          */
-        y_bg1_bit_index = (y_bg1_bit_index + 1) & 0x1F;
+        __asm
+            mov     a, _y_bg1_bit_index
+            anl     a, #0xF0
+            jnz     1$
 
-        /*
-         * If we're advancing, save the DPTR1 advancement that we performed
-         * during this line. Otherwise, it gets discarded at the next line.
-         *
-         * If we have any 1 bits remaining in the MDU, those are tiles we haven't
-         * advanced through yet. Adjust y_bg1_map accordingly. At this point we
-         * can be guaranteed that the only ones are in the low 16 bits.
-         */
-        if (!y_bg1_empty) {
-            __asm
-                mov     dpl, _MD0
-                mov     dph, _MD1
-                acall   _bitcount16_x2
-
-                add     a, _DPL1
-                mov     _y_bg1_map, a
-                clr     a
-                addc    a, _DPH1
-                mov     (_y_bg1_map+1), a
-            __endasm ;
-        }
+            mov     a, _y_bg1_bit_index
+            rl      a                       ; Index -> byte address
+            add     a, #(_SYS_VA_BG1_BITMAP & 0xFF)
+            mov     dpl, a
+            mov     dph, #(_SYS_VA_BG1_BITMAP >> 8)
+            movx    a, @dptr
+            mov     b, a
+            inc     dptr
+            movx    a, @dptr
+            mov     dph, a
+            mov     dpl, b
+            acall   _bitcount16_x2
+
+            add     a, _y_bg1_map
+            mov     _y_bg1_map, a
+            clr     a
+            addc    a, (_y_bg1_map+1)
+            anl     a, #3
+            mov     (_y_bg1_map+1), a
+1$:
+        __endasm ;
+
+        y_bg1_bit_index = (y_bg1_bit_index + 1) & 0x1F;
     }
     
     // Tail call to prepare the next line's bitmap
@@ -75,6 +75,17 @@ void graphics_render(void) __naked
         jnc     _graphics_ack           ; Return to ACK if no toggle
 1$:
 
+        ; Skip redundant frames. In continuous mode we'd otherwise keep
+        ; redrawing an unchanged VRAM, which is most of our active power.
+        ; The radio ISR and flash decoder clear vram_unchanged when the
+        ; picture may have changed. Disconnected mode draws into VRAM from
+        ; the main loop, so there we always render and leave the bit clear.
+
+        mov     c, _radio_connected
+        jnc     2$
+        jb      _vram_unchanged, _graphics_ack
+2$:     mov     _vram_unchanged, c
+
         ; Increment frame counter field
 
         mov     a, _next_ack
@@ -130,8 +141,8 @@ gd_n10: ljmp    _vm_bg2         ; 0x24
         .ds 1
 gd_n11: ljmp    _vm_stamp       ; 0x28
         .ds 1
-gd_n12: ajmp    _vm_powerdown   ; 0x2c (unused)
-        .ds 2
+gd_n12: ljmp    _vm_bg0_patch   ; 0x2c
+        .ds 1
 gd_n13: ajmp    _vm_powerdown   ; 0x30 (unused)
         .ds 2
 gd_n14: ajmp    _vm_powerdown   ; 0x34 (unused)
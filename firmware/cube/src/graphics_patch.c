@@ -0,0 +1,137 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker cube firmware
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "graphics_bg0.h"
+
+/*
+ * BG0, plus a small direct-color patch.
+ *
+ * This is BG0 mode with a box of up to _SYS_VRAM_PATCH_PIXELS RGB565
+ * pixels drawn on top of it, for content that changes too much from
+ * frame to frame to be made out of tiles. The patch lives where BG1's
+ * tile indices would be, so BG0 keeps its whole map. Since only the
+ * VRAM words that changed are sent over the radio, an animated patch
+ * costs about as much as the pixels that actually moved.
+ *
+ * The patch is configured with four bytes at _SYS_VA_PATCH_X:
+ *
+ *   - x:      First LCD column of the patch
+ *   - y:      First LCD row of the patch
+ *   - width:  Pixels per row, nonzero. x + width must not exceed 128.
+ *   - height: Number of rows. Zero hides the patch.
+ *
+ * Patch coordinates are in LCD rows and columns, so a partial window
+ * keeps its place on the patch. Each patch row overwrites part of an
+ * already-drawn BG0 line, then re-addresses the LCD to the start of
+ * the next line.
+ */
+
+// Copy of VRAM parameters, in GFX_BANK
+static uint8_t __at (GFX_BANK*8 + 2) gfxbank_patch_x;
+static uint8_t __at (GFX_BANK*8 + 3) gfxbank_patch_y;
+static uint8_t __at (GFX_BANK*8 + 4) gfxbank_patch_width;
+static uint8_t __at (GFX_BANK*8 + 5) gfxbank_patch_height;
+static uint16_t __at (GFX_BANK*8 + 6) gfxbank_patch_src;
+
+static void vm_patch_latch_parameters() __naked
+{
+    // Trashes dptr, r0, r1, and a.
+    __asm
+        mov     dptr, #_SYS_VA_PATCH_X
+        mov     r0, #_gfxbank_patch_x
+        mov     r1, #4
+        ljmp    _vram_atomic_copy
+    __endasm ;
+}
+
+static void vm_patch_line() __naked
+{
+    __asm
+        ; Take the bus away from flash, and start writing at the patch
+
+        mov     CTRL_PORT, #CTRL_IDLE
+        ASM_LCD_WRITE_BEGIN()
+        mov     _lcd_window_x, _gfxbank_patch_x
+        lcall   _lcd_address_and_write
+
+        mov     dpl, _gfxbank_patch_src
+        mov     dph, (_gfxbank_patch_src + 1)
+        mov     r2, _gfxbank_patch_width
+1$:
+        movx    a, @dptr        ; Low byte
+        inc     dptr
+        mov     r0, a
+        movx    a, @dptr        ; High byte
+        inc     dptr
+        PIXEL_FROM_REGS(r0, a)
+        djnz    r2, 1$
+
+        mov     _gfxbank_patch_src, dpl
+        mov     (_gfxbank_patch_src + 1), dph
+
+        ; Resume at the beginning of the next line, if there is one
+
+        mov     _lcd_window_x, #0
+        inc     _lcd_window_y
+        mov     a, _lcd_window_y
+        jb      acc.7, 2$
+        lcall   _lcd_address_and_write
+2$:
+        dec     _lcd_window_y
+        ASM_LCD_WRITE_END()
+        ret
+    __endasm ;
+}
+
+void vm_bg0_patch(void) __naked
+{
+    uint8_t y = vram.num_lines;
+
+    lcd_begin_frame();
+    i2c_a21_wait();
+    vm_bg0_setup();
+    vm_patch_latch_parameters();
+
+    // Skip any patch rows above the window
+    {
+        uint8_t skipped = lcd_window_y - gfxbank_patch_y;
+        gfxbank_patch_src = _SYS_VA_PATCH;
+        if (lcd_window_y > gfxbank_patch_y && skipped < gfxbank_patch_height)
+            gfxbank_patch_src += (uint16_t)(skipped * gfxbank_patch_width) << 1;
+    }
+
+    do {
+        vm_bg0_line();
+        if ((uint8_t)(lcd_window_y - gfxbank_patch_y) < gfxbank_patch_height)
+            vm_patch_line();
+        lcd_window_y++;
+        vm_bg0_next();
+    } while (--y);
+
+    lcd_end_frame();
+    GRAPHICS_RET();
+}
@@ -52,6 +52,7 @@ extern struct x_sprite_t x_spr[_SYS_SPRITES_PER_LINE];
 
 extern uint8_t y_spr_line;             // Current rendering line, zero-based
 extern uint8_t y_spr_line_limit;       // Rendering ends at this line
+extern uint8_t y_spr_gap;              // Upcoming lines known to have no sprites
 __sfr __at 0xC7 y_spr_active;          // Number of sprites in x_spr[]
 
 /*
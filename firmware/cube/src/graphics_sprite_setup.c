@@ -29,6 +29,7 @@
 
 uint8_t y_spr_line;
 uint8_t y_spr_line_limit;
+uint8_t y_spr_gap;
 
 
 void vm_bg0_spr_bg1(void) __naked
@@ -66,6 +67,12 @@ void vm_spr_setup()
 {
     y_spr_line = 0xFF;    // Will wrap to zero in vm_spr_next()
     y_spr_line_limit = vram.num_lines;
+    y_spr_gap = 0;
+
+    if (vram.flags & _SYS_VF_PARTIAL) {
+        y_spr_line += vram.first_line;
+        y_spr_line_limit += vram.first_line;
+    }
     
     vm_spr_next();        // Tail call to set up the first line
 }
@@ -123,11 +130,24 @@ void vm_spr_next()
      * we're already in the sprite. If and only if we aren't, we can see if it's
      * coming up soon by adding N to the adjusted sprite position, and checking
      * for overflow.
+     *
+     * Lines with no sprites on them usually come in long runs, especially
+     * with many small sprites. When a line comes up empty, we also note how
+     * many lines we have until the nearest sprite below us begins: that's
+     * just the complement of its Y offset. Until then, y_spr_gap lets us
+     * skip the whole search. Sprites that are in Y range but entirely off
+     * screen in X never become visible, so they don't count.
      */
 
     __asm
         inc     _y_spr_line
+        mov     a, _y_spr_gap       ; Still in a gap between sprites?
+        jz      10$
+        dec     _y_spr_gap          ;   Yes. y_spr_active is already zero.
+        ljmp    9$
+10$:
         mov     _y_spr_active, #0
+        mov     _y_spr_gap, #0xFF   ; Nearest sprite below us, so far
         mov     dptr, #_SYS_VA_SPR
         mov     r0, #_x_spr
         mov     r2, #_SYS_VRAM_SPRITES
@@ -258,7 +278,13 @@ void vm_spr_next()
         mov     _DPL, a
         sjmp    2$          ; Next iteration
 
-14$:    mov     a, _DPL     ; Skip 4 bytes
+14$:    mov     a, r6       ; Number of lines before this sprite starts, minus one
+        cpl     a
+        cjne    a, _y_spr_gap, 15$
+15$:    jnc     17$         ;   Closer than the others?
+        mov     _y_spr_gap, a
+
+17$:    mov     a, _DPL     ; Skip 4 bytes
         add     a, #4
         mov     _DPL, a
         sjmp    2$          ; Next iteration
@@ -269,5 +295,9 @@ void vm_spr_next()
         sjmp    2$          ; Next iteration
 
 3$:
+        mov     a, _y_spr_active    ; Found sprites? Then there's no gap,
+        jz      9$                  ;   check again on the next line.
+        mov     _y_spr_gap, #0
+9$:
     __endasm ;
 }
@@ -68,6 +68,8 @@ _y_bg0_map::        ; 2 bytes
     .ds 2
 _y_bg1_map::        ; 2 bytes
     .ds 2
+_x_bg1_skip_mask::  ; 2 bytes
+    .ds 2
 _fls_state::        ; 1 byte
     .ds 1
 _fls_tail::         ; 1 byte
@@ -80,6 +82,7 @@ _x_bg0_first_addr:: ; 1 byte
 ; ----------------------------------
 
 _x_spr::            ;     20 bytes
+_fls_pixels::       ;     16 bytes
 _lcd_window_x::     ;     1 byte
 _fb64_y::           ;     1 byte
 _fb128_y::          ;     1 byte
@@ -105,7 +108,9 @@ _disc_hop_timer::   ;     1 byte
     .ds 1           ; +14
 _disc_nb_base::     ;     1 byte
     .ds 1           ; +15
-    .ds 20-16       ; +16
+_disc_status_tick:: ;     1 byte
+    .ds 1           ; +16
+    .ds 20-17       ; +17
 
 ; ----------------------------------
 
@@ -117,6 +122,7 @@ _radio_query::      ;     32 bytes
 
     .area BSEG    (BIT)
 
+_disc_logo_drawn::
 _x_bg1_rshift::
     .ds 1
 _x_bg1_lshift::
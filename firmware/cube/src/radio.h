@@ -50,6 +50,7 @@ extern uint8_t __near ack_bits;
 extern uint8_t radio_query[32];
 extern __bit radio_connected;
 extern __bit radio_idle_hop;
+extern __bit vram_unchanged;
 
 /*
  * We track the length of the next ACK packet using a bitmap, where each
@@ -31,6 +31,7 @@
 #include "flash.h"
 #include "params.h"
 #include "power.h"
+#include "sensors.h"
 
 RF_MemACKType __near ack_data;
 uint8_t __near ack_bits;
@@ -107,6 +108,7 @@ uint16_t vram_dptr;                      // Current VRAM write pointer
 uint8_t radio_packet_deadline;           // Time at which we'll enter disconnected mode
 __bit radio_state_reset_not_pending;     // Next packet should start with a clean slate
 __bit radio_saved_dps;                   // Store DPS in a bit variable, to save space
+__bit vram_unchanged;                    // No VRAM writes since the last frame began
 
 
 /*
@@ -137,6 +139,20 @@ static void rx_write_deltas(void) __naked __using(RF_BANK)
 {
     __asm
 
+        ; We loop R_LOW+1 times total
+
+        inc     R_LOW
+        clr     _vram_unchanged
+
+        ; Convert raw Diff to 8-bit signed diff, stow in R_TMP
+
+        mov     a, R_DIFF
+        anl     a, #0xF
+        add     a, #-7
+        clr     c
+        rlc     a
+        mov     R_TMP, a
+
         ; Jump DPL/DPH backwards by the sample distance
 
         mov     a, R_SAMPLE
@@ -153,20 +169,73 @@ bs2:    DPTR_DELTA(-RF_VRAM_SAMPLE_2 * 2)
 bs1:    DPTR_DELTA(-RF_VRAM_SAMPLE_1 * 2)
         sjmp    bsE
 bs0:    DPTR_DELTA(-RF_VRAM_SAMPLE_0 * 2)
-bsE:
 
-        ; We loop R_LOW+1 times total
+        ; ---- Fast path for sample 0
 
-        inc     R_LOW
+        ; This is what the master sends for fills and for rows of
+        ; consecutive tiles: every word is derived from the one we just
+        ; wrote. Latch that word into DPL/DPH once, and stream the whole
+        ; run out through DPTR1 without switching DPS for every byte.
 
-        ; Convert raw Diff to 8-bit signed diff, stow in R_TMP
+        VRAM_MOVX_A_DPTR
+        inc     dptr
+        mov     R_HIGH, a
+        VRAM_MOVX_A_DPTR
+        mov     _DPH, a
+        mov     _DPL, R_HIGH
 
-        mov     a, R_DIFF
-        anl     a, #0xF
-        add     a, #-7
-        clr     c
-        rlc     a
-        mov     R_TMP, a
+        mov     a, R_TMP
+        mov     _DPS, #1
+        jz      7$              ; Zero diff, plain fill
+        jb      acc.7, 9$       ; Negative diff
+
+8$:
+        mov     a, _DPL         ; Add and store low byte
+        add     a, R_TMP
+        mov     _DPL, a
+        VRAM_MOVX_DPTR_A
+        inc     dptr
+        mov     a, _DPH         ; Add Carry to bit 1 of high byte
+        jnc     10$
+        add     a, #2
+        mov     _DPH, a
+10$:    VRAM_MOVX_DPTR_A
+        inc     dptr
+        djnz    R_LOW, 8$
+        sjmp    12$
+
+9$:
+        mov     a, _DPL         ; Add and store low byte
+        add     a, R_TMP
+        mov     _DPL, a
+        VRAM_MOVX_DPTR_A
+        inc     dptr
+        mov     a, _DPH         ; Subtract borrow from bit 1 of high byte
+        jc      11$
+        add     a, #0xFE
+        mov     _DPH, a
+11$:    VRAM_MOVX_DPTR_A
+        inc     dptr
+        djnz    R_LOW, 9$
+        sjmp    12$
+
+7$:
+        mov     a, _DPL
+        VRAM_MOVX_DPTR_A
+        inc     dptr
+        mov     a, _DPH
+        VRAM_MOVX_DPTR_A
+        inc     dptr
+        djnz    R_LOW, 7$
+
+12$:
+        mov     _DPS, #0
+        sjmp    5$
+
+        ; ---- General case, copying from VRAM
+
+bsE:
+        mov     a, R_TMP
         jb      acc.7, 3$       ; Negative diff
 
         ; ---- Loop for positive diffs
@@ -498,7 +567,8 @@ rxs_l1:
         sjmp    rx_next_sjmp
 
 rxs_l2:
-        mov     _DPS, #1        ; Switch to VRAM DPTR
+        inc     _DPS            ; Switch to VRAM DPTR (DPS is always 0 here)
+        clr     _vram_unchanged
 
         clr     c               ; Shift a zero into R_LOW, and MSB into C
         mov     a, R_LOW
@@ -515,7 +585,7 @@ rxs_l2:
         inc     dptr
         anl     _DPH1, #3       ; Wrap DPH1 at 1 kB        
 
-        mov     _DPS, #0
+        dec     _DPS
 
         mov     R_STATE, #0     ; Back to default state
         sjmp    rx_next_sjmp
@@ -668,7 +738,8 @@ rxs_w4:
         swap    a
         orl     AR_HIGH, a      ; Store bits fedc
 
-        mov     _DPS, #1        ; Switch to VRAM DPTR
+        inc     _DPS            ; Switch to VRAM DPTR
+        clr     _vram_unchanged
         mov     a, R_LOW
         VRAM_MOVX_DPTR_A        ; Store low byte
         inc     dptr
@@ -676,7 +747,7 @@ rxs_w4:
         VRAM_MOVX_DPTR_A        ; Store high byte
         inc     dptr
         anl     _DPH1, #3       ; Wrap DPH1 at 1 kB
-        mov     _DPS, #0
+        dec     _DPS
 
         mov     R_SAMPLE, #0    ; Any subsequent runs will copy this word (S=0 D=0)
         mov     R_DIFF, #RF_VRAM_DIFF_BASE
@@ -721,7 +792,7 @@ rx_special:
         mov     R_STATE, #0                     ; Catch-all, go back to default state
         anl     AR_SAMPLE, #3                   ; Specific ops are in low two bits...
 
-        ; -------- 1000 0111 <LOW> <HIGH> -- Sensor timer sync escape
+        ; -------- 1000 0111 <LOW> <HIGH> [<ACCEL>] -- Sensor timer sync escape
 
         cjne    R_SAMPLE, #0, 1$
 
@@ -733,6 +804,17 @@ rx_special:
         mov     _SPIRDAT, #0
         setb    _TCON_TR0                       ; Restart timer
 
+        ; Optional accelerometer threshold byte. Older masters leave it
+        ; out, and get every accelerometer change as before.
+
+        clr     a
+        cjne    R_NYBBLE_COUNT, #7, 4$          ; At least 3 bytes after the escape?
+4$:     jc      5$
+        SPI_WAIT
+        mov     a, _SPIRDAT
+        mov     _SPIRDAT, #0
+5$:     mov     _accel_threshold, a
+
         sjmp    rx_complete
 1$:
 
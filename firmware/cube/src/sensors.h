@@ -50,5 +50,8 @@ void tf2_isr(void) __interrupt(VECTOR_TF2) __naked;
 extern __bit i2c_a21_target;
 void i2c_a21_wait(void) __naked;
 
+// Smallest accelerometer change worth reporting, minus one. Set by the master.
+extern uint8_t accel_threshold;
+
 
 #endif
@@ -36,6 +36,7 @@
 uint8_t i2c_state;
 uint8_t i2c_temp_1;
 uint8_t i2c_temp_2;
+uint8_t accel_threshold;
 
 // 16-bit accumulator, for integrating battery voltage
 uint16_t i2c_battery_total;
@@ -603,6 +604,11 @@ void i2c_accel_store_results() __naked
      * one new axis. In fact, since this interrupt is higher priority than the
      * RF interrupt, we are guaranteed to send synchronized updates of both axes.
      *
+     * An axis only counts as changed if it moved by more than accel_threshold,
+     * which the master sends us along with its timer sync. This keeps sensor
+     * noise from turning every ACK into an accelerometer update. DPH is free
+     * to use as a temporary, the ISR saved it.
+     *
      * Expects the X axis to be in W2DAT, with X and Y in i2c_temp_1 and _2 respectively.
      * Returns by jumping to i2c_accel_store_results_ret.
      */
@@ -610,24 +616,44 @@ void i2c_accel_store_results() __naked
     __asm
 
         mov     a, _W2DAT
-
-        xrl     a, (_ack_data + RF_ACK_ACCEL + 2)
-        jz      1$
-        xrl     (_ack_data + RF_ACK_ACCEL + 2), a
+        mov     dph, a              ; Keep the new value
+        clr     c
+        subb    a, (_ack_data + RF_ACK_ACCEL + 2)
+        jnb     acc.7, 4$
+        cpl     a                   ; Absolute difference
+        inc     a
+4$:     setb    c                   ; Borrow unless it is over the threshold
+        subb    a, _accel_threshold
+        jc      1$
+        mov     (_ack_data + RF_ACK_ACCEL + 2), dph
         orl     _ack_bits, #RF_ACK_BIT_ACCEL
 1$:
 
         mov     a, _i2c_temp_2
-        xrl     a, (_ack_data + RF_ACK_ACCEL + 1)
-        jz      2$
-        xrl     (_ack_data + RF_ACK_ACCEL + 1), a
+        mov     dph, a              ; Keep the new value
+        clr     c
+        subb    a, (_ack_data + RF_ACK_ACCEL + 1)
+        jnb     acc.7, 5$
+        cpl     a                   ; Absolute difference
+        inc     a
+5$:     setb    c                   ; Borrow unless it is over the threshold
+        subb    a, _accel_threshold
+        jc      2$
+        mov     (_ack_data + RF_ACK_ACCEL + 1), dph
         orl     _ack_bits, #RF_ACK_BIT_ACCEL
 2$:
 
         mov     a, _i2c_temp_1
-        xrl     a, (_ack_data + RF_ACK_ACCEL + 0)
-        jz      3$
-        xrl     (_ack_data + RF_ACK_ACCEL + 0), a
+        mov     dph, a              ; Keep the new value
+        clr     c
+        subb    a, (_ack_data + RF_ACK_ACCEL + 0)
+        jnb     acc.7, 6$
+        cpl     a                   ; Absolute difference
+        inc     a
+6$:     setb    c                   ; Borrow unless it is over the threshold
+        subb    a, _accel_threshold
+        jc      3$
+        mov     (_ack_data + RF_ACK_ACCEL + 0), dph
         orl     _ack_bits, #RF_ACK_BIT_ACCEL
 3$:
 
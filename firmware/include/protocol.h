@@ -371,7 +371,7 @@
  * all, we have a reserved region of the diff codes, which are
  * redundant encodings for the 4-bit 'copy' code:
  *
- *   1000 0111             Sensor timer sync escape (Byte args: TL0, TH0)
+ *   1000 0111             Sensor timer sync escape (Byte args: TL0, TH0, Optional accel threshold)
  *   1001 0111             Explicit full ACK request (No args)
  *   1010 0111             Radio hop (Byte args: Channel, Optional 5-byte addr, Optional neighbor ID)
  *   1011 0111             Radio nap (Byte args: Duration low, duration high)
@@ -429,10 +429,16 @@
  *
  * Like the Flash Escape, this switches from nybble mode to byte mode,
  * and consumes the remainder of the packet. In this case, only two
- * bytes are read, and the rest of the packet, if any, is discarded.
+ * or three bytes are read, and the rest of the packet, if any, is discarded.
  *
  * These two bytes are used as a reload value for the master sensor
  * clock, which is momentarily stopped and restarted.
+ *
+ * An optional third byte sets the accelerometer threshold. The cube only
+ * flags an accelerometer axis as changed when it moves by more than this
+ * many counts, so sensor noise doesn't keep producing non-empty ACKs.
+ * Syncs without this byte set the threshold back to zero, which reports
+ * every change.
  */
 
 #define RF_VRAM_MAX_RUN    (0x3F + 5)
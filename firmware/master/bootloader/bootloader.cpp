@@ -166,6 +166,9 @@ void Bootloader::load()
     // initialize update state, default to beginning of application flash
     update.loadInProgress = true;
     update.addressPointer = APPLICATION_ADDRESS;
+    update.crcPointer = APPLICATION_ADDRESS;
+    update.streamRemaining = 0;
+    Crc32::reset();
 
     while (update.loadInProgress)
         Tasks::work();
@@ -178,11 +181,21 @@ void Bootloader::load()
  */
 void Bootloader::onUsbData(const uint8_t *buf, unsigned numBytes)
 {
+    /*
+     * While a CmdWriteStream is in progress, packets are pure ciphertext.
+     */
+    if (update.streamRemaining) {
+        unsigned len = MIN(numBytes, update.streamRemaining);
+        update.streamRemaining -= writeBlocks(buf, len);
+        return;
+    }
+
     switch (buf[0]) {
     case CmdGetVersion: {
-        // NOTE: earlier versions of the bootloader did not send the HW version.
-        // we expect all versions of swiss to be flexible enough to ignore the extra data.
-        const uint8_t response[] = { buf[0], VERSION, BOARD };
+        // NOTE: earlier versions of the bootloader did not send the HW version,
+        // or the feature flags. we expect all versions of swiss to be flexible
+        // enough to ignore the extra data.
+        const uint8_t response[] = { buf[0], VERSION, BOARD, FEATURES };
         UsbDevice::write(response, sizeof response);
         break;
     }
@@ -190,64 +203,32 @@ void Bootloader::onUsbData(const uint8_t *buf, unsigned numBytes)
     /*
      * Buf format: uint8_t command, [as many 16 byte aes blocks as fit]
      */
-    case CmdWriteMemory: {
-        uint8_t plaintext[AES128::BLOCK_SIZE];
-        const uint8_t *cipherIn = buf + 1;
-        numBytes--; // step past the byte of command
-
-        Stm32Flash::beginProgramming();
-
-        while (numBytes >= AES128::BLOCK_SIZE) {
-
-            decryptBlock(plaintext, cipherIn);
-            program(plaintext, AES128::BLOCK_SIZE);
-
-            cipherIn += AES128::BLOCK_SIZE;
-            numBytes -= AES128::BLOCK_SIZE;
-        }
+    case CmdWriteMemory:
+        writeBlocks(buf + 1, numBytes - 1);
+        break;
 
-        Stm32Flash::endProgramming();
+    /*
+     * Buf format: uint8_t command, uint32_t byte count.
+     * The count must be a multiple of the AES block size.
+     */
+    case CmdWriteStream:
+        if (numBytes >= 5)
+            memcpy(&update.streamRemaining, buf + 1, sizeof update.streamRemaining);
         break;
-    }
 
     /*
      * Buf format: uint8_t command, 16 bytes final aes block, uint32_t CRC, uint32_t size
      */
-    case CmdWriteFinal: {
-
-        if (numBytes < 25)
-            break;
-
-        const uint8_t *cipherIn = buf + 1;
-        uint8_t plaintext[AES128::BLOCK_SIZE];
-        decryptBlock(plaintext, cipherIn);
-
-        Stm32Flash::beginProgramming();
-
-        // last byte of last block is always the pad value
-        uint8_t padvalue = plaintext[AES128::BLOCK_SIZE - 1];
-        program(plaintext, AES128::BLOCK_SIZE - padvalue);
-
-        /*
-         * Write details to allow us to verify contents of MCU flash.
-         */
-        uint32_t crc = *reinterpret_cast<const uint32_t*>(buf + 17);
-        uint32_t size = *reinterpret_cast<const uint32_t*>(buf + 21);
-
-        Stm32Flash::programHalfWord(crc & 0xffff, update.addressPointer);
-        Stm32Flash::programHalfWord((crc >> 16) & 0xffff, update.addressPointer + 2);
-
-        Stm32Flash::programHalfWord(size & 0xffff, Stm32Flash::END_ADDR - 4);
-        Stm32Flash::programHalfWord((size >> 16) & 0xffff, Stm32Flash::END_ADDR - 2);
-
-        Stm32Flash::endProgramming();
-        update.loadInProgress = false;
+    case CmdWriteFinal:
+        writeFinal(buf, numBytes);
         break;
-    }
 
     case CmdResetAddrPtr:
         eraseMcuFlash();
         update.addressPointer = APPLICATION_ADDRESS;
+        update.crcPointer = APPLICATION_ADDRESS;
+        update.streamRemaining = 0;
+        Crc32::reset();
         break;
 
     case CmdGetAddrPtr: {
@@ -261,14 +242,100 @@ void Bootloader::onUsbData(const uint8_t *buf, unsigned numBytes)
 }
 
 /*
- * Decrypt a single block of AES encrypted data.
- * AES128::BLOCK_SIZE bytes must be available.
+ * Decrypt and program as many whole AES blocks as 'numBytes' holds.
+ * Returns the number of bytes consumed.
  */
-void Bootloader::decryptBlock(uint8_t *plaintext, const uint8_t *cipher)
+unsigned Bootloader::writeBlocks(const uint8_t *cipherIn, unsigned numBytes)
 {
-    AES128::encryptBlock(plaintext, update.cipherBuf, update.expandedKey);
-    memcpy(update.cipherBuf, cipher, AES128::BLOCK_SIZE);
-    AES128::xorBlock(plaintext, update.cipherBuf);
+    uint8_t plaintext[MAX_BATCH_BLOCKS * AES128::BLOCK_SIZE];
+    unsigned consumed = 0;
+
+    Stm32Flash::beginProgramming();
+
+    while (numBytes - consumed >= AES128::BLOCK_SIZE) {
+
+        unsigned blocks = MIN((numBytes - consumed) / AES128::BLOCK_SIZE,
+                              unsigned(MAX_BATCH_BLOCKS));
+        unsigned len = blocks * AES128::BLOCK_SIZE;
+
+        AES128::cfbDecrypt(plaintext, cipherIn + consumed, blocks,
+                           update.cipherBuf, update.expandedKey);
+        program(plaintext, len);
+
+        consumed += len;
+    }
+
+    Stm32Flash::endProgramming();
+
+    // everything so far has finished programming, check it
+    verifyProgrammed(update.addressPointer);
+
+    return consumed;
+}
+
+/*
+ * Read back whole words of freshly programmed flash into the running CRC,
+ * up to 'end'. A word that didn't program correctly shows up as a CRC
+ * mismatch in writeFinal().
+ */
+void Bootloader::verifyProgrammed(uint32_t end)
+{
+    if (update.crcPointer + sizeof(uint32_t) > end)
+        return;
+
+    unsigned count = (end - update.crcPointer) / sizeof(uint32_t);
+    Crc32::addWords(reinterpret_cast<const uint32_t*>(update.crcPointer), count);
+    update.crcPointer += count * sizeof(uint32_t);
+}
+
+void Bootloader::writeFinal(const uint8_t *buf, unsigned numBytes)
+{
+    if (numBytes < 25)
+        return;
+
+    const uint8_t *cipherIn = buf + 1;
+    uint8_t plaintext[AES128::BLOCK_SIZE];
+    AES128::cfbDecrypt(plaintext, cipherIn, 1, update.cipherBuf, update.expandedKey);
+
+    Stm32Flash::beginProgramming();
+
+    // last byte of last block is always the pad value
+    uint8_t padvalue = plaintext[AES128::BLOCK_SIZE - 1];
+    program(plaintext, AES128::BLOCK_SIZE - padvalue);
+
+    Stm32Flash::endProgramming();
+
+    uint32_t crc, size;
+    memcpy(&crc, buf + 17, sizeof crc);
+    memcpy(&size, buf + 21, sizeof size);
+
+    /*
+     * Compare against what actually landed in flash, the same range that
+     * mcuFlashIsValid() checks. On a mismatch, leave the size unwritten,
+     * so this image will never be considered valid.
+     */
+    verifyProgrammed(APPLICATION_ADDRESS + (size & ~3));
+    bool ok = size <= MAX_APP_SIZE && Crc32::get() == crc;
+
+    if (ok) {
+        /*
+         * Write details to allow us to verify contents of MCU flash.
+         */
+        Stm32Flash::beginProgramming();
+
+        Stm32Flash::programHalfWord(crc & 0xffff, update.addressPointer);
+        Stm32Flash::programHalfWord((crc >> 16) & 0xffff, update.addressPointer + 2);
+
+        Stm32Flash::programHalfWord(size & 0xffff, Stm32Flash::END_ADDR - 4);
+        Stm32Flash::programHalfWord((size >> 16) & 0xffff, Stm32Flash::END_ADDR - 2);
+
+        Stm32Flash::endProgramming();
+    }
+
+    const uint8_t response[] = { CmdWriteFinal, ok };
+    UsbDevice::write(response, sizeof response);
+
+    update.loadInProgress = false;
 }
 
 /*
@@ -46,26 +46,53 @@ public:
         CmdWriteMemory,
         CmdWriteFinal,
         CmdResetAddrPtr,
-        CmdGetAddrPtr
+        CmdGetAddrPtr,
+        CmdWriteStream
     };
 
+    /*
+     * Optional features, reported in an extra byte of the CmdGetVersion
+     * response so that VERSION, and older hosts' checks of it, stay put.
+     *
+     * FeatureStream: CmdWriteStream carries a uint32_t byte count, and
+     * that many bytes of ciphertext follow as bare packets, with no
+     * command byte in each one.
+     *
+     * FeatureVerify: programmed words are read back into a running CRC,
+     * and CmdWriteFinal answers { CmdWriteFinal, ok }. The image is only
+     * marked valid if the CRC matched.
+     */
+    enum Feature {
+        FeatureStream   = 1 << 0,
+        FeatureVerify   = 1 << 1,
+    };
+
+    static const uint8_t FEATURES = FeatureStream | FeatureVerify;
+
     static void init();
     static void exec(bool userRequestedUpdate);
 
     static void onUsbData(const uint8_t *buf, unsigned numBytes);
 
 private:
+    // Blocks decrypted per batch in writeBlocks(), one full USB packet
+    static const unsigned MAX_BATCH_BLOCKS = 4;
+
     static bool manualUpdateRequested();
     static void load();
     static bool eraseMcuFlash();
-    static void decryptBlock(uint8_t *plaintext, const uint8_t *cipher);
+    static unsigned writeBlocks(const uint8_t *cipherIn, unsigned numBytes);
     static void program(const uint8_t *data, unsigned len);
+    static void verifyProgrammed(uint32_t end);
+    static void writeFinal(const uint8_t *buf, unsigned numBytes);
     static bool mcuFlashIsValid();
     static void cleanup();
     static void jumpToApplication(uint32_t msp, uint32_t resetVector);
 
     struct Update {
         uint32_t addressPointer;
+        uint32_t crcPointer;        // words below this are in the running CRC
+        uint32_t streamRemaining;   // bytes of CmdWriteStream still to come
         uint32_t expandedKey[44];
         uint8_t cipherBuf[AES128::BLOCK_SIZE];
         volatile bool loadInProgress;
@@ -30,7 +30,7 @@
  * We use the standard IMA ADPCM step sizes, even though our
  * codec isn't quite identical to IMA ADPCM.
  */
-const uint16_t ADPCMDecoder::stepSizeTable[89] = {
+const uint16_t ADPCMDecoder::stepSizeTable[NUM_STEPS] = {
     7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
     34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
     143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449,
@@ -42,29 +42,111 @@ const uint16_t ADPCMDecoder::stepSizeTable[89] = {
 
 
 /**
- * Packed LUT for decoded nybble. Bits [7:0] are a signed coefficient for
- * the current step size, and bits [31:24] are the amount by which we update
- * the index. This split makes it easy to extract either half, as a signed
- * integer, using common ARM instructions. (Arithmetic shift, or 8-bit
- * sign extend).
+ * Signed coefficient for the current step size, for each decoded nybble.
+ * The predictor moves by (coefficient * step) / 8.
  *
  * Multiply is cheap, table lookups are cheap!
  */
-const int ADPCMDecoder::codeTable[16] = {
-    int(0xFFFFFF01),
-    int(0xFFFFFF03),
-    int(0xFFFFFF05),
-    int(0xFFFFFF07),
-    int(0x00000209),
-    int(0x0000040B),
-    int(0x0000060D),
-    int(0x0000080F),
-    int(0xFFFFFFFF),
-    int(0xFFFFFFFD),
-    int(0xFFFFFFFB),
-    int(0xFFFFFFF9),
-    int(0x000002F7),
-    int(0x000004F5),
-    int(0x000006F3),
-    int(0x000008F1),
+const int8_t ADPCMDecoder::coefTable[16] = {
+    1, 3, 5, 7, 9, 11, 13, 15,
+    -1, -3, -5, -7, -9, -11, -13, -15,
+};
+
+
+/**
+ * Next step index, for each current index and nybble magnitude (the low
+ * three bits). Magnitudes 0-3 step down by one, and 4-7 step up by 2, 4,
+ * 6, or 8. Entries are already clamped to the ends of stepSizeTable, so
+ * the decoder needs no compare-and-clamp per nybble.
+ */
+const uint8_t ADPCMDecoder::nextIndexTable[NUM_STEPS][8] = {
+    {  0,  0,  0,  0,  2,  4,  6,  8 },
+    {  0,  0,  0,  0,  3,  5,  7,  9 },
+    {  1,  1,  1,  1,  4,  6,  8, 10 },
+    {  2,  2,  2,  2,  5,  7,  9, 11 },
+    {  3,  3,  3,  3,  6,  8, 10, 12 },
+    {  4,  4,  4,  4,  7,  9, 11, 13 },
+    {  5,  5,  5,  5,  8, 10, 12, 14 },
+    {  6,  6,  6,  6,  9, 11, 13, 15 },
+    {  7,  7,  7,  7, 10, 12, 14, 16 },
+    {  8,  8,  8,  8, 11, 13, 15, 17 },
+    {  9,  9,  9,  9, 12, 14, 16, 18 },
+    { 10, 10, 10, 10, 13, 15, 17, 19 },
+    { 11, 11, 11, 11, 14, 16, 18, 20 },
+    { 12, 12, 12, 12, 15, 17, 19, 21 },
+    { 13, 13, 13, 13, 16, 18, 20, 22 },
+    { 14, 14, 14, 14, 17, 19, 21, 23 },
+    { 15, 15, 15, 15, 18, 20, 22, 24 },
+    { 16, 16, 16, 16, 19, 21, 23, 25 },
+    { 17, 17, 17, 17, 20, 22, 24, 26 },
+    { 18, 18, 18, 18, 21, 23, 25, 27 },
+    { 19, 19, 19, 19, 22, 24, 26, 28 },
+    { 20, 20, 20, 20, 23, 25, 27, 29 },
+    { 21, 21, 21, 21, 24, 26, 28, 30 },
+    { 22, 22, 22, 22, 25, 27, 29, 31 },
+    { 23, 23, 23, 23, 26, 28, 30, 32 },
+    { 24, 24, 24, 24, 27, 29, 31, 33 },
+    { 25, 25, 25, 25, 28, 30, 32, 34 },
+    { 26, 26, 26, 26, 29, 31, 33, 35 },
+    { 27, 27, 27, 27, 30, 32, 34, 36 },
+    { 28, 28, 28, 28, 31, 33, 35, 37 },
+    { 29, 29, 29, 29, 32, 34, 36, 38 },
+    { 30, 30, 30, 30, 33, 35, 37, 39 },
+    { 31, 31, 31, 31, 34, 36, 38, 40 },
+    { 32, 32, 32, 32, 35, 37, 39, 41 },
+    { 33, 33, 33, 33, 36, 38, 40, 42 },
+    { 34, 34, 34, 34, 37, 39, 41, 43 },
+    { 35, 35, 35, 35, 38, 40, 42, 44 },
+    { 36, 36, 36, 36, 39, 41, 43, 45 },
+    { 37, 37, 37, 37, 40, 42, 44, 46 },
+    { 38, 38, 38, 38, 41, 43, 45, 47 },
+    { 39, 39, 39, 39, 42, 44, 46, 48 },
+    { 40, 40, 40, 40, 43, 45, 47, 49 },
+    { 41, 41, 41, 41, 44, 46, 48, 50 },
+    { 42, 42, 42, 42, 45, 47, 49, 51 },
+    { 43, 43, 43, 43, 46, 48, 50, 52 },
+    { 44, 44, 44, 44, 47, 49, 51, 53 },
+    { 45, 45, 45, 45, 48, 50, 52, 54 },
+    { 46, 46, 46, 46, 49, 51, 53, 55 },
+    { 47, 47, 47, 47, 50, 52, 54, 56 },
+    { 48, 48, 48, 48, 51, 53, 55, 57 },
+    { 49, 49, 49, 49, 52, 54, 56, 58 },
+    { 50, 50, 50, 50, 53, 55, 57, 59 },
+    { 51, 51, 51, 51, 54, 56, 58, 60 },
+    { 52, 52, 52, 52, 55, 57, 59, 61 },
+    { 53, 53, 53, 53, 56, 58, 60, 62 },
+    { 54, 54, 54, 54, 57, 59, 61, 63 },
+    { 55, 55, 55, 55, 58, 60, 62, 64 },
+    { 56, 56, 56, 56, 59, 61, 63, 65 },
+    { 57, 57, 57, 57, 60, 62, 64, 66 },
+    { 58, 58, 58, 58, 61, 63, 65, 67 },
+    { 59, 59, 59, 59, 62, 64, 66, 68 },
+    { 60, 60, 60, 60, 63, 65, 67, 69 },
+    { 61, 61, 61, 61, 64, 66, 68, 70 },
+    { 62, 62, 62, 62, 65, 67, 69, 71 },
+    { 63, 63, 63, 63, 66, 68, 70, 72 },
+    { 64, 64, 64, 64, 67, 69, 71, 73 },
+    { 65, 65, 65, 65, 68, 70, 72, 74 },
+    { 66, 66, 66, 66, 69, 71, 73, 75 },
+    { 67, 67, 67, 67, 70, 72, 74, 76 },
+    { 68, 68, 68, 68, 71, 73, 75, 77 },
+    { 69, 69, 69, 69, 72, 74, 76, 78 },
+    { 70, 70, 70, 70, 73, 75, 77, 79 },
+    { 71, 71, 71, 71, 74, 76, 78, 80 },
+    { 72, 72, 72, 72, 75, 77, 79, 81 },
+    { 73, 73, 73, 73, 76, 78, 80, 82 },
+    { 74, 74, 74, 74, 77, 79, 81, 83 },
+    { 75, 75, 75, 75, 78, 80, 82, 84 },
+    { 76, 76, 76, 76, 79, 81, 83, 85 },
+    { 77, 77, 77, 77, 80, 82, 84, 86 },
+    { 78, 78, 78, 78, 81, 83, 85, 87 },
+    { 79, 79, 79, 79, 82, 84, 86, 88 },
+    { 80, 80, 80, 80, 83, 85, 87, 88 },
+    { 81, 81, 81, 81, 84, 86, 88, 88 },
+    { 82, 82, 82, 82, 85, 87, 88, 88 },
+    { 83, 83, 83, 83, 86, 88, 88, 88 },
+    { 84, 84, 84, 84, 87, 88, 88, 88 },
+    { 85, 85, 85, 85, 88, 88, 88, 88 },
+    { 86, 86, 86, 86, 88, 88, 88, 88 },
+    { 87, 87, 87, 87, 88, 88, 88, 88 },
 };
@@ -68,8 +68,10 @@ struct ADPCMState
  */
 class ADPCMDecoder
 {
-    static const uint16_t stepSizeTable[89];
-    static const int codeTable[16];
+    static const unsigned NUM_STEPS = 89;
+    static const uint16_t stepSizeTable[NUM_STEPS];
+    static const int8_t coefTable[16];
+    static const uint8_t nextIndexTable[NUM_STEPS][8];
 
     int sample;
     unsigned index;
@@ -80,7 +82,7 @@ public:
         unsigned v = state.value;
         sample = int16_t(v);
         index = v >> 16;
-        ASSERT(index < arraysize(stepSizeTable));
+        ASSERT(index < NUM_STEPS);
     }
 
     void ALWAYS_INLINE store(ADPCMState &state)
@@ -91,29 +93,23 @@ public:
     void ALWAYS_INLINE init(const uint8_t *header)
     {
         sample = int16_t(header[0] | (unsigned(header[1]) << 8));
-        index = MIN(header[2], int(arraysize(stepSizeTable) - 1));
+        index = MIN(header[2], int(NUM_STEPS - 1));
     }
 
     // Call once per nybble to update decoder state, least significant nybble first
     int ALWAYS_INLINE decodeNybble(unsigned nybble)
     {
-        ASSERT(index < arraysize(stepSizeTable));
-        ASSERT(nybble < arraysize(codeTable));
+        ASSERT(index < NUM_STEPS);
+        ASSERT(nybble < arraysize(coefTable));
 
         int step = stepSizeTable[index];
-        int code = codeTable[nybble];
+        int coef = coefTable[nybble];
 
         // Update predictor and clamp using MULS and SSAT.
-        sample = Intrinsic::SSAT(sample + 
-            ( int(unsigned(int8_t(code)) * unsigned(step)) >> 3 ), 16);
+        sample = Intrinsic::SSAT(sample + ((coef * step) >> 3), 16);
 
-        // Update quantizer step size
-        int nextIndex = index + (code >> 8);
-
-        // Clamp index. (This actually generates quite reasonable assembly)
-        nextIndex = MAX(nextIndex, 0);
-        nextIndex = MIN(nextIndex, int(arraysize(stepSizeTable) - 1));
-        index = nextIndex;
+        // Update quantizer step size. The table is already clamped.
+        index = nextIndexTable[index][nybble & 7];
 
         return sample;
     }
@@ -125,6 +121,20 @@ public:
         *(dest++) = decodeNybble(byte & 0xF);
         *(dest++) = decodeNybble(byte >> 4);
     }
+
+    // Decode 'bytes' bytes of ADPCM data, keeping the codec state in registers.
+    void ALWAYS_INLINE decodeBlock(SvmMemory::PhysAddr &src, int16_t *&dest, unsigned bytes)
+    {
+        while (bytes >= 4) {
+            decodeByte(src, dest);
+            decodeByte(src, dest);
+            decodeByte(src, dest);
+            decodeByte(src, dest);
+            bytes -= 4;
+        }
+        while (bytes--)
+            decodeByte(src, dest);
+    }
 };
 
 
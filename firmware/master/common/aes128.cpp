@@ -1,5 +1,6 @@
 
 #include "aes128.h"
+#include <string.h>
 
 // Matrix Sbox for the Sbox operation in encryption procedure
 static const uint8_t Sbox[256] = {
@@ -133,6 +134,27 @@ static inline uint32_t rot1(uint32_t x) {
     return (x << 24 ) | (x >> 8);
 }
 
+/*
+ * One forward round table, built from Sbox at runtime. Entry x is the
+ * MixColumn of a column holding only Sbox[x] in its first row. The other
+ * three rows are byte rotations of the same table, so SubBytes, ShiftRows
+ * and MixColumns together cost four lookups per column. The table lives
+ * in RAM, so the bootloader's flash budget only pays for buildTables().
+ */
+static uint32_t Te[256];
+static bool tablesBuilt;
+
+static void buildTables()
+{
+    for (unsigned x = 0; x != 256; ++x)
+        Te[x] = fwd_mcol(uint32_t(Sbox[x]) << 24);
+    tablesBuilt = true;
+}
+
+static inline uint32_t fwdRound(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    return Te[byte0(a)] ^ upr(Te[byte1(b)], 1) ^ upr(Te[byte2(c)], 2) ^ upr(Te[byte3(d)], 3);
+}
+
 /*
  * According to key, computes the expanded key (expkey).
  */
@@ -145,6 +167,9 @@ void AES128::expandKey(uint32_t* expkey, const uint32_t* key)
     register uint32_t copy2;
     register uint32_t copy3;
 
+    if (!tablesBuilt)
+        buildTables();
+
     copy0 = key[0];
     copy1 = key[1];
     copy2 = key[2];
@@ -171,62 +196,39 @@ void AES128::expandKey(uint32_t* expkey, const uint32_t* key)
     }
 }
 
-void AES128::encryptBlock(uint8_t* dest, const uint8_t* src, const uint32_t* expkey)
+/*
+ * Encrypt the state held in s0-s3, in place.
+ */
+static inline void encryptWords(uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3,
+    const uint32_t* expkey)
 {
-    uint32_t* dest32 = reinterpret_cast<uint32_t*>(dest);
-    const uint32_t* src32 = reinterpret_cast<const uint32_t*>(src);
-
     register uint32_t t0;
     register uint32_t t1;
     register uint32_t t2;
     register uint32_t t3;
-    register uint32_t s0;
-    register uint32_t s1;
-    register uint32_t s2;
-    register uint32_t s3;
-    register int r = 10; // Round counter
     register const uint32_t* local_pointer = expkey;
 
-    s0 = src32[0] ^ local_pointer[0];
-    s1 = src32[1] ^ local_pointer[1];
-    s2 = src32[2] ^ local_pointer[2];
-    s3 = src32[3] ^ local_pointer[3];
-    local_pointer += 4;
-
     // ADD KEY before start round
-    for (;;) {
-        t0 = bytesToWord( Sbox[byte0(s0)],
-                              Sbox[byte1(s1)],
-                              Sbox[byte2(s2)],
-                              Sbox[byte3(s3)]);
-        t1 = bytesToWord( Sbox[byte0(s1)],
-                              Sbox[byte1(s2)],
-                              Sbox[byte2(s3)],
-                              Sbox[byte3(s0)]);
-        t2 = bytesToWord( Sbox[byte0(s2)],
-                              Sbox[byte1(s3)],
-                              Sbox[byte2(s0)],
-                              Sbox[byte3(s1)]);
-        t3 = bytesToWord( Sbox[byte0(s3)],
-                              Sbox[byte1(s0)],
-                              Sbox[byte2(s1)],
-                              Sbox[byte3(s2)]);
-        // End of SBOX + Shift ROW
-
-        s0 = fwd_mcol(t0) ^ local_pointer[0];
-        s1 = fwd_mcol(t1) ^ local_pointer[1];
-        s2 = fwd_mcol(t2) ^ local_pointer[2];
-        s3 = fwd_mcol(t3) ^ local_pointer[3];
-        // End of mix column
+    s0 ^= local_pointer[0];
+    s1 ^= local_pointer[1];
+    s2 ^= local_pointer[2];
+    s3 ^= local_pointer[3];
+    local_pointer += 4;
 
+    // SBOX + Shift ROW + mix column, by table
+    for (unsigned r = 9; r; --r) {
+        t0 = fwdRound(s0, s1, s2, s3) ^ local_pointer[0];
+        t1 = fwdRound(s1, s2, s3, s0) ^ local_pointer[1];
+        t2 = fwdRound(s2, s3, s0, s1) ^ local_pointer[2];
+        t3 = fwdRound(s3, s0, s1, s2) ^ local_pointer[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
         local_pointer += 4;
-        if ( --r == 1) {
-            break;
-        }
-
     }
 
-    // Start Last round
+    // Start Last round, which has no mix column
     t0 = bytesToWord( Sbox[byte0(s0)],
                           Sbox[byte1(s1)],
                           Sbox[byte2(s2)],
@@ -244,16 +246,59 @@ void AES128::encryptBlock(uint8_t* dest, const uint8_t* src, const uint32_t* exp
                           Sbox[byte2(s1)],
                           Sbox[byte3(s2)]);
 
-    t0 ^= local_pointer[0];
-    t1 ^= local_pointer[1];
-    t2 ^= local_pointer[2];
-    t3 ^= local_pointer[3];
+    s0 = t0 ^ local_pointer[0];
+    s1 = t1 ^ local_pointer[1];
+    s2 = t2 ^ local_pointer[2];
+    s3 = t3 ^ local_pointer[3];
+}
+
+void AES128::encryptBlock(uint8_t* dest, const uint8_t* src, const uint32_t* expkey)
+{
+    uint32_t* dest32 = reinterpret_cast<uint32_t*>(dest);
+    const uint32_t* src32 = reinterpret_cast<const uint32_t*>(src);
+
+    uint32_t s0 = src32[0];
+    uint32_t s1 = src32[1];
+    uint32_t s2 = src32[2];
+    uint32_t s3 = src32[3];
+
+    encryptWords(s0, s1, s2, s3, expkey);
 
     // Store of the result of encryption
-    dest32[0] = t0;
-    dest32[1] = t1;
-    dest32[2] = t2;
-    dest32[3] = t3;
+    dest32[0] = s0;
+    dest32[1] = s1;
+    dest32[2] = s2;
+    dest32[3] = s3;
+}
+
+/*
+ * Decrypt 'count' blocks of CFB ciphertext. The feedback register stays
+ * in registers from one block to the next, and is only written back to
+ * 'iv' at the end. Input and output are copied a block at a time, since
+ * USB packets leave the ciphertext unaligned.
+ */
+void AES128::cfbDecrypt(uint8_t *dest, const uint8_t *src, unsigned count,
+    uint8_t *iv, const uint32_t* expkey)
+{
+    uint32_t feedback[4];
+    memcpy(feedback, iv, BLOCK_SIZE);
+
+    while (count--) {
+        uint32_t block[4] = { feedback[0], feedback[1], feedback[2], feedback[3] };
+        encryptWords(block[0], block[1], block[2], block[3], expkey);
+
+        memcpy(feedback, src, BLOCK_SIZE);
+        block[0] ^= feedback[0];
+        block[1] ^= feedback[1];
+        block[2] ^= feedback[2];
+        block[3] ^= feedback[3];
+        memcpy(dest, block, BLOCK_SIZE);
+
+        src += BLOCK_SIZE;
+        dest += BLOCK_SIZE;
+    }
+
+    memcpy(iv, feedback, BLOCK_SIZE);
 }
 
 /*
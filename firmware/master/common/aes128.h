@@ -11,6 +11,15 @@ public:
     static void expandKey(uint32_t* expkey, const uint32_t* key);
 
     static void encryptBlock(uint8_t *dest, const uint8_t *src, const uint32_t* expkey);
+
+    /*
+     * Decrypt 'count' whole blocks in CFB mode, as used for firmware
+     * updates. 'iv' holds the feedback register, and is left ready for
+     * the next call in the same stream. 'dest' may be the same as 'src'.
+     */
+    static void cfbDecrypt(uint8_t *dest, const uint8_t *src, unsigned count,
+        uint8_t *iv, const uint32_t* expkey);
+
     static void decryptBlock(uint32_t* dest, const uint32_t* src, const uint32_t* expkey);
 
     static void xorBlock(uint8_t* dest, const uint8_t* src) {
@@ -30,6 +30,7 @@
 #include "radio.h"
 #include "cubeslots.h"
 #include "tasks.h"
+#include "event.h"
 
 _SYSAssetLoader *AssetLoader::userLoader;
 const _SYSAssetConfiguration *AssetLoader::userConfig[_SYS_NUM_CUBE_SLOTS];
@@ -112,11 +113,16 @@ void AssetLoader::cubeDisconnect(_SYSCubeID id)
     // Disconnected cubes immediately become inactive, but we can restart them.
     ASSERT(id < _SYS_NUM_CUBE_SLOTS);
     _SYSCubeIDVector bit = Intrinsic::LZ(id);
+    bool wasActive = activeCubes & bit;
     Atomic::And(activeCubes, ~bit);
     Atomic::And(cacheCoherentCubes, ~bit);
     Atomic::And(queryErrorCubes, ~bit);
     Atomic::And(queryPendingCubes, ~bit);
     updateActiveCubes();
+
+    // Losing the last busy cube ends the load, same as finishing it.
+    if (wasActive && !activeCubes)
+        Event::setBasePending(Event::PID_BASE_ASSETDONE);
 }
 
 void AssetLoader::start(_SYSAssetLoader *loader, const _SYSAssetConfiguration *cfg,
@@ -293,17 +299,53 @@ void AssetLoader::task()
 {
     /*
      * Pump the state machine, on each active cube.
+     *
+     * A single FSM step often just moves to a state that could run
+     * right away (finishing one group and starting the next, or a CRC
+     * response followed by the next query). Rather than returning to
+     * Tasks::work() after every step, make up to MAX_PASSES passes over
+     * the cubes. A cube drops out of the pass as soon as a step leaves
+     * its state and substate unchanged, meaning it's waiting on the
+     * radio. Passes are round-robin, so one cube can't starve the rest.
      */
 
-    _SYSCubeIDVector cv = activeCubes & CubeSlots::userConnected;
-    while (cv) {
-        _SYSCubeID id = Intrinsic::CLZ(cv);
-        cv ^= Intrinsic::LZ(id);
+    _SYSCubeIDVector busy = activeCubes & CubeSlots::userConnected;
+
+    for (unsigned pass = 0; busy && pass < MAX_PASSES; ++pass) {
+        _SYSCubeIDVector cv = busy;
+        while (cv) {
+            _SYSCubeID id = Intrinsic::CLZ(cv);
+            _SYSCubeIDVector bit = Intrinsic::LZ(id);
+            cv ^= bit;
+
+            TaskState s = TaskState(cubeTaskState[id]);
+            uint32_t substate = cubeTaskSubstate[id].value;
+
+            fsmTaskState(id, s);
 
-        fsmTaskState(id, TaskState(cubeTaskState[id]));
+            if (cubeTaskState[id] == s && cubeTaskSubstate[id].value == substate)
+                busy &= ~bit;
+        }
+
+        // Cubes may have finished or disconnected during this pass
+        busy &= activeCubes & CubeSlots::userConnected;
+
+        // Leave the rest for next time if we're hogging the CPU
+        if (busy && Tasks::overBudget()) {
+            Tasks::trigger(Tasks::AssetLoader);
+            break;
+        }
     }
 }
 
+unsigned AssetLoader::idleBeats()
+{
+    // Loading cubes have deadlines that heartbeat() checks on every beat
+    if (userLoader && (activeCubes & CubeSlots::userConnected))
+        return 1;
+    return Tasks::MAX_IDLE_BEATS;
+}
+
 void AssetLoader::heartbeat()
 {
     /*
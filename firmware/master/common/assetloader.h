@@ -76,6 +76,7 @@ public:
     /// Tasks callbacks
     static void task();
     static void heartbeat();
+    static unsigned idleBeats();
 
     /// Return the current _SYSAssetLoader, if any is attached, or NULL if we're unattached.
     static ALWAYS_INLINE _SYSAssetLoader *getUserLoader() {
@@ -103,6 +104,9 @@ public:
 private:
     AssetLoader();  // Do not implement
 
+    // Upper limit on FSM passes per task() invocation
+    static const unsigned MAX_PASSES = 8;
+
     enum TaskState {
         S_ERROR,                // Internal consistency error; loading will stall.
         S_COMPLETE,             // Done loading, nothing to do.
@@ -65,6 +65,8 @@ void AssetLoader::fsmEnterState(_SYSCubeID id, TaskState s)
             Atomic::ClearLZ(activeCubes, id);
             updateActiveCubes();
             Event::setCubePending(Event::PID_CUBE_ASSETDONE, id);
+            if (!activeCubes)
+                Event::setBasePending(Event::PID_BASE_ASSETDONE);
             return;
 
         default:
@@ -413,6 +415,7 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
             lc->progress += bytes;
             cubeTaskSubstate[id].config.offset = offset;
             resetDeadline(id);
+            Event::setCubePending(Event::PID_CUBE_ASSETPROGRESS, id);
 
             // Are we done?
             ASSERT(offset <= group.dataSize);
@@ -125,9 +125,12 @@ void VirtAssetSlots::rebindCube(_SYSCubeID cube)
             eraseAssetSlotRecords(cube, erasedSlots);
         }
 
-        if (needWrite) {
-            // Write back updated CubeRecord
+        if (needErase) {
+            // New binding. Must be in flash before we touch the cube's slots.
             SysLFS::writeObject(ck, cr);
+        } else if (needWrite) {
+            // Only the access rank changed. Coalesce with other binds.
+            SysLFS::writeObjectDeferred(ck, cr);
         }
 
         // Update the graphics engine's current cube bank
@@ -232,7 +235,9 @@ bool VirtAssetSlots::locateGroup(const AssetGroupInfo &group,
                 asrKey = asr.makeKey(cubeKey, slot);
 
             } else {
-                // Out of records, and not allowed to allocate. Done searching.
+                // Out of records, and not allowed to allocate. Done searching,
+                // except for groups we may be able to share with other volumes.
+                foundCV |= locateSharedGroup(group, searchCV);
                 return true;
             }
 
@@ -258,8 +263,14 @@ bool VirtAssetSlots::locateGroup(const AssetGroupInfo &group,
                 ASSERT(searchCV & Intrinsic::LZ(cube));
                 searchCV ^= Intrinsic::LZ(cube);
 
+                // An identical group elsewhere on this cube saves us the load
+                if (locateSharedGroup(group, Intrinsic::LZ(cube))) {
+                    foundCV |= Intrinsic::LZ(cube);
+                    continue;
+                }
+
                 // Try to allocate the group
-                if (!asr.allocGroup(group.identity(), group.numTiles, offset)) {
+                if (!asr.allocGroup(group.identity(), group.contentKey(), group.numTiles, offset)) {
                     // We know for sure that there isn't any room left. Abort!
                     return false;
                 }
@@ -286,6 +297,80 @@ bool VirtAssetSlots::locateGroup(const AssetGroupInfo &group,
     return true;
 }
 
+_SYSCubeIDVector VirtAssetSlots::locateSharedGroup(const AssetGroupInfo &group,
+                                                   _SYSCubeIDVector searchCV)
+{
+    /*
+     * Look for a group with the same content as 'group', installed by
+     * any volume, on each cube in 'searchCV'. Only slots in the cube's
+     * current bank are addressable, so those are the only ones we search.
+     * The slot's owner can't recycle it while we're bound, since slots
+     * are only reallocated when a new volume binds.
+     *
+     * Updates the base address for every cube where we find it, and
+     * returns a vector of those cubes.
+     */
+
+    _SYSCubeIDVector foundCV = 0;
+
+    if (!numBoundSlots)
+        return 0;
+
+    SysLFS::AssetGroupContentKey key = group.contentKey();
+
+    FlashLFS &lfs = SysLFS::get();
+    FlashLFSObjectIter iter(lfs);
+    FlashLFSIndexRecord::KeyVector_t visited;
+    visited.clear();
+
+    while (searchCV && iter.previous(FlashLFSKeyQuery())) {
+        _SYSCubeID cube;
+        unsigned slot;
+
+        // Already seen a newer version of this key?
+        SysLFS::Key asrKey = (SysLFS::Key) iter.record()->getKey();
+        if (visited.test(asrKey))
+            continue;
+        visited.mark(asrKey);
+
+        // Is this an AssetSlotRecord?
+        SysLFS::Key cubeKey;
+        if (!SysLFS::AssetSlotRecord::decodeKey(asrKey, cubeKey, slot))
+            continue;
+
+        // Find the associated Cube ID
+        if (!SysLFS::CubeRecord::decodeKey(cubeKey, cube))
+            continue;
+        ASSERT(cube < _SYS_NUM_CUBE_SLOTS);
+
+        // Is this a cube we're still interested in, and a slot it can reach?
+        if (0 == (searchCV & Intrinsic::LZ(cube)))
+            continue;
+        if (slot / SysLFS::ASSET_SLOTS_PER_BANK != getCubeBank(cube))
+            continue;
+
+        SysLFS::AssetSlotRecord asr;
+        if (!asr.load(iter))
+            continue;
+
+        unsigned offset;
+        if (!asr.findGroupByContent(key, group.numTiles, offset))
+            continue;
+
+        _SYSAssetGroupCube *agc = AssetUtil::mapGroupCube(group.va, cube);
+        if (!agc)
+            break;
+
+        LOG(("ASSET[%d]: Sharing group from physical slot %d, offset %d\n", cube, slot, offset));
+
+        agc->baseAddr = offset + slot * PhysAssetSlot::SLOT_SIZE;
+        foundCV |= Intrinsic::LZ(cube);
+        searchCV ^= Intrinsic::LZ(cube);
+    }
+
+    return foundCV;
+}
+
 void VirtAssetSlots::finalizeSlot(_SYSCubeID cube, const VirtAssetSlot &slot,
     const AssetGroupInfo &group)
 {
@@ -434,6 +519,8 @@ void VirtAssetSlot::erase(_SYSCubeIDVector cv)
     _SYSCubeIDVector pendingOverview = cv & validCubeVector();
     _SYSCubeIDVector pendingSlots = pendingOverview;
 
+    // We read CubeRecords through the iterator, not SysLFS::read()
+    SysLFS::flush();
     FlashLFS &lfs = SysLFS::get();
     FlashLFSObjectIter iter(lfs);
 
@@ -542,6 +629,7 @@ void PhysAssetSlot::erase(_SYSCubeID cube)
     bool pendingOverview = true;
     bool pendingSlot = true;
 
+    SysLFS::flush();
     FlashLFS &lfs = SysLFS::get();
 
     SysLFS::Key cubeKey = SysLFS::CubeRecord::makeKey(cube);
@@ -186,6 +186,11 @@ public:
      * successfully finished, in finalizeSlot(). If we see this flag while
      * searching an asset group, we won't trust the contents of the slot at all.
      *
+     * A group that isn't installed under its own identity may still be
+     * found by content, in any physical slot on the cube's current bank.
+     * This lets identical groups from different volumes share one copy.
+     * See locateSharedGroup().
+     *
      * Returns 'true' on success. On allocation failure, returns 'false'.
      * Changes may have been already made by the time we discover the failure.
      */
@@ -207,6 +212,8 @@ private:
     static void setCubeBank(_SYSCubeID cube, unsigned bank);
     static void eraseAssetSlotRecords(_SYSCubeID cube, PhysSlotVector slots);
     static bool physSlotIsBound(_SYSCubeID cube, unsigned physSlot);
+    static _SYSCubeIDVector locateSharedGroup(const AssetGroupInfo &group,
+                                              _SYSCubeIDVector searchCV);
 
     static VirtAssetSlot instances[NUM_SLOTS];
     static FlashVolume boundVolume;
@@ -360,3 +360,31 @@ void AssetGroupInfo::copyCRC(uint8_t *buffer) const
         SvmMemory::copyROData(dataRef, buffer, va, _SYS_ASSET_GROUP_CRC_SIZE);
     }
 }
+
+SysLFS::AssetGroupContentKey AssetGroupInfo::contentKey() const
+{
+    /*
+     * Fold the stir-computed CRC and both sizes into a short key that
+     * identifies this group's content independently of its volume.
+     *
+     * The CRC samples only a few bytes per tile, so on its own it's a
+     * weak identity. Two groups must also agree on tile count and on
+     * compressed size before we'll call them the same.
+     */
+
+    uint8_t crc[_SYS_ASSET_GROUP_CRC_SIZE];
+    copyCRC(crc);
+
+    uint32_t key = dataSize * 0x9E3779B1 ^ numTiles;
+    for (unsigned i = 0; i < arraysize(crc); ++i)
+        key = ((key << 5) | (key >> 27)) ^ crc[i];
+
+    // Zero is reserved for "unknown"
+    if (!key)
+        key = 1;
+
+    SysLFS::AssetGroupContentKey result;
+    for (unsigned i = 0; i < arraysize(result.bytes); ++i)
+        result.bytes[i] = uint8_t(key >> (i * 8));
+    return result;
+}
@@ -83,6 +83,7 @@ struct AssetGroupInfo {
     bool fromAssetConfiguration(const _SYSAssetConfiguration *config);
 
     void copyCRC(uint8_t *buffer) const;
+    SysLFS::AssetGroupContentKey contentKey() const;
 
     SysLFS::AssetGroupIdentity identity() const
     {
@@ -0,0 +1,340 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Audio microbenchmarks. See audiobench.h.
+ */
+
+#include "audiobench.h"
+#include "audiomixer.h"
+#include "audiochannel.h"
+#include "adpcmdecoder.h"
+#include "xmtrackerplayer.h"
+#include "svmmemory.h"
+#include <string.h>
+
+#ifdef SIFTEO_SIMULATOR
+#   include "ostime.h"
+#endif
+
+namespace {
+
+    // Iterations per case. Long enough to be well above timer resolution.
+    const unsigned MIX_BLOCKS = 2000;
+    const unsigned TRACKER_TICKS = 1000;
+
+    // Layout of synthetic data in user RAM
+    const unsigned PCM_SAMPLES = 4096;
+    const unsigned ADPCM_BYTES = 4096;
+    const unsigned PCM_OFFSET = 0;
+    const unsigned ADPCM_OFFSET = PCM_OFFSET + PCM_SAMPLES * sizeof(int16_t);
+    const unsigned SONG_OFFSET = ADPCM_OFFSET + ADPCMState::HEADER_BYTES + ADPCM_BYTES;
+
+    const unsigned SONG_CHANNELS = 4;
+    const unsigned SONG_ROWS = 64;
+    const unsigned NOTE_BYTES = 5;
+
+    // Keeps results live, so the compiler can't discard the work
+    volatile int sink;
+
+    uint32_t prngState;
+
+    uint32_t prng()
+    {
+        // xorshift32; quality doesn't matter, only repeatability
+        prngState ^= prngState << 13;
+        prngState ^= prngState >> 17;
+        prngState ^= prngState << 5;
+        return prngState;
+    }
+
+    SysTime::Ticks now()
+    {
+        #ifdef SIFTEO_SIMULATOR
+            // Simulated time stands still while we run; use the host's clock
+            return SysTime::Ticks(OSTime::clock() * 1e9);
+        #else
+            return SysTime::ticks();
+        #endif
+    }
+
+    SvmMemory::PhysAddr userRAM()
+    {
+        SvmMemory::PhysAddr pa;
+        SvmMemory::mapRAM(SvmMemory::VIRTUAL_RAM_BASE, SvmMemory::RAM_SIZE_IN_BYTES, pa);
+        return pa;
+    }
+
+    SvmMemory::VirtAddr userVA(unsigned offset)
+    {
+        return SvmMemory::VIRTUAL_RAM_BASE + offset;
+    }
+
+    void makeModule(_SYSAudioModule &mod, uint8_t type, uint32_t sampleRate)
+    {
+        memset(&mod, 0, sizeof mod);
+        mod.sampleRate = sampleRate;
+        mod.loopType = _SYS_LOOP_REPEAT;
+        mod.type = type;
+        mod.volume = _SYS_AUDIO_DEFAULT_VOLUME;
+
+        if (type == _SYS_PCM) {
+            mod.loopEnd = PCM_SAMPLES;
+            mod.dataSize = PCM_SAMPLES * sizeof(int16_t);
+            mod.pData = userVA(PCM_OFFSET);
+        } else {
+            mod.loopEnd = ADPCM_BYTES * 2;
+            mod.dataSize = ADPCMState::HEADER_BYTES + ADPCM_BYTES;
+            mod.pData = userVA(ADPCM_OFFSET);
+        }
+    }
+
+    template <typename T>
+    T *place(unsigned &offset, unsigned count = 1)
+    {
+        // Word-aligned allocation of song structures in user RAM
+        offset = (offset + 3) & ~3;
+        T *p = reinterpret_cast<T*>(userRAM() + offset);
+        offset += count * sizeof(T);
+        ASSERT(offset <= SvmMemory::RAM_SIZE_IN_BYTES);
+        return p;
+    }
+
+    unsigned offsetOf(const void *p)
+    {
+        return reinterpret_cast<const uint8_t*>(p) - userRAM();
+    }
+
+    void finish(AudioBench::ReportFn fn, const char *name,
+        unsigned blocks, SysTime::Ticks start)
+    {
+        AudioBench::Result r = { name, blocks, now() - start };
+        fn(r);
+    }
+}
+
+void AudioBench::run(ReportFn report)
+{
+    /*
+     * Synthetic sample data. Any byte stream is valid ADPCM, and noise
+     * keeps the decoder's step index moving like real program material.
+     */
+
+    SvmMemory::erase();
+    prngState = 0x2545F491;
+
+    int16_t *pcm = reinterpret_cast<int16_t*>(userRAM() + PCM_OFFSET);
+    for (unsigned i = 0; i < PCM_SAMPLES; ++i)
+        pcm[i] = int16_t(prng());
+
+    uint8_t *adpcm = userRAM() + ADPCM_OFFSET;
+    memset(adpcm, 0, ADPCMState::HEADER_BYTES);
+    for (unsigned i = 0; i < ADPCM_BYTES; ++i)
+        adpcm[ADPCMState::HEADER_BYTES + i] = prng();
+
+    benchDecoder(report);
+    benchMixer(report);
+    benchLimiter(report);
+    benchTracker(report);
+
+    AudioMixer::instance.init();
+    SvmMemory::erase();
+}
+
+void AudioBench::benchDecoder(ReportFn report)
+{
+    const unsigned bytesPerBlock = BLOCK_FRAMES / 2;
+    const unsigned blocksPerPass = ADPCM_BYTES / bytesPerBlock;
+    const uint8_t *data = userRAM() + ADPCM_OFFSET + ADPCMState::HEADER_BYTES;
+    int16_t buffer[BLOCK_FRAMES];
+
+    ADPCMDecoder dec;
+    dec.init(data - ADPCMState::HEADER_BYTES);
+
+    SysTime::Ticks start = now();
+    for (unsigned i = 0; i < MIX_BLOCKS; ++i) {
+        SvmMemory::PhysAddr src = const_cast<uint8_t*>(data) + (i % blocksPerPass) * bytesPerBlock;
+        int16_t *dest = buffer;
+        dec.decodeBlock(src, dest, bytesPerBlock);
+        sink = buffer[0];
+    }
+    finish(report, "adpcm-decode", MIX_BLOCKS, start);
+}
+
+void AudioBench::benchMixer(ReportFn report)
+{
+    struct Case {
+        const char *name;
+        uint8_t type;
+        uint32_t sampleRate;
+    };
+
+    static const Case cases[] = {
+        { "mix-pcm-1x",       _SYS_PCM,     16000 },
+        { "mix-pcm-1.5x",     _SYS_PCM,     24000 },
+        { "mix-adpcm-0.5x",   _SYS_ADPCM,    8000 },
+        { "mix-adpcm-1x",     _SYS_ADPCM,   16000 },
+        { "mix-adpcm-1.37x",  _SYS_ADPCM,   22050 },
+        { "mix-adpcm-2x",     _SYS_ADPCM,   32000 },
+    };
+
+    int buffer[BLOCK_FRAMES];
+
+    for (unsigned c = 0; c < arraysize(cases); ++c) {
+        _SYSAudioModule mod;
+        makeModule(mod, cases[c].type, cases[c].sampleRate);
+
+        // A real mixer slot, since Siftulator tracks output per channel ID
+        AudioChannelSlot &slot = AudioMixer::instance.channelSlots[0];
+        slot.play(&mod, _SYS_LOOP_REPEAT);
+
+        SysTime::Ticks start = now();
+        for (unsigned i = 0; i < MIX_BLOCKS; ++i) {
+            slot.mixAudio<true>(buffer, BLOCK_FRAMES);
+            sink = buffer[0];
+        }
+        finish(report, cases[c].name, MIX_BLOCKS, start);
+        slot.stop();
+    }
+
+    // Every channel at once, combined the way AudioMixer::mixAudio() does
+    AudioChannelSlot *slots = AudioMixer::instance.channelSlots;
+    for (unsigned ch = 0; ch < _SYS_AUDIO_MAX_CHANNELS; ++ch) {
+        _SYSAudioModule mod;
+        makeModule(mod, (ch & 1) ? _SYS_PCM : _SYS_ADPCM, 12000 + ch * 1500);
+        slots[ch].play(&mod, _SYS_LOOP_REPEAT);
+    }
+
+    SysTime::Ticks start = now();
+    for (unsigned i = 0; i < MIX_BLOCKS; ++i) {
+        slots[0].mixAudio<true>(buffer, BLOCK_FRAMES);
+        for (unsigned ch = 1; ch < _SYS_AUDIO_MAX_CHANNELS; ++ch)
+            slots[ch].mixAudio<false>(buffer, BLOCK_FRAMES);
+        sink = buffer[0];
+    }
+    finish(report, "mix-8ch", MIX_BLOCKS, start);
+
+    for (unsigned ch = 0; ch < _SYS_AUDIO_MAX_CHANNELS; ++ch)
+        slots[ch].stop();
+}
+
+void AudioBench::benchLimiter(ReportFn report)
+{
+    // Loud enough that most samples land on the limiter's gain curve
+    int buffer[BLOCK_FRAMES];
+    for (unsigned i = 0; i < BLOCK_FRAMES; ++i)
+        buffer[i] = int(prng() % 0x30000) - 0x18000;
+
+    int16_t output[BLOCK_FRAMES];
+
+    SysTime::Ticks start = now();
+    for (unsigned i = 0; i < MIX_BLOCKS; ++i) {
+        AudioMixer::softLimitBlock(buffer, output, BLOCK_FRAMES);
+        sink = output[0];
+    }
+    finish(report, "limiter", MIX_BLOCKS, start);
+}
+
+void AudioBench::benchTracker(ReportFn report)
+{
+    /*
+     * A one-pattern song that keeps every channel busy with notes and
+     * the common per-tick effects (arpeggio, porta, vibrato, volume
+     * slide), on an instrument with a volume envelope. Timed per tracker
+     * tick, excluding mixing.
+     */
+
+    unsigned offset = SONG_OFFSET;
+
+    _SYSXMInstrument *inst = place<_SYSXMInstrument>(offset);
+    memset(inst, 0, sizeof *inst);
+    makeModule(inst->sample, _SYS_ADPCM, 16000);
+    inst->compression = 4;
+
+    static const uint16_t envelope[] = {
+        0 | (64 << 9), 4 | (48 << 9), 16 | (56 << 9), 40 | (16 << 9)
+    };
+    uint16_t *points = place<uint16_t>(offset, arraysize(envelope));
+    memcpy(points, envelope, sizeof envelope);
+    inst->volumeEnvelopePoints = userVA(offsetOf(points));
+    inst->nVolumeEnvelopePoints = arraysize(envelope);
+    inst->volumeSustainPoint = 2;
+    inst->volumeLoopStartPoint = 1;
+    inst->volumeLoopEndPoint = 3;
+    inst->volumeType = 1 | XmTrackerPlayer::kEnvelopeLoop;
+
+    static const uint8_t effects[][2] = {
+        { 0x0, 0x37 },      // Arpeggio
+        { 0x1, 0x04 },      // Porta up
+        { 0x4, 0x48 },      // Vibrato
+        { 0xA, 0x0F },      // Volume slide
+    };
+
+    uint8_t *notes = place<uint8_t>(offset, SONG_ROWS * SONG_CHANNELS * NOTE_BYTES);
+    uint8_t *note = notes;
+    for (unsigned row = 0; row < SONG_ROWS; ++row)
+        for (unsigned ch = 0; ch < SONG_CHANNELS; ++ch) {
+            bool trigger = ((row + ch) & 3) == 0;
+            const uint8_t *fx = effects[(row / 4 + ch) % arraysize(effects)];
+            *(note++) = trigger ? 37 + (row * 7 + ch * 5) % 24 : 0;
+            *(note++) = trigger ? 1 : 0;
+            *(note++) = trigger ? 0x40 : 0;
+            *(note++) = fx[0];
+            *(note++) = fx[1];
+        }
+
+    _SYSXMPattern *pattern = place<_SYSXMPattern>(offset);
+    pattern->nRows = SONG_ROWS;
+    pattern->dataSize = SONG_ROWS * SONG_CHANNELS * NOTE_BYTES;
+    pattern->pData = userVA(offsetOf(notes));
+
+    uint8_t *order = place<uint8_t>(offset);
+    *order = 0;
+
+    _SYSXMSong song;
+    memset(&song, 0, sizeof song);
+    song.patternOrderTable = userVA(offsetOf(order));
+    song.patternOrderTableSize = 1;
+    song.nChannels = SONG_CHANNELS;
+    song.nPatterns = 1;
+    song.patterns = userVA(offsetOf(pattern));
+    song.nInstruments = 1;
+    song.instruments = userVA(offsetOf(inst));
+    song.frequencyTable = XmTrackerPlayer::kLinearFrequencies;
+    song.tempo = 6;
+    song.bpm = 125;
+
+    XmTrackerPlayer &player = XmTrackerPlayer::instance;
+    player.init();
+    if (!player.play(&song))
+        return;
+
+    SysTime::Ticks start = now();
+    for (unsigned i = 0; i < TRACKER_TICKS; ++i)
+        player.tick();
+    finish(report, "tracker-tick", TRACKER_TICKS, start);
+
+    player.stop();
+}
@@ -0,0 +1,73 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef AUDIOBENCH_H_
+#define AUDIOBENCH_H_
+
+#include "systime.h"
+#include "macros.h"
+
+/**
+ * Microbenchmarks for the audio path: the ADPCM decoder, channel mixing
+ * at several playback speeds, the soft limiter, and the XM tracker.
+ *
+ * Each case runs on synthetic data placed in SVM user RAM, so the same
+ * code runs under Siftulator (--audio-bench) and on hardware (built with
+ * AUDIO_BENCHMARK=1). Flash latency is deliberately left out, so the
+ * numbers only move when the audio code itself gets faster or slower.
+ * Times are in nanoseconds of host time under Siftulator, and of
+ * SysTime on hardware.
+ *
+ * This clobbers user RAM and all mixer and tracker state. Only run it
+ * when no game is loaded.
+ */
+
+class AudioBench {
+public:
+    // Frames per timed block, the same as AudioMixer::pullAudio()
+    static const unsigned BLOCK_FRAMES = 32;
+
+    struct Result {
+        const char *name;
+        unsigned blocks;            // Timed iterations: mixer blocks, or tracker ticks
+        SysTime::Ticks elapsed;
+
+        unsigned nsPerBlock() const {
+            return blocks ? unsigned(elapsed / blocks) : 0;
+        }
+    };
+
+    typedef void (*ReportFn)(const Result &result);
+
+    static void run(ReportFn report);
+
+private:
+    static void benchDecoder(ReportFn report);
+    static void benchMixer(ReportFn report);
+    static void benchLimiter(ReportFn report);
+    static void benchTracker(ReportFn report);
+};
+
+#endif // AUDIOBENCH_H_
@@ -61,12 +61,19 @@ void AudioChannelSlot::play(const struct _SYSAudioModule *module, _SYSAudioLoopT
     state &= ~STATE_STOPPED;
 }
 
+template <bool tOverwrite>
 bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
 {
     /*
      * Add this channel's contribution to 'buffer' for
      * 'numFrames' audio frames. If the buffer is NULL,
      * update state without outputting any audio.
+     *
+     * With tOverwrite, the buffer's old contents are ignored: we store
+     * rather than accumulate, and fill any frames after the end of the
+     * sample with silence. This lets the first channel in a block stand
+     * in for zeroing the buffer. Returns false, without touching the
+     * buffer, if we had nothing to contribute.
      */
 
     // Early out if this channel is in the process of being stopped by the main thread.
@@ -88,7 +95,10 @@ bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
     // Local copy of offset, to avoid writing back to RAM every time
     uint64_t localOffset = offset;
 
-    do {
+    // Playing at the sample's own rate, or an exact multiple of it?
+    const bool wholeSteps = latchedIncrement > 0 && !(latchedIncrement & SAMPLE_FRAC_MASK);
+
+    while (numFrames) {
         unsigned index = localOffset >> SAMPLE_FRAC_SIZE;
         unsigned fractional = localOffset & SAMPLE_FRAC_MASK;
 
@@ -103,10 +113,44 @@ bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
                 #endif
 
                 stop();
+
+                if (tOverwrite && buffer)
+                    while (numFrames--)
+                        *(buffer++) = 0;
                 break;
             }
         }
 
+        if (buffer && wholeSteps && !fractional && index < loopEnd) {
+            /*
+             * Fast path for block mixing: every output frame lands exactly
+             * on an asset sample, so there's nothing to interpolate. Mix
+             * everything up to the loop boundary in one tight loop.
+             */
+
+            const unsigned step = latchedIncrement >> SAMPLE_FRAC_SIZE;
+            unsigned run = MIN(numFrames, (loopEnd - index + step - 1) / step);
+            ASSERT(run > 0);
+
+            numFrames -= run;
+            localOffset += uint64_t(run) * latchedIncrement;
+
+            do {
+                int sample = (samples.getSample(index, mod) * latchedVolume)
+                    >> _SYS_AUDIO_MAX_VOLUME_LOG2;
+
+                #ifdef SIFTEO_SIMULATOR
+                    MCAudioVisData::writeChannelSample(AudioMixer::instance.channelID(this), sample);
+                #endif
+
+                *buffer = tOverwrite ? sample : *buffer + sample;
+                buffer++;
+                index += step;
+            } while (--run);
+
+            continue;
+        }
+
         // Compute the next sample
         if (buffer) {
             int sample;
@@ -146,20 +190,23 @@ bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
             #endif
 
             // Mix into buffer (No need to clamp yet)
-            *buffer += sample;
+            *buffer = tOverwrite ? sample : *buffer + sample;
             buffer++;
         }
 
         // Advance to the next output sample
         localOffset += latchedIncrement;
-
-    } while (--numFrames);
+        numFrames--;
+    }
 
     offset = localOffset;
 
     return true;
 }
 
+template bool AudioChannelSlot::mixAudio<false>(int *buffer, uint32_t numFrames);
+template bool AudioChannelSlot::mixAudio<true>(int *buffer, uint32_t numFrames);
+
 void AudioChannelSlot::setPos(uint32_t ofs)
 {
     // Seeking past the end of the loop?
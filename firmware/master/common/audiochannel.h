@@ -81,8 +81,10 @@ public:
     void setPos(uint32_t ofs);
 
 protected:
+    template <bool tOverwrite>
     bool mixAudio(int *buffer, uint32_t numFrames);
     friend class AudioMixer;    // mixer can tell us to mixAudio()
+    friend class AudioBench;    // times mixAudio() directly
 
 private:
     static const int STATE_PAUSED   = (1 << 0);
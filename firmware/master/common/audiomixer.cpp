@@ -87,6 +87,9 @@ void AudioMixer::init()
         ch.stop();
     }
 
+    // The next program's sample data lives at the same VAs
+    AudioSampleData::invalidateCache();
+
     XmTrackerPlayer::instance.init();
 }
 
@@ -101,8 +104,8 @@ ALWAYS_INLINE bool AudioMixer::mixAudio(int *buffer, uint32_t numFrames)
      * Returns true if any audio data was available. If so, we're guaranteed
      * to produce exactly 'numFrames' of data.
      *
-     * Assumes the buffer was already zero'ed. Each channel is mixed together
-     * into the same buffer.
+     * The first channel to produce audio overwrites the buffer, and the
+     * rest accumulate into it. If we return false, the buffer is untouched.
      *
      * If buffer is NULL, we update the state of all channels without
      * actually generating any audio data.
@@ -127,7 +130,10 @@ ALWAYS_INLINE bool AudioMixer::mixAudio(int *buffer, uint32_t numFrames)
         }
         
         // Each channel individually mixes itself with the existing buffer contents
-        result |= ch.mixAudio(buffer, numFrames);
+        if (result)
+            ch.mixAudio<false>(buffer, numFrames);
+        else
+            result = ch.mixAudio<true>(buffer, numFrames);
     }
     
     return result;
@@ -183,6 +189,13 @@ ALWAYS_INLINE int AudioMixer::softLimiter(int32_t sample)
     return attenuated;
 }
 
+void AudioMixer::softLimitBlock(const int *src, int16_t *dest, unsigned count)
+{
+    // Out-of-line form of softLimiter(), so AudioBench can time it alone
+    while (count--)
+        *(dest++) = softLimiter(*(src++));
+}
+
 /*
  * Called from within Tasks::work to mix audio on the main thread, to be
  * consumed by the audio out device.
@@ -211,17 +224,11 @@ void AudioMixer::pullAudio()
      * and the tracker is idle.
      *
      * Note that in headless mode, we have no audio driver to wake up our
-     * task, we're polling based on wallclock time: so we constantly re-trigger
-     * our own task. In other modes, we do NOT do this. We only wake up when
-     * the audio driver has dequeued some samples.
+     * task. SystemMC stands in for it with a virtual-time audio clock, so
+     * we're triggered in lockstep with simulated time. In other modes, we
+     * only wake up when the audio driver has dequeued some samples.
      */
 
-    #ifdef SIFTEO_SIMULATOR
-        if (headless) {
-            Tasks::trigger(Tasks::AudioPull);
-        }
-    #endif
-
     #ifdef SIFTEO_SIMULATOR
         MCAudioVisData::instance.mixerActive = mixer.active();
     #endif
@@ -288,7 +295,12 @@ void AudioMixer::pullAudio()
     } 
 
     // Calculating volume is relatively expensive; do it only if we have audio to mix.
-    const int mixerVolume = Volume::systemVolume();
+    #ifdef SIFTEO_SIMULATOR
+        // Nobody's listening? Take the muted path, which only advances channel state.
+        const int mixerVolume = SystemMC::isAudioDiscarded() ? 0 : Volume::systemVolume();
+    #else
+        const int mixerVolume = Volume::systemVolume();
+    #endif
     ASSERT(mixerVolume >= 0 && mixerVolume <= Volume::MAX_VOLUME);
 
     #ifdef SIFTEO_SIMULATOR
@@ -344,12 +356,12 @@ void AudioMixer::pullAudio()
         } else if (mixerVolume) {
             // Not muted. Generate audio data
 
-            // Zero out the buffer (Faster than memset)
-            for (int *i = blockBuffer, *e = blockBuffer + blockSize; i != e; ++i)
-                *i = 0;
-
-            // Mix data from all channels.
+            // Mix data from all channels. Only zero the buffer if none of them played.
             mixed = mixer.mixAudio(blockBuffer, blockSize);
+            if (!mixed) {
+                for (int *i = blockBuffer, *e = blockBuffer + blockSize; i != e; ++i)
+                    *i = 0;
+            }
             // save our latest sample in the event that we need to begin a fadeout
             mixer.lastSample = blockBuffer[blockSize - 1];
 
@@ -28,6 +28,7 @@
 
 #include "ringbuffer.h"
 #include "audiochannel.h"
+#include "tasks.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <sifteo/abi.h>
@@ -97,15 +98,36 @@ public:
 
     static void pullAudio();
 
+    /*
+     * Deadline check, for safe points inside long-running user code.
+     *
+     * Normally we only mix from Tasks::work(), which runs after each syscall.
+     * User code that computes for a long time without making a syscall
+     * would starve the output buffer. SvmRuntime calls this on SVM calls and
+     * returns. It runs the mixer right away, and nothing else, but only once
+     * the output buffer is below a low watermark. Otherwise it costs a
+     * flag test.
+     */
+    static ALWAYS_INLINE void pollDeadline() {
+        if (Tasks::isPending(Tasks::AudioPull)
+            && output.readAvailable() < DEADLINE_WATERMARK
+            && (instance.active() || instance.trackerCallbackInterval))
+            Tasks::work(~Intrinsic::LZ(Tasks::AudioPull));
+    }
+
     ALWAYS_INLINE unsigned channelID(AudioChannelSlot *slot) {
         return slot - &channelSlots[0];
     }
 
 protected:
     friend class XmTrackerPlayer; // can call setTrackerCallbackInterval()
+    friend class AudioBench;      // drives channelSlots and softLimitBlock()
     void setTrackerCallbackInterval(uint32_t usec);
 
 private:
+    // Samples left in 'output' at which pollDeadline() steps in (16 ms)
+    static const unsigned DEADLINE_WATERMARK = SAMPLE_HZ / 64;
+
     static const int FADE_INCREMENT = 8;
     static const int FADE_MASK = 0xfffffff8;
     static const int FADE_TEST = 0x7;
@@ -125,6 +147,7 @@ private:
     bool mixAudio(int *buffer, uint32_t numFrames);
 
     static int softLimiter(int32_t sample);
+    static void softLimitBlock(const int *src, int16_t *dest, unsigned count);
 };
 
 #endif /* AUDIOMIXER_H_ */
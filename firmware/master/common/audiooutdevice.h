@@ -43,6 +43,37 @@ public:
 
     static const unsigned END_OF_STREAM = 0x8000;
 
+#ifndef SIFTEO_SIMULATOR
+    /*
+     * Output buffer health, sampled each time the device interrupts to
+     * consume mixer output. An underrun is an interrupt that found the
+     * device had caught up with the mixer while it was still active,
+     * so stale or missing samples reached the speaker. Fill levels are
+     * in samples, measured before the device consumed anything.
+     */
+    struct Stats {
+        uint32_t interrupts;
+        uint32_t underruns;
+        uint16_t minFill;
+        uint16_t maxFill;
+    };
+
+    static ALWAYS_INLINE const Stats &getStats() {
+        return stats;
+    }
+
+    static void resetStats();
+
+    static ALWAYS_INLINE void recordFill(unsigned fill, bool underrun) {
+        stats.interrupts++;
+        stats.underruns += underrun;
+        if (fill < stats.minFill)
+            stats.minFill = fill;
+        if (fill > stats.maxFill)
+            stats.maxFill = fill;
+    }
+#endif
+
     /*
      * On real hardware, our audio device is 100% interrupt driven, and it pulls
      * directly from the mixing buffer. On Siftulator, we don't have control over
@@ -58,6 +89,11 @@ public:
     #else
         static ALWAYS_INLINE void pullFromMixer() {}
     #endif
+
+private:
+    #ifndef SIFTEO_SIMULATOR
+        static Stats stats;
+    #endif
 };
 
 
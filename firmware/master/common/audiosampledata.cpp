@@ -26,9 +26,18 @@
 #include "audiosampledata.h"
 #include "svmmemory.h"
 #include <algorithm>
+#include <string.h>
 
 #define LGPFX "AudioSampleData: "
 
+AudioSampleData::CacheEntry AudioSampleData::cache[CACHE_ENTRIES];
+
+
+void AudioSampleData::invalidateCache()
+{
+    for (unsigned i = 0; i < CACHE_ENTRIES; ++i)
+        cache[i].pData = 0;
+}
 
 void AudioSampleData::init(const _SYSAudioModule &mod)
 {
@@ -36,6 +45,10 @@ void AudioSampleData::init(const _SYSAudioModule &mod)
     autoSnapshotPoint = mod.loopStart & ~HALF_BUFFER_MASK;
     snapshot.sampleNum = 0x7fffffff & ~HALF_BUFFER_MASK;
 
+    cacheable = mod.type == _SYS_ADPCM && mod.pData && mod.loopEnd <= MAX_CACHED_SAMPLES;
+    streaming = !cacheable && mod.pData && mod.dataSize >= MIN_STREAM_BYTES;
+    streamLength = 0;
+
     // Load initial conditions for ADPCM
     if (mod.type == _SYS_ADPCM) {
         uint32_t buffer = 0;
@@ -47,6 +60,34 @@ void AudioSampleData::init(const _SYSAudioModule &mod)
     reset();
 }
 
+SvmMemory::PhysAddr AudioSampleData::streamData(uint32_t offset,
+    uint32_t length, const _SYSAudioModule &mod)
+{
+    /*
+     * Return a pointer to 'length' bytes of module data, starting at
+     * 'offset', from this channel's stream window. Refills the window
+     * with the following STREAM_BYTES when the request falls outside it.
+     * Returns zero on failure, in which case the caller falls back on
+     * the cached path.
+     */
+
+    ASSERT(length <= STREAM_BYTES);
+
+    if (offset < streamOffset || offset + length > streamOffset + streamLength) {
+        uint32_t fill = MIN(STREAM_BYTES, mod.dataSize - offset);
+        streamLength = 0;
+
+        if (offset >= mod.dataSize || fill < length ||
+            !SvmMemory::copyRODataUncached(stream, mod.pData + offset, fill))
+            return 0;
+
+        streamOffset = offset;
+        streamLength = fill;
+    }
+
+    return &stream[offset - streamOffset];
+}
+
 void AudioSampleData::fetchBlockPCM(uint32_t sampleNum, const _SYSAudioModule &mod)
 {
     /*
@@ -63,8 +104,15 @@ void AudioSampleData::fetchBlockPCM(uint32_t sampleNum, const _SYSAudioModule &m
     SvmMemory::VirtAddr va = mod.pData + (sampleNum * sizeof(int16_t));
     SvmMemory::PhysAddr pa = (SvmMemory::PhysAddr) dest;
 
-    FlashBlockRef ref;
-    SvmMemory::copyROData(ref, pa, va, HALF_BUFFER * sizeof(int16_t));
+    const uint32_t length = HALF_BUFFER * sizeof(int16_t);
+    SvmMemory::PhysAddr streamPA = streaming ? streamData(va - mod.pData, length, mod) : 0;
+
+    if (streamPA) {
+        memcpy(pa, streamPA, length);
+    } else {
+        FlashBlockRef ref;
+        SvmMemory::copyROData(ref, pa, va, length);
+    }
 
     // Update state (Ignore snapshots)
     state.sampleNum = sampleNum + HALF_BUFFER;
@@ -82,6 +130,21 @@ void AudioSampleData::fetchBlockADPCM(uint32_t sampleNum, const _SYSAudioModule
     // Argument is expected to be Half-buffer-aligned.
     ASSERT((sampleNum & HALF_BUFFER_MASK) == 0);
 
+    if (cacheable) {
+        // Already decoded, by this channel or another one?
+        CacheEntry &entry = cacheEntry(sampleNum, mod);
+        if (entry.pData == mod.pData && entry.sampleNum == sampleNum) {
+            memcpy(&samples[sampleNum & FULL_BUFFER_MASK], entry.samples, sizeof entry.samples);
+            state.sampleNum = sampleNum + HALF_BUFFER;
+            state.adpcm = entry.adpcm;
+
+            // Same snapshot the decoder would have taken
+            if (UNLIKELY(state.sampleNum == autoSnapshotPoint))
+                snapshot = state;
+            return;
+        }
+    }
+
     // Fast local copy of ADPCM CODEC state (Either the last saved, or the initial conditions)
     unsigned stateSampleNum = state.sampleNum;
     ASSERT((stateSampleNum & HALF_BUFFER_MASK) == 0);
@@ -120,9 +183,9 @@ void AudioSampleData::fetchBlockADPCM(uint32_t sampleNum, const _SYSAudioModule
 
         while (1) {
             uint32_t chunk = bytesRemaining;
-            SvmMemory::PhysAddr pa;
+            SvmMemory::PhysAddr pa = streaming ? streamData(va - mod.pData, chunk, mod) : 0;
 
-            if (!SvmMemory::mapROData(ref, va, chunk, pa)) {
+            if (!pa && !SvmMemory::mapROData(ref, va, chunk, pa)) {
                 LOG((LGPFX "Memory mapping failure for ADPCM sample at VA 0x%08x\n",
                     unsigned(va)));
                 return;
@@ -132,17 +195,7 @@ void AudioSampleData::fetchBlockADPCM(uint32_t sampleNum, const _SYSAudioModule
             ASSERT(chunk <= 8);
             ASSERT(chunk > 0);
 
-            switch (chunk) {
-                case 8: dec.decodeByte(pa, dest);
-                case 7: dec.decodeByte(pa, dest);
-                case 6: dec.decodeByte(pa, dest);
-                case 5: dec.decodeByte(pa, dest);
-                case 4: dec.decodeByte(pa, dest);
-                case 3: dec.decodeByte(pa, dest);
-                case 2: dec.decodeByte(pa, dest);
-                case 1: dec.decodeByte(pa, dest);
-                case 0: break;
-            };
+            dec.decodeBlock(pa, dest, chunk);
 
             if (LIKELY(0 == (bytesRemaining -= chunk)))
                 break;
@@ -154,6 +207,14 @@ void AudioSampleData::fetchBlockADPCM(uint32_t sampleNum, const _SYSAudioModule
         unsigned beginningOfBlock = stateSampleNum;
         stateSampleNum += HALF_BUFFER;
 
+        if (cacheable) {
+            CacheEntry &entry = cacheEntry(beginningOfBlock, mod);
+            entry.pData = mod.pData;
+            entry.sampleNum = beginningOfBlock;
+            dec.store(entry.adpcm);
+            memcpy(entry.samples, dest - HALF_BUFFER, sizeof entry.samples);
+        }
+
         // Save an automatic snapshot if applicable
         ASSERT((stateSampleNum & HALF_BUFFER_MASK) == 0);
         ASSERT((snapshot.sampleNum & HALF_BUFFER_MASK) == 0);
@@ -37,6 +37,9 @@ class AudioSampleData {
 public:
     void init(const _SYSAudioModule &mod);
 
+    // Forget all shared decoded blocks. Needed whenever flash VAs may change meaning.
+    static void invalidateCache();
+
     // Seek to the beginning of the sample data.
     void ALWAYS_INLINE reset()
     {
@@ -89,7 +92,47 @@ private:
     } state, snapshot;
 
     ADPCMState adpcmIC;         // Initial conditions for ADPCM codec
+    bool cacheable;             // Short enough to use the shared decode cache?
+    bool streaming;             // Long enough to bypass the flash block cache?
+
+    /*
+     * Long modules are read through a small window owned by this channel,
+     * straight from the flash device. Each byte of a long stream is read
+     * once per pass, so keeping its blocks in the shared flash block cache
+     * buys nothing and evicts code and assets that are still in use.
+     */
+    static const unsigned STREAM_BYTES = 64;
+    static const unsigned MIN_STREAM_BYTES = 4096;
+
+    uint8_t stream[STREAM_BYTES];
+    uint32_t streamOffset;      // Module data offset of stream[0]
+    uint32_t streamLength;      // Valid bytes in stream[], zero if empty
+
+    /*
+     * Decoded ADPCM blocks, shared by every channel. This is a small
+     * direct-mapped cache, keyed by module data address and block. Only
+     * short modules use it, so that a whole short loop can stay resident
+     * and a long stream can't evict it. Once a short loop has played
+     * through once, further passes (on any channel) skip the decoder.
+     */
+    static const unsigned CACHE_ENTRIES = 32;               // Must be a power of two
+    static const unsigned CACHE_MASK = CACHE_ENTRIES - 1;
+    static const unsigned MAX_CACHED_SAMPLES = CACHE_ENTRIES * HALF_BUFFER;
+
+    struct CacheEntry {
+        SvmMemory::VirtAddr pData;  // Module this block belongs to, or zero
+        uint32_t sampleNum;         // First sample in the block
+        ADPCMState adpcm;           // Codec state after decoding the block
+        int16_t samples[HALF_BUFFER];
+    };
+
+    static CacheEntry cache[CACHE_ENTRIES];
+
+    static ALWAYS_INLINE CacheEntry &cacheEntry(uint32_t sampleNum, const _SYSAudioModule &mod) {
+        return cache[(sampleNum / HALF_BUFFER + mod.pData) & CACHE_MASK];
+    }
 
+    SvmMemory::PhysAddr streamData(uint32_t offset, uint32_t length, const _SYSAudioModule &mod);
     void fetchBlockPCM(uint32_t sampleNum, const _SYSAudioModule &mod);
     void fetchBlockADPCM(uint32_t sampleNum, const _SYSAudioModule &mod);
 
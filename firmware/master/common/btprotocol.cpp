@@ -107,6 +107,9 @@ void BTProtocolCallbacks::onReceiveData(uint8_t *buffer, unsigned length)
         dest->type = type;
         memcpy(dest->bytes, buffer + 1, length - 1);
 
+        BTProtocol::instance.counters.rxUserPackets++;
+        BTProtocol::instance.counters.rxUserBytes += length - 1;
+
         // Notify userspace that some data has arrived.
         queue.commit();
         return Event::setBasePending(Event::PID_BASE_BT_READ_AVAILABLE);
@@ -140,6 +143,9 @@ unsigned BTProtocolCallbacks::onProduceData(uint8_t *buffer)
             buffer[0] = src->type & BTProtocol::TYPE_MASK;
             memcpy(buffer + 1, src->bytes, length);
 
+            BTProtocol::instance.counters.txUserPackets++;
+            BTProtocol::instance.counters.txUserBytes += length;
+
             // Notify userspace that some buffer space is available
             queue.pop();
             Event::setBasePending(Event::PID_BASE_BT_WRITE_AVAILABLE);
@@ -155,6 +161,20 @@ unsigned BTProtocolCallbacks::onProduceData(uint8_t *buffer)
     return result;
 }
 
+bool BTProtocolCallbacks::isDataPending()
+{
+    if (BTProtocol::instance.sysData.bytesToWrite())
+        return true;
+
+    BTQueue &queue = BTProtocol::instance.userSendQueue;
+    return queue.hasQueue() && queue.readAvailable();
+}
+
+void BTProtocolCallbacks::onTransmitStalled()
+{
+    BTProtocol::instance.counters.txCreditStalls++;
+}
+
 void BTProtocol::task()
 {
     if (instance.flags.test(ReportVolumeFlag)) {
@@ -187,6 +187,12 @@ public:
 
     static void onReceiveData(uint8_t *buffer, unsigned length);
     static unsigned onProduceData(uint8_t *buffer);
+
+    /// Is there anything for onProduceData() to send right now?
+    static bool isDataPending();
+
+    /// Data is pending, but the hardware has no room for it yet.
+    static void onTransmitStalled();
 };
 
 #endif
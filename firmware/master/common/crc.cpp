@@ -34,13 +34,7 @@
 uint32_t Crc32::block(const uint32_t *words, uint32_t count)
 {
     reset();
-
-    while (count) {
-        addInline(*words);
-        words++;
-        count--;
-    }
-
+    addWords(words, count);
     return get();
 }
 
@@ -56,11 +50,8 @@ void CrcStream::addBytes(const uint8_t *bytes, uint32_t count)
         byteTotal += words << 2;
         count &= 3;
 
-        while (words) {
-            words--;
-            Crc32::addInline(*(const uint32_t*)bytes);
-            bytes += 4;
-        }
+        Crc32::addWords((const uint32_t*)bytes, words);
+        bytes += words << 2;
     }
 
     /*
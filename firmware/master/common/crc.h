@@ -64,6 +64,13 @@ public:
      */
     static void addUniqueness();
 
+    /**
+     * Add a run of words to the CRC in progress. Data must be
+     * word-aligned. On hardware, long runs are fed to the CRC engine
+     * by memory-to-memory DMA instead of one store at a time.
+     */
+    static void addWords(const uint32_t *words, uint32_t count);
+
     /**
      * CRC a block of words. Data must be word-aligned.
      */
@@ -85,7 +92,7 @@ private:
      * in our CRC hardware. The inlined version does not include this delay,
      * so using it directly without care can cause incorrect CRC results.
      * However, we want this fast version available for internal use in
-     * block() and CrcStream.
+     * addWords() and CrcStream.
      */
     static void addInline(uint32_t word);
 
@@ -42,6 +42,10 @@
 #include "prng.h"
 #include "radioaddrfactory.h"
 
+#ifdef SIFTEO_SIMULATOR
+#   include "latencytracer.h"
+#endif
+
 
 void CubeSlot::connect(SysLFS::Key cubeRecord, const RadioAddress &addr, const RF_ACKType &fullACK)
 {
@@ -50,7 +54,9 @@ void CubeSlot::connect(SysLFS::Key cubeRecord, const RadioAddress &addr, const R
     // Reset state
     NeighborSlot::resetSlots(cv);
     setVideoBuffer(0);
+    setVideoShadow(0);
     setMotionBuffer(0);
+    setAccelThreshold(DEFAULT_ACCEL_THRESHOLD);
     Atomic::And(CubeSlots::sendShutdown, ~cv);
     Atomic::And(CubeSlots::sendStipple, ~cv);
     Atomic::And(CubeSlots::vramPaused, ~cv);
@@ -60,6 +66,12 @@ void CubeSlot::connect(SysLFS::Key cubeRecord, const RadioAddress &addr, const R
     pendingChannel = INVALID_CHANNEL;
     ackOptional = false;
     napDeadline = 0;
+    timeSyncWait = 0;
+    memset(&linkStats, 0, sizeof linkStats);
+    channelSince = rateSince = SysTime::ticks();
+    ratePackets = 0;
+    packetRate = 0;
+    paintControl.resetStats();
 
     // Store new identity
     lastACK = fullACK;
@@ -106,6 +118,7 @@ void CubeSlot::disconnect()
     Event::setCubePending(Event::PID_CONNECTION, id());
 
     setVideoBuffer(0);
+    setVideoShadow(0);
     setMotionBuffer(0);
 
     NeighborSlot::instances[id()].resetPairs();
@@ -115,6 +128,7 @@ void CubeSlot::userConnect()
 {
     Atomic::Or(CubeSlots::userConnected, bit());
     setVideoBuffer(0);
+    setVideoShadow(0);
     VirtAssetSlots::rebindCube(id());
     AssetLoader::cubeConnect(id());
 }
@@ -166,6 +180,13 @@ void CubeSlot::setVideoBuffer(_SYSVideoBuffer *v)
     vbuf = v;
 }
 
+void CubeSlot::setVideoShadow(_SYSVideoShadow *s)
+{
+    // Nothing in a newly attached shadow is trusted until we've sent it
+    vshadow = s;
+    invalidateVideoShadow();
+}
+
 bool CubeSlot::radioProduce(PacketTransmission &tx, SysTime::Ticks now)
 {
     // If the cube is asleep, yield our transmit slot
@@ -235,6 +256,7 @@ bool CubeSlot::radioProduce(PacketTransmission &tx, SysTime::Ticks now)
          */
 
         codec.encodeShutdown(tx.packet);
+        invalidateVideoShadow();
         ASSERT(!tx.packet.isFull());
         if (!(CubeSlots::minUserCubes == 0 && CubeSlots::maxUserCubes == 0))
             tx.numSoftwareRetries = 0;
@@ -242,17 +264,28 @@ bool CubeSlot::radioProduce(PacketTransmission &tx, SysTime::Ticks now)
     } else if (UNLIKELY(CubeSlots::sendStipple & cv)) {
         // Send a stipple pattern
         codec.encodeStipple(tx.packet, vbuf);
+        if (vshadow) {
+            // Only these words changed; the rest of the shadow still holds
+            for (unsigned i = 0; i != CubeCodec::NUM_STIPPLE_WORDS; ++i) {
+                uint16_t addr = CubeCodec::stippleWords[i];
+                vshadow->valid[addr >> 5] &= ~VRAM::maskCM1(addr);
+            }
+        }
         Atomic::And(CubeSlots::sendStipple, ~cv);
         ASSERT(!tx.packet.isFull());
 
     } else if (LIKELY(0 == (CubeSlots::vramPaused & cv))) {
         // Normal updates from VideoBuffer
 
-        if (codec.encodeVRAM(tx.packet, vbuf)) {
+        if (codec.encodeVRAM(tx.packet, vbuf, vshadow)) {
             // Finished flushing Video Buffer. Maybe trigger a render.
 
+            #ifdef SIFTEO_SIMULATOR
+            LatencyTracer::vramFlushed(id());
+            #endif
+
             if (paintControl.vramFlushed(this)) {
-                if (!codec.encodeVRAM(tx.packet, vbuf)) {
+                if (!codec.encodeVRAM(tx.packet, vbuf, vshadow)) {
                     // Didn't have enough room to flush the trigger. More work to do!
                     idle = false;
                 }
@@ -296,17 +329,33 @@ bool CubeSlot::radioProduce(PacketTransmission &tx, SysTime::Ticks now)
      * each cube to a different timeslice of our sensor polling
      * period, allowing the neighbor sensors to cooperate via
      * time division multiplexing. The packet itself is a short
-     * (3 byte) and simple packet which simply adjusts the phase
-     * of the cube's sensor timer.
+     * (4 byte) and simple packet which simply adjusts the phase
+     * of the cube's sensor timer, and carries the threshold below
+     * which the cube won't report accelerometer changes.
+     *
+     * We'd rather send a sync on its own, without an ACK. A sync that
+     * rides in an ACK'ed packet gets delivered late if the packet has to
+     * be retransmitted, and even a single retry is longer than a sensor
+     * timeslot. But a cube that's always busy may never give us an empty
+     * packet, so once a sync has waited long enough we pack it into the
+     * tail of whatever packet we're building.
      */
 
     if (timeSyncState)  {
         timeSyncState--;
     } else if (tx.packet.len == 0) {
-        timeSyncState = 1000;
-        codec.escTimeSync(tx.packet, calculateTimeSync());
+        timeSyncState = TIME_SYNC_INTERVAL;
+        timeSyncWait = 0;
+        codec.escTimeSync(tx.packet, calculateTimeSync(), calculateAccelThreshold());
         tx.noAck = true;    // just throw it out there UDP style
         return true;
+    } else if (timeSyncWait < TIME_SYNC_MAX_WAIT) {
+        timeSyncWait++;
+    } else if (codec.escTimeSync(tx.packet, calculateTimeSync(), calculateAccelThreshold())) {
+        // Keep the ACK, the data ahead of the sync still needs it
+        timeSyncState = TIME_SYNC_INTERVAL;
+        timeSyncWait = 0;
+        return true;
     }
 
     /*
@@ -334,6 +383,56 @@ bool CubeSlot::radioProduce(PacketTransmission &tx, SysTime::Ticks now)
     return true;
 }
 
+unsigned CubeSlot::radioQuantum(SysTime::Ticks now) const
+{
+    /*
+     * How many packets should this cube be allowed to send per scheduling
+     * round? Everyone gets one. Cubes with a pending VRAM update can earn
+     * more, where extra airtime most reduces visible latency:
+     *
+     *   - A short backlog means the frame is nearly done. Finishing it
+     *     now lets the cube render, at little cost to anyone else.
+     *
+     *   - A frame that has been waiting a long time is already late.
+     *
+     * A cube streaming a large update (like a full BG0 scroll) gets
+     * neither bonus for its backlog, so it can't crowd out small updates
+     * on other cubes.
+     *
+     * Asset loading earns one more turn, but only for a cube that can
+     * use it right now: flash data is queued, the cube has FIFO space
+     * to take it, and its recent ACKs came back quickly without many
+     * retries. A cube that's slow to program flash runs out of FIFO
+     * credit and stops asking, and one on a noisy link would mostly
+     * spend the extra airtime on retransmits. Either way the turn goes
+     * to other cubes, so the fast ones finish early instead of waiting
+     * behind the slow ones.
+     *
+     * Called in ISR context, once per round.
+     */
+
+    unsigned quantum = 1;
+
+    if (vbuf && napDeadline <= now) {
+        uint32_t cm16 = vbuf->cm16;
+        if (cm16) {
+            if (Intrinsic::POPCOUNT(cm16) <= SHORT_BACKLOG_CHUNKS)
+                quantum++;
+            if (paintControl.frameAge(now) > SysTime::msTicks(STALE_FRAME_MS))
+                quantum++;
+        }
+    }
+
+    if ((AssetLoader::getActiveCubes() & bit()) &&
+        linkStats.retryRate <= FAST_LOAD_RETRY_RATE &&
+        linkStats.latencyUS <= FAST_LOAD_LATENCY_US &&
+        AssetLoader::needFlashPacket(id()))
+        quantum++;
+
+    ASSERT(quantum <= MAX_RADIO_QUANTUM);
+    return quantum;
+}
+
 void CubeSlot::radioEmptyAcknowledge()
 {
     ackOptional = false;
@@ -387,6 +486,10 @@ void CubeSlot::radioAcknowledge(const PacketBuffer &packet)
             // Notify userspace about the immediate update
             Event::setCubePending(Event::PID_CUBE_ACCELCHANGE, id());
 
+            #ifdef SIFTEO_SIMULATOR
+            LatencyTracer::ack(id(), false);
+            #endif
+
             // If userspace has subscribed to high-frequency updates, write to its MotionBuffer
             if (motionWriter.hasBuffer()) {
                 motionWriter.write(MotionUtil::captureAccelState(*ack, getVersion()),
@@ -412,6 +515,10 @@ void CubeSlot::radioAcknowledge(const PacketBuffer &packet)
             }
             Event::setCubePending(Event::PID_CUBE_TOUCH, id());
             IdleTimeout::reset();
+
+            #ifdef SIFTEO_SIMULATOR
+            LatencyTracer::ack(id(), true);
+            #endif
         }
 
         // Is this a flash reset ACK?
@@ -461,6 +568,72 @@ void CubeSlot::radioTimeout()
     ackOptional = false;
 }
 
+void CubeSlot::updateLinkStats(unsigned retries, SysTime::Ticks now, SysTime::Ticks latency)
+{
+    /*
+     * Called by RadioManager for every packet the cube ACKs, with the
+     * hardware retry count and the time since we handed that packet to
+     * the radio. Keep lifetime totals, plus exponentially weighted
+     * averages that describe how the current channel is doing.
+     *
+     * The retry count is quantized to whole bursts of hardware retries,
+     * so the latency average is what picks up the occasional single
+     * retry that the count can't see.
+     */
+
+    linkStats.packets++;
+    linkStats.retries += retries;
+
+    int rate = MIN(retries << 8, 0xFFFFu);
+    linkStats.retryRate += (rate - int(linkStats.retryRate)) >> LINK_STATS_SHIFT;
+
+    // Clamp before converting, to keep 64-bit division out of the ISR
+    int us = latency < SysTime::usTicks(0xFFFF) ? int(unsigned(latency) / 1000) : 0xFFFF;
+    linkStats.latencyUS += (us - int(linkStats.latencyUS)) >> LINK_STATS_SHIFT;
+
+    // Packet rate, measured over short windows
+    SysTime::Ticks window = now - rateSince;
+    if (window >= SysTime::msTicks(PACKET_RATE_WINDOW_MS)) {
+        unsigned ms = unsigned(MIN(window, SysTime::sTicks(1))) / 1000000;
+        unsigned rate = (linkStats.packets - ratePackets) * 1000 / ms;
+        packetRate = MIN(rate, 0xFFFFu);
+        ratePackets = linkStats.packets;
+        rateSince = now;
+    }
+}
+
+bool CubeSlot::linkIsPoor(SysTime::Ticks now) const
+{
+    /*
+     * Should we move this cube to a new channel, based only on its own
+     * link? This complements the shared RFSpectrumModel, which catches
+     * bursts of interference within a channel bucket. Here we look for
+     * links that are merely consistently bad.
+     *
+     * After a hop, we require a minimum dwell time on the new channel.
+     * That gives the averages time to settle, and keeps a cube that's
+     * just far from the base from hopping continuously.
+     */
+
+    if (now - channelSince < SysTime::msTicks(MIN_CHANNEL_DWELL_MS))
+        return false;
+
+    return linkStats.retryRate > POOR_LINK_RETRY_RATE ||
+           linkStats.latencyUS > POOR_LINK_LATENCY_US;
+}
+
+void CubeSlot::getLinkStats(_SYSCubeLinkStats &stats) const
+{
+    stats = linkStats;
+    stats.channel = address.channel;
+}
+
+void CubeSlot::getFrameStats(_SYSCubeFrameStats &stats) const
+{
+    paintControl.getFrameStats(stats);
+    stats.packetRate = packetRate;
+}
+
 uint64_t CubeSlot::getHWID() const
 {
     uint64_t result = 0;
@@ -514,6 +687,19 @@ uint16_t CubeSlot::calculateTimeSync()
     return (cubeTicks + slotID * slotWidth) & timerMask;
 }
 
+uint8_t CubeSlot::calculateAccelThreshold()
+{
+    /*
+     * The cube leaves accelerometer axes alone in its ACK until they move
+     * by more than this, so that sensor noise doesn't keep every ACK busy.
+     * A motion buffer wants each sample as it happens, though.
+     */
+
+    if (motionWriter.hasBuffer())
+        return 0;
+    return accelThreshold;
+}
+
 void CubeSlot::queryResponse(const PacketBuffer &packet)
 {
     /*
@@ -54,6 +54,7 @@
 class CubeSlot {
  public:
     bool radioProduce(PacketTransmission &tx, SysTime::Ticks now);
+    unsigned radioQuantum(SysTime::Ticks now) const;
     void radioAcknowledge(const PacketBuffer &packet);
     void radioEmptyAcknowledge();
     void radioTimeout();
@@ -95,9 +96,25 @@ class CubeSlot {
     void clearTouchEvent() const;
 
     void setVideoBuffer(_SYSVideoBuffer *v);
+    void setVideoShadow(_SYSVideoShadow *s);
 
     void ALWAYS_INLINE setMotionBuffer(_SYSMotionBuffer *m) {
         motionWriter.setBuffer(m);
+        timeSyncState = 0;  // Effective accel threshold may have changed
+    }
+
+    ALWAYS_INLINE MotionWriter &getMotionWriter() {
+        return motionWriter;
+    }
+
+    // Smallest accelerometer change, minus one, that a cube will report
+    static const unsigned DEFAULT_ACCEL_THRESHOLD = 1;
+    static const unsigned MAX_ACCEL_THRESHOLD = 127;
+
+    void ALWAYS_INLINE setAccelThreshold(unsigned threshold) {
+        ASSERT(threshold <= MAX_ACCEL_THRESHOLD);
+        accelThreshold = threshold;
+        timeSyncState = 0;  // Send it with the next time sync
     }
 
     // synced with SDK facing version in sdk/include/sifteo/video.h
@@ -194,6 +211,16 @@ class CubeSlot {
         return &address;
     }
 
+    // Per-cube radio link quality (ISR context, except getLinkStats)
+    void updateLinkStats(unsigned retries, SysTime::Ticks now, SysTime::Ticks latency);
+    bool linkIsPoor(SysTime::Ticks now) const;
+    void getLinkStats(_SYSCubeLinkStats &stats) const;
+    void getFrameStats(_SYSCubeFrameStats &stats) const;
+
+    ALWAYS_INLINE uint32_t getPacketCount() const {
+        return linkStats.packets;
+    }
+
     ALWAYS_INLINE SysLFS::Key getCubeRecordKey() const {
         ASSERT(cubeRecord >= SysLFS::kCubeBase);
         ASSERT(cubeRecord < static_cast<SysLFS::Key>(SysLFS::kCubeBase + SysLFS::NUM_PAIRINGS));
@@ -204,18 +231,43 @@ class CubeSlot {
     // Limit on round-trip time
     static const unsigned RTT_DEADLINE_MS = 250;
 
+    // Radio scheduling weights; see radioQuantum()
+    static const unsigned MAX_RADIO_QUANTUM = 4;
+    static const unsigned SHORT_BACKLOG_CHUNKS = 4;
+    static const unsigned STALE_FRAME_MS = 50;
+    static const unsigned FAST_LOAD_RETRY_RATE = 2 << 8;
+    static const unsigned FAST_LOAD_LATENCY_US = 2000;
+
+    // Packets between time syncs, and how many more a due sync may wait
+    // for an empty packet before it's packed into a busy one instead
+    static const unsigned TIME_SYNC_INTERVAL = 1000;
+    static const unsigned TIME_SYNC_MAX_WAIT = 64;
+
     // determine whether pending channel hop value is valid
     static const unsigned INVALID_CHANNEL = 0xff;
 
+    // Link quality averaging and hop policy; see linkIsPoor()
+    static const unsigned LINK_STATS_SHIFT = 3;
+    static const unsigned POOR_LINK_RETRY_RATE = 8 << 8;
+    static const unsigned POOR_LINK_LATENCY_US = 4000;
+    static const unsigned MIN_CHANNEL_DWELL_MS = 2000;
+    static const unsigned PACKET_RATE_WINDOW_MS = 250;
+
     // Large data
     SysTime::Ticks napDeadline;     // Accessed on ISR only, after connect
+    SysTime::Ticks channelSince;    // When we last changed channels
+    SysTime::Ticks rateSince;       // Start of the current packetRate window
     PaintControl paintControl;
 
     // Other aligned data
     _SYSVideoBuffer *vbuf;
+    _SYSVideoShadow *vshadow;
     MotionWriter motionWriter;
     CubeCodec codec;
+    _SYSCubeLinkStats linkStats;
+    uint32_t ratePackets;           // linkStats.packets at rateSince
     uint16_t timeSyncState;
+    uint16_t packetRate;
 
     // Byte variables
     RadioAddress address;
@@ -223,17 +275,32 @@ class CubeSlot {
     RF_ACKType lastACK;
 
     uint8_t pendingChannel;
+    uint8_t timeSyncWait;
+    uint8_t accelThreshold;
     bool ackOptional;
 
     uint16_t calculateTimeSync();
+    uint8_t calculateAccelThreshold();
     unsigned suggestNapTicks();
 
     void queryResponse(const PacketBuffer &packet);
 
+    ALWAYS_INLINE void invalidateVideoShadow() {
+        // We're about to change the cube's VRAM behind the shadow's back
+        if (vshadow)
+            memset(vshadow->valid, 0, sizeof vshadow->valid);
+    }
+
     ALWAYS_INLINE void applyPendingChannelHop() {
         if (pendingChannel < MAX_RF_CHANNEL) {
             address.channel = pendingChannel;
             pendingChannel = INVALID_CHANNEL;
+
+            // Averages from the old channel don't say anything about this one
+            linkStats.hops++;
+            linkStats.retryRate = 0;
+            linkStats.latencyUS = 0;
+            channelSince = SysTime::ticks();
         }
     }
 };
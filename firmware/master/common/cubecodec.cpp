@@ -35,9 +35,14 @@ using namespace Intrinsic;
 
 uint16_t CubeCodec::exemptionBegin;
 uint16_t CubeCodec::exemptionEnd;
+bool CubeCodec::lookahead = true;
 
+static const uint16_t sampleOffsets[] = {
+    RF_VRAM_SAMPLE_0, RF_VRAM_SAMPLE_1, RF_VRAM_SAMPLE_2, RF_VRAM_SAMPLE_3
+};
 
-bool CubeCodec::encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb)
+
+bool CubeCodec::encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb, _SYSVideoShadow *shadow)
 {
     /*
      * Note that we have to sweep that change map as we go. Since
@@ -66,6 +71,11 @@ bool CubeCodec::encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb)
      * we fill up the output packet. We assume that this function
      * begins with space available in the packet buffer.
      *
+     * If we have a shadow of the cube's VRAM, each cm1 word is first
+     * compared against it. Dirty words that the cube already holds are
+     * marked clean without being sent, and every word we do send is
+     * recorded in the shadow.
+     *
      * Returns true iff all VRAM has been flushed. The caller should try
      * to send this additional data, if there's still room in the TX
      * buffer.
@@ -89,55 +99,20 @@ bool CubeCodec::encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb)
         */
         exemptionBegin = exemptionEnd = (uint16_t) -1;
 
-        do {
+        /*
+         * With a change log attached, visit logged words first, in the
+         * order they were written. Anything the log missed is still in
+         * the change maps, and the scan below picks it up.
+         */
+        _SYSVideoChangeLog *log = VRAMChangeLog::find(vb);
+        bool outOfRoom = log && !drainChangeLog(buf, vb, shadow, log, flushed);
+
+        if (!outOfRoom) do {
             uint32_t cm16 = vb->cm16;
             if (!cm16)
                 break;
-
-            uint32_t idx32 = CLZ(cm16) >> 1;
-            ASSERT(idx32 < arraysize(vb->cm1));
-            uint32_t cm1 = vb->cm1[idx32];
-
-            DEBUG_LOG(("CODEC[%p] cm16=%08x cm1[%d]=%08x\n", vb, cm16, idx32, cm1));
-
-            if (cm1) {
-                uint32_t idx1 = CLZ(cm1);
-                uint16_t addr = (idx32 << 5) | idx1;
-
-                ASSERT(addr < _SYS_VRAM_WORDS);
-                CODEC_DEBUG_LOG(("CODEC: -encode addr %04x, data %04x\n", addr, vb->vram.words[addr]));
-
-                if (!encodeVRAMAddr(buf, addr) ||
-                    !encodeVRAMData(buf, vb, VRAM::peek(*vb, addr))) {
-
-                    /*
-                     * We ran out of room to encode. This should be rare,
-                     * happening only when we're near the end of the
-                     * packet buffer AND we're encoding a very large code,
-                     * like a literal 16-bit write plus a literal address
-                     * change.
-                     */
-                    break;
-                }
-
-                // Extend or reset the exemption range.
-                if (addr != exemptionEnd)
-                    exemptionBegin = addr;
-                exemptionEnd = addr + 1;
-
-                cm1 &= ROR(0x7FFFFFFF, idx1);
-                vb->cm1[idx32] = cm1;
-            }
-
-            if (!cm1) {
-                // We operate at a 1:32 resolution, half that of the cm16.
-                // So, clear two bits at a time.
-                cm16 &= ROR(0x3FFFFFFF, idx32 << 1);
-                vb->cm16 = cm16;
-                DEBUG_LOG(("CODEC[%p] cm16=%08x, cm1 cleared\n", vb, cm16));
-                if (!cm16)
-                    flushed = true;
-            }
+            if (!encodeGroup(buf, vb, shadow, CLZ(cm16) >> 1, flushed))
+                break;
         } while (!buf.isFull());
     }
 
@@ -159,6 +134,158 @@ bool CubeCodec::encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb)
     return flushed;
 }
 
+bool CubeCodec::encodeGroup(PacketBuffer &buf, _SYSVideoBuffer *vb,
+    _SYSVideoShadow *shadow, unsigned idx32, bool &flushed)
+{
+    /*
+     * Send the dirty words in one cm1 word, in address order. Returns
+     * false if we ran out of room partway through.
+     */
+
+    ASSERT(idx32 < arraysize(vb->cm1));
+    uint32_t cm1 = vb->cm1[idx32];
+
+    DEBUG_LOG(("CODEC[%p] cm16=%08x cm1[%d]=%08x\n", vb, vb->cm16, idx32, cm1));
+
+    /*
+     * Drain every dirty word in this cm1 word before we go back to
+     * cm16. Userspace can't modify the changemap while we're
+     * encoding, so there's no need to reload cm16 and cm1 and scan
+     * them again for every word. We do still store cm1 after each
+     * word, since deltaSampleAt() treats dirty words as off-limits.
+     */
+
+    if (shadow && cm1) {
+        cm1 &= ~unchangedWords(vb, shadow, idx32, cm1);
+        vb->cm1[idx32] = cm1;
+    }
+
+    bool outOfRoom = false;
+
+    while (cm1) {
+        uint32_t idx1 = CLZ(cm1);
+        uint16_t addr = (idx32 << 5) | idx1;
+
+        ASSERT(addr < _SYS_VRAM_WORDS);
+        CODEC_DEBUG_LOG(("CODEC: -encode addr %04x, data %04x\n", addr, vb->vram.words[addr]));
+
+        if (lookahead)
+            fillGap(vb, addr);
+
+        if (!encodeVRAMAddr(buf, addr) ||
+            !encodeVRAMData(buf, vb, VRAM::peek(*vb, addr))) {
+
+            /*
+             * We ran out of room to encode. This should be rare,
+             * happening only when we're near the end of the
+             * packet buffer AND we're encoding a very large code,
+             * like a literal 16-bit write plus a literal address
+             * change.
+             */
+            outOfRoom = true;
+            break;
+        }
+
+        // Extend or reset the exemption range.
+        if (addr != exemptionEnd)
+            exemptionBegin = addr;
+        exemptionEnd = addr + 1;
+
+        if (shadow) {
+            shadow->vram.words[addr] = VRAM::peek(*vb, addr);
+            shadow->valid[idx32] |= Intrinsic::LZ(idx1);
+        }
+
+        cm1 &= ROR(0x7FFFFFFF, idx1);
+        vb->cm1[idx32] = cm1;
+
+        if (buf.isFull())
+            break;
+    }
+
+    if (!cm1) {
+        // We operate at a 1:32 resolution, half that of the cm16.
+        // So, clear two bits at a time.
+        uint32_t cm16 = vb->cm16 & ROR(0x3FFFFFFF, idx32 << 1);
+        vb->cm16 = cm16;
+        DEBUG_LOG(("CODEC[%p] cm16=%08x, cm1 cleared\n", vb, cm16));
+        if (!cm16)
+            flushed = true;
+    }
+
+    return !outOfRoom;
+}
+
+bool CubeCodec::drainChangeLog(PacketBuffer &buf, _SYSVideoBuffer *vb,
+    _SYSVideoShadow *shadow, _SYSVideoChangeLog *log, bool &flushed)
+{
+    /*
+     * Consume records from a change log. For each record whose word is
+     * still dirty and still holds the logged value, send that word's whole
+     * cm1 group, just as the scan would. Sending the group in address
+     * order keeps the delta and run codes as good as the scan's. Stale
+     * records (the word was rewritten, or already sent) are dropped. We
+     * stop at a locked word, leaving it and everything after it for later.
+     *
+     * If the log overflowed, its records are incomplete. Drop them all;
+     * the change maps still have everything.
+     *
+     * Returns false iff we ran out of room in the packet.
+     */
+
+    uint32_t head = log->head;
+    uint32_t tail = log->tail;
+
+    if (head - tail > _SYS_VIDEO_CHANGE_LOG_SIZE) {
+        log->tail = head;
+        return true;
+    }
+
+    while (tail != head && !buf.isFull()) {
+        const _SYSVideoChange &rec = log->records[tail & (_SYS_VIDEO_CHANGE_LOG_SIZE - 1)];
+        uint16_t addr = rec.addr & _SYS_VRAM_WORD_MASK;
+
+        if ((VRAM::selectCM1(*vb, addr) & VRAM::maskCM1(addr)) &&
+            rec.word == VRAM::peek(*vb, addr)) {
+
+            if (!(vb->cm16 & VRAM::maskCM16(addr)))
+                break;
+            if (!encodeGroup(buf, vb, shadow, addr >> 5, flushed))
+                return false;
+            if (VRAM::selectCM1(*vb, addr) & VRAM::maskCM1(addr))
+                break;
+        }
+
+        log->tail = ++tail;
+    }
+
+    return true;
+}
+
+uint32_t CubeCodec::unchangedWords(const _SYSVideoBuffer *vb,
+    const _SYSVideoShadow *shadow, unsigned idx32, uint32_t cm1)
+{
+    /*
+     * Which of the dirty words in this cm1 word already match what the
+     * cube holds? Only words with a valid shadow entry can match.
+     */
+
+    uint32_t candidates = cm1 & shadow->valid[idx32];
+    uint32_t result = 0;
+
+    while (candidates) {
+        unsigned idx1 = CLZ(candidates);
+        uint32_t bit = Intrinsic::LZ(idx1);
+        uint16_t addr = (idx32 << 5) | idx1;
+
+        if (shadow->vram.words[addr] == VRAM::peek(*vb, addr))
+            result |= bit;
+        candidates ^= bit;
+    }
+
+    return result;
+}
+
 bool CubeCodec::encodeVRAMAddr(PacketBuffer &buf, uint16_t addr)
 {
     ASSERT(addr < _SYS_VRAM_WORDS);
@@ -207,6 +334,16 @@ bool CubeCodec::encodeVRAMData(PacketBuffer &buf, _SYSVideoBuffer *vb, uint16_t
     if (buf.isFull())
         return false;
 
+    if (lookahead) {
+        uint8_t d, s;
+        if (chooseDS(vb, data, d, s)) {
+            encodeDS(d, s);
+            txBits.flush(buf);
+            return true;
+        }
+        return encodeVRAMData(buf, data);
+    }
+
     /*
      * See if we can encode this word as a delta or copy from one of
      * our four sample points.  If we find a copy, that always wins
@@ -468,14 +605,140 @@ void CubeCodec::endPacket(PacketBuffer &buf)
     }
 }
 
+bool CubeCodec::chooseDS(_SYSVideoBuffer *vb, uint16_t data, uint8_t &d, uint8_t &s)
+{
+    /*
+     * Lookahead version of the sample search in encodeVRAMData().
+     *
+     * Rather than taking the first copy or delta we find, compare what
+     * each candidate costs: extending the current run is free until the
+     * run is flushed, a copy code is 4 bits, and a diff code is 8 bits.
+     * Among equally cheap codes, prefer one that the next few dirty words
+     * can extend, so that they become free run extensions as well.
+     *
+     * Returns false if no sample matches; the caller needs a literal.
+     */
+
+    unsigned deltas[arraysize(sampleOffsets)];
+    for (unsigned i = 0; i < arraysize(sampleOffsets); ++i)
+        deltas[i] = deltaSample(vb, data, sampleOffsets[i]);
+
+    if (canExtendRun(1) && deltas[codeS] == codeD) {
+        d = codeD;
+        s = codeS;
+        return true;
+    }
+
+    unsigned bestCost = (unsigned) -1;
+    bool bestContinues = false;
+
+    for (unsigned i = 0; i < arraysize(deltas); ++i) {
+        unsigned cost;
+        if (deltas[i] == RF_VRAM_DIFF_BASE)
+            cost = 4;
+        else if (deltas[i] < 0x10)
+            cost = 8;
+        else
+            continue;
+
+        if (cost > bestCost || (cost == bestCost && bestContinues))
+            continue;
+
+        bool continues = nextWordsContinue(vb, deltas[i], i);
+        if (cost < bestCost || continues) {
+            d = deltas[i];
+            s = i;
+            bestCost = cost;
+            bestContinues = continues;
+        }
+    }
+
+    return bestCost != (unsigned) -1;
+}
+
+bool CubeCodec::nextWordsContinue(_SYSVideoBuffer *vb, uint8_t d, uint8_t s)
+{
+    /*
+     * If we encode the word at codePtr with (d, s), could the following
+     * MIN_LOOKAHEAD_RUN words extend that into a run? A run of just one
+     * word costs as much as the copy code it replaces, and it can steal
+     * the first word of a longer run, so shorter runs don't count.
+     *
+     * Only dirty, unlocked words are worth asking about, since clean ones
+     * will be skipped. Words ahead of each one count as already encoded,
+     * exactly as they will once encodeVRAM() extends the exemption range.
+     */
+
+    uint16_t savedBegin = exemptionBegin;
+    uint16_t savedEnd = exemptionEnd;
+    uint16_t addr = codePtr;
+    bool result = true;
+
+    if (addr != exemptionEnd)
+        exemptionBegin = addr;
+
+    for (unsigned i = 0; i < MIN_LOOKAHEAD_RUN; ++i) {
+        uint16_t next = (addr + 1) & _SYS_VRAM_WORD_MASK;
+        uint16_t ptr = (next - sampleOffsets[s]) & _SYS_VRAM_WORD_MASK;
+        exemptionEnd = addr + 1;
+
+        if (!next ||
+            !(VRAM::selectCM1(*vb, next) & VRAM::maskCM1(next)) ||
+            (vb->lock & VRAM::maskCM16(next)) ||
+            deltaSampleAt(vb, VRAM::peek(*vb, next), ptr) != d) {
+            result = false;
+            break;
+        }
+        addr = next;
+    }
+
+    exemptionBegin = savedBegin;
+    exemptionEnd = savedEnd;
+    return result;
+}
+
+void CubeCodec::fillGap(_SYSVideoBuffer *vb, uint16_t addr)
+{
+    /*
+     * Lookahead alternative to an address skip. If every clean word between
+     * codePtr and 'addr' would extend the current run, resending them costs
+     * nothing. A skip costs at least 8 bits, and it forces the run to be
+     * flushed. Clean words already match the cube's VRAM, so resending
+     * them is harmless.
+     */
+
+    uint16_t gap = (addr - codePtr) & _SYS_VRAM_WORD_MASK;
+
+    if (gap == 0 || gap > MAX_GAP_FILL || !canExtendRun(gap))
+        return;
+
+    for (unsigned i = 0; i < gap; ++i) {
+        uint16_t ptr = (codePtr + i) & _SYS_VRAM_WORD_MASK;
+        uint16_t sample = (ptr - sampleOffsets[codeS]) & _SYS_VRAM_WORD_MASK;
+
+        if ((vb->lock & VRAM::maskCM16(ptr)) ||
+            deltaSampleAt(vb, VRAM::peek(*vb, ptr), sample) != codeD)
+            return;
+    }
+
+    CODEC_DEBUG_LOG(("CODEC: fill gap of %d words at %04x\n", gap, codePtr));
+
+    for (unsigned i = 0; i < gap; ++i)
+        encodeDS(codeD, codeS);
+
+    ASSERT(codePtr == addr);
+}
+
 unsigned CubeCodec::deltaSample(_SYSVideoBuffer *vb, uint16_t data, uint16_t offset)
 {
-    uint16_t ptr = codePtr - offset;
-    ptr &= _SYS_VRAM_WORD_MASK;
+    return deltaSampleAt(vb, data, (codePtr - offset) & _SYS_VRAM_WORD_MASK);
+}
 
+unsigned CubeCodec::deltaSampleAt(_SYSVideoBuffer *vb, uint16_t data, uint16_t ptr)
+{
     CODEC_DEBUG_LOG(("CODEC: deltaSample(%04x, %03x) "
         "lock=%08x mask=%08x codePtr=%03x\n",
-        data, offset, vb->lock, VRAM::maskCM16(ptr), codePtr));
+        data, ptr, vb->lock, VRAM::maskCM16(ptr), codePtr));
 
     if ((vb->lock & VRAM::maskCM16(ptr)) ||
         (VRAM::selectCM1(*vb, ptr) & VRAM::maskCM1(ptr))) {
@@ -508,31 +771,37 @@ unsigned CubeCodec::deltaSample(_SYSVideoBuffer *vb, uint16_t data, uint16_t off
 
     CODEC_DEBUG_LOG(("CODEC: deltaSample(%04x, %03x) "
         "sample=%04x dI=%04x sI=%04x res=%d\n",
-        data, offset, sample, dI, sI, result));
+        data, ptr, sample, dI, sI, result));
 
     return result;
 }
 
-void CubeCodec::escTimeSync(PacketBuffer &buf, uint16_t rawTimer)
+bool CubeCodec::escTimeSync(PacketBuffer &buf, uint16_t rawTimer, uint8_t accelThreshold)
 {
     /*
-     * Timer synchronization escape. This sends the sync escape,
-     * plus a dummy nybble to force a flush if necessary. We then
-     * send the new raw 13-bit time synchronization value. This
-     * must be the last code in the packet.
+     * Timer synchronization escape. If the buffer has room, this sends
+     * the sync escape, plus a dummy nybble to force a flush if necessary.
+     * We then send the new raw 13-bit time synchronization value, and
+     * the cube's accelerometer threshold. This must be the last code in
+     * the packet.
      */
 
-    ASSERT(txBits.hasRoomForFlush(buf, 12 + 2*8));
+    if (txBits.hasRoomForFlush(buf, 12 + 3*8)) {
 
-    txBits.append(0xF78, 12);
-    txBits.flush(buf);
-    txBits.init();
+        txBits.append(0xF78, 12);
+        txBits.flush(buf);
+        txBits.init();
 
-    buf.append(rawTimer & 0x1F);    // Low 5 bits
-    buf.append(rawTimer >> 5);      // High 8 bits
+        buf.append(rawTimer & 0x1F);    // Low 5 bits
+        buf.append(rawTimer >> 5);      // High 8 bits
+        buf.append(accelThreshold);
 
-    if (!buf.isFull())
-        stateReset();
+        if (!buf.isFull())
+            stateReset();
+
+        return true;
+    }
+    return false;
 }
 
 bool CubeCodec::escRequestAck(PacketBuffer &buf)
@@ -647,6 +916,16 @@ void CubeCodec::encodeShutdown(PacketBuffer &buf)
         _SYS_VM_SLEEP | (_SYS_VF_CONTINUOUS << 8));
 }
 
+const uint16_t CubeCodec::stippleWords[] = {
+    offsetof(_SYSVideoRAM, fb) / 2,
+    offsetof(_SYSVideoRAM, colormap[2]) / 2,
+    offsetof(_SYSVideoRAM, stamp_pitch) / 2,
+    offsetof(_SYSVideoRAM, stamp_x) / 2,
+    offsetof(_SYSVideoRAM, stamp_key) / 2,
+    offsetof(_SYSVideoRAM, first_line) / 2,
+    offsetof(_SYSVideoRAM, mode) / 2,
+};
+
 void CubeCodec::encodeStipple(PacketBuffer &buf, _SYSVideoBuffer *vbuf)
 {
     /* 
@@ -669,11 +948,11 @@ void CubeCodec::encodeStipple(PacketBuffer &buf, _SYSVideoBuffer *vbuf)
         modeFlagsWord |= _SYS_VF_CONTINUOUS << 8;
     }
 
-    encodePoke(buf, offsetof(_SYSVideoRAM, fb)/2,          0x0220);
-    encodePoke(buf, offsetof(_SYSVideoRAM, colormap[2])/2, 0x0000);
-    encodePoke(buf, offsetof(_SYSVideoRAM, stamp_pitch)/2, 0x0201);
-    encodePoke(buf, offsetof(_SYSVideoRAM, stamp_x)/2,     0x8000);
-    encodePoke(buf, offsetof(_SYSVideoRAM, stamp_key)/2,   0x0000);
-    encodePoke(buf, offsetof(_SYSVideoRAM, first_line)/2,  0x8000);
-    encodePoke(buf, offsetof(_SYSVideoRAM, mode)/2,        modeFlagsWord);
+    // Same order as stippleWords[]
+    const uint16_t data[NUM_STIPPLE_WORDS] = {
+        0x0220, 0x0000, 0x0201, 0x8000, 0x0000, 0x8000, uint16_t(modeFlagsWord)
+    };
+
+    for (unsigned i = 0; i != NUM_STIPPLE_WORDS; ++i)
+        encodePoke(buf, stippleWords[i], data[i]);
 }
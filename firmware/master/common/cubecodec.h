@@ -106,6 +106,15 @@ class BitBuffer {
 /**
  * Compression codec, for sending compressed VRAM data to cubes.
  * This implements the protocol described in protocol.h.
+ *
+ * Each CubeSlot owns a codec, and the stream it produces is only
+ * meaningful to that one cube. The decoder's state (write pointer,
+ * sample history, pending RLE and flash escapes) lives in the cube and
+ * differs from cube to cube. Also, the cube radio only listens on its
+ * own auto-acknowledged pipe. So even when several cubes are sent
+ * identical VRAM, we can't broadcast it once. That would take a second
+ * receive pipe without acks in the cube firmware, and a way to bring
+ * every receiver's decoder state into agreement first.
  */
 
 class CubeCodec {
@@ -116,8 +125,8 @@ class CubeCodec {
         txBits.init();
     }
 
-    // Returns 'true' if finished.
-    bool encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb);
+    // Returns 'true' if finished. The shadow is optional.
+    bool encodeVRAM(PacketBuffer &buf, _SYSVideoBuffer *vb, _SYSVideoShadow *shadow = 0);
 
     bool encodeVRAMAddr(PacketBuffer &buf, uint16_t addr);
     bool encodeVRAMData(PacketBuffer &buf, uint16_t data);
@@ -126,14 +135,26 @@ class CubeCodec {
     void encodeShutdown(PacketBuffer &buf);
     void encodeStipple(PacketBuffer &buf, _SYSVideoBuffer *vbuf);
 
+    // VRAM word addresses that encodeStipple() overwrites on the cube
+    static const unsigned NUM_STIPPLE_WORDS = 7;
+    static const uint16_t stippleWords[NUM_STIPPLE_WORDS];
+
     bool encodePoke(PacketBuffer &buf, uint16_t addr, uint16_t data) {
         return encodeVRAMAddr(buf, addr) && encodeVRAMData(buf, data);
     }
 
     void endPacket(PacketBuffer &buf);
 
+    /**
+     * Lookahead encoding. When set, the encoder considers the cost of each
+     * candidate code across neighbouring words instead of taking the first
+     * acceptable one. Can be cleared to fall back on the purely greedy
+     * encoder when radio ISR time is tight.
+     */
+    static bool lookahead;
+
     // Escape codes (Ends the packet)
-    void escTimeSync(PacketBuffer &buf, uint16_t rawTimer);
+    bool escTimeSync(PacketBuffer &buf, uint16_t rawTimer, uint8_t accelThreshold);
     bool escFlash(PacketBuffer &buf);
     bool escRequestAck(PacketBuffer &buf);
     bool escRadioNap(PacketBuffer &buf, uint16_t duration);
@@ -154,12 +175,34 @@ class CubeCodec {
     static uint16_t exemptionBegin;    /// Lock exemption range, first address
     static uint16_t exemptionEnd;      /// Lock exemption range, last address
 
+    // Longest run of clean words fillGap() will resend instead of skipping
+    static const unsigned MAX_GAP_FILL = 8;
+
+    // Shortest run that makes chooseDS() prefer one code over an equal one
+    static const unsigned MIN_LOOKAHEAD_RUN = 2;
+
     ALWAYS_INLINE void codePtrAdd(uint16_t words) {
         ASSERT(codePtr < _SYS_VRAM_WORDS);
         codePtr = (codePtr + words) & _SYS_VRAM_WORD_MASK;
     }
 
+    // Can the current copy/diff code be repeated 'words' more times?
+    ALWAYS_INLINE bool canExtendRun(unsigned words) const {
+        return codeS < 4 && codeD < 0x10 &&
+            codeRuns + words <= RF_VRAM_MAX_RUN;
+    }
+
     unsigned deltaSample(_SYSVideoBuffer *vb, uint16_t data, uint16_t offset);
+    unsigned deltaSampleAt(_SYSVideoBuffer *vb, uint16_t data, uint16_t ptr);
+    bool chooseDS(_SYSVideoBuffer *vb, uint16_t data, uint8_t &d, uint8_t &s);
+    bool nextWordsContinue(_SYSVideoBuffer *vb, uint8_t d, uint8_t s);
+    void fillGap(_SYSVideoBuffer *vb, uint16_t addr);
+    bool encodeGroup(PacketBuffer &buf, _SYSVideoBuffer *vb,
+        _SYSVideoShadow *shadow, unsigned idx32, bool &flushed);
+    bool drainChangeLog(PacketBuffer &buf, _SYSVideoBuffer *vb,
+        _SYSVideoShadow *shadow, _SYSVideoChangeLog *log, bool &flushed);
+    static uint32_t unchangedWords(const _SYSVideoBuffer *vb,
+        const _SYSVideoShadow *shadow, unsigned idx32, uint32_t cm1);
 
     ALWAYS_INLINE void appendDS(uint8_t d, uint8_t s) {
         if (d == RF_VRAM_DIFF_BASE) {
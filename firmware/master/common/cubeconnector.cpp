@@ -46,6 +46,7 @@ RadioAddress CubeConnector::reconnectAddr;
 
 SysLFS::PairingIDRecord CubeConnector::savedPairingID;
 SysLFS::PairingMRURecord CubeConnector::savedPairingMRU;
+SysLFS::PairingHintRecord CubeConnector::savedPairingHints;
 BitVector<SysLFS::NUM_PAIRINGS> CubeConnector::reconnectQueue;
 BitVector<SysLFS::NUM_PAIRINGS> CubeConnector::recycleQueue;
 BitVector<CubeConnector::NUM_WORK_ITEMS> CubeConnector::taskWork;
@@ -55,6 +56,7 @@ uint8_t CubeConnector::neighborKey;
 uint8_t CubeConnector::txState;
 uint8_t CubeConnector::rxState;
 uint8_t CubeConnector::pairingPacketCounter;
+bool CubeConnector::reconnectAltFirst;
 uint8_t CubeConnector::hwid[HWID_LEN];
 _SYSCubeID CubeConnector::cubeID;
 SysLFS::Key CubeConnector::cubeRecord;
@@ -75,10 +77,16 @@ void CubeConnector::init()
     // Load saved pairing HWIDs from SysLFS
     savedPairingID.load();
     savedPairingMRU.load();
+    savedPairingHints.load();
 
-    // State machine init
+    /*
+     * State machine init. Poke every cube we know about before we spend
+     * any time looking for new ones; after power-on or resume, most of
+     * the cubes around are ones we've already paired.
+     */
     enableReconnect();
-    txState = PairingFirstContact;
+    refillReconnectQueue();
+    txState = ReconnectFirstContact;
 }
 
 void CubeConnector::onSysLFSInvalidated()
@@ -87,6 +95,7 @@ void CubeConnector::onSysLFSInvalidated()
     // these should now be full of invalid entries.
     savedPairingID.load();
     savedPairingMRU.load();
+    savedPairingHints.load();
 
     // we can't assume any pairing data is still valid,
     // so we disconnect all connected ubes since they're no longer paired.
@@ -141,7 +150,11 @@ void CubeConnector::task()
                 break;
 
             case TaskSavePairingMRU:
-                SysLFS::writeObject(SysLFS::kPairingMRU, savedPairingMRU);
+                SysLFS::writeObjectDeferred(SysLFS::kPairingMRU, savedPairingMRU);
+                break;
+
+            case TaskSavePairingHints:
+                SysLFS::writeObjectDeferred(SysLFS::kPairingHints, savedPairingHints);
                 break;
 
             case TaskRecyclePairings:
@@ -282,6 +295,11 @@ bool CubeConnector::popReconnectQueue()
     /*
      * Extract the next reconnectable cube from our queue, and use it to
      * set the current hwid and reconnectAddr.
+     *
+     * We go in most-recently-used order, since those cubes are the most
+     * likely to be around, and skip any that connected since the queue
+     * was filled. The first ping goes out on whichever channel the cube
+     * last answered on.
      */
 
     // Reconnection can be disabled in Siftulator. This is used by cube firmware unit tests.
@@ -300,17 +318,52 @@ bool CubeConnector::popReconnectQueue()
         return false;
 
     unsigned index;
-    if (!reconnectQueue.clearFirst(index))
-        return false;
+    for (unsigned i = 0;; ++i) {
+        if (i == SysLFS::NUM_PAIRINGS) {
+            // MRU list out of sync with the queue? Take whatever's left.
+            if (!reconnectQueue.clearFirst(index))
+                return false;
+            break;
+        }
+        index = savedPairingMRU.rank[i];
+        if (index < SysLFS::NUM_PAIRINGS && reconnectQueue.test(index)) {
+            reconnectQueue.clear(index);
+            if (!CubeSlots::pairConnected.test(index))
+                break;
+        }
+    }
 
     uint64_t hwid64 = savedPairingID.hwid[index];
     memcpy(hwid, &hwid64, sizeof hwid);
     RadioAddrFactory::fromHardwareID(reconnectAddr, hwid64);
     cubeRecord = SysLFS::Key(SysLFS::kCubeBase + index);
 
+    uint8_t hint = savedPairingHints.channel[index];
+    reconnectAltFirst = hint != SysLFS::PairingHintRecord::UNKNOWN
+        && hint != reconnectAddr.channel;
+    if (reconnectAltFirst)
+        RadioAddrFactory::convertPrimaryToAlternateChannel(reconnectAddr, hwid[0]);
+
     return true;
 }
 
+void CubeConnector::updateChannelHint()
+{
+    /*
+     * The cube we're reconnecting just answered on reconnectAddr.
+     * Remember that channel for next time.
+     */
+
+    unsigned index = cubeRecord - SysLFS::kCubeBase;
+    ASSERT(index < SysLFS::NUM_PAIRINGS);
+
+    if (savedPairingHints.channel[index] != reconnectAddr.channel) {
+        savedPairingHints.channel[index] = reconnectAddr.channel;
+        taskWork.atomicMark(TaskSavePairingHints);
+        Tasks::trigger(Tasks::CubeConnector);
+    }
+}
+
 bool CubeConnector::hwidIsPaired(const uint8_t *id)
 {
     for (int i = SysLFS::NUM_PAIRINGS - 1; i >= 0; --i) {
@@ -348,6 +401,12 @@ void CubeConnector::newCubeRecord()
             taskWork.atomicMark(TaskSavePairingID);
             Tasks::trigger(Tasks::CubeConnector);
 
+            // Whatever channel the old cube used means nothing now
+            if (savedPairingHints.channel[index] != SysLFS::PairingHintRecord::UNKNOWN) {
+                savedPairingHints.channel[index] = SysLFS::PairingHintRecord::UNKNOWN;
+                taskWork.atomicMark(TaskSavePairingHints);
+            }
+
             break;
         }
     }
@@ -406,7 +465,7 @@ void CubeConnector::radioProduce(PacketTransmission &tx)
          * cube, and waking that cube up from sleep.
          *
          * We toggle between a primary and an alternate channel for each
-         * reconnectable address.
+         * reconnectable address, starting with the one it last used.
          */
         case ReconnectFirstContact:
         case_ReconnectFirstContact:
@@ -423,7 +482,11 @@ void CubeConnector::radioProduce(PacketTransmission &tx)
 
         case ReconnectAltFirstContact:
             if (reconnectEnabled) {
-                RadioAddrFactory::convertPrimaryToAlternateChannel(reconnectAddr, hwid[0]);
+                if (reconnectAltFirst)
+                    RadioAddrFactory::fromHardwareID(reconnectAddr,
+                        savedPairingID.hwid[cubeRecord - SysLFS::kCubeBase]);
+                else
+                    RadioAddrFactory::convertPrimaryToAlternateChannel(reconnectAddr, hwid[0]);
                 tx.dest = &reconnectAddr;
                 tx.packet.len = 1;
                 tx.packet.bytes[0] = 0xff;
@@ -562,6 +625,7 @@ void CubeConnector::radioAcknowledge(const PacketBuffer &packet)
                 #endif
                 && !memcmp(hwid, ack->hwid, sizeof hwid))
             {
+                updateChannelHint();
                 txState = ReconnectBeginHop;
             }
             break;
@@ -588,8 +652,13 @@ void CubeConnector::radioAcknowledge(const PacketBuffer &packet)
                  * in the cube's FIFO. Send another request, and keep waiting.
                  */
             } else {
-                // Success or fail, we go back to the first contact state
-                txState = PairingFirstContact;
+                /*
+                 * Success or fail, move on to the next cube in the
+                 * reconnect queue without waiting for another pairing
+                 * ping. Once the queue is empty, that falls through to
+                 * PairingFirstContact.
+                 */
+                txState = ReconnectFirstContact;
 
                 if (!memcmp(hwid, ack->hwid, sizeof hwid)) {
                     // HWID matched!
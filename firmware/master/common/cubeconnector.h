@@ -92,6 +92,7 @@ private:
         TaskRecyclePairings,
         TaskSavePairingID,
         TaskSavePairingMRU,
+        TaskSavePairingHints,
 
         NUM_WORK_ITEMS,         // Must be last
     };
@@ -104,6 +105,7 @@ private:
 
     static SysLFS::PairingIDRecord savedPairingID;
     static SysLFS::PairingMRURecord savedPairingMRU;
+    static SysLFS::PairingHintRecord savedPairingHints;
     static BitVector<SysLFS::NUM_PAIRINGS> reconnectQueue;
     static BitVector<SysLFS::NUM_PAIRINGS> recycleQueue;
     static BitVector<NUM_WORK_ITEMS> taskWork;
@@ -115,6 +117,7 @@ private:
     static uint8_t txState;
     static uint8_t rxState;
     static uint8_t pairingPacketCounter;
+    static bool reconnectAltFirst;
     static uint8_t hwid[HWID_LEN];
     static _SYSCubeID cubeID;
     static SysLFS::Key cubeRecord;
@@ -123,6 +126,7 @@ private:
     static void nextNeighborKey();
     static void refillReconnectQueue();
     static bool popReconnectQueue();
+    static void updateChannelHint();
     static void newCubeRecord();
     static bool hwidIsPaired(const uint8_t *id);
 
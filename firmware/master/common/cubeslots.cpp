@@ -180,8 +180,13 @@ void CubeSlots::refreshCubes(_SYSCubeIDVector cv)
 {
     /*
      * For a set of cubes that we've monkeyed with behind the back of whatever
-     * userspace app is running, go through and zap the change maps on their
-     * video buffers, if any, and queue up REFRESH events for userspace to handle.
+     * userspace app is running, resend whatever we overwrote from their video
+     * buffers, if any, and queue up REFRESH events for userspace to handle.
+     *
+     * The video buffer is still an exact copy of what userspace wants on the
+     * cube, so we don't need to resend all of it. The stipple only touched a
+     * few words, and UICoordinator::detach() already marked anything a system
+     * UI drew. Repainting from REFRESH then costs only the words that change.
      */
 
     while (cv) {
@@ -190,7 +195,9 @@ void CubeSlots::refreshCubes(_SYSCubeIDVector cv)
 
         _SYSVideoBuffer *vbuf = CubeSlots::instances[id].getVBuf();
         if (vbuf) {
-            VRAM::init(*vbuf);
+            vbuf->flags = VRAM::DEFAULT_LOCK_FLAGS;
+            for (unsigned i = 0; i != CubeCodec::NUM_STIPPLE_WORDS; ++i)
+                VRAM::markDirty(*vbuf, CubeCodec::stippleWords[i]);
         }
 
         Event::setCubePending(Event::PID_CUBE_REFRESH, id);
@@ -0,0 +1,170 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker host tools
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ELF_SYMBOL_INDEX_H
+#define ELF_SYMBOL_INDEX_H
+
+#include "elfdefs.h"
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+/**
+ * Address-to-symbol lookup for an ELF symbol table, shared by the host
+ * tools (Siftulator and swiss). Never built into firmware.
+ *
+ * The table is built once, sorted by start address, with names already
+ * read and demangled, so each lookup is a binary search instead of a scan
+ * over .symtab. Lookups match the old linear scan exactly: the symbol
+ * containing the address with the highest start address wins, and ties
+ * go to the symbol that comes first in .symtab.
+ */
+class ELFSymbolIndex {
+public:
+    struct Entry {
+        Elf::Symbol symbol;     // st_value has its Thumb bit stripped
+        uint32_t order;         // Index in .symtab, for tie-breaking
+        uint64_t maxEnd;        // Highest end address of this and all prior entries
+        std::string name;
+        std::string demangledName;
+
+        bool operator< (const Entry &other) const {
+            if (symbol.st_value != other.symbol.st_value)
+                return symbol.st_value < other.symbol.st_value;
+            return order < other.order;
+        }
+
+        bool contains(uint32_t address) const {
+            return address - symbol.st_value < symbol.st_size;
+        }
+
+        // Cheap swap for sorting, and disambiguates from swap() in macros.h
+        friend void swap(Entry &a, Entry &b) {
+            std::swap(a.symbol, b.symbol);
+            std::swap(a.order, b.order);
+            std::swap(a.maxEnd, b.maxEnd);
+            a.name.swap(b.name);
+            a.demangledName.swap(b.demangledName);
+        }
+    };
+
+    void clear() {
+        entries.clear();
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    /**
+     * Index 'count' symbols, with names from a string table of 'strSize'
+     * bytes. Symbols with no size can never contain an address, so they
+     * are left out.
+     */
+    void init(const Elf::Symbol *table, unsigned count,
+        const char *strTab, uint32_t strSize)
+    {
+        entries.clear();
+
+        for (unsigned i = 0; i < count; ++i) {
+            const Elf::Symbol &sym = table[i];
+            if (!sym.st_size)
+                continue;
+
+            entries.push_back(Entry());
+            Entry &e = entries.back();
+            e.symbol = sym;
+            e.order = i;
+
+            // Strip the Thumb bit from function symbols.
+            if ((sym.st_info & 0xF) == Elf::STT_FUNC)
+                e.symbol.st_value &= ~1;
+
+            if (strTab && sym.st_name < strSize) {
+                const char *str = strTab + sym.st_name;
+                e.name.assign(str, strnlen(str, strSize - sym.st_name));
+            }
+            e.demangledName = e.name;
+            demangle(e.demangledName);
+        }
+
+        std::sort(entries.begin(), entries.end());
+
+        uint64_t maxEnd = 0;
+        for (unsigned i = 0, e = entries.size(); i != e; ++i) {
+            const Elf::Symbol &sym = entries[i].symbol;
+            maxEnd = std::max<uint64_t>(maxEnd, uint64_t(sym.st_value) + sym.st_size);
+            entries[i].maxEnd = maxEnd;
+        }
+    }
+
+    /// The nearest symbol containing 'address', or NULL if none does.
+    const Entry *find(uint32_t address) const {
+        /*
+         * Start at the last entry beginning at or below 'address', and walk
+         * back until no earlier symbol can reach it. Symbols rarely nest,
+         * so this is almost always one or two steps.
+         */
+
+        Entry key;
+        key.symbol.st_value = address;
+        key.order = uint32_t(-1);
+        std::vector<Entry>::const_iterator I =
+            std::upper_bound(entries.begin(), entries.end(), key);
+
+        const Entry *best = 0;
+        while (I != entries.begin()) {
+            --I;
+            if (I->maxEnd <= address)
+                break;
+            if (best && I->symbol.st_value != best->symbol.st_value)
+                break;
+            if (I->contains(address))
+                best = &*I;
+        }
+
+        return best;
+    }
+
+    static void demangle(std::string &name) {
+        // This uses the demangler built into GCC's libstdc++.
+        // It uses the same name mangling style as clang.
+
+        int status;
+        char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+        if (status == 0) {
+            name = result;
+            free(result);
+        }
+    }
+
+private:
+    std::vector<Entry> entries;
+};
+
+#endif // ELF_SYMBOL_INDEX_H
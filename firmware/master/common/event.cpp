@@ -30,7 +30,12 @@
 #include "pause.h"
 #include "idletimeout.h"
 
+#ifdef SIFTEO_SIMULATOR
+#   include "latencytracer.h"
+#endif
+
 Event::VectorInfo Event::vectors[_SYS_NUM_VECTORS];
+BitVector<_SYS_NUM_VECTORS> Event::batched;
 Event::Params Event::params[NUM_PIDS];
 BitVector<Event::NUM_PIDS> Event::pending;
 
@@ -38,6 +43,7 @@ BitVector<Event::NUM_PIDS> Event::pending;
 void Event::clearVectors()
 {
     memset(vectors, 0, sizeof vectors);
+    batched.clear();
 }
 
 void Event::dispatch()
@@ -72,6 +78,7 @@ void Event::dispatch()
 
             case PID_BASE_TRACKER:              if (dispatchBasePID(pid, _SYS_BASE_TRACKER              )) return; else break;
             case PID_BASE_GAME_MENU:            if (dispatchBasePID(pid, _SYS_BASE_GAME_MENU            )) return; else break;
+            case PID_BASE_ASSETDONE:            if (dispatchBasePID(pid, _SYS_BASE_ASSETDONE           )) return; else break;
             case PID_BASE_VOLUME_DELETE:        if (dispatchBasePID(pid, _SYS_BASE_VOLUME_DELETE        )) return; else break;
             case PID_BASE_VOLUME_COMMIT:        if (dispatchBasePID(pid, _SYS_BASE_VOLUME_COMMIT        )) return; else break;
             case PID_BASE_BT_DISCONNECT:        if (dispatchBasePID(pid, _SYS_BASE_BT_DISCONNECT        )) return; else break;
@@ -212,17 +219,28 @@ bool Event::dispatchCubePID(PriorityID pid, _SYSCubeID cid)
      * before the switch.
      */
 
-    Atomic::And(params[pid].cubesPending, ~Intrinsic::LZ(cid));
+    _SYSVectorID vid;
     switch (pid) {
-        case PID_CUBE_REFRESH:      return callCubeEvent(_SYS_CUBE_REFRESH, cid);
-        case PID_CUBE_TOUCH:        return callCubeEvent(_SYS_CUBE_TOUCH, cid);
-        case PID_CUBE_ASSETDONE:    return callCubeEvent(_SYS_CUBE_ASSETDONE, cid);
-        case PID_CUBE_BATTERY:      return callCubeEvent(_SYS_CUBE_BATTERY, cid);
-        case PID_CUBE_ACCELCHANGE:  return callCubeEvent(_SYS_CUBE_ACCELCHANGE, cid);
-        default:                    ASSERT(0);
+        case PID_CUBE_REFRESH:       vid = _SYS_CUBE_REFRESH; break;
+        case PID_CUBE_TOUCH:         vid = _SYS_CUBE_TOUCH; break;
+        case PID_CUBE_ASSETDONE:     vid = _SYS_CUBE_ASSETDONE; break;
+        case PID_CUBE_BATTERY:       vid = _SYS_CUBE_BATTERY; break;
+        case PID_CUBE_ACCELCHANGE:   vid = _SYS_CUBE_ACCELCHANGE; break;
+        case PID_CUBE_ASSETPROGRESS: vid = _SYS_CUBE_ASSETPROGRESS; break;
+        default:                     ASSERT(0); return false;
     }
 
-    return false;
+    #ifdef SIFTEO_SIMULATOR
+    if (vid == _SYS_CUBE_TOUCH || vid == _SYS_CUBE_ACCELCHANGE)
+        LatencyTracer::dispatch(batched.test(vid) ? params[pid].cubesPending
+            : Intrinsic::LZ(cid), vid == _SYS_CUBE_TOUCH);
+    #endif
+
+    if (batched.test(vid))
+        return callCubeBatchEvent(vid, pid);
+
+    Atomic::And(params[pid].cubesPending, ~Intrinsic::LZ(cid));
+    return callCubeEvent(vid, cid);
 }
 
 ALWAYS_INLINE void Event::cubeEventsClear(PriorityID pid)
@@ -259,11 +277,38 @@ void Event::setCubePending(PriorityID pid, _SYSCubeID cid)
     pending.atomicMark(pid);
 }
 
-void Event::setVector(_SYSVectorID vid, void *handler, void *context)
+void Event::setVector(_SYSVectorID vid, void *handler, void *context, bool batch)
 {
     ASSERT(vid < _SYS_NUM_VECTORS);
+    ASSERT(!batch || vectorSupportsBatch(vid));
     vectors[vid].handler = reinterpret_cast<reg_t>(handler);
     vectors[vid].context = reinterpret_cast<reg_t>(context);
+
+    if (batch)
+        batched.mark(vid);
+    else
+        batched.clear(vid);
+}
+
+bool Event::vectorSupportsBatch(_SYSVectorID vid)
+{
+    /*
+     * Only the one-step cube events can be batched. Connect, disconnect
+     * and neighbor events are produced by state machines that need to
+     * run once per cube.
+     */
+
+    switch (vid) {
+        case _SYS_CUBE_REFRESH:
+        case _SYS_CUBE_TOUCH:
+        case _SYS_CUBE_ASSETDONE:
+        case _SYS_CUBE_BATTERY:
+        case _SYS_CUBE_ACCELCHANGE:
+        case _SYS_CUBE_ASSETPROGRESS:
+            return true;
+        default:
+            return false;
+    }
 }
 
 void *Event::getVectorHandler(_SYSVectorID vid)
@@ -305,6 +350,29 @@ bool Event::callCubeEvent(_SYSVectorID vid, _SYSCubeID cid)
     return false;
 }
 
+bool Event::callCubeBatchEvent(_SYSVectorID vid, PriorityID pid)
+{
+    /*
+     * Deliver every cube that's pending for this PID in one handler call.
+     * The handler gets a _SYSCubeIDVector in place of a single cube ID.
+     * Cubes that become pending after we take the snapshot stay pending,
+     * and go out with the next call.
+     */
+
+    ASSERT(vid < _SYS_NUM_VECTORS);
+    VectorInfo &vi = vectors[vid];
+
+    _SYSCubeIDVector cubes = params[pid].cubesPending;
+    Atomic::And(params[pid].cubesPending, ~cubes);
+
+    if (vi.handler && cubes) {
+        SvmRuntime::sendEvent(vi.handler, vi.context, cubes);
+        return true;
+    }
+
+    return false;
+}
+
 bool Event::callNeighborEvent(_SYSVectorID vid, _SYSCubeID c0, _SYSSideID s0, _SYSCubeID c1, _SYSSideID s1)
 {
     ASSERT(vid < _SYS_NUM_VECTORS);
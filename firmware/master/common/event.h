@@ -70,6 +70,7 @@ class Event {
         // System state events (lower than refresh)
         PID_BASE_GAME_MENU,
         PID_CUBE_ASSETDONE,
+        PID_BASE_ASSETDONE,
 
         // Filesystem events (delete before commit)
         PID_BASE_VOLUME_DELETE,
@@ -94,6 +95,7 @@ class Event {
         // High-bandwidth / low-priority events
         PID_CUBE_BATTERY,
         PID_CUBE_ACCELCHANGE,
+        PID_CUBE_ASSETPROGRESS,
 
         // Must be last
         NUM_PIDS
@@ -107,7 +109,8 @@ class Event {
     static void setBasePending(PriorityID pid, uint32_t param=0);
     static void setCubePending(PriorityID pid, _SYSCubeID cid);
 
-    static void setVector(_SYSVectorID vid, void *handler, void *context);
+    static void setVector(_SYSVectorID vid, void *handler, void *context, bool batch=false);
+    static bool vectorSupportsBatch(_SYSVectorID vid);
     static void *getVectorHandler(_SYSVectorID vid);
     static void *getVectorContext(_SYSVectorID vid);
 
@@ -126,12 +129,14 @@ class Event {
 
     static bool callBaseEvent(_SYSVectorID vid, uint32_t param);
     static bool callCubeEvent(_SYSVectorID vid, _SYSCubeID cid);
+    static bool callCubeBatchEvent(_SYSVectorID vid, PriorityID pid);
 
     static bool dispatchCubePID(PriorityID pid, _SYSCubeID cid);
     static bool dispatchBasePID(PriorityID pid, _SYSVectorID vid);
     static void cubeEventsClear(PriorityID pid);
 
     static VectorInfo vectors[_SYS_NUM_VECTORS];
+    static BitVector<_SYS_NUM_VECTORS> batched;
     static Params params[NUM_PIDS];
     static BitVector<NUM_PIDS> pending;
 };
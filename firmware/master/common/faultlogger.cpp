@@ -158,6 +158,45 @@ unsigned FaultLogger::buildFaultRecord(uint8_t *buffer)
     }
 }
 
+unsigned FaultLogger::countRepeats(SysLFS::Key lastKey, uint8_t *buffer)
+{
+    /*
+     * If the last fault we logged was this same fault, return the number
+     * of times it's been seen so far. Otherwise, zero. 'buffer' is only
+     * scratch space here.
+     */
+
+    if (header.recordType != SysLFS::kFaultSVM)
+        return 0;
+
+    int size = SysLFS::read(lastKey, buffer, FlashLFSIndexRecord::MAX_SIZE);
+    const SysLFS::FaultHeader *last = (const SysLFS::FaultHeader*) buffer;
+
+    if (size < int(sizeof *last) ||
+        last->runningVolume != header.runningVolume ||
+        last->code != header.code)
+        return 0;
+
+    switch (last->recordType) {
+
+    case SysLFS::kFaultSVM: {
+        const SysLFS::FaultRecordSvm *r = (const SysLFS::FaultRecordSvm*) buffer;
+        if (size >= int(sizeof *r) && r->regs.pc == regs.pc)
+            return 1;
+        break;
+    }
+
+    case SysLFS::kFaultRepeat: {
+        const SysLFS::FaultRecordRepeat *r = (const SysLFS::FaultRecordRepeat*) buffer;
+        if (size >= int(sizeof *r) && r->pc == regs.pc)
+            return r->count;
+        break;
+    }
+    }
+
+    return 0;
+}
+
 void FaultLogger::buildFaultRecord(SysLFS::FaultRecordSvm *buffer)
 {
     memset(buffer, SENTINEL, sizeof *buffer);
@@ -228,15 +267,6 @@ void FaultLogger::task()
     SysLFS::Key lastKey = lastHeader.readLatest();
     SysLFS::Key key;
 
-    if (lastKey == SysLFS::kEnd) {
-        // First fault in this filesystem
-        key = SysLFS::kFaultBase;
-        header.reference = 1;
-    } else {
-        key = SysLFS::FaultHeader::nextKey(lastKey);
-        header.reference = lastHeader.reference + 1;
-    }
-
     /*
      * Use the bottom of userspace RAM as temporary space to build our
      * fault record. The actual composition of the record is type-specific.
@@ -246,10 +276,45 @@ void FaultLogger::task()
     SvmMemory::PhysAddr recordPA;
     SvmMemory::mapRAM(recordVA, FlashLFSIndexRecord::MAX_SIZE, recordPA);
 
-    unsigned length = buildFaultRecord(recordPA);
+    unsigned repeats = lastKey == SysLFS::kEnd ? 0 : countRepeats(lastKey, recordPA);
+
+    if (repeats) {
+        /*
+         * A title that faults the same way every time it's launched would
+         * otherwise fill the log with copies of one record, pushing out
+         * everything else and costing a full record's worth of flash
+         * writes each time. Count it instead, next to the original.
+         */
+
+        SysLFS::FaultRecordRepeat repeat;
+
+        key = repeats == 1 ? SysLFS::FaultHeader::nextKey(lastKey) : lastKey;
+        header.reference = lastHeader.reference;
+        header.recordType = SysLFS::kFaultRepeat;
+
+        repeat.header = header;
+        repeat.pc = regs.pc;
+        repeat.count = MIN(repeats + 1, 0xFFFFu);
+        repeat.reserved = 0;
 
-    ASSERT(length <= FlashLFSIndexRecord::MAX_SIZE);
-    SysLFS::write(key, recordPA, length, true);
+        codePage.release();
+        SysLFS::write(key, (const uint8_t*) &repeat, sizeof repeat, true);
+
+    } else {
+        if (lastKey == SysLFS::kEnd) {
+            // First fault in this filesystem
+            key = SysLFS::kFaultBase;
+            header.reference = 1;
+        } else {
+            key = SysLFS::FaultHeader::nextKey(lastKey);
+            header.reference = lastHeader.reference + 1;
+        }
+
+        unsigned length = buildFaultRecord(recordPA);
+
+        ASSERT(length <= FlashLFSIndexRecord::MAX_SIZE);
+        SysLFS::write(key, recordPA, length, true);
+    }
 
     /*
      * Now display the fault UI, until the user dismisses it.
@@ -69,6 +69,7 @@ private:
 
     // Runs in task context
     static unsigned buildFaultRecord(uint8_t *buffer);
+    static unsigned countRepeats(SysLFS::Key lastKey, uint8_t *buffer);
     static void buildFaultRecord(SysLFS::FaultRecordSvm *buffer);
     static void safeMemoryDump(uint8_t *dest, SvmMemory::VirtAddr src, unsigned length);
     static void dumpMetadata(const Elf::Program &program, uint16_t key, void *dest, unsigned destSize);
@@ -27,18 +27,26 @@
 #include "flash_device.h"
 #include "flash_lfs.h"
 #include "svmdebugger.h"
+#include "svmcpu.h"
 #include "faultlogger.h"
 #include <string.h>
 
 uint8_t FlashBlock::mem[NUM_CACHE_BLOCKS][BLOCK_SIZE] BLOCK_ALIGN;
 FlashBlock FlashBlock::instances[NUM_CACHE_BLOCKS];
 uint8_t FlashBlock::validCodeBundles[NUM_CACHE_BLOCKS];
+FlashBlock::ValidationMemo FlashBlock::validationMemos[NUM_VALIDATION_MEMOS];
+uint8_t FlashBlock::hashBuckets[NUM_HASH_BUCKETS];
+uint8_t FlashBlock::hashNext[NUM_CACHE_BLOCKS];
+BitVector<FlashBlock::NUM_CACHE_BLOCKS> FlashBlock::hotBlocks;
+unsigned FlashBlock::numHotBlocks;
+FlashBlock *FlashBlock::preloadBlock;
+uint32_t FlashBlock::preloadAddr;
 unsigned FlashBlock::latestStamp;
 
 
 void FlashBlock::init()
 {
-    // All blocks start out with no valid data
+    // All blocks start out with no valid data, and none are indexed
     for (unsigned i = 0; i < NUM_CACHE_BLOCKS; ++i) {
         instances[i].address = INVALID_ADDRESS;
 
@@ -47,6 +55,12 @@ void FlashBlock::init()
         instances[i].idByte = i;
     }
 
+    memset(hashBuckets, NO_BLOCK, sizeof hashBuckets);
+    memset(validationMemos, 0, sizeof validationMemos);
+    hotBlocks.clear();
+    numHotBlocks = 0;
+    preloadBlock = 0;
+
     FLASHLAYER_STATS_ONLY(resetStats());
 }
 
@@ -58,23 +72,35 @@ void FlashBlock::get(FlashBlockRef &ref, uint32_t blockAddr, unsigned flags)
         // Cache layer 1: Repeated access to the same block. Keep existing ref.
         FLASHLAYER_STATS_ONLY(stats.periodic.blockHitSame++);
 
-    } else if (FlashBlock *cached = lookupBlock(blockAddr)) {
-        // Cache layer 2: Block exists elsewhere in the cache
-        FLASHLAYER_STATS_ONLY(stats.periodic.blockHitOther++);
-        ref.set(cached);
-
     } else {
-        // Cache miss. Find a free block and reload it. Reset the lazy
-        // code validator.
-
-        FlashBlock *recycled = recycleBlock(blockAddr);
-        ASSERT(recycled->refCount == 0);
-        ASSERT(recycled >= &instances[0] && recycled < &instances[NUM_CACHE_BLOCKS]);
-
-        recycled->load(blockAddr, flags);
-        ref.set(recycled);
+        // Claim a background read if it's finished, or if it's what we want
+        if (preloadBlock && (preloadAddr == blockAddr || FlashDevice::asyncDone()))
+            finishPreload();
+
+        if (FlashBlock *cached = lookupBlock(blockAddr)) {
+            // Cache layer 2: Block exists elsewhere in the cache. If this
+            // isn't just a continuation of the access that loaded it (like
+            // the next chunk of a sequential read) the block graduates to
+            // the hot segment.
+            FLASHLAYER_STATS_ONLY(stats.periodic.blockHitOther++);
+            ref.set(cached);
+            if (cached->getAge(latestStamp) >= MIN_PROMOTE_AGE)
+                cached->promote();
+
+        } else {
+            // Cache miss. Find a free block and reload it. Reset the lazy
+            // code validator. We need the bus, so any preload finishes first.
+
+            finishPreload();
+            FlashBlock *recycled = recycleBlock(blockAddr);
+            ASSERT(recycled->refCount == 0);
+            ASSERT(recycled >= &instances[0] && recycled < &instances[NUM_CACHE_BLOCKS]);
+
+            recycled->load(blockAddr, flags);
+            ref.set(recycled);
+        }
     }
-    
+
     // Update this block's access stamp (See recycleBlock)
     ref->stamp = ++latestStamp;
 
@@ -82,6 +108,125 @@ void FlashBlock::get(FlashBlockRef &ref, uint32_t blockAddr, unsigned flags)
     FLASHLAYER_STATS_ONLY(dumpStats());
 }
 
+bool FlashBlock::getRun(FlashBlockRef *refs, const uint32_t *blockAddrs, unsigned count)
+{
+    /*
+     * Reference 'count' distinct blocks held in adjacent cache slots, so their
+     * data forms one contiguous region of cache memory. This lets callers
+     * treat a structure that straddles block boundaries as a plain pointer.
+     *
+     * The cache is fully associative, so this is only a placement decision:
+     * we pick a window of slots, then fill each slot either in place, by
+     * moving an idle copy from elsewhere in the cache, or from the device.
+     * Returns false if referenced blocks leave no usable window; callers
+     * must be able to fall back on ordinary block-at-a-time access.
+     */
+
+    ASSERT(count >= 1 && count <= MAX_RUN_BLOCKS);
+
+    for (unsigned i = 0; i < count; ++i)
+        refs[i].release();
+
+    // Blocks involved in the run must be settled before we move them
+    finishPreload();
+
+    unsigned base;
+    if (!findRunSlots(base, blockAddrs, count))
+        return false;
+
+    for (unsigned i = 0; i < count; ++i) {
+        FlashBlock *slot = &instances[base + i];
+        uint32_t blockAddr = blockAddrs[i];
+        ASSERT((blockAddr & BLOCK_MASK) == 0);
+
+        if (slot->address == blockAddr) {
+            FLASHLAYER_STATS_ONLY(stats.periodic.blockHitOther++);
+
+        } else if (FlashBlock *cached = lookupBlock(blockAddr)) {
+            // Relocate an idle copy; cheaper than another device read
+            ASSERT(cached->refCount == 0);
+            FLASHLAYER_STATS_ONLY(stats.periodic.blockHitOther++);
+
+            slot->invalidateCode();
+            slot->demote();
+            memcpy(slot->getData(), cached->getData(), BLOCK_SIZE);
+
+            cached->invalidateCode();
+            cached->demote();
+            cached->setAddress(INVALID_ADDRESS);
+            slot->setAddress(blockAddr);
+
+        } else {
+            ASSERT(slot->refCount == 0);
+            slot->demote();
+            slot->load(blockAddr);
+        }
+
+        refs[i].set(slot);
+        slot->stamp = ++latestStamp;
+        FLASHLAYER_STATS_ONLY(stats.periodic.blockTotal++);
+    }
+
+    FLASHLAYER_STATS_ONLY(dumpStats());
+    return true;
+}
+
+bool FlashBlock::findRunSlots(unsigned &base, const uint32_t *blockAddrs, unsigned count)
+{
+    /*
+     * Choose the window of slots for getRun(). A slot is usable if it
+     * already holds the right block, or if it's unreferenced. Referenced
+     * blocks can't move, so any that belong to the run pin the window's
+     * position. Among usable windows, prefer the one that displaces the
+     * fewest hot blocks and valid cold blocks.
+     */
+
+    unsigned first = 0;
+    unsigned last = NUM_CACHE_BLOCKS - count;
+
+    for (unsigned i = 0; i < count; ++i) {
+        FlashBlock *cached = lookupBlock(blockAddrs[i]);
+        if (cached && cached->refCount) {
+            if (cached->id() < i)
+                return false;
+            unsigned pinned = cached->id() - i;
+            if (pinned < first || pinned > last)
+                return false;
+            first = last = pinned;
+        }
+    }
+
+    bool found = false;
+    unsigned bestCost = 0;
+
+    for (unsigned s = first; s <= last; ++s) {
+        unsigned cost = 0;
+        unsigned i;
+
+        for (i = 0; i < count; ++i) {
+            FlashBlock *slot = &instances[s + i];
+            if (slot->address == blockAddrs[i])
+                continue;
+            if (slot->refCount)
+                break;
+            if (hotBlocks.test(s + i))
+                cost += 4;
+            else if (slot->address != INVALID_ADDRESS)
+                cost += 1;
+        }
+
+        if (i == count && (!found || cost < bestCost)) {
+            found = true;
+            base = s;
+            bestCost = cost;
+            if (cost == 0)
+                break;
+        }
+    }
+
+    return found;
+}
+
 void FlashBlock::anonymous(FlashBlockRef &ref)
 {
     /*
@@ -104,8 +249,9 @@ void FlashBlock::anonymous(FlashBlockRef &ref)
     ASSERT(recycled >= &instances[0] && recycled < &instances[NUM_CACHE_BLOCKS]);
 
     // This ensures nobody else will ref the same block.
-    recycled->address = INVALID_ADDRESS;
-    recycled->validCodeBundles[recycled->id()] = 0;
+    recycled->setAddress(INVALID_ADDRESS);
+    recycled->demote();
+    recycled->invalidateCode();
 
     ref.set(recycled);
     ASSERT(recycled->refCount == 1);
@@ -124,75 +270,254 @@ void FlashBlock::anonymous(FlashBlockRef &ref, uint8_t fillByte)
 ALWAYS_INLINE FlashBlock *FlashBlock::lookupBlock(uint32_t blockAddr)
 {
     /*
-     * This is a compromise between a fully associative and a set-associative
-     * cache. We can't usefully be set-associative with a small N, because
-     * our N would need to be at least as large as the worst-case number of
-     * referenced blocks.
-     *
-     * So instead, we'll still be a fully associative cache, but we use
-     * the address as a hint for which cache bucket to start in. We strongly
-     * prefer to place blocks in this cached address, but we don't require
-     * it (in case the preferred location is referenced or very recently
-     * accessed).
+     * We're a fully associative cache, so any block may live in any slot.
+     * Rather than searching every slot, follow a short chain from a hash
+     * index keyed on the block address. Every block with a valid address
+     * is on exactly one chain; anonymous blocks are on none.
      */
 
     ASSERT((blockAddr & BLOCK_MASK) == 0);
-    FlashBlock *ptr = &instances[(blockAddr >> BLOCK_SIZE_LOG2) % NUM_CACHE_BLOCKS];
-    unsigned count = NUM_CACHE_BLOCKS;
+    unsigned idx = hashBuckets[hashBucket(blockAddr)];
 
-    do {
+    while (idx != NO_BLOCK) {
+        ASSERT(idx < NUM_CACHE_BLOCKS);
+        FlashBlock *ptr = &instances[idx];
         if (ptr->address == blockAddr)
             return ptr;
-        if (++ptr == &instances[NUM_CACHE_BLOCKS])
-            ptr = &instances[0];
-    } while (--count);
+        idx = hashNext[idx];
+    }
 
     return 0;
 }
 
-FlashBlock *FlashBlock::recycleBlock(uint32_t blockAddr)
+void FlashBlock::setAddress(uint32_t blockAddr)
 {
     /*
-     * Look for a block we can recycle, in order to service a cache miss.
-     * To maintain the hash property of our cache, we strongly prefer to
-     * recycle the block which is directly mapped to the requested address.
-     *
-     * We opt to skip to the next block if the preferred block is referenced,
-     * or if it was used recently. (Its stamp is recent).
+     * Change this block's address, keeping the hash index in sync.
+     * All writes to 'address' after init() must go through here.
+     */
+
+    if (address == blockAddr)
+        return;
+
+    if (address != INVALID_ADDRESS) {
+        uint8_t *link = &hashBuckets[hashBucket(address)];
+        while (*link != id()) {
+            ASSERT(*link != NO_BLOCK);
+            link = &hashNext[*link];
+        }
+        *link = hashNext[id()];
+    }
+
+    address = blockAddr;
+
+    if (blockAddr != INVALID_ADDRESS) {
+        uint8_t &head = hashBuckets[hashBucket(blockAddr)];
+        hashNext[id()] = head;
+        head = id();
+    }
+}
+
+void FlashBlock::promote()
+{
+    /*
+     * Move this block into the hot segment. That segment has a fixed upper
+     * size, so if it's full we make room by demoting its least recently
+     * used unreferenced block. If everything hot is referenced, we let the
+     * segment overflow temporarily; correctness doesn't depend on the limit.
      */
 
-    // First pass: Look for something both unreferenced and stale
-    {
-        FlashBlock *ptr = &instances[(blockAddr >> BLOCK_SIZE_LOG2) % NUM_CACHE_BLOCKS];
-        unsigned count = NUM_CACHE_BLOCKS;
-        const unsigned ageThreshold = NUM_CACHE_BLOCKS * 2;
+    if (hotBlocks.test(id()))
+        return;
+
+    if (numHotBlocks >= MAX_HOT_BLOCKS) {
+        FlashBlock *oldest = 0;
+        unsigned oldestAge = 0;
         unsigned localLatestStamp = latestStamp;
 
-        do {
-            if (ptr->refCount == 0 && (ptr->address == INVALID_ADDRESS
-                    || ptr->getAge(localLatestStamp) >= ageThreshold))
-                return ptr;
-            if (++ptr == &instances[NUM_CACHE_BLOCKS])
-                ptr = &instances[0];
-        } while (--count);
+        for (unsigned idx = 0; idx < NUM_CACHE_BLOCKS; idx++) {
+            FlashBlock *ptr = &instances[idx];
+            if (ptr->refCount == 0 && hotBlocks.test(idx)) {
+                unsigned age = ptr->getAge(localLatestStamp);
+                if (!oldest || age > oldestAge) {
+                    oldest = ptr;
+                    oldestAge = age;
+                }
+            }
+        }
+
+        if (oldest)
+            oldest->demote();
     }
 
-    // Second pass: Give up on finding a stale block, just look for anything unreferenced
-    {
-        FlashBlock *ptr = &instances[(blockAddr >> BLOCK_SIZE_LOG2) % NUM_CACHE_BLOCKS];
-        unsigned count = NUM_CACHE_BLOCKS;
-
-        do {
-            if (ptr->refCount == 0)
-                return ptr;
-            if (++ptr == &instances[NUM_CACHE_BLOCKS])
-                ptr = &instances[0];
-        } while (--count);
+    hotBlocks.mark(id());
+    numHotBlocks++;
+}
+
+void FlashBlock::demote()
+{
+    if (hotBlocks.test(id())) {
+        hotBlocks.clear(id());
+        ASSERT(numHotBlocks > 0);
+        numHotBlocks--;
     }
+}
+
+FlashBlock *FlashBlock::findVictim()
+{
+    /*
+     * Look for a block we can recycle. Returns NULL if every block is
+     * referenced.
+     *
+     * This is a segmented LRU, after the '2Q' family of policies. New
+     * blocks enter a cold segment, and only blocks that are looked up
+     * again after the caller moved on to a different block are promoted
+     * to the hot segment. We always replace a cold block if we can, so a
+     * long sequential read (like streaming a large asset) cycles through
+     * the cold segment without disturbing hot SVM code and metadata.
+     *
+     * In order of preference, we take:
+     *
+     *   1. Any unreferenced block without a valid address
+     *   2. The least recently used unreferenced cold block
+     *   3. The least recently used unreferenced hot block
+     */
+
+    FlashBlock *coldVictim = 0;
+    FlashBlock *hotVictim = 0;
+    unsigned coldAge = 0;
+    unsigned hotAge = 0;
+    unsigned localLatestStamp = latestStamp;
+
+    for (unsigned idx = 0; idx < NUM_CACHE_BLOCKS; idx++) {
+        FlashBlock *ptr = &instances[idx];
+
+        if (ptr->refCount)
+            continue;
+
+        if (ptr->address == INVALID_ADDRESS) {
+            ptr->demote();
+            return ptr;
+        }
+
+        unsigned age = ptr->getAge(localLatestStamp);
+
+        if (hotBlocks.test(idx)) {
+            if (!hotVictim || age > hotAge) {
+                hotVictim = ptr;
+                hotAge = age;
+            }
+        } else {
+            if (!coldVictim || age > coldAge) {
+                coldVictim = ptr;
+                coldAge = age;
+            }
+        }
+    }
+
+    if (coldVictim)
+        return coldVictim;
+
+    if (hotVictim)
+        hotVictim->demote();
+
+    return hotVictim;
+}
+
+FlashBlock *FlashBlock::recycleBlock(uint32_t blockAddr)
+{
+    // Find a block to service a cache miss. Running out is fatal.
+
+    if (FlashBlock *victim = findVictim())
+        return victim;
 
     FaultLogger::internalError(FaultLogger::F_OUT_OF_CACHE_BLOCKS);
 }
 
+void FlashBlock::finishPreload()
+{
+    /*
+     * Wait for any background read to land, then publish the block under
+     * its new address. If the read failed we just drop it; whoever wanted
+     * the block will take an ordinary cache miss.
+     */
+
+    FlashBlock *block = preloadBlock;
+    if (!block)
+        return;
+    preloadBlock = 0;
+
+    ASSERT(block->isAnonymous());
+    ASSERT(lookupBlock(preloadAddr) == 0);
+
+    if (FlashDevice::finishAsync()) {
+        block->setAddress(preloadAddr);
+        SvmDebugger::patchFlashBlock(preloadAddr, block->getData());
+    }
+
+    block->decRef();
+}
+
+void FlashBlock::invalidateCode()
+{
+    /*
+     * This block's contents are about to change. Forget anything we
+     * know about the code it contains.
+     */
+
+    validCodeBundles[id()] = 0;
+
+#ifdef SIFTEO_SIMULATOR
+    SvmCpu::invalidateDecodeCache(id());
+#endif
+}
+
+uint32_t FlashBlock::codeDigest(const uint32_t *words)
+{
+    /*
+     * Order-sensitive digest of a whole block, several times cheaper
+     * than running the validator over it. This is only a guard against
+     * stale memos, such as a block that was rewritten without going
+     * through invalidate(), or an abort trap page that was synthesized
+     * at the same address.
+     */
+
+    uint32_t digest = 0;
+    for (unsigned i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
+        digest = Intrinsic::ROL(digest, 5) ^ words[i];
+    return digest;
+}
+
+unsigned FlashBlock::validateCode()
+{
+    /*
+     * Count the valid code bundles at the beginning of this block, using
+     * the memo for this flash address if it's still current.
+     */
+
+    const uint32_t *words = reinterpret_cast<const uint32_t*>(getData());
+
+    if (isAnonymous())
+        return SvmValidator::findValidBundles(words);
+
+    STATIC_ASSERT((NUM_VALIDATION_MEMOS & (NUM_VALIDATION_MEMOS - 1)) == 0);
+    STATIC_ASSERT(BLOCK_SIZE / Svm::BUNDLE_SIZE <= BLOCK_MASK);
+    ValidationMemo &memo = validationMemos[(address >> BLOCK_SIZE_LOG2)
+        & (NUM_VALIDATION_MEMOS - 1)];
+
+    uint32_t digest = codeDigest(words);
+    unsigned bundles = memo.tag & BLOCK_MASK;
+
+    if (bundles && (memo.tag & ~BLOCK_MASK) == address && memo.digest == digest)
+        return bundles;
+
+    bundles = SvmValidator::findValidBundles(words);
+    ASSERT(bundles <= BLOCK_MASK);
+    memo.tag = address | bundles;
+    memo.digest = digest;
+    return bundles;
+}
+
 void FlashBlock::load(uint32_t blockAddr, unsigned flags)
 {
     /*
@@ -203,8 +528,8 @@ void FlashBlock::load(uint32_t blockAddr, unsigned flags)
     ASSERT(blockAddr != INVALID_ADDRESS);
     ASSERT((blockAddr & (BLOCK_SIZE - 1)) == 0);
 
-    validCodeBundles[id()] = 0;
-    address = blockAddr;
+    invalidateCode();
+    setAddress(blockAddr);
 
     uint8_t *data = getData();
     ASSERT(isAddrValid(reinterpret_cast<uintptr_t>(data)));
@@ -269,7 +594,7 @@ void FlashBlockWriter::beginBlock(const FlashBlockRef &r)
     ASSERT(ref.isHeld());
 
     // Prepare to write
-    ref->validCodeBundles[ref->id()] = 0;
+    ref->invalidateCode();
 }
 
 void FlashBlockWriter::beginBlock()
@@ -309,6 +634,14 @@ void FlashBlock::invalidate(uint32_t addrBegin, uint32_t addrEnd, unsigned flags
         return;
 
     ASSERT(addrBegin < addrEnd);
+    finishPreload();
+
+    // Flash is changing; forget what we validated there
+    for (unsigned idx = 0; idx < NUM_VALIDATION_MEMOS; idx++) {
+        uint32_t memoAddr = validationMemos[idx].tag & ~BLOCK_MASK;
+        if (memoAddr + BLOCK_SIZE > addrBegin && memoAddr < addrEnd)
+            validationMemos[idx].tag = 0;
+    }
 
     for (unsigned idx = 0; idx < NUM_CACHE_BLOCKS; idx++) {
         FlashBlock *block = &instances[idx];
@@ -333,7 +666,7 @@ void FlashBlock::invalidateBlock(unsigned flags)
             load(address, flags);
     } else {
         // Nobody's using this block, quietly mark it as invalid / anonymous
-        address = INVALID_ADDRESS;
+        setAddress(INVALID_ADDRESS);
     }
 }
 
@@ -352,8 +685,26 @@ void FlashBlockWriter::commitBlock()
         // Must not be anonymous
         ASSERT(block->address != FlashBlock::INVALID_ADDRESS);
 
-        FlashDevice::write(block->address, block->getData(),
-            FlashBlock::BLOCK_SIZE);
+        /*
+         * Programming 0xFF never changes any bits, so don't spend bus time
+         * on erased words at either end of the block. This is common for
+         * volume headers, partially filled payload blocks, and LFS indexes.
+         * If nothing is left, the device doesn't need to hear about it.
+         */
+
+        const uint32_t *words = reinterpret_cast<const uint32_t*>(block->getData());
+        unsigned begin = 0;
+        unsigned end = FlashBlock::BLOCK_SIZE / sizeof(uint32_t);
+
+        while (begin != end && words[end - 1] == 0xFFFFFFFF)
+            end--;
+        while (begin != end && words[begin] == 0xFFFFFFFF)
+            begin++;
+
+        if (begin != end)
+            FlashDevice::write(block->address + begin * sizeof(uint32_t),
+                reinterpret_cast<const uint8_t*>(words + begin),
+                (end - begin) * sizeof(uint32_t));
 
         // Make sure we are only programming bits from 1 to 0.
         DEBUG_ONLY(block->verify());
@@ -389,28 +740,66 @@ void FlashBlockWriter::relocate(uint32_t blockAddr)
     // Same as commitBlock() if we aren't moving.
     if (block->address != blockAddr) {
 
-        // Invalidate any blocks we're replacing. They must be unref'ed.
-        for (unsigned idx = 0; idx < FlashBlock::NUM_CACHE_BLOCKS; idx++) {
-            FlashBlock *b = &FlashBlock::instances[idx];
-            if (b->address == blockAddr) {
+        // A preload could be about to publish the address we're taking over
+        FlashBlock::finishPreload();
 
-                if (b->refCount != 0) {
-                    LOG(("FLASH: Serious Error! Detected an attempt to relocate "
-                        "anonymous block over referenced block. Did someone "
-                        "delete a volume which still had outstanding references?\n"));
-                    ASSERT(0);
-                }
+        // Invalidate any block we're replacing. It must be unref'ed.
+        while (FlashBlock *b = FlashBlock::lookupBlock(blockAddr)) {
 
-                b->address = FlashBlock::INVALID_ADDRESS;
+            if (b->refCount != 0) {
+                LOG(("FLASH: Serious Error! Detected an attempt to relocate "
+                    "anonymous block over referenced block. Did someone "
+                    "delete a volume which still had outstanding references?\n"));
+                ASSERT(0);
             }
+
+            b->setAddress(FlashBlock::INVALID_ADDRESS);
         }
 
         // Replace this block's address in the cache.
-        block->address = blockAddr;
+        block->setAddress(blockAddr);
     }
 }
 
 void FlashBlock::preload(uint32_t blockAddr)
 {
-    // XXX: Implement me
+    /*
+     * Start reading a block we expect to need soon, so it can arrive while
+     * the CPU does something else. This is only a hint. We skip it if the
+     * block is already cached, if another preload is still in flight, or
+     * if the device or the cache can't accommodate it right now.
+     *
+     * Until the read finishes, the block is anonymous and referenced, so
+     * nobody else can see it or recycle it. It enters the cold segment when
+     * published by finishPreload().
+     */
+
+    ASSERT((blockAddr & BLOCK_MASK) == 0);
+
+    if (preloadBlock) {
+        if (!FlashDevice::asyncDone())
+            return;
+        finishPreload();
+    }
+
+    if (lookupBlock(blockAddr))
+        return;
+
+    FlashBlock *block = findVictim();
+    if (!block)
+        return;
+
+    block->setAddress(INVALID_ADDRESS);
+    block->invalidateCode();
+    block->incRef();
+    block->stamp = ++latestStamp;
+
+    if (!FlashDevice::readAsync(blockAddr, block->getData(), BLOCK_SIZE)) {
+        block->decRef();
+        return;
+    }
+
+    FLASHLAYER_STATS_ONLY(stats.periodic.blockPreload++);
+    preloadBlock = block;
+    preloadAddr = blockAddr;
 }
@@ -38,6 +38,7 @@
 #include "systime.h"
 #include "machine.h"
 #include "macros.h"
+#include "bits.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -62,12 +63,24 @@ public:
     static const unsigned NUM_CACHE_BLOCKS = 64;    // 16 kB of cache
     static const unsigned MAX_REFCOUNT = NUM_CACHE_BLOCKS;
 
+    // Address hash index (Must be a power of two)
+    static const unsigned NUM_HASH_BUCKETS = NUM_CACHE_BLOCKS;
+
+    // Upper limit on the 'hot' segment; the rest is always left for new blocks
+    static const unsigned MAX_HOT_BLOCKS = NUM_CACHE_BLOCKS * 3 / 4;
+
+    // Re-references younger than this (in accesses) are assumed to be correlated
+    static const unsigned MIN_PROMOTE_AGE = NUM_CACHE_BLOCKS;
+
     // Block size (Must be a power of two)
     static const unsigned BLOCK_SIZE_LOG2 = 8;
     static const unsigned BLOCK_SIZE = 1 << BLOCK_SIZE_LOG2;
     static const unsigned BLOCK_MASK = BLOCK_SIZE - 1;
     #define BLOCK_ALIGN __attribute__((aligned(256)))
 
+    // Longest run for getRun(); enough for the largest LFS object at any alignment
+    static const unsigned MAX_RUN_BLOCKS = 5;
+
     // Special address for anonymous blocks
     static const uint32_t INVALID_ADDRESS = (uint32_t)-1;
 
@@ -91,11 +104,16 @@ private:
         unsigned globalRefcount;
         SysTime::Ticks timestamp;
 
+        // Running totals, with each interval folded in as it's reset
+        uint64_t totalAccesses;
+        uint64_t totalMisses;
+
         // These counters are reset on every interval
         struct {
             unsigned blockHitSame;
             unsigned blockHitOther;
             unsigned blockMiss;
+            unsigned blockPreload;
             unsigned blockTotal;
 
             // Should be last, for efficiency. This is large!
@@ -112,6 +130,31 @@ private:
     // Stored out-of-line, to keep the main FlashBlock length a power-of-two
     static uint8_t validCodeBundles[NUM_CACHE_BLOCKS];
 
+    /*
+     * Validation results that outlive a cache slot, indexed by flash block
+     * address. A code block that gets recycled and later reloaded can skip
+     * the validator, after comparing a cheap digest of its contents.
+     */
+    static const unsigned NUM_VALIDATION_MEMOS = 128;   // Must be a power of two
+    struct ValidationMemo {
+        uint32_t tag;       // Block address, ORed with the valid bundle count
+        uint32_t digest;    // See codeDigest()
+    };
+    static ValidationMemo validationMemos[NUM_VALIDATION_MEMOS];
+
+    // Chained hash index from block address to cache slot; see lookupBlock()
+    static const uint8_t NO_BLOCK = 0xFF;
+    static uint8_t hashBuckets[NUM_HASH_BUCKETS];
+    static uint8_t hashNext[NUM_CACHE_BLOCKS];
+
+    // Blocks that have been re-referenced since they were loaded; see recycleBlock()
+    static BitVector<NUM_CACHE_BLOCKS> hotBlocks;
+    static unsigned numHotBlocks;
+
+    // Block being filled by a background read, if any; see preload()
+    static FlashBlock *preloadBlock;
+    static uint32_t preloadAddr;
+
 public:
     ALWAYS_INLINE unsigned id() const {
         return idByte;
@@ -143,18 +186,23 @@ public:
         uint8_t &pcb = validCodeBundles[id()];
         unsigned cb = pcb;
 
-        if (cb == 0) {
-            const uint32_t *words = reinterpret_cast<const uint32_t*>(getData());
-            pcb = cb = SvmValidator::findValidBundles(words);
-        }
+        if (cb == 0)
+            pcb = cb = validateCode();
 
         return (offset >> 2) < cb;
     }
 
 #ifdef SIFTEO_SIMULATOR
     static bool isAddrValid(uintptr_t pa);
+
+    // Byte offset of a physical address from the start of the cache
+    ALWAYS_INLINE static uintptr_t cacheOffset(uintptr_t pa) {
+        return reinterpret_cast<uint8_t*>(pa) - &mem[0][0];
+    }
+
     static void resetStats();
     static void dumpStats();
+    static void getTotals(uint64_t &accesses, uint64_t &misses);
     static bool hotBlockSort(unsigned i, unsigned j);
     static void countBlockMiss(uint32_t blockAddr);
     void verify();
@@ -168,6 +216,7 @@ public:
     // Cached block accessors
     static void preload(uint32_t blockAddr);
     static void get(FlashBlockRef &ref, uint32_t blockAddr, unsigned flags = 0);
+    static bool getRun(FlashBlockRef *refs, const uint32_t *blockAddrs, unsigned count);
 
     // Support for anonymous memory
     static void anonymous(FlashBlockRef &ref);
@@ -204,8 +253,23 @@ private:
         return uint16_t(latest - stamp);
     }
 
+    ALWAYS_INLINE static unsigned hashBucket(uint32_t blockAddr) {
+        STATIC_ASSERT((NUM_HASH_BUCKETS & (NUM_HASH_BUCKETS - 1)) == 0);
+        return (blockAddr >> BLOCK_SIZE_LOG2) & (NUM_HASH_BUCKETS - 1);
+    }
+
+    void setAddress(uint32_t blockAddr);
+    void promote();
+    void demote();
+
+    void invalidateCode();
+    unsigned validateCode();
+    static uint32_t codeDigest(const uint32_t *words);
     static FlashBlock *lookupBlock(uint32_t blockAddr);
+    static FlashBlock *findVictim();
     static FlashBlock *recycleBlock(uint32_t blockAddr);
+    static bool findRunSlots(unsigned &base, const uint32_t *blockAddrs, unsigned count);
+    static void finishPreload();
     void load(uint32_t blockAddr, unsigned flags = 0);
 };
 
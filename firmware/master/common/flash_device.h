@@ -48,6 +48,16 @@ public:
     static void read(uint32_t address, uint8_t *buf, unsigned len);
     static void write(uint32_t address, const uint8_t *buf, unsigned len);
 
+    /*
+     * Background reads. At most one may be in flight. readAsync() returns
+     * false if it couldn't start. finishAsync() waits, and returns false if
+     * the read failed and must be retried synchronously. Any other device
+     * operation implicitly waits for a background read to finish.
+     */
+    static bool readAsync(uint32_t address, uint8_t *buf, unsigned len);
+    static bool asyncDone();
+    static bool finishAsync();
+
     DEBUG_ONLY(static void setStealthIO(int counter);)
     DEBUG_ONLY(static void verify(uint32_t address, const uint8_t *buf, unsigned len);)
 
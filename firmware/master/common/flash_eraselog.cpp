@@ -277,3 +277,28 @@ void FlashEraseLog::clearBlocks(FlashMapBlock::Set &inventory)
         }
     }
 }
+
+unsigned FlashEraseLog::countRecords()
+{
+    /*
+     * Count the records not yet popped from any erase log volume. This is
+     * an upper bound on the number of pre-erased blocks we have, since we
+     * don't check each record's CRC here.
+     */
+
+    FlashVolumeIter vi;
+    FlashEraseLog log;
+    unsigned count = 0;
+    vi.begin();
+
+    while (vi.next(log.volume)) {
+        if (log.volume.getType() != FlashVolume::T_ERASE_LOG)
+            continue;
+
+        log.findIndices();
+        if (log.writeIndex > log.readIndex)
+            count += log.writeIndex - log.readIndex;
+    }
+
+    return count;
+}
@@ -473,6 +473,7 @@ void FlashLFS::initWithVolumeVector(FlashVolume parent, FlashLFSVolumeVector::Se
     this->parent = parent;
 
     volumes.sort(si);
+    keyCache.clear();
 
     unsigned index = volumes.numSlotsInUse;
     lastSequenceNumber = index ? si.slots[index - 1] : 0;
@@ -543,6 +544,76 @@ void FlashLFSCache::invalidate()
         instances[i].invalidate();
 }
 
+void FlashLFSKeyCache::clear()
+{
+    memset(entries, 0, sizeof entries);
+    STATIC_ASSERT(EMPTY == 0);
+}
+
+void FlashLFSKeyCache::forget(unsigned key)
+{
+    Entry &e = entryFor(key);
+    if (e.key == key)
+        e.address = EMPTY;
+}
+
+void FlashLFSKeyCache::store(unsigned key, unsigned address, const FlashLFSIndexRecord *record)
+{
+    ASSERT(FlashLFSIndexRecord::isKeyAllowed(key));
+    ASSERT(address != EMPTY && address != MISSING);
+
+    Entry &e = entryFor(key);
+    e.address = address;
+    e.crc = record->getCRC();
+    e.key = key;
+    e.sizeInUnits = record->getSizeInUnits();
+}
+
+void FlashLFSKeyCache::storeMissing(unsigned key)
+{
+    ASSERT(FlashLFSIndexRecord::isKeyAllowed(key));
+
+    Entry &e = entryFor(key);
+    e.address = MISSING;
+    e.key = key;
+}
+
+bool FlashLFSKeyCache::contains(unsigned key)
+{
+    Entry &e = entryFor(key);
+    return e.key == key && e.address != EMPTY;
+}
+
+int FlashLFSKeyCache::read(unsigned key, uint8_t *buffer, unsigned bufferSize)
+{
+    /*
+     * Same rules as FlashLFSObjectIter::readAndCheck(). If the CRC fails
+     * (most likely because the buffer is too small to hold the object) we
+     * let the caller's full search sort it out, since it may find an older
+     * copy that fits.
+     */
+
+    Entry &e = entryFor(key);
+
+    if (e.key != key || e.address == EMPTY)
+        return -1;
+    if (e.address == MISSING)
+        return 0;
+
+    unsigned size = MIN(bufferSize, unsigned(e.sizeInUnits) << FlashLFSIndexRecord::SIZE_SHIFT);
+    FlashDevice::read(e.address, buffer, size);
+
+    CrcStream cs;
+    cs.reset();
+    cs.addBytes(buffer, size);
+    uint32_t crc = cs.get(FlashLFSIndexRecord::SIZE_UNIT);
+
+    if ((crc ^ e.crc) & 0xFFFF)
+        return -1;
+
+    return size;
+}
+
 FlashLFSObjectAllocator::FlashLFSObjectAllocator(FlashLFS &lfs, unsigned key,
     unsigned size, unsigned crc)
     : lfs(lfs), key(key),
@@ -562,6 +633,9 @@ bool FlashLFSObjectAllocator::allocate(unsigned volLimit)
      * to write to. Otherwise, we'll try to allocate a new volume.
      */
 
+    // Any cached location for this key is about to be out of date
+    lfs.keyCache.forget(key);
+
     FlashVolume vol = lfs.volumes.last();
     if (vol.block.isValid() && allocInVolume(vol))
         return true;
@@ -1017,6 +1091,9 @@ bool FlashLFS::collectLocalGarbage()
 
     ASSERT(isValid());
 
+    // Objects are about to move, and volumes may disappear
+    keyCache.clear();
+
     // Early out
     unsigned numSlotsInUse = volumes.numSlotsInUse;
     if (numSlotsInUse == 0)
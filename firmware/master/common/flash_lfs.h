@@ -304,8 +304,12 @@ public:
         return size;
     }
 
+    ALWAYS_INLINE unsigned getCRC() const {
+        return crc[0] | (crc[1] << 8);
+    }
+
     ALWAYS_INLINE bool checkCRC(unsigned reference) const {
-        return !(((crc[0] | (crc[1] << 8)) ^ reference) & 0xFFFF);
+        return !((getCRC() ^ reference) & 0xFFFF);
     }
 
     ALWAYS_INLINE static bool isKeyAllowed(unsigned key) {
@@ -318,6 +322,60 @@ public:
 };
 
 
+/**
+ * FlashLFSKeyCache is a small RAM cache which remembers, for recently read
+ * keys, where the newest valid copy of that object lives in flash. With a
+ * cache hit, reading an object needs no index traversal at all.
+ *
+ * The cache is direct-mapped by key. Each entry holds a copy of the
+ * object's index record data, so a hit still CRCs the object just like a
+ * normal read would. We also remember keys that have no objects at all.
+ *
+ * Entries are filled lazily by reads, or ahead of time by prefetching a
+ * batch of keys in one index traversal. Anything that could make an entry
+ * stale (writing a newer copy of the key, garbage collection, or loss of
+ * the LFS state) must forget it.
+ */
+class FlashLFSKeyCache
+{
+public:
+    static const unsigned NUM_ENTRIES = 32;
+
+    void clear();
+    void forget(unsigned key);
+    void store(unsigned key, unsigned address, const FlashLFSIndexRecord *record);
+    void storeMissing(unsigned key);
+
+    /// Does the cache already know where this key lives, or that it's missing?
+    bool contains(unsigned key);
+
+    /**
+     * Try to read an object using only the cache. Returns the number of
+     * bytes read, zero if the key is known not to exist, or -1 if the
+     * caller must do a full search.
+     */
+    int read(unsigned key, uint8_t *buffer, unsigned bufferSize);
+
+private:
+    static const uint32_t EMPTY = 0;
+    static const uint32_t MISSING = -1;
+
+    struct Entry {
+        uint32_t address;   // Object data, EMPTY, or MISSING
+        uint16_t crc;
+        uint8_t key;
+        uint8_t sizeInUnits;
+    };
+
+    Entry entries[NUM_ENTRIES];
+
+    ALWAYS_INLINE Entry &entryFor(unsigned key) {
+        STATIC_ASSERT((NUM_ENTRIES & (NUM_ENTRIES - 1)) == 0);
+        return entries[key & (NUM_ENTRIES - 1)];
+    }
+};
+
+
 /**
  * FlashLFSKeyQuery is a search query which locates some set of keys,
  * either via exact match or exclusion. Doing this level of filtering
@@ -611,6 +669,7 @@ public:
 
     ALWAYS_INLINE void invalidate() {
         lastSequenceNumber = INVALID_LSN;
+        keyCache.clear();
     }
 
     ALWAYS_INLINE bool isValid() {
@@ -624,6 +683,7 @@ public:
     uint32_t lastSequenceNumber;
     FlashVolume parent;
     FlashLFSVolumeVector volumes;
+    FlashLFSKeyCache keyCache;
 
 private:
     typedef BitVector<FlashLFSVolumeVector::MAX_VOLUMES> VolumeIndexVector;
@@ -86,6 +86,39 @@ bool FlashMapSpan::flashAddrToOffset(FlashAddr flashAddr, ByteOffset &byteOffset
     return false;
 }
 
+bool FlashMapSpan::getBytesContiguous(FlashBlockRef *refs, ByteOffset byteOffset,
+    uint32_t length, PhysAddr &ptr) const
+{
+    /*
+     * Map 'length' bytes of the span as one contiguous pointer, holding
+     * up to FlashBlock::MAX_RUN_BLOCKS references in 'refs'. The blocks
+     * may be physically scattered in flash; only their cache slots are
+     * adjacent. Returns false if the range is invalid or too long, or if
+     * the cache can't find room for the run.
+     */
+
+    if (!length || length > FlashBlock::MAX_RUN_BLOCKS * FlashBlock::BLOCK_SIZE)
+        return false;
+
+    ByteOffset blockPart = byteOffset & ~(ByteOffset)FlashBlock::BLOCK_MASK;
+    ByteOffset bytePart = byteOffset & FlashBlock::BLOCK_MASK;
+    unsigned count = (bytePart + length + FlashBlock::BLOCK_MASK) / FlashBlock::BLOCK_SIZE;
+
+    if (count > FlashBlock::MAX_RUN_BLOCKS)
+        return false;
+
+    FlashAddr blockAddrs[FlashBlock::MAX_RUN_BLOCKS];
+    for (unsigned i = 0; i < count; ++i)
+        if (!offsetToFlashAddr(blockPart + i * FlashBlock::BLOCK_SIZE, blockAddrs[i]))
+            return false;
+
+    if (!FlashBlock::getRun(refs, blockAddrs, count))
+        return false;
+
+    ptr = refs[0]->getData() + bytePart;
+    return true;
+}
+
 bool FlashMapSpan::copyBytes(FlashBlockRef &ref, ByteOffset byteOffset, uint8_t *dest, uint32_t length) const
 {
     while (length) {
@@ -95,6 +128,10 @@ bool FlashMapSpan::copyBytes(FlashBlockRef &ref, ByteOffset byteOffset, uint8_t
         if (!getBytes(ref, byteOffset, srcPA, chunk))
             return false;
 
+        // Fetch the next block in the background while we copy this one
+        if (length > chunk)
+            preloadBlock(byteOffset + chunk);
+
         memcpy(dest, srcPA, chunk);
         dest += chunk;
         byteOffset += chunk;
@@ -108,21 +145,21 @@ bool FlashMapSpan::copyBytesUncached(ByteOffset byteOffset, uint8_t *dest, uint3
 {
     while (length) {
         /*
-         * Note: Even though we are bypassing the cache, we still split on
-         *       cache block boundaries, since that's also the alignment
-         *       guaranteed by a FlashMapSpan.
+         * The span is contiguous in flash up to the end of each
+         * FlashMapBlock, so we can read that much as a single burst: one
+         * command, then one long data phase. This saves re-issuing a read
+         * command for every cache block.
          */
 
-        ByteOffset blockPart = byteOffset & ~(ByteOffset)FlashBlock::BLOCK_MASK;
-        ByteOffset bytePart = byteOffset & FlashBlock::BLOCK_MASK;
-        uint32_t maxLength = FlashBlock::BLOCK_SIZE - bytePart;
-        uint32_t chunk = MIN(length, maxLength);
-
         FlashAddr fa;
-        if (!offsetToFlashAddr(blockPart, fa))
+        if (!offsetToFlashAddr(byteOffset, fa))
             return false;
 
-        FlashDevice::read(fa + bytePart, dest, chunk);
+        uint32_t mapBlockLeft = FlashMapBlock::BLOCK_SIZE - (fa & FlashMapBlock::BLOCK_MASK);
+        uint32_t spanLeft = sizeInBytes() - byteOffset;
+        uint32_t chunk = MIN(length, MIN(mapBlockLeft, spanLeft));
+
+        FlashDevice::read(fa, dest, chunk);
 
         byteOffset += chunk;
         dest += chunk;
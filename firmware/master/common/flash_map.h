@@ -266,6 +266,7 @@ public:
     bool getByte(FlashBlockRef &ref, ByteOffset byteOffset, PhysAddr &ptr, unsigned flags = 0) const;
     bool copyBytes(FlashBlockRef &ref, ByteOffset byteOffset, uint8_t *dest, uint32_t length) const;
     bool copyBytes(ByteOffset byteOffset, uint8_t *dest, uint32_t length) const;
+    bool getBytesContiguous(FlashBlockRef *refs, ByteOffset byteOffset, uint32_t length, PhysAddr &ptr) const;
     bool preloadBlock(ByteOffset byteOffset) const;
 
     // Cache-bypassing data access
@@ -24,6 +24,10 @@
  */
 
 #include "flash_preerase.h"
+#include "flash_device.h"
+#include "usbvolumemanager.h"
+
+unsigned FlashBlockPreEraser::countdown;
 
 
 // Tell our FlashBlockRecycler not to use the erase log
@@ -50,3 +54,43 @@ bool FlashBlockPreEraser::next()
     log.commit(r);
     return true;
 }
+
+void FlashBlockPreEraser::heartbeat(unsigned beats)
+{
+    if (countdown > beats) {
+        countdown -= beats;
+        return;
+    }
+
+    countdown = FILL_INTERVAL;
+    Tasks::trigger(Tasks::PreEraser);
+}
+
+void FlashBlockPreEraser::task()
+{
+    /*
+     * One background time slice: pre-erase at most one block, then go back
+     * to user code. Both the recycler's device scan and the erase itself
+     * happen here, so foreground allocations can usually just pop a block
+     * from the erase log.
+     *
+     * Skip this slice if the previous erase is still running, so that we
+     * never hold the flash bus for longer than one erase. Also skip it while
+     * a USB install is in progress. That install's volume is still
+     * T_INCOMPLETE, and the recycler would treat it as garbage.
+     */
+
+    if (FlashDevice::busy() || UsbVolumeManager::isWriting())
+        return;
+
+    if (FlashEraseLog::countRecords() >= POOL_TARGET) {
+        countdown = FULL_INTERVAL;
+        return;
+    }
+
+    FlashBlockPreEraser bpe;
+    if (!bpe.next()) {
+        // Nothing left to recycle. Don't rescan until a while later.
+        countdown = BACKOFF_INTERVAL;
+    }
+}
@@ -27,11 +27,15 @@
 #define FLASH_PREERASE_H_
 
 #include "flash_recycler.h"
+#include "tasks.h"
 
 /**
  * Manages the process of pre-erasing blocks.
  * Callers can erase blocks as long as they have time to kill.
  * Results are immediately committed to the FlashEraseLog.
+ *
+ * We also do this in the background, one block per time slice, to keep
+ * a small pool of pre-erased blocks available for new volumes.
  */
 
 class FlashBlockPreEraser {
@@ -40,7 +44,25 @@ public:
 
     bool next();
 
+    static void heartbeat(unsigned beats);
+    static void task();
+
+    /// Beats we can sleep through before the next background slice is due
+    static ALWAYS_INLINE unsigned idleBeats() {
+        return MAX(countdown, 1u);
+    }
+
 private:
+    // Size of the pool we try to keep topped up, in map blocks
+    static const unsigned POOL_TARGET = 4;
+
+    // Heartbeats between background slices, while filling / when full / when out of space
+    static const unsigned FILL_INTERVAL = Tasks::HEARTBEAT_HZ;
+    static const unsigned FULL_INTERVAL = Tasks::HEARTBEAT_HZ * 10;
+    static const unsigned BACKOFF_INTERVAL = Tasks::HEARTBEAT_HZ * 60;
+
+    static unsigned countdown;
+
     FlashEraseLog log;
     FlashBlockRecycler recycler;
 };
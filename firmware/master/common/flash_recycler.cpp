@@ -31,10 +31,31 @@
 
 
 FlashBlockRecycler::FlashBlockRecycler(bool useEraseLog)
-    : useEraseLog(useEraseLog)
+    : useEraseLog(useEraseLog), scanned(false)
 {
     ASSERT(!dirtyVolume.ref.isHeld());
+    issuedBlocks.clear();
+}
+
+void FlashBlockRecycler::scan()
+{
+    /*
+     * Deferred until the first time we need a block that isn't in the
+     * erase log. Blocks we've already popped from the log aren't part of
+     * any volume yet, and they're no longer in the log either, so make
+     * sure they don't look like orphans.
+     */
+
+    ASSERT(!scanned);
+    scanned = true;
+
     findOrphansAndDeletedVolumes();
+
+    FlashMapBlock::Set iterSet = issuedBlocks;
+    unsigned index;
+    while (iterSet.clearFirst(index))
+        orphanBlocks.clear(index);
+
     findCandidateVolumes();
 }
 
@@ -110,13 +131,17 @@ void FlashBlockRecycler::findCandidateVolumes()
      * Using the results of findOrphansAndDeletedVolumes(),
      * create a set of "candidate" volumes, in which at least one
      * of the valid blocks has an erase count <= the average.
+     * Each candidate goes into a bucket according to its lowest
+     * erase count.
      *
      * In order to avoid deleting the erase log unless we're really
      * low on space, we never include erase log volumes in this initial
      * list of candidates.
      */
 
-    candidateVolumes.clear();
+    bool found = false;
+    for (unsigned i = 0; i != NUM_EC_BUCKETS; ++i)
+        candidateVolumes[i].clear();
 
     FlashMapBlock::Set iterSet = deletedVolumes;
     unsigned index;
@@ -137,13 +162,22 @@ void FlashBlockRecycler::findCandidateVolumes()
         ASSERT(FlashVolume::typeIsRecyclable(hdr->type));
         ASSERT(hdr->isHeaderValid());
 
+        EraseCount minEraseCount = averageEraseCount + 1;
+
         for (unsigned I = 0; I != numMapEntries; ++I) {
-            FlashMapBlock block = map->blocks[I];
-            if (block.isValid() && hdr->getEraseCount(eraseRef, block, I, numMapEntries) <= averageEraseCount) {
-                candidateVolumes.mark(index);
-                break;
+            if (map->blocks[I].isValid()) {
+                EraseCount ec = hdr->getEraseCount(eraseRef, block, I, numMapEntries);
+                if (ec < minEraseCount)
+                    minEraseCount = ec;
             }
         }
+
+        if (minEraseCount <= averageEraseCount) {
+            // Always < NUM_EC_BUCKETS, since minEraseCount < averageEraseCount + 1
+            uint64_t bucket = uint64_t(minEraseCount) * NUM_EC_BUCKETS / (averageEraseCount + 1);
+            candidateVolumes[bucket].mark(index);
+            found = true;
+        }
     }
 
     /*
@@ -153,8 +187,9 @@ void FlashBlockRecycler::findCandidateVolumes()
      * candidates.
      */
 
-    if (candidateVolumes.empty()) {
-        candidateVolumes = deletedVolumes;
+    if (!found) {
+        FlashMapBlock::Set &fallback = candidateVolumes[NUM_EC_BUCKETS - 1];
+        fallback = deletedVolumes;
 
         /*
          * Still nothing?? Start recycling the volume(s) used to store our
@@ -164,11 +199,20 @@ void FlashBlockRecycler::findCandidateVolumes()
          * we'll dequeue from it.)
          */
 
-        if (useEraseLog && candidateVolumes.empty())
-            candidateVolumes = eraseLogVolumes;
+        if (useEraseLog && fallback.empty())
+            fallback = eraseLogVolumes;
     }
 }
 
+bool FlashBlockRecycler::nextCandidate(unsigned &index)
+{
+    // Take a volume from the least-worn nonempty bucket
+    for (unsigned i = 0; i != NUM_EC_BUCKETS; ++i)
+        if (candidateVolumes[i].clearFirst(index))
+            return true;
+    return false;
+}
+
 bool FlashBlockRecycler::next(FlashMapBlock &block, EraseCount &eraseCount)
 {
     /*
@@ -188,10 +232,15 @@ bool FlashBlockRecycler::next(FlashMapBlock &block, EraseCount &eraseCount)
         if (eraseLog.pop(rec)) {
             block = rec.block;
             eraseCount = rec.ec;
+            if (!scanned)
+                block.mark(issuedBlocks);
             return true;
         }
     }
 
+    if (!scanned)
+        scan();
+
     /*
      * We must start with orphaned blocks. See the explanation in the class
      * comment for FlashBlockRecycler. This part is easy- we assume they're
@@ -237,9 +286,9 @@ bool FlashBlockRecycler::next(FlashMapBlock &block, EraseCount &eraseCount)
          */
 
         unsigned index;
-        if (!candidateVolumes.clearFirst(index)) {
+        if (!nextCandidate(index)) {
             findCandidateVolumes();
-            if (!candidateVolumes.clearFirst(index))
+            if (!nextCandidate(index))
                 return false;
         }
         vol = FlashMapBlock::fromIndex(index);
@@ -78,6 +78,11 @@
  * our approach involves keeping a set of candidate volumes in which at least
  * one of their blocks has an erase count <= the average. This candidate list
  * is always preferred when searching for blocks to recycle.
+ *
+ * Candidates are bucketed by their lowest erase count, in equal slices of
+ * the range [0, average]. We drain the least-worn bucket first. That's a
+ * coarse histogram, but it keeps selection O(1) while steering heavy churn
+ * away from the most-worn blocks.
  */
 
 class FlashBlockRecycler {
@@ -95,6 +100,9 @@ public:
      * which is optional. By default, it is consulted first.
      *
      * The returned block is guaranteed to be erased.
+     *
+     * The device is only scanned for recyclable blocks once the erase log
+     * runs dry, so a well-stocked erase log makes this cheap.
      */
     bool next(FlashMapBlock &block, EraseCount &eraseCount);
 
@@ -102,15 +110,21 @@ private:
     FlashMapBlock::Set orphanBlocks;            // Not reachable from anywhere
     FlashMapBlock::Set deletedVolumes;          // Header blocks for deleted volumes
     FlashMapBlock::Set eraseLogVolumes;         // Blocks used to store the erase log
-    FlashMapBlock::Set candidateVolumes;        // Current list of recycling candidates
+    static const unsigned NUM_EC_BUCKETS = 4;
+
+    FlashMapBlock::Set candidateVolumes[NUM_EC_BUCKETS];  // Recycling candidates, least worn first
+    FlashMapBlock::Set issuedBlocks;            // Returned by next() before we scanned
     uint32_t averageEraseCount;
     bool useEraseLog;
+    bool scanned;
 
     FlashEraseLog eraseLog;
     FlashBlockWriter dirtyVolume;
 
+    void scan();
     void findOrphansAndDeletedVolumes();
     void findCandidateVolumes();
+    bool nextCandidate(unsigned &index);
 };
 
 
@@ -38,6 +38,7 @@ void FlashStack::init()
     FlashDevice::init();
     FlashBlock::init();
     FlashLFSCache::invalidate();
+    FlashVolumeIter::invalidateCache();
 }
 
 
@@ -45,19 +46,12 @@ void FlashStack::invalidateCache(unsigned flags)
 {
     FlashBlock::invalidate(flags);
     FlashLFSCache::invalidate();
+    FlashVolumeIter::invalidateCache();
 }
 
 
-void FlashStack::reformatDevice()
+void FlashStack::eraseDevice()
 {
-    /*
-     * Do a physical wipe of the flash device.
-     *
-     * Bonus: since we now know everything is erased, we can mark all blocks as
-     * pre-erased, allowing subsequent write operations to avoid erasing
-     * what would otherwise be considered "orphaned" blocks.
-     */
-
     FlashDevice::eraseAll();
 
     // max timeout for chip erase is 200 seconds (!)
@@ -75,6 +69,19 @@ void FlashStack::reformatDevice()
      */
 
     invalidateCache(FlashBlock::F_ABORT_TRAP);
+}
+
+void FlashStack::reformatDevice()
+{
+    /*
+     * Do a physical wipe of the flash device.
+     *
+     * Bonus: since we now know everything is erased, we can mark all blocks as
+     * pre-erased, allowing subsequent write operations to avoid erasing
+     * what would otherwise be considered "orphaned" blocks.
+     */
+
+    eraseDevice();
 
     /*
      * Log the erased blocks only after we're sure they have finished erasing
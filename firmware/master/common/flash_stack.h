@@ -44,6 +44,13 @@ namespace FlashStack {
      */
     void reformatDevice();
 
+    /**
+     * Physically erase the entire device and invalidate all caches,
+     * without pre-erasing anything. For callers that are about to
+     * write raw contents over the whole device.
+     */
+    void eraseDevice();
+
 } // end namespace FlashStack
 
 
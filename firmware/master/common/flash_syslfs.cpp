@@ -31,6 +31,34 @@
 #include "cubeslots.h"
 #include "cubeconnector.h"
 #include "svmloader.h"
+#include "tasks.h"
+
+namespace SysLFS {
+
+    struct DeferredWrite {
+        uint8_t key;
+        uint8_t size;
+        uint8_t data[MAX_DEFERRED_BYTES];
+    };
+
+    // Heartbeats from the first deferred write until the flush
+    const unsigned FLUSH_DELAY = Tasks::HEARTBEAT_HZ;
+
+    // Heartbeats from a write until we look for garbage, and between GC passes
+    const unsigned COMPACT_DELAY = Tasks::HEARTBEAT_HZ * 10;
+
+    // Don't bother compacting an LFS with this many volumes or fewer
+    const unsigned COMPACT_MIN_VOLUMES = 2;
+
+    static DeferredWrite deferred[NUM_DEFERRED_WRITES];
+    static BitVector<NUM_DEFERRED_WRITES> deferredValid;
+    static unsigned flushCountdown;
+    static unsigned compactCountdown;
+    static bool compactDue;
+
+    static bool findDeferred(Key k, unsigned &index);
+    static void flushDeferred(unsigned index);
+}
 
 
 int SysLFS::read(Key k, uint8_t *buffer, unsigned bufferSize)
@@ -40,6 +68,14 @@ int SysLFS::read(Key k, uint8_t *buffer, unsigned bufferSize)
     STATIC_ASSERT(kEnd == 0x100);
     ASSERT(FlashLFSIndexRecord::isKeyAllowed(k));
 
+    // Newer than anything in flash
+    unsigned index;
+    if (findDeferred(k, index)) {
+        unsigned size = MIN(deferred[index].size, bufferSize);
+        memcpy(buffer, deferred[index].data, size);
+        return size;
+    }
+
     FlashLFS &lfs = SysLFS::get();
     FlashLFSObjectIter iter(lfs);
 
@@ -60,6 +96,11 @@ int SysLFS::write(Key k, const uint8_t *data, unsigned dataSize, bool gc)
     ASSERT(FlashLFSIndexRecord::isKeyAllowed(k));
     ASSERT(FlashLFSIndexRecord::isSizeAllowed(dataSize));
 
+    // This write supersedes any deferred one
+    unsigned index;
+    if (findDeferred(k, index))
+        deferredValid.clear(index);
+
     CrcStream cs;
     cs.reset();
     cs.addBytes(data, dataSize);
@@ -94,9 +135,136 @@ int SysLFS::write(Key k, const uint8_t *data, unsigned dataSize, bool gc)
 
     FlashBlock::invalidate(allocator.address(), allocator.address() + dataSize);
     FlashDevice::write(allocator.address(), data, dataSize);
+
+    if (!compactCountdown && !compactDue)
+        compactCountdown = COMPACT_DELAY;
+
     return dataSize;
 }
 
+bool SysLFS::findDeferred(Key k, unsigned &index)
+{
+    BitVector<NUM_DEFERRED_WRITES> vec = deferredValid;
+    while (vec.clearFirst(index))
+        if (deferred[index].key == k)
+            return true;
+    return false;
+}
+
+void SysLFS::writeDeferred(Key k, const uint8_t *data, unsigned dataSize)
+{
+    ASSERT(FlashLFSIndexRecord::isKeyAllowed(k));
+    ASSERT(dataSize <= MAX_DEFERRED_BYTES);
+
+    unsigned index;
+    if (!findDeferred(k, index)) {
+        BitVector<NUM_DEFERRED_WRITES> unused = deferredValid;
+        unused.invert();
+        if (!unused.findFirst(index)) {
+            // No room to defer it. Write through.
+            write(k, data, dataSize);
+            return;
+        }
+
+        // Start the clock on the first write since the last flush
+        if (deferredValid.empty())
+            flushCountdown = FLUSH_DELAY;
+
+        deferred[index].key = k;
+        deferredValid.mark(index);
+    }
+
+    deferred[index].size = dataSize;
+    memcpy(deferred[index].data, data, dataSize);
+}
+
+void SysLFS::flushDeferred(unsigned index)
+{
+    // Copy it out first; write() may let someone defer another record
+    DeferredWrite dw = deferred[index];
+    deferredValid.clear(index);
+    write(Key(dw.key), dw.data, dw.size);
+}
+
+void SysLFS::flush()
+{
+    unsigned index;
+    while (deferredValid.findFirst(index))
+        flushDeferred(index);
+    flushCountdown = 0;
+}
+
+void SysLFS::heartbeat(unsigned beats)
+{
+    if (flushCountdown) {
+        if (flushCountdown > beats) {
+            flushCountdown -= beats;
+        } else {
+            flushCountdown = 0;
+            Tasks::trigger(Tasks::SysLFSWriter);
+        }
+    }
+
+    if (compactCountdown) {
+        if (compactCountdown > beats) {
+            compactCountdown -= beats;
+        } else {
+            compactCountdown = 0;
+            compactDue = true;
+            Tasks::trigger(Tasks::SysLFSWriter);
+        }
+    }
+}
+
+unsigned SysLFS::idleBeats()
+{
+    unsigned beats = Tasks::MAX_IDLE_BEATS;
+    if (flushCountdown)
+        beats = MIN(beats, flushCountdown);
+    if (compactCountdown)
+        beats = MIN(beats, compactCountdown);
+    return beats;
+}
+
+void SysLFS::task()
+{
+    /*
+     * One background time slice. Deferred writes go out first, one record
+     * at a time, so we can give up the CPU if they run over budget.
+     */
+
+    unsigned index;
+    if (!flushCountdown) {
+        while (deferredValid.findFirst(index)) {
+            flushDeferred(index);
+            if (Tasks::overBudget()) {
+                Tasks::trigger(Tasks::SysLFSWriter);
+                return;
+            }
+        }
+    }
+
+    /*
+     * Then at most one pass of local garbage collection, if SysLFS has
+     * spread out over more volumes than it needs. This can erase a block,
+     * so stay out of the way of USB transfers and asset loading. If GC
+     * found anything, there may be more to do; check back later.
+     */
+
+    if (compactDue && deferredValid.empty()) {
+        compactDue = false;
+
+        if (Tasks::isPending(Tasks::UsbOUT) || Tasks::isPending(Tasks::AssetLoader)) {
+            compactCountdown = COMPACT_DELAY;
+            return;
+        }
+
+        FlashLFS &lfs = get();
+        if (lfs.volumes.numSlotsInUse > COMPACT_MIN_VOLUMES && lfs.collectLocalGarbage())
+            compactCountdown = COMPACT_DELAY;
+    }
+}
+
 SysLFS::Key SysLFS::CubeRecord::makeKey(_SYSCubeID cube)
 {
     // CubeSlots store their own mapping back to their paired CubeRecord key
@@ -211,6 +379,17 @@ void SysLFS::PairingMRURecord::load()
     ASSERT(missing.empty());
 }
 
+void SysLFS::PairingHintRecord::init()
+{
+    memset(this, UNKNOWN, sizeof *this);
+}
+
+void SysLFS::PairingHintRecord::load()
+{
+    if (!readObject(SysLFS::kPairingHints, *this))
+        init();
+}
+
 bool SysLFS::PairingMRURecord::access(unsigned index)
 {
     /*
@@ -572,6 +751,7 @@ void SysLFS::AssetSlotRecord::init()
     flags = 0;
     memset(crc, 0x00, sizeof crc);
     memset(groups, 0xff, sizeof groups);
+    memset(contentKeys, 0x00, sizeof contentKeys);
 }
 
 bool SysLFS::AssetSlotRecord::load(const FlashLFSObjectIter &iter)
@@ -588,9 +768,16 @@ bool SysLFS::AssetSlotRecord::load(const FlashLFSObjectIter &iter)
 unsigned SysLFS::AssetSlotRecord::writeableSize() const
 {
     // How many bytes do we need to write for this record?
+    // The content keys sit after the full groups[] array, so any
+    // nonempty record has to include all of groups[].
 
-    STATIC_ASSERT(sizeof flags + sizeof crc + sizeof groups == sizeof *this);
-    return totalGroups() * sizeof groups[0] + sizeof flags + sizeof crc;
+    STATIC_ASSERT(sizeof flags + sizeof crc + sizeof groups + sizeof contentKeys == sizeof *this);
+
+    unsigned count = totalGroups();
+    if (!count)
+        return sizeof flags + sizeof crc;
+
+    return offsetof(AssetSlotRecord, contentKeys) + count * sizeof contentKeys[0];
 }
 
 bool SysLFS::AssetSlotRecord::findGroup(AssetGroupIdentity identity, unsigned &offset) const
@@ -625,8 +812,42 @@ bool SysLFS::AssetSlotRecord::findGroup(AssetGroupIdentity identity, unsigned &o
     return false;
 }
 
+bool SysLFS::AssetSlotRecord::findGroupByContent(AssetGroupContentKey key,
+    unsigned numTiles, unsigned &offset) const
+{
+    /*
+     * Like findGroup(), but matching on content rather than identity.
+     * The group may belong to any volume, including one that's since
+     * been deleted. Groups with unknown content never match.
+     */
+
+    ASSERT(!key.isUnknown());
+
+    AssetGroupSize size = AssetGroupSize::fromTileCount(numTiles);
+    unsigned inProgress = flags & F_LOAD_IN_PROGRESS;
+    unsigned currentOffset = 0;
+
+    for (unsigned i = 0; i < ASSET_GROUPS_PER_SLOT; ++i) {
+        const LoadedAssetGroupRecord &group = groups[i];
+
+        if (group.isEmpty())
+            break;
+        if (inProgress && (i + 1) < ASSET_GROUPS_PER_SLOT && groups[i + 1].isEmpty())
+            break;
+
+        if (contentKeys[i] == key && group.size.code == size.code) {
+            offset = currentOffset;
+            return true;
+        }
+
+        currentOffset += group.size.tileCount();
+    }
+
+    return false;
+}
+
 bool SysLFS::AssetSlotRecord::allocGroup(AssetGroupIdentity identity,
-    unsigned numTiles, unsigned &offset)
+    AssetGroupContentKey key, unsigned numTiles, unsigned &offset)
 {
     /*
      * Append a record for the given group identity. On success, writes
@@ -655,6 +876,7 @@ bool SysLFS::AssetSlotRecord::allocGroup(AssetGroupIdentity identity,
 
             group.size = AssetGroupSize::fromTileCount(numTiles);
             group.identity = identity;
+            contentKeys[i] = key;
             offset = currentOffset;
             return true;
         }
@@ -751,9 +973,13 @@ void SysLFS::invalidateClients()
      * either directly (SysLFS::deleteAll()) or indirectly (FlashStack::deleteEverything()).
      *
      * These changes aren't necessarily visible to SysLFS clients,
-     * so update their state accordingly.
+     * so update their state accordingly. Deferred writes belong to the
+     * old SysLFS, so drop them.
      */
 
+    deferredValid.clear();
+    flushCountdown = 0;
+
     CubeConnector::onSysLFSInvalidated();
 }
 
@@ -791,6 +1017,9 @@ void SysLFS::cleanupDeletedVolumes()
      * iteration loop.
      */
 
+    // We iterate over records directly, so deferred writes must be in flash
+    flush();
+
     /*
      * Iterate over volumes once, to build a map of which volumes still exist.
      * We must explicitly avoid adding deleted volumes to this set!
@@ -916,6 +1145,7 @@ bool SysLFS::AssetSlotRecord::cleanupDeletedVolumes(const FlashMapBlock::Set &al
         if (vol.isValid() && !vol.test(allVolumes) && !SvmLoader::isVolumeMapped(vol)) {
             // Found a deleted volume. Invalidate its volume code, but leave the rest of the slot intact.
             // This will prevent the deleted group from being used, but other groups will still be usable.
+            // Its content key stays, so another volume with identical assets can still share it.
 
             memset(&id, 0, sizeof id);
             changed = true;
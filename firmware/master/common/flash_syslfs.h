@@ -77,7 +77,8 @@ namespace SysLFS {
      */
 
     enum Key {
-        kBluetoothBase  = 14,
+        kPairingHints   = 13,
+        kBluetoothBase,
         kFaultBase      = kBluetoothBase + NUM_BLUETOOTH,
         kPairingMRU     = kFaultBase + NUM_FAULTS,
         kPairingID,
@@ -107,6 +108,7 @@ namespace SysLFS {
 
     enum FaultRecordType {
         kFaultSVM = 1,
+        kFaultRepeat,
     };
 
     struct FaultHeader {
@@ -154,6 +156,20 @@ namespace SysLFS {
         FaultMemoryDumps mem;
     };
 
+    /*
+     * A fault identical to the one logged just before it (same volume,
+     * code, and PC) gets this compact record instead of another full one.
+     * Further repeats rewrite it in place. The reference number is the
+     * same as the full record's, so users report the same number each time.
+     */
+
+    struct FaultRecordRepeat {
+        FaultHeader header;         // 'uptime' is from the latest repeat
+        uint32_t pc;
+        uint16_t count;             // Times seen, including the full record
+        uint16_t reserved;
+    };
+
     /*
      * Pairing data.
      *
@@ -181,6 +197,22 @@ namespace SysLFS {
         bool access(unsigned index);
     };
 
+    /*
+     * The RF channel each paired cube last answered a reconnect on.
+     * Cubes listen on either a primary or an alternate channel, and this
+     * tells us which one to try first. It's only a hint; a stale entry
+     * costs us one extra ping.
+     */
+
+    struct PairingHintRecord {
+        uint8_t channel[NUM_PAIRINGS];
+
+        static const uint8_t UNKNOWN = 0xFF;
+
+        void init();
+        void load();
+    };
+
     /*
      * Per-cube data for connected cubes.
      *
@@ -276,6 +308,24 @@ namespace SysLFS {
         }
     };
 
+    /*
+     * Identifies a group by what it contains rather than where it came
+     * from, so identical groups from different volumes can share one copy
+     * on the cube. All zeroes means unknown; see AssetGroupInfo::contentKey().
+     */
+    struct AssetGroupContentKey {
+        uint8_t bytes[4];
+
+        bool isUnknown() const {
+            return (bytes[0] | bytes[1] | bytes[2] | bytes[3]) == 0;
+        }
+
+        bool operator == (AssetGroupContentKey other) const {
+            return bytes[0] == other.bytes[0] && bytes[1] == other.bytes[1] &&
+                   bytes[2] == other.bytes[2] && bytes[3] == other.bytes[3];
+        }
+    };
+
     struct AssetSlotRecord {
         enum Flags {
             F_LOAD_IN_PROGRESS = (1 << 0),
@@ -284,14 +334,19 @@ namespace SysLFS {
         uint8_t flags;
         uint8_t crc[_SYS_ASSET_GROUP_CRC_SIZE];
 
-        // Variable size. Empty groups can be truncated when writing.
         LoadedAssetGroupRecord groups[ASSET_GROUPS_PER_SLOT];
 
+        // Parallel to groups[]. Variable size; keys past the last group are
+        // truncated when writing, and older records may not have any at all.
+        AssetGroupContentKey contentKeys[ASSET_GROUPS_PER_SLOT];
+
         static Key makeKey(Key cubeKey, unsigned slot);
         static bool decodeKey(Key slotKey, Key &cubeKey, unsigned &slot);
 
         bool findGroup(AssetGroupIdentity identity, unsigned &offset) const;
-        bool allocGroup(AssetGroupIdentity identity, unsigned numTiles, unsigned &offset);
+        bool findGroupByContent(AssetGroupContentKey key, unsigned numTiles, unsigned &offset) const;
+        bool allocGroup(AssetGroupIdentity identity, AssetGroupContentKey key,
+            unsigned numTiles, unsigned &offset);
         unsigned totalTiles() const;
         unsigned totalGroups() const;
         bool isEmpty() const;
@@ -315,7 +370,8 @@ namespace SysLFS {
         STATIC_ASSERT(kEnd <= _SYS_FS_MAX_OBJECT_KEYS);
         STATIC_ASSERT(sizeof(FlashMapBlock) == 1);
         STATIC_ASSERT(sizeof(LoadedAssetGroupRecord) == 3);
-        STATIC_ASSERT(sizeof(AssetSlotRecord) == 3 * ASSET_GROUPS_PER_SLOT + 1 + 16);
+        STATIC_ASSERT(sizeof(AssetGroupContentKey) == 4);
+        STATIC_ASSERT(sizeof(AssetSlotRecord) == (3 + 4) * ASSET_GROUPS_PER_SLOT + 1 + 16);
         STATIC_ASSERT(sizeof(AssetSlotOverviewRecord) == 4);
         STATIC_ASSERT(sizeof(CubeRecord) == ASSET_SLOTS_PER_CUBE * sizeof(AssetSlotOverviewRecord));
 
@@ -336,6 +392,43 @@ namespace SysLFS {
         return write(k, (const uint8_t*) &obj, sizeof obj, gc) == sizeof obj;
     }
 
+    /*
+     * Deferred writes.
+     *
+     * For records that change often, but whose latest version isn't needed
+     * for consistency after a power loss: the pairing MRU order, reconnect
+     * channel hints, and asset slot access ranks. Repeated writes to the
+     * same key are coalesced in RAM, and a low-priority task flushes them
+     * shortly afterwards. Shutdown flushes them too.
+     *
+     * read() sees deferred data, and a regular write() to the same key
+     * supersedes it. Code that iterates over SysLFS records directly
+     * must flush() first.
+     */
+
+    const unsigned NUM_DEFERRED_WRITES = 12;
+    const unsigned MAX_DEFERRED_BYTES = sizeof(CubeRecord);
+
+    void writeDeferred(Key k, const uint8_t *data, unsigned dataSize);
+
+    template <typename T>
+    inline void writeObjectDeferred(Key k, const T &obj) {
+        STATIC_ASSERT(sizeof obj <= MAX_DEFERRED_BYTES);
+        writeDeferred(k, (const uint8_t*) &obj, sizeof obj);
+    }
+
+    void flush();
+
+    /*
+     * Background work: deferred writes, and compaction. After SysLFS has
+     * been written to, we periodically collect its local garbage, so its
+     * index stays short and foreground writes rarely have to wait for GC.
+     */
+
+    void heartbeat(unsigned beats);
+    void task();
+    unsigned idleBeats();
+
     void deleteAll();
     void deleteCube(unsigned index);
     void invalidateClients();
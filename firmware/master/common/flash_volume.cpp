@@ -242,6 +242,10 @@ void FlashVolume::deleteEverything()
     SysLFS::invalidateClients();
 }
 
+FlashMapBlock::Set FlashVolumeIter::cachedHeaders;
+unsigned FlashVolumeIter::cacheGeneration;
+bool FlashVolumeIter::cacheValid;
+
 bool FlashVolumeIter::next(FlashVolume &vol)
 {
     unsigned index;
@@ -251,24 +255,41 @@ bool FlashVolumeIter::next(FlashVolume &vol)
     while (remaining.clearFirst(index)) {
         FlashVolume v(FlashMapBlock::fromIndex(index));
 
-        if (v.isValid()) {
-            FlashBlockRef ref;
-            FlashVolumeHeader *hdr = FlashVolumeHeader::get(ref, v.block);
-            ASSERT(hdr->isHeaderValid());
-            const FlashMap *map = hdr->getMap();
-
-            // Don't visit any future blocks that are part of this volume
-            for (unsigned I = 0, E = hdr->numMapEntries(); I != E; ++I) {
-                FlashMapBlock block = map->blocks[I];
-                if (block.isValid())
-                    block.clear(remaining);
-            }
+        if (!v.isValid()) {
+            // Can't become valid again without FlashVolumeWriter::begin()
+            v.block.clear(cachedHeaders);
+            continue;
+        }
+
+        /*
+         * Cache every valid header, even one that's part of a volume we
+         * already visited. It will become visible if that volume is recycled.
+         */
+        v.block.mark(cachedHeaders);
+
+        if (v.block.test(covered))
+            continue;
 
-            vol = v;
-            return true;
+        FlashBlockRef ref;
+        FlashVolumeHeader *hdr = FlashVolumeHeader::get(ref, v.block);
+        ASSERT(hdr->isHeaderValid());
+        const FlashMap *map = hdr->getMap();
+
+        // Don't visit any future blocks that are part of this volume
+        for (unsigned I = 0, E = hdr->numMapEntries(); I != E; ++I) {
+            FlashMapBlock block = map->blocks[I];
+            if (block.isValid())
+                block.mark(covered);
         }
+
+        vol = v;
+        return true;
     }
 
+    // A complete pass. Unless the cache was invalidated meanwhile, it's good now.
+    if (generation == cacheGeneration)
+        cacheValid = true;
+
     return false;
 }
 
@@ -298,6 +319,9 @@ bool FlashVolumeWriter::begin(FlashBlockRecycler &recycler,
         return false;
     }
 
+    // New header, make sure FlashVolumeIter can find it
+    FlashVolumeIter::addToCache(volume.block);
+
     // Finish writing
     writer.commitBlock();
     ASSERT(volume.isValid());
@@ -566,17 +590,20 @@ uint32_t FlashVolume::signHandle(uint32_t h)
     return b.code | (Crc32::get() & 0xFFFFFF00);
 }
 
-bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package)
+bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package,
+    FlashVolume keep)
 {
     /**
      * Start writing a game, after deleting any existing game volumes with
-     * the same package name.
+     * the same package name. If 'keep' is valid, it must be one of those
+     * volumes, and it survives until the caller deletes it.
      */
 
     SysLFS::cleanupDeletedVolumes();
 
     FlashVolumeIter vi;
     FlashVolume vol;
+    bool keepFound = false;
 
     vi.begin();
     while (vi.next(vol)) {
@@ -587,11 +614,18 @@ bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package)
         Elf::Program program;
         if (program.init(vol.getPayload(ref))) {
             const char *str = program.getMetaString(ref, _SYS_METADATA_PACKAGE_STR);
-            if (str && !strcmp(str, package))
-                vol.deleteTree();
+            if (str && !strcmp(str, package)) {
+                if (vol.block.code == keep.block.code)
+                    keepFound = true;
+                else
+                    vol.deleteTree();
+            }
         }
     }
 
+    if (keep.block.isValid() && !keepFound)
+        return false;
+
     FlashBlockRecycler recycler;
     return begin(recycler, FlashVolume::T_GAME, payloadBytes);
 }
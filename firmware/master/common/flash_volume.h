@@ -171,6 +171,12 @@ private:
 /**
  * A lightweight iterator, capable of finding all valid FlashVolumes on
  * the device.
+ *
+ * The first complete iteration visits every block, and remembers which
+ * ones held a valid volume header. Later iterations only visit those
+ * blocks. This set may include blocks which are no longer valid headers,
+ * but it must never be missing one. The only way to create a new header
+ * is FlashVolumeWriter::begin(), which adds it to the set.
  */
 class FlashVolumeIter
 {
@@ -178,15 +184,38 @@ public:
     /// Reset the iterator back to the beginning of the sequence
     void begin() {
         DEBUG_ONLY(initialized = true);
-        remaining.mark();
+        generation = cacheGeneration;
+        covered.clear();
+        if (cacheValid)
+            remaining = cachedHeaders;
+        else
+            remaining.mark();
     }
 
     /// Returns 'true' iff another FlashVolume can be found.
     bool next(FlashVolume &vol);
 
+    /// A new volume header may have been written to this block
+    static void addToCache(FlashMapBlock block) {
+        block.mark(cachedHeaders);
+    }
+
+    /// Forget all cached header locations, after writing to flash behind our back
+    static void invalidateCache() {
+        cacheValid = false;
+        cachedHeaders.clear();
+        cacheGeneration++;
+    }
+
 private:
     FlashMapBlock::Set remaining;
+    FlashMapBlock::Set covered;     // Part of a volume we've already returned
+    unsigned generation;
     DEBUG_ONLY(bool initialized;)
+
+    static FlashMapBlock::Set cachedHeaders;
+    static unsigned cacheGeneration;
+    static bool cacheValid;
 };
 
 /**
@@ -222,8 +251,13 @@ public:
     /**
      * Start writing a game, after deleting any existing game volumes with
      * the same package name.
+     *
+     * If 'keep' is valid, it must be one of those existing volumes. It's
+     * left in place, so that a delta install can copy payload data from
+     * it, and the caller is responsible for deleting it after commit().
      */
-    bool beginGame(unsigned payloadBytes, const char *package);
+    bool beginGame(unsigned payloadBytes, const char *package,
+        FlashVolume keep = FlashMapBlock::invalid());
 
     /**
      * Start writing the launcher, after deleting any existing launcher.
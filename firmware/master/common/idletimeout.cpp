@@ -39,7 +39,7 @@
 
 unsigned IdleTimeout::countdown = IdleTimeout::IDLE_TIMEOUT_SYSTICKS;
 
-void IdleTimeout::heartbeat()
+void IdleTimeout::heartbeat(unsigned beats)
 {
     ASSERT(countdown > 0);
 
@@ -48,7 +48,9 @@ void IdleTimeout::heartbeat()
      * in via USB, don't bother counting down to yet another shutdown event.
      */
 
-    if (--countdown == 0) {
+    if (countdown > beats) {
+        countdown -= beats;
+    } else {
 
         reset();    // in case we come back, without actually powering down
 
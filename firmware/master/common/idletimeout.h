@@ -35,11 +35,17 @@ public:
         countdown = IDLE_TIMEOUT_SYSTICKS;
     }
 
-    static void heartbeat();
+    static void heartbeat(unsigned beats);
+
+    /// Beats we can sleep through before the countdown expires
+    static ALWAYS_INLINE unsigned idleBeats() {
+        return countdown;
+    }
 
 private:
     /*
      * Heartbeat is at 10Hz, our idle timeout is 10 minutes.
+     * Counts down by however many beats each heartbeat covers.
      */
     static const unsigned IDLE_TIMEOUT_SYSTICKS = 10 * 60 * 10;
     static unsigned countdown;
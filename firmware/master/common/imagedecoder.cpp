@@ -27,7 +27,16 @@
 #include "cube.h"
 #include "assetutil.h"
 #include "vram.h"
+#include <string.h>
 
+ImageDecoder::CacheEntry ImageDecoder::cache[CACHE_ENTRIES];
+
+
+void ImageDecoder::invalidateCache()
+{
+    for (unsigned i = 0; i < CACHE_ENTRIES; ++i)
+        cache[i].pData = 0;
+}
 
 bool ImageDecoder::init(const _SYSAssetImage *userPtr)
 {
@@ -126,11 +135,24 @@ int ImageDecoder::tile(unsigned x, unsigned y, unsigned frame)
 
             if (blockCache.index != blockNum) {
                 // This block isn't in the cache. Calculate the rest of its
-                // size, and decompress it into the cache.
+                // size, and fetch it from the shared cache or decompress it.
 
                 unsigned blockH = MIN(8, header.height - (y & ~7));
+                unsigned numTiles = blockW * blockH;
+                CacheEntry &entry = cache[(blockNum + header.pData) & CACHE_MASK];
                 blockCache.index = blockNum;
-                if (!decompressDUB(blockNum, blockW * blockH)) {
+
+                if (header.pData && entry.pData == header.pData &&
+                    entry.blockNum == blockNum && entry.baseAddr == baseAddr) {
+                    memcpy(blockCache.data, entry.data, numTiles * sizeof entry.data[0]);
+
+                } else if (decompressDUB(blockNum, numTiles)) {
+                    entry.pData = header.pData;
+                    entry.blockNum = blockNum;
+                    entry.baseAddr = baseAddr;
+                    memcpy(entry.data, blockCache.data, numTiles * sizeof entry.data[0]);
+
+                } else {
                     // Failure. Cache the failure, so we can fail fast!
                     for (unsigned i = 0; i < arraysize(blockCache.data); i++)
                         blockCache.data[i] = NO_TILE;
@@ -146,6 +168,47 @@ int ImageDecoder::tile(unsigned x, unsigned y, unsigned frame)
     }
 }
 
+bool ImageDecoder::tileRow(unsigned x, unsigned y, unsigned frame,
+    uint16_t *dest, unsigned count)
+{
+    /*
+     * Fetch 'count' horizontally consecutive tiles at once, for image
+     * formats that store tiles in row order. Returns 'false' if this
+     * image or range needs to go through tile() instead.
+     */
+
+    if (y >= header.height || frame >= header.frames ||
+        x >= header.width || count > header.width - x)
+        return false;
+
+    unsigned location = x + (y + frame * header.height) * header.width;
+
+    switch (header.format) {
+
+        case _SYS_AIF_PINNED: {
+            uint16_t tile = header.pData + baseAddr + location;
+            for (unsigned i = 0; i != count; ++i)
+                dest[i] = tile++;
+            return true;
+        }
+
+        case _SYS_AIF_FLAT: {
+            if (SvmMemory::copyROData(ref, reinterpret_cast<SvmMemory::PhysAddr>(dest),
+                header.pData + (location << 1), count * sizeof dest[0])) {
+                for (unsigned i = 0; i != count; ++i)
+                    dest[i] += baseAddr;
+            } else {
+                for (unsigned i = 0; i != count; ++i)
+                    dest[i] = NO_TILE;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
 SvmMemory::VirtAddr ImageDecoder::readIndex(unsigned i)
 {
     /*
@@ -291,9 +354,8 @@ unsigned BitReader::read(unsigned bits)
         // Buffer another 32 bits
         ASSERT(bitCount <= 32);
         uint32_t newBits;
-        if (!SvmMemory::copyROData(ref, newBits, va))
+        if (!cursor.read(newBits))
             return 0;
-        va += sizeof(newBits);
         buffer |= (buffer_t)newBits << bitCount;
         bitCount += 32;
     }
@@ -394,9 +456,72 @@ uint32_t ImageIter::getDestBytes(uint32_t stride) const
     return words * 2;
 }
 
+bool ImageIter::copyRowsToVRAM(_SYSVideoBuffer &vbuf, uint16_t originAddr,
+    unsigned stride)
+{
+    /*
+     * Fast path for images that aren't block-compressed. Each row is
+     * fetched and written in runs that stay within one 32-word change
+     * group, so locking and change bits are applied once per run.
+     *
+     * Returns 'false' without writing anything if the image needs the
+     * general per-tile path.
+     */
+
+    if (blockMask != 0xFFFF || right <= left || bottom <= top)
+        return false;
+
+    uint16_t words[32];
+
+    for (unsigned row = top; row != bottom; ++row) {
+        unsigned addr = originAddr + (row - top) * stride;
+        unsigned srcX = left;
+
+        while (srcX != right) {
+            VRAM::truncateWordAddr(addr);
+            unsigned chunk = MIN(right - srcX, 32 - VRAM::indexCM1(addr));
+
+            if (!decoder.tileRow(srcX, row, frame, words, chunk)) {
+                if (row == top && srcX == left)
+                    return false;
+                for (unsigned i = 0; i != chunk; ++i)
+                    words[i] = decoder.tile(srcX + i, row, frame);
+            }
+            for (unsigned i = 0; i != chunk; ++i)
+                words[i] = _SYS_TILE77(words[i]);
+
+            VRAM::pokeGroup(vbuf, addr, words, chunk);
+            addr += chunk;
+            srcX += chunk;
+        }
+    }
+
+    return true;
+}
+
+bool ImageIter::copyRowsToMem(uint16_t *dest, unsigned stride)
+{
+    // Like copyRowsToVRAM(), for plain memory.
+
+    if (blockMask != 0xFFFF || right <= left || bottom <= top)
+        return false;
+
+    unsigned width = right - left;
+
+    for (unsigned row = top; row != bottom; ++row, dest += stride)
+        if (!decoder.tileRow(left, row, frame, dest, width))
+            for (unsigned i = 0; i != width; ++i)
+                dest[i] = decoder.tile(left + i, row, frame);
+
+    return true;
+}
+
 void ImageIter::copyToVRAM(_SYSVideoBuffer &vbuf, uint16_t originAddr,
     unsigned stride)
 {
+    if (copyRowsToVRAM(vbuf, originAddr, stride))
+        return;
+
     do {
         uint16_t addr = originAddr + getAddr(stride);
         VRAM::truncateWordAddr(addr);
@@ -406,6 +531,9 @@ void ImageIter::copyToVRAM(_SYSVideoBuffer &vbuf, uint16_t originAddr,
 
 void ImageIter::copyToMem(uint16_t *dest, unsigned stride)
 {
+    if (copyRowsToMem(dest, stride))
+        return;
+
     do {
         dest[getAddr(stride)] = tile();
     } while (next());
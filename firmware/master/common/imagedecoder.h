@@ -47,6 +47,7 @@ public:
     bool init(const _SYSAssetImage *userPtr);
 
     int tile(unsigned x, unsigned y, unsigned frame);
+    bool tileRow(unsigned x, unsigned y, unsigned frame, uint16_t *dest, unsigned count);
 
     ALWAYS_INLINE unsigned getWidth() const {
         return header.width;
@@ -60,12 +61,34 @@ public:
     // Other bits refer to the blocks themselves.
     uint16_t getBlockMask() const;
 
+    // Forget all decoded DUB blocks, when the VAs they came from are remapped
+    static void invalidateCache();
+
 private:
     struct {
         uint16_t data[64];
         unsigned index;
     } blockCache;
 
+    /*
+     * Decoded DUB blocks, shared by every ImageDecoder. blockCache above
+     * only lives as long as one syscall; this direct-mapped cache keeps
+     * blocks across calls, so redrawing or scrolling the same image doesn't
+     * run the bit reader again. Keyed by image address, block, and the
+     * base address the tiles were relocated to.
+     */
+    static const unsigned CACHE_ENTRIES = 16;               // Must be a power of two
+    static const unsigned CACHE_MASK = CACHE_ENTRIES - 1;
+
+    struct CacheEntry {
+        SvmMemory::VirtAddr pData;  // Image this block belongs to, or zero
+        unsigned blockNum;
+        uint16_t baseAddr;
+        uint16_t data[64];
+    };
+
+    static CacheEntry cache[CACHE_ENTRIES];
+
     _SYSAssetImage header;
     uint16_t baseAddr;
     FlashBlockRef ref;
@@ -158,6 +181,9 @@ public:
     void copyToMem(uint16_t *dest, unsigned stride);
 
 private:
+    bool copyRowsToVRAM(_SYSVideoBuffer &vbuf, uint16_t originAddr, unsigned stride);
+    bool copyRowsToMem(uint16_t *dest, unsigned stride);
+
     ImageDecoder &decoder;
 
     uint16_t x;         // Current address within the image
@@ -182,7 +208,7 @@ private:
 class BitReader {
 public:
     BitReader(FlashBlockRef &ref, SvmMemory::VirtAddr va)
-        : buffer(0), bitCount(0), ref(ref), va(va) {}
+        : buffer(0), bitCount(0), cursor(ref, va) {}
 
     unsigned read(unsigned bits);
     unsigned readVar();
@@ -191,8 +217,7 @@ private:
     typedef uint64_t buffer_t;
     buffer_t buffer;
     unsigned bitCount;
-    FlashBlockRef &ref;
-    SvmMemory::VirtAddr va;
+    SvmROCursor cursor;
 };
 
 
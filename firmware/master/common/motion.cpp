@@ -25,6 +25,7 @@
 
 #include <string.h>
 #include "motion.h"
+#include "machine.h"
 
 
 _SYSByte4 MotionUtil::captureAccelState(const RF_ACKType &ack, uint8_t cubeVersion)
@@ -328,6 +329,7 @@ void MotionWriter::write(_SYSByte4 reading, SysTime::Ticks timestamp)
 
         // Overwrite the whole sample atomically
         prevSlot.value = reading.value;
+        sequence++;
         return;
     }
 
@@ -361,4 +363,32 @@ void MotionWriter::write(_SYSByte4 reading, SysTime::Ticks timestamp)
 
     // Make new data available to userspace
     buffer->header.tail = tail;
+    sequence++;
+}
+
+void MotionWriter::integrate(unsigned duration, _SYSInt3 *result)
+{
+    // Sample the sequence first; a write() during our scan invalidates the result
+    uint32_t seq = Atomic::Load(sequence);
+
+    if (integrateCache.sequence != seq || integrateCache.duration != duration) {
+        MotionUtil::integrate(mbuf, duration, &integrateCache.result);
+        integrateCache.duration = duration;
+        integrateCache.sequence = seq;
+    }
+
+    *result = integrateCache.result;
+}
+
+void MotionWriter::median(unsigned duration, _SYSMotionMedian *result)
+{
+    uint32_t seq = Atomic::Load(sequence);
+
+    if (medianCache.sequence != seq || medianCache.duration != duration) {
+        MotionUtil::median(mbuf, duration, &medianCache.result);
+        medianCache.duration = duration;
+        medianCache.sequence = seq;
+    }
+
+    *result = medianCache.result;
 }
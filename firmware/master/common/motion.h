@@ -65,12 +65,17 @@ class MotionWriter {
 public:
 	ALWAYS_INLINE void setBuffer(_SYSMotionBuffer *m) {
 		mbuf = m;
+		sequence++;     // Forget cached results
 	}
 
 	ALWAYS_INLINE bool hasBuffer() {
 		return mbuf != 0;
 	}
 
+	ALWAYS_INLINE bool isBuffer(const _SYSMotionBuffer *m) const {
+		return mbuf == m;
+	}
+
     /// Returns the buffer's suggested rate in ticks, if any, or an arbitrary large value otherwise.
     ALWAYS_INLINE unsigned getBufferRate() const {
         return mbuf ? mbuf->header.rate : -1;
@@ -79,9 +84,31 @@ public:
 	// Safe to call from ISR context
     void write(_SYSByte4 reading, SysTime::Ticks timestamp);
 
+    /*
+     * MotionUtil queries on our own buffer, from the main thread. The last
+     * result for each is kept until write() adds a sample, so repeated
+     * queries between samples (several filters reading the same cube, or
+     * frames faster than the capture rate) don't rescan the buffer.
+     */
+    void integrate(unsigned duration, _SYSInt3 *result);
+    void median(unsigned duration, _SYSMotionMedian *result);
+
 private:
     SysTime::Ticks lastTimestamp;		// Accessed by ISR only
     _SYSMotionBuffer *mbuf;				// Pointer written on main thread, read on ISR
+    uint32_t sequence;                  // Bumped by every write() and setBuffer()
+
+    struct {
+        uint32_t sequence;
+        unsigned duration;
+        _SYSInt3 result;
+    } integrateCache;
+
+    struct {
+        uint32_t sequence;
+        unsigned duration;
+        _SYSMotionMedian result;
+    } medianCache;
 };
 
 
@@ -35,6 +35,7 @@
 #ifdef SIFTEO_SIMULATOR
 #   include "system.h"
 #   include "system_mc.h"
+#   include "latencytracer.h"
 #   define PAINT_LOG(_x)    do { if (SystemMC::getSystem()->opt_paintTrace) { LOG(_x); }} while (0)
 #else
 #   define PAINT_LOG(_x)
@@ -139,6 +140,23 @@ static const SysTime::Ticks fpsHigh = SysTime::hzTicks(60);
 static const int8_t fpMax = 5;
 static const int8_t fpMin = -8;
 
+/*
+ * Pipelined painting, configured by _SYS_setPaintPipeline():
+ *
+ * pipelineDepth --
+ *    Replaces fpMax, when nonzero. Paint() only blocks once this many
+ *    frames are pending, and we enter continuous mode as soon as the
+ *    cube falls that far behind.
+ *
+ * pipelineInterval --
+ *    Replaces fpsHigh. We pace frames at the slower of this interval
+ *    and each cube's measured framePeriodUS, so that the queue stays
+ *    short instead of filling up in a burst and then stalling.
+ */
+
+uint8_t PaintControl::pipelineDepth;
+SysTime::Ticks PaintControl::pipelineInterval;
+
 
 void PaintControl::waitForPaint(CubeSlot *cube, uint32_t excludedTasks)
 {
@@ -168,8 +186,12 @@ void PaintControl::waitForPaint(CubeSlot *cube, uint32_t excludedTasks)
             break;
 
         // Wait for minimum frame rate AND for pending renders
-        if (now > paintTimestamp + fpsHigh && pendingFrames <= fpMax)
+        if (pipelineDepth) {
+            if (now > paintTimestamp + pipelinePeriod() && pendingFrames < pipelineDepth)
+                break;
+        } else if (now > paintTimestamp + fpsHigh && pendingFrames <= fpMax) {
             break;
+        }
 
         Tasks::idle(excludedTasks);
     }
@@ -206,6 +228,10 @@ void PaintControl::triggerPaint(CubeSlot *cube, SysTime::Ticks now)
     if (!cube->isSysConnected())
         return;
 
+    #ifdef SIFTEO_SIMULATOR
+    LatencyTracer::paint(cube->id());
+    #endif
+
     int32_t pending = Atomic::Load(pendingFrames);
     int32_t newPending = pending;
 
@@ -233,6 +259,7 @@ void PaintControl::triggerPaint(CubeSlot *cube, SysTime::Ticks now)
     if (needPaint) {
         VRAMFlags vf(vbuf);
         newPending++;
+        trackPaint(now);
 
         /*
          * There are multiple ways to enter continuous mode: vramFlushed()
@@ -247,12 +274,13 @@ void PaintControl::triggerPaint(CubeSlot *cube, SysTime::Ticks now)
          * if we see frames stacking up in newPending.
          */
 
-        if (newPending >= fpMax && allowContinuous(cube)) {
+        const int32_t maxPending = maxPendingFrames();
+        if (newPending >= maxPending && allowContinuous(cube)) {
             if (!vf.test(_SYS_VF_CONTINUOUS)) {
                 enterContinuous(cube, vbuf, vf, now);
                 vf.apply(vbuf);
             }
-            newPending = fpMax;
+            newPending = maxPending;
         }
 
         // When the codec calls us back in vramFlushed(), trigger a render
@@ -360,6 +388,11 @@ bool PaintControl::pollForFinish(CubeSlot *cube, SysTime::Ticks now)
             Atomic::And(vbuf->flags, ~_SYS_VBF_TRIGGER_ON_FLUSH);
 
             PAINT_LOG((LOG_PREFIX "-finish: trigger expired, done\n", LOG_PARAMS));
+
+            #ifdef SIFTEO_SIMULATOR
+            if (SystemMC::getSystem()->opt_paintTrace)
+                SystemMC::checkQuiescentVRAM(cube);
+            #endif
             return true;
         }
     }
@@ -377,8 +410,23 @@ void PaintControl::ackFrames(CubeSlot *cube, int32_t count)
      * we have synchronized our ACK bits with the cube's
      * TOGGLE bit, this means the frame has finished
      * rendering and we can clear the 'render' dirty bit.
+     *
+     * While frames were pending, the cube was busy the whole time since
+     * the last ACK, so that interval also tells us how fast this cube is
+     * actually rendering. That's what pipelined painting paces itself to.
      */
-    
+
+    SysTime::Ticks now = SysTime::ticks();
+
+    if (pendingFrames > 0 && count > 0) {
+        // Clamp before dividing, to keep 64-bit math out of the ISR
+        uint32_t elapsed = MIN(now - ackTimestamp, fpsLow);
+        int32_t us = elapsed / 1000 / count;
+        framePeriodUS += (us - int32_t(framePeriodUS)) >> 2;
+    }
+    ackTimestamp = now;
+    trackAck(cube, now, count);
+
     pendingFrames -= count;
 
     _SYSVideoBuffer *vbuf = cube->getVBuf();
@@ -465,6 +513,25 @@ bool PaintControl::vramFlushed(CubeSlot *cube)
     return false;
 }
 
+void PaintControl::setPipeline(unsigned depth, unsigned frameIntervalUS)
+{
+    STATIC_ASSERT(_SYS_MAX_PAINT_PIPELINE <= fpMax);
+    ASSERT(depth <= _SYS_MAX_PAINT_PIPELINE);
+
+    pipelineDepth = depth;
+    pipelineInterval = SysTime::usTicks(frameIntervalUS);
+}
+
+int32_t PaintControl::maxPendingFrames()
+{
+    return pipelineDepth ? pipelineDepth : fpMax;
+}
+
+SysTime::Ticks PaintControl::pipelinePeriod() const
+{
+    return MAX(pipelineInterval, SysTime::usTicks(framePeriodUS));
+}
+
 bool PaintControl::allowContinuous(CubeSlot *cube)
 {
     // Conserve cube CPU time during asset loading; don't use continuous rendering.
@@ -526,6 +593,7 @@ void PaintControl::makeSynchronous(CubeSlot *cube, _SYSVideoBuffer *vbuf)
     PAINT_LOG((LOG_PREFIX "makeSynchronous\n", LOG_PARAMS));
 
     pendingFrames = 0;
+    paintCount = 0;
 
     // We can only enter SYNC_ACK state if we know that vbuf's flags
     // match what's on real hardware. We know this after any vramFlushed().
@@ -552,6 +620,96 @@ bool PaintControl::canMakeSynchronous(CubeSlot *cube, _SYSVideoBuffer *vbuf,
         && timestamp > asyncTimestamp + fpsLow;
 }
 
+void PaintControl::resetStats()
+{
+    frames = 0;
+    ackPackets = 0;
+    packetsPerFrame = 0;
+    paintCount = 0;
+    memset(latencyHistogram, 0, sizeof latencyHistogram);
+}
+
+void PaintControl::trackPaint(SysTime::Ticks now)
+{
+    /*
+     * Remember when this frame was queued, so we can tell how long it
+     * took once the cube ACKs it. ACKs aren't strictly 1:1 with paints,
+     * and pendingFrames gets clamped and reset, so this is only an
+     * estimate. If the ring is full, the oldest frame is forgotten.
+     */
+
+    unsigned tail = (paintHead + paintCount) % MAX_TRACKED_FRAMES;
+    paintTimes[tail] = uint32_t(now >> 10);
+
+    if (paintCount < MAX_TRACKED_FRAMES)
+        paintCount++;
+    else
+        paintHead = (paintHead + 1) % MAX_TRACKED_FRAMES;
+}
+
+void PaintControl::trackAck(CubeSlot *cube, SysTime::Ticks now, int32_t count)
+{
+    // ISR context. Retire 'count' frames, and sample the newest one.
+
+    if (count <= 0)
+        return;
+
+    frames += count;
+
+    uint32_t packets = cube->getPacketCount();
+    uint32_t ppf = MIN((packets - ackPackets) << 8, 0xFFFFu) / count;
+    packetsPerFrame += (int32_t(ppf) - int32_t(packetsPerFrame)) >> 2;
+    ackPackets = packets;
+
+    if (!paintCount)
+        return;
+
+    unsigned retired = MIN(unsigned(count), unsigned(paintCount));
+    unsigned newest = (paintHead + retired - 1) % MAX_TRACKED_FRAMES;
+    paintHead = (paintHead + retired) % MAX_TRACKED_FRAMES;
+    paintCount -= retired;
+
+    // Timestamps are in units of 1.024 us; convert to microseconds
+    uint32_t delta = uint32_t(now >> 10) - paintTimes[newest];
+    delta = MIN(delta, uint32_t(NUM_LATENCY_BUCKETS * LATENCY_BUCKET_US));
+    uint32_t us = delta + ((delta * 3) >> 7);
+
+    unsigned bucket = MIN(us / LATENCY_BUCKET_US, NUM_LATENCY_BUCKETS - 1);
+
+    // Saturating counts are halved, so old samples fade out
+    if (latencyHistogram[bucket] == 0xFF) {
+        for (unsigned i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+            latencyHistogram[i] >>= 1;
+    }
+    latencyHistogram[bucket]++;
+}
+
+void PaintControl::getFrameStats(_SYSCubeFrameStats &stats) const
+{
+    static const uint8_t percentiles[] = { 50, 90, 99 };
+    STATIC_ASSERT(arraysize(percentiles) == arraysize(stats.latencyUS));
+
+    stats.frames = frames;
+    stats.framePeriodUS = MIN(framePeriodUS, 0xFFFFu);
+    stats.packetsPerFrame = packetsPerFrame;
+
+    unsigned total = 0;
+    for (unsigned i = 0; i < NUM_LATENCY_BUCKETS; ++i)
+        total += latencyHistogram[i];
+
+    // Report the upper edge of the bucket holding each percentile
+    for (unsigned p = 0; p < arraysize(percentiles); ++p) {
+        unsigned target = (total * percentiles[p] + 99) / 100;
+        unsigned sum = 0;
+        unsigned bucket = 0;
+
+        while (bucket < NUM_LATENCY_BUCKETS - 1 && sum + latencyHistogram[bucket] < target)
+            sum += latencyHistogram[bucket++];
+
+        stats.latencyUS[p] = total ? (bucket + 1) * LATENCY_BUCKET_US : 0;
+    }
+}
+
 bool VRAMFlags::apply(_SYSVideoBuffer *vbuf)
 {
     // Atomic update via XOR.
@@ -85,11 +85,45 @@ class PaintControl {
     void ackFrames(CubeSlot *cube, int32_t count);
     bool vramFlushed(CubeSlot *cube);
 
+    // Time since the last _SYS_paint(). Safe to call in ISR context.
+    SysTime::Ticks frameAge(SysTime::Ticks now) const {
+        return now - paintTimestamp;
+    }
+
+    // Pipelined painting for all cubes, see _SYS_setPaintPipeline()
+    static void setPipeline(unsigned depth, unsigned frameIntervalUS);
+
+    // Frame telemetry, see _SYSCubeFrameStats
+    void resetStats();
+    void getFrameStats(_SYSCubeFrameStats &stats) const;
+
  private:
+    // Frame latency tracking
+    static const unsigned MAX_TRACKED_FRAMES = 8;
+    static const unsigned NUM_LATENCY_BUCKETS = 16;
+    static const unsigned LATENCY_BUCKET_US = 4000;
+
     SysTime::Ticks paintTimestamp;      // Last user call to _SYS_paint()
     SysTime::Ticks asyncTimestamp;      // TOGGLE, TRIGGER_ON_FLUSH, entering CONTINUOUS mode
+    SysTime::Ticks ackTimestamp;        // Last frame ACK
     int32_t pendingFrames;
-
+    uint32_t framePeriodUS;             // Average time per ACK'ed frame, while busy
+
+    uint32_t paintTimes[MAX_TRACKED_FRAMES];    // Ring of paint timestamps, in ticks >> 10
+    uint32_t frames;
+    uint32_t ackPackets;                // Cube's packet count at the last frame ACK
+    uint16_t packetsPerFrame;           // 8.8 fixed point
+    uint8_t paintHead;
+    uint8_t paintCount;
+    uint8_t latencyHistogram[NUM_LATENCY_BUCKETS];
+
+    static uint8_t pipelineDepth;       // Zero unless pipelining
+    static SysTime::Ticks pipelineInterval;
+
+    static int32_t maxPendingFrames();
+    void trackPaint(SysTime::Ticks now);
+    void trackAck(CubeSlot *cube, SysTime::Ticks now, int32_t count);
+    SysTime::Ticks pipelinePeriod() const;
     static bool allowContinuous(CubeSlot *cube);
     void enterContinuous(CubeSlot *cube, _SYSVideoBuffer *vbuf,
         VRAMFlags &flags, SysTime::Ticks timestamp);
@@ -37,15 +37,47 @@
 #endif
 
 uint8_t RadioManager::currentProducer;
+uint8_t RadioManager::preparedProducer;
+SysTime::Ticks RadioManager::produceTime;
 bool RadioManager::enabled;
 uint8_t RadioManager::nextPID;
 uint32_t RadioManager::schedule[RadioManager::PID_COUNT];
 uint32_t RadioManager::nextSchedule[RadioManager::PID_COUNT];
+uint8_t RadioManager::deficit[RadioManager::NUM_PRODUCERS];
 _SYSPseudoRandomState RadioManager::prngISR;
 RFSpectrumModel RadioManager::rfSpectrumModel;
 
 
 void RadioManager::produce(PacketTransmission &tx)
+{
+    currentProducer = produceFrom(tx, NO_PRODUCER);
+    produceTime = SysTime::ticks();
+}
+
+bool RadioManager::prepare(PacketTransmission &tx)
+{
+    /*
+     * The packet in flight belongs to currentProducer. Its next packet
+     * may depend on this one's ACK, so it has to wait for a regular
+     * produce(). Anyone else's doesn't, since ACKs only ever update the
+     * state of the producer they belong to.
+     */
+
+    unsigned id = produceFrom(tx, currentProducer);
+    if (id == NO_PRODUCER)
+        return false;
+
+    preparedProducer = id;
+    return true;
+}
+
+void RadioManager::commitPrepared()
+{
+    currentProducer = preparedProducer;
+    produceTime = SysTime::ticks();
+}
+
+unsigned RadioManager::produceFrom(PacketTransmission &tx, unsigned exclude)
 {
     /*
      * Produce the next radio packet to transmit. This module's
@@ -97,6 +129,14 @@ void RadioManager::produce(PacketTransmission &tx)
      * This is clearly not a globally optimal algorithm, but it should
      * yield an optimal-enough solution in all cases, and it needs
      * to be efficient enough to run on every radio ISR :)
+     *
+     * Not every producer gets the same share, though. On top of the
+     * round-robin we run a simple deficit scheme: at the start of each
+     * round, every cube is given a quantum (see CubeSlot::radioQuantum)
+     * and it may transmit up to that many times before it moves on to
+     * the next round's schedule. Extra turns go back into this round's
+     * queue for the PID just used, so they follow the same collision
+     * rules as everything else.
      */
 
     const uint32_t activeMask = CubeSlots::sysConnected | Intrinsic::LZ(CONNECTOR_ID);
@@ -162,6 +202,8 @@ void RadioManager::produce(PacketTransmission &tx)
                     added &= ~s;
                 }
                 schedule[0] |= added;
+
+                refillDeficits(activeMask, now);
                 continue;
             }
 
@@ -179,8 +221,7 @@ void RadioManager::produce(PacketTransmission &tx)
             tx.txPower = PacketTransmission::dBmMinus18;
 
             nextPID = (thisPID + 1) & PID_MASK;
-            currentProducer = DUMMY_ID;
-            return;
+            return DUMMY_ID;
         }
 
         /*
@@ -193,15 +234,24 @@ void RadioManager::produce(PacketTransmission &tx)
         ASSERT(producer < NUM_PRODUCERS);
         uint32_t producerBit = Intrinsic::LZ(producer);
 
+        // Leave the schedule as-is, this producer has to wait its turn
+        if (producer == exclude)
+            return NO_PRODUCER;
+
         // Always remove from current schedule
         schedule[foundPID] ^= producerBit;
 
         // Does this producer even want to transmit right now?
         if (dispatchProduce(producer, tx, now)) {
-            nextSchedule[thisPID] |= producerBit;
+            if (deficit[producer]) {
+                // Quantum left; eligible again later in this round
+                deficit[producer]--;
+                schedule[thisPID] |= producerBit;
+            } else {
+                nextSchedule[thisPID] |= producerBit;
+            }
             nextPID = (thisPID + 1) & PID_MASK;
-            currentProducer = producer;
-            return;
+            return producer;
         }
 
         // If not, put it back with its existing PID but in the new schedule
@@ -209,6 +259,21 @@ void RadioManager::produce(PacketTransmission &tx)
     }
 }
 
+void RadioManager::refillDeficits(uint32_t activeMask, SysTime::Ticks now)
+{
+    // Start of a new scheduling round. Cubes get their quantum, minus the
+    // turn every producer gets anyway. The connector never gets extra.
+
+    uint32_t cubes = activeMask & ~Intrinsic::LZ(CONNECTOR_ID);
+    deficit[CONNECTOR_ID] = 0;
+
+    while (cubes) {
+        unsigned id = Intrinsic::CLZ(cubes);
+        cubes ^= Intrinsic::LZ(id);
+        deficit[id] = CubeSlot::getInstance(id).radioQuantum(now) - 1;
+    }
+}
+
 void RadioManager::ackWithPacket(const PacketBuffer &packet, unsigned retries)
 {
 //    dispatchAcknowledge(currentProducer, packet, retries);
@@ -267,7 +332,7 @@ void RadioManager::timeout()
         slot.radioTimeout();
 }
 
-void RadioManager::processRetries(const CubeSlot &slot, unsigned retries)
+void RadioManager::processRetries(CubeSlot &slot, unsigned retries)
 {
     /*
      * Upon completion of a transmission, check whether the number of retries
@@ -277,13 +342,20 @@ void RadioManager::processRetries(const CubeSlot &slot, unsigned retries)
      * We bucketize channels so we can track them in a single uint32_t mask -
      * there are 83 possible channels, but we only really need to track in
      * larger buckets, since we'll want to jump away in larger increments.
+     *
+     * Each cube also keeps its own retry and latency averages. Those can
+     * ask for a hop too, if this one link has been poor for a while even
+     * though the bucket as a whole looks fine.
      */
 
+    const SysTime::Ticks now = SysTime::ticks();
+    slot.updateLinkStats(retries, now, now - produceTime);
+
     unsigned channel = slot.getRadioAddress()->channel;
     rfSpectrumModel.update(channel, retries);
 
     unsigned energy = rfSpectrumModel.energry(channel);
-    if (energy > CHANNEL_HOP_THRESHOLD) {
+    if (energy > CHANNEL_HOP_THRESHOLD || slot.linkIsPoor(now)) {
         // XXX: hop other connected cubes within some range of this channel?
         Atomic::Or(CubeSlots::pendingHop, slot.bit());
     }
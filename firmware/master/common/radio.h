@@ -192,6 +192,9 @@ class Radio {
     // Called at Tasks::HEARTBEAT_HZ, in task context
     static void heartbeat();
 
+    // Beats the radio can go without a heartbeat, for tickless idle
+    static unsigned idleBeats();
+
     /*
      * Values for the L01's tx power register.
      */
@@ -240,10 +243,25 @@ class RadioManager {
      */
 
     static void produce(PacketTransmission &tx);
+
+    /**
+     * Optional speculative produce(), for radios that can overlap packet
+     * encoding with the previous packet's airtime. Fills in the packet
+     * that will follow the one in flight, but only from a producer whose
+     * next packet can't depend on that one's ACK. Returns false if there
+     * is no such producer right now.
+     *
+     * A prepared packet is already part of its producer's stream, so it
+     * can never be discarded: the radio must send it next, calling
+     * commitPrepared() instead of produce().
+     */
+    static bool prepare(PacketTransmission &tx);
+    static void commitPrepared();
+
     static void ackWithPacket(const PacketBuffer &packet, unsigned retries);
     static void ackEmpty(unsigned retries);
     static void timeout();
-    static void processRetries(const CubeSlot &slot, unsigned retries);
+    static void processRetries(CubeSlot &slot, unsigned retries);
 
     ALWAYS_INLINE static unsigned suggestChannel() {
         return rfSpectrumModel.suggestChannel();
@@ -272,6 +290,10 @@ class RadioManager {
      */
 
     static uint8_t currentProducer;
+    static uint8_t preparedProducer;
+
+    // When currentProducer's packet was handed to the radio
+    static SysTime::Ticks produceTime;
 
     static bool enabled;
 
@@ -286,6 +308,9 @@ class RadioManager {
     // Dummy ID, not counted in NUM_PRODUCERS
     static const unsigned DUMMY_ID = NUM_PRODUCERS;
 
+    // Not a producer at all, for when nobody is excluded from scheduling
+    static const unsigned NO_PRODUCER = 0xFF;
+
     // Tracking packet IDs, for explicitly avoiding ID collisions
     static const unsigned PID_COUNT = 4;
     static const unsigned PID_MASK = PID_COUNT - 1;
@@ -296,7 +321,14 @@ class RadioManager {
     // Priority queues for each PID value
     static uint32_t schedule[PID_COUNT];
     static uint32_t nextSchedule[PID_COUNT];
+
+    // Extra transmit opportunities each producer has left this round
+    static uint8_t deficit[NUM_PRODUCERS];
+    static void refillDeficits(uint32_t activeMask, SysTime::Ticks now);
     
+    // Pick a producer other than 'exclude', and have it fill 'tx'
+    static unsigned produceFrom(PacketTransmission &tx, unsigned exclude);
+
     // Dispatch to a paritcular producer, by ID
     static ALWAYS_INLINE bool dispatchProduce(unsigned id, PacketTransmission &tx, SysTime::Ticks now);
 };
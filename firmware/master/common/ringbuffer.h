@@ -92,10 +92,14 @@ public:
         return (uintptr_t) &mBuf[0];
     }
 
-    void ALWAYS_INLINE dequeueWithDMACount(unsigned count) {
+    unsigned ALWAYS_INLINE dequeueWithDMACount(unsigned count) {
         // Update the 'head' pointer, given an updated DMA count.
-        ASSERT(count < getDMACount());
-        mHead = capacity() & (tSize - count);
+        // Returns the number of items the DMA engine consumed.
+        ASSERT(count <= getDMACount());
+        unsigned head = capacity() & (tSize - count);
+        unsigned consumed = capacity() & (head - mHead);
+        mHead = head;
+        return consumed;
     }
 
     /*
@@ -32,6 +32,7 @@
 #include "cubeslots.h"
 #include "cubeconnector.h"
 #include "flash_preerase.h"
+#include "flash_syslfs.h"
 #include "idletimeout.h"
 
 #ifndef SIFTEO_SIMULATOR
@@ -110,6 +111,9 @@ void ShutdownManager::housekeeping()
      * of one flash block erasure.
      */
 
+    // Deferred SysLFS writes go out first, whatever happens next
+    SysLFS::flush();
+
     while (!HomeButton::isPressed() && !Tasks::isPending(Tasks::UsbOUT)) {
         if (!FlashLFS::collectGlobalGarbage())
             break;
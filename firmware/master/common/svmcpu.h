@@ -60,6 +60,17 @@ namespace SvmCpu {
 
     void run(reg_t sp, reg_t pc) SVM_RUN_ATTRS;
 
+#ifdef SIFTEO_SIMULATOR
+    // The emulator caches decoded instructions for each FlashBlock
+    void invalidateDecodeCache(unsigned blockID);
+
+    // Ticks until SystemMC next needs to hear about elapsed CPU time
+    void setTickBudget(uint64_t ticks);
+
+    // Total instructions executed so far
+    uint64_t instructionCount();
+#endif
+
     // Registers that get saved to the stack automatically by hardware
     struct HwContext {
         reg_t r0;
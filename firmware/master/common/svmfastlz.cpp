@@ -38,74 +38,150 @@
 
 /**
  * This is a small inlined utility class for safely and quickly reading a
- * byte stream from flash. Uses a tiny buffer to amortize costs (checking
- * boundary conditions, address translation) over many bytes.
+ * byte stream from flash or RAM. Rather than copying the stream through a
+ * private buffer, we read in place from a window: the longest span that
+ * SvmMemory::mapROData() can give us at once, typically the remainder of
+ * one flash cache block. Bounds checks and address translation happen
+ * once per window, and literal runs can be copied out of it in bulk.
  */
-class LZByteReader {
+class LZStreamReader {
 public:
 
-    ALWAYS_INLINE LZByteReader(FlashBlockRef &ref, SvmMemory::VirtAddr src, uint32_t srcLen)
-        : ref(ref), src(src), srcLen(srcLen), bufLen(0)
+    ALWAYS_INLINE LZStreamReader(FlashBlockRef &ref, SvmMemory::VirtAddr src, uint32_t srcLen)
+        : ref(ref), src(src), srcLen(srcLen), winLen(0), failed(false)
     {}
 
-    ALWAYS_INLINE ~LZByteReader() {}
-
     /// Are we at the end of the stream?
     ALWAYS_INLINE bool eof() const {
-        return !(srcLen | bufLen);
+        return !(srcLen | winLen);
+    }
+
+    /// Did we stop early because of a memory mapping failure?
+    ALWAYS_INLINE bool mapFailed() const {
+        return failed;
     }
 
     /**
-     * Read one byte from the stream, filling the buffer if needed.
+     * Read one byte from the stream, mapping a new window if needed.
      * If we're past the end of the stream or we hit a mapping error,
      * returns zero. eof() will be 'true' immediately after return in
      * this case.
      */
     ALWAYS_INLINE uint8_t read()
     {
-        if (UNLIKELY(bufLen == 0)) {
-            fillBuffer();
-            if (UNLIKELY(bufLen == 0))
+        if (UNLIKELY(winLen == 0)) {
+            nextWindow();
+            if (UNLIKELY(winLen == 0))
                 return 0;
         }
 
-        bufLen--;
-        return *(bufPtr++);
+        winLen--;
+        return *(winPtr++);
     }
 
+    /**
+     * Copy 'len' bytes from the stream to 'dest'. Anything past the end
+     * of the stream reads as zero, just like read().
+     */
+    void copy(uint8_t *dest, unsigned len);
+
 private:
-    FlashBlockRef ref;
+    FlashBlockRef &ref;
     SvmMemory::VirtAddr src;
     unsigned srcLen;            // Bytes remaining at 'src'
-    unsigned bufLen;            // Bytes remaining in buffer
-    uint8_t *bufPtr;            // Current read location in buffer
-    uint8_t buffer[32];
+    unsigned winLen;            // Bytes remaining in window
+    const uint8_t *winPtr;      // Current read location in window
+    bool failed;
 
-    void fillBuffer();
+    void nextWindow();
 };
 
 
-void LZByteReader::fillBuffer()
+void LZStreamReader::nextWindow()
 {
-    ASSERT(bufLen == 0);
-    unsigned chunk = MIN(srcLen, sizeof buffer);
-    if (!chunk)
+    ASSERT(winLen == 0);
+    if (!srcLen)
         return;
 
-    if (!SvmMemory::copyROData(ref, &buffer[0], src, chunk))
+    uint32_t chunk = srcLen;
+    SvmMemory::PhysAddr pa;
+    if (!SvmMemory::mapROData(ref, src, chunk, pa)) {
+        // Treat the rest of the stream as missing
+        srcLen = 0;
+        failed = true;
         return;
+    }
 
-    bufLen = chunk;
-    bufPtr = &buffer[0];
+    ASSERT(chunk >= 1 && chunk <= srcLen);
+    winLen = chunk;
+    winPtr = pa;
     src += chunk;
     srcLen -= chunk;
 }
 
+void LZStreamReader::copy(uint8_t *dest, unsigned len)
+{
+    while (len) {
+        if (!winLen) {
+            nextWindow();
+            if (!winLen) {
+                memset(dest, 0, len);
+                return;
+            }
+        }
+
+        unsigned chunk = MIN(len, winLen);
+        memcpy(dest, winPtr, chunk);
+        dest += chunk;
+        len -= chunk;
+        winPtr += chunk;
+        winLen -= chunk;
+    }
+}
+
+
+/**
+ * Copy a match of 'len' bytes from 'r' to 'op', where 'r' lies before
+ * 'op' and the two may overlap. Overlap is what makes LZ77 matches
+ * repeat, so we copy in chunks no longer than the match distance. Each
+ * chunk is then a plain non-overlapping memcpy(), which moves whole
+ * words at a time wherever alignment allows.
+ */
+static ALWAYS_INLINE uint8_t *lzCopyMatch(uint8_t *op, const uint8_t *r, unsigned len)
+{
+    unsigned distance = op - r;
+    ASSERT(distance > 0);
+
+    if (len < 8) {
+        // Short matches are common; a call to memcpy() costs more than it saves
+        do {
+            *op++ = *r++;
+        } while (--len);
+        return op;
+    }
+
+    if (distance == 1) {
+        // A run of one repeated byte
+        memset(op, r[0], len);
+        return op + len;
+    }
+
+    do {
+        unsigned chunk = MIN(len, distance);
+        memcpy(op, r, chunk);
+        op += chunk;
+        r += chunk;
+        len -= chunk;
+    } while (len);
+
+    return op;
+}
+
 
 bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
     uint32_t &destLen, SvmMemory::VirtAddr src, uint32_t srcLen)
 {
-    LZByteReader br(ref, src, srcLen);
+    LZStreamReader br(ref, src, srcLen);
 
     uint8_t *op = dest;
     uint8_t *op_limit = op + destLen;
@@ -136,32 +212,16 @@ bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
             else
                 ctrl = br.read();
 
-            if (r == op) {
-                /* optimize copy for a run */
-                uint8_t b = r[-1];
-                *op++ = b;
-                *op++ = b;
-                *op++ = b;
-                for(; len; --len)
-                    *op++ = b;
-            } else {
-                /* copy from reference */
-                r--;
-                *op++ = *r++;
-                *op++ = *r++;
-                *op++ = *r++;
-                for(; len; --len)
-                    *op++ = *r++;
-            }
+            op = lzCopyMatch(op, r - 1, len + 3);
+
         } else {
             ctrl++;
 
             if (UNLIKELY(op + ctrl > op_limit))
                 return false;
 
-            *op++ = br.read();
-            for (--ctrl; ctrl; ctrl--)
-                *op++ = br.read();
+            br.copy(op, ctrl);
+            op += ctrl;
 
             loop = LIKELY(!br.eof());
             if (loop)
@@ -169,7 +229,49 @@ bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
         }
     } while (LIKELY(loop));
 
+    if (UNLIKELY(br.mapFailed()))
+        return false;
+
     ASSERT(unsigned(op - dest) <= destLen);
     destLen = op - dest;
     return true;
 }
+
+bool SvmFastLZ::decompressZeroRuns(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
+    uint32_t destLen, SvmMemory::VirtAddr src, uint32_t srcLen)
+{
+    uint32_t offset = 0;
+
+    while (srcLen) {
+        uint16_t hdr[3];
+        if (srcLen < sizeof hdr)
+            return false;
+        if (!SvmMemory::copyROData(ref, (SvmMemory::PhysAddr) hdr, src, sizeof hdr))
+            return false;
+        src += sizeof hdr;
+        srcLen -= sizeof hdr;
+
+        uint32_t zeroes = hdr[0];
+        uint32_t plainLen = hdr[1];
+        uint32_t packedLen = hdr[2];
+
+        offset += zeroes;
+        if (offset > destLen || plainLen > destLen - offset || packedLen > srcLen)
+            return false;
+
+        if (packedLen == plainLen) {
+            if (!SvmMemory::copyROData(ref, dest + offset, src, plainLen))
+                return false;
+        } else {
+            uint32_t len = plainLen;
+            if (!decompressL1(ref, dest + offset, len, src, packedLen) || len != plainLen)
+                return false;
+        }
+
+        offset += plainLen;
+        src += packedLen;
+        srcLen -= packedLen;
+    }
+
+    return true;
+}
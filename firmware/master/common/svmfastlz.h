@@ -52,6 +52,23 @@ public:
     static bool decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
         uint32_t &destLen, SvmMemory::VirtAddr src, uint32_t srcLen);
 
+    /**
+     * Decompress a zero-run segment from virtual memory.
+     *
+     * This is a sequence of records, each with a little-endian header
+     * of three 16-bit words: a count of zero bytes to skip, the length
+     * of the non-zero region that follows, and the number of stream bytes
+     * used to store that region. If the stored length equals the region
+     * length, the region is a plain copy. Otherwise it's FastLZ Level 1.
+     *
+     * Skipped bytes are not written at all; 'dest' must already be zeroed.
+     * Returns false on memory mapping failure, on any record that would
+     * overrun 'destLen', or on a region that doesn't decode to its
+     * stated length.
+     */
+    static bool decompressZeroRuns(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
+        uint32_t destLen, SvmMemory::VirtAddr src, uint32_t srcLen);
+
 private:
     SvmFastLZ();    // Do not implement
 };
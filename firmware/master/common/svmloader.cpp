@@ -45,6 +45,8 @@
 #include "assetloader.h"
 #include "btprotocol.h"
 #include "xmtrackerplayer.h"
+#include "imagedecoder.h"
+#include "vram.h"
 
 #ifdef SIFTEO_SIMULATOR
 #   include "system_mc.h"
@@ -107,6 +109,11 @@ bool SvmLoader::loadRWData(const Elf::Program &program)
         case _SYS_ELF_PT_LOAD_FASTLZ:
             return SvmFastLZ::decompressL1(ref, destPA, destLen, srcVA, srcLen);
 
+        // Zero runs skipped, FastLZ or plain data in between.
+        // Relies on SvmMemory::erase() having already zeroed RAM.
+        case _SYS_ELF_PT_LOAD_ZRUNS:
+            return SvmFastLZ::decompressZeroRuns(ref, destPA, destLen, srcVA, srcLen);
+
         default:
             return false;
     }
@@ -131,8 +138,12 @@ bool SvmLoader::prepareToExec(const Elf::Program &program, SvmRuntime::StackInfo
     // Detach any existing cube buffers.
     for (unsigned i = 0; i < _SYS_NUM_CUBE_SLOTS; i++) {
         CubeSlots::instances[i].setVideoBuffer(0);
+        CubeSlots::instances[i].setVideoShadow(0);
         CubeSlots::instances[i].setMotionBuffer(0);
+        CubeSlots::instances[i].setAccelThreshold(CubeSlot::DEFAULT_ACCEL_THRESHOLD);
     }
+    VRAMChangeLog::detachAll();
+    PaintControl::setPipeline(0, 0);
 
     // Reset Bluetooth userspace state
     BTProtocol::setUserQueues(0, 0);
@@ -166,6 +177,9 @@ bool SvmLoader::prepareToExec(const Elf::Program &program, SvmRuntime::StackInfo
     // Set up default flash segment
     SvmMemory::setFlashSegment(0, program.getRODataSpan());
 
+    // Decoded images may have come from the old contents of these VAs
+    ImageDecoder::invalidateCache();
+
     // Init stack
     stack.limit = program.getTopOfRAM();
     stack.top = SvmMemory::VIRTUAL_RAM_TOP;
@@ -236,6 +250,10 @@ FlashMapSpan SvmLoader::secondaryMap(FlashVolume vol)
     mapVols[1] = vol;
     FlashMapSpan span = vol.getPayload(mapRefs[1]);
     SvmMemory::setFlashSegment(1, span);
+
+    // Cached audio and images may have been decoded from the old contents of these VAs
+    AudioSampleData::invalidateCache();
+    ImageDecoder::invalidateCache();
     return span;
 }
 
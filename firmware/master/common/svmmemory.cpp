@@ -79,6 +79,15 @@ bool SvmMemory::mapROData(FlashBlockRef &ref, VirtAddr va,
            flashSeg[1].getBytes(ref, va - SEGMENT_1_VA, pa, length);
 }
 
+bool SvmMemory::mapROWindow(FlashBlockRef *refs, VirtAddr va,
+    uint32_t length, PhysAddr &pa)
+{
+    STATIC_ASSERT(arraysize(flashSeg) == 2);
+    return mapRAM(va, length, pa) ||
+           flashSeg[0].getBytesContiguous(refs, va - SEGMENT_0_VA, length, pa) ||
+           flashSeg[1].getBytesContiguous(refs, va - SEGMENT_1_VA, length, pa);
+}
+
 bool SvmMemory::preload(VirtAddr va)
 {
     STATIC_ASSERT(arraysize(flashSeg) == 2);
@@ -86,6 +95,13 @@ bool SvmMemory::preload(VirtAddr va)
            flashSeg[1].preloadBlock(va - SEGMENT_1_VA);
 }
 
+void SvmMemory::preloadNextCodeBlock(VirtAddr va)
+{
+    // Same address rules as mapROCode()
+    uint32_t flashOffset = (uint32_t)va & 0xfffffc;
+    flashSeg[0].preloadBlock((flashOffset & ~FlashBlock::BLOCK_MASK) + FlashBlock::BLOCK_SIZE);
+}
+
 void SvmMemory::validateBase(FlashBlockRef &ref, VirtAddr va,
     PhysAddr &bro, PhysAddr &brw)
 {
@@ -135,6 +151,45 @@ bool SvmMemory::copyROData(FlashBlockRef &ref,
            flashSeg[1].copyBytes(ref, src - SEGMENT_1_VA, dest, length);
 }
 
+bool SvmMemory::copyRODataUncached(PhysAddr dest, VirtAddr src, uint32_t length)
+{
+    // RAM address
+    PhysAddr srcPA;
+    if (mapRAM(src, length, srcPA)) {
+        memcpy(dest, srcPA, length);
+        return true;
+    }
+
+    STATIC_ASSERT(arraysize(flashSeg) == 2);
+    return flashSeg[0].copyBytesUncached(src - SEGMENT_0_VA, dest, length) ||
+           flashSeg[1].copyBytesUncached(src - SEGMENT_1_VA, dest, length);
+}
+
+bool SvmROCursor::readSlow(uint8_t *dest, uint32_t length)
+{
+    // Map as much as we can, up to the end of the next block
+    window = FlashBlock::BLOCK_SIZE;
+
+    if (!SvmMemory::mapROData(ref, va, window, pa) || window < length) {
+        /*
+         * This read straddles a block boundary, or it's RAM that we can't
+         * map a whole window of. Copy it the slow way, and leave the next
+         * read to map a fresh window.
+         */
+        window = 0;
+        if (!SvmMemory::copyROData(ref, dest, va, length))
+            return false;
+        va += length;
+        return true;
+    }
+
+    memcpy(dest, pa, length);
+    pa += length;
+    va += length;
+    window -= length;
+    return true;
+}
+
 bool SvmMemory::strlcpyROData(FlashBlockRef &ref, char *dest, VirtAddr src, uint32_t destSize)
 {
     char *last = dest + destSize - 1;
@@ -46,6 +46,9 @@ public:
     static const unsigned VIRTUAL_RAM_BASE = 0x10000;
     static const unsigned VIRTUAL_RAM_TOP = VIRTUAL_RAM_BASE + RAM_SIZE_IN_BYTES;
 
+    // Longest flash window mapROWindow() can pin, in cache blocks
+    static const unsigned MAX_WINDOW_BLOCKS = FlashBlock::MAX_RUN_BLOCKS;
+
     typedef uint8_t* PhysAddr;
     typedef Svm::reg_t VirtAddr;
 
@@ -130,6 +133,19 @@ public:
      */
     static bool mapROCode(FlashBlockRef &ref, VirtAddr va, PhysAddr &pa);
 
+    /**
+     * Map an entire read-only region as one contiguous pointer, for callers
+     * that would otherwise copy it or loop over mapROData() chunks. Flash
+     * data is pinned via 'refs', an array of MAX_WINDOW_BLOCKS references,
+     * in adjacent cache slots.
+     *
+     * This can fail even for valid addresses: if the region is longer than
+     * the window, or if held references leave the cache no room to arrange
+     * it. Callers must fall back on mapROData() when this returns false.
+     */
+    static bool mapROWindow(FlashBlockRef *refs, VirtAddr va,
+        uint32_t length, PhysAddr &pa);
+
     /**
      * Copy out read-only data into arbitrary physical RAM. This is a more
      * convenient alternative for small data structures that are not necessarily
@@ -137,6 +153,13 @@ public:
      */
     static bool copyROData(FlashBlockRef &ref, PhysAddr dest, VirtAddr src, uint32_t length);
 
+    /**
+     * Like copyROData, but flash is read directly from the device without
+     * going through the block cache. For long streams that are read once,
+     * where caching them would only evict blocks that other code still needs.
+     */
+    static bool copyRODataUncached(PhysAddr dest, VirtAddr src, uint32_t length);
+
     /**
      * Copy out read-only data into arbitrary physical RAM, stopping when we hit
      * a NUL terminator. Guaranteed to NUL-terminate the destination string
@@ -164,6 +187,12 @@ public:
      */
     static bool preload(VirtAddr va);
 
+    /**
+     * Hint that code is likely to run past the end of the block containing
+     * 'va'. Starts preloading the next code block, if there is one.
+     */
+    static void preloadNextCodeBlock(VirtAddr va);
+
     /**
      * Convenient type-safe wrapper around copyROData.
      */
@@ -353,4 +382,41 @@ private:
 };
 
 
+/**
+ * A forward-only reader for read-only data in virtual memory. Sequential
+ * reads come straight out of a window onto the cache block that 'ref'
+ * pins. We only remap when a read crosses the end of the window.
+ *
+ * The cursor owns 'ref' while it's in use. Any other use of the same ref
+ * would leave our window pointing at the wrong block.
+ */
+
+class SvmROCursor {
+public:
+    SvmROCursor(FlashBlockRef &ref, SvmMemory::VirtAddr va)
+        : ref(ref), va(va), window(0) {}
+
+    template <typename T>
+    ALWAYS_INLINE bool read(T &dest)
+    {
+        if (LIKELY(window >= sizeof(T))) {
+            memcpy(&dest, pa, sizeof(T));
+            pa += sizeof(T);
+            va += sizeof(T);
+            window -= sizeof(T);
+            return true;
+        }
+        return readSlow(reinterpret_cast<uint8_t*>(&dest), sizeof(T));
+    }
+
+private:
+    FlashBlockRef &ref;
+    SvmMemory::VirtAddr va;
+    SvmMemory::PhysAddr pa;
+    uint32_t window;
+
+    bool readSlow(uint8_t *dest, uint32_t length);
+};
+
+
 #endif // SVM_MEMORY_H
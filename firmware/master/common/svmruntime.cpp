@@ -34,12 +34,21 @@
 #include "tasks.h"
 #include "cubeslots.h"
 #include "faultlogger.h"
+#include "audiomixer.h"
 
 #include <math.h>
 #include <sifteo/abi.h>
 
 typedef uint64_t (*SvmSyscall)(reg_t p0, reg_t p1, reg_t p2, reg_t p3,
                                reg_t p4, reg_t p5, reg_t p6, reg_t p7);
+typedef uint64_t (*SvmSyscall4)(reg_t p0, reg_t p1, reg_t p2, reg_t p3);
+
+// Signature encoding for SyscallInfo, generated along with SyscallTable
+#define SC_ARGC_MASK            0x0F
+#define SC_RET_NONE             0x00
+#define SC_RET_32               0x10
+#define SC_RET_64               0x20
+#define SC_INFO(_argc, _ret)    ((_argc) | (_ret))
 
 // Library function aliases, used by syscall-table on hardware only.
 #ifdef SIFTEO_SIMULATOR
@@ -272,6 +281,9 @@ void SvmRuntime::ret(unsigned actions)
 #ifndef SIFTEO_SIMULATOR
     #include "sampleprofiler.h"
 #endif
+#ifdef CYCLE_PROFILER
+    #include "cycleprofiler.h"
+#endif
 
 void SvmRuntime::svc(uint8_t imm8)
 {
@@ -286,6 +298,9 @@ void SvmRuntime::svc(uint8_t imm8)
         else
             svcIndirectOperation(imm8);
 
+        // Keep audio fed even if user code makes no syscalls for a while
+        AudioMixer::pollDeadline();
+
     } else if ((imm8 & (0x3 << 6)) == (0x2 << 6)) {
         uint8_t syscallNum = imm8 & 0x3f;
         syscall(syscallNum);
@@ -448,10 +463,36 @@ void SvmRuntime::syscall(unsigned num)
             reinterpret_cast<void*>(SvmCpu::reg(7))));
     });
 
-    uint64_t result = fn(SvmCpu::reg(0), SvmCpu::reg(1),
-                         SvmCpu::reg(2), SvmCpu::reg(3),
-                         SvmCpu::reg(4), SvmCpu::reg(5),
-                         SvmCpu::reg(6), SvmCpu::reg(7));
+    /*
+     * Most syscalls, including the per-frame video and math calls, take
+     * at most four arguments. Those only need r0-r3, which the native ABI
+     * passes in registers too. Calling them with the narrower signature
+     * skips loading r4-r7 from saved user state and pushing them as
+     * native stack arguments.
+     */
+
+    uint8_t info = SyscallInfo[num];
+    uint64_t result;
+
+    #ifdef CYCLE_PROFILER
+        STATIC_ASSERT(arraysize(SyscallTable) <= CycleProfiler::NUM_SYSCALLS);
+        uint32_t cycleStart = CycleProfiler::now();
+    #endif
+
+    if ((info & SC_ARGC_MASK) <= 4) {
+        SvmSyscall4 fn4 = reinterpret_cast<SvmSyscall4>(fn);
+        result = fn4(SvmCpu::reg(0), SvmCpu::reg(1),
+                     SvmCpu::reg(2), SvmCpu::reg(3));
+    } else {
+        result = fn(SvmCpu::reg(0), SvmCpu::reg(1),
+                    SvmCpu::reg(2), SvmCpu::reg(3),
+                    SvmCpu::reg(4), SvmCpu::reg(5),
+                    SvmCpu::reg(6), SvmCpu::reg(7));
+    }
+
+    #ifdef CYCLE_PROFILER
+        CycleProfiler::endSyscall(num, cycleStart);
+    #endif
 
     uint32_t result0 = result;
     uint32_t result1 = result >> 32;
@@ -461,8 +502,14 @@ void SvmRuntime::syscall(unsigned num)
             num, result1, result0));
     });
 
-    SvmCpu::setReg(0, result0);
-    SvmCpu::setReg(1, result1);
+    // Only write back the result registers this syscall actually defines.
+    // Whatever else the native call left in r0/r1 is meaningless.
+    if (info & SC_RET_64) {
+        SvmCpu::setReg(0, result0);
+        SvmCpu::setReg(1, result1);
+    } else if (info & SC_RET_32) {
+        SvmCpu::setReg(0, result0);
+    }
 }
 
 ALWAYS_INLINE void SvmRuntime::tailSyscall(unsigned num)
@@ -550,10 +597,17 @@ reg_t SvmRuntime::mapSP(reg_t addr)
 void SvmRuntime::branch(reg_t addr)
 {
     SvmMemory::PhysAddr pa;
-    if (SvmMemory::mapROCode(codeBlock, addr, pa))
+    uint32_t prevBlock = codeBlock.isHeld() ? codeBlock->getAddress() : FlashBlock::INVALID_ADDRESS;
+
+    if (SvmMemory::mapROCode(codeBlock, addr, pa)) {
         SvmCpu::setReg(REG_PC, reinterpret_cast<reg_t>(pa));
-    else
+
+        // Entering a new code block; its successor is a good guess for what's next
+        if (codeBlock->getAddress() != prevBlock)
+            SvmMemory::preloadNextCodeBlock(addr);
+    } else {
         SvmRuntime::fault(F_BAD_CODE_ADDRESS);
+    }
 }
 
 ALWAYS_INLINE void SvmRuntime::longLDRSP(unsigned reg, unsigned offset)
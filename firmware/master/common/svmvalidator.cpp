@@ -32,7 +32,6 @@
 #include "svmvalidator.h"
 #include "svm.h"
 #include "macros.h"
-#include "svmcpu.h"
 
 using namespace Svm;
 namespace SvmValidator {
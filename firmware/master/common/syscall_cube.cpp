@@ -64,6 +64,18 @@ void _SYS_setVideoBuffer(_SYSCubeID cid, struct _SYSVideoBuffer *vbuf)
     CubeSlots::instances[cid].setVideoBuffer(vbuf);
 }
 
+void _SYS_setVideoShadow(_SYSCubeID cid, struct _SYSVideoShadow *shadow)
+{
+    if (!isAligned(shadow))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+    if (!SvmMemory::mapRAM(shadow, sizeof *shadow, true))
+        return SvmRuntime::fault(F_SYSCALL_ADDRESS);
+    if (!CubeSlots::validID(cid))
+        return SvmRuntime::fault(F_SYSCALL_PARAM);
+
+    CubeSlots::instances[cid].setVideoShadow(shadow);
+}
+
 void _SYS_setMotionBuffer(_SYSCubeID cid, _SYSMotionBuffer *mbuf)
 {
     if (!isAligned(mbuf))
@@ -83,6 +95,27 @@ void _SYS_setMotionBuffer(_SYSCubeID cid, _SYSMotionBuffer *mbuf)
     CubeSlots::instances[cid].setMotionBuffer(mbuf);
 }
 
+void _SYS_setAccelThreshold(_SYSCubeID cid, uint32_t threshold)
+{
+    if (!CubeSlots::validID(cid))
+        return SvmRuntime::fault(F_SYSCALL_PARAM);
+    if (threshold > CubeSlot::MAX_ACCEL_THRESHOLD)
+        return SvmRuntime::fault(F_SYSCALL_PARAM);
+
+    CubeSlots::instances[cid].setAccelThreshold(threshold);
+}
+
+static MotionWriter *findMotionWriter(const _SYSMotionBuffer *mbuf)
+{
+    // Is this buffer attached to a cube? If so, its writer can memoize queries.
+    for (unsigned i = 0; i < _SYS_NUM_CUBE_SLOTS; ++i) {
+        MotionWriter &writer = CubeSlots::instances[i].getMotionWriter();
+        if (writer.isBuffer(mbuf))
+            return &writer;
+    }
+    return 0;
+}
+
 void _SYS_motion_integrate(const struct _SYSMotionBuffer *mbuf, unsigned duration, struct _SYSInt3 *result)
 {
     if (!isAligned(mbuf))
@@ -99,7 +132,11 @@ void _SYS_motion_integrate(const struct _SYSMotionBuffer *mbuf, unsigned duratio
     if (!SvmMemory::mapRAM(result, sizeof *result))
         return SvmRuntime::fault(F_SYSCALL_ADDRESS);
 
-    MotionUtil::integrate(mbuf, duration, result);
+    MotionWriter *writer = findMotionWriter(mbuf);
+    if (writer)
+        writer->integrate(duration, result);
+    else
+        MotionUtil::integrate(mbuf, duration, result);
 }
 
 void _SYS_motion_median(const struct _SYSMotionBuffer *mbuf, unsigned duration, struct _SYSMotionMedian *result)
@@ -116,7 +153,11 @@ void _SYS_motion_median(const struct _SYSMotionBuffer *mbuf, unsigned duration,
     if (!SvmMemory::mapRAM(result, sizeof *result))
         return SvmRuntime::fault(F_SYSCALL_ADDRESS);
 
-    MotionUtil::median(mbuf, duration, result);
+    MotionWriter *writer = findMotionWriter(mbuf);
+    if (writer)
+        writer->median(duration, result);
+    else
+        MotionUtil::median(mbuf, duration, result);
 }
 
 uint32_t _SYS_getAccel(_SYSCubeID cid)
@@ -170,4 +211,44 @@ void _SYS_unpair(_SYSCubeID cid)
     Atomic::Or(CubeSlots::sendShutdown, Intrinsic::LZ(cid));
 }
 
+uint32_t _SYS_cubeLinkStats(_SYSCubeID cid, struct _SYSCubeLinkStats *buffer, uint32_t bufferSize)
+{
+    if (!CubeSlots::validID(cid)) {
+        SvmRuntime::fault(F_SYSCALL_PARAM);
+        return 0;
+    }
+    if (!SvmMemory::mapRAM(buffer, bufferSize)) {
+        SvmRuntime::fault(F_SYSCALL_ADDRESS);
+        return 0;
+    }
+
+    _SYSCubeLinkStats stats;
+    CubeSlots::instances[cid].getLinkStats(stats);
+
+    unsigned actualSize = MIN(sizeof stats, bufferSize);
+    memset(buffer, 0, bufferSize);
+    memcpy(buffer, &stats, actualSize);
+    return actualSize;
+}
+
+uint32_t _SYS_cubeFrameStats(_SYSCubeID cid, struct _SYSCubeFrameStats *buffer, uint32_t bufferSize)
+{
+    if (!CubeSlots::validID(cid)) {
+        SvmRuntime::fault(F_SYSCALL_PARAM);
+        return 0;
+    }
+    if (!SvmMemory::mapRAM(buffer, bufferSize)) {
+        SvmRuntime::fault(F_SYSCALL_ADDRESS);
+        return 0;
+    }
+
+    _SYSCubeFrameStats stats;
+    CubeSlots::instances[cid].getFrameStats(stats);
+
+    unsigned actualSize = MIN(sizeof stats, bufferSize);
+    memset(buffer, 0, bufferSize);
+    memcpy(buffer, &stats, actualSize);
+    return actualSize;
+}
+
 }  // extern "C"
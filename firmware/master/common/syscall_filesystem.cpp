@@ -41,6 +41,22 @@
 #include "svmloader.h"
 #include "elfprogram.h"
 
+/// Default to reading the running volume, but allow overriding this.
+static bool readableParentVolume(_SYSVolumeHandle parent, FlashVolume &vol)
+{
+    if (parent) {
+        vol = parent;
+        if (!vol.isValid()) {
+            SvmRuntime::fault(F_BAD_VOLUME_HANDLE);
+            return false;
+        }
+    } else {
+        vol = SvmLoader::getRunningVolume();
+        ASSERT(vol.isValid());
+    }
+    return true;
+}
+
 extern "C" {
 
 
@@ -162,18 +178,9 @@ uint32_t _SYS_elf_map(_SYSVolumeHandle volHandle)
 int32_t _SYS_fs_objectRead(unsigned key, uint8_t *buffer,
     unsigned bufferSize, _SYSVolumeHandle parent)
 {
-    // Default to reading the running volume, but allow overriding this.
     FlashVolume parentVol;
-    if (parent) {
-        parentVol = parent;
-        if (!parentVol.isValid()) {
-            SvmRuntime::fault(F_BAD_VOLUME_HANDLE);
-            return _SYS_EINVAL;
-        }
-    } else {
-        parentVol = SvmLoader::getRunningVolume();
-        ASSERT(parentVol.isValid());
-    }
+    if (!readableParentVolume(parent, parentVol))
+        return _SYS_EINVAL;
 
     if (!FlashLFSIndexRecord::isKeyAllowed(key)) {
         SvmRuntime::fault(F_SYSCALL_PARAM);
@@ -195,21 +202,107 @@ int32_t _SYS_fs_objectRead(unsigned key, uint8_t *buffer,
      * it's required that the entire object, excepting any trailing
      * 0xFF padding, must fit in the buffer. If not, we'll notice
      * a CRC failure.
+     *
+     * Repeat reads are usually answered by the LFS's key cache, without
+     * touching the index at all.
      */
 
     FlashLFS &lfs = FlashLFSCache::get(parentVol);
+
+    int cachedSize = lfs.keyCache.read(key, buffer, bufferSize);
+    if (cachedSize >= 0)
+        return cachedSize;
+
     FlashLFSObjectIter iter(lfs);
+    bool anyRecords = false;
 
     while (iter.previous(FlashLFSKeyQuery(key))) {
         unsigned size = iter.record()->getSizeInBytes();
         size = MIN(size, bufferSize);
-        if (iter.readAndCheck(buffer, size))
+        anyRecords = true;
+        if (iter.readAndCheck(buffer, size)) {
+            lfs.keyCache.store(key, iter.address(), iter.record());
             return size;
+        }
     }
 
+    if (!anyRecords)
+        lfs.keyCache.storeMissing(key);
+
     return 0;
 }
 
+uint32_t _SYS_fs_objectPrefetch(const uint8_t *keys, uint32_t count,
+    _SYSVolumeHandle parent)
+{
+    FlashVolume parentVol;
+    if (!readableParentVolume(parent, parentVol))
+        return 0;
+
+    FlashLFS &lfs = FlashLFSCache::get(parentVol);
+
+    /*
+     * Collect the set of keys that aren't already cached. The key list
+     * may live in either RAM or flash, so copy it in small chunks.
+     */
+
+    FlashLFSIndexRecord::KeyVector_t wanted;
+    SvmMemory::VirtAddr va = reinterpret_cast<SvmMemory::VirtAddr>(keys);
+    FlashBlockRef ref;
+
+    wanted.clear();
+    while (count) {
+        uint8_t chunk[32];
+        unsigned chunkSize = MIN(count, sizeof chunk);
+
+        if (!SvmMemory::copyROData(ref, reinterpret_cast<SvmMemory::PhysAddr>(chunk),
+            va, chunkSize)) {
+            SvmRuntime::fault(F_SYSCALL_ADDRESS);
+            return 0;
+        }
+
+        for (unsigned i = 0; i != chunkSize; ++i)
+            if (!lfs.keyCache.contains(chunk[i]))
+                wanted.mark(chunk[i]);
+
+        va += chunkSize;
+        count -= chunkSize;
+    }
+    ref.release();
+
+    /*
+     * One backwards traversal finds the newest record for every wanted
+     * key. Keys drop out of the query as they're found, so the meta-index
+     * filters can skip rows that hold nothing we still need.
+     *
+     * We don't CRC the objects here; that would mean reading all of the
+     * data twice. A cache hit is always CRC'ed by the later read, and a
+     * newest copy that fails its check falls back to a full search.
+     */
+
+    unsigned found = 0;
+    unsigned remaining = wanted.popcount();
+    FlashLFSIndexRecord::KeyVector_t excluded = wanted;
+    excluded.invert();
+
+    FlashLFSObjectIter iter(lfs);
+    while (remaining && iter.previous(FlashLFSKeyQuery(&excluded))) {
+        unsigned key = iter.record()->getKey();
+        lfs.keyCache.store(key, iter.address(), iter.record());
+        excluded.mark(key);
+        wanted.clear(key);
+        remaining--;
+        found++;
+    }
+
+    // Anything we didn't find has no records at all
+    unsigned key;
+    while (wanted.clearFirst(key))
+        lfs.keyCache.storeMissing(key);
+
+    return found;
+}
+
 int32_t _SYS_fs_objectWrite(unsigned key, const uint8_t *data, unsigned dataSize)
 {
     // Programs may only write objects in their own local volume
@@ -266,6 +359,22 @@ int32_t _SYS_fs_objectWrite(unsigned key, const uint8_t *data, unsigned dataSize
     uint32_t currentAddr = allocator.address();
     uint32_t remainingBytes = dataSize;
 
+    /*
+     * Usually the whole object can be mapped at once, and it reaches the
+     * device in a single write. If not, fall back on block-sized chunks.
+     */
+
+    if (remainingBytes) {
+        FlashBlockRef window[SvmMemory::MAX_WINDOW_BLOCKS];
+        SvmMemory::PhysAddr pa;
+
+        ref.release();
+        if (SvmMemory::mapROWindow(window, va, remainingBytes, pa)) {
+            FlashDevice::write(currentAddr, pa, remainingBytes);
+            remainingBytes = 0;
+        }
+    }
+
     while (remainingBytes) {
         SvmMemory::PhysAddr pa;
         uint32_t chunk = remainingBytes;
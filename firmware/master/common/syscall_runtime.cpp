@@ -37,6 +37,7 @@
 #include "svmclock.h"
 #include "radio.h"
 #include "cubeslots.h"
+#include "paintcontrol.h"
 #include "event.h"
 #include "tasks.h"
 #include "shutdown.h"
@@ -82,6 +83,14 @@ void _SYS_paintUnlimited(void)
     SvmRuntime::dispatchEventsOnReturn();
 }
 
+void _SYS_setPaintPipeline(uint32_t depth, uint32_t frameIntervalUS)
+{
+    if (depth > _SYS_MAX_PAINT_PIPELINE)
+        return SvmRuntime::fault(F_SYSCALL_PARAM);
+
+    PaintControl::setPipeline(depth, frameIntervalUS);
+}
+
 void _SYS_finish(void)
 {
     CubeSlots::finishCubes(CubeSlots::userConnected);
@@ -101,6 +110,14 @@ void _SYS_setVector(_SYSVectorID vid, void *handler, void *context)
     SvmRuntime::fault(F_SYSCALL_PARAM);
 }
 
+void _SYS_setVectorBatched(_SYSVectorID vid, void *handler, void *context)
+{
+    if (vid < _SYS_NUM_VECTORS && Event::vectorSupportsBatch(vid))
+        return Event::setVector(vid, handler, context, true);
+
+    SvmRuntime::fault(F_SYSCALL_PARAM);
+}
+
 void *_SYS_getVectorHandler(_SYSVectorID vid)
 {
     if (vid < _SYS_NUM_VECTORS)
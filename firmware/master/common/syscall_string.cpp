@@ -31,25 +31,128 @@
  */
 
 #include <sifteo/abi.h>
+#include <string.h>
 #include "svmmemory.h"
 #include "svmruntime.h"
 #include "crc.h"
 #include "svmfastlz.h"
 
+#if defined(SIFTEO_SIMULATOR) && defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+
+/*
+ * Word fill and copy, used by the memset/memcpy syscalls once both ends
+ * are known to be word-aligned RAM.
+ *
+ * On hardware, the bulk of the work is done 32 bytes at a time with
+ * eight-register STM (and LDM) bursts, which keep the bus busy with one
+ * instruction per 32 bytes. In the simulator we use SSE2 stores for fills,
+ * and the host's memcpy() for copies.
+ */
+
+static void fill32(uint32_t *dest, uint32_t value, uint32_t count)
+{
+    uint32_t blocks = count >> 3;
+    count &= 7;
+
+    if (blocks) {
+        #ifdef SIFTEO_SIMULATOR
+            #ifdef __SSE2__
+                __m128i v = _mm_set1_epi32(value);
+                do {
+                    _mm_storeu_si128((__m128i*) dest, v);
+                    _mm_storeu_si128((__m128i*) (dest + 4), v);
+                    dest += 8;
+                } while (--blocks);
+            #else
+                do {
+                    dest[0] = dest[1] = dest[2] = dest[3] = value;
+                    dest[4] = dest[5] = dest[6] = dest[7] = value;
+                    dest += 8;
+                } while (--blocks);
+            #endif
+        #else
+            asm volatile (
+                "mov    r3, %[value]                            \n"
+                "mov    r4, %[value]                            \n"
+                "mov    r5, %[value]                            \n"
+                "mov    r6, %[value]                            \n"
+                "mov    r8, %[value]                            \n"
+                "mov    r9, %[value]                            \n"
+                "mov    r10, %[value]                           \n"
+                "mov    r11, %[value]                           \n"
+            "1:                                                 \n"
+                "stmia  %[dest]!, {r3-r6, r8-r11}               \n"
+                "subs   %[blocks], #1                           \n"
+                "bne    1b                                      \n"
+                : [dest] "+r" (dest), [blocks] "+r" (blocks)
+                : [value] "r" (value)
+                : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r11", "cc", "memory");
+        #endif
+    }
+
+    while (count--)
+        *(dest++) = value;
+}
+
+static void copy32(uint32_t *dest, const uint32_t *src, uint32_t count)
+{
+    #ifdef SIFTEO_SIMULATOR
+        memcpy(dest, src, count * sizeof *dest);
+    #else
+        uint32_t blocks = count >> 3;
+        count &= 7;
+
+        if (blocks) {
+            asm volatile (
+            "1:                                                 \n"
+                "ldmia  %[src]!, {r3-r6, r8-r11}                \n"
+                "stmia  %[dest]!, {r3-r6, r8-r11}               \n"
+                "subs   %[blocks], #1                           \n"
+                "bne    1b                                      \n"
+                : [dest] "+r" (dest), [src] "+r" (src), [blocks] "+r" (blocks)
+                :
+                : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r11", "cc", "memory");
+        }
+
+        while (count--)
+            *(dest++) = *(src++);
+    #endif
+}
+
 extern "C" {
 
-#define MEMSET_BODY() {                                                 \
-    if (SvmMemory::mapRAM(dest, mulsat16x16(sizeof *dest, count))) {    \
-        while (count) {                                                 \
-            *(dest++) = value;                                          \
-            count--;                                                    \
-        }                                                               \
-    }                                                                   \
+void _SYS_memset8(uint8_t *dest, uint8_t value, uint32_t count)
+{
+    // The C library's memset() already works a word at a time
+    if (SvmMemory::mapRAM(dest, count))
+        memset(dest, value, count);
 }
 
-void _SYS_memset8(uint8_t *dest, uint8_t value, uint32_t count) MEMSET_BODY()
-void _SYS_memset16(uint16_t *dest, uint16_t value, uint32_t count) MEMSET_BODY()
-void _SYS_memset32(uint32_t *dest, uint32_t value, uint32_t count) MEMSET_BODY()
+void _SYS_memset16(uint16_t *dest, uint16_t value, uint32_t count)
+{
+    if (!SvmMemory::mapRAM(dest, mulsat16x16(sizeof *dest, count)) || !count)
+        return;
+
+    // Unaligned leading halfword, then whole words, then a trailing halfword
+
+    if (!isAligned(dest)) {
+        *(dest++) = value;
+        count--;
+    }
+
+    fill32(reinterpret_cast<uint32_t*>(dest), value | (uint32_t(value) << 16), count >> 1);
+
+    if (count & 1)
+        dest[count - 1] = value;
+}
+
+void _SYS_memset32(uint32_t *dest, uint32_t value, uint32_t count)
+{
+    if (SvmMemory::mapRAM(dest, mulsat16x16(sizeof *dest, count)))
+        fill32(dest, value, count);
+}
 
 void _SYS_memcpy8(uint8_t *dest, const uint8_t *src, uint32_t count)
 {
@@ -61,24 +164,45 @@ void _SYS_memcpy8(uint8_t *dest, const uint8_t *src, uint32_t count)
 
 void _SYS_memcpy16(uint16_t *dest, const uint16_t *src, uint32_t count)
 {
-    // Currently implemented in terms of memcpy8. We may provide a
-    // separate optimized implementation of this syscall in the future.   
-
     if (!isAligned(dest, 2) || !isAligned(src, 2))
         return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
 
-    _SYS_memcpy8((uint8_t*) dest, (const uint8_t*) src, mulsat16x16(sizeof *dest, count));
+    uint32_t bytes = mulsat16x16(sizeof *dest, count);
+
+    // Word-aligned RAM-to-RAM copies take the burst path, like memcpy32.
+    // Anything else (flash sources, odd halfwords) goes through memcpy8.
+
+    if (isAligned(dest) && isAligned(src)) {
+        uint16_t *destPA = dest;
+        const uint16_t *srcPA = src;
+
+        if (SvmMemory::mapRAM(destPA, bytes) && SvmMemory::mapRAM(srcPA, bytes)) {
+            copy32(reinterpret_cast<uint32_t*>(destPA),
+                reinterpret_cast<const uint32_t*>(srcPA), count >> 1);
+            if (count & 1)
+                destPA[count - 1] = srcPA[count - 1];
+            return;
+        }
+    }
+
+    _SYS_memcpy8((uint8_t*) dest, (const uint8_t*) src, bytes);
 }
 
 void _SYS_memcpy32(uint32_t *dest, const uint32_t *src, uint32_t count)
 {
-    // Currently implemented in terms of memcpy8. We may provide a
-    // separate optimized implementation of this syscall in the future.
-
     if (!isAligned(dest) || !isAligned(src))
         return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
 
-    _SYS_memcpy8((uint8_t*) dest, (const uint8_t*) src, mulsat16x16(sizeof *dest, count));
+    uint32_t bytes = mulsat16x16(sizeof *dest, count);
+    uint32_t *destPA = dest;
+    const uint32_t *srcPA = src;
+
+    // RAM-to-RAM copies use LDM/STM bursts; flash sources go through the cache.
+
+    if (SvmMemory::mapRAM(destPA, bytes) && SvmMemory::mapRAM(srcPA, bytes))
+        copy32(destPA, srcPA, count);
+    else
+        _SYS_memcpy8((uint8_t*) dest, (const uint8_t*) src, bytes);
 }
 
 uint32_t _SYS_crc32(const uint8_t *data, uint32_t count)
@@ -33,6 +33,8 @@
 #include <sifteo/abi.h>
 #include <stdlib.h>
 #include "macros.h"
+#include "svmmemory.h"
+#include "svmruntime.h"
 
 extern "C" {
 
@@ -358,5 +360,58 @@ uint32_t _SYS_tcosf(uint32_t a)
     return reinterpret_cast<uint32_t&>(r);
 }
 
+void _SYS_tsincosi_array(_SYSInt2 *results, const int32_t *angles, uint32_t count)
+{
+    /*
+     * Batch form of tcosi() and tsini(). Each result is the unit vector
+     * (cos, sin) for the corresponding angle. Both arrays are validated
+     * once, so userspace pays for one syscall instead of two per angle.
+     */
+
+    if (!isAligned(results) || !isAligned(angles))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+
+    if (!SvmMemory::mapRAM(results, mulsat16x16(sizeof *results, count)) ||
+        !SvmMemory::mapRAM(angles, mulsat16x16(sizeof *angles, count)))
+        return SvmRuntime::fault(F_SYSCALL_ADDRESS);
+
+    for (; count; --count, ++results, ++angles) {
+        uint32_t a = *angles;
+        results->x = _SYS_tsini(a + 0x800);
+        results->y = _SYS_tsini(a);
+    }
+}
+
+void _SYS_affine_transformi(const _SYSAffineQ16 *m, const _SYSInt2 *src, _SYSInt2 *dest, uint32_t count)
+{
+    /*
+     * Apply one Q16 affine matrix to an array of Q16 points. 'src' and
+     * 'dest' may be the same array.
+     *
+     * Each product is truncated to Q16 before summing, so the results
+     * are bit-identical to FixedAffineMatrix::transform() in userspace.
+     */
+
+    if (!isAligned(m) || !isAligned(src) || !isAligned(dest))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+
+    _SYSAffineQ16 mat;
+    if (!SvmMemory::copyROData(mat, m))
+        return SvmRuntime::fault(F_SYSCALL_ADDRESS);
+
+    if (!SvmMemory::mapRAM(src, mulsat16x16(sizeof *src, count)) ||
+        !SvmMemory::mapRAM(dest, mulsat16x16(sizeof *dest, count)))
+        return SvmRuntime::fault(F_SYSCALL_ADDRESS);
+
+    for (; count; --count, ++src, ++dest) {
+        int64_t x = src->x;
+        int64_t y = src->y;
+        int32_t rx = int32_t((mat.xx * x) >> 16) + int32_t((mat.yx * y) >> 16) + mat.cx;
+        int32_t ry = int32_t((mat.xy * x) >> 16) + int32_t((mat.yy * y) >> 16) + mat.cy;
+        dest->x = rx;
+        dest->y = ry;
+    }
+}
+
 
 }  // extern "C"
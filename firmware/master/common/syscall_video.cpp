@@ -278,6 +278,88 @@ void _SYS_vbuf_wrect(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_t
     }
 }
 
+void _SYS_vbuf_batch(struct _SYSVideoBuffer *vbuf, const struct _SYSVideoOp *ops, uint16_t count)
+{
+    /*
+     * Apply a whole list of fill/seqi/write/writei operations in one
+     * syscall. Each op is processed in runs that stay within one 32-word
+     * cm1 group, so locking and dirty-bit marking happen per group
+     * rather than per word.
+     */
+
+    if (!isAligned(vbuf) || !isAligned(ops))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+
+    if (!SvmMemory::mapRAM(vbuf) ||
+        !SvmMemory::mapRAM(ops, mulsat16x16(sizeof *ops, count))) {
+        SvmRuntime::fault(F_SYSCALL_ADDRESS);
+        return;
+    }
+
+    FlashBlockRef ref;
+    uint16_t words[32];
+
+    for (; count; --count, ++ops) {
+        uint16_t code = ops->code;
+        uint16_t addr = ops->addr;
+        uint16_t remaining = ops->count;
+        uint16_t arg = ops->arg;
+        SvmMemory::VirtAddr srcVA = ops->pSrc;
+
+        if (code > _SYS_VOP_WRITEI)
+            return SvmRuntime::fault(F_SYSCALL_PARAM);
+        if (code >= _SYS_VOP_WRITE && (srcVA & 1))
+            return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+
+        while (remaining) {
+            VRAM::truncateWordAddr(addr);
+            unsigned chunk = MIN(remaining, 32 - VRAM::indexCM1(addr));
+
+            switch (code) {
+
+            case _SYS_VOP_FILL:
+                for (unsigned i = 0; i != chunk; ++i)
+                    words[i] = arg;
+                break;
+
+            case _SYS_VOP_SEQI:
+                for (unsigned i = 0; i != chunk; ++i)
+                    words[i] = _SYS_TILE77(arg++);
+                break;
+
+            case _SYS_VOP_WRITE:
+            case _SYS_VOP_WRITEI:
+                if (!SvmMemory::copyROData(ref,
+                    reinterpret_cast<SvmMemory::PhysAddr>(words),
+                    srcVA, chunk * sizeof words[0])) {
+                    SvmRuntime::fault(F_SYSCALL_ADDRESS);
+                    return;
+                }
+                srcVA += chunk * sizeof words[0];
+                if (code == _SYS_VOP_WRITEI)
+                    for (unsigned i = 0; i != chunk; ++i)
+                        words[i] = _SYS_TILE77(uint16_t(words[i] + arg));
+                break;
+            }
+
+            VRAM::pokeGroup(*vbuf, addr, words, chunk);
+            addr += chunk;
+            remaining -= chunk;
+        }
+    }
+}
+
+void _SYS_vbuf_setChangeLog(struct _SYSVideoBuffer *vbuf, struct _SYSVideoChangeLog *log)
+{
+    if (!isAligned(vbuf) || !isAligned(log))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+    if (!SvmMemory::mapRAM(vbuf) || !SvmMemory::mapRAM(log, sizeof *log, true))
+        return SvmRuntime::fault(F_SYSCALL_ADDRESS);
+
+    if (!VRAMChangeLog::attach(vbuf, log))
+        return SvmRuntime::fault(F_SYSCALL_PARAM);
+}
+
 void _SYS_vbuf_spr_resize(struct _SYSVideoBuffer *vbuf, unsigned id, unsigned width, unsigned height)
 {
     // Address validation occurs after these calculations, in _SYS_vbuf_poke.
@@ -53,6 +53,20 @@ struct SysTime {
     typedef int64_t Ticks;
     static Ticks ticks();
 
+#ifndef SIFTEO_SIMULATOR
+    /*
+     * Tickless idle, hardware only. Both must be called with interrupts
+     * masked, around a single WFI.
+     *
+     * stretchTick() lets the timer period in progress run on through up to
+     * 'beats' heartbeats, if there's room to. restoreTick() puts the timer
+     * back on its regular schedule, and makes up any heartbeats that went
+     * by without an interrupt.
+     */
+    static void stretchTick(unsigned beats);
+    static void restoreTick();
+#endif
+
     /*
      * Convert common things to and from Ticks.
      *
@@ -37,6 +37,8 @@
 #include "batterylevel.h"
 #include "volume.h"
 #include "btprotocol.h"
+#include "flash_preerase.h"
+#include "flash_syslfs.h"
 
 #ifdef SIFTEO_SIMULATOR
 #   include "mc_timing.h"
@@ -52,6 +54,18 @@
 #   if (BOARD == BOARD_TEST_JIG)
 #       include "testjig.h"
 #   endif
+#   ifdef CYCLE_PROFILER
+#       include "cycleprofiler.h"
+#   endif
+#endif
+
+/*
+ * Tickless idle needs the real SysTick, with the heartbeat running off it.
+ * The GDB rework makes waitForInterrupt() a no-op, so there's no point.
+ */
+#if !defined(SIFTEO_SIMULATOR) && !defined(BOOTLOADER) && !defined(RFTEST) && \
+    !defined(REV2_GDB_REWORK) && (BOARD != BOARD_TEST_JIG)
+#   define TICKLESS_IDLE
 #endif
 
 
@@ -85,6 +99,8 @@ ALWAYS_INLINE void Tasks::taskInvoke(unsigned id)
         case Tasks::Heartbeat:          return heartbeatTask();
         case Tasks::FaultLogger:        return FaultLogger::task();
         case Tasks::BluetoothProtocol:  return BTProtocol::task();
+        case Tasks::PreEraser:          return FlashBlockPreEraser::task();
+        case Tasks::SysLFSWriter:       return SysLFS::task();
     #endif
 
     #if !defined(SIFTEO_SIMULATOR) && defined(HAVE_NRF8001) && !defined(BOOTLOADER)
@@ -118,12 +134,18 @@ void Tasks::heartbeatTask()
 
 #if !BOARD_EQUALS(BOARD_TEST_JIG)
 
+    // Usually one, more if we slept through some in a tickless idle
+    uint32_t beats = Atomic::Load(pendingBeats);
+    Atomic::Add(pendingBeats, -beats);
+
     #ifndef DISABLE_IDLETIMEOUT
-    IdleTimeout::heartbeat();
+    IdleTimeout::heartbeat(beats);
     #endif
 
     Radio::heartbeat();
     AssetLoader::heartbeat();
+    FlashBlockPreEraser::heartbeat(beats);
+    SysLFS::heartbeat(beats);
 
 #endif
 
@@ -133,12 +155,48 @@ void Tasks::heartbeatTask()
 }
 
 
+/*
+ * How many heartbeats can go by before anyone needs one? Consumers that
+ * only count beats can take them all at once later. Anyone who polls
+ * hardware or a deadline on every beat holds us to one.
+ *
+ * Audio and paint don't appear here. Both are driven by their own
+ * interrupts, and any interrupt ends a tickless sleep early. ADC volume
+ * and battery sampling can skip beats too; with no audio playing, nobody
+ * notices a late volume reading, and the battery changes slowly.
+ */
+#ifdef TICKLESS_IDLE
+unsigned Tasks::idleBeats()
+{
+    unsigned beats = MAX_IDLE_BEATS;
+
+#if !defined(BOOTLOADER) && !BOARD_EQUALS(BOARD_TEST_JIG)
+
+    #ifndef DISABLE_IDLETIMEOUT
+    beats = MIN(beats, IdleTimeout::idleBeats());
+    #endif
+
+    beats = MIN(beats, Radio::idleBeats());
+    beats = MIN(beats, AssetLoader::idleBeats());
+    beats = MIN(beats, FlashBlockPreEraser::idleBeats());
+    beats = MIN(beats, SysLFS::idleBeats());
+
+#endif
+
+    return beats;
+}
+#endif // TICKLESS_IDLE
+
+
 /***********************************************************************************
  ***********************************************************************************/
 
 uint32_t Tasks::pendingMask;
 uint32_t Tasks::iterationMask;
 uint32_t Tasks::watchdogCounter;
+uint32_t Tasks::pendingBeats;
+SysTime::Ticks Tasks::taskStartTicks;
+Tasks::TaskStats Tasks::stats[Tasks::NUM_TASKS];
 
 
 bool Tasks::work(uint32_t exclude)
@@ -173,7 +231,7 @@ bool Tasks::work(uint32_t exclude)
      * an infinite loop in such cases.
      */
     #ifdef SIFTEO_SIMULATOR
-    SystemMC::elapseTicks(MCTiming::TICKS_PER_TASKS_WORK);
+    SystemMC::elapseTicks(MCTiming::TICKS_PER_TASKS_WORK, SvmProfiler::Tasks);
     #endif
 
     // Clear only the bits we managed to capture above
@@ -200,15 +258,75 @@ bool Tasks::work(uint32_t exclude)
     ASSERT((tasks & exclude) == 0);
     iterationMask = tasks;
 
+    SysTime::Ticks passStart = SysTime::ticks();
+    SysTime::Ticks outerTaskStart = taskStartTicks;
+
     do {
         unsigned idx = Intrinsic::CLZ(tasks);
-        taskInvoke(idx);
-        tasks = (iterationMask &= ~Intrinsic::LZ(idx));
+        uint32_t bit = Intrinsic::LZ(idx);
+
+        SysTime::Ticks start = SysTime::ticks();
+        taskStartTicks = start;
+
+        #ifdef CYCLE_PROFILER
+            uint32_t cycleStart = CycleProfiler::now();
+            taskInvoke(idx);
+            CycleProfiler::endTask(idx, cycleStart);
+        #else
+            taskInvoke(idx);
+        #endif
+
+        SysTime::Ticks now = SysTime::ticks();
+        recordRun(idx, now - start);
+
+        tasks = (iterationMask &= ~bit);
+
+        if (tasks && now - passStart > SysTime::usTicks(WORK_BUDGET_US)) {
+            /*
+             * Out of time for this pass. Hand the remainder back to
+             * pendingMask; they'll be first in line on the next work().
+             */
+            Atomic::Or(pendingMask, tasks);
+            iterationMask = 0;
+            break;
+        }
+
+        /*
+         * Anything triggered while that task ran which outranks it also
+         * outranks everything left in this pass. Pull it in now, instead
+         * of making (for example) AudioPull wait behind a string of
+         * lower priority tasks. Tasks that re-trigger themselves can
+         * never outrank themselves, so this always terminates.
+         */
+        uint32_t urgent = pendingMask & ~exclude & ~(bit | (bit - 1));
+        if (urgent) {
+            Atomic::And(pendingMask, ~urgent);
+            tasks = (iterationMask |= urgent);
+        }
     } while (tasks);
 
+    taskStartTicks = outerTaskStart;
     return true;
 }
 
+void Tasks::recordRun(unsigned id, SysTime::Ticks elapsed)
+{
+    ASSERT(id < NUM_TASKS);
+    TaskStats &s = stats[id];
+
+    s.runs++;
+    s.totalTicks += elapsed;
+    if (elapsed > SysTime::usTicks(TASK_BUDGET_US))
+        s.overruns++;
+    if (elapsed > s.maxTicks)
+        s.maxTicks = MIN(elapsed, SysTime::Ticks(0xFFFFFFFF));
+}
+
+bool Tasks::overBudget()
+{
+    return SysTime::ticks() - taskStartTicks > SysTime::usTicks(TASK_BUDGET_US);
+}
+
 void Tasks::idle(uint32_t exclude)
 {
     /*
@@ -218,16 +336,47 @@ void Tasks::idle(uint32_t exclude)
      * caller is waiting on something which requires Tasks to execute.
      */
 
-    if (!work(exclude))
-        waitForInterrupt();
+    if (work(exclude))
+        return;
+
+#ifdef TICKLESS_IDLE
+    unsigned beats = idleBeats();
+    if (beats > 1) {
+        /*
+         * Tickless: stretch the SysTick period in progress across 'beats'
+         * heartbeats, and sleep. Interrupts stay masked until the timer is
+         * back on its regular schedule. WFI still wakes on a pending
+         * interrupt, it just doesn't run the handler until we unmask.
+         *
+         * Check pendingMask again with interrupts masked, since an ISR
+         * that triggered a task after work() looked would otherwise cost
+         * us the whole stretched period.
+         */
+
+        __asm__ __volatile__ ("cpsid i" : : : "memory");
+
+        if (!(pendingMask & ~exclude)) {
+            SysTime::stretchTick(beats);
+            waitForInterrupt();
+            SysTime::restoreTick();
+        }
+
+        __asm__ __volatile__ ("cpsie i" : : : "memory");
+        return;
+    }
+#endif
+
+    waitForInterrupt();
 }
 
-void Tasks::heartbeatISR()
+void Tasks::heartbeatISR(unsigned beats)
 {
+    Atomic::Add(pendingBeats, beats);
+
     #ifndef DISABLE_WATCHDOG
 
     // Check the watchdog timer
-    if (++watchdogCounter >= WATCHDOG_DURATION) {
+    if ((watchdogCounter += beats) >= WATCHDOG_DURATION) {
 
         /*
          * Help diagnose the hang for internal firmware debugging
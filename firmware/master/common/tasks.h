@@ -28,6 +28,8 @@
 
 #include "macros.h"
 #include "machine.h"
+#include "systime.h"
+#include <string.h>
 
 #ifndef SIFTEO_SIMULATOR
 #include "board.h"
@@ -73,12 +75,42 @@ public:
         UsbIN,
         Profiler,
         TestJig,
-        FactoryTest
+        FactoryTest,
+        PreEraser,
+        SysLFSWriter,
+
+        NUM_TASKS   // must be last
+    };
+
+    /*
+     * Scheduling budgets.
+     *
+     * A single work() pass stops invoking tasks once it has run for longer
+     * than WORK_BUDGET_US, and defers whatever is left back to pendingMask
+     * so that user code and the next syscall boundary get a turn. Long
+     * running task handlers are expected to poll overBudget() and
+     * re-trigger themselves rather than finishing everything in one go.
+     */
+    static const unsigned TASK_BUDGET_US = 1000;
+    static const unsigned WORK_BUDGET_US = 2000;
+
+    /*
+     * Per-task instrumentation, readable over USB via the Profiler
+     * subsystem. Times are in SysTime::Ticks, and are inclusive of any
+     * nested work() that runs from within the task.
+     */
+    struct TaskStats {
+        uint32_t runs;
+        uint32_t overruns;      // Runs longer than TASK_BUDGET_US
+        uint32_t maxTicks;
+        SysTime::Ticks totalTicks;
     };
 
     static void init() {
         pendingMask = 0;
         watchdogCounter = 0;
+        pendingBeats = 0;
+        resetStats();
     }
 
     /*
@@ -100,11 +132,23 @@ public:
      * This timer MUST be long enough, worst case, for one 64kB flash block erasure.
      * Typical erase time is 1/2 second, but the data sheet specifies a max of 1 second.
      * To be on the safe side, our timeout is currently 3 seconds.
+     *
+     * After a tickless idle, one call may stand in for several 'beats'.
+     * The Heartbeat task passes that count on to anyone who counts beats.
      */
-    static void heartbeatISR();
+    static void heartbeatISR(unsigned beats = 1);
     static const unsigned HEARTBEAT_HZ = 10;
     static const unsigned WATCHDOG_DURATION = HEARTBEAT_HZ * 3;
 
+    /*
+     * Tickless idle. When idle() finds nothing to do, and every heartbeat
+     * consumer agrees it can wait, the hardware may sleep through up to
+     * MAX_IDLE_BEATS heartbeats without a timer interrupt. Any other
+     * interrupt ends the sleep early, and puts the heartbeat back on its
+     * regular schedule.
+     */
+    static const unsigned MAX_IDLE_BEATS = 16;
+
     /// One-shot, execute a task once at the next opportunity
     static ALWAYS_INLINE void trigger(TaskID id) {
         Atomic::SetLZ(pendingMask, id);
@@ -140,6 +184,22 @@ public:
         watchdogCounter = 0;
     }
 
+    /*
+     * Has the currently running task used up its TASK_BUDGET_US? Tasks
+     * that can split their work should check this, trigger() themselves,
+     * and return early.
+     */
+    static bool overBudget();
+
+    static ALWAYS_INLINE const TaskStats &getStats(TaskID id) {
+        ASSERT(id < NUM_TASKS);
+        return stats[id];
+    }
+
+    static void resetStats() {
+        memset(stats, 0, sizeof stats);
+    }
+
     /*
      * Block until the next hardware event occurs.
      * (Emulated in siftulator, one instruction in hardware)
@@ -159,9 +219,14 @@ private:
     static uint32_t pendingMask;
     static uint32_t iterationMask;
     static uint32_t watchdogCounter;
+    static uint32_t pendingBeats;
+    static SysTime::Ticks taskStartTicks;
+    static TaskStats stats[NUM_TASKS];
 
     static void heartbeatTask();
+    static unsigned idleBeats();
     static ALWAYS_INLINE void taskInvoke(unsigned id);
+    static void recordRun(unsigned id, SysTime::Ticks elapsed);
 };
 
 #endif // TASKS_H
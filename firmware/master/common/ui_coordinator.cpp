@@ -27,6 +27,8 @@
 #include "ui_coordinator.h"
 #include "cube.h"
 #include "cubeslots.h"
+#include "cubecodec.h"
+#include "vram.h"
 #include "machine.h"
 #include "tasks.h"
 
@@ -144,14 +146,26 @@ void UICoordinator::attachToCube(_SYSCubeID id)
      * to copy over the SYSVideoBuffer flags and VRAM flags from the
      * old buffer (if any), but to init the rest of our buffer from
      * scratch.
+     *
+     * If there was an old buffer, the cube is still showing it (apart
+     * from the stipple), so only words that differ from it need to be
+     * sent. Our own VRAM keeps whatever the last UI drew, so a UI that
+     * comes back to the same cube mostly redraws for free.
      */
 
-    VRAM::init(avb.vbuf);
     savedVBuf = cube.getVBuf();
 
     if (savedVBuf) {
+        avb.vbuf.lock = 0;
+        memset(avb.vbuf.cm1, 0, sizeof avb.vbuf.cm1);
         avb.vbuf.flags = savedVBuf->flags;
         avb.vbuf.vram.flags = savedVBuf->vram.flags;
+
+        VRAM::markDifferences(avb.vbuf, *savedVBuf);
+        for (unsigned i = 0; i != CubeCodec::NUM_STIPPLE_WORDS; ++i)
+            VRAM::markDirty(avb.vbuf, CubeCodec::stippleWords[i]);
+    } else {
+        VRAM::init(avb.vbuf);
     }
 
     avb.cube = id;
@@ -189,6 +203,8 @@ void UICoordinator::detach()
     finish();
 
     if (savedVBuf) {
+        // Resend only what we drew over the old buffer's contents
+        VRAM::markDifferences(*savedVBuf, avb.vbuf);
         savedVBuf->flags = avb.vbuf.flags;
         VRAM::pokeb(*savedVBuf, offsetof(_SYSVideoRAM, flags), avb.vbuf.vram.flags);
     }
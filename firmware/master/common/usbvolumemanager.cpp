@@ -30,6 +30,7 @@
 #include "flash_volumeheader.h"
 #include "flash_syslfs.h"
 #include "flash_stack.h"
+#include "crc.h"
 
 #ifndef SIFTEO_SIMULATOR
 #include "usb/usbdevice.h"
@@ -37,6 +38,9 @@
 
 FlashVolumeWriter UsbVolumeManager::writer;
 UsbVolumeManager::LFSObjectWriteStatus UsbVolumeManager::lfsWriter;
+UsbVolumeManager::DeltaWriteStatus UsbVolumeManager::deltaWriter;
+bool UsbVolumeManager::writeInProgress;
+bool UsbVolumeManager::restoreInProgress;
 
 void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
 {
@@ -56,7 +60,10 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         if (!memchr(packageStr, 0, m.payloadLen() - 4))
             break;
 
-        if (writer.beginGame(numBytes, packageStr)) {
+        deltaWriter.base = FlashMapBlock::invalid();
+        deltaWriter.payloadBytes = numBytes;
+        writeInProgress = writer.beginGame(numBytes, packageStr);
+        if (writeInProgress) {
             reply.header |= WroteHeaderOK;
         } else {
             reply.header |= WroteHeaderFail;
@@ -73,7 +80,10 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
             break;
 
         const uint32_t numBytes = *reinterpret_cast<const uint32_t*>(m.payload);
-        if (writer.beginLauncher(numBytes)) {
+        deltaWriter.base = FlashMapBlock::invalid();
+        deltaWriter.payloadBytes = numBytes;
+        writeInProgress = writer.beginLauncher(numBytes);
+        if (writeInProgress) {
             reply.header |= WroteHeaderOK;
         } else {
             reply.header |= WroteHeaderFail;
@@ -87,15 +97,22 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         return;
 
     case WriteCommit:
-        if (writer.isPayloadComplete()) {
-            writer.commit();
-            reply.header |= WriteCommitOK;
-            reply.append(&writer.volume.block.code, 1);
-        } else {
-            reply.header |= WriteCommitFail;
-        }
+        commit(m, reply);
+        break;
+
+    case WriteGameDeltaHeader:
+        beginDeltaWrite(m, reply);
+        break;
+
+    case DeltaBlockHashes:
+        deltaBlockHashes(m, reply);
         break;
 
+    case WriteDeltaCopy:
+        // NOTE: like WritePayload, these get no response
+        deltaCopy(m);
+        return;
+
     case VolumeOverview:
         volumeOverview(reply);
         break;
@@ -104,6 +121,11 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         volumeDetail(m, reply);
         break;
 
+    case VolumeInventory:
+        // NOTE: streams its own replies
+        volumeInventory(m);
+        return;
+
     case DeleteVolume: {
         if (m.payloadLen() < sizeof(unsigned))
             break;
@@ -184,6 +206,26 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         flashDeviceRead(m, reply);
         break;
 
+    case FlashDeviceScan:
+        flashDeviceScan(m, reply);
+        break;
+
+    case FlashDeviceRestore:
+        /*
+         * Keep writeInProgress set from here on, so the pre-eraser leaves
+         * the device alone while the image is being written.
+         */
+        FlashStack::eraseDevice();
+        writeInProgress = true;
+        restoreInProgress = true;
+        reply.header |= FlashDeviceRestore;
+        break;
+
+    case FlashDeviceWrite:
+        // NOTE: like WritePayload, these get no response
+        flashDeviceWrite(m);
+        return;
+
     case BaseSysInfo:
         baseSysInfo(m, reply);
         break;
@@ -202,24 +244,35 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         return;
     }
 
+    sendReply(reply);
+}
+
+bool UsbVolumeManager::sendReply(const USBProtocolMsg &reply, unsigned timeoutMillis)
+{
 #ifndef SIFTEO_SIMULATOR
-    UsbDevice::write(reply.bytes, reply.len);
+    return UsbDevice::write(reply.bytes, reply.len, timeoutMillis) != 0;
+#else
+    return true;
 #endif
 }
 
 void UsbVolumeManager::volumeOverview(USBProtocolMsg &reply)
+{
+    VolumeOverviewReply *r = reply.zeroCopyAppend<VolumeOverviewReply>();
+    reply.header |= VolumeOverview;
+    getOverview(*r);
+}
+
+void UsbVolumeManager::getOverview(VolumeOverviewReply &r)
 {
     /*
      * Retrieve top-level info about all volumes.
      * We treat deleted, incomplete, and LFS volumes specially here.
      */
 
-    VolumeOverviewReply *r = reply.zeroCopyAppend<VolumeOverviewReply>();
-    reply.header |= VolumeOverview;
-
-    r->systemBytes = 0;
-    r->freeBytes = FlashDevice::CAPACITY;
-    r->bits.clear();
+    r.systemBytes = 0;
+    r.freeBytes = FlashDevice::CAPACITY;
+    r.bits.clear();
 
     FlashVolumeIter vi;
     FlashVolume vol;
@@ -236,60 +289,144 @@ void UsbVolumeManager::volumeOverview(USBProtocolMsg &reply)
 
         // All other volumes count against our free space
         unsigned volSize = hdr->volumeSizeInBytes();
-        r->freeBytes -= volSize;
+        r.freeBytes -= volSize;
 
         // Count space used by SysLFS
         if (hdr->parentBlock == 0 && hdr->type == FlashVolume::T_LFS) {
-            r->systemBytes += volSize;
+            r.systemBytes += volSize;
             continue;
         }
 
         // Other top-level volumes are marked in the bitmap
         if (hdr->parentBlock == 0)
-            r->bits.mark(vol.block.code);
+            r.bits.mark(vol.block.code);
     }
 }
 
 void UsbVolumeManager::volumeDetail(const USBProtocolMsg &m, USBProtocolMsg &reply)
 {
-    /*
-     * Read fixed-size details pertaining to a single volume.
-     */
-
     if (m.payloadLen() < sizeof(unsigned))
         return;
 
     unsigned volBlockCode = *m.castPayload<unsigned>();
-    FlashVolume vol = FlashMapBlock::fromCode(volBlockCode);
+    VolumeDetailReply detail;
 
-    if (vol.isValid()) {
+    if (getDetail(volBlockCode, detail)) {
         VolumeDetailReply *r = reply.zeroCopyAppend<VolumeDetailReply>();
         reply.header |= VolumeDetail;
+        *r = detail;
+    }
+}
 
-        // Map the volume header
-        FlashBlockRef ref;
-        FlashVolumeHeader *hdr = FlashVolumeHeader::get(ref, vol.block);
-        ASSERT(hdr->isHeaderValid());
+bool UsbVolumeManager::getDetail(unsigned volBlockCode, VolumeDetailReply &r)
+{
+    /*
+     * Read fixed-size details pertaining to a single volume.
+     */
 
-        r->type = hdr->type;
-        r->selfBytes = hdr->volumeSizeInBytes();
-        r->childBytes = 0;
+    FlashVolume vol = FlashMapBlock::fromCode(volBlockCode);
+    if (!vol.isValid())
+        return false;
 
-        // Total up the size of all child volumes
+    // Map the volume header
+    FlashBlockRef ref;
+    FlashVolumeHeader *hdr = FlashVolumeHeader::get(ref, vol.block);
+    ASSERT(hdr->isHeaderValid());
 
-        FlashVolumeIter vi;
-        FlashVolume child;
-        vi.begin();
-        while (vi.next(child)) {
-            if (!FlashVolume::typeIsRecyclable(child.getType()) &&
-                child.getParent().block.code == volBlockCode)
-            {
-                hdr = FlashVolumeHeader::get(ref, child.block);
-                ASSERT(hdr->isHeaderValid());
-                r->childBytes += hdr->volumeSizeInBytes();
+    r.type = hdr->type;
+    r.selfBytes = hdr->volumeSizeInBytes();
+    r.childBytes = 0;
+
+    // Total up the size of all child volumes
+
+    FlashVolumeIter vi;
+    FlashVolume child;
+    vi.begin();
+    while (vi.next(child)) {
+        if (!FlashVolume::typeIsRecyclable(child.getType()) &&
+            child.getParent().block.code == volBlockCode)
+        {
+            hdr = FlashVolumeHeader::get(ref, child.block);
+            ASSERT(hdr->isHeaderValid());
+            r.childBytes += hdr->volumeSizeInBytes();
+        }
+    }
+
+    return true;
+}
+
+void UsbVolumeManager::volumeInventory(const USBProtocolMsg &m)
+{
+    /*
+     * Stream the overview, details, and requested metadata for every
+     * top-level volume, so hosts can list a device without a round trip
+     * per volume and key. Each write waits for the previous packet to go
+     * out, so the host just keeps reading until InventoryEnd. If the host
+     * stops reading, give up rather than holding up the system.
+     */
+
+    const unsigned recordBytes = USBProtocolMsg::MAX_PAYLOAD_BYTES - sizeof(InventoryRecordHeader);
+
+    VolumeInventoryRequest req;
+    memset(&req, 0, sizeof req);
+    memcpy(&req, m.payload, MIN(m.payloadLen(), sizeof req));
+    req.numKeys = MIN(req.numKeys, MAX_INVENTORY_KEYS);
+
+    VolumeOverviewReply overview;
+    getOverview(overview);
+
+    USBProtocolMsg reply;
+    beginInventoryRecord(reply, InventoryOverview);
+    reply.append((const uint8_t*) &overview, sizeof overview);
+    if (!sendReply(reply, INVENTORY_TIMEOUT_MS))
+        return;
+
+    unsigned volBlockCode;
+    while (overview.bits.clearFirst(volBlockCode)) {
+        VolumeDetailReply detail;
+        if (!getDetail(volBlockCode, detail))
+            continue;
+
+        beginInventoryRecord(reply, InventoryVolume, volBlockCode);
+        reply.append((const uint8_t*) &detail, sizeof detail);
+        if (!sendReply(reply, INVENTORY_TIMEOUT_MS))
+            return;
+
+        FlashVolume vol = FlashMapBlock::fromCode(volBlockCode);
+
+        for (unsigned i = 0; i < req.numKeys; ++i) {
+            uint8_t meta[MAX_INVENTORY_META_BYTES];
+            unsigned metalen = Elf::Program::copyMeta(vol, req.keys[i], 1, sizeof meta, meta);
+
+            for (unsigned offset = 0; offset < metalen; offset += recordBytes) {
+                unsigned chunk = MIN(metalen - offset, recordBytes);
+
+                InventoryRecordHeader *hdr = beginInventoryRecord(reply, InventoryMetadata, volBlockCode);
+                hdr->key = req.keys[i];
+                hdr->offset = offset;
+                hdr->totalBytes = metalen;
+                reply.append(meta + offset, chunk);
+                if (!sendReply(reply, INVENTORY_TIMEOUT_MS))
+                    return;
             }
         }
     }
+
+    beginInventoryRecord(reply, InventoryEnd);
+    sendReply(reply, INVENTORY_TIMEOUT_MS);
+}
+
+UsbVolumeManager::InventoryRecordHeader *UsbVolumeManager::beginInventoryRecord(
+    USBProtocolMsg &reply, InventoryRecordType type, unsigned volBlockCode)
+{
+    reply.init(USBProtocol::Installer);
+    reply.header |= VolumeInventory;
+
+    InventoryRecordHeader *hdr = reply.zeroCopyAppend<InventoryRecordHeader>();
+    memset(hdr, 0, sizeof *hdr);
+    hdr->type = type;
+    hdr->volume = volBlockCode;
+    return hdr;
 }
 
 void UsbVolumeManager::volumeMetadata(const USBProtocolMsg &m, USBProtocolMsg &reply)
@@ -439,6 +576,63 @@ void UsbVolumeManager::flashDeviceRead(const USBProtocolMsg &m, USBProtocolMsg &
     reply.len += length;
 }
 
+void UsbVolumeManager::flashDeviceScan(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * Report which pages of one erase block are entirely erased.
+     */
+
+    const unsigned pagesPerBlock = FlashDevice::ERASE_BLOCK_SIZE / FlashDevice::PAGE_SIZE;
+    STATIC_ASSERT(pagesPerBlock == 256);
+
+    if (m.payloadLen() < sizeof(uint32_t))
+        return;
+
+    uint32_t address = *m.castPayload<uint32_t>();
+    if (address >= FlashDevice::CAPACITY || (address % FlashDevice::ERASE_BLOCK_SIZE))
+        return;
+
+    FlashDeviceScanReply *r = reply.zeroCopyAppend<FlashDeviceScanReply>();
+    reply.header |= FlashDeviceScan;
+
+    r->address = address;
+    r->erasedPages.clear();
+
+    for (unsigned page = 0; page < pagesPerBlock; ++page) {
+        uint32_t buf[16];
+        bool erased = true;
+
+        for (unsigned offset = 0; erased && offset < FlashDevice::PAGE_SIZE; offset += sizeof buf) {
+            FlashDevice::read(address + offset, reinterpret_cast<uint8_t*>(buf), sizeof buf);
+            for (unsigned i = 0; i < arraysize(buf); ++i)
+                if (buf[i] != 0xFFFFFFFF)
+                    erased = false;
+        }
+
+        if (erased)
+            r->erasedPages.mark(page);
+        address += FlashDevice::PAGE_SIZE;
+    }
+}
+
+void UsbVolumeManager::flashDeviceWrite(const USBProtocolMsg &m)
+{
+    /*
+     * Raw page data for an image restore, prefixed with its address.
+     * Only accepted once FlashDeviceRestore has wiped the device.
+     */
+
+    if (!restoreInProgress || m.payloadLen() < sizeof(uint32_t))
+        return;
+
+    uint32_t address = *m.castPayload<uint32_t>();
+    unsigned length = m.payloadLen() - sizeof(uint32_t);
+    if (address > FlashDevice::CAPACITY || length > FlashDevice::CAPACITY - address)
+        return;
+
+    FlashDevice::write(address, m.payload + sizeof(uint32_t), length);
+}
+
 void UsbVolumeManager::baseSysInfo(const USBProtocolMsg &m, USBProtocolMsg &reply)
 {
     reply.header |= BaseSysInfo;
@@ -459,8 +653,14 @@ void UsbVolumeManager::beginLFSObjectWrite(const USBProtocolMsg &m, USBProtocolM
      *
      * This essentially works like _SYS_fs_objectWrite() - it will simply
      * add new entries for any specified keys.
+     *
+     * Hosts may stream the payload without waiting for our reply, so
+     * forget any previous object first: if this header fails, its
+     * payload gets dropped rather than landing somewhere else.
      */
 
+    lfsWriter.endAddr = lfsWriter.currentAddr;
+
     if (m.payloadLen() < sizeof(LFSObjectHeader)) {
         reply.header |= WriteLFSObjectHeaderFail;
         return;
@@ -539,3 +739,177 @@ void UsbVolumeManager::lfsPayloadWrite(const USBProtocolMsg &m)
         }
     }
 }
+
+void UsbVolumeManager::commit(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * Make the volume we've been writing persistent.
+     *
+     * A commit may include a CRC of the entire payload. Delta installs
+     * always send one, since part of the payload came from data the host
+     * never saw. On a mismatch the new volume stays T_INCOMPLETE and gets
+     * recycled, and the installed volume it would have replaced survives.
+     */
+
+    if (!writer.isPayloadComplete()) {
+        reply.header |= WriteCommitFail;
+        return;
+    }
+
+    if (m.payloadLen() >= sizeof(uint32_t)) {
+        uint32_t crc = *m.castPayload<uint32_t>();
+        if (!payloadMatchesCrc(writer.volume, deltaWriter.payloadBytes, crc)) {
+            writeInProgress = false;
+            deltaWriter.base = FlashMapBlock::invalid();
+            reply.header |= WriteCommitFail;
+            return;
+        }
+    }
+
+    writer.commit();
+    writeInProgress = false;
+
+    if (deltaWriter.base.block.isValid()) {
+        deltaWriter.base.deleteTree();
+        deltaWriter.base = FlashMapBlock::invalid();
+    }
+
+    reply.header |= WriteCommitOK;
+    reply.append(&writer.volume.block.code, 1);
+}
+
+bool UsbVolumeManager::payloadMatchesCrc(FlashVolume vol, uint32_t bytes, uint32_t crc)
+{
+    /*
+     * CRC the first 'bytes' of a volume's payload, a word at a time,
+     * padding the final word with 0xFF. Payload data that hasn't been
+     * committed yet is still in the block cache, so this reads through
+     * the cache rather than directly from the device.
+     */
+
+    FlashBlockRef ref;
+    FlashMapSpan span = vol.getPayload(ref);
+    uint32_t words[DELTA_BLOCK_SIZE / sizeof(uint32_t)];
+
+    Crc32::reset();
+
+    for (uint32_t offset = 0; offset < bytes; offset += sizeof words) {
+        uint32_t chunk = MIN(bytes - offset, sizeof words);
+
+        memset(words, 0xFF, sizeof words);
+        if (!span.copyBytes(offset, reinterpret_cast<uint8_t*>(words), chunk))
+            return false;
+
+        Crc32::addWords(words, (chunk + 3) / 4);
+    }
+
+    return Crc32::get() == crc;
+}
+
+void UsbVolumeManager::beginDeltaWrite(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * Like WriteGameHeader, but the installed copy of this package
+     * given by 'base' is kept until commit, so that WriteDeltaCopy can
+     * copy its payload into the new volume.
+     *
+     * Payload: uint32 payload size, uint32 base volume code, package string.
+     */
+
+    const unsigned argBytes = 2 * sizeof(uint32_t);
+
+    if (m.payloadLen() <= argBytes) {
+        reply.header |= WroteHeaderFail;
+        return;
+    }
+
+    const uint32_t *args = m.castPayload<uint32_t>();
+    const char *packageStr = reinterpret_cast<const char*>(m.payload + argBytes);
+    if (!memchr(packageStr, 0, m.payloadLen() - argBytes)) {
+        reply.header |= WroteHeaderFail;
+        return;
+    }
+
+    FlashVolume base = FlashMapBlock::fromCode(args[1]);
+    if (!base.isValid() || base.getType() != FlashVolume::T_GAME) {
+        reply.header |= WroteHeaderFail;
+        return;
+    }
+
+    deltaWriter.base = base;
+    deltaWriter.payloadBytes = args[0];
+    writeInProgress = writer.beginGame(args[0], packageStr, base);
+
+    if (writeInProgress) {
+        reply.header |= WroteHeaderOK;
+    } else {
+        deltaWriter.base = FlashMapBlock::invalid();
+        reply.header |= WroteHeaderFail;
+    }
+}
+
+void UsbVolumeManager::deltaBlockHashes(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * CRC consecutive DELTA_BLOCK_SIZE blocks of a game's payload,
+     * starting at 'firstBlock'. The reply is short if we reach the
+     * end of the volume. Returns an empty buffer on a bad volume.
+     */
+
+    if (m.payloadLen() < sizeof(DeltaHashRequest))
+        return;
+
+    const DeltaHashRequest *req = m.castPayload<DeltaHashRequest>();
+
+    FlashVolume vol = FlashMapBlock::fromCode(req->volume);
+    if (!vol.isValid() || vol.getType() != FlashVolume::T_GAME)
+        return;
+
+    DeltaHashReply *r = reply.zeroCopyAppend<DeltaHashReply>();
+    reply.header |= DeltaBlockHashes;
+    r->firstBlock = req->firstBlock;
+    r->count = 0;
+
+    FlashBlockRef ref;
+    FlashMapSpan span = vol.getPayload(ref);
+    uint32_t words[DELTA_BLOCK_SIZE / sizeof(uint32_t)];
+
+    while (r->count < arraysize(r->crc)) {
+        uint32_t offset = (req->firstBlock + r->count) * DELTA_BLOCK_SIZE;
+        if (!span.copyBytesUncached(offset, reinterpret_cast<uint8_t*>(words), sizeof words))
+            break;
+        r->crc[r->count++] = Crc32::block(words, arraysize(words));
+    }
+}
+
+void UsbVolumeManager::deltaCopy(const USBProtocolMsg &m)
+{
+    /*
+     * Append a range of the delta base volume's payload to the volume
+     * being written. Anything malformed is dropped, which leaves the
+     * payload short so the commit will fail.
+     */
+
+    if (m.payloadLen() < sizeof(DeltaCopyRequest) || !deltaWriter.base.block.isValid())
+        return;
+
+    const DeltaCopyRequest *req = m.castPayload<DeltaCopyRequest>();
+    if (req->length > deltaWriter.payloadBytes)
+        return;
+
+    FlashBlockRef ref;
+    FlashMapSpan span = deltaWriter.base.getPayload(ref);
+    uint8_t buffer[DELTA_BLOCK_SIZE];
+    uint32_t offset = req->offset;
+    uint32_t remaining = req->length;
+
+    while (remaining) {
+        uint32_t chunk = MIN(remaining, sizeof buffer);
+        if (!span.copyBytesUncached(offset, buffer, chunk))
+            return;
+
+        writer.appendPayload(buffer, chunk);
+        offset += chunk;
+        remaining -= chunk;
+    }
+}
@@ -58,9 +58,26 @@ public:
         WriteLFSObjectHeader,
         WriteLFSObjectHeaderFail,
         WriteLFSObjectPayload,
-        DeleteLFSChildren
+        DeleteLFSChildren,
+        WriteGameDeltaHeader,
+        DeltaBlockHashes,
+        WriteDeltaCopy,
+        FlashDeviceScan,
+        FlashDeviceRestore,
+        FlashDeviceWrite,
+        VolumeInventory
     };
 
+    /*
+     * Delta installs: the host compares its new ELF against CRCs of
+     * fixed-size blocks from the installed copy of the same package,
+     * then sends a mix of WritePayload data and WriteDeltaCopy ranges
+     * which we copy out of the installed volume. WriteCommit carries a
+     * CRC of the whole payload, and the old volume is only deleted once
+     * the new one checks out.
+     */
+    static const unsigned DELTA_BLOCK_SIZE = 256;
+
     struct VolumeOverviewReply {
         unsigned systemBytes;
         unsigned freeBytes;
@@ -78,6 +95,38 @@ public:
         unsigned key;
     };
 
+    /*
+     * VolumeInventory answers a whole manifest listing in one request.
+     * The reply is a stream of packets which all carry the VolumeInventory
+     * command: one InventoryOverview record, then for each top-level volume
+     * an InventoryVolume record followed by InventoryMetadata records for
+     * each requested key it has, and finally an InventoryEnd record.
+     * Metadata too long for one packet is split across consecutive records
+     * with increasing offsets.
+     */
+    static const unsigned MAX_INVENTORY_KEYS = 8;
+    static const unsigned MAX_INVENTORY_META_BYTES = 256;
+
+    enum InventoryRecordType {
+        InventoryOverview,
+        InventoryVolume,
+        InventoryMetadata,
+        InventoryEnd
+    };
+
+    struct VolumeInventoryRequest {
+        unsigned numKeys;
+        uint16_t keys[MAX_INVENTORY_KEYS];
+    };
+
+    struct InventoryRecordHeader {
+        uint8_t type;
+        uint8_t volume;
+        uint16_t key;
+        uint16_t offset;
+        uint16_t totalBytes;
+    };
+
     struct LFSDetailRecord {
         unsigned address;
         unsigned size;
@@ -104,6 +153,33 @@ public:
         uint32_t length;
     };
 
+    /*
+     * Backups ask which pages of each erase block are blank, and only
+     * read back the rest. A restore wipes the whole device without
+     * logging the erased blocks, then writes raw pages until the host
+     * reboots us.
+     */
+    struct FlashDeviceScanReply {
+        uint32_t address;
+        BitVector<256> erasedPages;
+    };
+
+    struct DeltaHashRequest {
+        unsigned volume;
+        unsigned firstBlock;
+    };
+
+    struct DeltaHashReply {
+        unsigned firstBlock;
+        unsigned count;
+        uint32_t crc[13];
+    };
+
+    struct DeltaCopyRequest {
+        uint32_t offset;
+        uint32_t length;
+    };
+
     struct SysInfoReply {
         uint8_t baseUniqueID[SysInfo::UniqueIdNumBytes];
         uint8_t baseHwRevision;
@@ -122,8 +198,14 @@ public:
 
     static void onUsbData(const USBProtocolMsg &m);
 
+    /// Is an install holding a volume that's still T_INCOMPLETE?
+    static bool isWriting() {
+        return writeInProgress;
+    }
+
 private:
     static const unsigned SYSLFS_VOLUME_BLOCK_CODE = 0;
+    static const unsigned INVENTORY_TIMEOUT_MS = 1000;
 
     struct LFSObjectWriteStatus {
         uint32_t startAddr;
@@ -131,20 +213,41 @@ private:
         uint32_t endAddr;
     };
 
+    struct DeltaWriteStatus {
+        FlashVolume base;
+        uint32_t payloadBytes;
+    };
+
     static FlashVolumeWriter writer;
     static LFSObjectWriteStatus lfsWriter;
+    static DeltaWriteStatus deltaWriter;
+    static bool writeInProgress;
+    static bool restoreInProgress;
 
     // handlers
     static ALWAYS_INLINE void volumeOverview(USBProtocolMsg &reply);
     static ALWAYS_INLINE void volumeDetail(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static void volumeInventory(const USBProtocolMsg &m);
     static ALWAYS_INLINE void volumeMetadata(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void lfsDetail(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void pairCube(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void pairingSlotDetail(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void flashDeviceRead(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static ALWAYS_INLINE void flashDeviceScan(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static ALWAYS_INLINE void flashDeviceWrite(const USBProtocolMsg &m);
     static ALWAYS_INLINE void baseSysInfo(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void beginLFSObjectWrite(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void lfsPayloadWrite(const USBProtocolMsg &m);
+    static ALWAYS_INLINE void beginDeltaWrite(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static ALWAYS_INLINE void deltaBlockHashes(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static ALWAYS_INLINE void deltaCopy(const USBProtocolMsg &m);
+    static ALWAYS_INLINE void commit(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static void getOverview(VolumeOverviewReply &r);
+    static bool getDetail(unsigned volBlockCode, VolumeDetailReply &r);
+    static InventoryRecordHeader *beginInventoryRecord(USBProtocolMsg &reply,
+        InventoryRecordType type, unsigned volBlockCode = 0);
+    static bool sendReply(const USBProtocolMsg &reply, unsigned timeoutMillis = 0xffffffff);
+    static bool payloadMatchesCrc(FlashVolume vol, uint32_t bytes, uint32_t crc);
 };
 
 #endif // _USB_VOLUME_MANAGER_H
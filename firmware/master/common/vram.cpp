@@ -0,0 +1,128 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "vram.h"
+
+VRAMChangeLog::Entry VRAMChangeLog::entries[MAX_LOGS];
+unsigned VRAMChangeLog::numEntries;
+
+
+bool VRAMChangeLog::attach(_SYSVideoBuffer *vbuf, _SYSVideoChangeLog *log)
+{
+    /*
+     * Attach 'log' to 'vbuf', replacing any log it already has. A null
+     * 'log' detaches. Returns false if every slot is in use.
+     *
+     * The codec reads this table from an ISR, so an entry's log pointer
+     * is only set once the rest of the entry is valid.
+     */
+
+    if (!log) {
+        detach(vbuf);
+        return true;
+    }
+
+    Entry *slot = 0;
+    for (unsigned i = 0; i != numEntries; ++i) {
+        if (entries[i].vbuf == vbuf) {
+            slot = &entries[i];
+            break;
+        }
+        if (!entries[i].vbuf && !slot)
+            slot = &entries[i];
+    }
+
+    if (!slot) {
+        if (numEntries == MAX_LOGS)
+            return false;
+        slot = &entries[numEntries];
+    }
+
+    slot->log = 0;
+    Atomic::Barrier();
+
+    log->head = 0;
+    log->tail = 0;
+    slot->vbuf = vbuf;
+    Atomic::Barrier();
+
+    slot->log = log;
+    if (slot == &entries[numEntries])
+        numEntries++;
+    return true;
+}
+
+void VRAMChangeLog::detach(_SYSVideoBuffer *vbuf)
+{
+    for (unsigned i = 0; i != numEntries; ++i)
+        if (entries[i].vbuf == vbuf) {
+            entries[i].log = 0;
+            Atomic::Barrier();
+            entries[i].vbuf = 0;
+        }
+
+    while (numEntries && !entries[numEntries - 1].vbuf)
+        numEntries--;
+}
+
+void VRAMChangeLog::detachAll()
+{
+    for (unsigned i = 0; i != numEntries; ++i)
+        entries[i].log = 0;
+    Atomic::Barrier();
+    numEntries = 0;
+    for (unsigned i = 0; i != MAX_LOGS; ++i)
+        entries[i].vbuf = 0;
+}
+
+_SYSVideoChangeLog *VRAMChangeLog::find(const _SYSVideoBuffer *vbuf)
+{
+    for (unsigned i = 0; i != numEntries; ++i)
+        if (entries[i].vbuf == vbuf)
+            return entries[i].log;
+    return 0;
+}
+
+void VRAMChangeLog::appendSlow(_SYSVideoBuffer &vbuf, uint16_t addr)
+{
+    _SYSVideoChangeLog *log = find(&vbuf);
+    if (!log)
+        return;
+
+    /*
+     * If the log is full, count the record without storing it. The
+     * codec sees more records than the log holds, drops them all, and
+     * scans the change maps instead.
+     */
+
+    uint32_t head = log->head;
+    if (head - log->tail < _SYS_VIDEO_CHANGE_LOG_SIZE) {
+        _SYSVideoChange &rec = log->records[head & (_SYS_VIDEO_CHANGE_LOG_SIZE - 1)];
+        rec.addr = addr;
+        rec.word = vbuf.vram.words[addr];
+    }
+    Atomic::Barrier();
+    log->head = head + 1;
+}
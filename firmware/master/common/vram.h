@@ -45,6 +45,51 @@
  * these operations, see the userlevel VideoBuffer class.
  */
 
+/**
+ * Optional per-buffer logs of changed VRAM words.
+ *
+ * Userspace attaches a _SYSVideoChangeLog to a _SYSVideoBuffer. While it's
+ * attached, every VRAM write below that changes a word also appends an
+ * (address, value) record, and CubeCodec visits logged words in order
+ * instead of scanning the change maps for them.
+ *
+ * Records are only hints. The change maps stay authoritative, so a full
+ * log just drops records, and the codec falls back to scanning.
+ */
+
+class VRAMChangeLog {
+public:
+    static bool attach(_SYSVideoBuffer *vbuf, _SYSVideoChangeLog *log);
+    static void detach(_SYSVideoBuffer *vbuf);
+    static void detachAll();
+
+    static _SYSVideoChangeLog *find(const _SYSVideoBuffer *vbuf);
+
+    static ALWAYS_INLINE bool active() {
+        return numEntries != 0;
+    }
+
+    static ALWAYS_INLINE void append(_SYSVideoBuffer &vbuf, uint16_t addr) {
+        // Almost nobody attaches a log. Keep the common case to one test.
+        if (UNLIKELY(active()))
+            appendSlow(vbuf, addr);
+    }
+
+private:
+    struct Entry {
+        _SYSVideoBuffer *vbuf;
+        _SYSVideoChangeLog *log;
+    };
+
+    static const unsigned MAX_LOGS = _SYS_NUM_CUBE_SLOTS;
+
+    static Entry entries[MAX_LOGS];
+    static unsigned numEntries;     /// High-water mark in entries[]
+
+    static void appendSlow(_SYSVideoBuffer &vbuf, uint16_t addr);
+};
+
+
 struct VRAM {
 
     static const uint32_t DEFAULT_LOCK_FLAGS = _SYS_VBF_NEED_PAINT;
@@ -70,6 +115,41 @@ struct VRAM {
         return Intrinsic::LZ(addr >> 4);
     }
 
+    static ALWAYS_INLINE unsigned dirtyRunLength(uint32_t cm1, unsigned idx1) {
+        // Number of consecutive dirty words in 'cm1', starting at bit 'idx1'
+        ASSERT(idx1 < 32);
+        uint32_t clean = ~(cm1 << idx1);
+        return clean ? Intrinsic::CLZ(clean) : 32 - idx1;
+    }
+
+    /**
+     * Find the first run of dirty words (cm1 bits) at or after 'addr'.
+     * On success, moves 'addr' to the start of the run and returns its
+     * length. Returns zero if nothing at or after 'addr' is dirty.
+     *
+     * This works a whole cm1 word at a time, using CLZ to skip clean
+     * words and to measure the run. Runs end at cm1 word boundaries.
+     * Note that this ignores cm16, so it also finds locked words.
+     */
+    static unsigned findDirtyRun(const _SYSVideoBuffer &vbuf, uint16_t &addr)
+    {
+        ASSERT(addr <= _SYS_VRAM_WORDS);
+        unsigned idx32 = addr >> 5;
+        if (idx32 >= arraysize(vbuf.cm1))
+            return 0;
+
+        uint32_t bits = vbuf.cm1[idx32] & (0xFFFFFFFF >> (addr & 31));
+        while (!bits) {
+            if (++idx32 == arraysize(vbuf.cm1))
+                return 0;
+            bits = vbuf.cm1[idx32];
+        }
+
+        unsigned idx1 = Intrinsic::CLZ(bits);
+        addr = (idx32 << 5) | idx1;
+        return dirtyRunLength(bits, idx1);
+    }
+
     static ALWAYS_INLINE void truncateByteAddr(uint16_t &addr) {
         addr &= _SYS_VRAM_BYTE_MASK;
     }
@@ -106,6 +186,87 @@ struct VRAM {
             lock(vbuf, addr, lockFlags);
             vbuf.vram.words[addr] = word;
             Atomic::SetLZ(selectCM1(vbuf, addr), indexCM1(addr));
+            VRAMChangeLog::append(vbuf, addr);
+        }
+    }
+
+    /**
+     * Like poke(), for a run of words that all fall within one cm1 word
+     * (a 32-word aligned group). Locks and change bits are applied once
+     * for the whole run, instead of once per word.
+     */
+    static void pokeGroup(_SYSVideoBuffer &vbuf, uint16_t addr,
+        const uint16_t *words, unsigned count,
+        uint32_t lockFlags = DEFAULT_LOCK_FLAGS)
+    {
+        ASSERT(count > 0 && indexCM1(addr) + count <= 32);
+
+        uint16_t *dest = &vbuf.vram.words[addr];
+        uint32_t changed = 0;
+        for (unsigned i = 0; i != count; ++i)
+            if (dest[i] != words[i])
+                changed |= maskCM1(addr + i);
+        if (!changed)
+            return;
+
+        // Lock both 16-word halves of the group, as needed
+        uint16_t base = addr & ~31;
+        uint32_t lockMask = 0;
+        if (changed & 0xFFFF0000)
+            lockMask |= maskCM16(base);
+        if (changed & 0x0000FFFF)
+            lockMask |= maskCM16(base + 16);
+
+        Atomic::Or(vbuf.flags, lockFlags);
+        vbuf.lock |= lockMask;
+        Atomic::Barrier();
+
+        for (unsigned i = 0; i != count; ++i)
+            dest[i] = words[i];
+        Atomic::Or(selectCM1(vbuf, addr), changed);
+
+        if (UNLIKELY(VRAMChangeLog::active()))
+            for (unsigned i = 0; i != count; ++i)
+                if (changed & maskCM1(addr + i))
+                    VRAMChangeLog::append(vbuf, addr + i);
+    }
+
+    /**
+     * Mark a word dirty without changing it, for when the cube's copy
+     * is known to differ from the buffer.
+     */
+    static void markDirty(_SYSVideoBuffer &vbuf, uint16_t addr,
+        uint32_t lockFlags = DEFAULT_LOCK_FLAGS)
+    {
+        lock(vbuf, addr, lockFlags);
+        Atomic::SetLZ(selectCM1(vbuf, addr), indexCM1(addr));
+    }
+
+    /**
+     * Mark dirty every word in 'vbuf' that differs from 'cube', a buffer
+     * whose contents are on the cube right now. Words still dirty in
+     * 'cube' haven't reached the cube yet, so they're marked too. This
+     * lets one buffer take over from another without resending all of VRAM.
+     */
+    static void markDifferences(_SYSVideoBuffer &vbuf, const _SYSVideoBuffer &cube)
+    {
+        for (unsigned idx32 = 0; idx32 != arraysize(vbuf.cm1); ++idx32) {
+            const uint16_t *a = &vbuf.vram.words[idx32 << 5];
+            const uint16_t *b = &cube.vram.words[idx32 << 5];
+            uint32_t changed = cube.cm1[idx32];
+
+            for (unsigned i = 0; i != 32; ++i)
+                if (a[i] != b[i])
+                    changed |= Intrinsic::LZ(i);
+            if (!changed)
+                continue;
+
+            uint16_t base = idx32 << 5;
+            if (changed & 0xFFFF0000)
+                lock(vbuf, base);
+            if (changed & 0x0000FFFF)
+                lock(vbuf, base + 16);
+            Atomic::Or(vbuf.cm1[idx32], changed);
         }
     }
 
@@ -119,6 +280,7 @@ struct VRAM {
             lock(vbuf, addrw, lockFlags);
             vbuf.vram.bytes[addr] = byte;
             Atomic::SetLZ(selectCM1(vbuf, addrw), indexCM1(addrw));
+            VRAMChangeLog::append(vbuf, addrw);
         }
     }
 
@@ -143,6 +305,7 @@ struct VRAM {
             lock(vbuf, addrw, lockFlags);
             __sync_xor_and_fetch(&vbuf.vram.bytes[addr], byte);
             Atomic::SetLZ(selectCM1(vbuf, addrw), indexCM1(addrw));
+            VRAMChangeLog::append(vbuf, addrw);
         }
     }
 
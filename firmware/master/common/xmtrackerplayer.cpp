@@ -1064,19 +1064,28 @@ void XmTrackerPlayer::processEnvelope(XmTrackerChannel &channel)
             return;
         }
 
-        // Load current and next envelope points from flash.
-        FlashBlockRef ref;
+        /*
+         * Load current and next envelope points from flash. A segment
+         * usually spans many ticks, so only go to flash when we move on
+         * to a new one (or a new instrument).
+         */
         SvmMemory::VirtAddr va = instrument.volumeEnvelopePoints + envelope.point * sizeof(uint16_t);
-        if (!SvmMemory::copyROData(ref, envPt0, va)) {
-            LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)va, (long unsigned)sizeof(envPt0)));
-            ASSERT(false); stop(); return;
-        }
-        if (!SvmMemory::copyROData(ref, envPt1, va + sizeof(uint16_t))) {
-            LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)(va + sizeof(uint16_t)), (long unsigned)sizeof(envPt1)));
-            ASSERT(false); stop(); return;
+        if (va != envelope.segmentVA) {
+            FlashBlockRef ref;
+            if (!SvmMemory::copyROData(ref, envelope.segment[0], va)) {
+                LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
+                     (void *)va, (long unsigned)sizeof(envPt0)));
+                ASSERT(false); stop(); return;
+            }
+            if (!SvmMemory::copyROData(ref, envelope.segment[1], va + sizeof(uint16_t))) {
+                LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
+                     (void *)(va + sizeof(uint16_t)), (long unsigned)sizeof(envPt1)));
+                ASSERT(false); stop(); return;
+            }
+            envelope.segmentVA = va;
         }
+        envPt0 = envelope.segment[0];
+        envPt1 = envelope.segment[1];
 
         pointLength = envelopeOffset(envPt1) - envelopeOffset(envPt0);
     }
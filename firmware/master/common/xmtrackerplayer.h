@@ -37,6 +37,10 @@ struct XmTrackerEnvelopeMemory {
     uint8_t point;
     uint8_t value;
     bool done;
+
+    // Envelope segment currently being interpolated, as last read from flash
+    SvmMemory::VirtAddr segmentVA;
+    uint16_t segment[2];
 };
 
 struct XmTrackerChannel {
@@ -140,6 +144,8 @@ public:
     bool isUsingChannel(unsigned ch) const;
 
 private:
+    friend class AudioBench;    // drives tick() directly
+
     // Frequency and period computation
     static const uint8_t kLinearFrequencies = 0x01;
     static const uint8_t kAmigaFrequencies = 0x00;
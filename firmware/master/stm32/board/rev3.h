@@ -109,6 +109,9 @@
 #define NBR_IN2_GPIO        GPIOPin(&GPIOA, 3)
 #define NBR_TX_TIM          TIM4                    // NOTE! same as BATT_LVL_TIM
 #define NBR_TX_TIM_CH       3                       // CH3=PB8, CH4=PB9
+#define NBR_TX_DMA          DMA1                    // TIM4_UP
+#define NBR_TX_DMA_CHAN     7
+#define NBR_TX_DMA_IRQ      DMA1_Channel7
 
 // U A R T
 #define UART_DBG            USART1                  // Uses alternate configuration
@@ -27,6 +27,24 @@
 #include "hardware.h"
 #include "sysinfo.h"
 
+#ifndef BOOTLOADER
+#include "dma.h"
+
+/*
+ * DMA1 channel 1 has no peripheral in use on any of our boards, so we
+ * borrow it for memory-to-memory transfers into the CRC data register.
+ * Each DMA write takes longer than the CRC engine's 4 AHB cycles, and
+ * low priority keeps it out of the way of the flash and radio channels.
+ */
+static const unsigned CRC_DMA_CHANNEL = 0;
+
+// Below this, setting up the channel costs more than it saves
+static const unsigned CRC_DMA_MIN_WORDS = 32;
+
+// CNDTR is only 16 bits wide
+static const unsigned CRC_DMA_MAX_WORDS = 0xFFFF;
+#endif
+
 
 void Crc32::addUniqueness()
 {
@@ -45,3 +63,52 @@ NEVER_INLINE void Crc32::add(uint32_t word)
     // This function should never be inlined!
     addInline(word);
 }
+
+void Crc32::addWords(const uint32_t *words, uint32_t count)
+{
+#ifndef BOOTLOADER
+    /*
+     * The bootloader doesn't link the DMA driver, and if anyone else has
+     * the channel, we quietly fall back on the CPU loop below.
+     */
+    volatile DMAChannel_t *ch;
+    if (count >= CRC_DMA_MIN_WORDS &&
+        (ch = Dma::initChannel(&DMA1, CRC_DMA_CHANNEL, 0, 0)) != 0) {
+
+        const uint32_t tcif = Dma::Complete << (CRC_DMA_CHANNEL * 4);
+
+        while (count) {
+            unsigned chunk = MIN(count, unsigned(CRC_DMA_MAX_WORDS));
+
+            ch->CPAR = (uint32_t)&CRC.DR;
+            ch->CMAR = (uint32_t)words;
+            ch->CNDTR = chunk;
+            ch->CCR =   (1 << 14) |     // MEM2MEM
+                        (2 << 10) |     // MSIZE = 32 bits
+                        (2 << 8) |      // PSIZE = 32 bits
+                        (1 << 7) |      // MINC
+                        (1 << 4) |      // DIR = memory to peripheral
+                        Dma::LowPrio |
+                        (1 << 0);       // EN
+
+            // No interrupt; we have nothing better to do than wait
+            while (!(DMA1.ISR & tcif));
+            DMA1.IFCR = 1 << (CRC_DMA_CHANNEL * 4);
+            ch->CCR = 0;
+
+            words += chunk;
+            count -= chunk;
+        }
+
+        Dma::deinitChannel(&DMA1, CRC_DMA_CHANNEL);
+        return;
+    }
+#endif
+
+    // Loop overhead covers the engine's minimum delay between words
+    while (count) {
+        addInline(*words);
+        words++;
+        count--;
+    }
+}
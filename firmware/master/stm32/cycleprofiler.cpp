@@ -0,0 +1,47 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "cycleprofiler.h"
+#include <string.h>
+
+CycleProfiler::Counter CycleProfiler::syscalls[NUM_SYSCALLS];
+CycleProfiler::Counter CycleProfiler::tasks[Tasks::NUM_TASKS];
+
+void CycleProfiler::init()
+{
+    reset();
+
+    // Trace enable (TRCENA), then start the cycle counter (CYCCNTENA)
+    NVIC.DEMCR |= 1 << 24;
+    DWT.CYCCNT = 0;
+    DWT.CTRL |= 1 << 0;
+}
+
+void CycleProfiler::reset()
+{
+    memset(syscalls, 0, sizeof syscalls);
+    memset(tasks, 0, sizeof tasks);
+}
@@ -0,0 +1,103 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef CYCLEPROFILER_H_
+#define CYCLEPROFILER_H_
+
+#include "hardware.h"
+#include "macros.h"
+#include "tasks.h"
+
+/*
+ * Exact cycle accounting for syscalls and Tasks handlers, using the
+ * Cortex-M3 DWT cycle counter. SampleProfiler tells us roughly where
+ * time goes; this tells us exactly what each syscall costs.
+ *
+ * Only built with CYCLE_PROFILER=1, since the tables cost RAM and
+ * every syscall pays for two extra counter reads. Counts are inclusive,
+ * so a syscall that blocks in Tasks::work() is also charged for the
+ * tasks that run underneath it.
+ *
+ * The 32-bit counter wraps about once a minute at 72 MHz, which is
+ * fine for individual measurements but means totals are accumulated
+ * in 64 bits.
+ */
+
+class CycleProfiler
+{
+public:
+    static const unsigned NUM_SYSCALLS = 256;
+
+    enum Table {
+        TaskCycles,
+        SyscallCycles,
+        EndOfTables = 0xFF
+    };
+
+    struct Counter {
+        uint32_t calls;
+        uint32_t maxCycles;
+        uint64_t totalCycles;
+    };
+
+    static void init();
+    static void reset();
+
+    static ALWAYS_INLINE uint32_t now() {
+        return DWT.CYCCNT;
+    }
+
+    static ALWAYS_INLINE void endSyscall(unsigned num, uint32_t start) {
+        ASSERT(num < NUM_SYSCALLS);
+        record(syscalls[num], now() - start);
+    }
+
+    static ALWAYS_INLINE void endTask(unsigned id, uint32_t start) {
+        ASSERT(id < Tasks::NUM_TASKS);
+        record(tasks[id], now() - start);
+    }
+
+    static ALWAYS_INLINE const Counter &syscall(unsigned num) {
+        return syscalls[num];
+    }
+
+    static ALWAYS_INLINE const Counter &task(unsigned id) {
+        return tasks[id];
+    }
+
+private:
+    static Counter syscalls[NUM_SYSCALLS];
+    static Counter tasks[Tasks::NUM_TASKS];
+
+    static ALWAYS_INLINE void record(Counter &c, uint32_t cycles) {
+        c.calls++;
+        c.totalCycles += cycles;
+        if (cycles > c.maxCycles)
+            c.maxCycles = cycles;
+    }
+};
+
+#endif // CYCLEPROFILER_H_
@@ -56,15 +56,27 @@ namespace DacAudioOut {
          * DMA half-complete or complete IRQ.
          * Poke the mixer, asynchronously ask it to fill the buffer some more.
          * Update our ring buffer's pointers.
+         *
+         * The mixer only refills at half-buffer granularity, so if the
+         * engine consumed more than was queued, it has already played
+         * samples left over from the last trip around the ring.
          */
 
-        AudioMixer::output.dequeueWithDMACount(dmaChannel->CNDTR);
+        unsigned fill = AudioMixer::output.readAvailable();
+        unsigned consumed = AudioMixer::output.dequeueWithDMACount(dmaChannel->CNDTR);
+        AudioOutDevice::recordFill(fill, consumed > fill && AudioMixer::instance.active());
+
         Tasks::trigger(Tasks::AudioPull);
     }
 }
 
+AudioOutDevice::Stats AudioOutDevice::stats;
+
 void AudioOutDevice::init()
 {
+    resetStats();
+
+
     // Sample rate timer, connected to DAC trigger input.
     DacAudioOut::sampleTimer.init(72000000 / AudioMixer::SAMPLE_HZ, 0);
     DacAudioOut::sampleTimer.configureTriggerOutput();
@@ -120,6 +132,14 @@ void AudioOutDevice::stop()
     Dac::disableChannel(AUDIO_DAC_CHAN);
 }
 
+void AudioOutDevice::resetStats()
+{
+    stats.interrupts = 0;
+    stats.underruns = 0;
+    stats.minFill = 0xFFFF;
+    stats.maxFill = 0;
+}
+
 int AudioOutDevice::getSampleBias()
 {
     // Convert signed to unsigned samples, with 1/2 full-scale bias.
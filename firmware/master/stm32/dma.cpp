@@ -24,6 +24,7 @@
  */
 
 #include "dma.h"
+#include <string.h>
 
 /*
  * Several peripherals can be served by a single DMA channel, so this module
@@ -35,6 +36,7 @@ uint32_t Dma::Ch1Mask = 0;
 uint32_t Dma::Ch2Mask = 0;
 Dma::DmaHandler_t Dma::Ch1Handlers[7];
 Dma::DmaHandler_t Dma::Ch2Handlers[5];
+Dma::ChannelStats Dma::stats[NUM_CHANNELS];
 
 volatile DMAChannel_t * Dma::initChannel(volatile DMA_t *dma, int channel, DmaIsr_t func, void *param)
 {
@@ -44,6 +46,7 @@ volatile DMAChannel_t * Dma::initChannel(volatile DMA_t *dma, int channel, DmaIs
             RCC.AHBENR |= (1 << 0);
             dma->IFCR = 0x0FFFFFFF; // clear all ISRs
         } else if (Ch1Mask & (1 << channel)) {
+            stats[statsIndex(dma, channel)].conflicts++;
             return 0;     // already registered :(
         }
 
@@ -57,6 +60,7 @@ volatile DMAChannel_t * Dma::initChannel(volatile DMA_t *dma, int channel, DmaIs
             RCC.AHBENR |= (1 << 1);
             dma->IFCR = 0x0FFFFFFF; // clear all ISRs
         } else if (Ch2Mask & (1 << channel)) {
+            stats[statsIndex(dma, channel)].conflicts++;
             return 0;     // already registered :(
         }
 
@@ -106,15 +110,43 @@ void Dma::deinitChannel(volatile DMA_t *dma, int channel)
     }
 }
 
+void Dma::resetStats()
+{
+    memset(stats, 0, sizeof stats);
+}
+
 /*
     Common dispatcher for all dma interrupts.
     Shift the flags for the given channel into the lowest 4 bits,
     clear the ISR status, and call back the handler.
+
+    Also counts the event, and checks whether any other channel on this
+    controller is still busy, before the handler gets a chance to start
+    something new.
 */
 void Dma::serveIsr(volatile DMA_t *dma, int ch, DmaHandler_t &handler)
 {
     uint32_t flags = (dma->ISR >> (ch * 4)) & 0xF;  // only bottom 4 bits are relevant to a single channel
     dma->IFCR = 1 << (ch * 4); // set the CGIFx bit to clear the whole channel
+
+    ChannelStats &s = stats[statsIndex(dma, ch)];
+    if (flags & Error)
+        s.errors++;
+    if (flags & HalfComplete)
+        s.halfTransfers++;
+    if (flags & Complete) {
+        s.transfers++;
+
+        int numChannels = dma == &DMA1 ? arraysize(Ch1Handlers) : arraysize(Ch2Handlers);
+        for (int i = 0; i < numChannels; ++i) {
+            volatile DMAChannel_t &other = dma->channels[i];
+            if (i != ch && (other.CCR & 1) && other.CNDTR) {
+                s.contended++;
+                break;
+            }
+        }
+    }
+
     if (handler.isrfunc) {
         handler.isrfunc(handler.param, flags);
     }
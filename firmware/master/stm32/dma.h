@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 #include "hardware.h"
+#include "macros.h"
 
 class Dma
 {
@@ -47,9 +48,37 @@ public:
         Error           = (1 << 3)
     };
 
+    /*
+     * Per-channel counters, readable over USB via the Profiler subsystem.
+     *
+     * A transfer is 'contended' if, when it finished, another channel on
+     * the same controller still had work queued. The two were competing
+     * for the bus, and the arbiter was choosing between them by priority.
+     * 'conflicts' counts initChannel() calls refused because somebody
+     * else already owned the channel.
+     */
+    struct ChannelStats {
+        uint32_t transfers;
+        uint32_t halfTransfers;
+        uint32_t errors;
+        uint32_t contended;
+        uint32_t conflicts;
+    };
+
+    // Indexed by channel on DMA1, then DMA2
+    static const unsigned NUM_DMA1_CHANNELS = 7;
+    static const unsigned NUM_DMA2_CHANNELS = 5;
+    static const unsigned NUM_CHANNELS = NUM_DMA1_CHANNELS + NUM_DMA2_CHANNELS;
+
     static volatile DMAChannel_t * initChannel(volatile DMA_t *dma, int channel, DmaIsr_t func, void *param);
     static void deinitChannel(volatile DMA_t *dma, int channel);
 
+    static ALWAYS_INLINE const ChannelStats &getStats(unsigned index) {
+        return stats[index];
+    }
+
+    static void resetStats();
+
 private:
     struct DmaHandler_t {
         DmaIsr_t isrfunc;
@@ -64,6 +93,12 @@ private:
     static uint32_t Ch2Mask;
     static DmaHandler_t Ch2Handlers[5];
 
+    static ChannelStats stats[NUM_CHANNELS];
+
+    static ALWAYS_INLINE unsigned statsIndex(volatile DMA_t *dma, int channel) {
+        return dma == &DMA1 ? channel : NUM_DMA1_CHANNELS + channel;
+    }
+
     friend void ISR_DMA1_Channel1();
     friend void ISR_DMA1_Channel2();
     friend void ISR_DMA1_Channel3();
@@ -48,6 +48,18 @@ void FlashDevice::read(uint32_t address, uint8_t *buf, unsigned len) {
         flash.read(address, buf, len);
 }
 
+bool FlashDevice::readAsync(uint32_t address, uint8_t *buf, unsigned len) {
+    return len && flash.readAsync(address, buf, len);
+}
+
+bool FlashDevice::asyncDone() {
+    return flash.asyncDone();
+}
+
+bool FlashDevice::finishAsync() {
+    return flash.finishAsync();
+}
+
 void FlashDevice::write(uint32_t address, const uint8_t *buf, unsigned len) {
     if (len)
         flash.write(address, buf, len);
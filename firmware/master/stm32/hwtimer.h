@@ -141,6 +141,21 @@ public:
     void ALWAYS_INLINE disableUpdateIsr() const {
         tim->DIER &= ~(1 << 0);
     }
+    void ALWAYS_INLINE enableUpdateDma() const {
+        tim->DIER |= (1 << 8);
+    }
+    void ALWAYS_INLINE disableUpdateDma() const {
+        tim->DIER &= ~(1 << 8);
+    }
+
+    /*
+     * Each DMA write to DMAR goes to the next of 'count' compare registers,
+     * starting at channel 'ch' (numbered 1-4). DBA counts 32-bit registers
+     * from the start of the timer, and CCR1 is the 13th.
+     */
+    void ALWAYS_INLINE configureDmaBurst(int ch, unsigned count) const {
+        tim->DCR = ((count - 1) << 8) | (13 + ch - 1);
+    }
 
     uint16_t ALWAYS_INLINE lastCapture(int ch) const {
         return tim->compareCapRegs[ch - 1].CCR;
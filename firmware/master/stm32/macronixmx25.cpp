@@ -33,6 +33,13 @@
 
 volatile bool MacronixMX25::dmaInProgress = false;
 
+MacronixMX25 *MacronixMX25::asyncOwner;
+volatile uint8_t MacronixMX25::asyncPhase = AsyncIdle;
+bool MacronixMX25::asyncSuccess;
+uint8_t MacronixMX25::asyncCmd[5];
+uint8_t *MacronixMX25::asyncBuf;
+unsigned MacronixMX25::asyncLen;
+
 /*
  * Flash DMA is the highest priority channel on DMA1.
  * SPI1 is on APB2, clocked @ 72MHz. We'd like to run at 18MHz, so divide by 4.
@@ -86,6 +93,7 @@ void MacronixMX25::read(uint32_t address, uint8_t *buf, unsigned len)
                             uint8_t(address >> 0),
                             Nop };  // dummy
 
+    finishAsync();
     waitWhileBusy();
 
     // May need to retry in case of DMA failure
@@ -100,16 +108,80 @@ void MacronixMX25::read(uint32_t address, uint8_t *buf, unsigned len)
             continue;
         }
 
-        dmaInProgress = true;
-        spi.transferDma(buf, buf, len);
-        if (!waitForDma()) {
-            spiEnd();
-            continue;
+        /*
+         * The data phase streams on for as long as we keep clocking, so a
+         * long burst only needs the one command. DMA counts are 16-bit.
+         */
+
+        uint8_t *dataBuf = buf;
+        unsigned remaining = len;
+        bool success = true;
+
+        while (remaining && success) {
+            unsigned chunk = MIN(remaining, unsigned(MAX_DMA_LEN));
+
+            dmaInProgress = true;
+            spi.transferDma(dataBuf, dataBuf, chunk);
+            success = waitForDma();
+
+            dataBuf += chunk;
+            remaining -= chunk;
         }
 
         spiEnd();
-        return;
+        if (success)
+            return;
+    }
+}
+
+/*
+ * Begin reading in the background. The command and data phases are chained
+ * from the DMA completion IRQ, so the CPU can keep working until it needs
+ * the data. Only one background read may be in flight; any other flash
+ * operation will wait for it first.
+ *
+ * Returns false without starting anything if the device is busy.
+ */
+bool MacronixMX25::readAsync(uint32_t address, uint8_t *buf, unsigned len)
+{
+    finishAsync();
+    if (busy())
+        return false;
+
+    asyncCmd[0] = FastRead;
+    asyncCmd[1] = address >> 16;
+    asyncCmd[2] = address >> 8;
+    asyncCmd[3] = address >> 0;
+    asyncCmd[4] = Nop;  // dummy
+
+    asyncOwner = this;
+    asyncBuf = buf;
+    asyncLen = len;
+    asyncSuccess = false;
+
+    spiBegin();
+    asyncPhase = AsyncCommand;
+    dmaInProgress = true;
+    spi.txDma(asyncCmd, sizeof asyncCmd);
+
+    return true;
+}
+
+/*
+ * Wait for any background read to finish. Returns true if the most recent
+ * background read completed successfully. If the DMA was lost (see
+ * waitForDma) the buffer contents are undefined, and the caller should
+ * fall back on a synchronous read().
+ */
+bool MacronixMX25::finishAsync()
+{
+    if (asyncPhase != AsyncIdle && !waitForDma()) {
+        spiEnd();
+        asyncPhase = AsyncIdle;
+        dmaInProgress = false;
     }
+
+    return asyncSuccess;
 }
 
 /*
@@ -117,6 +189,8 @@ void MacronixMX25::read(uint32_t address, uint8_t *buf, unsigned len)
 */
 void MacronixMX25::write(uint32_t address, const uint8_t *buf, unsigned len)
 {
+    finishAsync();
+
     while (len) {
         // align writes to PAGE_SIZE chunks
         uint32_t pagelen = FlashDevice::PAGE_SIZE - (address & (FlashDevice::PAGE_SIZE - 1));
@@ -165,6 +239,7 @@ void MacronixMX25::write(uint32_t address, const uint8_t *buf, unsigned len)
  */
 void MacronixMX25::eraseBlock(uint32_t address)
 {
+    finishAsync();
     waitWhileBusy();
     ensureWriteEnabled();
 
@@ -180,6 +255,7 @@ void MacronixMX25::eraseBlock(uint32_t address)
 
 void MacronixMX25::chipErase()
 {
+    finishAsync();
     waitWhileBusy();
     ensureWriteEnabled();
 
@@ -201,6 +277,7 @@ void MacronixMX25::ensureWriteEnabled()
 
 void MacronixMX25::readId(FlashDevice::JedecID *id)
 {
+    finishAsync();
     waitWhileBusy();
     spiBegin();
 
@@ -229,6 +306,7 @@ uint8_t MacronixMX25::readReg(MacronixMX25::Command cmd)
 
 void MacronixMX25::deepSleep()
 {
+    finishAsync();
     spiBegin();
     spi.transfer(DeepPowerDown);
     spiEnd();
@@ -374,5 +452,20 @@ bool MacronixMX25::waitForDma()
 
 void MacronixMX25::dmaCompletionCallback()
 {
+    switch (asyncPhase) {
+
+    case AsyncCommand:
+        // Command is out, start clocking in the data. Still in progress.
+        asyncPhase = AsyncData;
+        asyncOwner->spi.transferDma(asyncBuf, asyncBuf, asyncLen);
+        return;
+
+    case AsyncData:
+        asyncOwner->spiEnd();
+        asyncSuccess = true;
+        asyncPhase = AsyncIdle;
+        break;
+    }
+
     dmaInProgress = false;
 }
@@ -50,6 +50,12 @@ public:
     void init();
 
     void read(uint32_t address, uint8_t *buf, unsigned len);
+    bool readAsync(uint32_t address, uint8_t *buf, unsigned len);
+    bool finishAsync();
+
+    bool asyncDone() const {
+        return asyncPhase == AsyncIdle;
+    }
     void write(uint32_t address, const uint8_t *buf, unsigned len);
     void eraseBlock(uint32_t address);
     void chipErase();
@@ -112,10 +118,27 @@ private:
         ReleaseReadEnhanced         = 0xFF
     };
 
+    enum AsyncPhase {
+        AsyncIdle,
+        AsyncCommand,
+        AsyncData
+    };
+
+    // Largest single DMA transfer; CNDTR is a 16-bit register
+    static const unsigned MAX_DMA_LEN = 0xFFFF;
+
     GPIOPin csn;
     SPIMaster spi;
     bool mightBeBusy;
 
+    // Background read state, advanced by dmaCompletionCallback()
+    static MacronixMX25 *asyncOwner;
+    static volatile uint8_t asyncPhase;
+    static bool asyncSuccess;
+    static uint8_t asyncCmd[5];
+    static uint8_t *asyncBuf;
+    static unsigned asyncLen;
+
     ALWAYS_INLINE void spiBegin() {
         csn.setLow();
     }
@@ -34,6 +34,7 @@
 #include "tasks.h"
 #include "audiomixer.h"
 #include "audiooutdevice.h"
+#include "audiobench.h"
 #include "volume.h"
 #include "usb/usbdevice.h"
 #include "homebutton.h"
@@ -41,6 +42,7 @@
 #include "powermanager.h"
 #include "crc.h"
 #include "sampleprofiler.h"
+#include "cycleprofiler.h"
 #include "bootloader.h"
 #include "cubeconnector.h"
 #include "neighbor_tx.h"
@@ -50,6 +52,19 @@
 #include "adc.h"
 #include "realtimeclock.h"
 
+#ifdef AUDIO_BENCHMARK
+static void reportAudioBench(const AudioBench::Result &r)
+{
+    // Per block: nanoseconds, and cycles at our 72 MHz system clock
+    UART((r.name));
+    UART((" ns "));
+    UART_HEX(r.nsPerBlock());
+    UART((" cycles "));
+    UART_HEX(uint32_t(uint64_t(r.nsPerBlock()) * 72 / 1000));
+    UART(("\r\n"));
+}
+#endif
+
 /*
  * Application specific entry point.
  * All low level init is done in setup.cpp.
@@ -112,6 +127,10 @@ int main()
 
     NVIC.irqEnable(IVT.NBR_TX_TIM);                 // Neighbor transmit
     NVIC.irqPrioritize(IVT.NBR_TX_TIM, 0x60);       //  just below volume timer
+#ifdef NBR_TX_DMA_IRQ
+    NVIC.irqEnable(IVT.NBR_TX_DMA_IRQ);             // Neighbor transmit, end of frame
+    NVIC.irqPrioritize(IVT.NBR_TX_DMA_IRQ, 0x60);   //  same as its timer
+#endif
 
 #ifdef HAVE_NRF8001
 
@@ -241,6 +260,14 @@ int main()
     PowerManager::beginVbusMonitor();
     SampleProfiler::init();
 
+#ifdef CYCLE_PROFILER
+    CycleProfiler::init();
+#endif
+
+#ifdef AUDIO_BENCHMARK
+    AudioBench::run(reportAudioBench);
+#endif
+
 #ifdef HAVE_NRF8001
     // Initialize Bluetooth LE radio. Includes a short power-on delay. (Shorter than Radio::init)
     NRF8001::instance.init();
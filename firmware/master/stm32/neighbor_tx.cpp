@@ -31,6 +31,11 @@
 #include "hwtimer.h"
 #include "vectors.h"
 #include "batterylevel.h"
+#include "sampleprofiler.h"
+
+#ifdef NBR_TX_DMA
+#include "dma.h"
+#endif
 
 namespace {
 
@@ -60,6 +65,103 @@ namespace {
         Transmitting
     } txState;
 
+    static void beginWait()
+    {
+        /*
+         * Between transmissions, we give battery measurement an
+         * opportunity to take a sample.
+         */
+
+        HwTimer txPeriodTimer(&NBR_TX_TIM);
+        setDuty(0);
+        txPeriodTimer.setPeriod(Neighbor::BIT_PERIOD_TICKS, Neighbor::NUM_TX_WAIT_PERIODS);
+        txState = BetweenTransmissions;
+
+        // if we're measuring battery via RC, we must share our timer.
+        // otherwise, don't bother.
+        #if defined(USE_RC_BATT_MEAS) && (BOARD != BOARD_TEST_JIG)
+        BatteryLevel::beginCapture();
+        #endif
+    }
+
+#ifdef NBR_TX_DMA
+
+    /*
+     * When the timer's update event has a DMA channel to itself, we queue a
+     * whole frame up front instead of taking an interrupt for every bit.
+     * Each update event bursts one duty value per pin into the compare
+     * registers, so a frame costs one DMA-complete interrupt, plus one
+     * update interrupt at the end of the wait that follows it.
+     *
+     * The duty values take effect at the update event after they're
+     * written, exactly like setDuty() from the per-bit ISR did.
+     */
+
+    static const unsigned NUM_PINS = arraysize(pins);
+    static const unsigned MAX_FRAME_BITS = 16;
+
+    static uint16_t txPulses[(MAX_FRAME_BITS + 1) * NUM_PINS];
+    static volatile DMAChannel_t *txDmaChannel;
+
+    static void loadFrame()
+    {
+        /*
+         * Same bits as the shift loop sends: big endian, stopping after
+         * the last 1, followed by a zero to end the final pulse.
+         */
+
+        unsigned data = txData;
+        unsigned i = 0;
+
+        while (data) {
+            uint16_t duty = (data & 0x8000) ? Neighbor::PULSE_LEN_TICKS : 0;
+            data = (data << 1) & 0xFFFF;
+            for (unsigned p = 0; p < NUM_PINS; ++p)
+                txPulses[i++] = duty;
+        }
+
+        for (unsigned p = 0; p < NUM_PINS; ++p)
+            txPulses[i++] = 0;
+
+        txDmaChannel->CCR &= ~1;
+        txDmaChannel->CNDTR = i;
+        txDmaChannel->CCR |= 1;
+
+        HwTimer txPeriodTimer(&NBR_TX_TIM);
+        txPeriodTimer.enableUpdateDma();
+    }
+
+    static void stopFrame()
+    {
+        HwTimer txPeriodTimer(&NBR_TX_TIM);
+        txPeriodTimer.disableUpdateDma();
+        txDmaChannel->CCR &= ~1;
+    }
+
+    static void dmaCallback(void *p, uint8_t flags)
+    {
+        /*
+         * The trailing zero has just been written, at the update event
+         * where the per-bit ISR would have found txData empty.
+         */
+
+        SampleProfiler::SubSystem s = SampleProfiler::subsystem();
+        SampleProfiler::setSubsystem(SampleProfiler::NeighborISR);
+
+        stopFrame();
+
+        if (txState == Transmitting) {
+            beginWait();
+
+            HwTimer txPeriodTimer(&NBR_TX_TIM);
+            txPeriodTimer.enableUpdateIsr();
+        }
+
+        SampleProfiler::setSubsystem(s);
+    }
+
+#endif // NBR_TX_DMA
+
 }
 
 void NeighborTX::init()
@@ -73,6 +175,20 @@ void NeighborTX::init()
         pins[i].setControl(GPIOPin::IN_PULL);
         txPeriodTimer.enableChannel(channel);
     }
+
+#ifdef NBR_TX_DMA
+    txPeriodTimer.configureDmaBurst(NBR_TX_TIM_CH, NUM_PINS);
+
+    txDmaChannel = Dma::initChannel(&NBR_TX_DMA, NBR_TX_DMA_CHAN - 1, dmaCallback, 0);
+    txDmaChannel->CPAR = (uint32_t) &NBR_TX_TIM.DMAR;
+    txDmaChannel->CMAR = (uint32_t) txPulses;
+    txDmaChannel->CCR = Dma::MediumPrio |
+                        (1 << 10) | // MSIZE - 16-bit memory data word size
+                        (1 << 8) |  // PSIZE - 16-bit peripheral register size
+                        (1 << 7) |  // MINC - memory pointer increment
+                        (1 << 4) |  // DIR - direction, 1 == memory -> peripheral
+                        (1 << 1);   // TCIE - transfer complete ISR enable
+#endif
 }
 
 void NeighborTX::start(unsigned data, unsigned sideMask)
@@ -106,10 +222,13 @@ void NeighborTX::start(unsigned data, unsigned sideMask)
         txData = txDataBuffer;
         txState = Transmitting;
 
+        // transmission will begin at the next update event
+    #ifdef NBR_TX_DMA
+        loadFrame();
+    #else
         HwTimer txPeriodTimer(&NBR_TX_TIM);
         txPeriodTimer.enableUpdateIsr();
-
-        // transmission will begin at the next txPeriodISR
+    #endif
     }
 }
 
@@ -118,6 +237,10 @@ void NeighborTX::stop()
     HwTimer txPeriodTimer(&NBR_TX_TIM);
     txPeriodTimer.disableUpdateIsr();
 
+#ifdef NBR_TX_DMA
+    stopFrame();
+#endif
+
     setDuty(0);
 
     for (unsigned i = 0; i < arraysize(pins); ++i)
@@ -148,8 +271,14 @@ IRQ_HANDLER ISR_FN(NBR_TX_TIM)()
      *
      * We might be in the middle of transmitting some data, or we might be in our
      * waiting period between transmissions. Move along accordingly.
+    
+     * With NBR_TX_DMA, bits are sent by DMA instead, and this only runs at the
+     * end of the wait between transmissions.
      */
 
+    SampleProfiler::SubSystem s = SampleProfiler::subsystem();
+    SampleProfiler::setSubsystem(SampleProfiler::NeighborISR);
+
     HwTimer txPeriodTimer(&NBR_TX_TIM);
     uint16_t status = txPeriodTimer.status();
     txPeriodTimer.clearStatus();
@@ -162,21 +291,7 @@ IRQ_HANDLER ISR_FN(NBR_TX_TIM)()
         case Transmitting:
             // was the previous bit our last one?
             if (txData == 0) {
-                /*
-                 * Between transmissions, we give battery measurement an
-                 * opportunity to take a sample.
-                 */
-
-                setDuty(0);
-                txPeriodTimer.setPeriod(Neighbor::BIT_PERIOD_TICKS, Neighbor::NUM_TX_WAIT_PERIODS);
-                txState = BetweenTransmissions;
-
-                // if we're measuring battery via RC, we must share our timer.
-                // otherwise, don't bother.
-                #if defined(USE_RC_BATT_MEAS) && (BOARD != BOARD_TEST_JIG)
-                BatteryLevel::beginCapture();
-                #endif
-
+                beginWait();
             } else {
                 // send data out big endian
                 setDuty((txData & 0x8000) ? Neighbor::PULSE_LEN_TICKS : 0);
@@ -191,6 +306,12 @@ IRQ_HANDLER ISR_FN(NBR_TX_TIM)()
             txData = txDataBuffer;
             txState = Transmitting;
             txPeriodTimer.setPeriod(Neighbor::BIT_PERIOD_TICKS, 0);
+
+        #ifdef NBR_TX_DMA
+            // The frame's own DMA takes it from here
+            txPeriodTimer.disableUpdateIsr();
+            loadFrame();
+        #endif
             break;
 
         case Idle:
@@ -204,6 +325,8 @@ IRQ_HANDLER ISR_FN(NBR_TX_TIM)()
         BatteryLevel::captureIsr();
     }
     #endif
+
+    SampleProfiler::setSubsystem(s);
 }
 
 void NeighborTX::floatSide(unsigned side)
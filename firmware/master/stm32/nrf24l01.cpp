@@ -73,6 +73,13 @@ void NRF24L01::init()
 
     transmitPower = PacketTransmission::dBm0;
 
+    channelCmd[0] = CMD_W_REGISTER | REG_RF_CH;
+    channelCmd[1] = UNKNOWN_CHANNEL;
+    txAddressCmd[0] = CMD_W_REGISTER | REG_TX_ADDR;
+    rxAddressCmd[0] = CMD_W_REGISTER | REG_RX_ADDR_P0;
+    setupRetrCmd[0] = CMD_W_REGISTER | REG_SETUP_RETR;
+    rfSetupCmd[0] = CMD_W_REGISTER | REG_RF_SETUP;
+
     const uint8_t radio_setup[]  = {
         /* Enable nRF24L01 features */
         2, CMD_W_REGISTER | REG_FEATURE,        0x07,
@@ -199,6 +206,7 @@ void NRF24L01::setConstantCarrier(bool enabled, unsigned channel)
         spi.transfer(CMD_W_REGISTER | REG_RF_CH);
         spi.transfer(channel);
         spiEnd();
+        channelCmd[1] = UNKNOWN_CHANNEL;
 
         ce.setHigh();
     } else {
@@ -218,6 +226,8 @@ void NRF24L01::setChannel(uint8_t ch)
     spi.transfer(CMD_W_REGISTER | REG_RF_CH);
     spi.transfer(ch);
     spiEnd();
+
+    channelCmd[1] = UNKNOWN_CHANNEL;
 }
 
 uint8_t NRF24L01::channel()
@@ -238,9 +248,6 @@ void NRF24L01::isr()
     // Acknowledge to the IRQ controller
     irq.irqAcknowledge();
 
-    // Let the radio watchdog know we're okay
-    irqCount++;
-
     /*
      * Read the NRF STATUS register, then write to clear. This tells
      * us which IRQ(s) occurred, and acknowledges them to the nRF
@@ -251,11 +258,16 @@ void NRF24L01::isr()
     spi.transfer(status);
     spiEnd();
 
+    // Let the radio watchdog know we're okay. Our own wakeups don't count.
+    if (status || !prepareRequested)
+        irqCount++;
+
     switch (status) {
 
     case 0:
         // Shouldn't happen, but.. electrical noise maybe?
-        UART("Spurious nRF IRQ!\r\n");
+        if (!prepareRequested)
+            UART("Spurious nRF IRQ!\r\n");
         break;
 
     case MAX_RT:
@@ -282,9 +294,29 @@ void NRF24L01::isr()
         break;
     }
 
+    if (prepareRequested) {
+        prepareRequested = false;
+        prepareNext();
+    }
+
     SampleProfiler::setSubsystem(s);
 }
 
+void NRF24L01::prepareNext()
+{
+    /*
+     * Encode the next packet while the current one is in the air, so it's
+     * ready to go as soon as the ACK comes back. If RadioManager can't do
+     * that yet, beginTransmitting() will produce() as usual.
+     */
+
+    if (nextPrepared || !RadioManager::isRadioEnabled())
+        return;
+
+    nextBuffer.init();
+    nextPrepared = prepare(nextBuffer);
+}
+
 void NRF24L01::handleTimeout()
 {
     /*
@@ -350,8 +382,17 @@ void NRF24L01::beginTransmitting()
         return;
     }
 
-    txBuffer.init();
-    produce(txBuffer);
+    if (nextPrepared && !rfTestModeEnabled) {
+        // Already encoded while the last packet was in the air
+        PacketTransmission prepared = nextBuffer;
+        nextBuffer = txBuffer;
+        txBuffer = prepared;
+        nextPrepared = false;
+        RadioManager::commitPrepared();
+    } else {
+        txBuffer.init();
+        produce(txBuffer);
+    }
 
     softRetriesLeft = txBuffer.numSoftwareRetries;
 
@@ -360,15 +401,57 @@ void NRF24L01::beginTransmitting()
 #endif
 
     /*
-     * Fire off our transmit process. Subsequent steps are performed in the
-     * SPI completion event.
+     * Queue up the whole transmit as one SPI chain: any settings that
+     * changed since the last packet, the payload, then the CE pulse that
+     * starts transmitting. We hear back once, when the pulse is over.
      */
 
-    txnState = TXChannel;
-    spiBegin();
-    txAddressBuffer[0] = CMD_W_REGISTER | REG_RF_CH;
-    txAddressBuffer[1] = txBuffer.dest->channel;
-    spi.txDma(txAddressBuffer, 2);
+    const RadioAddress *dest = txBuffer.dest;
+    SPIMaster::Segment *seg = txChain;
+    bool addressKnown = channelCmd[1] != UNKNOWN_CHANNEL;
+
+    if (channelCmd[1] != dest->channel) {
+        channelCmd[1] = dest->channel;
+        SPIMaster::Segment s = { channelCmd, 0, sizeof channelCmd, SPIMaster::sSelect };
+        *(seg++) = s;
+    }
+
+    if (!addressKnown || memcmp(txAddressCmd + 1, dest->id, sizeof dest->id)) {
+        memcpy(txAddressCmd + 1, dest->id, sizeof dest->id);
+        memcpy(rxAddressCmd + 1, dest->id, sizeof dest->id);
+        SPIMaster::Segment tx = { txAddressCmd, 0, sizeof txAddressCmd, SPIMaster::sSelect };
+        SPIMaster::Segment rx = { rxAddressCmd, 0, sizeof rxAddressCmd, SPIMaster::sSelect };
+        *(seg++) = tx;
+        *(seg++) = rx;
+    }
+
+    if (txBuffer.numHardwareRetries != hardRetries) {
+        hardRetries = txBuffer.numHardwareRetries;
+        setupRetrCmd[1] = AUTO_RETRY_DELAY | hardRetries;
+        SPIMaster::Segment s = { setupRetrCmd, 0, sizeof setupRetrCmd, SPIMaster::sSelect };
+        *(seg++) = s;
+    }
+
+    if (txBuffer.txPower != transmitPower) {
+        transmitPower = txBuffer.txPower;
+        // enforce 2Mbit/sec transfer rate
+        rfSetupCmd[1] = 0x08 | (transmitPower & 0x6);
+        SPIMaster::Segment s = { rfSetupCmd, 0, sizeof rfSetupCmd, SPIMaster::sSelect };
+        *(seg++) = s;
+    }
+
+    // Either buffer has room for the command byte just before the payload
+    uint8_t *payloadCmd = txBuffer.packet.bytes - 1;
+    *payloadCmd = txBuffer.noAck ? CMD_W_TX_PAYLOAD_NO_ACK : CMD_W_TX_PAYLOAD;
+    SPIMaster::Segment payload = { payloadCmd, 0, uint8_t(txBuffer.packet.len + 1), SPIMaster::sSelect };
+    *(seg++) = payload;
+
+    // See pulseCE() for the timing. No chip select, only CE.
+    SPIMaster::Segment pulse = { txData, 0, CE_PULSE_BYTES, SPIMaster::sStrobe };
+    *(seg++) = pulse;
+
+    txnState = TXPacket;
+    spi.chainDma(txChain, seg - txChain, &csn, &ce);
 }
 
 void NRF24L01::pulseCE()
@@ -385,12 +468,12 @@ void NRF24L01::pulseCE()
      *
      * We're clocking the nRF SPI @ 9MHz, making a single clock cycle ~11ns.
      * So we need to send at least (10us / 11ns) / 8 (bits/byte) = 12 bytes.
-     * Bump up to 15 for a little margin.
+     * Bump up to 15 (CE_PULSE_BYTES) for a little margin.
      */
 
     txnState = TXPulseCE;
     ce.setHigh();
-    spi.txDma(txData, 15);
+    spi.txDma(txData, CE_PULSE_BYTES);
 }
 
 void NRF24L01::staticSpiCompletionHandler()
@@ -422,8 +505,9 @@ void NRF24L01::onSpiComplete()
 {
     /*
      * An SPI transmission has completed.
-     * NRF transmit and receive operations consist of multiple SPI transmissions,
-     * so step to the next state and execute accordingly.
+     * NRF receive operations consist of multiple SPI transmissions, so step
+     * to the next state and execute accordingly. Transmits are queued as a
+     * single SPI chain, so we only get here once they're completely done.
      *
      * NOTE: the RX states are only executed in the event that data arrived on one
      * of the ACK packets that we've received. Otherwise, we start in directly on
@@ -469,63 +553,20 @@ void NRF24L01::onSpiComplete()
         beginTransmitting();
         break;
 
-    case TXChannel:
-        txnState = TXAddressTx;
-        spiBegin();
-        txAddressBuffer[0] = CMD_W_REGISTER | REG_TX_ADDR;
-        memcpy(txAddressBuffer + 1, txBuffer.dest->id, sizeof txBuffer.dest->id);
-        spi.txDma(txAddressBuffer, sizeof(txBuffer.dest->id) + 1);
-        break;
-
-    case TXAddressTx:
-        txnState = TXAddressRx;
-        spiBegin();
-        txAddressBuffer[0] = CMD_W_REGISTER | REG_RX_ADDR_P0;
-        memcpy(txAddressBuffer + 1, txBuffer.dest->id, sizeof txBuffer.dest->id);
-        spi.txDma(txAddressBuffer, sizeof(txBuffer.dest->id) + 1);
-        break;
-
-    case TXAddressRx:
-        // Set retry count if necessary, otherwise FALL THROUGH to RF_SETUP.
-        if (txBuffer.numHardwareRetries != hardRetries) {
-            txnState = TXRfSetup;
-            spiBegin();
-            txAddressBuffer[0] = CMD_W_REGISTER | REG_SETUP_RETR;
-            txAddressBuffer[1] = AUTO_RETRY_DELAY | txBuffer.numHardwareRetries;
-            spi.txDma(txAddressBuffer, 2);
-            break;
-        }
-
-    case TXRfSetup:
-         // Set transmit power if necessary, otherwise FALL THROUGH to payload.
-         if (txBuffer.txPower != transmitPower) {
-             txnState = TXSetupRetr;
-             spiBegin();
-             txAddressBuffer[0] = CMD_W_REGISTER | REG_RF_SETUP;
-             // enforce 2Mbit/sec transfer rate
-             txAddressBuffer[1] = 0x08 | (txBuffer.txPower & 0x6);
-             spi.txDma(txAddressBuffer, 2);
-             break;
-         }
-
-    case TXSetupRetr:
-        hardRetries = txBuffer.numHardwareRetries;
-        transmitPower = txBuffer.txPower;
-        txnState = TXPayload;
-        spiBegin();
-        txData[0] = txBuffer.noAck ? CMD_W_TX_PAYLOAD_NO_ACK : CMD_W_TX_PAYLOAD;
-        spi.txDma(txData, txBuffer.packet.len + 1);
-        break;
-
-    case TXPayload:
-        pulseCE();
-        break;
+    case TXPacket:
+        // The transmit chain ends with a CE pulse. FALL THROUGH.
 
     case TXPulseCE:
         if (softRetriesLeft == 0) {
             txnState = Idle;
         }
         ce.setLow();
+
+        // The packet is in the air. Prepare the next one, at radio priority.
+        if (!nextPrepared && !prepareRequested) {
+            prepareRequested = true;
+            irq.softwareInterrupt();
+        }
         break;
 
     case Idle:
@@ -42,7 +42,9 @@ public:
              GPIOPin _csn,
              SPIMaster _spi)
         : irq(_irq), ce(_ce), csn(_csn), spi(_spi),
-          txBuffer(NULL, txData + 1), rxBuffer(rxData + 1), txnState(Idle),
+          txBuffer(NULL, txData + 1), nextBuffer(NULL, nextData + 1),
+          rxBuffer(rxData + 1), txnState(Idle),
+          nextPrepared(false), prepareRequested(false),
           softRetriesLeft(0),
           hardRetries(PacketTransmission::DEFAULT_HARDWARE_RETRIES)
           {}
@@ -51,6 +53,7 @@ public:
 
     static const unsigned MAX_HW_RETRIES = 15;
     static const uint8_t AUTO_RETRY_DELAY = 0x10;   // 500 us
+    static const uint8_t CE_PULSE_BYTES = 15;       // SPI bytes, >= 10 us
 
     void init();
     void beginTransmitting();
@@ -74,12 +77,7 @@ public:
         Idle,
         RXStatus,
         RXPayload,
-        TXChannel,
-        TXAddressTx,
-        TXAddressRx,
-        TXRfSetup,
-        TXSetupRetr,
-        TXPayload,
+        TXPacket,
         TXPulseCE
     };
 
@@ -142,12 +140,22 @@ public:
     SPIMaster spi;
 
     PacketTransmission txBuffer;
+    PacketTransmission nextBuffer;
     PacketBuffer rxBuffer;
 
     // volatile primarily so that factorytest can poll on this, while it
     // may only get updated from ISR context
     volatile TransactionState txnState;
 
+    /*
+     * Double buffering: while txBuffer is in the air, we ask RadioManager
+     * to prepare the packet after it in nextBuffer. The work happens in
+     * our own IRQ handler, triggered in software, so it runs at radio
+     * priority rather than in the SPI DMA ISR.
+     */
+    volatile bool nextPrepared;
+    volatile bool prepareRequested;
+
     /*
      * Current retry counts.
      */
@@ -161,21 +169,33 @@ public:
      * precede the payload data.
      */
     uint8_t txData[PacketBuffer::MAX_LEN + 1];
+    uint8_t nextData[PacketBuffer::MAX_LEN + 1];
     uint8_t rxData[PacketBuffer::MAX_LEN + 1];
 
     /*
-     * NOTE: This exists because the RadioAddress struct does not provide room
-     * for the extra byte we need to efficiently transmit these details via DMA.
+     * Register writes for the transmit chain. Each one needs its own
+     * buffer, since they're all queued up for DMA at once, and each needs
+     * room for the command byte that RadioAddress doesn't have.
      *
-     * It's cheaper RAM-wise to maintain this single buffer than to extend
-     * RadioAddress, which is stored in each Cube object, at the cost of a bit
-     * of CPU to copy the data.
+     * These double as a cache of the radio's channel and address, so we
+     * only write them when the destination actually changes.
+     */
+    static const uint8_t UNKNOWN_CHANNEL = 0xFF;
+    uint8_t channelCmd[2];
+    uint8_t txAddressCmd[sizeof(RadioAddress::id) + 1];
+    uint8_t rxAddressCmd[sizeof(RadioAddress::id) + 1];
+    uint8_t setupRetrCmd[2];
+    uint8_t rfSetupCmd[2];
+
+    /*
+     * Up to five register writes, the payload, and the CE pulse.
      */
-    uint8_t txAddressBuffer[sizeof(RadioAddress::id) + 1];
+    SPIMaster::Segment txChain[7];
 
     void handleTimeout();
     void beginReceive();
     void pulseCE();
+    void prepareNext();
 
     /*
      * Helpers to forward RF events to the appropriate destination.
@@ -216,6 +236,15 @@ public:
 #endif
     }
 
+    static bool ALWAYS_INLINE prepare(PacketTransmission &tx) {
+        // Only RadioManager supports speculative produce()
+#ifdef RFTEST_GOLD_MASTER
+        return false;
+#else
+        return !rfTestModeEnabled && RadioManager::prepare(tx);
+#endif
+    }
+
     static void ALWAYS_INLINE produce(PacketTransmission &tx) {
 #ifdef RFTEST_GOLD_MASTER
             FactoryTest::produce(tx);
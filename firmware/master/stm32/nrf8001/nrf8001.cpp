@@ -335,14 +335,29 @@ void NRF8001::produceCommand()
     }
 
     // If we can transmit, see if BTProtocol wants to.
-    if (dataCredits && (openPipes & (1 << PIPE_SIFTEO_BASE_DATA_IN_TX))) {
-        unsigned len = BTProtocolCallbacks::onProduceData(&txBuffer.param[1]);
-        if (len) {
-            txBuffer.length = len + 2;
-            txBuffer.command = Op::SendData;
-            txBuffer.param[0] = PIPE_SIFTEO_BASE_DATA_IN_TX;
-            dataCredits--;
-            return;
+    if (openPipes & (1 << PIPE_SIFTEO_BASE_DATA_IN_TX)) {
+        if (!dataCredits) {
+            if (BTProtocolCallbacks::isDataPending())
+                BTProtocolCallbacks::onTransmitStalled();
+
+        } else {
+            unsigned len = BTProtocolCallbacks::onProduceData(&txBuffer.param[1]);
+            if (len) {
+                txBuffer.length = len + 2;
+                txBuffer.command = Op::SendData;
+                txBuffer.param[0] = PIPE_SIFTEO_BASE_DATA_IN_TX;
+                dataCredits--;
+
+                /*
+                 * SendData has no response event to wake us up again, so
+                 * without this we'd send one packet per requestProduceData()
+                 * or DataCreditEvent. Keep draining the queue back-to-back
+                 * for as long as we have credits to spend.
+                 */
+                if (dataCredits && BTProtocolCallbacks::isDataPending())
+                    requestTransaction();
+                return;
+            }
         }
     }
 
@@ -79,8 +79,12 @@ namespace PwmAudioOut {
     static const GPIOPin outB(&AUDIO_PWMB_PORT, AUDIO_PWMB_PIN);
 }
 
+AudioOutDevice::Stats AudioOutDevice::stats;
+
 void AudioOutDevice::init()
 {
+    resetStats();
+
     // TIM1 partial remap for complementary channels
     STATIC_ASSERT(&AUDIO_PWM_TIM == &TIM1);
     AFIO.MAPR |= (1 << 6);
@@ -157,6 +161,10 @@ IRQ_HANDLER ISR_FN(AUDIO_SAMPLE_TIM)()
     GPIOPin::Control ctrlA = GPIOPin::OUT_2MHZ;
     GPIOPin::Control ctrlB = GPIOPin::OUT_2MHZ;
 
+    // Running dry is only an underrun while the mixer still has output
+    unsigned fill = AudioMixer::output.readAvailable();
+    AudioOutDevice::recordFill(fill, !fill && AudioMixer::instance.active());
+
     while (!AudioMixer::output.empty()) {
         int sample = AudioMixer::output.dequeue();
 
@@ -190,6 +198,14 @@ IRQ_HANDLER ISR_FN(AUDIO_SAMPLE_TIM)()
     Tasks::trigger(Tasks::AudioPull);
 }
 
+void AudioOutDevice::resetStats()
+{
+    stats.interrupts = 0;
+    stats.underruns = 0;
+    stats.minFill = 0xFFFF;
+    stats.maxFill = 0;
+}
+
 int AudioOutDevice::getSampleBias()
 {
     return 0;
@@ -37,6 +37,7 @@
 #include "systime.h"
 #include "radio.h"
 #include "nrf24l01.h"
+#include "tasks.h"
 
 static uint8_t radioStartup = 0;
 static uint32_t radioWatchdog = 0;
@@ -106,6 +107,20 @@ void Radio::reinit()
 #endif
 }
 
+unsigned Radio::idleBeats()
+{
+    /*
+     * While the radio is starting up or enabled, heartbeat() is its
+     * watchdog and power-on timer, so it needs every beat. An enabled
+     * radio keeps us awake with its own IRQs anyway.
+     */
+
+    if ((radioStartup && radioStartup <= 2) || RadioManager::isRadioEnabled())
+        return 1;
+
+    return Tasks::MAX_IDLE_BEATS;
+}
+
 void Radio::heartbeat()
 {
     /*
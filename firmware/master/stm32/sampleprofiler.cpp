@@ -24,54 +24,313 @@
  */
 
 #include "sampleprofiler.h"
+#include "cycleprofiler.h"
 #include "usb/usbdevice.h"
 #include "usbprotocol.h"
 #include "vectors.h"
+#include "dma.h"
+#include "audiooutdevice.h"
+#include "audiomixer.h"
 
 #include "tasks.h"
 
 #include <string.h>
 
+extern unsigned _stack;
+extern unsigned __data_src;
+
 SampleProfiler::SubSystem SampleProfiler::subsys;
-uint32_t SampleProfiler::sampleBuf;
+SampleProfiler::SampleMode SampleProfiler::mode;
+uint32_t SampleProfiler::sampleBuf[MAX_STACK_DEPTH];
+unsigned SampleProfiler::sampleDepth;
+volatile uint32_t SampleProfiler::sampleSeq;
 HwTimer SampleProfiler::timer(&PROFILER_TIM);
+RingBuffer<256, uint32_t> SampleProfiler::pcQueue;
+uint32_t SampleProfiler::droppedSamples;
+uint32_t SampleProfiler::subsystemSamples[NUM_SUBSYSTEMS];
 
 void SampleProfiler::init()
 {
     subsys = None;
+    mode = Disabled;
+    sampleDepth = 1;
+    pcQueue.init();
 
-    // Highest prime number under 1000
-    timer.init(997, 70);
+    timer.init(DEFAULT_PERIOD, 70);
 }
 
 void SampleProfiler::onUSBData(const USBProtocolMsg &m)
 {
-    if (m.payloadLen() < 2 || m.payload[0] != SetProfilingEnabled)
+    if (m.payloadLen() < 2)
         return;
 
-    if (m.payload[1]) {
-        timer.enableUpdateIsr();
-        Tasks::trigger(Tasks::Profiler);
-    } else {
-        Tasks::cancel(Tasks::Profiler);
+    switch (m.payload[0]) {
+
+    case SetProfilingEnabled:
         timer.disableUpdateIsr();
+        Tasks::cancel(Tasks::Profiler);
+
+        // Older hosts only ever send 0 or 1, and no period
+        mode = m.payload[1] >= Stacks ? Stacks : SampleMode(m.payload[1]);
+        if (mode != Disabled) {
+            unsigned period = DEFAULT_PERIOD;
+            if (m.payloadLen() >= 4)
+                period = MAX(unsigned(m.payload[2] | (m.payload[3] << 8)), unsigned(MIN_PERIOD));
+            timer.setPeriod(period, 70);
+
+            sampleDepth = 1;
+            pcQueue.init();
+            droppedSamples = 0;
+            memset(subsystemSamples, 0, sizeof subsystemSamples);
+
+            timer.enableUpdateIsr();
+        }
+        return;
+
+    case GetTaskStats:
+        // payload[1] nonzero requests a reset once the stats are sent
+        sendTaskStats(m.payload[1]);
+        return;
+
+    case GetCycleStats:
+        sendCycleStats(m.payload[1]);
+        return;
+
+    case GetDmaStats:
+        sendDmaStats(m.payload[1]);
+        return;
+
+    case GetAudioStats:
+        sendAudioStats(m.payload[1]);
+        return;
+
+    case GetSampleStats:
+        sendSampleStats();
+        return;
     }
 }
 
-void SampleProfiler::processSample(uint32_t pc)
+void SampleProfiler::sendTaskStats(bool reset)
+{
+    for (unsigned id = 0; id < Tasks::NUM_TASKS; ++id) {
+        const Tasks::TaskStats &s = Tasks::getStats(Tasks::TaskID(id));
+
+        USBProtocolMsg m(USBProtocol::Profiler);
+        TaskStatsReply *r = m.zeroCopyAppend<TaskStatsReply>();
+
+        r->command = GetTaskStats;
+        r->task = id;
+        r->reserved[0] = r->reserved[1] = 0;
+        r->runs = s.runs;
+        r->overruns = s.overruns;
+        r->maxUS = s.maxTicks / SysTime::usTicks(1);
+        r->totalMS = s.totalTicks / SysTime::msTicks(1);
+
+        UsbDevice::write(m.bytes, m.len);
+    }
+
+    if (reset)
+        Tasks::resetStats();
+}
+
+void SampleProfiler::sendCycleStats(bool reset)
+{
+#ifdef CYCLE_PROFILER
+    for (unsigned id = 0; id < Tasks::NUM_TASKS; ++id) {
+        const CycleProfiler::Counter &c = CycleProfiler::task(id);
+        if (c.calls)
+            sendCycleCounter(CycleProfiler::TaskCycles, id, c.totalCycles, c.calls, c.maxCycles);
+    }
+
+    for (unsigned num = 0; num < CycleProfiler::NUM_SYSCALLS; ++num) {
+        const CycleProfiler::Counter &c = CycleProfiler::syscall(num);
+        if (c.calls)
+            sendCycleCounter(CycleProfiler::SyscallCycles, num, c.totalCycles, c.calls, c.maxCycles);
+    }
+
+    if (reset)
+        CycleProfiler::reset();
+#endif
+
+    sendCycleCounter(CycleProfiler::EndOfTables, 0, 0, 0, 0);
+}
+
+void SampleProfiler::sendDmaStats(bool reset)
+{
+    for (unsigned ch = 0; ch < Dma::NUM_CHANNELS; ++ch) {
+        const Dma::ChannelStats &s = Dma::getStats(ch);
+
+        USBProtocolMsg m(USBProtocol::Profiler);
+        DmaStatsReply *r = m.zeroCopyAppend<DmaStatsReply>();
+
+        r->command = GetDmaStats;
+        r->channel = ch;
+        r->reserved[0] = r->reserved[1] = 0;
+        r->transfers = s.transfers;
+        r->halfTransfers = s.halfTransfers;
+        r->errors = s.errors;
+        r->contended = s.contended;
+        r->conflicts = s.conflicts;
+
+        UsbDevice::write(m.bytes, m.len);
+    }
+
+    if (reset)
+        Dma::resetStats();
+}
+
+void SampleProfiler::sendAudioStats(bool reset)
+{
+    const AudioOutDevice::Stats &s = AudioOutDevice::getStats();
+
+    USBProtocolMsg m(USBProtocol::Profiler);
+    AudioStatsReply *r = m.zeroCopyAppend<AudioStatsReply>();
+
+    r->command = GetAudioStats;
+    r->reserved[0] = r->reserved[1] = r->reserved[2] = 0;
+    r->interrupts = s.interrupts;
+    r->underruns = s.underruns;
+    r->minFill = s.interrupts ? s.minFill : 0;
+    r->maxFill = s.maxFill;
+    r->capacity = AudioMixer::output.capacity();
+    r->reserved2 = 0;
+
+    UsbDevice::write(m.bytes, m.len);
+
+    if (reset)
+        AudioOutDevice::resetStats();
+}
+
+void SampleProfiler::sendSampleStats()
+{
+    USBProtocolMsg m(USBProtocol::Profiler);
+    SampleStatsReply *r = m.zeroCopyAppend<SampleStatsReply>();
+
+    r->command = GetSampleStats;
+    r->numSubsystems = NUM_SUBSYSTEMS;
+    r->reserved[0] = r->reserved[1] = 0;
+    r->dropped = droppedSamples;
+    memcpy(r->samples, subsystemSamples, sizeof r->samples);
+
+    UsbDevice::write(m.bytes, m.len);
+}
+
+void SampleProfiler::sendCycleCounter(unsigned table, unsigned index, uint64_t total,
+                                      uint32_t calls, uint32_t maxCycles)
+{
+    USBProtocolMsg m(USBProtocol::Profiler);
+    CycleStatsReply *r = m.zeroCopyAppend<CycleStatsReply>();
+
+    r->command = GetCycleStats;
+    r->table = table;
+    r->index = index;
+    r->calls = calls;
+    r->maxCycles = maxCycles;
+    r->totalCyclesLow = total;
+    r->totalCyclesHigh = total >> 32;
+
+    UsbDevice::write(m.bytes, m.len);
+}
+
+void SampleProfiler::processSample(uint32_t pc, const uint32_t *frame, uint32_t excReturn)
 {
     timer.clearStatus();
+    subsystemSamples[subsys]++;
 
     // high 4 bits are subsystem
-    sampleBuf = (subsys << 28) | pc;
+    pc |= subsys << 28;
+
+    if (mode == Stacks) {
+        sampleBuf[0] = pc;
+        sampleDepth = walkStack(frame, excReturn);
+        sampleSeq++;
+        Tasks::trigger(Tasks::Profiler);
+
+    } else if (pcQueue.full()) {
+        droppedSamples++;
+
+    } else {
+        pcQueue.enqueue(pc);
+        if (pcQueue.readAvailable() >= MAX_STACK_DEPTH)
+            Tasks::trigger(Tasks::Profiler);
+    }
+}
+
+bool SampleProfiler::isReturnAddress(uint32_t addr)
+{
+    // Thumb return addresses are odd, and must land in our own code
+    return (addr & 1) && addr < uintptr_t(&__data_src) &&
+        addr >= uintptr_t(NVIC.VectorTableFlash);
+}
+
+unsigned SampleProfiler::walkStack(const uint32_t *frame, uint32_t excReturn)
+{
+    /*
+     * GCC's Thumb-2 frames don't form a chain we can follow, even with
+     * frame pointers, so look up the interrupted stack for words that
+     * could be return addresses into flash. Stale values get picked up
+     * too; the host treats these stacks as approximate.
+     *
+     * The hardware-stacked LR is the best guess for the caller, and the
+     * interrupted code's own stack starts just past the 8-word exception
+     * frame (plus a word of padding if bit 9 of the stacked xPSR is set).
+     */
+
+    unsigned depth = 1;
+
+    uint32_t lr = frame[5];
+    if (isReturnAddress(lr))
+        sampleBuf[depth++] = lr;
+
+    const uint32_t *sp = frame + 8 + ((frame[7] >> 9) & 1);
+
+    // Main stack ends at _stack. User stacks live in the RAM above it.
+    uintptr_t top = (excReturn & 0x4) ? 0x20010000 : uintptr_t(&_stack);
+    uintptr_t limit = MIN(top, uintptr_t(sp + STACK_SCAN_WORDS));
+
+    for (; uintptr_t(sp) < limit && depth < MAX_STACK_DEPTH; ++sp) {
+        uint32_t word = *sp;
+        if (isReturnAddress(word) && word != sampleBuf[depth - 1])
+            sampleBuf[depth++] = word;
+    }
+
+    return depth;
 }
 
 void SampleProfiler::task()
 {
-    USBProtocolMsg m(USBProtocol::Profiler);
-    m.append((uint8_t*)&sampleBuf, sizeof sampleBuf);
-    UsbDevice::write(m.bytes, m.len);
-    Tasks::trigger(Tasks::Profiler);
+    /*
+     * The sampling ISR triggers us, so we only wake up when there's
+     * something new to send: a full batch of PCs, or one stack.
+     */
+
+    USBProtocolMsg m;
+
+    if (mode == Stacks) {
+        /*
+         * The sampling ISR may land while we copy, so retry until we get a
+         * consistent snapshot. It can only preempt us, never the reverse.
+         */
+
+        uint32_t seq;
+        do {
+            seq = sampleSeq;
+            m.init(USBProtocol::Profiler);
+            m.append((uint8_t*)sampleBuf, sampleDepth * sizeof sampleBuf[0]);
+        } while (seq != sampleSeq);
+
+        UsbDevice::write(m.bytes, m.len);
+        return;
+    }
+
+    while (pcQueue.readAvailable() >= MAX_STACK_DEPTH) {
+        m.init(USBProtocol::Profiler);
+        for (unsigned i = 0; i < MAX_STACK_DEPTH; ++i) {
+            uint32_t pc = pcQueue.dequeue();
+            m.append((uint8_t*)&pc, sizeof pc);
+        }
+        UsbDevice::write(m.bytes, m.len);
+    }
 }
 
 void SampleProfiler::reportHang()
@@ -115,6 +374,7 @@ NAKED_HANDLER ISR_TIM2()
         "mrseq  r1, msp             \n\t"
         "mrsne  r1, psp             \n\t"
         "ldr    r0, [r1, #24]       \n\t"   // load r0 with the stacked PC
+        "mov    r2, lr              \n\t"   // r1 = stacked frame, r2 = EXC_RETURN
         "push   { lr }              \n\t"
         "bl     %[handler]          \n\t"   // and pass it off to be processed
         "pop    { pc }"
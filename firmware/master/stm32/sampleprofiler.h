@@ -28,6 +28,7 @@
 
 #include "hwtimer.h"
 #include "usbprotocol.h"
+#include "ringbuffer.h"
 
 class SampleProfiler
 {
@@ -40,17 +41,117 @@ public:
         SVCISR,
         RFISR,
         BluetoothISR,
+        NeighborISR,
+        NUM_SUBSYSTEMS
     };
 
     enum Command {
-        SetProfilingEnabled
+        SetProfilingEnabled,
+        GetTaskStats,
+        GetCycleStats,
+        GetDmaStats,
+        GetAudioStats,
+        GetSampleStats,
     };
 
+    /*
+     * Reply to GetTaskStats, one per task. Times are in microseconds,
+     * except the total which is in milliseconds to keep it from wrapping.
+     */
+    struct TaskStatsReply {
+        uint8_t command;
+        uint8_t task;
+        uint8_t reserved[2];
+        uint32_t runs;
+        uint32_t overruns;
+        uint32_t maxUS;
+        uint32_t totalMS;
+    };
+
+    /*
+     * Reply to GetDmaStats, one per channel in Dma::ChannelStats order
+     * (DMA1 channels, then DMA2).
+     */
+    struct DmaStatsReply {
+        uint8_t command;
+        uint8_t channel;
+        uint8_t reserved[2];
+        uint32_t transfers;
+        uint32_t halfTransfers;
+        uint32_t errors;
+        uint32_t contended;
+        uint32_t conflicts;
+    };
+
+    /*
+     * Reply to GetAudioStats, a single AudioOutDevice::Stats snapshot.
+     * Fill levels are in samples.
+     */
+    struct AudioStatsReply {
+        uint8_t command;
+        uint8_t reserved[3];
+        uint32_t interrupts;
+        uint32_t underruns;
+        uint16_t minFill;
+        uint16_t maxFill;
+        uint16_t capacity;
+        uint16_t reserved2;
+    };
+
+    /*
+     * Reply to GetCycleStats, one per CycleProfiler counter that has
+     * been hit, followed by a single reply with table == EndOfTables.
+     * Firmware built without CYCLE_PROFILER sends only the end marker.
+     */
+    struct CycleStatsReply {
+        uint8_t command;
+        uint8_t table;
+        uint16_t index;
+        uint32_t calls;
+        uint32_t maxCycles;
+        uint32_t totalCyclesLow;
+        uint32_t totalCyclesHigh;
+    };
+
+    /*
+     * Reply to GetSampleStats: how many samples landed in each subsystem
+     * since profiling was last enabled, including any that were dropped
+     * because the host wasn't keeping up.
+     */
+    struct SampleStatsReply {
+        uint8_t command;
+        uint8_t numSubsystems;
+        uint8_t reserved[2];
+        uint32_t dropped;
+        uint32_t samples[NUM_SUBSYSTEMS];
+    };
+
+    /*
+     * SetProfilingEnabled takes one of these, optionally followed by a
+     * 16-bit sample period in timer ticks of about 1 us.
+     *
+     * In PCOnly mode, samples are queued and sent in batches, one PC per
+     * word (with the subsystem in its high 4 bits). In Stacks mode each
+     * sample packet holds a whole stack: the PC, then likely return
+     * addresses, innermost first.
+     */
+    enum SampleMode {
+        Disabled,
+        PCOnly,
+        Stacks,
+    };
+
+    static const unsigned MAX_STACK_DEPTH = USBProtocolMsg::MAX_PAYLOAD_BYTES / sizeof(uint32_t);
+
+    // Sample period, in ticks of the ~1 MHz profiler timer
+    static const unsigned DEFAULT_PERIOD = 997;     // Highest prime under 1000
+    static const unsigned MIN_PERIOD = 100;
+
     static void init();
 
     static void onUSBData(const USBProtocolMsg &m);
 
-    static void processSample(uint32_t pc);
+    static void processSample(uint32_t pc, const uint32_t *frame, uint32_t excReturn);
     static void task();
     static void reportHang();
 
@@ -63,9 +164,31 @@ public:
     }
 
 private:
+    static void sendTaskStats(bool reset);
+    static void sendCycleStats(bool reset);
+    static void sendDmaStats(bool reset);
+    static void sendAudioStats(bool reset);
+    static void sendSampleStats();
+    static void sendCycleCounter(unsigned table, unsigned index, uint64_t total,
+                                 uint32_t calls, uint32_t maxCycles);
+
+    static unsigned walkStack(const uint32_t *frame, uint32_t excReturn);
+    static ALWAYS_INLINE bool isReturnAddress(uint32_t addr);
+
+    // How far up the interrupted stack we look for return addresses
+    static const unsigned STACK_SCAN_WORDS = 64;
+
     static SubSystem subsys;
-    static uint32_t sampleBuf;  // currently just a single sample
+    static SampleMode mode;
+    static uint32_t sampleBuf[MAX_STACK_DEPTH];
+    static unsigned sampleDepth;
+    static volatile uint32_t sampleSeq;
     static HwTimer timer;
+
+    // PCOnly samples waiting to go out, in batches of MAX_STACK_DEPTH
+    static RingBuffer<256, uint32_t> pcQueue;
+    static uint32_t droppedSamples;
+    static uint32_t subsystemSamples[NUM_SUBSYSTEMS];
 };
 
 #endif // SAMPLEPROFILER_H_
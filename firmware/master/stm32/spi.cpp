@@ -197,6 +197,46 @@ void SPIMaster::txDma(const uint8_t *txbuf, unsigned len)
     dmaTxChan->CCR |= 0x1;
 }
 
+/*
+    Run a chain of DMA transfers, without waking up the caller in between.
+    'segments' must stay valid until the completion callback fires.
+
+    The STM32F1 DMA controller can't follow a descriptor chain on its own,
+    so we step to the next segment from our DMA ISR. That's still far
+    cheaper than a trip through the device driver for each transfer.
+*/
+void SPIMaster::chainDma(const Segment *segments, unsigned count,
+                         const GPIOPin *select, const GPIOPin *strobe)
+{
+    chainSegment = segments;
+    chainSelect = select;
+    chainStrobe = strobe;
+    chainLeft = count;
+
+    beginSegment(*segments);
+}
+
+void SPIMaster::beginSegment(const Segment &s)
+{
+    if (s.flags & sSelect)
+        chainSelect->setLow();
+    if (s.flags & sStrobe)
+        chainStrobe->setHigh();
+
+    if (s.rxbuf)
+        transferDma(s.txbuf, s.rxbuf, s.len);
+    else
+        txDma(s.txbuf, s.len);
+}
+
+void SPIMaster::endSegment()
+{
+    if (chainSelect)
+        chainSelect->setHigh();
+    if (chainStrobe)
+        chainStrobe->setLow();
+}
+
 /*
     Static routine to dispatch DMA events to the appropriate SPIMaster
     instance. It's assumed that the instance was passed as the param to
@@ -226,6 +266,16 @@ void SPIMaster::dmaCallback(void *p, uint8_t flags)
         (void)spi->hw->SR;
     }
 
+    // Step through a chain, if we're in one. Errors end the chain early.
+    if (spi->chainLeft) {
+        spi->endSegment();
+        if (--spi->chainLeft && !(flags & (1 << 3))) {
+            spi->beginSegment(*++spi->chainSegment);
+            return;
+        }
+        spi->chainLeft = 0;
+    }
+
     if (spi->completionCB) {
         spi->completionCB();
     }
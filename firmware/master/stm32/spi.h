@@ -62,13 +62,33 @@ class SPIMaster {
 
     typedef void (*CompletionCallback)();
 
+    /*
+     * One DMA transfer in a chain. Segments run back to back from the
+     * DMA ISR, and the completion callback only fires after the last one.
+     *
+     * Each segment may hold the chain's 'select' pin low and/or its
+     * 'strobe' pin high while it runs. Both are released between
+     * segments, so each selected segment is its own device transaction.
+     */
+    struct Segment {
+        const uint8_t *txbuf;
+        uint8_t *rxbuf;         // NULL to discard received data
+        uint8_t len;
+        uint8_t flags;
+    };
+
+    enum SegmentFlags {
+        sSelect     = (1 << 0),
+        sStrobe     = (1 << 1)
+    };
+
     SPIMaster(volatile SPI_t *_hw,
               GPIOPin _sck,
               GPIOPin _miso,
               GPIOPin _mosi,
               CompletionCallback cb = 0)
         : hw(_hw), sck(_sck), miso(_miso), mosi(_mosi),
-          completionCB(cb) {}
+          chainLeft(0), completionCB(cb) {}
 
     void init(const Config & config);
 
@@ -78,6 +98,9 @@ class SPIMaster {
     void transferDma(const uint8_t *txbuf, uint8_t *rxbuf, unsigned len);
     void txDma(const uint8_t *txbuf, unsigned len);
 
+    void chainDma(const Segment *segments, unsigned count,
+                  const GPIOPin *select, const GPIOPin *strobe = 0);
+
  private:
     volatile SPI_t *hw;
     volatile DMAChannel_t *dmaRxChan;
@@ -87,8 +110,16 @@ class SPIMaster {
     GPIOPin mosi;
     uint32_t dmaRxPriorityBits;
 
+    const Segment *chainSegment;
+    const GPIOPin *chainSelect;
+    const GPIOPin *chainStrobe;
+    unsigned chainLeft;
+
     CompletionCallback completionCB;
     static void dmaCallback(void *p, uint8_t flags);
+
+    void beginSegment(const Segment &s);
+    void endSegment();
 };
 
 #endif
@@ -31,6 +31,17 @@
 static const unsigned SYSTICK_HZ = (72000000 / 8);
 static const unsigned SYSTICK_IRQ_HZ = 10;
 static const uint32_t SYSTICK_RELOAD = (SYSTICK_HZ / SYSTICK_IRQ_HZ) - 1;
+static const uint32_t SYSTICK_PERIOD = SYSTICK_RELOAD + 1;
+
+/*
+ * Tickless idle never reloads SysTick with less than this, so that we're
+ * sure to have put SYSTICK_RELOAD back before the short period runs out.
+ * About 14us.
+ */
+static const uint32_t SYSTICK_MIN_RELOAD = 128;
+
+// Heartbeats covered by a stretched period in progress, or zero
+static unsigned stretchBeats;
 
 /*
  * tickBase --
@@ -56,6 +67,10 @@ void SysTime::init()
 
     tickBase = 0;
     lastTick = 0;
+    stretchBeats = 0;
+
+    // A stretched period must still fit in the 24-bit counter
+    STATIC_ASSERT(Tasks::MAX_IDLE_BEATS * SYSTICK_PERIOD <= 0x1000000);
 
     NVIC.SysTick_CS = 0;
     NVIC.SysTick_RELOAD = SYSTICK_RELOAD;
@@ -66,6 +81,90 @@ void SysTime::init()
     NVIC.SysTick_CS = 3;
 }
 
+static void reloadOnce(uint32_t reload)
+{
+    /*
+     * Start a one-off period of 'reload' + 1 counts. Writing the current
+     * value clears it, so SysTick loads RELOAD on its next count. Once it
+     * has, the following periods can go back to normal.
+     *
+     * The partial count in progress is lost each time, so the timebase
+     * slips by under a microsecond per tickless sleep.
+     */
+
+    NVIC.SysTick_RELOAD = reload;
+    NVIC.SysTick = 0;
+    while (NVIC.SysTick == 0);
+    NVIC.SysTick_RELOAD = SYSTICK_RELOAD;
+}
+
+void SysTime::stretchTick(unsigned beats)
+{
+    ASSERT(beats >= 1 && beats <= Tasks::MAX_IDLE_BEATS);
+    ASSERT(stretchBeats == 0);
+
+    /*
+     * Leave it alone if the rollover is about to happen, or already has
+     * and is waiting on its ISR.
+     */
+
+    uint32_t remaining = NVIC.SysTick;
+    const uint32_t PENDSTSET = 1 << 26;
+    if (beats < 2 || remaining < SYSTICK_MIN_RELOAD ||
+        (NVIC.interruptControlState & PENDSTSET))
+        return;
+
+    // The next rollover, and (beats - 1) more after it
+    reloadOnce(remaining + (beats - 1) * SYSTICK_PERIOD - 1);
+    stretchBeats = beats;
+}
+
+void SysTime::restoreTick()
+{
+    unsigned beats = stretchBeats;
+    if (!beats)
+        return;
+    stretchBeats = 0;
+
+    const uint32_t PENDSTSET = 1 << 26;
+    unsigned missed;
+
+    if (NVIC.interruptControlState & PENDSTSET) {
+        /*
+         * Slept through the whole thing. SysTick has already reloaded
+         * with a normal period, and the pending ISR counts the last beat.
+         */
+
+        missed = beats - 1;
+
+    } else {
+        /*
+         * Woken early. The regular rollovers we skipped fall on whole
+         * periods back from the end of the stretched one. Count the ones
+         * behind us, and reload to land on the next one.
+         */
+
+        uint32_t remaining = NVIC.SysTick;
+        missed = beats - 1 - remaining / SYSTICK_PERIOD;
+        remaining %= SYSTICK_PERIOD;
+
+        if (remaining < SYSTICK_MIN_RELOAD) {
+            // Close enough; call that rollover done, and wait for the next
+            missed++;
+            remaining += SYSTICK_PERIOD;
+        }
+
+        reloadOnce(remaining - 1);
+    }
+
+    if (missed) {
+        tickBase += hzTicks(SYSTICK_IRQ_HZ) * missed;
+#ifndef RFTEST
+        Tasks::heartbeatISR(missed);
+#endif
+    }
+}
+
 IRQ_HANDLER ISR_SysTick()
 {
     tickBase += SysTime::hzTicks(SYSTICK_IRQ_HZ);
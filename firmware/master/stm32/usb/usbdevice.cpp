@@ -283,9 +283,16 @@ uint8_t UsbDevice::epINBuf[UsbHardware::MAX_PACKET];
 */
 void UsbDevice::handleOUTData()
 {
+    /*
+     * Several packets may be queued. Take one at a time, and come back
+     * for the next so that other tasks get a turn in between.
+     */
+
     USBProtocolMsg m;
     m.len = UsbHardware::epReadPacket(OutEpAddr, m.bytes, m.bytesFree());
     if (m.len > 0) {
+        Tasks::trigger(Tasks::UsbOUT);
+
     #if ((BOARD == BOARD_TEST_JIG) && !defined(BOOTLOADER))
         TestJig::onTestDataReceived(m.bytes, m.len);
     #elif defined(BOOTLOADER)
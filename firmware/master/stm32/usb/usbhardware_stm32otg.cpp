@@ -113,6 +113,9 @@ void reset()
     while (OTG.global.GRSTCTL & (1 << 4))
         ;
 
+    rxQueueHead = rxQueueTail = 0;
+    rxQueueStalled = false;
+
     // disable EPs, only if they're not already disabled.
     for (unsigned i = 0; i < 4; ++i) {
 
@@ -264,43 +267,69 @@ uint16_t epWritePacket(uint8_t addr, const void *buf, uint16_t len)
 
 /*
  * Read directly from the fifo the RX data that most recently arrived.
- * Don't update counts or re-enable RXFLVL yet - this happens once the
- * packet is read by the actual client, at which point we're ready to
- * receive another packet.
+ * Don't update counts or re-enable the endpoint yet - for EP0 this happens
+ * once the packet is read by the actual client, and for data endpoints once
+ * the transfer completes and there's room for another packet.
  */
-static void epReadFifo(uint16_t len)
+static void epReadFifo(PacketBuf &pb, uint16_t len)
 {
     // there's only one shared rx fifo, so arbitrarily access via ep0
     uint32_t wordCount = (len + 3) / 4;
     volatile uint32_t *fifo = OTG.epFifos[0];
-    uint32_t *buf32 = reinterpret_cast<uint32_t*>(&rxFifoBuf.bytes[0]);
+    uint32_t *buf32 = reinterpret_cast<uint32_t*>(&pb.bytes[0]);
 
     while (wordCount--) {
         *buf32++ = *fifo;
     }
-    rxFifoBuf.len = len;
+    pb.len = len;
+}
+
+static void epArmOUT(uint8_t addr)
+{
+    volatile USBOTG_OUT_EP_t & ep = OTG.device.outEps[addr];
+    ep.DOEPTSIZ = doeptsiz[addr];
+    ep.DOEPCTL |= (1 << 31) | (1 << 26);    // EPENA & CNAK
+}
+
+static ALWAYS_INLINE unsigned rxQueueNext(unsigned i)
+{
+    return (i + 1) % RX_QUEUE_DEPTH;
 }
 
 /*
  * Get the RX packet that most recently arrived.
- * If it's on EP0, we read directly from the fifo.
- * For any other endpoint, it should have already been buffered - read it from there.
+ * If it's on EP0, it was buffered in rxFifoBuf. Any other endpoint
+ * takes the oldest packet from the ring, or returns 0 if it's empty.
  */
 uint16_t epReadPacket(uint8_t addr, void *buf, uint16_t len)
 {
-    len = MIN(len, rxFifoBuf.len);
-    rxFifoBuf.len = 0;
+    if (addr == 0) {
+        len = MIN(len, rxFifoBuf.len);
+        rxFifoBuf.len = 0;
+        memcpy(buf, rxFifoBuf.bytes, len);
 
-    // copy the data out of our buffer
-    // TODO: UsbDevice should provide its own endpoint buffers
-    memcpy(buf, rxFifoBuf.bytes, len);
+        epArmOUT(addr);
+        return len;
+    }
 
-    // unmask RXFLVL & re-enable this endpoint for more RXing
-    OTG.global.GINTMSK |= RXFLVL;
+    unsigned head = rxQueueHead;
+    if (head == rxQueueTail)
+        return 0;
 
-    volatile USBOTG_OUT_EP_t & ep = OTG.device.outEps[addr];
-    ep.DOEPTSIZ = doeptsiz[addr];
-    ep.DOEPCTL |= (1 << 31) | (1 << 26);    // EPENA & CNAK
+    PacketBuf &pb = rxQueue[head];
+    len = MIN(len, pb.len);
+    memcpy(buf, pb.bytes, len);
+
+    /*
+     * Free the slot before checking for a stall. If the ISR filled the
+     * ring, it set rxQueueStalled before we got here; if it runs after
+     * this point, it sees the free slot and re-arms by itself.
+     */
+    rxQueueHead = rxQueueNext(head);
+    if (rxQueueStalled) {
+        rxQueueStalled = false;
+        epArmOUT(addr);
+    }
 
     return len;
 }
@@ -319,16 +348,20 @@ void rxflvlISR()
     uint32_t rxstsp = OTG.global.GRXSTSP;
     uint16_t pktsts = (rxstsp >> 17) & 0xf;
     uint16_t bcnt = (rxstsp >> 4) & 0x3ff;   // BCNT mask
+    uint8_t epnum = rxstsp & 0xf;
 
     switch (pktsts) {
 
     case PktStsSetupData:
-        UsbHardware::epReadFifo(bcnt);
+        UsbHardware::epReadFifo(rxFifoBuf, bcnt);
         break;
 
     case PktStsOutData:
-        if (bcnt > 0) {
-            UsbHardware::epReadFifo(bcnt);
+        if (epnum != 0) {
+            // committed to the ring once the transfer completes
+            UsbHardware::epReadFifo(rxQueue[rxQueueTail], bcnt);
+        } else if (bcnt > 0) {
+            UsbHardware::epReadFifo(rxFifoBuf, bcnt);
         }
         break;
     }
@@ -412,8 +445,20 @@ void outEpISR()
             if (i == 0) {
                 UsbCore::out();
             } else {
-                // don't receive any more packets until UsbDevice reads this one
-                OTG.global.GINTMSK &= ~RXFLVL;
+                // zero-length packets carry nothing for the application
+                unsigned tail = rxQueueTail;
+                if (rxQueue[tail].len) {
+                    tail = rxQueueNext(tail);
+                    rxQueueTail = tail;
+                }
+
+                // keep receiving unless that was the last free slot
+                if (rxQueueNext(tail) != rxQueueHead) {
+                    epArmOUT(i);
+                } else {
+                    rxQueueStalled = true;
+                }
+
                 UsbDevice::outEndpointCallback(i);
             }
         }
@@ -78,9 +78,10 @@ namespace UsbHardwareStm32Otg
      * out of usb ram as soon as they arrive. Stash them here until the application
      * reads them out.
      *
-     * TODO: the application should provide this buffer, and we should provide a
-     * mechanism for it to tell us once it has consumed it such that we can
-     * start receiving the next one.
+     * EP0 uses rxFifoBuf. Data endpoints get a small ring, so the host can
+     * keep sending while the application is still busy with an earlier
+     * packet (programming flash, for instance). Their endpoint is only left
+     * NAKing once every slot is full, and re-armed as soon as one frees up.
      */
     struct PacketBuf {
         uint8_t bytes[UsbHardware::MAX_PACKET];
@@ -88,6 +89,13 @@ namespace UsbHardwareStm32Otg
     };
     PacketBuf rxFifoBuf;
 
+    // One slot always stays empty, to tell a full ring from an empty one
+    static const unsigned RX_QUEUE_DEPTH = 4;
+    PacketBuf rxQueue[RX_QUEUE_DEPTH];
+    volatile uint8_t rxQueueHead;       // next packet for the application
+    volatile uint8_t rxQueueTail;       // slot the next packet arrives in
+    volatile bool rxQueueStalled;       // endpoint left disabled, ring was full
+
 
     struct InEndpointState {
         const uint8_t *buf;
@@ -3,7 +3,9 @@
 # Firmware syscall table generator.
 #
 # Reads "abi.h" from stdin, produces a function pointer table on stdout,
-# for use in the SVM runtime implementation.
+# for use in the SVM runtime implementation. Alongside it, we emit a table
+# describing each syscall's signature, so the runtime can skip marshalling
+# registers that a particular syscall doesn't use.
 #
 # Micah Elizabeth Scott <micah@misc.name>
 # Copyright <c> 2012 Sifteo, Inc. All rights reserved.
@@ -102,12 +104,33 @@ aliasTable = {
 
 #######################################################################
 
-regex = re.compile(r"^.*(_SYS_\w+)\s*\(.*\)\s+_SC\((\d+)\)");
+regex = re.compile(r"^\s*(.*?)\b(_SYS_\w+)\s*\((.*)\)\s+_SC\((\d+)\)");
 fallback = re.compile(r"_SC\((\d+)\)");
 highestNum = 0
 callMap = {}
+infoMap = {}
 typedef = "(SvmSyscall)"
 
+def signatureInfo(retType, params):
+    # All parameters are 32-bit integers, by the syscall convention.
+    params = params.strip()
+    if params in ('', 'void'):
+        argc = 0
+    else:
+        argc = len(params.split(','))
+    if argc > 8:
+        raise Exception("Too many syscall parameters: %r" % params)
+
+    retType = retType.strip()
+    if retType == 'void':
+        ret = 'SC_RET_NONE'
+    elif retType.endswith('64_t'):
+        ret = 'SC_RET_64'
+    else:
+        ret = 'SC_RET_32'
+
+    return 'SC_INFO(%d, %s)' % (argc, ret)
+
 #
 # Scan the header for system calls
 #
@@ -115,11 +138,12 @@ typedef = "(SvmSyscall)"
 for line in sys.stdin:
     m = regex.match(line)
     if m:
-        name, num = m.group(1), int(m.group(2))
+        name, num = m.group(2), int(m.group(4))
         highestNum = max(highestNum, num)
         if num in callMap:
             raise Exception("Duplicate syscall #%d" % num)
         callMap[num] = name
+        infoMap[num] = signatureInfo(m.group(1), m.group(3))
     
     elif fallback.search(line):
         raise Exception("Regex might have missed a syscall on line: %r" % line);
@@ -148,3 +172,13 @@ for i in range(highestNum+1):
     print "    /* %4d */ %s %s," % (i, typedef, name)
 
 print "};"
+
+#
+# Signature table, parallel to SyscallTable.
+#
+
+print "\nstatic const uint8_t SyscallInfo[] = {"
+for i in range(highestNum+1):
+    print "    /* %4d */ %s," % (i, infoMap.get(i) or "0")
+
+print "};"
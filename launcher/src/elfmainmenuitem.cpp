@@ -36,6 +36,8 @@ using namespace Sifteo;
 
 ELFMainMenuItem ELFMainMenuItem::instances[MAX_INSTANCES];
 ELFMainMenuItem *ELFMainMenuItem::firstRun = 0;
+ELFMainMenuItem::MetadataCache ELFMainMenuItem::cache;
+const StoredObject ELFMainMenuItem::cacheKey = StoredObject::allocate();
 
 void ELFMainMenuItem::autoexec()
 {
@@ -84,6 +86,16 @@ void ELFMainMenuItem::findGames(Array<MainMenuItem*, Shared::MAX_ITEMS> &items)
 
     items.clear();
 
+    /*
+     * Start a fresh metadata cache, using the one we saved last time
+     * to skip parsing the metadata of any games we've already seen.
+     * Only games which are still installed carry over.
+     */
+
+    static MetadataCache previous;
+    previous.load();
+    cache.count = 0;
+
     /*
      * Create an ELFMainMenuItem for each, skipping any volumes
      * that cause init() to return false, and making sure the
@@ -98,7 +110,7 @@ void ELFMainMenuItem::findGames(Array<MainMenuItem*, Shared::MAX_ITEMS> &items)
         ELFMainMenuItem *inst = &instances[itemI];
         Volume vol = volumes[volI];
         bool isFirstRunExperience;
-        if (inst->init(vol, &isFirstRunExperience)) {
+        if (inst->init(vol, &isFirstRunExperience, &previous)) {
             if (!firstRun && isFirstRunExperience) {
                 firstRun = inst;
             } else {
@@ -111,14 +123,23 @@ void ELFMainMenuItem::findGames(Array<MainMenuItem*, Shared::MAX_ITEMS> &items)
     if (firstRun) {
         items.append(firstRun);
     }
+
+    // Only touch flash if the set of games actually changed
+    if (!(cache == previous)) {
+        cache.store();
+    }
 }
 
-bool ELFMainMenuItem::init(Volume volume, bool* outFirstRun)
+bool ELFMainMenuItem::init(Volume volume, bool* outFirstRun, const MetadataCache *previous)
 {
     /*
      * Load critical metadata from this volume into RAM, and check whether
      * it's suitable to include in the launcher menu. This loads only
      * lightweight resources from the volume. No assets are stored yet.
+     *
+     * If 'previous' has a record for this exact volume, we trust it
+     * instead of parsing the metadata again. Either way, the record
+     * we used is added to the new cache.
      */
 
     STATIC_ASSERT(MAX_INSTANCES < Shared::MAX_ITEMS);
@@ -126,48 +147,81 @@ bool ELFMainMenuItem::init(Volume volume, bool* outFirstRun)
     this->volume = volume;
     MappedVolume map(volume);
 
+    CacheRecord record;
+    const CacheRecord *cached = previous ? previous->find(volume.sys) : 0;
+
+    if (cached && !memcmp(cached->uuid.bytes, map.uuid()->bytes, sizeof cached->uuid)) {
+        record = *cached;
+    } else {
+        readMetadata(map, record);
+    }
+
+    if (cache.count < arraysize(cache.records)) {
+        cache.records[cache.count++] = record;
+    }
+
+    if (outFirstRun) {
+        *outFirstRun = (record.flags & F_FIRST_RUN) != 0;
+    }
+
+    if (!(record.flags & F_USABLE)) {
+        return false;
+    }
+
+    cubeRange = &record.cubeRange;
+    numAssetSlots = record.numAssetSlots;
+    uuid = record.uuid;
+    hasValidIcon = (record.flags & F_VALID_ICON) != 0;
+
+    return true;
+}
+
+void ELFMainMenuItem::readMetadata(MappedVolume &map, CacheRecord &record)
+{
+    bzero(record);
+    record.volume = volume.sys;
+    record.uuid = *map.uuid();
 
     /*
      * Check if this is the first run experience.
      * Kind of a hack - would prefer to have a first-class metadata.
      */
-     if (outFirstRun) {
-        const char *package = map.package();
-        const char *firstRunPackage = "com.sifteo.facetime";
-        while(*package && (*package == *firstRunPackage)) {
-            package++;
-            firstRunPackage++;
-        }
-        *outFirstRun = (*package == *firstRunPackage);
+    const char *package = map.package();
+    const char *firstRunPackage = "com.sifteo.facetime";
+    while(*package && (*package == *firstRunPackage)) {
+        package++;
+        firstRunPackage++;
+    }
+    if (*package == *firstRunPackage) {
+        record.flags |= F_FIRST_RUN;
     }
-
 
     LOG("LAUNCHER: Found Volume<%02x> %s, version %s \"%s\"\n",
         volume.sys & 0xFF, map.package(), map.version(), map.title());
 
     // Save the cube range (required)
-    cubeRange = map.metadata<_SYSMetadataCubeRange>(_SYS_METADATA_CUBE_RANGE);
-    if (!cubeRange.isValid()) {
+    CubeRange range = map.metadata<_SYSMetadataCubeRange>(_SYS_METADATA_CUBE_RANGE);
+    if (!range.isValid()) {
         LOG("LAUNCHER: Skipping game, invalid cube range\n");
-        return false;
+        return;
     }
+    record.cubeRange = range.sys;
 
     // Save the number of asset slots (required)
     const uint8_t *slots = map.metadata<uint8_t>(_SYS_METADATA_NUM_ASLOTS);
-    numAssetSlots = slots ? *slots : 0;
-    if (numAssetSlots > MAX_ASSET_SLOTS) {
+    record.numAssetSlots = slots ? *slots : 0;
+    if (record.numAssetSlots > MAX_ASSET_SLOTS) {
         LOG("LAUNCHER: Skipping game, too many asset slots. Requested %d, max is %d.\n",
-            numAssetSlots, MAX_ASSET_SLOTS);
-        return false;
+            record.numAssetSlots, MAX_ASSET_SLOTS);
+        return;
     }
 
-    // Save the UUID
-    uuid = *map.uuid();
-
     // See if there's a usable icon? We'll load it later, if so.
-    hasValidIcon = checkIcon(map);
+    if (checkIcon(map)) {
+        record.flags |= F_VALID_ICON;
+    }
 
-    return true;
+    record.flags |= F_USABLE;
 }
 
 bool ELFMainMenuItem::checkIcon(MappedVolume &map)
@@ -204,6 +258,39 @@ bool ELFMainMenuItem::checkIcon(MappedVolume &map)
 
 void ELFMainMenuItem::getAssets(Sifteo::MenuItem &menuItem, Shared::AssetConfiguration &config)
 {
+    /*
+     * Hand the menu a placeholder for now. The real icon gets filled in
+     * by loadIcon() when the menu is about to scroll this item into view,
+     * so we don't spend time decompressing icons nobody looks at.
+     */
+
+    iconLoaded = false;
+    icon.buffer.init();
+    icon.buffer.erase(Menu_BgTile);
+    menuItem.icon = icon.buffer;
+
+    if (hasValidIcon) {
+        MappedVolume map(volume);
+
+        // We already validated the icon metadata
+        auto iconMeta = map.metadata<_SYSMetadataImage>(_SYS_METADATA_ICON_96x96);
+        ASSERT(iconMeta);
+
+        // Only the group header is needed now; remember to load it later
+        AssetImage iconSrc;
+        map.translate(iconMeta, iconSrc, icon.group);
+        config.append(Shared::iconSlot, icon.group, volume);
+    }
+}
+
+void ELFMainMenuItem::loadIcon()
+{
+    if (iconLoaded)
+        return;
+    iconLoaded = true;
+
+    icon.buffer.init();
+
     if (hasValidIcon) {
         /*
          * Gather an icon from this volume.
@@ -211,33 +298,31 @@ void ELFMainMenuItem::getAssets(Sifteo::MenuItem &menuItem, Shared::AssetConfigu
 
         MappedVolume map(volume);
 
-        // We already validated the icon metadata
         auto iconMeta = map.metadata<_SYSMetadataImage>(_SYS_METADATA_ICON_96x96);
         ASSERT(iconMeta);
         ASSERT(iconMeta->width == icon.buffer.tileWidth());
         ASSERT(iconMeta->height == icon.buffer.tileHeight());
 
-        // Mapping translation; convert to an AssetImage and AssetGroup.
+        /*
+         * Mapping translation; convert to an AssetImage. Translate into a
+         * scratch group, since icon.group already holds this icon's load
+         * addresses on each cube, then point the image back at icon.group.
+         */
         AssetImage iconSrc;
-        map.translate(iconMeta, iconSrc, icon.group);
+        AssetGroup scratch;
+        map.translate(iconMeta, iconSrc, scratch);
+        iconSrc.sys.pAssetGroup = reinterpret_cast<uint32_t>(&icon.group.sys);
 
         // The above AssetImage still references data in the mapped volume,
         // which won't be available later. Copy / decompress it into RAM.
-        icon.buffer.init();
         icon.buffer.image(vec(0,0), iconSrc);
-        menuItem.icon = icon.buffer;
-
-        // Remember to load this asset group later
-        config.append(Shared::iconSlot, icon.group, volume);
 
     } else {
         /*
          * No icon? Create a randomly generated icon.
          */
 
-        icon.buffer.init();
         NineBlock::generate(crc32(uuid), icon.buffer);
-        menuItem.icon = icon.buffer;
     }
 }
 
@@ -306,3 +391,37 @@ void ELFMainMenuItem::exec()
 
     volume.exec();
 }
+
+void ELFMainMenuItem::MetadataCache::load()
+{
+    int result = cacheKey.read(records, sizeof records);
+    count = result > 0 ? result / sizeof records[0] : 0;
+}
+
+void ELFMainMenuItem::MetadataCache::store()
+{
+    STATIC_ASSERT(sizeof records <= StoredObject::MAX_SIZE);
+
+    if (count) {
+        cacheKey.write(records, count * sizeof records[0]);
+    } else {
+        cacheKey.erase();
+    }
+}
+
+const ELFMainMenuItem::CacheRecord *ELFMainMenuItem::MetadataCache::find(_SYSVolumeHandle volume) const
+{
+    for (unsigned i = 0; i != count; ++i) {
+        if (records[i].volume == volume)
+            return &records[i];
+    }
+    return 0;
+}
+
+bool ELFMainMenuItem::MetadataCache::operator== (const MetadataCache &other) const
+{
+    return count == other.count &&
+        !memcmp(reinterpret_cast<const uint8_t*>(records),
+                reinterpret_cast<const uint8_t*>(other.records),
+                count * sizeof records[0]);
+}
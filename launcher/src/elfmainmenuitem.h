@@ -38,6 +38,7 @@ class ELFMainMenuItem : public MainMenuItem
 {
 public:
     virtual void getAssets(Sifteo::MenuItem &menuItem, Shared::AssetConfiguration &config);
+    virtual void loadIcon();
     virtual void bootstrap(Sifteo::CubeSet cubes, ProgressDelegate &progress);
 
     virtual Sifteo::Volume getVolume() {
@@ -85,6 +86,38 @@ private:
 
     static ELFMainMenuItem *firstRun;
 
+    /**
+     * Everything init() learns from a volume's metadata, saved in the
+     * launcher's own LFS so that we don't have to re-read it for every game
+     * each time the menu starts. Records are matched by volume handle and
+     * UUID, so a reinstalled game always misses.
+     */
+    struct CacheRecord {
+        _SYSVolumeHandle volume;
+        Sifteo::MappedVolume::UUID uuid;
+        _SYSMetadataCubeRange cubeRange;
+        uint8_t numAssetSlots;
+        uint8_t flags;
+    };
+
+    enum CacheFlags {
+        F_USABLE        = 1 << 0,
+        F_VALID_ICON    = 1 << 1,
+        F_FIRST_RUN     = 1 << 2,
+    };
+
+    struct MetadataCache {
+        unsigned count;
+        CacheRecord records[MAX_INSTANCES];
+
+        void load();
+        void store();
+        const CacheRecord *find(_SYSVolumeHandle volume) const;
+        bool operator== (const MetadataCache &other) const;
+    };
+
+    static const Sifteo::StoredObject cacheKey;
+
     struct SlotInfo {
         unsigned totalBytes;
         unsigned totalTiles;
@@ -95,6 +128,7 @@ private:
     CubeRange cubeRange;
     uint8_t numAssetSlots;
     bool hasValidIcon;
+    bool iconLoaded;
     Sifteo::MappedVolume::UUID uuid;
     Sifteo::Volume volume;
 
@@ -116,7 +150,12 @@ private:
      * an ELFMainMenuItem for the volume, or 'false' if it should not appear
      * on the main menu.
      */
-    bool init(Sifteo::Volume volume, bool *outFirstRun=0);
+    bool init(Sifteo::Volume volume, bool *outFirstRun=0, const MetadataCache *cache=0);
+
+    /**
+     * Slow path for init(), parses the volume's metadata into 'record'.
+     */
+    void readMetadata(Sifteo::MappedVolume &map, CacheRecord &record);
 
     /**
      * Validate volume metadata that will be required later by getAssets()
@@ -131,4 +170,5 @@ private:
     static unsigned averageProgressBytes(const Sifteo::AssetLoader &loader, Sifteo::CubeSet cubes);
 
     static ELFMainMenuItem instances[MAX_INSTANCES];
+    static MetadataCache cache;
 };
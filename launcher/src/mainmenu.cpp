@@ -105,6 +105,9 @@ void MainMenu::initMenu(unsigned initialIndex, bool popUp, int panTarget)
 {
     ASSERT(items.count() > 0);
 
+    // The menu draws its first screen right away; have those icons ready.
+    loadIcons(initialIndex);
+
     // (Re)initialize the menu
     menu.init(Shared::video[mainCube], &menuAssets, menuItems);
     menu.setIconYOffset(8);
@@ -228,6 +231,7 @@ void MainMenu::eventLoop()
 
         // Keep running until a choice is made or the menu cube disconnects
         while (mainCube.isDefined() && menu.pollEvent(&e)) {
+            loadVisibleIcons();
             updateConnecting();
             updateSound();
             updateMusic();
@@ -782,6 +786,29 @@ void MainMenu::paint(unsigned index)
     items[index]->paint();
 }
 
+void MainMenu::loadIcons(unsigned index)
+{
+    // Load the icon at 'index' and its neighbours on either side
+    for (unsigned i = index ? index - 1 : 0, e = MIN(index + 2, items.count()); i < e; ++i) {
+        items[i]->loadIcon();
+    }
+}
+
+void MainMenu::loadVisibleIcons()
+{
+    /*
+     * Icons are only decompressed on demand. The menu never scrolls by
+     * more than one item per frame, so keeping the neighbours of every
+     * visible item loaded means nothing is drawn before it's ready.
+     */
+
+    for (unsigned i = 0, e = items.count(); i != e; ++i) {
+        if (menu.itemVisible(i)) {
+            loadIcons(i);
+        }
+    }
+}
+
 void MainMenu::prepareAssets()
 {
     /*
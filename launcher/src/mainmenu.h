@@ -113,6 +113,8 @@ private:
     void updateConnecting();
 
     void prepareAssets();
+    void loadIcons(unsigned index);
+    void loadVisibleIcons();
     
     bool areEnoughCubesConnected(unsigned index);
     void updateCubeRangeAlert();
@@ -50,6 +50,12 @@ public:
      */
     virtual void getAssets(Sifteo::MenuItem &assets, Shared::AssetConfiguration &config) = 0;
 
+    /**
+     * Make sure this item's icon is ready to draw. Items that fill in their
+     * icon lazily do it here, shortly before the menu scrolls them on-screen.
+     */
+    virtual void loadIcon() {}
+
     /**
      * Which Volume is associated with this item, if any?
      */
@@ -29,6 +29,7 @@
 #endif
 
 #include <sifteo/abi.h>
+#include <sifteo/arena.h>
 #include <sifteo/array.h>
 #include <sifteo/asset.h>
 #include <sifteo/audio.h>
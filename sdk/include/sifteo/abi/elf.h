@@ -59,6 +59,7 @@ extern "C" {
 // SVM-specific program header types
 #define _SYS_ELF_PT_METADATA        0x7000f001      // Metadata key/value dictionary
 #define _SYS_ELF_PT_LOAD_FASTLZ     0x7000f002      // PT_LOAD, with FastLZ (Level 1) compression
+#define _SYS_ELF_PT_LOAD_ZRUNS      0x7000f003      // PT_LOAD, zero runs skipped, FastLZ between them
 
 struct _SYSMetadataKey {
     uint16_t    stride;     // Byte offset from this value to the next
@@ -80,6 +81,7 @@ struct _SYSMetadataKey {
 #define _SYS_METADATA_CUBE_RANGE        0x0008  // _SYSMetadataCubeRange
 #define _SYS_METADATA_MIN_OS_VERSION    0x0009  // uint32_t minimum OS version required
 #define _SYS_METADATA_IS_DEMO_OF_STR    0x000a  // DNS-style string of the full version of this demo app
+#define _SYS_METADATA_STACK_BYTES       0x000b  // uint32_t worst-case user stack usage, 0 if unknown
 
 struct _SYSMetadataBootAsset {
     uint32_t        pHdr;           // Virtual address for _SYSAssetGroupHeader
@@ -42,6 +42,15 @@ typedef void (*_SYSCubeEvent)(void *context, _SYSCubeID cid);
 typedef void (*_SYSNeighborEvent)(void *context,
     _SYSCubeID c0, _SYSSideID s0, _SYSCubeID c1, _SYSSideID s1);
 
+/*
+ * Batched cube events, set via _SYS_setVectorBatched. One call covers
+ * every cube with this event pending, as a CLZ-ordered bit vector.
+ * Only the simple cube events (refresh, touch, accelerometer, battery,
+ * asset progress and asset done) can be batched.
+ */
+
+typedef void (*_SYSCubeBatchEvent)(void *context, _SYSCubeIDVector cubes);
+
 typedef enum {
     _SYS_NEIGHBOR_ADD = 0,
     _SYS_NEIGHBOR_REMOVE,
@@ -64,6 +73,8 @@ typedef enum {
     _SYS_BASE_USB_DISCONNECT,
     _SYS_BASE_USB_READ_AVAILABLE,
     _SYS_BASE_USB_WRITE_AVAILABLE,
+    _SYS_CUBE_ASSETPROGRESS,
+    _SYS_BASE_ASSETDONE,
 
     _SYS_NUM_VECTORS,   // Must be last
 } _SYSVectorID;
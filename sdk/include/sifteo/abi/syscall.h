@@ -73,6 +73,7 @@ void _SYS_yield(void) _SC(66);   /// Temporarily cede control to the firmware
 void _SYS_paint(void) _SC(67);   /// Enqueue a new rendering frame
 void _SYS_finish(void) _SC(68);  /// Wait for enqueued frames to finish
 void _SYS_paintUnlimited(void) _SC(69);
+void _SYS_setPaintPipeline(uint32_t depth, uint32_t frameIntervalUS) _SC(200);
 
 // Lightweight event logging support: string identifier plus 0-7 integers.
 // Tag bits: type [31:27], arity [26:24] param [23:0]
@@ -152,6 +153,8 @@ int32_t _SYS_tsini(uint32_t a) _SC(15);
 int32_t _SYS_tcosi(uint32_t a) _SC(181);
 uint32_t _SYS_tsinf(uint32_t a) _SC(182);
 uint32_t _SYS_tcosf(uint32_t a) _SC(183);
+void _SYS_tsincosi_array(struct _SYSInt2 *results, const int32_t *angles, uint32_t count) _SC(205);
+void _SYS_affine_transformi(const struct _SYSAffineQ16 *m, const struct _SYSInt2 *src, struct _SYSInt2 *dest, uint32_t count) _SC(206);
 
 void _SYS_memset8(uint8_t *dest, uint8_t value, uint32_t count) _SC(44);
 void _SYS_memset16(uint16_t *dest, uint16_t value, uint32_t count) _SC(110);
@@ -178,6 +181,7 @@ uint32_t _SYS_prng_valueBounded(struct _SYSPseudoRandomState *state, uint32_t li
 int64_t _SYS_ticks_ns(void) _SC(21);  /// Return the monotonic system timer, in 64-bit integer nanoseconds
 
 void _SYS_setVector(_SYSVectorID vid, void *handler, void *context) _SC(122);
+void _SYS_setVectorBatched(_SYSVectorID vid, void *handler, void *context) _SC(207);
 void *_SYS_getVectorHandler(_SYSVectorID vid) _SC(123);
 void *_SYS_getVectorContext(_SYSVectorID vid) _SC(124);
 void _SYS_setGameMenuLabel(const char *label) _SC(174);
@@ -189,6 +193,7 @@ uint32_t _SYS_getNeighbors(_SYSCubeID cid) _SC(59);
 uint32_t _SYS_isTouching(_SYSCubeID cid) _SC(55);
 uint64_t _SYS_getCubeHWID(_SYSCubeID cid) _SC(130);
 void _SYS_setMotionBuffer(_SYSCubeID cid, _SYSMotionBuffer *mbuf) _SC(175);
+void _SYS_setAccelThreshold(_SYSCubeID cid, uint32_t threshold) _SC(204);
 
 // Battery information
 uint32_t _SYS_cubeBatteryLevel(_SYSCubeID cid) _SC(129);
@@ -198,6 +203,8 @@ uint32_t _SYS_sysBatteryLevel() _SC(173);
 uint32_t _SYS_getConnectedCubes() _SC(16);
 void _SYS_setCubeRange(uint32_t minimum, uint32_t maximum) _SC(125);
 void _SYS_unpair(_SYSCubeID cid) _SC(126);
+uint32_t _SYS_cubeLinkStats(_SYSCubeID cid, struct _SYSCubeLinkStats *buffer, uint32_t bufferSize) _SC(199);
+uint32_t _SYS_cubeFrameStats(_SYSCubeID cid, struct _SYSCubeFrameStats *buffer, uint32_t bufferSize) _SC(201);
 
 // Version
 uint32_t _SYS_version(void) _SC(186);
@@ -232,6 +239,7 @@ void _SYS_asset_loadCancel(struct _SYSAssetLoader *loader, _SYSCubeIDVector cv)
 
 // Video buffers
 void _SYS_setVideoBuffer(_SYSCubeID cid, struct _SYSVideoBuffer *vbuf) _SC(61);
+void _SYS_setVideoShadow(_SYSCubeID cid, struct _SYSVideoShadow *shadow) _SC(202);
 void _SYS_vbuf_init(struct _SYSVideoBuffer *vbuf) _SC(62);
 void _SYS_vbuf_lock(struct _SYSVideoBuffer *vbuf, uint16_t addr) _SC(149);
 void _SYS_vbuf_unlock(struct _SYSVideoBuffer *vbuf) _SC(150);
@@ -245,6 +253,8 @@ void _SYS_vbuf_seqi(struct _SYSVideoBuffer *vbuf, uint16_t addr, uint16_t index,
 void _SYS_vbuf_write(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_t *src, uint16_t count) _SC(37);
 void _SYS_vbuf_writei(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_t *src, uint16_t offset, uint16_t count) _SC(153);
 void _SYS_vbuf_wrect(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_t *src, uint16_t offset, uint16_t count, uint16_t lines, uint16_t src_stride, uint16_t addr_stride) _SC(154);
+void _SYS_vbuf_batch(struct _SYSVideoBuffer *vbuf, const struct _SYSVideoOp *ops, uint16_t count) _SC(203);
+void _SYS_vbuf_setChangeLog(struct _SYSVideoBuffer *vbuf, struct _SYSVideoChangeLog *log) _SC(209);
 void _SYS_vbuf_spr_resize(struct _SYSVideoBuffer *vbuf, unsigned id, unsigned width, unsigned height) _SC(155);
 void _SYS_vbuf_spr_move(struct _SYSVideoBuffer *vbuf, unsigned id, int x, int y) _SC(156);
 
@@ -274,6 +284,7 @@ int32_t _SYS_fs_objectWrite(unsigned key, const uint8_t *data, unsigned dataSize
 uint32_t _SYS_fs_runningVolume() _SC(168);
 uint32_t _SYS_fs_previousVolume() _SC(171);
 uint32_t _SYS_fs_info(_SYSFilesystemInfo *buffer, uint32_t bufferSize) _SC(172);
+uint32_t _SYS_fs_objectPrefetch(const uint8_t *keys, uint32_t count, _SYSVolumeHandle parent) _SC(208);
 
 // Bluetooth
 uint32_t _SYS_bt_isAvailable() _SC(188);
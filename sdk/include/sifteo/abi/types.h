@@ -86,6 +86,18 @@ struct _SYSInt3 {
     int32_t x, y, z;
 };
 
+/*
+ * 2D affine transform in Q16 fixed-point. Same member order as
+ * Sifteo::AffineMatrix:
+ *
+ *      [ xx  yx  cx ]
+ *      [ xy  yy  cy ]
+ */
+
+struct _SYSAffineQ16 {
+    int32_t cx, cy, xx, xy, yx, yy;
+};
+
 union _SYSByte4 {
     struct {
         int8_t x, y, z, w;
@@ -201,6 +213,41 @@ struct _SYSPseudoRandomState {
 #define _SYS_HWID_BITS          64
 #define _SYS_INVALID_HWID       ((uint64_t)-1)
 
+/*
+ * Radio link statistics for one cube. Counters run from the time the
+ * cube connected; the rate and latency are running averages for the
+ * channel it's currently on.
+ */
+
+struct _SYSCubeLinkStats {
+    uint32_t packets;           /// Packets acknowledged by the cube
+    uint32_t retries;           /// Hardware retries spent on those packets
+    uint32_t hops;              /// Number of channel hops
+    uint16_t retryRate;         /// Recent retries per packet, 8.8 fixed point
+    uint16_t latencyUS;         /// Recent transmit-to-ACK time, in microseconds
+    uint8_t channel;            /// Current RF channel
+    uint8_t reserved[3];
+};
+
+/*
+ * Rendering statistics for one cube. Frame latency is measured from a
+ * _SYS_paint() that queued a frame to the cube's acknowledgment of it,
+ * and summarized by percentiles over a decaying histogram. Radio retry
+ * statistics are separate, in _SYSCubeLinkStats.
+ */
+
+#define _SYS_FRAME_LATENCY_P50  0
+#define _SYS_FRAME_LATENCY_P90  1
+#define _SYS_FRAME_LATENCY_P99  2
+
+struct _SYSCubeFrameStats {
+    uint32_t frames;            /// Frames acknowledged since the cube connected
+    uint16_t latencyUS[3];      /// Frame latency percentiles, _SYS_FRAME_LATENCY_*
+    uint16_t framePeriodUS;     /// Recent time per frame, while frames are pending
+    uint16_t packetsPerFrame;   /// Recent radio packets per frame, 8.8 fixed point
+    uint16_t packetRate;        /// Recent radio packets per second
+};
+
 /*
  * Filesystem
  */
@@ -276,6 +323,11 @@ struct _SYSBluetoothCounters {
     uint32_t rxBytes;
     uint32_t txBytes;
     uint32_t rxUserDropped;
+    uint32_t rxUserPackets;     /// User packets delivered to the receive queue
+    uint32_t rxUserBytes;       /// Payload bytes in rxUserPackets
+    uint32_t txUserPackets;     /// User packets taken from the send queue
+    uint32_t txUserBytes;       /// Payload bytes in txUserPackets
+    uint32_t txCreditStalls;    /// Times data was waiting but the radio had no buffers
 };
 
 /*
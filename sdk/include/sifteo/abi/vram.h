@@ -58,13 +58,14 @@ extern "C" {
 #define _SYS_VRAM_BG1_TILES     144     // Total number of opaque tiles in BG1
 #define _SYS_VRAM_BG2_WIDTH     16      // Width/height of BG2 tile grid
 #define _SYS_VRAM_SPRITES       8       // Total number of linear sprites
+#define _SYS_VRAM_PATCH_PIXELS  180     // Total number of RGB565 pixels in the BG0_PATCH patch
 #define _SYS_SPRITES_PER_LINE   4       // Maximum visible sprites per scanline
 #define _SYS_CHROMA_KEY         0x4f    // Chroma key MSB
 #define _SYS_CKEY_BIT_EOL       0x40    // Chroma-key special bit, end-of-line
 
 // Bits for 'flags'
 
-#define _SYS_VF_RESERVED        0x01    // Reserved, must be zero
+#define _SYS_VF_PARTIAL         0x01    // Window also selects which mode lines to draw
 #define _SYS_VF_TOGGLE          0x02    // Toggle bit, to trigger a new frame render
 #define _SYS_VF_SYNC            0x04    // Sync with LCD vertical refresh
 #define _SYS_VF_CONTINUOUS      0x08    // Render continuously, without waiting for toggle
@@ -88,6 +89,7 @@ extern "C" {
 #define _SYS_VM_BG0_SPR_BG1     0x20    // BG0, multiple linear sprites, then BG1
 #define _SYS_VM_BG2             0x24    // Background BG2: 16x16 grid with affine transform
 #define _SYS_VM_STAMP           0x28    // Reconfigurable 16-color framebuffer with transparency
+#define _SYS_VM_BG0_PATCH       0x2c    // BG0, plus a small direct-color patch
 #define _SYS_VM_SLEEP           0x3c    // Puts cube to sleep after fading out display
     
 // Important VRAM addresses
@@ -107,6 +109,8 @@ extern "C" {
 #define _SYS_VA_MODE            0x3fe
 #define _SYS_VA_FLAGS           0x3ff
 #define _SYS_VA_STAMP_PITCH     0x320
+#define _SYS_VA_PATCH           0x288
+#define _SYS_VA_PATCH_X         0x3f0
 
 struct _SYSSpriteInfo {
     /*
@@ -168,6 +172,15 @@ union _SYSVideoRAM {
         struct _SYSAffine bg2_affine;   // 0x200 - 0x20b
         uint16_t bg2_border;            // 0x20c - 0x20d
     };
+
+    struct {
+        uint16_t patch_bg0_tiles[324];  // 0x000 - 0x287
+        uint16_t patch[180];            // 0x288 - 0x3ef
+        uint8_t patch_x;                // 0x3f0   0 <= x <= 127
+        uint8_t patch_y;                // 0x3f1   0 <= y <= 127
+        uint8_t patch_width;            // 0x3f2   x + width <= 128
+        uint8_t patch_height;           // 0x3f3   width * height <= 180
+    };
 };
 
 /*
@@ -259,11 +272,20 @@ union _SYSVideoRAM {
  * without making any VRAM changes.
  *
  * This flag is set automatically by _SYS_vbuf_lock().
+ *
+ * By default, _SYS_paint() only lets a cube fall a few frames behind
+ * before it blocks, and it paces frames at a fixed maximum rate. A
+ * game can use _SYS_setPaintPipeline() to choose how many frames may be
+ * queued up per cube (up to _SYS_MAX_PAINT_PIPELINE), and a target frame
+ * interval. With a pipeline, frames are paced to the slower of that
+ * interval and the rate at which each cube is actually ACKing frames.
  */
 
 #define _SYS_VBF_NEED_PAINT     (1 << 0)        // Request a paint operation
 // All other bits are reserved for system use.
 
+#define _SYS_MAX_PAINT_PIPELINE 5               // Max frames queued per cube
+
 struct _SYSVideoBuffer {
     uint32_t flags;             /// INOUT  _SYS_VBF_* bits
     uint32_t lock;              /// OUT    Lock map, at a resolution of 1 bit per 16 words
@@ -285,6 +307,81 @@ struct _SYSAttachedVideoBuffer {
     struct _SYSVideoBuffer vbuf;
 };
 
+/*
+ * Optional record of what a cube's VRAM actually holds, attached with
+ * _SYS_setVideoShadow(). While one is attached, any dirty word that
+ * already matches the cube's copy is marked clean without being sent.
+ * This helps games that redraw every frame from scratch, since words
+ * that get rewritten with their old values cost no radio bandwidth.
+ *
+ * The system owns the contents. Userspace only provides the memory,
+ * and must not modify it while it's attached. Words are only trusted
+ * once their 'valid' bit is set, which happens when they're sent.
+ */
+
+struct _SYSVideoShadow {
+    uint32_t valid[16];         /// OUT    Words whose value on the cube is known, 1 bit per word
+    union _SYSVideoRAM vram;    /// OUT    Cube's VRAM contents, for valid words
+};
+
+/*
+ * Optional log of VRAM changes, attached to a _SYSVideoBuffer with
+ * _SYS_vbuf_setChangeLog(). While one is attached, every word that a
+ * _SYS_vbuf_* call changes is also appended here, as a packed 32-bit
+ * (address, value) record. The system visits logged words in the order
+ * they were written, sending the 32-word change map group around each,
+ * without scanning the change maps to find them. This suits games that
+ * update a few scattered words each frame.
+ *
+ * The change maps stay authoritative, and the lock protocol above is
+ * unchanged. A record is only a hint that its word may need sending.
+ * If the log overflows, or VRAM is modified without a syscall, the
+ * system falls back to scanning the change maps.
+ *
+ * The system owns the contents. Userspace only provides the memory,
+ * and must not modify it while it's attached.
+ */
+
+#define _SYS_VIDEO_CHANGE_LOG_SIZE  64      // Records per log, power of two
+
+struct _SYSVideoChange {
+    uint16_t addr;              /// Word address
+    uint16_t word;              /// Value it was changed to
+};
+
+struct _SYSVideoChangeLog {
+    uint32_t head;              /// OUT    Records written, free-running
+    uint32_t tail;              /// OUT    Records consumed, free-running
+    struct _SYSVideoChange records[_SYS_VIDEO_CHANGE_LOG_SIZE];
+};
+
+/*
+ * A list of VRAM updates for _SYS_vbuf_batch(), which applies them all in
+ * one syscall. Each op covers 'count' consecutive words starting at 'addr',
+ * wrapping at the end of VRAM, with the same meaning as the equivalent
+ * single-op syscall:
+ *
+ *   _SYS_VOP_FILL     Fill with 'arg'                    (_SYS_vbuf_fill)
+ *   _SYS_VOP_SEQI     7:7 tile indices 'arg', 'arg'+1... (_SYS_vbuf_seqi)
+ *   _SYS_VOP_WRITE    Copy words from 'pSrc'             (_SYS_vbuf_write)
+ *   _SYS_VOP_WRITEI   Tile indices 'pSrc' plus 'arg'     (_SYS_vbuf_writei)
+ */
+
+enum _SYSVideoOpCode {
+    _SYS_VOP_FILL = 0,
+    _SYS_VOP_SEQI,
+    _SYS_VOP_WRITE,
+    _SYS_VOP_WRITEI
+};
+
+struct _SYSVideoOp {
+    uint16_t code;              /// _SYS_VOP_*
+    uint16_t addr;              /// First VRAM word address
+    uint16_t count;             /// Number of words
+    uint16_t arg;               /// Fill word, first tile index, or tile offset
+    uint32_t pSrc;              /// Source words in RAM or flash, for WRITE/WRITEI
+};
+
 /*
  * Tiles in the _SYSVideoBuffer are typically encoded in 7:7 format, in
  * which a 14-bit tile ID is packed into the upper 7 bits of each byte
@@ -0,0 +1,322 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo SDK
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+#ifdef NOT_USERSPACE
+#   error This is a userspace-only header, not allowed by the current build.
+#endif
+
+#include <sifteo/abi.h>
+#include <sifteo/macros.h>
+
+namespace Sifteo {
+
+/**
+ * @defgroup arena Arena
+ *
+ * @brief Fixed-size allocators for user RAM
+ *
+ * Games have no heap, so anything that isn't a global or a local variable
+ * normally has to be sized statically for its worst case. The allocators
+ * here let you set aside one block of RAM and carve it up at runtime:
+ *
+ * - An Arena is a bump allocator. Allocation is a pointer increment, and
+ *   memory is only ever released all at once, either with reset() or by
+ *   rewinding to an earlier mark(). An ArenaScope does the rewinding
+ *   automatically, which makes it easy to keep per-frame scratch data in
+ *   one shared arena.
+ *
+ * - A Pool hands out and takes back individual objects of a single type,
+ *   in any order.
+ *
+ * Both return raw, uninitialized storage. Nothing here calls constructors
+ * or destructors, so objects which need setup must be initialized
+ * explicitly. For example, Array::clear() and TileBuffer::init():
+ *
+ * @code
+ * Arena<4096> scratch;
+ *
+ * void drawFrame(CubeID cube)
+ * {
+ *     ArenaScope<4096> frame(scratch);
+ *
+ *     Array<Int2, 64> *points = scratch.alloc< Array<Int2, 64> >();
+ *     points->clear();
+ *
+ *     TileBuffer<8, 8> *buffer = scratch.alloc< TileBuffer<8, 8> >();
+ *     buffer->init();
+ *     buffer->setCube(cube);
+ *
+ *     // ... everything above is released when 'frame' goes out of scope
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ * @brief A bump allocator over a fixed block of RAM
+ *
+ * The template parameter is the size of the arena, in bytes. Allocations
+ * are rounded up to a multiple of their alignment, and an allocation that
+ * doesn't fit returns a null pointer. Each allocation is O(1), and so is
+ * releasing any number of them with reset() or rewind().
+ */
+template <unsigned tBytes>
+class Arena {
+public:
+    /// Opaque position in the arena, returned by mark()
+    typedef unsigned Marker;
+
+    /// Initialize a new, empty arena
+    Arena() {
+        reset();
+    }
+
+    /// Retrieve the total size of this arena in bytes, constant at compile-time
+    static unsigned capacity() {
+        return tBytes;
+    }
+
+    /// How many bytes are currently allocated, including alignment padding?
+    unsigned used() const {
+        return top;
+    }
+
+    /// How many bytes are still available, ignoring alignment?
+    unsigned remaining() const {
+        return tBytes - top;
+    }
+
+    /// Release every allocation at once
+    void reset() {
+        top = 0;
+    }
+
+    /// Remember the current allocation position, for a later rewind()
+    Marker mark() const {
+        return top;
+    }
+
+    /**
+     * @brief Release everything allocated since a mark()
+     *
+     * Markers must be rewound in LIFO order. Rewinding to a marker that
+     * is newer than the current position is an error.
+     */
+    void rewind(Marker m) {
+        ASSERT(m <= top);
+        top = m;
+    }
+
+    /**
+     * @brief Allocate 'bytes' of uninitialized memory
+     *
+     * The result is aligned to 'align' bytes, which must be a power of two
+     * no larger than 8. Returns zero if the arena doesn't have enough space
+     * left, in which case the arena is not modified.
+     */
+    void *alloc(unsigned bytes, unsigned align = 4) {
+        ASSERT(align && align <= 8 && (align & (align - 1)) == 0);
+
+        unsigned offset = (top + align - 1) & ~(align - 1);
+        if (offset > tBytes || bytes > tBytes - offset)
+            return 0;
+
+        top = offset + bytes;
+        return reinterpret_cast<uint8_t*>(storage) + offset;
+    }
+
+    /// Allocate uninitialized space for a single object of type T
+    template <typename T>
+    T *alloc() {
+        return static_cast<T*>(alloc(sizeof(T), __alignof__(T)));
+    }
+
+    /// Allocate uninitialized space for an array of 'count' objects of type T
+    template <typename T>
+    T *allocArray(unsigned count) {
+        if (count > tBytes / sizeof(T))
+            return 0;
+        return static_cast<T*>(alloc(sizeof(T) * count, __alignof__(T)));
+    }
+
+    /// Does this pointer lie within the arena's storage?
+    bool contains(const void *p) const {
+        const uint8_t *b = reinterpret_cast<const uint8_t*>(storage);
+        const uint8_t *q = static_cast<const uint8_t*>(p);
+        return q >= b && q < b + tBytes;
+    }
+
+private:
+    unsigned top;
+    uint64_t storage[(tBytes + 7) / 8];
+};
+
+/**
+ * @brief Frame-scoped scratch allocations
+ *
+ * Records the arena's position when constructed, and rewinds to it when
+ * destroyed. Everything allocated from the arena while the scope is alive
+ * is released together at the end of the scope, so a single arena can
+ * provide temporary storage for each frame, or for each step of a
+ * longer computation.
+ *
+ * Scopes on the same arena must nest.
+ */
+template <unsigned tBytes>
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena<tBytes> &arena)
+        : arena(arena), marker(arena.mark()) {}
+
+    ~ArenaScope() {
+        arena.rewind(marker);
+    }
+
+private:
+    Arena<tBytes> &arena;
+    typename Arena<tBytes>::Marker marker;
+
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+};
+
+/**
+ * @brief A fixed-capacity pool of objects of a single type
+ *
+ * Objects may be allocated and freed in any order, each in constant time.
+ * Free slots are kept on an intrusive list, threaded through the unused
+ * storage itself, so the pool needs no separate bookkeeping per object. Slots that have
+ * never been allocated aren't on the list at all; construction is O(1)
+ * regardless of capacity.
+ *
+ * Returned objects are uninitialized.
+ */
+template <typename T, unsigned tCapacity>
+class Pool {
+public:
+    /// Initialize a new pool, with every slot free
+    Pool() {
+        reset();
+    }
+
+    /// Retrieve the capacity of this pool, always constant at compile-time.
+    static unsigned capacity() {
+        return tCapacity;
+    }
+
+    /// How many objects are currently allocated?
+    unsigned count() const {
+        return numAllocated;
+    }
+
+    /// Are all objects free?
+    bool empty() const {
+        return numAllocated == 0;
+    }
+
+    /// Are all objects allocated?
+    bool full() const {
+        return numAllocated == tCapacity;
+    }
+
+    /// Free every object at once
+    void reset() {
+        freeList = 0;
+        numFresh = 0;
+        numAllocated = 0;
+    }
+
+    /**
+     * @brief Allocate an uninitialized object
+     *
+     * Returns zero if every object in the pool is in use.
+     */
+    T *alloc() {
+        Slot *s;
+
+        if (freeList) {
+            s = freeList;
+            freeList = s->next;
+        } else if (numFresh < tCapacity) {
+            s = &slots[numFresh++];
+        } else {
+            return 0;
+        }
+
+        numAllocated++;
+        return reinterpret_cast<T*>(s);
+    }
+
+    /**
+     * @brief Return an object to the pool
+     *
+     * The pointer must have come from alloc() on this same pool, and must
+     * not already be free.
+     */
+    void free(T *p) {
+        ASSERT(contains(p));
+        ASSERT(numAllocated > 0);
+
+        Slot *s = reinterpret_cast<Slot*>(p);
+        s->next = freeList;
+        freeList = s;
+        numAllocated--;
+    }
+
+    /// Does this pointer refer to one of the pool's objects?
+    bool contains(const T *p) const {
+        const Slot *s = reinterpret_cast<const Slot*>(p);
+        return s >= &slots[0] && s < &slots[tCapacity]
+            && (reinterpret_cast<const uint8_t*>(s) -
+                reinterpret_cast<const uint8_t*>(&slots[0])) % sizeof(Slot) == 0;
+    }
+
+    /// Index of an object within the pool, in the range [0, capacity)
+    unsigned indexOf(const T *p) const {
+        ASSERT(contains(p));
+        return reinterpret_cast<const Slot*>(p) - &slots[0];
+    }
+
+private:
+    union Slot {
+        Slot *next;
+        uint8_t bytes[sizeof(T)];
+        uint64_t align;
+    };
+
+    Slot *freeList;
+    unsigned numFresh;
+    unsigned numAllocated;
+    Slot slots[tCapacity];
+};
+
+/**
+ * @} endgroup arena
+ */
+
+}   // namespace Sifteo
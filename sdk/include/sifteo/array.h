@@ -177,6 +177,38 @@ public:
         ASSERT(count() > 0);
         numItems--;
     }
+
+    /**
+     * @brief Remove a specific element, by index, without preserving order.
+     *
+     * The last element is moved into the hole, so this is constant-time
+     * no matter where the element is. Like erase(), NOT_FOUND is ignored.
+     */
+    void erase_unordered(unsigned index) {
+        if (index == NOT_FOUND)
+            return;
+
+        erase_unordered(items + index);
+    }
+
+    /// Remove the element at iterator 'item', moving the last element into its place.
+    void erase_unordered(iterator item) {
+        ASSERT(item >= begin() && item < end());
+        numItems--;
+        if (item != end())
+            *item = items[numItems];
+    }
+
+    /**
+     * @brief Copy 'n' items from 'src' to the end of the array.
+     *
+     * This is a single memcpy(), rather than one push_back() per item.
+     */
+    void append(const T *src, unsigned n) {
+        ASSERT(count() + n <= tCapacity);
+        memcpy((uint8_t*)end(), (const uint8_t*)src, n * sizeof(T));
+        numItems += n;
+    }
     
     /// Return an iterator pointing to the first slot in the array.
     iterator begin() {
@@ -310,6 +342,56 @@ public:
         _SYS_memset32(words, 0, NUM_WORDS);
     }
 
+    /**
+     * @brief Mark (set to 1) a range of bits.
+     *
+     * This is a half-open interval. All bits >= 'begin' and < 'end' are
+     * marked. Only the words that overlap the range are touched.
+     */
+    void mark(unsigned begin, unsigned end)
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+
+        ASSERT(begin <= end);
+        ASSERT(end <= tSize);
+
+        if (NUM_WORDS > 1) {
+            if (begin == end)
+                return;
+            for (unsigned w = begin >> 5, last = (end - 1) >> 5; w <= last; w++) {
+                int offset = w << 5;
+                words[w] |= range(begin - offset) & ~range(end - offset);
+            }
+        } else {
+            words[0] |= range(begin) & ~range(end);
+        }
+    }
+
+    /**
+     * @brief Clear (set to 0) a range of bits.
+     *
+     * This is a half-open interval. All bits >= 'begin' and < 'end' are
+     * cleared. Only the words that overlap the range are touched.
+     */
+    void clear(unsigned begin, unsigned end)
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+
+        ASSERT(begin <= end);
+        ASSERT(end <= tSize);
+
+        if (NUM_WORDS > 1) {
+            if (begin == end)
+                return;
+            for (unsigned w = begin >> 5, last = (end - 1) >> 5; w <= last; w++) {
+                int offset = w << 5;
+                words[w] &= ~(range(begin - offset) & ~range(end - offset));
+            }
+        } else {
+            words[0] &= ~(range(begin) & ~range(end));
+        }
+    }
+
     /// Is a particular bit marked?
     bool test(unsigned index) const
     {
@@ -398,6 +480,43 @@ public:
         return false;
     }
 
+    /**
+     * @brief Find the lowest marked bit within a range.
+     *
+     * Like findFirst(), but only bits >= 'begin' and < 'end' are
+     * considered. Words outside the range are never read, so this is a
+     * cheap way to resume a search or to scan one part of a large array.
+     */
+    bool findFirst(unsigned &index, unsigned begin, unsigned end) const
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+
+        ASSERT(begin <= end);
+        ASSERT(end <= tSize);
+
+        if (NUM_WORDS > 1) {
+            if (begin == end)
+                return false;
+            for (unsigned w = begin >> 5, last = (end - 1) >> 5; w <= last; w++) {
+                int offset = w << 5;
+                uint32_t v = words[w] & range(begin - offset) & ~range(end - offset);
+                if (v) {
+                    index = (w << 5) | clz(v);
+                    ASSERT(index < tSize);
+                    return true;
+                }
+            }
+        } else if (NUM_WORDS == 1) {
+            uint32_t v = words[0] & range(begin) & ~range(end);
+            if (v) {
+                index = clz(v);
+                ASSERT(index < tSize);
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * @brief Find and clear the lowest marked bit.
      *
@@ -588,6 +707,61 @@ public:
         return result;
     }
 
+    /// In-place bitwise AND with another BitArray of the same size
+    BitArray<tSize> &operator &= (const BitArray<tSize> &other)
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-compare"
+        for (unsigned w = 0; w < NUM_WORDS; w++)
+            words[w] &= other.words[w];
+        #pragma clang diagnostic pop
+        return *this;
+    }
+
+    /// In-place bitwise OR with another BitArray of the same size
+    BitArray<tSize> &operator |= (const BitArray<tSize> &other)
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-compare"
+        for (unsigned w = 0; w < NUM_WORDS; w++)
+            words[w] |= other.words[w];
+        #pragma clang diagnostic pop
+        return *this;
+    }
+
+    /// In-place bitwise XOR with another BitArray of the same size
+    BitArray<tSize> &operator ^= (const BitArray<tSize> &other)
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-compare"
+        for (unsigned w = 0; w < NUM_WORDS; w++)
+            words[w] ^= other.words[w];
+        #pragma clang diagnostic pop
+        return *this;
+    }
+
+    /// Are the same bits marked in both arrays?
+    bool operator == (const BitArray<tSize> &other) const
+    {
+        const unsigned NUM_WORDS = (tSize + 31) / 32;
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-compare"
+        for (unsigned w = 0; w < NUM_WORDS; w++)
+            if (words[w] != other.words[w])
+                return false;
+        #pragma clang diagnostic pop
+        return true;
+    }
+
+    /// Are any bits different between the two arrays?
+    bool operator != (const BitArray<tSize> &other) const
+    {
+        return !(*this == other);
+    }
+
     /// Negate a BitArray, returning a new array in which each bit is inverted
     BitArray<tSize> operator ~ () const
     {
@@ -193,6 +193,36 @@ public:
  * loader.finish();
  * \endcode
  *
+ * <b>Loading in the Background</b>
+ *
+ * Rather than blocking in finish(), a game can keep painting while
+ * the load runs, and find out it's done via Events::assetDone.
+ * Events::cubeAssetProgress fires as data is sent to each cube, which
+ * is a convenient point to update a progress bar.
+ *
+ * \code
+ * static bool loading;
+ *
+ * void onAssetDone() {
+ *     loading = false;
+ * }
+ *
+ * void onProgress(void*, unsigned cube) {
+ *     drawProgressBar(cube, loader.cubeProgress(cube, 128));
+ * }
+ *
+ * loading = true;
+ * Events::assetDone.set(onAssetDone);
+ * Events::cubeAssetProgress.set(onProgress);
+ * loader.start(config, CubeSet::connected());
+ *
+ * while (loading) {
+ *     animate();
+ *     System::paint();
+ * }
+ * loader.finish();
+ * \endcode
+ *
  * <b>Multiple AssetConfiguration Example</b>
  * \code
  * #include "assets.gen.h"
@@ -617,6 +617,37 @@ struct BluetoothCounters
     uint32_t userPacketsDropped() {
         return current.rxUserDropped - base.rxUserDropped;
     }
+
+    /// User-defined packets delivered to a BluetoothPipe
+    uint32_t receivedUserPackets() {
+        return current.rxUserPackets - base.rxUserPackets;
+    }
+
+    /// Payload bytes in receivedUserPackets()
+    uint32_t receivedUserBytes() {
+        return current.rxUserBytes - base.rxUserBytes;
+    }
+
+    /// User-defined packets sent from a BluetoothPipe
+    uint32_t sentUserPackets() {
+        return current.txUserPackets - base.txUserPackets;
+    }
+
+    /// Payload bytes in sentUserPackets()
+    uint32_t sentUserBytes() {
+        return current.txUserBytes - base.txUserBytes;
+    }
+
+    /**
+     * @brief Times that sending stalled on flow control
+     *
+     * Counts the times the system had packets ready to send, but had to
+     * wait for the Bluetooth radio to free up a transmit buffer. If this
+     * grows quickly, the link rather than your app is limiting throughput.
+     */
+    uint32_t sendStalls() {
+        return current.txCreditStalls - base.txCreditStalls;
+    }
 };
 
 
@@ -184,6 +184,16 @@ struct CubeID {
         _SYS_setVideoBuffer(*this, 0);
     }
 
+    /**
+     * @brief Detach any VideoShadow which was previously attached to this cube.
+     *
+     * VRAM updates are sent in full again from this point on.
+     */
+    void detachVideoShadow() const {
+        ASSERT(sys < NUM_SLOTS);
+        _SYS_setVideoShadow(*this, 0);
+    }
+
     /**
      * @brief Detach any motion buffer which was previously attached to this cube.
      *
@@ -196,6 +206,26 @@ struct CubeID {
         _SYS_setMotionBuffer(*this, 0);
     }
 
+    /**
+     * @brief Change how far the accelerometer must move before this cube
+     * reports it.
+     *
+     * Each axis is only updated once it moves by more than 'threshold'
+     * counts, out of the full range of 256. Ignoring small changes keeps
+     * sensor noise from using up radio time, and from producing a stream
+     * of accelerometer events. The default is 1. Zero reports every
+     * change. Cubes with a motion buffer attached always report every
+     * change, regardless of this setting.
+     *
+     * The threshold must be no larger than 127. It resets to the default
+     * when a cube reconnects.
+     */
+    void setAccelThreshold(unsigned threshold) const {
+        ASSERT(sys < NUM_SLOTS);
+        ASSERT(threshold <= 127);
+        _SYS_setAccelThreshold(*this, threshold);
+    }
+
     /**
      * @brief Get this cube's battery level.
      *
@@ -215,6 +245,43 @@ struct CubeID {
         return _SYS_cubeBatteryLevel(*this) / float(_SYS_BATTERY_MAX);
     }
 
+    /**
+     * @brief Get statistics about this cube's radio link.
+     *
+     * The packet, retry, and hop counters start at zero when the cube
+     * connects. The retry rate and latency are running averages for
+     * the channel the cube is using right now; the system hops to a new
+     * channel on its own when these get too high.
+     *
+     * This is intended for diagnostics. Games don't need to act on it.
+     */
+    _SYSCubeLinkStats linkStats() const {
+        ASSERT(sys < NUM_SLOTS);
+        _SYSCubeLinkStats stats;
+        _SYS_cubeLinkStats(*this, &stats, sizeof stats);
+        return stats;
+    }
+
+    /**
+     * @brief Get statistics about how quickly this cube is rendering.
+     *
+     * The latency percentiles describe how long recent frames took to
+     * go from System::paint() to being acknowledged by the cube. Along
+     * with the radio packet rate and packets per frame, these let a game
+     * tell when it's asking for more than a cube can keep up with, and
+     * scale back its visual effects.
+     *
+     * Index latencyUS[] with _SYS_FRAME_LATENCY_P50, _SYS_FRAME_LATENCY_P90,
+     * or _SYS_FRAME_LATENCY_P99. Latencies are zero until at least one
+     * frame has been measured.
+     */
+    _SYSCubeFrameStats frameStats() const {
+        ASSERT(sys < NUM_SLOTS);
+        _SYSCubeFrameStats stats;
+        _SYS_cubeFrameStats(*this, &stats, sizeof stats);
+        return stats;
+    }
+
     /**
      * @brief Remove the persistent pairing association between this cube and the current Base.
      *
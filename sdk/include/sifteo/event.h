@@ -114,6 +114,54 @@ struct EventVector {
         _SYS_setVector(tID, u.pVoid, (void*) cls);
     }
 
+    /**
+     * @brief Set this Vector to a batched handler, with context pointer
+     *
+     * Batched handlers are only available for the simple per-cube events:
+     * cubeRefresh, cubeTouch, cubeAccelChange, cubeBatteryLevelChange,
+     * cubeAssetProgress and cubeAssetDone. Other vectors will fault.
+     *
+     * Instead of one call per cube, the handler is called once with every
+     * cube that has this event pending:
+     *
+     *   void handler(ContextType c, unsigned cubes);
+     *
+     * 'cubes' is a _SYSCubeIDVector. Use CubeSet::setMask() to iterate
+     * over it. When many cubes report at once, such as accelerometer
+     * changes during a shake, this saves a handler call for every cube
+     * after the first.
+     */
+    template <typename tContext>
+    void setBatched(void (*handler)(tContext, unsigned), tContext context) const {
+        _SYS_setVectorBatched(tID, (void*) handler, reinterpret_cast<void*>(context));
+    }
+
+    /**
+     * @brief Set this Vector to a batched bare function
+     *
+     * Like setBatched() with a context, but for a function which takes
+     * a dummy void* placeholder argument:
+     *
+     *   void handler(void*, unsigned cubes);
+     */
+    void setBatched(void (*handler)(void*, unsigned)) const {
+        _SYS_setVectorBatched(tID, (void*) handler, 0);
+    }
+
+    /**
+     * @brief Set this event vector to a batched instance method, given a
+     * class method pointer and an instance of that class.
+     */
+    template <typename tClass>
+    void setBatched(void (tClass::*handler)(unsigned), tClass *cls) const {
+        union {
+            void *pVoid;
+            void (tClass::*pMethod)(unsigned);
+        } u;
+        u.pMethod = handler;
+        _SYS_setVectorBatched(tID, u.pVoid, (void*) cls);
+    }
+
     /**
      * @brief Return the currently set handler function, as a void pointer.
      */
@@ -471,6 +519,15 @@ namespace Events {
     /// The current AssetConfiguration has finished loading on this cube.
     const EventVector<_SYS_CUBE_ASSETDONE>   cubeAssetDone;
 
+    /**
+     * @brief The AssetLoader has sent more data to this cube.
+     *
+     * Use AssetLoader::cubeProgress() to read the new value. Progress
+     * updates are coalesced, so a handler sees at most one event per
+     * cube each time events are dispatched.
+     */
+    const EventVector<_SYS_CUBE_ASSETPROGRESS> cubeAssetProgress;
+
     /// A cube's accelerometer state has changed.
     const EventVector<_SYS_CUBE_ACCELCHANGE> cubeAccelChange;
 
@@ -501,6 +558,15 @@ namespace Events {
     /// An event generated by Sifteo::AudioTracker.
     const EventVector<_SYS_BASE_TRACKER>     baseTracker;
 
+    /**
+     * @brief No cubes are busy loading assets any longer.
+     *
+     * Sent once the last busy cube in the current AssetLoader session
+     * either finishes loading or disconnects. After this event,
+     * AssetLoader::finish() returns without blocking.
+     */
+    const NullaryEventVector<_SYS_BASE_ASSETDONE>  assetDone;
+
     /// An event generated by an optional custom "game menu" item on the standard pause menu
     const GameMenuEventVector                gameMenu;
 
@@ -146,6 +146,38 @@ public:
         return _SYS_fs_objectRead(sys, (uint8_t*)buffer, bufferSize, volume);
     }
 
+    /**
+     * @brief Look up this object ahead of a later read()
+     *
+     * See the static prefetch() for details.
+     */
+    void prefetch(_SYSVolumeHandle volume = 0) const {
+        _SYS_fs_objectPrefetch(&sys, 1, volume);
+    }
+
+    /**
+     * @brief Look up several objects at once, ahead of later reads
+     *
+     * Each read() has to locate its object in the filesystem index before
+     * it can copy any data. When you know you're about to read a batch of
+     * objects, such as all of the keys for a saved level, prefetching
+     * them first finds every one of them in a single pass over the index.
+     * The reads that follow can then go straight to the data.
+     *
+     * This is only a hint. It never changes the result of a read, and the
+     * system only remembers a limited number of recently used keys, so
+     * prefetching far more objects than you're about to read is wasted
+     * effort.
+     *
+     * @return the number of objects found which weren't already known
+     * to the system.
+     */
+    static unsigned prefetch(const StoredObject *objects, unsigned count,
+        _SYSVolumeHandle volume = 0) {
+        STATIC_ASSERT(sizeof *objects == sizeof(_SYSObjectKey));
+        return _SYS_fs_objectPrefetch(&objects->sys, count, volume);
+    }
+
     /**
      * @brief Save a new version of an object
      *
@@ -1124,6 +1124,396 @@ struct AffineMatrix {
     }
 };
 
+/**
+ * @brief Signed fixed-point number, with 'F' bits to the right of the
+ * binary point.
+ *
+ * Floating point math is emulated in software, and every float operation
+ * is a system call. FixedPoint arithmetic compiles down to plain integer
+ * instructions, which makes it a good fit for particle systems and other
+ * code that updates many positions per frame.
+ *
+ * Multiplication is done entirely in 32-bit arithmetic, so it never calls
+ * into the 64-bit integer library. The product must still fit in the
+ * 32-bit result. Division is only provided for integer divisors.
+ *
+ * F may be at most 16. The typedefs Fixed16 (Q16) and Fixed8 (Q8) cover
+ * the common cases.
+ */
+template <unsigned F> struct FixedPoint {
+    int32_t raw;    ///< Underlying integer, equal to the value times 2^F
+
+    static const int32_t ONE = 1 << F;              ///< Raw value of 1.0
+    static const uint32_t FRAC_MASK = ONE - 1;      ///< Mask for the fractional bits
+
+    /// Create a FixedPoint from its raw integer representation
+    static FixedPoint fromRaw(int32_t r) {
+        FixedPoint result = { r };
+        return result;
+    }
+
+    /// Create a FixedPoint from an integer
+    static FixedPoint fromInt(int i) {
+        return fromRaw(i << F);
+    }
+
+    /**
+     * @brief Create a FixedPoint from a float, rounding to the nearest
+     * representable value.
+     *
+     * This folds away when the argument is constant. At runtime it costs
+     * a few floating point system calls.
+     */
+    static FixedPoint fromFloat(float f) {
+        return fromRaw(Sifteo::round(f * ONE));
+    }
+
+    /// Create a FixedPoint from a raw fixed-point value with a different number of fraction bits
+    template <unsigned G> static FixedPoint fromFixed(FixedPoint<G> v) {
+        return fromRaw(G > F ? (v.raw >> ((G - F) & 31)) : (v.raw << ((F - G) & 31)));
+    }
+
+    /// Round towards negative infinity, returning an integer
+    int floor() const {
+        return raw >> F;
+    }
+
+    /// Round towards positive infinity, returning an integer
+    int ceil() const {
+        return (raw + int32_t(FRAC_MASK)) >> F;
+    }
+
+    /// Round to the nearest integer. Halfway values round up.
+    int round() const {
+        return (raw + (ONE >> 1)) >> F;
+    }
+
+    /// Convert to floating point
+    float toFloat() const {
+        return raw * (1.0f / ONE);
+    }
+
+    /// Return the fractional part, always non-negative
+    FixedPoint frac() const {
+        return fromRaw(raw & FRAC_MASK);
+    }
+
+    /// Return the absolute value
+    FixedPoint abs() const {
+        return fromRaw(raw < 0 ? -raw : raw);
+    }
+
+    /**
+     * @brief Multiply two raw fixed-point values, without a 64-bit product.
+     *
+     * Each operand is split into a signed integer part and an unsigned
+     * fraction. With F <= 16, none of the four partial products can
+     * overflow 32 bits on its own.
+     */
+    static int32_t mulRaw(int32_t a, int32_t b) {
+        STATIC_ASSERT(F <= 16);
+        int32_t ah = a >> F;
+        int32_t bh = b >> F;
+        uint32_t al = a & FRAC_MASK;
+        uint32_t bl = b & FRAC_MASK;
+        return ((ah * bh) << F) + ah * int32_t(bl) + int32_t(al) * bh
+            + int32_t((al * bl) >> F);
+    }
+};
+
+typedef FixedPoint<16>  Fixed16;    ///< Q16 fixed-point, 16 integer bits and 16 fraction bits
+typedef FixedPoint<8>   Fixed8;     ///< Q8 fixed-point, 24 integer bits and 8 fraction bits
+
+template <unsigned F> inline FixedPoint<F> operator-(FixedPoint<F> a) { return FixedPoint<F>::fromRaw(-a.raw); }
+template <unsigned F> inline FixedPoint<F> operator+(FixedPoint<F> a, FixedPoint<F> b) { return FixedPoint<F>::fromRaw(a.raw + b.raw); }
+template <unsigned F> inline FixedPoint<F> operator-(FixedPoint<F> a, FixedPoint<F> b) { return FixedPoint<F>::fromRaw(a.raw - b.raw); }
+template <unsigned F> inline FixedPoint<F> operator*(FixedPoint<F> a, FixedPoint<F> b) { return FixedPoint<F>::fromRaw(FixedPoint<F>::mulRaw(a.raw, b.raw)); }
+template <unsigned F> inline FixedPoint<F> operator*(FixedPoint<F> a, int k) { return FixedPoint<F>::fromRaw(a.raw * k); }
+template <unsigned F> inline FixedPoint<F> operator*(int k, FixedPoint<F> a) { return FixedPoint<F>::fromRaw(a.raw * k); }
+template <unsigned F> inline FixedPoint<F> operator/(FixedPoint<F> a, int k) { return FixedPoint<F>::fromRaw(a.raw / k); }
+template <unsigned F> inline FixedPoint<F> operator<<(FixedPoint<F> a, int shift) { return FixedPoint<F>::fromRaw(a.raw << shift); }
+template <unsigned F> inline FixedPoint<F> operator>>(FixedPoint<F> a, int shift) { return FixedPoint<F>::fromRaw(a.raw >> shift); }
+template <unsigned F> inline FixedPoint<F> operator+=(FixedPoint<F> &a, FixedPoint<F> b) { return a = a + b; }
+template <unsigned F> inline FixedPoint<F> operator-=(FixedPoint<F> &a, FixedPoint<F> b) { return a = a - b; }
+template <unsigned F> inline FixedPoint<F> operator*=(FixedPoint<F> &a, FixedPoint<F> b) { return a = a * b; }
+template <unsigned F> inline FixedPoint<F> operator*=(FixedPoint<F> &a, int k) { return a = a * k; }
+template <unsigned F> inline bool operator==(FixedPoint<F> a, FixedPoint<F> b) { return a.raw == b.raw; }
+template <unsigned F> inline bool operator!=(FixedPoint<F> a, FixedPoint<F> b) { return a.raw != b.raw; }
+template <unsigned F> inline bool operator<(FixedPoint<F> a, FixedPoint<F> b) { return a.raw < b.raw; }
+template <unsigned F> inline bool operator>(FixedPoint<F> a, FixedPoint<F> b) { return a.raw > b.raw; }
+template <unsigned F> inline bool operator<=(FixedPoint<F> a, FixedPoint<F> b) { return a.raw <= b.raw; }
+template <unsigned F> inline bool operator>=(FixedPoint<F> a, FixedPoint<F> b) { return a.raw >= b.raw; }
+
+/**
+ * @brief Table-driven sine, as a Q16 fixed-point value.
+ *
+ * The angle is in the same units as tsini(): a full circle is 8192.
+ */
+inline Fixed16 fsin(int angle)
+{
+    return Fixed16::fromRaw(tsini(angle));
+}
+
+/**
+ * @brief Table-driven cosine, as a Q16 fixed-point value.
+ *
+ * The angle is in the same units as tcosi(): a full circle is 8192.
+ */
+inline Fixed16 fcos(int angle)
+{
+    return Fixed16::fromRaw(tcosi(angle));
+}
+
+/**
+ * @brief Two-element vector of FixedPoint values.
+ *
+ * This mirrors the integer parts of Vector2. Angles are integers, in units
+ * of 360/8192 degrees like tsini().
+ */
+template <unsigned F> struct FixedVector2 {
+    typedef FixedPoint<F> Scalar;
+
+    Scalar x;   ///< Vector component X
+    Scalar y;   ///< Vector component Y
+
+    /// Create a vector from two FixedPoint values
+    static FixedVector2 create(Scalar x, Scalar y) {
+        FixedVector2 result = { x, y };
+        return result;
+    }
+
+    /// Create a vector from an integer vector
+    static FixedVector2 fromInt(Int2 v) {
+        return create(Scalar::fromInt(v.x), Scalar::fromInt(v.y));
+    }
+
+    /// Create a vector from a floating point vector, rounding each component
+    static FixedVector2 fromFloat(Float2 v) {
+        return create(Scalar::fromFloat(v.x), Scalar::fromFloat(v.y));
+    }
+
+    /// Create a vector of the given length, pointing at the given integer angle
+    static FixedVector2 polar(int angle, Scalar magnitude) {
+        return create(magnitude * fcos(angle), magnitude * fsin(angle));
+    }
+
+    /// Modify this vector's value in-place.
+    void set(Scalar _x, Scalar _y) {
+        x = _x;
+        y = _y;
+    }
+
+    /// Round each component towards negative infinity
+    Int2 floor() const {
+        return vec(x.floor(), y.floor());
+    }
+
+    /// Round each component to the nearest integer
+    Int2 round() const {
+        return vec(x.round(), y.round());
+    }
+
+    /// Convert to a floating point vector
+    Float2 toFloat() const {
+        return vec(x.toFloat(), y.toFloat());
+    }
+
+    /// Calculate the scalar length (magnitude) of this vector, squared.
+    Scalar len2() const {
+        return x * x + y * y;
+    }
+
+    /**
+     * @brief Rotate this vector about the origin counterclockwise by an
+     * integer angle.
+     *
+     * The angle uses the same units as tsini(). To rotate many points by
+     * the same angle, build a FixedAffineMatrix and use transformPoints().
+     */
+    FixedVector2 rotate(int angle) const {
+        Scalar s = fsin(angle), c = fcos(angle);
+        return create(x*c - y*s, x*s + y*c);
+    }
+};
+
+typedef FixedVector2<16>    FixedVec2;      ///< Typedef for a 2-vector of Q16 fixed-point values
+typedef FixedVector2<8>     Fixed8Vec2;     ///< Typedef for a 2-vector of Q8 fixed-point values
+
+/**
+ * @brief Batch sine and cosine table lookup
+ *
+ * For each angle in 'angles', stores the unit vector (tcosi(a), tsini(a))
+ * in 'results'. Angles and results use the same units as tsini().
+ *
+ * This is a single system call for the whole array, so it's much cheaper
+ * than calling tsini() and tcosi() in a loop. Both arrays must be in RAM.
+ */
+inline void tsincosi(Int2 *results, const int *angles, unsigned count)
+{
+    _SYS_tsincosi_array(reinterpret_cast<_SYSInt2*>(results),
+        reinterpret_cast<const int32_t*>(angles), count);
+}
+
+/**
+ * @brief Batch table-driven sine and cosine, as Q16 unit vectors.
+ *
+ * Same as tsincosi(), but each result is a FixedVec2. One system call
+ * covers the whole array. Both arrays must be in RAM.
+ */
+inline void fsincos(FixedVec2 *results, const int *angles, unsigned count)
+{
+    _SYS_tsincosi_array(reinterpret_cast<_SYSInt2*>(results),
+        reinterpret_cast<const int32_t*>(angles), count);
+}
+
+template <unsigned F> inline FixedVector2<F> operator-(FixedVector2<F> u) { return FixedVector2<F>::create(-u.x, -u.y); }
+template <unsigned F> inline FixedVector2<F> operator+(FixedVector2<F> u, FixedVector2<F> v) { return FixedVector2<F>::create(u.x+v.x, u.y+v.y); }
+template <unsigned F> inline FixedVector2<F> operator-(FixedVector2<F> u, FixedVector2<F> v) { return FixedVector2<F>::create(u.x-v.x, u.y-v.y); }
+template <unsigned F> inline FixedVector2<F> operator*(FixedVector2<F> u, FixedPoint<F> k) { return FixedVector2<F>::create(u.x*k, u.y*k); }
+template <unsigned F> inline FixedVector2<F> operator*(FixedPoint<F> k, FixedVector2<F> u) { return FixedVector2<F>::create(u.x*k, u.y*k); }
+template <unsigned F> inline FixedVector2<F> operator*(FixedVector2<F> u, int k) { return FixedVector2<F>::create(u.x*k, u.y*k); }
+template <unsigned F> inline FixedVector2<F> operator*(int k, FixedVector2<F> u) { return FixedVector2<F>::create(u.x*k, u.y*k); }
+template <unsigned F> inline FixedVector2<F> operator/(FixedVector2<F> u, int k) { return FixedVector2<F>::create(u.x/k, u.y/k); }
+template <unsigned F> inline FixedVector2<F> operator<<(FixedVector2<F> u, int shift) { return FixedVector2<F>::create(u.x<<shift, u.y<<shift); }
+template <unsigned F> inline FixedVector2<F> operator>>(FixedVector2<F> u, int shift) { return FixedVector2<F>::create(u.x>>shift, u.y>>shift); }
+template <unsigned F> inline FixedVector2<F> operator+=(FixedVector2<F> &u, FixedVector2<F> v) { return u = u + v; }
+template <unsigned F> inline FixedVector2<F> operator-=(FixedVector2<F> &u, FixedVector2<F> v) { return u = u - v; }
+template <unsigned F> inline FixedVector2<F> operator*=(FixedVector2<F> &u, FixedPoint<F> k) { return u = u * k; }
+template <unsigned F> inline bool operator==(FixedVector2<F> u, FixedVector2<F> v) { return u.x == v.x && u.y == v.y; }
+template <unsigned F> inline bool operator!=(FixedVector2<F> u, FixedVector2<F> v) { return u.x != v.x || u.y != v.y; }
+
+/// Dot product of two FixedVector2 values
+template <unsigned F> inline FixedPoint<F> dot(FixedVector2<F> u, FixedVector2<F> v) {
+    return u.x*v.x + u.y*v.y;
+}
+
+/**
+ * @brief Q16 fixed-point version of AffineMatrix.
+ *
+ *      [ xx  yx  cx ]
+ *      [ xy  yy  cy ]
+ *      [  0   0   1 ]
+ *
+ * Rotation angles are integers, in the same units as tsini(). Building a
+ * rotation costs two table lookups, after which transforming each point
+ * is pure integer math.
+ */
+struct FixedAffineMatrix {
+    Fixed16 cx;   ///< Matrix member cx, the constant offset for X
+    Fixed16 cy;   ///< Matrix member cy, the constant offset for Y
+    Fixed16 xx;   ///< Matrix member xx, the horizontal X delta
+    Fixed16 xy;   ///< Matrix member xy, the horizontal Y delta
+    Fixed16 yx;   ///< Matrix member yx, the vertical X delta
+    Fixed16 yy;   ///< Matrix member yy, the vertical Y delta
+
+    /// Create an uninitialized matrix
+    FixedAffineMatrix() {}
+
+    /// Create a matrix from six scalar values
+    FixedAffineMatrix(Fixed16 _xx, Fixed16 _yx, Fixed16 _cx,
+                      Fixed16 _xy, Fixed16 _yy, Fixed16 _cy)
+        : cx(_cx), cy(_cy), xx(_xx),
+          xy(_xy), yx(_yx), yy(_yy) {}
+
+    /// Create the identity matrix.
+    static FixedAffineMatrix identity() {
+        Fixed16 zero = Fixed16::fromRaw(0), one = Fixed16::fromInt(1);
+        return FixedAffineMatrix(one, zero, zero,
+                                 zero, one, zero);
+    }
+
+    /// Create a matrix which scales by a factor of 's'
+    static FixedAffineMatrix scaling(Fixed16 s) {
+        Fixed16 zero = Fixed16::fromRaw(0);
+        return FixedAffineMatrix(s, zero, zero,
+                                 zero, s, zero);
+    }
+
+    /// Create a matrix which translates by vector 'v'
+    static FixedAffineMatrix translation(FixedVec2 v) {
+        Fixed16 zero = Fixed16::fromRaw(0), one = Fixed16::fromInt(1);
+        return FixedAffineMatrix(one, zero, v.x,
+                                 zero, one, v.y);
+    }
+
+    /// Create a matrix which rotates counterclockwise by an integer angle.
+    static FixedAffineMatrix rotation(int angle) {
+        Fixed16 s = fsin(angle), c = fcos(angle), zero = Fixed16::fromRaw(0);
+        return FixedAffineMatrix(c, -s, zero,
+                                 s, c, zero);
+    }
+
+    /// Matrix multiplication
+    void operator*= (const FixedAffineMatrix &m) {
+        FixedAffineMatrix n;
+
+        n.cx = xx*m.cx + yx*m.cy + cx;
+        n.cy = xy*m.cx + yy*m.cy + cy;
+        n.xx = xx*m.xx + yx*m.xy;
+        n.xy = xy*m.xx + yy*m.xy;
+        n.yx = xx*m.yx + yx*m.yy;
+        n.yy = xy*m.yx + yy*m.yy;
+
+        *this = n;
+    }
+
+    /// Compose this matrix with a translation by vector 'v'
+    void translate(FixedVec2 v) {
+        *this *= translation(v);
+    }
+
+    /// Compose this matrix with a rotation by an integer angle
+    void rotate(int angle) {
+        *this *= rotation(angle);
+    }
+
+    /// Compose this matrix with a scale by factor 's'
+    void scale(Fixed16 s) {
+        *this *= scaling(s);
+    }
+
+    /// Transform a single point
+    FixedVec2 transform(FixedVec2 p) const {
+        return FixedVec2::create(xx*p.x + yx*p.y + cx,
+                                 xy*p.x + yy*p.y + cy);
+    }
+};
+
+/**
+ * @brief Transform an array of points by the same matrix.
+ *
+ * The whole array is handled by one system call, which computes the same
+ * results as FixedAffineMatrix::transform(). 'src' and 'dest' must both
+ * be in RAM, and they may be the same array.
+ */
+inline void transformPoints(const FixedAffineMatrix &m, const FixedVec2 *src,
+    FixedVec2 *dest, unsigned count)
+{
+    _SYS_affine_transformi(reinterpret_cast<const _SYSAffineQ16*>(&m),
+        reinterpret_cast<const _SYSInt2*>(src),
+        reinterpret_cast<_SYSInt2*>(dest), count);
+}
+
+/**
+ * @brief Transform an array of points, rounding the results to integers.
+ *
+ * This is handy for placing sprites directly from fixed-point particle
+ * positions. 'src' and 'dest' must both be in RAM.
+ */
+inline void transformPoints(const FixedAffineMatrix &m, const FixedVec2 *src,
+    Int2 *dest, unsigned count)
+{
+    _SYS_affine_transformi(reinterpret_cast<const _SYSAffineQ16*>(&m),
+        reinterpret_cast<const _SYSInt2*>(src),
+        reinterpret_cast<_SYSInt2*>(dest), count);
+
+    while (count--) {
+        dest->x = Fixed16::fromRaw(dest->x).round();
+        dest->y = Fixed16::fromRaw(dest->y).round();
+        dest++;
+    }
+}
+
 /**
  * @} endgroup math
 */
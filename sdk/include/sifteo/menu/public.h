@@ -128,6 +128,7 @@ inline void Menu::init(VideoBuffer &vid, const MenuAssets *aAssets, MenuItem *aI
     startingItem = 0;
 
     position = 0.0f;
+    invalidateColumns();
 
     setIconYOffset(kDefaultIconYOffset);
     setPeekTiles(kDefaultPeekTiles);
@@ -306,7 +307,7 @@ inline void Menu::anchor(uint8_t item, bool hopUp, int8_t panTarget)
 
     if (hopUp) {
         position = stoppingPositionFor(startingItem);
-        prev_ut = computeCurrentTile() + kNumTilesX;
+        invalidateColumns();
         updateBG0();
 
         changeState(MENU_STATE_HOP_UP);
@@ -142,7 +142,7 @@ inline void Menu::transFromStart()
         hasBeenStarted = true;
         
         position = stoppingPositionFor(startingItem);
-        prev_ut = computeCurrentTile() + kNumTilesX;
+        invalidateColumns();
         updateBG0();
 
         for(int i = 0; i < NUM_SIDES; i++) {
@@ -163,6 +163,8 @@ class Menu {
     static const float kPanEasingRate = 0.05f;
     //static const float kPanMaxSpeed = 7.5f; // moved due to weird linker error
     static const unsigned kPanDelayMilliseconds = 800;
+    static const unsigned kColumnBudget = 2;
+    static const int16_t kInvalidColumn = 0x7fff;
 
     // instance-constants
     uint8_t kHeaderHeight;
@@ -206,6 +208,8 @@ class Menu {
     // scrolling states (Inertia and Tilt): physics
     float position;         // current x position
     int prev_ut;            // tile validity tracker
+    int16_t drawnColumns[kNumTilesX]; // global column drawn in each BG0 column
+    float prevPosition;     // position at the last updateBG0(), for prefetch
     float velocity;         // current velocity
     TimeStep frameclock;    // framerate timer
     // finish state: animation iterations
@@ -256,6 +260,8 @@ class Menu {
     uint8_t computeSelected();
     void checkForPress();
     void drawColumn(int);
+    bool drawColumnIfNeeded(int);
+    void invalidateColumns();
     int stoppingPositionFor(int);
     float velocityMultiplier();
     float maxVelocity();
@@ -109,6 +109,7 @@ inline void Menu::drawColumn(int x)
 {
     // x is the column in "global" space
     Int2 topLeft = { umod(x, kNumTilesX), 0 };
+    drawnColumns[topLeft.x] = x;
     Int2 size = { 1, kIconTileHeight };
 
     // icon or blank column?
@@ -175,17 +176,51 @@ inline float Menu::lerp(float min, float max, float u)
     return min + u * (max - min);
 }
 
+inline bool Menu::drawColumnIfNeeded(int x)
+{
+    if (drawnColumns[umod(x, kNumTilesX)] == x)
+        return false;
+
+    drawColumn(x);
+    return true;
+}
+
+inline void Menu::invalidateColumns()
+{
+    // Force the next updateBG0() to redraw every column
+    for (unsigned i = 0; i < kNumTilesX; i++)
+        drawnColumns[i] = kInvalidColumn;
+    prevPosition = position;
+}
+
 inline void Menu::updateBG0()
 {
     int ut = computeCurrentTile();
+    unsigned drawn = 0;
 
-    while(prev_ut < ut) {
-        drawColumn(++prev_ut + kNumVisibleTilesX);
+    // Any column that's even partly on-screen must be drawn right away.
+    for (int x = ut; x <= ut + kNumVisibleTilesX; x++) {
+        drawn += drawColumnIfNeeded(x);
     }
-    while(prev_ut > ut) {
-        drawColumn(--prev_ut);
+
+    /*
+     * BG0 has one column more than we can ever show. While scrolling, use it
+     * to draw the next column in the direction of travel, so that column has
+     * already reached the cube by the time it scrolls into view. Skip this on
+     * frames that already had to draw several columns, to spread the work
+     * out over frames instead of piling it onto the slowest ones.
+     */
+    if (drawn < kColumnBudget) {
+        if (position > prevPosition) {
+            drawColumnIfNeeded(ut + kNumVisibleTilesX + 1);
+        } else if (position < prevPosition) {
+            drawColumnIfNeeded(ut - 1);
+        }
     }
 
+    prev_ut = ut;
+    prevPosition = position;
+
     {
         Int2 vec = {(position - kEndCapPadding), kIconYOffset};
         vid->bg0.setPanning(vec);
@@ -141,6 +141,32 @@ class System {
         _SYS_paintUnlimited();
     }
 
+    /**
+     * @brief Let paint() run ahead of the cubes, with frame pacing.
+     *
+     * By default, paint() is tuned for games that change VRAM in bursts.
+     * Games that redraw every frame often spend much of their time in
+     * paint(), waiting for each cube to acknowledge a frame. This call
+     * turns on a pipelined mode instead: paint() returns as soon as
+     * fewer than 'depth' frames are still queued for each cube, so the
+     * game can build its next frame while earlier ones are in flight.
+     *
+     * Frames are paced to the slower of 'fps' and the frame rate each
+     * cube is actually achieving, as measured from its acknowledgments.
+     * That keeps the queue short and steady, instead of filling it in a
+     * burst and then stalling.
+     *
+     * The setting lasts until the game exits. A depth of zero restores
+     * the default behavior. The depth may be at most
+     * _SYS_MAX_PAINT_PIPELINE.
+     */
+
+    static void setPaintPipeline(unsigned depth, float fps = 60.0f) {
+        ASSERT(depth <= _SYS_MAX_PAINT_PIPELINE);
+        ASSERT(fps > 0.0f);
+        _SYS_setPaintPipeline(depth, uint32_t(1e6f / fps));
+    }
+
     /**
      * @brief Wait for any previous paint() to finish.
      *
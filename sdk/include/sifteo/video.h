@@ -38,6 +38,7 @@
 #include <sifteo/video/bg0.h>
 #include <sifteo/video/bg1.h>
 #include <sifteo/video/bg2.h>
+#include <sifteo/video/patch.h>
 #include <sifteo/video/tilebuffer.h>
 
 namespace Sifteo {
@@ -88,6 +89,7 @@ enum VideoMode {
     BG0_SPR_BG1    = _SYS_VM_BG0_SPR_BG1, ///< BG0 background, 8 sprites, BG1 overlay
     BG2            = _SYS_VM_BG2,         ///< 16x16 tiled mode with affine transform
     STAMP          = _SYS_VM_STAMP,       ///< Reconfigurable 16-color framebuffer with transparency
+    BG0_PATCH      = _SYS_VM_BG0_PATCH,   ///< BG0 background plus a small direct-color patch
 };
 
 
@@ -152,10 +154,11 @@ struct VideoBuffer {
         FB64Drawable            fb64;       ///< Drawable for the FB64 framebuffer mode
         FB128Drawable           fb128;      ///< Drawable for the FB128 framebuffer mode
         BG0ROMDrawable          bg0rom;     ///< Drawable for the BG0_ROM tiled mode
-        BG0Drawable             bg0;        ///< Drawable for the BG0 layer, as used in BG0, BG0_BG1, and BG0_SPR_BG1 modes
+        BG0Drawable             bg0;        ///< Drawable for the BG0 layer, as used in BG0, BG0_BG1, BG0_SPR_BG1, and BG0_PATCH modes
         BG1Drawable             bg1;        ///< Drawable for the BG1 layer, as used in BG0_BG1 and BG0_SPR_BG1 modes
         BG2Drawable             bg2;        ///< Drawable for the BG2 tiled mode
         StampDrawable           stamp;      ///< Drawable for the STAMP framebuffer mode
+        PatchDrawable           patch;      ///< Drawable for the patch in BG0_PATCH mode
     };
 
     // Implicit conversions
@@ -200,6 +203,32 @@ struct VideoBuffer {
      */
     void setWindow(uint8_t firstLine, uint8_t numLines) {
         poke(offsetof(_SYSVideoRAM, first_line) / 2, firstLine | (numLines << 8));
+        setPartialFlag(false);
+    }
+
+    /**
+     * @brief Redraw only part of the screen, leaving the rest untouched.
+     *
+     * Like setWindow(), except that the window also picks which lines of
+     * the video mode are drawn. Line N of BG0, BG1 or the sprites lands on
+     * LCD line N, exactly where a full-screen frame would put it. This
+     * makes it cheap to update a small part of the screen, such as a
+     * status bar, without redrawing and sending the whole LCD.
+     *
+     * Supported in the BG0, BG0_BG1 and BG0_SPR_BG1 modes. Other modes
+     * treat this like setWindow(). Call setWindow() or setDefaultWindow()
+     * to return to normal drawing.
+     */
+    void setPartialWindow(uint8_t firstLine, uint8_t numLines) {
+        poke(offsetof(_SYSVideoRAM, first_line) / 2, firstLine | (numLines << 8));
+        setPartialFlag(true);
+    }
+
+    /**
+     * @brief Is the current window a partial redraw, set with setPartialWindow()?
+     */
+    bool isPartialWindow() const {
+        return peekb(offsetof(_SYSVideoRAM, flags)) & _SYS_VF_PARTIAL;
     }
 
     /**
@@ -251,6 +280,16 @@ struct VideoBuffer {
         xorb(offsetof(_SYSVideoRAM, flags), (r ^ flags) & mask);
     }
 
+    /**
+     * @brief Set or clear the _SYS_VF_PARTIAL bit, used by setWindow()
+     * and setPartialWindow().
+     */
+    void setPartialFlag(bool partial) {
+        uint8_t flags = peekb(offsetof(_SYSVideoRAM, flags));
+        if (bool(flags & _SYS_VF_PARTIAL) != partial)
+            xorb(offsetof(_SYSVideoRAM, flags), _SYS_VF_PARTIAL);
+    }
+
     /**
      * @brief Look up the last display rotation set by setRotation().
      */
@@ -645,6 +684,73 @@ struct VideoBuffer {
     }
 };
 
+/**
+ * @brief A record of the VRAM contents already sent to one cube.
+ *
+ * Games that redraw everything each frame often mark VRAM words as
+ * changed even when they end up with the same value the cube already
+ * has. With a VideoShadow attached, the system compares each changed
+ * word against this copy and skips any that the cube already holds,
+ * saving radio bandwidth.
+ *
+ * A VideoShadow costs a little over 1 kB of RAM, so it's opt-in. It
+ * belongs to one cube, not to a VideoBuffer, and it stays valid if you
+ * attach a different VideoBuffer to that cube. The system owns its
+ * contents; don't modify them.
+ *
+ * See VideoShadow::attach() and CubeID::detachVideoShadow().
+ */
+struct VideoShadow {
+    _SYSVideoShadow sys;
+
+    /**
+     * @brief Start tracking VRAM for the specified cube.
+     *
+     * Any VideoShadow previously attached to that cube is detached. The
+     * shadow starts out empty, and fills in as VRAM is sent to the cube.
+     * Like a VideoBuffer, a VideoShadow must never be attached to more
+     * than one cube at once.
+     */
+    void attach(_SYSCubeID id) {
+        _SYS_setVideoShadow(id, &sys);
+    }
+};
+
+/**
+ * @brief A log of VRAM changes, in the order they were made.
+ *
+ * Normally the system finds changed VRAM words by scanning the
+ * VideoBuffer's change maps. With a VideoChangeLog attached, each word
+ * changed through a VideoBuffer method is also logged, and the system
+ * sends logged words in order without scanning for them. This helps
+ * games that change a few scattered words at a time, such as sprite
+ * positions or individual tiles.
+ *
+ * The log holds _SYS_VIDEO_CHANGE_LOG_SIZE records. If more changes than
+ * that are waiting to be sent, or VRAM is modified directly, the system
+ * falls back to scanning, so a log never makes rendering incorrect. It
+ * belongs to one VideoBuffer. The system owns its contents; don't modify
+ * them.
+ */
+struct VideoChangeLog {
+    _SYSVideoChangeLog sys;
+
+    /**
+     * @brief Start logging changes to the specified VideoBuffer.
+     *
+     * Any VideoChangeLog previously attached to that buffer is detached.
+     * Only a few logs can be attached at once, one per cube slot.
+     */
+    void attach(VideoBuffer &vbuf) {
+        _SYS_vbuf_setChangeLog(vbuf, &sys);
+    }
+
+    /// Stop logging changes to the specified VideoBuffer
+    static void detach(VideoBuffer &vbuf) {
+        _SYS_vbuf_setChangeLog(vbuf, 0);
+    }
+};
+
 /**
  * @} endgroup video
 */
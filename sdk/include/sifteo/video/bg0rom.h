@@ -245,11 +245,29 @@ struct BG0ROMDrawable {
      */
     void fill(UInt2 topLeft, UInt2 size, unsigned tileIndex)
     {
-        while (size.y) {
-            span(topLeft, size.x, tileIndex);
-            size.y--;
-            topLeft.y++;
+        ASSERT(topLeft.x + size.x <= tileWidth() &&
+            topLeft.y + size.y <= tileHeight());
+
+        // One syscall for the whole rectangle, rather than one per row.
+        // Full-width rows are contiguous, so they're a single run.
+        _SYSVideoOp ops[_SYS_VRAM_BG0_WIDTH];
+        unsigned rows = size.y;
+        unsigned width = size.x;
+        if (width == tileWidth()) {
+            width *= rows;
+            rows = 1;
         }
+
+        uint16_t addr = tileAddr(topLeft);
+        for (unsigned i = 0; i != rows; ++i) {
+            ops[i].code = _SYS_VOP_FILL;
+            ops[i].addr = addr;
+            ops[i].count = width;
+            ops[i].arg = _SYS_TILE77(tileIndex);
+            ops[i].pSrc = 0;
+            addr += tileWidth();
+        }
+        _SYS_vbuf_batch(&sys.vbuf, ops, rows);
     }
 
     /**
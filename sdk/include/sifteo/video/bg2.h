@@ -176,10 +176,54 @@ struct BG2Drawable {
             256.0f * m.yx + 0.5f,
             256.0f * m.yy + 0.5f,
         };
+        setMatrix(a);
+    }
+
+    /**
+     * @brief Set the current affine transform matrix, from a fixed-point
+     * matrix.
+     *
+     * This uses only integer math, so it's much cheaper than the
+     * AffineMatrix version when the matrix changes every frame.
+     */
+    void setMatrix(const FixedAffineMatrix &m) {
+        setMatrix(packMatrix(m));
+    }
+
+    /**
+     * @brief Set the current affine transform, already in the hardware's
+     * 8.8 fixed-point format.
+     *
+     * Use this with tables built ahead of time by packMatrix(), for
+     * animations that cycle through a fixed set of rotations or scales.
+     */
+    void setMatrix(const _SYSAffine &a) {
         _SYS_vbuf_write(&sys.vbuf, offsetof(_SYSVideoRAM, bg2_affine)/2,
                         (const uint16_t *)&a, 6);
     }
 
+    /**
+     * @brief Convert a fixed-point matrix to the hardware's 8.8 format,
+     * rounding to nearest.
+     *
+     * For example, to precompute one full turn in 64 steps:
+     *
+     *     static _SYSAffine frames[64];
+     *     for (unsigned i = 0; i < arraysize(frames); ++i)
+     *         frames[i] = BG2Drawable::packMatrix(FixedAffineMatrix::rotation(i * 128));
+     */
+    static _SYSAffine packMatrix(const FixedAffineMatrix &m) {
+        _SYSAffine a = {
+            int16_t((m.cx.raw + 0x80) >> 8),
+            int16_t((m.cy.raw + 0x80) >> 8),
+            int16_t((m.xx.raw + 0x80) >> 8),
+            int16_t((m.xy.raw + 0x80) >> 8),
+            int16_t((m.yx.raw + 0x80) >> 8),
+            int16_t((m.yy.raw + 0x80) >> 8),
+        };
+        return a;
+    }
+
     /**
      * @brief Plot a single tile, by absolute tile index,
      * at location 'pos' in tile units.
@@ -212,11 +256,29 @@ struct BG2Drawable {
      */
     void fill(UInt2 topLeft, UInt2 size, unsigned tileIndex)
     {
-        while (size.y) {
-            span(topLeft, size.x, tileIndex);
-            size.y--;
-            topLeft.y++;
+        ASSERT(topLeft.x + size.x <= tileWidth() &&
+            topLeft.y + size.y <= tileHeight());
+
+        // One syscall for the whole rectangle, rather than one per row.
+        // Full-width rows are contiguous, so they're a single run.
+        _SYSVideoOp ops[_SYS_VRAM_BG2_WIDTH];
+        unsigned rows = size.y;
+        unsigned width = size.x;
+        if (width == tileWidth()) {
+            width *= rows;
+            rows = 1;
+        }
+
+        uint16_t addr = tileAddr(topLeft);
+        for (unsigned i = 0; i != rows; ++i) {
+            ops[i].code = _SYS_VOP_FILL;
+            ops[i].addr = addr;
+            ops[i].count = width;
+            ops[i].arg = _SYS_TILE77(tileIndex);
+            ops[i].pSrc = 0;
+            addr += tileWidth();
         }
+        _SYS_vbuf_batch(&sys.vbuf, ops, rows);
     }
 
     /**
@@ -122,7 +122,7 @@ struct FBDrawable {
         const unsigned byteAddr = xByte + pos.y * bytesPerLine;
         const unsigned pixelMask = ((1 << tBitsPerPixel) - 1) << xBit;
 
-        uint8_t byte = _SYS_vbuf_peekb(&sys.vbuf, byteAddr);
+        uint8_t byte = sys.vbuf.vram.bytes[byteAddr];
         byte &= ~pixelMask;
         byte |= colorIndex << xBit;
         _SYS_vbuf_pokeb(&sys.vbuf, byteAddr, byte);
@@ -158,54 +158,48 @@ struct FBDrawable {
         ASSERT(pos.x <= tWidth && width <= tWidth &&
             (pos.x + width) <= tWidth && pos.y < tHeight);
 
-        const unsigned pixelsPerWord = 16 / tBitsPerPixel;
-        const unsigned wordsPerLine = tWidth / pixelsPerWord;
-        const unsigned colorWord = expand16(colorIndex);
-
-        // Calculate a base address in words, and
-        // left/right boundaries relative to that in bits.
-        unsigned addr = pos.x / pixelsPerWord + pos.y * wordsPerLine;
-        int start = (pos.x % pixelsPerWord) * tBitsPerPixel;
-        int end = start + width * tBitsPerPixel;
-
-        while (end > 0) {
-            if (start <= 0 && end >= 16) {
-                // A run of complete words
-
-                unsigned count = end / 16;
-                _SYS_vbuf_fill(&sys.vbuf, addr, colorWord, count);
-                addr += count;
-                unsigned bits = count * 16;
-                start -= bits;
-                end -= bits;
-
-            } else {
-                // One partial word. (The first, last or only word)
-
-                unsigned mask = bitRange<uint16_t>(start, end);
-                unsigned word = _SYS_vbuf_peek(&sys.vbuf, addr);
-                word &= ~mask;
-                word |= colorWord & mask;
-                _SYS_vbuf_poke(&sys.vbuf, addr, word);
-                addr++;
-                start -= 16;
-                end -= 16;
-            }
-        }
+        _SYSVideoOp ops[3];
+        uint16_t edges[2];
+        unsigned count = spanOps(ops, edges, pos, width, expand16(colorIndex));
+        if (count)
+            _SYS_vbuf_batch(&sys.vbuf, ops, count);
     }
 
     /**
      * @brief Fill a rectangle of pixels, specified as a top-left corner
      * location and a size.
      *
+     * Full-width rectangles are a single fill. Otherwise, several lines
+     * at a time go out in one batched VRAM update.
+     *
      * All coordinates must be in range. This function performs no clipping.
      */
     void fill(UInt2 topLeft, UInt2 size, unsigned colorIndex)
     {
+        ASSERT(topLeft.x + size.x <= tWidth && topLeft.y + size.y <= tHeight);
+
+        const unsigned wordsPerLine = tWidth * tBitsPerPixel / 16;
+        const uint16_t colorWord = expand16(colorIndex);
+
+        if (topLeft.x == 0 && size.x == tWidth) {
+            _SYS_vbuf_fill(&sys.vbuf, topLeft.y * wordsPerLine,
+                colorWord, size.y * wordsPerLine);
+            return;
+        }
+
+        const unsigned linesPerBatch = 8;
+        _SYSVideoOp ops[linesPerBatch * 3];
+        uint16_t edges[linesPerBatch * 2];
+
         while (size.y) {
-            span(topLeft, size.x, colorIndex);
-            size.y--;
-            topLeft.y++;
+            unsigned count = 0;
+            for (unsigned i = 0; i != linesPerBatch && size.y; ++i) {
+                count += spanOps(ops + count, edges + i * 2, topLeft, size.x, colorWord);
+                size.y--;
+                topLeft.y++;
+            }
+            if (count)
+                _SYS_vbuf_batch(&sys.vbuf, ops, count);
         }
     }
 
@@ -221,54 +215,17 @@ struct FBDrawable {
      * @brief Draw a span of pixels from a packed-pixel bitmap, of the
      * same color depth as this framebuffer mode.
      *
+     * The pixels are packed into whole VRAM words in RAM first, and
+     * written with a single call.
+     *
      * All coordinates must be in range. This function performs no clipping.
      */
     void bitmapSpan(UInt2 pos, unsigned width, const uint8_t *data)
     {
-        ASSERT(pos.x <= tWidth && width <= tWidth &&
-            (pos.x + width) <= tWidth && pos.y < tHeight);
-
-        const unsigned pixelsPerByte = 8 / tBitsPerPixel;
-        const unsigned bytesPerLine = tWidth / pixelsPerByte;
-
-        // Base address in bits
-        unsigned addr = pos.x / pixelsPerByte + pos.y * bytesPerLine;
-
-        // Bitmap alignment
-        unsigned shift = (pos.x % pixelsPerByte) * tBitsPerPixel;
-        unsigned invShift = 8 - shift;
-
-        // Initial mask range, in bits, relative to the base address
-        int start = shift;
-        int end = start + width * tBitsPerPixel;
-
-        while (end > 0) {
-            // One source byte at a time, splatted to either one or two
-            // destination bytes in VRAM.
-
-            uint8_t source = *data;
-            data++;
-
-            // First byte
-            unsigned mask = (0xFF << shift) & bitRange<uint16_t>(start, end);
-            unsigned byte = _SYS_vbuf_peekb(&sys.vbuf, addr);
-            byte &= ~mask;
-            byte |= (source << shift) & mask;
-            _SYS_vbuf_pokeb(&sys.vbuf, addr, byte);
-
-            addr++;
-            start -= 8;
-            end -= 8;
-
-            // Optional second byte
-            if (shift) {
-                unsigned mask = (0xFF >> invShift) & bitRange<uint16_t>(start, end);
-                unsigned byte = _SYS_vbuf_peekb(&sys.vbuf, addr);
-                byte &= ~mask;
-                byte |= (source >> invShift) & mask;
-                _SYS_vbuf_pokeb(&sys.vbuf, addr, byte);
-            }
-        }
+        uint16_t words[tWidth * tBitsPerPixel / 16 + 1];
+        _SYSVideoOp op;
+        if (packSpan(op, words, pos, width, data))
+            _SYS_vbuf_write(&sys.vbuf, op.addr, words, op.count);
     }
 
     /**
@@ -276,7 +233,8 @@ struct FBDrawable {
      * this framebuffer mode.
      *
      * The destination rectangle is specified as a top-left corner
-     * and size, both in pixels.
+     * and size, both in pixels. Several lines at a time go out in one
+     * batched VRAM update.
      *
      * The bitmap does not need any special alignment.
      * The source bitmap stride is specified in bytes.
@@ -285,11 +243,21 @@ struct FBDrawable {
      */
     void bitmap(UInt2 topLeft, UInt2 size, const uint8_t *data, unsigned stride)
     {
+        const unsigned linesPerBatch = 8;
+        const unsigned maxWords = tWidth * tBitsPerPixel / 16 + 1;
+        _SYSVideoOp ops[linesPerBatch];
+        uint16_t words[linesPerBatch * maxWords];
+
         while (size.y) {
-            bitmapSpan(topLeft, size.x, data);
-            size.y--;
-            topLeft.y++;
-            data += stride;
+            unsigned count = 0;
+            for (unsigned i = 0; i != linesPerBatch && size.y; ++i) {
+                count += packSpan(ops[count], words + i * maxWords, topLeft, size.x, data);
+                size.y--;
+                topLeft.y++;
+                data += stride;
+            }
+            if (count)
+                _SYS_vbuf_batch(&sys.vbuf, ops, count);
         }
     }
 
@@ -315,6 +283,102 @@ struct FBDrawable {
     CubeID cube() const {
         return sys.cube;
     }
+
+private:
+    /*
+     * Partial words are merged with the current VRAM contents here, in
+     * RAM. The VideoBuffer is our own memory, so we read it directly
+     * instead of making a peek call for every edge.
+     */
+
+    /// Ops for one solid span: up to two masked edge words and a fill.
+    unsigned spanOps(_SYSVideoOp *ops, uint16_t *edges,
+        UInt2 pos, unsigned width, uint16_t colorWord)
+    {
+        const unsigned pixelsPerWord = 16 / tBitsPerPixel;
+        const unsigned wordsPerLine = tWidth / pixelsPerWord;
+
+        unsigned addr = pos.x / pixelsPerWord + pos.y * wordsPerLine;
+        int start = (pos.x % pixelsPerWord) * tBitsPerPixel;
+        int end = start + width * tBitsPerPixel;
+        unsigned count = 0;
+
+        while (end > 0) {
+            _SYSVideoOp &op = ops[count++];
+            op.addr = addr;
+
+            if (start <= 0 && end >= 16) {
+                // A run of complete words
+                unsigned words = end / 16;
+                op.code = _SYS_VOP_FILL;
+                op.count = words;
+                op.arg = colorWord;
+                op.pSrc = 0;
+                addr += words;
+                start -= words * 16;
+                end -= words * 16;
+
+            } else {
+                // One partial word. (The first, last or only word)
+                unsigned mask = bitRange<uint16_t>(start, end);
+                *edges = (sys.vbuf.vram.words[addr] & ~mask) | (colorWord & mask);
+                op.code = _SYS_VOP_WRITE;
+                op.count = 1;
+                op.arg = 0;
+                op.pSrc = reinterpret_cast<uint32_t>(edges);
+                edges++;
+                addr++;
+                start -= 16;
+                end -= 16;
+            }
+        }
+
+        return count;
+    }
+
+    /// Pack one line of bitmap pixels into 'words', as a single WRITE op.
+    unsigned packSpan(_SYSVideoOp &op, uint16_t *words,
+        UInt2 pos, unsigned width, const uint8_t *data)
+    {
+        ASSERT(pos.x <= tWidth && width <= tWidth &&
+            (pos.x + width) <= tWidth && pos.y < tHeight);
+
+        const unsigned pixelsPerWord = 16 / tBitsPerPixel;
+        const unsigned wordsPerLine = tWidth / pixelsPerWord;
+        const int numBytes = (width * tBitsPerPixel + 7) / 8;
+
+        if (!width)
+            return 0;
+
+        unsigned addr = pos.x / pixelsPerWord + pos.y * wordsPerLine;
+        int shift = (pos.x % pixelsPerWord) * tBitsPerPixel;
+        int end = shift + width * tBitsPerPixel;
+        unsigned count = 0;
+
+        for (int bit = 0; bit < end; bit += 16, count++) {
+            // Gather the 16 source bits that land in this word. The
+            // first word's bits start 'shift' bits before the bitmap.
+            int srcBit = bit - shift;
+            int byteIndex = (srcBit + 16) / 8 - 2;
+            uint32_t source = 0;
+            for (int i = 0; i != 3; ++i) {
+                int index = byteIndex + i;
+                if (index >= 0 && index < numBytes)
+                    source |= uint32_t(data[index]) << (8 * i);
+            }
+            source >>= srcBit - byteIndex * 8;
+
+            unsigned mask = bitRange<uint16_t>(shift - bit, end - bit);
+            words[count] = (sys.vbuf.vram.words[addr + count] & ~mask) | (source & mask);
+        }
+
+        op.code = _SYS_VOP_WRITE;
+        op.addr = addr;
+        op.count = count;
+        op.arg = 0;
+        op.pSrc = reinterpret_cast<uint32_t>(words);
+        return count ? 1 : 0;
+    }
 };
 
 
@@ -0,0 +1,152 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo SDK
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifdef NOT_USERSPACE
+#   error This is a userspace-only header, not allowed by the current build.
+#endif
+
+#include <sifteo/abi.h>
+#include <sifteo/macros.h>
+#include <sifteo/math.h>
+#include <sifteo/asset.h>
+#include <sifteo/video/color.h>
+
+namespace Sifteo {
+
+/**
+ * @addtogroup video
+/**
+ * @brief A VRAM accessor for the direct-color patch in BG0_PATCH mode.
+ *
+ * BG0_PATCH draws an ordinary BG0 layer, then covers a small box of it
+ * with up to _SYS_VRAM_PATCH_PIXELS pixels of RGB565 color. This is
+ * meant for content which changes too much from frame to frame to be
+ * built out of tiles, such as a small video or a particle effect.
+ *
+ * Only pixels which actually change are sent over the radio, so the
+ * cost of animating the patch scales with how much of it moves. Use
+ * the BG0Drawable in the VideoBuffer for everything behind the patch.
+ *
+ * The patch is stored row-major, with a pitch equal to its width.
+ * Its position is in LCD pixels, so it does not pan along with BG0.
+ */
+struct PatchDrawable {
+    _SYSAttachedVideoBuffer sys;
+
+    /**
+     * @brief Move and resize the patch.
+     *
+     * The patch must fit on the LCD, and its area must be no larger
+     * than _SYS_VRAM_PATCH_PIXELS. Pixel contents are not moved; you'll
+     * usually want to redraw the patch after resizing it.
+     */
+    void setBox(Int2 topLeft, Int2 size) {
+        ASSERT(topLeft.x >= 0 && topLeft.y >= 0 &&
+            size.x > 0 && size.y >= 0 &&
+            topLeft.x + size.x <= 128 &&
+            topLeft.y + size.y <= 128 &&
+            size.x * size.y <= _SYS_VRAM_PATCH_PIXELS);
+
+        _SYS_vbuf_poke(&sys.vbuf, offsetof(_SYSVideoRAM, patch_x)/2,
+            topLeft.x | (topLeft.y << 8));
+        _SYS_vbuf_poke(&sys.vbuf, offsetof(_SYSVideoRAM, patch_width)/2,
+            size.x | (size.y << 8));
+    }
+
+    /**
+     * @brief Hide the patch, leaving only BG0 visible.
+     */
+    void hide() {
+        _SYS_vbuf_pokeb(&sys.vbuf, offsetof(_SYSVideoRAM, patch_height), 0);
+    }
+
+    /**
+     * @brief Return the top-left corner of the patch, in LCD pixels.
+     */
+    UByte2 position() const {
+        return vec(sys.vbuf.vram.patch_x, sys.vbuf.vram.patch_y);
+    }
+
+    /**
+     * @brief Return the size of the patch, in pixels.
+     */
+    UByte2 size() const {
+        return vec(sys.vbuf.vram.patch_width, sys.vbuf.vram.patch_height);
+    }
+
+    /**
+     * @brief Plot one pixel, in patch-relative coordinates.
+     */
+    void plot(Int2 pos, RGB565 color) {
+        unsigned width = sys.vbuf.vram.patch_width;
+        ASSERT(pos.x >= 0 && pos.y >= 0 &&
+            pos.x < (int)width && pos.y < sys.vbuf.vram.patch_height);
+
+        _SYS_vbuf_poke(&sys.vbuf, offsetof(_SYSVideoRAM, patch)/2
+            + pos.x + pos.y * width, color.value);
+    }
+
+    /**
+     * @brief Copy one row of pixels from a RAM buffer.
+     *
+     * 'src' must hold at least as many pixels as the patch is wide.
+     */
+    void span(unsigned row, const RGB565 *src) {
+        unsigned width = sys.vbuf.vram.patch_width;
+        ASSERT(row < sys.vbuf.vram.patch_height);
+
+        _SYS_vbuf_write(&sys.vbuf, offsetof(_SYSVideoRAM, patch)/2
+            + row * width, &src->value, width);
+    }
+
+    /**
+     * @brief Fill the whole patch with a single color.
+     */
+    void fill(RGB565 color) {
+        _SYS_vbuf_fill(&sys.vbuf, offsetof(_SYSVideoRAM, patch)/2, color.value,
+            sys.vbuf.vram.patch_width * sys.vbuf.vram.patch_height);
+    }
+
+    /**
+     * @brief Return the VideoBuffer associated with this drawable.
+     */
+    _SYSVideoBuffer &videoBuffer() {
+        return sys.vbuf;
+    }
+
+    /**
+     * @brief Return the CubeID associated with this drawable.
+     */
+    CubeID cube() const {
+        return sys.cube;
+    }
+};
+
+/**
+ * @} end addtogroup video
+ */
+
+};  // namespace Sifteo
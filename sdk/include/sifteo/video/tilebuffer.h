@@ -34,6 +34,7 @@
 #include <sifteo/asset.h>
 #include <sifteo/memory.h>
 #include <sifteo/cube.h>
+#include <sifteo/video/bg0.h>
 
 namespace Sifteo {
 
@@ -64,6 +65,11 @@ namespace Sifteo {
  * header we build in RAM needs to be initialized by the constructor,
  * and you must attach the TileBuffer to a specific CubeID so we can
  * relocate assets.
+ *
+ * Each row keeps a span of tiles that were drawn since the last flush().
+ * flush() copies just those spans to BG0, in one batched VRAM update,
+ * so a mostly-static screen composed in a TileBuffer costs very little
+ * to keep up to date. If you write to tiles[] directly, call markDirty().
  */
 
 template <unsigned tW, unsigned tH, unsigned tF = 1>
@@ -74,6 +80,11 @@ struct TileBuffer {
     } sys;
     uint16_t tiles[tW * tH * tF];
 
+    /// Per-row range of tiles [begin, end) drawn since the last flush()
+    struct {
+        uint8_t begin, end;
+    } dirty[tH * tF];
+
     // Implicit conversion to AssetImage base class
     operator const AssetImage& () const { return *reinterpret_cast<const AssetImage*>(&sys.image); }
     operator AssetImage& () { return *reinterpret_cast<AssetImage*>(&sys.image); }
@@ -117,8 +128,10 @@ struct TileBuffer {
      * @brief Initialize the TileBuffer's AssetImage header.
      */
     void init() {
+        STATIC_ASSERT(tW < 256);
         sys.cube = _SYS_CUBE_ID_INVALID;
         bzero(sys.image);
+        markDirty();
         sys.image.width = tW;
         sys.image.height = tH;
         sys.image.frames = tF;
@@ -237,6 +250,7 @@ struct TileBuffer {
     void erase(uint16_t index = 0) {
         ASSERT(sys.cube != _SYS_CUBE_ID_INVALID);
         memset16(&tiles[0], index, sizeInWords());
+        markDirty();
     }
 
     /**
@@ -266,7 +280,10 @@ struct TileBuffer {
     void plot(unsigned i, uint16_t tileIndex) {
         ASSERT(sys.cube != _SYS_CUBE_ID_INVALID);
         ASSERT(i < numTiles());
-        tiles[i] = tileIndex;
+        if (tiles[i] != tileIndex) {
+            tiles[i] = tileIndex;
+            markRow(i / tileWidth(), i % tileWidth(), 1);
+        }
     }
 
     /**
@@ -278,7 +295,7 @@ struct TileBuffer {
     void plot(UInt2 pos, uint16_t tileIndex, unsigned frame = 0) {
         ASSERT(sys.cube != _SYS_CUBE_ID_INVALID);
         ASSERT(pos.x < tileWidth() && pos.y < tileHeight() && frame < numFrames());
-        tiles[tileAddr(pos, frame)] = tileIndex;
+        plot(tileAddr(pos, frame), tileIndex);
     }
 
     /**
@@ -312,6 +329,7 @@ struct TileBuffer {
         ASSERT(pos.x <= tileWidth() && width <= tileWidth() &&
             (pos.x + width) <= tileWidth() && pos.y < tileHeight());
         memset16(&tiles[tileAddr(pos, frame)], tileIndex, width);
+        markRow(pos.y + frame * tileHeight(), pos.x, width);
     }
 
     /**
@@ -366,6 +384,7 @@ struct TileBuffer {
                pos.y < tileHeight() && pos.y + image.tileHeight() <= tileHeight() &&
                destFrame < numFrames());
         _SYS_image_memDraw(&tiles[tileAddr(pos, destFrame)], sys.cube, image, tileWidth(), srcFrame);
+        markDirty(pos, image.tileSize(), destFrame);
     }
 
     /**
@@ -386,6 +405,7 @@ struct TileBuffer {
                destFrame < numFrames());
         _SYS_image_memDrawRect(&tiles[tileAddr(destXY, destFrame)], sys.cube,
             image, tileWidth(), srcFrame, (_SYSInt2*) &srcXY, (_SYSInt2*) &size);
+        markDirty(destXY, size, destFrame);
     }
 
     /**
@@ -409,11 +429,120 @@ struct TileBuffer {
                 ASSERT(font.tileWidth() + (font.tileHeight() - 1) * tileWidth() + addr
                     <= numTiles() + tiles);
                 _SYS_image_memDraw(addr, sys.cube, font, tileWidth(), c - firstChar);
+                unsigned i = addr - tiles;
+                for (unsigned y = 0; y != font.tileHeight(); ++y)
+                    markRow(i / tileWidth() + y, i % tileWidth(), font.tileWidth());
                 addr += font.tileWidth();
             }
             str++;
         }
     }
+
+    /**
+     * @brief Mark the whole buffer, every frame, as changed.
+     *
+     * Use this after writing to tiles[] directly, or to force the next
+     * flush() to copy everything.
+     */
+    void markDirty() {
+        for (unsigned i = 0; i != arraysize(dirty); ++i) {
+            dirty[i].begin = 0;
+            dirty[i].end = tW;
+        }
+    }
+
+    /**
+     * @brief Mark a rectangle of tiles as changed.
+     *
+     * All coordinates must be in range. This function performs no clipping.
+     */
+    void markDirty(UInt2 topLeft, UInt2 size, unsigned frame = 0) {
+        ASSERT(topLeft.x + size.x <= tileWidth() &&
+            topLeft.y + size.y <= tileHeight() && frame < numFrames());
+        for (unsigned y = 0; y != size.y; ++y)
+            markRow(topLeft.y + y + frame * tileHeight(), topLeft.x, size.x);
+    }
+
+    /**
+     * @brief Is anything in this frame waiting to be flushed?
+     */
+    bool isDirty(unsigned frame = 0) const {
+        ASSERT(frame < numFrames());
+        for (unsigned y = 0; y != tH; ++y) {
+            unsigned row = y + frame * tH;
+            if (dirty[row].begin < dirty[row].end)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Copy the tiles changed since the last flush to BG0, with
+     * this frame's top-left corner at 'pos', and mark the frame clean.
+     *
+     * Each dirty row span becomes one write in a single batched VRAM
+     * update, and spans that continue across rows are merged. Tiles that
+     * haven't changed are never touched, so they cost nothing on the
+     * radio or in the VRAM syscall.
+     *
+     * This assumes BG0 still holds what the last flush() left there. If
+     * something else drew over it, call markDirty() first.
+     *
+     * The whole frame must fit on BG0. This function performs no clipping.
+     */
+    void flush(BG0Drawable &bg0, UInt2 pos = vec(0U, 0U), unsigned frame = 0) {
+        ASSERT(sys.cube != _SYS_CUBE_ID_INVALID);
+        ASSERT(pos.x + tileWidth() <= bg0.tileWidth() &&
+            pos.y + tileHeight() <= bg0.tileHeight() && frame < numFrames());
+
+        _SYSVideoOp ops[tH];
+        unsigned count = 0;
+
+        for (unsigned y = 0; y != tH; ++y) {
+            unsigned row = y + frame * tH;
+            unsigned begin = dirty[row].begin;
+            unsigned end = dirty[row].end;
+            if (begin >= end)
+                continue;
+
+            dirty[row].begin = tW;
+            dirty[row].end = 0;
+
+            uint16_t addr = bg0.tileAddr(vec(pos.x + begin, pos.y + y));
+            uint32_t src = reinterpret_cast<uint32_t>(&tiles[row * tW + begin]);
+
+            if (count) {
+                // Contiguous with the previous span, in VRAM and in memory?
+                _SYSVideoOp &prev = ops[count - 1];
+                if (prev.addr + prev.count == addr &&
+                    prev.pSrc + prev.count * sizeof(uint16_t) == src) {
+                    prev.count += end - begin;
+                    continue;
+                }
+            }
+
+            _SYSVideoOp &op = ops[count++];
+            op.code = _SYS_VOP_WRITEI;
+            op.addr = addr;
+            op.count = end - begin;
+            op.arg = 0;
+            op.pSrc = src;
+        }
+
+        if (count)
+            _SYS_vbuf_batch(&bg0.sys.vbuf, ops, count);
+    }
+
+private:
+    void markRow(unsigned row, unsigned x, unsigned width) {
+        ASSERT(row < arraysize(dirty) && x + width <= tW);
+        if (!width)
+            return;
+        if (x < dirty[row].begin)
+            dirty[row].begin = x;
+        if (x + width > dirty[row].end)
+            dirty[row].end = x + width;
+    }
 };
 
 
@@ -33,6 +33,7 @@ kNumTotalAssetSlots = kNumPairings * kAssetSlotsPerCube
 kNumFaults          = 16
 
 kFaultBase          = 0x16
+kFaultRepeat        = 2             # FaultRecordType for repeats of the previous fault
 kPairingMRU         = kFaultBase + kNumFaults
 kPairingID          = kPairingMRU + 1
 kCubeBase           = kPairingID + 1
@@ -127,12 +128,20 @@ def getFault(v):
 
     FaultRecordSvm = namedtuple('FaultRecordSvm', 'header, cubes, regs, vol, mem')
 
+    FaultRecordRepeatFormat = "<IHH"
+    FaultRecordRepeat = namedtuple('FaultRecordRepeat', 'header, pc, count, reserved')
+
     # populate our tuples with the fault data
     f = StringIO.StringIO(v)
 
     headerData = f.read(struct.calcsize(FaultHeaderFormat))
     header = FaultHeader._make(struct.unpack(FaultHeaderFormat, headerData))
 
+    # a repeat of the previous fault only records how many times it was seen
+    if header.recordType == kFaultRepeat:
+        repeatData = f.read(struct.calcsize(FaultRecordRepeatFormat))
+        return FaultRecordRepeat(header, *struct.unpack(FaultRecordRepeatFormat, repeatData))
+
     cubeInfoData = f.read(struct.calcsize(FaultCubeInfoFormat))
     cubeInfo = FaultCubeInfo._make(struct.unpack(FaultCubeInfoFormat, cubeInfoData))
 
@@ -150,6 +159,10 @@ def getFault(v):
 
 def printFault(f):
     print "********************************"
+    if f.header.recordType == kFaultRepeat:
+        printFaultRepeat(f)
+        return
+
     vol = f.vol
     print "Fault Info for %s (%s)" % (vol.package, vol.version)
     print "    uuid: %s" % vol.uuid
@@ -176,6 +189,16 @@ def printFault(f):
     for i, gpr in enumerate(r.gpr):
         print "    r%d: 0x%08x" % (i, gpr)
 
+def printFaultRepeat(f):
+    hdr = f.header
+    print "Repeated Fault"
+    print "    reference: %d (see the full record with this reference)" % hdr.reference
+    print "    runningVolume: 0x%x" % hdr.runningVolume
+    print "    fault code: 0x%x - %s" % (hdr.code, faultCodeStr(hdr.code))
+    print "    PC: 0x%08x" % f.pc
+    print "    times seen: %d" % f.count
+    print "    uptime at last repeat (in sys ticks): %d" % hdr.uptime
+
 def faultCodeStr(code):
     return {
         1: "Stack allocation failure",
@@ -215,6 +238,7 @@ def faultCodeStr(code):
 def faultRecordTypeStr(t):
     return {
         1: "SVM Fault Record",
+        2: "Repeated Fault Record",
     }.get(t, "Unknown fault record type")
 
 def dumpSaveData(filepath):
@@ -37,6 +37,46 @@
 using namespace std;
 
 
+/*
+ * Tables for our IMA ADPCM variant. Each code table entry holds the
+ * 8-bit signed multiplier for the current step size (in eighths), and
+ * in its upper bits, the index adjustment for the next sample.
+ */
+
+static const uint16_t stepSizeTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+    143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449,
+    494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411,
+    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026,
+    4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int codeTable[16] = {
+    static_cast<const int>(0xFFFFFF01),
+    static_cast<const int>(0xFFFFFF03),
+    static_cast<const int>(0xFFFFFF05),
+    static_cast<const int>(0xFFFFFF07),
+    static_cast<const int>(0x00000209),
+    static_cast<const int>(0x0000040B),
+    static_cast<const int>(0x0000060D),
+    static_cast<const int>(0x0000080F),
+    static_cast<const int>(0xFFFFFFFF),
+    static_cast<const int>(0xFFFFFFFD),
+    static_cast<const int>(0xFFFFFFFB),
+    static_cast<const int>(0xFFFFFFF9),
+    static_cast<const int>(0x000002F7),
+    static_cast<const int>(0x000004F5),
+    static_cast<const int>(0x000006F3),
+    static_cast<const int>(0x000008F1)
+};
+
+// Codes sorted by increasing multiplier, from -15 to +15
+static const uint8_t codeOrder[16] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 0, 1, 2, 3, 4, 5, 6, 7
+};
+
 AudioEncoder *AudioEncoder::create(string name)
 {
     transform(name.begin(), name.end(), name.begin(), ::tolower);
@@ -60,7 +100,18 @@ void ADPCMEncoder::encode(const std::vector<uint8_t> &in, std::vector<uint8_t> &
 {
     State state;
     optimizeIC(state, in);
-    encodeWithIC(state, in, out, in.size());
+
+    /*
+     * The trellis search almost always wins, but it can't promise to
+     * find the greedy path. Keep whichever encoding has less error.
+     */
+
+    std::vector<uint8_t> greedy;
+    uint64_t greedyError = encodeWithIC(state, in, greedy, in.size());
+    uint64_t trellisError = encodeTrellis(state, in, out);
+
+    if (greedyError < trellisError)
+        out.swap(greedy);
 }
 
 void ADPCMEncoder::optimizeIC(State &state, const std::vector<uint8_t> &in)
@@ -209,6 +260,156 @@ uint64_t ADPCMEncoder::encodeWithIC(State state, const std::vector<uint8_t> &in,
     return error;
 }
 
+uint64_t ADPCMEncoder::encodeTrellis(State state, const std::vector<uint8_t> &in,
+    std::vector<uint8_t> &out)
+{
+    /*
+     * Encode PCM data using a trellis search. Instead of committing to
+     * the closest nybble for every sample, we keep the TRELLIS_WIDTH
+     * lowest-error codec states after each sample. A slightly worse
+     * nybble now can leave the predictor and step size in a much better
+     * position for the samples that follow.
+     *
+     * To keep memory bounded, we search TRELLIS_BLOCK samples at a time
+     * plus TRELLIS_LOOKAHEAD samples of context, commit the best path
+     * through the block, and continue from the state at its end.
+     *
+     * Input and output formats, and the returned error metric, are
+     * identical to encodeWithIC().
+     */
+
+    unsigned numSamples = in.size() / sizeof(int16_t);
+    std::vector<int> samples(numSamples);
+    for (unsigned i = 0; i < numSamples; i++)
+        samples[i] = int16_t(in[2*i] | (in[2*i + 1] << 8));
+
+    // Doubled final sample?
+    if (numSamples & 1)
+        samples.push_back(samples.back());
+
+    std::vector<uint8_t> codes;
+    std::vector<TrellisNode> history;
+    codes.reserve(samples.size());
+    uint64_t error = 0;
+
+    out.resize(0);
+    out.reserve(samples.size() / 2 + HEADER_SIZE);
+
+    // Write the initial conditions header
+    out.push_back(state.sample);
+    out.push_back(state.sample >> 8);
+    out.push_back(state.index);
+
+    for (unsigned begin = 0; begin < samples.size(); begin += TRELLIS_BLOCK) {
+        unsigned end = std::min<unsigned>(begin + TRELLIS_BLOCK, samples.size());
+        unsigned searchEnd = std::min<unsigned>(end + TRELLIS_LOOKAHEAD, samples.size());
+        unsigned length = searchEnd - begin;
+
+        TrellisPath paths[TRELLIS_WIDTH];
+        TrellisPath nextPaths[TRELLIS_WIDTH];
+        unsigned numPaths = 1;
+
+        paths[0].state = state;
+        paths[0].error = 0;
+        history.resize(length * TRELLIS_WIDTH);
+
+        for (unsigned t = 0; t < length; t++) {
+            int sample = samples[begin + t];
+            unsigned numNext = 0;
+
+            for (unsigned p = 0; p < numPaths; p++) {
+                /*
+                 * Only nybbles near the ideal quantizer output are worth
+                 * exploring. Find the closest multiplier, and try its
+                 * neighbors on either side.
+                 */
+
+                int step = stepSizeTable[paths[p].state.index];
+                int ideal = (sample - paths[p].state.sample) * 8 / step;
+                int center = std::min(15, std::max(0, (ideal + 16) / 2));
+                int first = std::max(0, center - int(TRELLIS_RADIUS));
+                int last = std::min(15, center + int(TRELLIS_RADIUS));
+
+                for (int i = first; i <= last; i++) {
+                    unsigned code = codeOrder[i];
+                    TrellisPath candidate;
+                    candidate.state = paths[p].state;
+                    decodeSample(candidate.state, code);
+
+                    int64_t e = candidate.state.sample - sample;
+                    candidate.error = paths[p].error + e*e;
+                    candidate.node.parent = p;
+                    candidate.node.code = code;
+
+                    addTrellisPath(nextPaths, numNext, candidate);
+                }
+            }
+
+            for (unsigned p = 0; p < numNext; p++) {
+                paths[p] = nextPaths[p];
+                history[t * TRELLIS_WIDTH + p] = nextPaths[p].node;
+            }
+            numPaths = numNext;
+        }
+
+        // Trace the lowest-error path backwards, then commit this block
+        std::vector<uint8_t> blockCodes(length);
+        unsigned p = 0;
+        for (unsigned t = length; t--;) {
+            const TrellisNode &node = history[t * TRELLIS_WIDTH + p];
+            blockCodes[t] = node.code;
+            p = node.parent;
+        }
+
+        for (unsigned t = 0; t < end - begin; t++) {
+            decodeSample(state, blockCodes[t]);
+            int64_t e = state.sample - samples[begin + t];
+            error += e*e;
+            codes.push_back(blockCodes[t]);
+        }
+    }
+
+    for (unsigned i = 0; i < codes.size(); i += 2)
+        out.push_back(codes[i] | (codes[i + 1] << 4));
+
+    return error;
+}
+
+void ADPCMEncoder::addTrellisPath(TrellisPath *paths, unsigned &count,
+    const TrellisPath &candidate)
+{
+    /*
+     * Insert a candidate into a list of at most TRELLIS_WIDTH paths,
+     * sorted by increasing error. Paths that arrive at the same codec
+     * state are interchangeable from here on, so we keep only the best.
+     */
+
+    if (count == TRELLIS_WIDTH && candidate.error >= paths[count - 1].error)
+        return;
+
+    unsigned slot = count;
+    for (unsigned i = 0; i < count; i++)
+        if (paths[i].state.sample == candidate.state.sample &&
+            paths[i].state.index == candidate.state.index) {
+            if (candidate.error >= paths[i].error)
+                return;
+            slot = i;
+            break;
+        }
+
+    if (slot == count) {
+        if (count < TRELLIS_WIDTH)
+            count++;
+        slot = count - 1;
+    }
+
+    while (slot > 0 && paths[slot - 1].error > candidate.error) {
+        paths[slot] = paths[slot - 1];
+        slot--;
+    }
+    paths[slot] = candidate;
+}
+
 uint64_t ADPCMEncoder::encodePair(State &state, int s1, int s2, std::vector<uint8_t> &out)
 {
     // Compressed nybbles, and predictor errors
@@ -235,37 +436,7 @@ unsigned ADPCMEncoder::encodeSample(State &state, int sample)
      * on ARM with multiply and shift.
      */
     
-    static const uint16_t stepSizeTable[89] = {
-        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
-        34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
-        143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449,
-        494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411,
-        1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026,
-        4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
-        12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
-    };
-
-    static const int codeTable[16] = {
-        static_cast<const int>(0xFFFFFF01),
-        static_cast<const int>(0xFFFFFF03),
-        static_cast<const int>(0xFFFFFF05),
-        static_cast<const int>(0xFFFFFF07),
-        static_cast<const int>(0x00000209),
-        static_cast<const int>(0x0000040B),
-        static_cast<const int>(0x0000060D),
-        static_cast<const int>(0x0000080F),
-        static_cast<const int>(0xFFFFFFFF),
-        static_cast<const int>(0xFFFFFFFD),
-        static_cast<const int>(0xFFFFFFFB),
-        static_cast<const int>(0xFFFFFFF9),
-        static_cast<const int>(0x000002F7),
-        static_cast<const int>(0x000004F5),
-        static_cast<const int>(0x000006F3),
-        static_cast<const int>(0x000008F1)
-    };
-
-    int index = state.index;
-    int step = stepSizeTable[index];
+    int step = stepSizeTable[state.index];
 
     // Difference between new sample and old prediction
     int prevSample = state.sample;
@@ -284,12 +455,24 @@ unsigned ADPCMEncoder::encodeSample(State &state, int sample)
         }
     }
 
+    decodeSample(state, bestCode);
+    return bestCode;
+}
+
+void ADPCMEncoder::decodeSample(State &state, unsigned code)
+{
+    /*
+     * Update the codec state for one nybble of compressed data,
+     * exactly as the decoder will.
+     */
+
+    int step = stepSizeTable[state.index];
+    int diff = int(unsigned(int8_t(codeTable[code])) * unsigned(step)) >> 3;
+
     // Update prediction
-    state.sample = std::min(32767, std::max(-32768, prevSample + bestDiff));
+    state.sample = std::min(32767, std::max(-32768, state.sample + diff));
 
     // Update quantizer step size
-    index += (codeTable[bestCode] >> 8);
+    int index = state.index + (codeTable[code] >> 8);
     state.index = std::min<int>(INDEX_MAX, std::max(0, index));
-
-    return bestCode;
 }
@@ -85,16 +85,37 @@ public:
     }
 
 private:
+    static const unsigned TRELLIS_WIDTH = 8;
+    static const unsigned TRELLIS_RADIUS = 1;
+    static const unsigned TRELLIS_BLOCK = 4096;
+    static const unsigned TRELLIS_LOOKAHEAD = 256;
+
     struct State {
         unsigned index;
         int sample;
     };
 
+    struct TrellisNode {
+        uint8_t parent;
+        uint8_t code;
+    };
+
+    struct TrellisPath {
+        State state;
+        uint64_t error;
+        TrellisNode node;
+    };
+
     static void optimizeIC(State &state, const std::vector<uint8_t> &in);
     static uint64_t encodeWithIC(State state, const std::vector<uint8_t> &in,
         std::vector<uint8_t> &out, unsigned inBytes);
+    static uint64_t encodeTrellis(State state, const std::vector<uint8_t> &in,
+        std::vector<uint8_t> &out);
+    static void addTrellisPath(TrellisPath *paths, unsigned &count,
+        const TrellisPath &candidate);
 
     static unsigned encodeSample(State &state, int sample);
+    static void decodeSample(State &state, unsigned code);
     static uint64_t encodePair(State &state, int s1, int s2, std::vector<uint8_t> &out);
 };
 
@@ -0,0 +1,195 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * STIR -- Sifteo Tiled Image Reducer
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef WIN32
+#   include <io.h>
+#endif
+
+#include "buildcache.h"
+
+#define STRINGIFY(_x)   #_x
+#define TOSTRING(_x)    STRINGIFY(_x)
+
+namespace Stir {
+
+// Bump this whenever the meaning of any cached data changes
+static const uint32_t CACHE_VERSION = 3;
+
+static const char CACHE_MAGIC[4] = { 'S', 'T', 'C', 'h' };
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    while (size--) {
+        h ^= *(bytes++);
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+CacheKey::CacheKey(const char *kind)
+    : h1(FNV_OFFSET),
+      h2(0x84222325cbf29ce4ULL)     // Arbitrary second basis
+{
+    addValue(CACHE_VERSION);
+#ifdef SDK_VERSION
+    add(std::string(TOSTRING(SDK_VERSION)));
+#endif
+    add(std::string(kind));
+}
+
+void CacheKey::add(const void *data, size_t size)
+{
+    h1 = fnv1a(h1, data, size);
+    h2 = fnv1a(h2, data, size);
+}
+
+void CacheKey::add(const std::string &s)
+{
+    // Length first, so adjacent strings can't run together
+    addValue<uint32_t>(s.size());
+    add(s.data(), s.size());
+}
+
+bool CacheKey::addFile(const std::string &filename)
+{
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+
+    uint8_t buffer[16 * 1024];
+    size_t size;
+    uint32_t total = 0;
+    while ((size = fread(buffer, 1, sizeof buffer, f)) > 0) {
+        add(buffer, size);
+        total += size;
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+
+    addValue(total);
+    return ok;
+}
+
+std::string CacheKey::str() const
+{
+    char buf[33];
+    snprintf(buf, sizeof buf, "%016llx%016llx",
+        (unsigned long long) h1, (unsigned long long) h2);
+    return buf;
+}
+
+std::string BuildCache::path(const CacheKey &key) const
+{
+    return mDir + "/" + key.str();
+}
+
+bool BuildCache::load(const CacheKey &key, CacheBlob &blob) const
+{
+    if (!isEnabled())
+        return false;
+
+    FILE *f = fopen(path(key).c_str(), "rb");
+    if (!f)
+        return false;
+
+    char magic[sizeof CACHE_MAGIC];
+    uint32_t size;
+    uint64_t check;
+    std::vector<uint8_t> &data = blob.data();
+
+    bool ok = fread(magic, sizeof magic, 1, f) == 1 &&
+              !memcmp(magic, CACHE_MAGIC, sizeof magic) &&
+              fread(&size, sizeof size, 1, f) == 1 &&
+              fread(&check, sizeof check, 1, f) == 1;
+
+    if (ok) {
+        data.resize(size);
+        ok = (size == 0 || fread(&data[0], size, 1, f) == 1) &&
+             fgetc(f) == EOF &&
+             check == fnv1a(FNV_OFFSET, size ? &data[0] : NULL, size);
+    }
+
+    fclose(f);
+
+    if (!ok)
+        data.clear();
+    return ok;
+}
+
+void BuildCache::store(const CacheKey &key, const CacheBlob &blob) const
+{
+    /*
+     * Failures here aren't fatal, we'll just miss the cache next time.
+     * Entries are written under a temporary name and then renamed, so
+     * a STIR run that gets interrupted can't leave a partial entry.
+     */
+
+    if (!isEnabled())
+        return;
+
+#ifdef WIN32
+    mkdir(mDir.c_str());
+#else
+    mkdir(mDir.c_str(), 0777);
+#endif
+
+    const std::vector<uint8_t> &data = blob.data();
+    uint32_t size = data.size();
+    uint64_t check = fnv1a(FNV_OFFSET, size ? &data[0] : NULL, size);
+
+    std::string finalPath = path(key);
+    std::string tempPath = finalPath + ".tmp";
+
+    FILE *f = fopen(tempPath.c_str(), "wb");
+    if (!f)
+        return;
+
+    bool ok = fwrite(CACHE_MAGIC, sizeof CACHE_MAGIC, 1, f) == 1 &&
+              fwrite(&size, sizeof size, 1, f) == 1 &&
+              fwrite(&check, sizeof check, 1, f) == 1 &&
+              (size == 0 || fwrite(&data[0], size, 1, f) == 1);
+
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef WIN32
+    // rename() won't replace an existing file here
+    if (ok)
+        remove(finalPath.c_str());
+#endif
+
+    if (!ok || rename(tempPath.c_str(), finalPath.c_str()))
+        remove(tempPath.c_str());
+}
+
+};  // namespace Stir
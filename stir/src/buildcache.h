@@ -0,0 +1,165 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * STIR -- Sifteo Tiled Image Reducer
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _BUILDCACHE_H
+#define _BUILDCACHE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace Stir {
+
+
+/*
+ * CacheKey --
+ *
+ *    Identifies one cached result, by hashing everything that could
+ *    affect it. This is a pair of independent 64-bit FNV-1a hashes,
+ *    seeded with the kind of result and the STIR version, so a new
+ *    release never reuses an old release's output.
+ */
+
+class CacheKey {
+ public:
+    explicit CacheKey(const char *kind);
+
+    void add(const void *data, size_t size);
+    void add(const std::string &s);
+    bool addFile(const std::string &filename);
+
+    template <typename T> void addValue(const T &value) {
+        add(&value, sizeof value);
+    }
+
+    std::string str() const;
+
+ private:
+    uint64_t h1, h2;
+};
+
+
+/*
+ * CacheBlob --
+ *
+ *    Serialized contents of one cache entry. Values are stored in
+ *    host byte order; the cache lives next to a single build, it
+ *    isn't meant to be portable.
+ */
+
+class CacheBlob {
+ public:
+    CacheBlob() : mPos(0) {}
+
+    std::vector<uint8_t> &data() {
+        return mData;
+    }
+
+    const std::vector<uint8_t> &data() const {
+        return mData;
+    }
+
+    void write(const void *p, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t*>(p);
+        mData.insert(mData.end(), bytes, bytes + size);
+    }
+
+    template <typename T> void writeValue(const T &value) {
+        write(&value, sizeof value);
+    }
+
+    template <typename T> void writeVector(const std::vector<T> &v) {
+        writeValue<uint32_t>(v.size());
+        if (!v.empty())
+            write(&v[0], v.size() * sizeof v[0]);
+    }
+
+    bool read(void *p, size_t size) {
+        if (size > mData.size() - mPos)
+            return false;
+        memcpy(p, &mData[mPos], size);
+        mPos += size;
+        return true;
+    }
+
+    template <typename T> bool readValue(T &value) {
+        return read(&value, sizeof value);
+    }
+
+    template <typename T> bool readVector(std::vector<T> &v) {
+        uint32_t size;
+        if (!readValue(size) || size > (mData.size() - mPos) / sizeof(T))
+            return false;
+        v.resize(size);
+        return size == 0 || read(&v[0], size * sizeof v[0]);
+    }
+
+    bool atEnd() const {
+        return mPos == mData.size();
+    }
+
+ private:
+    std::vector<uint8_t> mData;
+    size_t mPos;
+};
+
+
+/*
+ * BuildCache --
+ *
+ *    A directory of results from previous STIR runs, so that assets
+ *    whose inputs haven't changed don't need to be compiled again.
+ *    Each entry is one file, named after its CacheKey. Damaged or
+ *    truncated entries are detected and treated as misses.
+ *
+ *    BuildCache has no mutable state, so jobs on different threads
+ *    can share it.
+ */
+
+class BuildCache {
+ public:
+    void setDirectory(const std::string &dir) {
+        mDir = dir;
+    }
+
+    bool isEnabled() const {
+        return !mDir.empty();
+    }
+
+    bool load(const CacheKey &key, CacheBlob &blob) const;
+    void store(const CacheKey &key, const CacheBlob &blob) const;
+
+ private:
+    std::string mDir;
+
+    std::string path(const CacheKey &key) const;
+};
+
+
+};  // namespace Stir
+
+#endif
@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "tile.h"
 #include "script.h"
@@ -52,9 +53,12 @@ static void usage()
             "Options:\n"
             "  -h            Show this help message, and exit\n"
             "  -v            Verbose mode, show progress as we work\n"
+            "  -j THREADS    Compile independent assets in parallel (0 = one per CPU)\n"
+            "  -c DIR        Cache compiled assets in DIR, and reuse them when unchanged\n"
             "  -o FILE.cpp   Generate a C++ source file with your asset data\n"
             "  -o FILE.h     Generate a C++ header with metadata for your assets\n"
             "  -o FILE.html  Generate a proofing sheet for your assets, in HTML format\n"
+            "  -o FILE.bin   Put bulk asset data in a raw file, for slinky's -binary option\n"
             "  VAR=VALUE     Define a script variable, prior to parsing the script\n"
             "\n"
             "Sifteo SDK (" TOSTRING(SDK_VERSION) ")\n"
@@ -85,6 +89,24 @@ int main(int argc, char **argv)
             continue;
         }
          
+        if (!strcmp(arg, "-j") && argv[c+1]) {
+            char *end;
+            long n = strtol(argv[c+1], &end, 10);
+            if (*end || n < 0) {
+                log.error("Invalid thread count: '%s'", argv[c+1]);
+                return 1;
+            }
+            script.setNumThreads(n);
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "-c") && argv[c+1]) {
+            script.setCacheDirectory(argv[c+1]);
+            c++;
+            continue;
+        }
+
         if (!strcmp(arg, "-o") && argv[c+1]) {
             if (script.addOutput(argv[c+1])) {
                 c++;
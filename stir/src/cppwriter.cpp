@@ -25,9 +25,10 @@
  */
 
 #include "cppwriter.h"
-#include "audioencoder.h"
-#include "wavedecoder.h"
 #include <assert.h>
+#include <ctype.h>
+#include <string.h>
+#include <sstream>
 #include "sifteo/abi.h"
 
 namespace Stir {
@@ -99,6 +100,26 @@ void CPPWriter::writeString(const std::vector<uint8_t> &data)
     } while (i < data.size());
 }
 
+static void littleEndianBytes(const std::vector<uint16_t> &data, std::vector<uint8_t> &bytes)
+{
+    bytes.reserve(bytes.size() + data.size() * 2);
+
+    for (unsigned i = 0; i < data.size(); i++) {
+        bytes.push_back(data[i]);
+        bytes.push_back(data[i] >> 8);
+    }
+}
+
+void CPPWriter::writeString(const std::vector<uint16_t> &data)
+{
+    // Little-endian 16-bit words, as a string literal. The declaration
+    // must ensure at least 16-bit alignment.
+
+    std::vector<uint8_t> bytes;
+    littleEndianBytes(data, bytes);
+    writeString(bytes);
+}
+
 void CPPWriter::writeArray(const std::vector<uint8_t> &data)
 {
     char buf[8];
@@ -125,8 +146,78 @@ void CPPWriter::writeArray(const std::vector<uint16_t> &data)
     mStream << "\n";
 }
 
-CPPSourceWriter::CPPSourceWriter(Logger &log, const char *filename)
-    : CPPWriter(log, filename), nextGroupOrdinal(0) {}
+CPPSourceWriter::CPPSourceWriter(Logger &log, const char *filename, const char *binaryFilename)
+    : CPPWriter(log, filename), nextGroupOrdinal(0), mBinarySize(0)
+{
+    /*
+     * Bulk data can go into a separate raw binary file instead of string
+     * literals. slinky links that file in with "-binary", copying it
+     * straight into flash without running it through the compiler. We
+     * refer to it by the same symbol slinky defines: "_binary_", the
+     * file's base name with non-alphanumeric characters replaced by
+     * underscores, then "_start".
+     */
+
+    if (!binaryFilename || !mStream.is_open())
+        return;
+
+    mBinary.open(binaryFilename, std::ios::out | std::ios::binary);
+    if (!mBinary.is_open()) {
+        log.error("Error opening output file '%s'", binaryFilename);
+        return;
+    }
+
+    const char *name = binaryFilename;
+    for (const char *p = binaryFilename; *p; ++p)
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+
+    mBinarySymbol = "_binary_";
+    for (; *name; ++name)
+        mBinarySymbol += isalnum((unsigned char) *name) ? *name : '_';
+    mBinarySymbol += "_start";
+
+    mStream << "\nextern \"C\" const char " << mBinarySymbol << "[];\n";
+}
+
+std::string CPPSourceWriter::binaryRef(const std::vector<uint8_t> &data)
+{
+    // Append to the binary file, 32-bit aligned, and return
+    // an expression for the data's address as a uintptr_t.
+
+    static const char zeroes[4] = { 0 };
+    unsigned pad = -mBinarySize & 3;
+    mBinary.write(zeroes, pad);
+    mBinarySize += pad;
+
+    std::ostringstream ref;
+    ref << "reinterpret_cast<uintptr_t>(" << mBinarySymbol << ") + " << mBinarySize;
+
+    if (!data.empty())
+        mBinary.write(reinterpret_cast<const char*>(&data[0]), data.size());
+    mBinarySize += data.size();
+
+    return ref.str();
+}
+
+std::string CPPSourceWriter::dataRef(const std::string &name, const std::vector<uint8_t> &data)
+{
+    // Address of a named data array, or of the same data in our binary file.
+
+    if (hasBinary())
+        return binaryRef(data);
+    return "reinterpret_cast<uintptr_t>(" + name + "_data)";
+}
+
+std::string CPPSourceWriter::dataRef(const std::string &name, const std::vector<uint16_t> &data)
+{
+    if (hasBinary()) {
+        std::vector<uint8_t> bytes;
+        littleEndianBytes(data, bytes);
+        return binaryRef(bytes);
+    }
+    return "reinterpret_cast<uintptr_t>(" + name + "_data)";
+}
 
 bool CPPSourceWriter::writeGroup(const Group &group)
 {
@@ -147,30 +238,52 @@ bool CPPSourceWriter::writeGroup(const Group &group)
          *      read-only data yet.
          */
 
-        mStream <<
-            "\n"
-            "static const struct {\n" <<
-            indent << "struct _SYSAssetGroupHeader hdr;\n" <<
-            indent << "uint8_t data[" << group.getLoadstream().size() << "];\n"
-            "} " << group.getName() << "_data = {{\n" <<
-            indent << "/* reserved  */ 0,\n" <<
-            indent << "/* ordinal   */ " << nextGroupOrdinal++ << ",\n" <<
-            indent << "/* numTiles  */ " << group.getPool().size() << ",\n" <<
-            indent << "/* dataSize  */ " << group.getLoadstream().size() << ",\n" <<
-            indent << "/* crc       */ {\n" <<
-            indent;
-                writeArray(crc);
-        mStream <<
-            indent << "},\n" <<
-            "}, {\n";
+        if (hasBinary()) {
+            // Same layout as the struct below, including the loadstream's NUL.
+            std::vector<uint8_t> data;
+            data.push_back(0);
+            data.push_back(nextGroupOrdinal++);
+            data.push_back(group.getPool().size());
+            data.push_back(group.getPool().size() >> 8);
+            for (unsigned i = 0; i < 4; i++)
+                data.push_back(group.getLoadstream().size() >> (i * 8));
+            data.insert(data.end(), crc.begin(), crc.end());
+            data.insert(data.end(), group.getLoadstream().begin(), group.getLoadstream().end());
+            data.push_back(0);
 
-        writeArray(group.getLoadstream());
+            mStream <<
+                "\n"
+                "Sifteo::AssetGroup " << group.getName() << " = {{\n" <<
+                indent << "/* pHdr      */ " << binaryRef(data) << ",\n" <<
+                "}};\n\n";
 
-        mStream <<
-            "}};\n\n"
-            "Sifteo::AssetGroup " << group.getName() << " = {{\n" <<
-            indent << "/* pHdr      */ reinterpret_cast<uintptr_t>(&" << group.getName() << "_data.hdr),\n" <<
-            "}};\n\n";
+        } else {
+            mStream <<
+                "\n"
+                "static const struct {\n" <<
+                indent << "struct _SYSAssetGroupHeader hdr;\n" <<
+                indent << "uint8_t data[" << (group.getLoadstream().size() + 1) << "];\n"
+                "} " << group.getName() << "_data = {{\n" <<
+                indent << "/* reserved  */ 0,\n" <<
+                indent << "/* ordinal   */ " << nextGroupOrdinal++ << ",\n" <<
+                indent << "/* numTiles  */ " << group.getPool().size() << ",\n" <<
+                indent << "/* dataSize  */ " << group.getLoadstream().size() << ",\n" <<
+                indent << "/* crc       */ {\n" <<
+                indent;
+                    writeArray(crc);
+            mStream <<
+                indent << "},\n" <<
+                "},\n";
+
+            // Loadstream as a string literal; the array has room for its NUL.
+            writeString(group.getLoadstream());
+
+            mStream <<
+                "};\n\n"
+                "Sifteo::AssetGroup " << group.getName() << " = {{\n" <<
+                indent << "/* pHdr      */ reinterpret_cast<uintptr_t>(&" << group.getName() << "_data.hdr),\n" <<
+                "}};\n\n";
+        }
     }
 
     mLog.infoBegin("Encoding images");
@@ -186,60 +299,19 @@ bool CPPSourceWriter::writeGroup(const Group &group)
     return true;
 }
 
-bool CPPSourceWriter::writeSound(const Sound &sound)
+void CPPSourceWriter::writeSound(const Sound &sound)
 {
-    AudioEncoder *enc = AudioEncoder::create(sound.getEncode());
-    assert(enc != 0);
-
-    std::vector<uint8_t> raw;
-    std::vector<uint8_t> data;
-
-    std::string filepath = sound.getFile();
-    unsigned sz = filepath.size();
-
-    /*
-     * If the sample rate has not been explicitly specified in assets.lua,
-     * and we have a WAV file, default to its native sample rate.
-     *
-     * Otherwise, use the standard 16kHz sample rate.
-     */
-    uint32_t sampleRate = sound.getSampleRate();
+    // Audio data was already loaded and encoded by Sound::compress().
 
-    if (sz >= 4 && filepath.substr(sz - 4) == ".wav") {
-        uint32_t waveNativeSampleRate;
-        if (!WaveDecoder::loadFile(raw, waveNativeSampleRate, filepath, mLog))
-            return false;
+    const std::vector<uint8_t> &data = sound.getData();
+    uint32_t numSamples = sound.getNumSamples();
 
-        if (sampleRate == Sound::UNSPECIFIED_SAMPLE_RATE) {
-            sampleRate = waveNativeSampleRate;
-        }
-    }
-    else {
-        LodePNG::loadFile(raw, filepath);
-    }
-
-    if (sampleRate == Sound::UNSPECIFIED_SAMPLE_RATE) {
-        sampleRate = Sound::STANDARD_SAMPLE_RATE;
-    }
-
-    uint32_t numSamples = raw.size() / sizeof(int16_t);
-
-    enc->encode(raw, data);
-
-    mLog.infoLineWithLabel(sound.getName().c_str(),
-        "%7.02f kiB, %s (%s)",
-        data.size() / 1024.0f, enc->getName(), sound.getFile().c_str());
-
-    if (data.empty()) {
-        mLog.error("Error encoding audio file '%s'", sound.getFile().c_str());
-        delete enc;
-        return false;
+    if (!hasBinary()) {
+        mStream << "static const char " << sound.getName() << "_data[] = \n";
+        writeString(data);
+        mStream << ";\n\n";
     }
 
-    mStream << "static const char " << sound.getName() << "_data[] = \n";
-    writeString(data);
-    mStream << ";\n\n";
-
     // If the loop length is 0, there is no looping by default.
     _SYSAudioLoopType loopType = sound.getLoopType();
     if (sound.getLoopLength() == 0)
@@ -264,18 +336,15 @@ bool CPPSourceWriter::writeSound(const Sound &sound)
 
     mStream <<
         "extern const Sifteo::AssetAudio " << sound.getName() << " = {{\n" <<
-        indent << "/* sampleRate */ " << sampleRate << ",\n" <<
+        indent << "/* sampleRate */ " << sound.getOutputSampleRate() << ",\n" <<
         indent << "/* loopStart  */ " << sound.getLoopStart() << ",\n" <<
         indent << "/* loopEnd    */ " << loopEnd << ",\n" <<
         indent << "/* loopType   */ " << (loopType == _SYS_LOOP_ONCE ? "_SYS_LOOP_ONCE" : "_SYS_LOOP_REPEAT") << ",\n" <<
-        indent << "/* type       */ " << enc->getTypeSymbol() << ",\n" <<
+        indent << "/* type       */ " << sound.getTypeSymbol() << ",\n" <<
         indent << "/* volume     */ " << sound.getVolume() << ",\n" <<
         indent << "/* dataSize   */ " << data.size() << ",\n" <<
-        indent << "/* pData      */ reinterpret_cast<uintptr_t>(" << sound.getName() << "_data),\n" <<
+        indent << "/* pData      */ " << dataRef(sound.getName(), data) << ",\n" <<
         "}};\n\n";
-
-    delete enc;
-    return true;
 }
 
 void CPPSourceWriter::writeImageList(const ImageList& images)
@@ -312,8 +381,8 @@ void CPPSourceWriter::writeImage(const Image &image, bool writeDecl, bool writeA
 
     // Declare the data so we can do a forward reference,
     // to keep the header ordered first in memory when we can.
-    if (writeDecl) {
-        mStream << "extern const uint16_t " << image.getName() << "_data[];\n";
+    if (writeDecl && !hasBinary()) {
+        mStream << "extern const char " << image.getName() << "_data[];\n";
     }
 
     if (writeAsset) {
@@ -368,7 +437,7 @@ void CPPSourceWriter::writeImage(const Image &image, bool writeDecl, bool writeA
                 mStream <<
                     indent << "/* format   */ " << format << ",\n" <<
                     indent << "/* reserved */ 0,\n" <<
-                    indent << "/* pData    */ reinterpret_cast<uintptr_t>(" << image.getName() << "_data)\n}}";
+                    indent << "/* pData    */ " << dataRef(image.getName(), data) << "\n}}";
             
                 if (image.inList()) {
                     mStream << ",\n";
@@ -377,10 +446,10 @@ void CPPSourceWriter::writeImage(const Image &image, bool writeDecl, bool writeA
                 }                
             }
 
-            if (writeData) {
-                mStream << "const uint16_t " << image.getName() << "_data[] = {\n";
-                writeArray(data);
-                mStream << "};\n\n";
+            if (writeData && !hasBinary()) {
+                mStream << "const char " << image.getName() << "_data[] __attribute__((aligned(2))) =\n";
+                writeString(data);
+                mStream << ";\n\n";
             }
 
             return;
@@ -393,11 +462,14 @@ void CPPSourceWriter::writeImage(const Image &image, bool writeDecl, bool writeA
     // it will still be in an AssetImage class, but the compression format will
     // be _SYS_AIF_FLAT.
 
+    std::vector<uint16_t> data;
+    image.encodeFlat(data);
+
     if (writeAsset) {
         mStream <<
             indent << "/* format   */ _SYS_AIF_FLAT,\n" <<
             indent << "/* reserved */ 0,\n" <<
-            indent << "/* pData    */ reinterpret_cast<uintptr_t>(" << image.getName() << "_data)\n}}";
+            indent << "/* pData    */ " << dataRef(image.getName(), data) << "\n}}";
 
         if (image.inList()) {
             mStream << ",\n";
@@ -406,13 +478,11 @@ void CPPSourceWriter::writeImage(const Image &image, bool writeDecl, bool writeA
         }
     }
     
-    if (writeData) {
+    if (writeData && !hasBinary()) {
         mStream <<
-            "const uint16_t " << image.getName() << "_data[] = {\n";
-        std::vector<uint16_t> data;
-        image.encodeFlat(data);
-        writeArray(data);
-        mStream << "};\n\n";
+            "const char " << image.getName() << "_data[] __attribute__((aligned(2))) =\n";
+        writeString(data);
+        mStream << ";\n\n";
     }
 }
 
@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 #include <fstream>
+#include <string>
 
 #include "tile.h"
 #include "script.h"
@@ -60,6 +61,7 @@ class CPPWriter {
     void writeArray(const std::vector<uint8_t> &data);
     void writeArray(const std::vector<uint16_t> &data);
     void writeString(const std::vector<uint8_t> &data);
+    void writeString(const std::vector<uint16_t> &data);
 };
 
 
@@ -72,9 +74,9 @@ class CPPWriter {
 
 class CPPSourceWriter : public CPPWriter {
  public:
-    CPPSourceWriter(Logger &log, const char *filename);
+    CPPSourceWriter(Logger &log, const char *filename, const char *binaryFilename = NULL);
     bool writeGroup(const Group &group);
-    bool writeSound(const Sound &sound);
+    void writeSound(const Sound &sound);
     void writeTrackerShared(const Tracker &tracker);
     void writeTracker(const Tracker &tracker);
     void writeImageList(const ImageList& images);
@@ -82,7 +84,18 @@ class CPPSourceWriter : public CPPWriter {
  private:
     void writeImage(const Image &image, bool writeDecl=true, bool writeAsset=true, bool writeData=true);
 
+    bool hasBinary() const {
+        return mBinary.is_open();
+    }
+
+    std::string binaryRef(const std::vector<uint8_t> &data);
+    std::string dataRef(const std::string &name, const std::vector<uint8_t> &data);
+    std::string dataRef(const std::string &name, const std::vector<uint16_t> &data);
+
     unsigned nextGroupOrdinal;
+    std::ofstream mBinary;
+    std::string mBinarySymbol;
+    uint32_t mBinarySize;
 };
 
 
@@ -169,48 +169,56 @@ void DUBEncoder::encodeBlock(uint16_t *pTopLeft,
     unsigned width, unsigned height, std::vector<uint16_t> &data)
 {
     BitBuffer bits;
-    std::vector<uint16_t> dict;
+    std::vector<uint16_t> tiles;
+    std::vector<Code> codes;
     Code prevCode = { Code::INVALID };
     unsigned repeatCount = 0;
     bool repeating = false;
 
     for (unsigned y = 0; y < height; y++)
-        for (unsigned x = 0; x < width; x++) {
-            uint16_t tile = pTopLeft[x + y*mWidth];
-
-            // Find the best code for this tile, and update the dictionary
-            Code code = findBestCode(dict, tile);
-            dict.push_back(tile);
-
-            // If we ever output two identical codes in a row, that counts
-            // as a run. The next code *must* be a REPEAT code.
-            bool sameCode = (code.type == prevCode.type && code.value == prevCode.value);
-            prevCode = code;
-
-            if (repeating) {
-                if (sameCode) {
-                    // Extending an existing run
-                    repeatCount++;
-                    continue;
-                } else {
-                    // Break an existing run
-                    Code rep = { Code::REPEAT, static_cast<int>(repeatCount) };
-                    debugCode(x, y, rep, tile);
-                    packCode(rep, bits);
-                    bits.flush(data);
-                    repeating = false;
-                }
-            } else if (sameCode) {
-                // Beginning a run. The next code will be a REPEAT.
-                repeating = true;
-                repeatCount = 0;
+        for (unsigned x = 0; x < width; x++)
+            tiles.push_back(pTopLeft[x + y*mWidth]);
+
+    if (mEffort == EFFORT_FAST)
+        chooseCodesFast(tiles, codes);
+    else
+        chooseCodesOptimal(tiles, codes);
+
+    for (unsigned i = 0; i < tiles.size(); i++) {
+        unsigned x = i % width;
+        unsigned y = i / width;
+        uint16_t tile = tiles[i];
+        Code code = codes[i];
+
+        // If we ever output two identical codes in a row, that counts
+        // as a run. The next code *must* be a REPEAT code.
+        bool same = sameCode(code, prevCode);
+        prevCode = code;
+
+        if (repeating) {
+            if (same) {
+                // Extending an existing run
+                repeatCount++;
+                continue;
+            } else {
+                // Break an existing run
+                Code rep = { Code::REPEAT, static_cast<int>(repeatCount) };
+                debugCode(x, y, rep, tile);
+                packCode(rep, bits);
+                bits.flush(data);
+                repeating = false;
             }
-
-            debugCode(x, y, code, tile);
-            packCode(code, bits);
-            bits.flush(data);
+        } else if (same) {
+            // Beginning a run. The next code will be a REPEAT.
+            repeating = true;
+            repeatCount = 0;
         }
 
+        debugCode(x, y, code, tile);
+        packCode(code, bits);
+        bits.flush(data);
+    }
+
     if (repeating) {
         // Flush any final REPEAT code we have stowed away.
         Code rep = { Code::REPEAT, static_cast<int>(repeatCount) };
@@ -222,6 +230,136 @@ void DUBEncoder::encodeBlock(uint16_t *pTopLeft,
     bits.flush(data, true);
 }
 
+void DUBEncoder::chooseCodesFast(const std::vector<uint16_t> &tiles,
+    std::vector<Code> &codes)
+{
+    // Greedily use the shortest code for each tile, in order.
+
+    std::vector<uint16_t> dict;
+
+    for (unsigned i = 0; i < tiles.size(); i++) {
+        codes.push_back(findBestCode(dict, tiles[i]));
+        dict.push_back(tiles[i]);
+    }
+}
+
+void DUBEncoder::chooseCodesOptimal(const std::vector<uint16_t> &tiles,
+    std::vector<Code> &codes)
+{
+    /*
+     * Choose every code in the block at once, for the fewest total bits.
+     *
+     * The encoded block is a sequence of runs of identical codes. A run
+     * of one code costs that code's length, and a run of k > 1 costs two
+     * copies of the code plus a REPEAT(k-2). Adjacent runs must use
+     * different codes, or the decoder would see a single longer run.
+     *
+     * This is a shortest path over run boundaries. For every prefix of
+     * the block we keep the cheapest parse, plus the cheapest parse that
+     * ends in a different code than that one. The latter is all we need
+     * to start a new run with any code while honoring that constraint.
+     *
+     * Blocks are at most 64 tiles, and a run of a given code can only
+     * extend over tiles the code is valid for, so this stays cheap.
+     */
+
+    struct State {
+        unsigned cost;
+        Code code;
+        unsigned start;     // First tile in this state's final run
+        unsigned prevSlot;  // Which state at 'start' the run follows
+    };
+
+    const unsigned n = tiles.size();
+    const unsigned infinity = (unsigned) -1;
+    const State empty = { infinity, { Code::INVALID }, 0, 0 };
+    const State origin = { 0, { Code::INVALID }, 0, 0 };
+
+    // Two states per prefix length: [2*j] is the cheapest, [2*j+1] the
+    // cheapest whose final code differs from [2*j]'s.
+    std::vector<State> states(2 * (n + 1), empty);
+    states[0] = origin;
+
+    std::vector<unsigned> repeatLen;
+    for (unsigned k = 0; k < n; k++) {
+        Code rep = { Code::REPEAT, static_cast<int>(k) };
+        repeatLen.push_back(codeLen(rep));
+    }
+
+    for (unsigned last = 0; last < n; last++) {
+        // Every code that can produce this tile
+        std::vector<Code> candidates;
+        Code delta = { Code::DELTA, (int)tiles[last] - (last ? (int)tiles[last - 1] : 0) };
+        candidates.push_back(delta);
+        for (unsigned i = 0; i < last; i++)
+            if (tiles[last] == tiles[last - 1 - i]) {
+                Code ref = { Code::REF, static_cast<int>(i) };
+                candidates.push_back(ref);
+            }
+
+        State &best = states[2 * (last + 1)];
+        State &second = states[2 * (last + 1) + 1];
+
+        for (unsigned c = 0; c < candidates.size(); c++) {
+            Code code = candidates[c];
+            unsigned len = codeLen(code);
+
+            // Try every run of 'code' that ends at 'last'
+            for (unsigned first = last + 1; first-- > 0;) {
+                if (!codeMatches(code, tiles, first))
+                    break;
+
+                unsigned k = last - first + 1;
+                unsigned runLen = k == 1 ? len : 2 * len + repeatLen[k - 2];
+
+                unsigned slot = sameCode(states[2 * first].code, code) ? 1 : 0;
+                const State &prev = states[2 * first + slot];
+                if (prev.cost == infinity)
+                    continue;
+
+                State s = { prev.cost + runLen, code, first, slot };
+
+                if (s.cost < best.cost) {
+                    if (!sameCode(best.code, code))
+                        second = best;
+                    best = s;
+                } else if (s.cost < second.cost && !sameCode(best.code, code)) {
+                    second = s;
+                }
+            }
+        }
+    }
+
+    // Walk back along the chosen runs
+    codes.resize(n);
+    for (unsigned end = n, slot = 0; end;) {
+        const State &s = states[2 * end + slot];
+        for (unsigned i = s.start; i < end; i++)
+            codes[i] = s.code;
+        slot = s.prevSlot;
+        end = s.start;
+    }
+}
+
+bool DUBEncoder::codeMatches(Code code, const std::vector<uint16_t> &tiles, unsigned i)
+{
+    // Would 'code' produce tiles[i], given all tiles before it?
+
+    switch (code.type) {
+    case Code::DELTA:
+        return (int)tiles[i] - (i ? (int)tiles[i - 1] : 0) == code.value;
+    case Code::REF:
+        return (unsigned)code.value < i && tiles[i] == tiles[i - 1 - code.value];
+    default:
+        return false;
+    }
+}
+
+bool DUBEncoder::sameCode(Code a, Code b)
+{
+    return a.type == b.type && a.value == b.value;
+}
+
 void DUBEncoder::debugCode(int x, int y, DUBEncoder::Code c, int tile) const
 {
 #ifdef DEBUG_DUB
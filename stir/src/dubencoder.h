@@ -48,12 +48,23 @@ class Logger;
  *    To quickly locate the proper 8x8 block(s) in a large asset, the
  *    encoded data is prefixed with a block index, which lists the size
  *    of each compressed block.
+ *
+ *    The encoding effort selects how codes are chosen. EFFORT_FAST picks
+ *    the shortest code for each tile in turn. EFFORT_OPTIMAL searches
+ *    all code choices for a whole block, including how they group into
+ *    REPEAT runs, for the smallest possible block.
  */
 
 class DUBEncoder {
 public:
-    DUBEncoder(unsigned width, unsigned height, unsigned frames)
-        : mWidth(width), mHeight(height), mFrames(frames) {}
+    enum Effort {
+        EFFORT_FAST,
+        EFFORT_OPTIMAL,
+    };
+
+    DUBEncoder(unsigned width, unsigned height, unsigned frames,
+        Effort effort = EFFORT_OPTIMAL)
+        : mWidth(width), mHeight(height), mFrames(frames), mEffort(effort) {}
 
     void encodeTiles(std::vector<uint16_t> &tiles);
     void logStats(const std::string &name, Logger &log);
@@ -75,6 +86,7 @@ private:
     };
 
     unsigned mWidth, mHeight, mFrames;
+    Effort mEffort;
     bool mIndex16;
 
     std::vector<uint16_t> blockResult;  // Compressed block data
@@ -82,7 +94,11 @@ private:
 
     void encodeBlock(uint16_t *pTopLeft, unsigned width, unsigned height,
         std::vector<uint16_t> &blockData);
+    void chooseCodesFast(const std::vector<uint16_t> &tiles, std::vector<Code> &codes);
+    void chooseCodesOptimal(const std::vector<uint16_t> &tiles, std::vector<Code> &codes);
     Code findBestCode(const std::vector<uint16_t> &dict, uint16_t tile);
+    static bool codeMatches(Code code, const std::vector<uint16_t> &tiles, unsigned i);
+    static bool sameCode(Code a, Code b);
 
     unsigned getIndexSize() const;
     void debugCode(int x, int y, Code code, int tile) const;
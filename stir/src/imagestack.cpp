@@ -73,9 +73,11 @@ bool ImageStack::load(const char *filename)
        return false;
 
    source *s = new source();
+   s->filename = filename;
 
-   s->decoder.decode(s->rgba, png);
-   if (s->rgba.empty() || s->decoder.getWidth() == 0 || s->decoder.getHeight() == 0) {
+   // Only the header for now. Pixel data is decoded by storeFrame().
+   s->decoder.inspect(png);
+   if (s->decoder.hasError() || s->decoder.getWidth() == 0 || s->decoder.getHeight() == 0) {
        delete s;
        return false;
    }
@@ -84,6 +86,37 @@ bool ImageStack::load(const char *filename)
    return true;
 }
 
+bool ImageStack::decodeSource(source *s)
+{
+    if (!s->rgba.empty())
+        return true;
+
+    // Keep at most one decoded source around
+    for (std::vector<source*>::iterator i = sources.begin(); i != sources.end(); i++)
+        if (*i != s)
+            releaseSource(*i);
+
+    std::vector<uint8_t> png;
+    LodePNG::loadFile(png, s->filename);
+    if (png.empty())
+        return false;
+
+    s->decoder.decode(s->rgba, png);
+    if (s->decoder.hasError() || s->rgba.size() !=
+        s->decoder.getWidth() * s->decoder.getHeight() * 4) {
+        releaseSource(s);
+        return false;
+    }
+
+    return true;
+}
+
+void ImageStack::releaseSource(source *s)
+{
+    // Actually return the memory, not just clear the vector
+    std::vector<uint8_t>().swap(s->rgba);
+}
+
 void ImageStack::finishLoading()
 {
     /*
@@ -145,11 +178,11 @@ void ImageStack::finishLoading()
     return NULL;
 }
 
-void ImageStack::storeFrame(unsigned frame, TileGrid &tg, const TileOptions &opt)
+bool ImageStack::storeFrame(unsigned frame, TileGrid &tg, const TileOptions &opt)
 {
     source *s = getSourceForFrame(frame);
-    if (!s)
-        return;
+    if (!s || !decodeSource(s))
+        return false;
 
     unsigned index = frame - s->firstFrame;
     unsigned gridW = s->decoder.getWidth() / mWidth;
@@ -160,6 +193,12 @@ void ImageStack::storeFrame(unsigned frame, TileGrid &tg, const TileOptions &opt
     unsigned stride = s->decoder.getWidth() * 4;
 
     tg.load(opt, &s->rgba[x*4 + y*stride], stride, mWidth, mHeight);
+
+    // Done with this source after its last frame
+    if (index + 1 == s->numFrames)
+        releaseSource(s);
+
+    return true;
 }
 
 };  // namespace Stir
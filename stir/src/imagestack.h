@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 #include <vector>
+#include <string>
 
 #include "tile.h"
 #include "lodepng.h"
@@ -43,6 +44,11 @@ namespace Stir {
  *    need not be a one-to-one relationship between input images and
  *    frames: One image can be used as a strip or grid of frames, for
  *    example.
+ *
+ *    Loading a source only reads its PNG header. Pixels are decoded
+ *    on demand by storeFrame(), and released as soon as the last frame
+ *    from that source has been stored, so long animations only ever
+ *    need one decoded source image in memory at a time.
  */
 
 class ImageStack {
@@ -57,7 +63,7 @@ class ImageStack {
     void setHeight(int height);
     void setFrames(int frames);
 
-    void storeFrame(unsigned frame, TileGrid &tg, const TileOptions &opt);
+    bool storeFrame(unsigned frame, TileGrid &tg, const TileOptions &opt);
 
     unsigned getWidth() const {
         return mWidth;
@@ -81,6 +87,7 @@ class ImageStack {
 
  private:
     struct source {
+        std::string filename;
         LodePNG::Decoder decoder;
         std::vector<uint8_t> rgba;
         unsigned firstFrame;
@@ -95,6 +102,8 @@ class ImageStack {
     std::vector<source*> sources;
 
     source *getSourceForFrame(unsigned frame);
+    bool decodeSource(source *s);
+    void releaseSource(source *s);
 };
 
 
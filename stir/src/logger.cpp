@@ -163,4 +163,118 @@ void ConsoleLogger::setMinLabelWidth(unsigned width)
     mLabelWidth = std::max(mLabelWidth, width);
 }
 
+static std::string vformat(const char *fmt, va_list ap)
+{
+    char line[1024];
+    vsnprintf(line, sizeof line, fmt, ap);
+    line[sizeof line - 1] = 0;
+    return line;
+}
+
+BufferedLogger::~BufferedLogger() {}
+
+void BufferedLogger::add(EventType type, const char *label, const std::string &text, unsigned width)
+{
+    Event e;
+    e.type = type;
+    e.label = label ? label : "";
+    e.text = text;
+    e.width = width;
+    mEvents.push_back(e);
+}
+
+void BufferedLogger::heading(const char *name)
+{
+    add(E_HEADING, name, "");
+}
+
+void BufferedLogger::taskBegin(const char *name)
+{
+    add(E_TASK_BEGIN, name, "");
+}
+
+void BufferedLogger::taskProgress(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    std::string text = vformat(fmt, ap);
+    va_end(ap);
+
+    // Progress lines overwrite each other; only the latest one matters.
+    if (!mEvents.empty() && mEvents.back().type == E_TASK_PROGRESS)
+        mEvents.back().text = text;
+    else
+        add(E_TASK_PROGRESS, NULL, text);
+}
+
+void BufferedLogger::taskEnd()
+{
+    add(E_TASK_END, NULL, "");
+}
+
+void BufferedLogger::infoBegin(const char *name)
+{
+    add(E_INFO_BEGIN, name, "");
+}
+
+void BufferedLogger::infoLine(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    add(E_INFO_LINE, NULL, vformat(fmt, ap));
+    va_end(ap);
+}
+
+void BufferedLogger::infoLineWithLabel(const char *label, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    add(E_INFO_LINE_WITH_LABEL, label, vformat(fmt, ap));
+    va_end(ap);
+}
+
+void BufferedLogger::infoEnd()
+{
+    add(E_INFO_END, NULL, "");
+}
+
+void BufferedLogger::error(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    add(E_ERROR, NULL, vformat(fmt, ap));
+    va_end(ap);
+}
+
+void BufferedLogger::setMinLabelWidth(unsigned width)
+{
+    add(E_MIN_LABEL_WIDTH, NULL, "", width);
+}
+
+void BufferedLogger::replay(Logger &log) const
+{
+    for (std::vector<Event>::const_iterator i = mEvents.begin(); i != mEvents.end(); ++i) {
+        const char *label = i->label.c_str();
+        const char *text = i->text.c_str();
+
+        switch (i->type) {
+        case E_HEADING:                 log.heading(label); break;
+        case E_TASK_BEGIN:              log.taskBegin(label); break;
+        case E_TASK_PROGRESS:           log.taskProgress("%s", text); break;
+        case E_TASK_END:                log.taskEnd(); break;
+        case E_INFO_BEGIN:              log.infoBegin(label); break;
+        case E_INFO_LINE:               log.infoLine("%s", text); break;
+        case E_INFO_LINE_WITH_LABEL:    log.infoLineWithLabel(label, "%s", text); break;
+        case E_INFO_END:                log.infoEnd(); break;
+        case E_ERROR:                   log.error("%s", text); break;
+        case E_MIN_LABEL_WIDTH:         log.setMinLabelWidth(i->width); break;
+        }
+    }
+}
+
+void BufferedLogger::clear()
+{
+    mEvents.clear();
+}
+
 };  // namespace Stir
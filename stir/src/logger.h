@@ -28,6 +28,7 @@
 #define _LOGGER_H
 
 #include <string>
+#include <vector>
 
 namespace Stir {
 
@@ -81,6 +82,65 @@ class ConsoleLogger : public Logger {
     std::string mLastProgressLine;
 };
 
+/*
+ * BufferedLogger --
+ *
+ *    Records log calls so they can be replayed into another Logger
+ *    later on. Worker threads log into one of these, and the main
+ *    thread replays each buffer in a fixed order, so the console output
+ *    doesn't depend on which job happened to finish first.
+ *
+ *    Only the last taskProgress() line of each task is kept.
+ */
+
+class BufferedLogger : public Logger {
+ public:
+    virtual ~BufferedLogger();
+
+    virtual void heading(const char *name);
+
+    virtual void taskBegin(const char *name);
+    virtual void taskProgress(const char *fmt, ...);
+    virtual void taskEnd();
+
+    virtual void infoBegin(const char *name);
+    virtual void infoLine(const char *fmt, ...);
+    virtual void infoLineWithLabel(const char *label, const char *fmt, ...);
+    virtual void infoEnd();
+
+    virtual void error(const char *fmt, ...);
+
+    virtual void setMinLabelWidth(unsigned width);
+
+    void replay(Logger &log) const;
+    void clear();
+
+ private:
+    enum EventType {
+        E_HEADING,
+        E_TASK_BEGIN,
+        E_TASK_PROGRESS,
+        E_TASK_END,
+        E_INFO_BEGIN,
+        E_INFO_LINE,
+        E_INFO_LINE_WITH_LABEL,
+        E_INFO_END,
+        E_ERROR,
+        E_MIN_LABEL_WIDTH,
+    };
+
+    struct Event {
+        EventType type;
+        std::string label;
+        std::string text;
+        unsigned width;
+    };
+
+    std::vector<Event> mEvents;
+
+    void add(EventType type, const char *label, const std::string &text, unsigned width=0);
+};
+
 };  // namespace Stir
 
 #endif
@@ -133,7 +133,7 @@ ProofWriter::ProofWriter(Logger &log, const char *filename)
     }
 }
  
-void ProofWriter::writeGroup(const Group &group)
+void ProofWriter::writeGroup(const Group &group, const std::string &tiles)
 {
     if (!mStream.is_open())
         return;
@@ -147,7 +147,7 @@ void ProofWriter::writeGroup(const Group &group)
                << group.getLoadstream().size() / 1024.0 << " kB stream\n"
         "</p>\n";
 
-    defineTiles(group.getPool());
+    mStream << tiles;
 
     if (!group.isFixed())
         tileRange(0, group.getPool().size(), Tile::SIZE, 96);
@@ -191,17 +191,45 @@ void ProofWriter::close()
     }
 }
 
-void ProofWriter::defineTiles(const TilePool &pool)
+void ProofWriter::defineTiles(const TilePool &pool, const BuildCache &cache,
+    std::string &out)
 {
     /*
      * Define a set of tile data, in Javascript. Tiles are represented
      * as a common prefix (to optimize out the PNG header) plus an
      * array of tile-specific suffixes.
+     *
+     * The result depends only on the optimized tile images, so that's
+     * all the cache key covers.
      */
 
+    out.clear();
     if (!pool.size())
         return;
 
+    CacheKey key("proof");
+    key.addValue<uint32_t>(pool.size());
+
+    for (unsigned i = 0; i < pool.size(); i++) {
+        const Tile &t = *pool.tile(i);
+        uint16_t pixels[Tile::PIXELS];
+
+        for (unsigned p = 0; p < Tile::PIXELS; p++)
+            pixels[p] = t.pixel(p).value;
+
+        key.add(pixels, sizeof pixels);
+    }
+
+    if (cache.isEnabled()) {
+        CacheBlob blob;
+        std::vector<char> text;
+
+        if (cache.load(key, blob) && blob.readVector(text) && blob.atEnd()) {
+            out.assign(text.begin(), text.end());
+            return;
+        }
+    }
+
     std::vector<std::string> uri(pool.size());
 
     for (unsigned i = 0; i < pool.size(); i++)
@@ -213,12 +241,23 @@ void ProofWriter::defineTiles(const TilePool &pool)
         while (prefixLen && uri[i].compare(0, prefixLen, uri[0], 0, prefixLen))
             prefixLen--;
 
-    mStream << "<script>pool = defineTiles(\"" << uri[0].substr(0, prefixLen) << "\",[";
+    out.append("<script>pool = defineTiles(\"");
+    out.append(uri[0], 0, prefixLen);
+    out.append("\",[");
 
-    for (unsigned i = 0; i < pool.size(); i++)
-        mStream << "\"" << uri[i].substr(prefixLen) << "\",";
+    for (unsigned i = 0; i < pool.size(); i++) {
+        out.append("\"");
+        out.append(uri[i], prefixLen, std::string::npos);
+        out.append("\",");
+    }
+
+    out.append("]);</script>\n");
 
-    mStream << "]);</script>\n";
+    if (cache.isEnabled()) {
+        CacheBlob blob;
+        blob.writeVector(std::vector<char>(out.begin(), out.end()));
+        cache.store(key, blob);
+    }
 }
 
 unsigned ProofWriter::newCanvas(unsigned tilesW, unsigned tilesH, unsigned tileSize, bool hidden)
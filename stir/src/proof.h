@@ -35,6 +35,7 @@
 #include "tile.h"
 #include "script.h"
 #include "logger.h"
+#include "buildcache.h"
 
 namespace Stir {
 
@@ -59,9 +60,19 @@ class ProofWriter {
  public:
     ProofWriter(Logger &log, const char *filename);
 
-    void writeGroup(const Group &group);
+    bool isOpen() const {
+        return mStream.is_open();
+    }
+
+    void writeGroup(const Group &group, const std::string &tiles);
     void close();
 
+    // Tile definitions are rendered separately, since PNG-encoding
+    // every tile is most of a proof's cost. This is thread-safe, and
+    // results are kept in the BuildCache.
+    static void defineTiles(const TilePool &pool, const BuildCache &cache,
+        std::string &out);
+
  private:
     static const char *header;
 
@@ -69,7 +80,6 @@ class ProofWriter {
     unsigned mID;
     std::ofstream mStream;
 
-    void defineTiles(const TilePool &pool);
     unsigned newCanvas(unsigned tilesW, unsigned tilesH, unsigned tileSize, bool hidden=false);
     void tileRange(unsigned begin, unsigned end, unsigned tileSize, unsigned width);
     void tileGrid(const TileGrid &grid, unsigned tileSize, bool hidden=false);
@@ -35,13 +35,17 @@
 #include "cppwriter.h"
 #include "audioencoder.h"
 #include "dubencoder.h"
+#include "wavedecoder.h"
 #include "tracker.h"
+#include "threadpool.h"
 
 namespace Stir {
 
 // Important global variables
 #define GLOBAL_DEFGROUP         "_defaultGroup"
 #define GLOBAL_QUALITY          "quality"
+#define GLOBAL_DUB_EFFORT       "dub_effort"
+#define GLOBAL_DECODE_SPEED     "decode_speed"
 
 const char Group::className[] = "group";
 const char Image::className[] = "image";
@@ -71,7 +75,7 @@ Lunar<Tracker>::RegType Tracker::methods[] = {
 
 Script::Script(Logger &l)
     : log(l), anyOutputs(false), outputHeader(NULL),
-      outputSource(NULL), outputProof(NULL)
+      outputSource(NULL), outputProof(NULL), outputBinary(NULL), numThreads(1)
 {    
     L = lua_open();
     luaL_openlibs(L);
@@ -79,6 +83,10 @@ Script::Script(Logger &l)
     // Default globals
     lua_pushinteger(L, 9);
     lua_setglobal(L, GLOBAL_QUALITY);
+    lua_pushinteger(L, DUBEncoder::EFFORT_OPTIMAL);
+    lua_setglobal(L, GLOBAL_DUB_EFFORT);
+    lua_pushinteger(L, 0);
+    lua_setglobal(L, GLOBAL_DECODE_SPEED);
 
     Lunar<Group>::Register(L);
     Lunar<Image>::Register(L);
@@ -91,6 +99,184 @@ Script::~Script()
     lua_close(L);
 }
 
+namespace {
+
+    /*
+     * BuildJob --
+     *
+     *    A chunk of asset compilation that doesn't depend on any other
+     *    asset. On a thread pool, jobs log into a private buffer that
+     *    finish() replays later, in script order. Single-threaded, a job
+     *    just runs from finish() and logs directly, exactly as if it
+     *    were inline.
+     */
+
+    class BuildJob : public ThreadPool::Job {
+    public:
+        BuildJob() : mDone(false), mOK(false) {}
+
+        virtual void run() {
+            mOK = build(mBuffer);
+            mDone = true;
+        }
+
+        bool finish(Logger &log) {
+            if (mDone)
+                mBuffer.replay(log);
+            else
+                mOK = build(log);
+            mDone = true;
+            return mOK;
+        }
+
+    protected:
+        virtual bool build(Logger &log) = 0;
+
+    private:
+        bool mDone;
+        bool mOK;
+        BufferedLogger mBuffer;
+    };
+
+    class GroupJob : public BuildJob {
+    public:
+        GroupJob(Group *group, const BuildCache &cache)
+            : mGroup(group), mCache(cache) {}
+
+        Group *getGroup() const {
+            return mGroup;
+        }
+
+    protected:
+        virtual bool build(Logger &log) {
+            TilePool &pool = mGroup->getPool();
+
+            log.heading(mGroup->getName().c_str());
+
+            CacheKey key("group");
+            bool cached = false;
+
+            if (mCache.isEnabled()) {
+                pool.hashInputs(key);
+                key.addValue<uint8_t>(mGroup->isFixed());
+                key.addValue<double>(mGroup->getDecodeSpeed());
+                cached = load(key);
+            }
+
+            if (cached) {
+                log.taskBegin("Reusing cached tiles");
+                log.taskProgress("%d tiles", pool.size());
+                log.taskEnd();
+            } else {
+                pool.optimize(log);
+            }
+
+            if (!mGroup->isFixed()) {
+                if (pool.size() > pool.MAX_SIZE) {
+                    log.error("Error: Group '%s' with %d tiles is too large (%.02f%% of %d-tile slot)",
+                        mGroup->getName().c_str(), pool.size(), pool.size() * (100.0 / pool.MAX_SIZE),
+                        pool.MAX_SIZE);
+                    return false;
+                }
+
+                if (!cached)
+                    pool.encode(mGroup->getLoadstream(), &log, mGroup->getDecodeSpeed());
+            }
+
+            if (!cached && mCache.isEnabled()) {
+                CacheBlob blob;
+                blob.writeVector(mGroup->getLoadstream());
+                pool.save(blob);
+                mCache.store(key, blob);
+            }
+
+            return true;
+        }
+
+    private:
+        Group *mGroup;
+        const BuildCache &mCache;
+
+        bool load(const CacheKey &key) {
+            CacheBlob blob;
+            std::vector<uint8_t> loadstream;
+
+            if (mCache.load(key, blob) &&
+                blob.readVector(loadstream) &&
+                mGroup->getPool().load(blob)) {
+                mGroup->getLoadstream() = loadstream;
+                return true;
+            }
+            return false;
+        }
+    };
+
+    class SoundJob : public BuildJob {
+    public:
+        SoundJob(Sound *sound, const BuildCache &cache)
+            : mSound(sound), mCache(cache) {}
+
+        Sound *getSound() const {
+            return mSound;
+        }
+
+    protected:
+        virtual bool build(Logger &log) {
+            return mSound->compress(log, mCache);
+        }
+
+    private:
+        Sound *mSound;
+        const BuildCache &mCache;
+    };
+
+    class DUBJob : public ThreadPool::Job {
+    public:
+        DUBJob(Image *image) : mImage(image) {}
+
+        virtual void run() {
+            mImage->prepareDUB();
+        }
+
+    private:
+        Image *mImage;
+    };
+
+    class ProofJob : public ThreadPool::Job {
+    public:
+        ProofJob(Group *group, const BuildCache &cache)
+            : mGroup(group), mCache(cache), mDone(false) {}
+
+        virtual void run() {
+            ProofWriter::defineTiles(mGroup->getPool(), mCache, mTiles);
+            mDone = true;
+        }
+
+        // Renders inline if the job never ran on a pool
+        const std::string &getTiles() {
+            if (!mDone)
+                run();
+            return mTiles;
+        }
+
+    private:
+        Group *mGroup;
+        const BuildCache &mCache;
+        bool mDone;
+        std::string mTiles;
+    };
+
+    // Owns the jobs it holds
+    template <typename T>
+    class JobList : public std::vector<T*> {
+    public:
+        ~JobList() {
+            for (typename std::vector<T*>::iterator i = this->begin(); i != this->end(); ++i)
+                delete *i;
+        }
+    };
+}
+
 bool Script::run(const char *filename)
 {
     if (!anyOutputs)
@@ -102,29 +288,72 @@ bool Script::run(const char *filename)
     if (!collect())
         return false;
 
+    /*
+     * Groups and sounds are independent of each other, so with more
+     * than one thread they're all compiled up front on a ThreadPool.
+     * Once every TilePool is final, images can be DUB-encoded in
+     * parallel too, alongside rendering the proof's tile images.
+     * Everything below still writes output and replays logs in the
+     * same order, so the results don't depend on the number of threads.
+     */
+
     ProofWriter proof(log, outputProof);
-    CPPHeaderWriter header(log, outputHeader);
-    CPPSourceWriter source(log, outputSource);
+    JobList<GroupJob> groupJobs;
+    JobList<ProofJob> proofJobs;    // Parallel to groupJobs, NULL if no proof
+    JobList<SoundJob> soundJobs;
 
     for (std::set<Group*>::iterator i = groups.begin(); i != groups.end(); i++) {
         Group *group = *i;
-        TilePool &pool = group->getPool();
+        groupJobs.push_back(new GroupJob(group, cache));
+        proofJobs.push_back(proof.isOpen() && group->hasProof()
+            ? new ProofJob(group, cache) : NULL);
+    }
+    for (std::set<Sound*>::iterator i = sounds.begin(); i != sounds.end(); i++)
+        soundJobs.push_back(new SoundJob(*i, cache));
+
+    if (numThreads > 1) {
+        ThreadPool threads(numThreads);
+        std::vector<ThreadPool::Job*> jobs;
+
+        jobs.insert(jobs.end(), groupJobs.begin(), groupJobs.end());
+        jobs.insert(jobs.end(), soundJobs.begin(), soundJobs.end());
+        threads.run(jobs);
+
+        JobList<DUBJob> dubJobs;
+        jobs.clear();
+
+        for (unsigned i = 0; i < groupJobs.size(); i++) {
+            Group *group = groupJobs[i]->getGroup();
+            if (!group->isFixed() && group->getPool().size() > TilePool::MAX_SIZE)
+                continue;
+
+            // Proofs first, they're usually the longest jobs
+            if (proofJobs[i])
+                jobs.push_back(proofJobs[i]);
+
+            const std::set<Image*> &images = group->getImages();
+            for (std::set<Image*>::const_iterator j = images.begin(); j != images.end(); j++) {
+                Image *image = *j;
+                if (!image->isPinned() && !image->isFlat())
+                    dubJobs.push_back(new DUBJob(image));
+            }
+        }
 
-        log.heading(group->getName().c_str());
-        pool.optimize(log);
+        jobs.insert(jobs.end(), dubJobs.begin(), dubJobs.end());
+        threads.run(jobs);
+    }
 
-        if (!group->isFixed()) {
-            if (pool.size() > pool.MAX_SIZE) {
-                log.error("Error: Group '%s' with %d tiles is too large (%.02f%% of %d-tile slot)",
-                    group->getName().c_str(), pool.size(), pool.size() * (100.0 / pool.MAX_SIZE),
-                    pool.MAX_SIZE);
-                return false;
-            }
+    CPPHeaderWriter header(log, outputHeader);
+    CPPSourceWriter source(log, outputSource, outputBinary);
 
-            pool.encode(group->getLoadstream(), &log);
-        }
+    for (unsigned i = 0; i < groupJobs.size(); i++) {
+        Group *group = groupJobs[i]->getGroup();
 
-        proof.writeGroup(*group);
+        if (!groupJobs[i]->finish(log))
+            return false;
+
+        if (proofJobs[i])
+            proof.writeGroup(*group, proofJobs[i]->getTiles());
         header.writeGroup(*group);
 
         if (!source.writeGroup(*group))
@@ -140,11 +369,12 @@ bool Script::run(const char *filename)
         log.heading("Audio");
         log.infoBegin("Sound compression");
 
-        for (std::set<Sound*>::iterator i = sounds.begin(); i != sounds.end(); i++) {
-            Sound *sound = *i;
+        for (JobList<SoundJob>::iterator i = soundJobs.begin(); i != soundJobs.end(); i++) {
+            Sound *sound = (*i)->getSound();
             header.writeSound(*sound);
-            if (!source.writeSound(*sound))
+            if (!(*i)->finish(log))
                 return false;
+            source.writeSound(*sound);
         }
 
         log.infoEnd();
@@ -234,6 +464,12 @@ bool Script::addOutput(const char *filename)
         return true;
     }
 
+    if (outputBinary == NULL && matchExtension(filename, "bin")) {
+        outputBinary = filename;
+        anyOutputs = true;
+        return true;
+    }
+
     return false;
 }
 
@@ -243,6 +479,16 @@ void Script::setVariable(const char *key, const char *value)
     lua_setglobal(L, key);
 }
 
+void Script::setNumThreads(unsigned n)
+{
+    numThreads = n ? n : ThreadPool::hardwareThreads();
+}
+
+void Script::setCacheDirectory(const char *dir)
+{
+    cache.setDirectory(dir);
+}
+
 bool Script::matchExtension(const char *filename, const char *ext)
 {
     const char *p = strrchr(filename, '.');
@@ -486,7 +732,10 @@ Group::Group(lua_State *L)
         TileGrid grid(&pool);
         TileOptions opt(10.0f, true);   // Pinned
 
-        image.storeFrame(0, grid, opt);
+        if (!image.storeFrame(0, grid, opt)) {
+            luaL_error(L, "Not a valid PNG image file: '%s'", filename);
+            return;
+        }
         pool.makeFixed();
 
         fixed = true;
@@ -507,6 +756,18 @@ Group::Group(lua_State *L)
         quality = lua_tonumber(L, -1);
     }
 
+    if (Script::argMatch(L, "decode_speed")) {
+        decodeSpeed = lua_tonumber(L, -1);
+    } else {
+        lua_getglobal(L, GLOBAL_DECODE_SPEED);
+        decodeSpeed = lua_tonumber(L, -1);
+    }
+
+    if (Script::argMatch(L, "proof"))
+        proof = lua_toboolean(L, -1);
+    else
+        proof = true;
+
     if (!Script::argEnd(L))
         return;
 
@@ -558,6 +819,11 @@ Image::Image(lua_State *L) : mInList(false)
         mTileOpt.quality = mGroup->getQuality();
     }
 
+    // Zero selects the fast DUB encoder, e.g. "stir dub_effort=0" for dev builds
+    lua_getglobal(L, GLOBAL_DUB_EFFORT);
+    mDUBEffort = lua_tointeger(L, -1) > 0 ? DUBEncoder::EFFORT_OPTIMAL : DUBEncoder::EFFORT_FAST;
+    lua_pop(L, 1);
+
     if (Script::argMatch(L, "frames"))
         mImages.setFrames(lua_tointeger(L, -1));
     if (Script::argMatch(L, "width"))
@@ -626,7 +892,10 @@ Image::Image(lua_State *L) : mInList(false)
         return;
     }
 
-    createGrids();
+    if (!createGrids()) {
+        luaL_error(L, "Failed to decode PNG image data");
+        return;
+    }
 }
 
 int Image::width(lua_State *L)
@@ -659,14 +928,17 @@ int Image::group(lua_State *L)
     return 1;
 }
 
-void Image::createGrids()
+bool Image::createGrids()
 {
     mGrids.clear();
 
     for (unsigned frame = 0; frame < mImages.getFrames(); frame++) {
         mGrids.push_back(TileGrid(&mGroup->getPool()));
-        mImages.storeFrame(frame, mGrids.back(), mTileOpt);
+        if (!mImages.storeFrame(frame, mGrids.back(), mTileOpt))
+            return false;
     }
+
+    return true;
 }
 
 const char *Image::getClassName() const
@@ -703,12 +975,30 @@ void Image::encodeFlat(std::vector<uint16_t> &data) const
 }
 
 bool Image::encodeDUB(std::vector<uint16_t> &data, Logger &log, std::string &format) const
+{
+    if (!mDUB.valid)
+        return runDUB(data, log, format);
+
+    mDUB.log.replay(log);
+    data = mDUB.data;
+    format = mDUB.format;
+    return mDUB.ok;
+}
+
+void Image::prepareDUB()
+{
+    mDUB.ok = runDUB(mDUB.data, mDUB.log, mDUB.format);
+    mDUB.valid = true;
+}
+
+bool Image::runDUB(std::vector<uint16_t> &data, Logger &log, std::string &format) const
 {
     // Compressed image, encoded using the DUB codec.
     
     DUBEncoder encoder( mImages.getWidth() / Tile::SIZE,
                         mImages.getHeight() / Tile::SIZE,
-                        mImages.getFrames() );
+                        mImages.getFrames(),
+                        mDUBEffort );
 
     std::vector<uint16_t> tiles;
     encodeFlat(tiles);
@@ -739,6 +1029,7 @@ bool Image::encodeDUB(std::vector<uint16_t> &data, Logger &log, std::string &for
 }
 
 Sound::Sound(lua_State *L)
+    : mOutputSampleRate(0), mNumSamples(0), mTypeSymbol(NULL)
 {
     if (!Script::argBegin(L, className))
         return;
@@ -796,6 +1087,93 @@ Sound::Sound(lua_State *L)
         luaL_error(L, "Invalid audio encoding parameters");
 }
 
+bool Sound::compress(Logger &log, const BuildCache &cache)
+{
+    AudioEncoder *enc = AudioEncoder::create(getEncode());
+    assert(enc != 0);
+
+    CacheKey key("sound");
+    key.add(getEncode());
+    key.addValue(getSampleRate());
+    bool cacheable = cache.isEnabled() && key.addFile(getFile());
+
+    CacheBlob blob;
+    if (cacheable && cache.load(key, blob) &&
+        blob.readValue(mOutputSampleRate) &&
+        blob.readValue(mNumSamples) &&
+        blob.readVector(mData) &&
+        blob.atEnd() && !mData.empty()) {
+
+        mTypeSymbol = enc->getTypeSymbol();
+        log.infoLineWithLabel(getName().c_str(),
+            "%7.02f kiB, %s (%s, cached)",
+            mData.size() / 1024.0f, enc->getName(), getFile().c_str());
+
+        delete enc;
+        return true;
+    }
+
+    std::vector<uint8_t> raw;
+
+    std::string filepath = getFile();
+    unsigned sz = filepath.size();
+
+    /*
+     * If the sample rate has not been explicitly specified in assets.lua,
+     * and we have a WAV file, default to its native sample rate.
+     *
+     * Otherwise, use the standard 16kHz sample rate.
+     */
+    uint32_t sampleRate = getSampleRate();
+
+    if (sz >= 4 && filepath.substr(sz - 4) == ".wav") {
+        uint32_t waveNativeSampleRate;
+        if (!WaveDecoder::loadFile(raw, waveNativeSampleRate, filepath, log)) {
+            delete enc;
+            return false;
+        }
+
+        if (sampleRate == UNSPECIFIED_SAMPLE_RATE) {
+            sampleRate = waveNativeSampleRate;
+        }
+    }
+    else {
+        LodePNG::loadFile(raw, filepath);
+    }
+
+    if (sampleRate == UNSPECIFIED_SAMPLE_RATE) {
+        sampleRate = STANDARD_SAMPLE_RATE;
+    }
+
+    mOutputSampleRate = sampleRate;
+    mNumSamples = raw.size() / sizeof(int16_t);
+    mTypeSymbol = enc->getTypeSymbol();
+
+    mData.clear();
+    enc->encode(raw, mData);
+
+    log.infoLineWithLabel(getName().c_str(),
+        "%7.02f kiB, %s (%s)",
+        mData.size() / 1024.0f, enc->getName(), getFile().c_str());
+
+    delete enc;
+
+    if (mData.empty()) {
+        log.error("Error encoding audio file '%s'", getFile().c_str());
+        return false;
+    }
+
+    if (cacheable) {
+        CacheBlob result;
+        result.writeValue(mOutputSampleRate);
+        result.writeValue(mNumSamples);
+        result.writeVector(mData);
+        cache.store(key, result);
+    }
+
+    return true;
+}
+
 Tracker::Tracker(lua_State *L)
 {
     if (!Script::argBegin(L, className))
@@ -42,6 +42,8 @@ extern "C" {
 #include "imagestack.h"
 #include "sifteo/abi.h"
 #include "tracker.h"
+#include "buildcache.h"
+#include "dubencoder.h"
 
 #include <iostream>
 
@@ -71,6 +73,8 @@ public:
 
     bool addOutput(const char *filename);
     void setVariable(const char *key, const char *value);
+    void setNumThreads(unsigned n);
+    void setCacheDirectory(const char *dir);
 
  private:
     lua_State *L;
@@ -80,6 +84,9 @@ public:
     const char *outputHeader;
     const char *outputSource;
     const char *outputProof;
+    const char *outputBinary;
+    unsigned numThreads;
+    BuildCache cache;
 
     std::set<Group*> groups;
     std::set<Tracker*> trackers;
@@ -127,6 +134,10 @@ public:
         return quality;
     }
 
+    lua_Number getDecodeSpeed() const {
+        return decodeSpeed;
+    }
+
     const TilePool &getPool() const {
         return pool;
     }
@@ -139,6 +150,10 @@ public:
         return fixed;
     }
 
+    bool hasProof() const {
+        return proof;
+    }
+
     void setName(const char *s) {
         mName = s;
     }
@@ -168,8 +183,10 @@ public:
 
 private:
     lua_Number quality;
+    lua_Number decodeSpeed;
     TilePool pool;
     bool fixed;
+    bool proof;
     std::string mName;
     std::set<Image*> mImages;
     std::vector<uint8_t> mLoadstream;
@@ -232,7 +249,21 @@ public:
     void encodeFlat(std::vector<uint16_t> &data) const;
     bool encodeDUB(std::vector<uint16_t> &data, Logger &log, std::string &format) const;
 
+    // Run the DUB encoder ahead of time, e.g. on a worker thread.
+    // Afterwards, encodeDUB() just hands back the stored result.
+    void prepareDUB();
+
  private:
+    struct DUBResult {
+        DUBResult() : valid(false), ok(false) {}
+
+        bool valid;
+        bool ok;
+        std::vector<uint16_t> data;
+        std::string format;
+        BufferedLogger log;
+    };
+
     Group *mGroup;
     ImageStack mImages;
     TileOptions mTileOpt;
@@ -240,8 +271,11 @@ public:
     std::string mName;
     bool mIsFlat;
     bool mInList;
+    DUBEncoder::Effort mDUBEffort;
+    DUBResult mDUB;
 
-    void createGrids();
+    bool createGrids();
+    bool runDUB(std::vector<uint16_t> &data, Logger &log, std::string &format) const;
 
     int width(lua_State *L);
     int height(lua_State *L);
@@ -369,6 +403,26 @@ public:
         return mVolume;
     }
 
+    // Load and encode the audio data, or reuse a cached result. Results
+    // are available from the accessors below once this succeeds.
+    bool compress(Logger &log, const BuildCache &cache);
+
+    const std::vector<uint8_t> &getData() const {
+        return mData;
+    }
+
+    uint32_t getOutputSampleRate() const {
+        return mOutputSampleRate;
+    }
+
+    uint32_t getNumSamples() const {
+        return mNumSamples;
+    }
+
+    const char *getTypeSymbol() const {
+        return mTypeSymbol;
+    }
+
 private:
     std::string mName;
     std::string mFile;
@@ -378,6 +432,11 @@ private:
     uint32_t mLoopLength;
     uint16_t mVolume;
     _SYSAudioLoopType mLoopType;
+
+    std::vector<uint8_t> mData;
+    uint32_t mOutputSampleRate;
+    uint32_t mNumSamples;
+    const char *mTypeSymbol;
 };
 
 class Tracker {
@@ -0,0 +1,116 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * STIR -- Sifteo Tiled Image Reducer
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "threadpool.h"
+#include "tinythread.h"
+
+namespace Stir {
+
+namespace {
+
+    struct WorkQueue {
+        const std::vector<ThreadPool::Job*> *jobs;
+        unsigned next;
+        tthread::mutex mutex;
+    };
+
+}
+
+ThreadPool::Job::~Job() {}
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : mNumThreads(std::max(1u, numThreads))
+{}
+
+unsigned ThreadPool::hardwareThreads()
+{
+    return std::max(1u, tthread::thread::hardware_concurrency());
+}
+
+void ThreadPool::worker(void *arg)
+{
+    WorkQueue *queue = static_cast<WorkQueue*>(arg);
+
+    for (;;) {
+        Job *job;
+        {
+            tthread::lock_guard<tthread::mutex> guard(queue->mutex);
+            if (queue->next >= queue->jobs->size())
+                return;
+            job = (*queue->jobs)[queue->next++];
+        }
+        job->run();
+    }
+}
+
+void ThreadPool::run(const std::vector<Job*> &jobs)
+{
+    unsigned numThreads = std::min<unsigned>(mNumThreads, jobs.size());
+
+    if (numThreads <= 1) {
+        for (std::vector<Job*>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+            (*i)->run();
+        return;
+    }
+
+    WorkQueue queue;
+    queue.jobs = &jobs;
+    queue.next = 0;
+
+    std::vector<tthread::thread*> threads;
+    for (unsigned i = 1; i < numThreads; ++i)
+        threads.push_back(new tthread::thread(worker, &queue));
+
+    worker(&queue);
+
+    for (std::vector<tthread::thread*>::iterator i = threads.begin(); i != threads.end(); ++i) {
+        (*i)->join();
+        delete *i;
+    }
+}
+
+Mutex::Mutex()
+    : mImpl(new tthread::mutex())
+{}
+
+Mutex::~Mutex()
+{
+    delete static_cast<tthread::mutex*>(mImpl);
+}
+
+void Mutex::lock()
+{
+    static_cast<tthread::mutex*>(mImpl)->lock();
+}
+
+void Mutex::unlock()
+{
+    static_cast<tthread::mutex*>(mImpl)->unlock();
+}
+
+};  // namespace Stir
@@ -0,0 +1,113 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * STIR -- Sifteo Tiled Image Reducer
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <vector>
+
+namespace Stir {
+
+
+/*
+ * ThreadPool --
+ *
+ *    Runs a batch of independent jobs, spread across a fixed number
+ *    of threads. The calling thread does its share of the work too,
+ *    and run() returns only after every job has finished.
+ *
+ *    With a single thread, jobs run inline in their original order.
+ *    Jobs are always handed out in order, but they may finish in any
+ *    order; anything order-dependent (like logging) should be
+ *    buffered by the job and handled by the caller afterwards.
+ */
+
+class ThreadPool {
+ public:
+    class Job {
+     public:
+        virtual ~Job();
+        virtual void run() = 0;
+    };
+
+    ThreadPool(unsigned numThreads=1);
+
+    void run(const std::vector<Job*> &jobs);
+
+    unsigned getNumThreads() const {
+        return mNumThreads;
+    }
+
+    static unsigned hardwareThreads();
+
+ private:
+    unsigned mNumThreads;
+
+    static void worker(void *arg);
+};
+
+
+/*
+ * Mutex --
+ *
+ *    Minimal mutex, for shared state touched by ThreadPool jobs. This
+ *    wraps TinyThread++ without exposing its platform headers to the
+ *    rest of STIR.
+ */
+
+class Mutex {
+ public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+    class Guard {
+     public:
+        Guard(Mutex &m) : mMutex(m) {
+            mMutex.lock();
+        }
+
+        ~Guard() {
+            mMutex.unlock();
+        }
+
+     private:
+        Mutex &mMutex;
+    };
+
+ private:
+    void *mImpl;
+
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+};
+
+
+};  // namespace Stir
+
+#endif
@@ -31,9 +31,13 @@
 #include <set>
 #include <map>
 #include <math.h>
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
 
 #include "tile.h"
 #include "tilecodec.h"
+#include "buildcache.h"
 
 
 /*
@@ -63,16 +67,30 @@ namespace Stir {
 
 std::tr1::unordered_map<Tile::Identity, TileRef> Tile::instances;
 
+Mutex Tile::instancesMutex;
+
 Tile::Tile(const Identity &id)
-    : mHasSobel(false), mHasDec4(false), mID(id)
-    {}
+    : mID(id)
+{
+    /*
+     * Derived data is built up front rather than lazily, so that a
+     * Tile really is immutable once it's shared. Groups are optimized
+     * on separate threads, and they can share Tile instances.
+     */
+
+    constructPalette();
+    constructLab();
+    constructSobel();
+    constructDec4();
+}
 
 TileRef Tile::instance(const Identity &id)
 {
     /*
      * Return an existing Tile matching the given identity, or create a new one if necessary.
      */
-     
+
+    Mutex::Guard guard(instancesMutex);
     std::tr1::unordered_map<Identity, TileRef>::iterator i = instances.find(id);
         
     if (i == instances.end()) {
@@ -194,6 +212,16 @@ void Tile::constructPalette(void)
     }
 }
 
+void Tile::constructLab()
+{
+    for (unsigned i = 0; i < PIXELS; i++) {
+        CIELab lab(mID.pixels[i]);
+        mLabL[i] = lab.L;
+        mLabA[i] = lab.a;
+        mLabB[i] = lab.b;
+    }
+}
+
 void Tile::constructSobel()
 {
     /*
@@ -202,7 +230,6 @@ void Tile::constructSobel()
      * See: http://en.wikipedia.org/wiki/Sobel_operator
      */
 
-    mHasSobel = true;
     mSobelTotal = 0;
 
     unsigned i = 0;
@@ -245,8 +272,6 @@ void Tile::constructDec4()
     const unsigned scale = SIZE / 2;
     unsigned i = 0;
 
-    mHasDec4 = true;
-
     for (unsigned y1 = 0; y1 < SIZE; y1 += scale)
         for (unsigned x1 = 0; x1 < SIZE; x1 += scale) {
             CIELab acc;
@@ -277,36 +302,71 @@ double Tile::errorMetric(Tile &other, double limit)
      *
      * If we exceed 'limit', the test can exit early. This lets us
      * calculate the easy metrics first, and skip the rest if we're
-     * already over.
+     * already over. The per-pixel metrics are checked every few
+     * pixels too; their terms are all non-negative and summed in the
+     * same order as fineMSE() and sobelError(), so a partial sum over
+     * the limit means the full one would be as well.
      */
 
+    const unsigned block = PIXELS / 4;
     double error = 0;
 
     error += 0.450 * coarseMSE(other);
     if (error > limit)
         return DBL_MAX;
 
-    error += 0.025 * fineMSE(other);
-    if (error > limit)
-        return DBL_MAX;
-
-    error += 5.00 * sobelError(other);
+    double fine = 0;
+    for (unsigned i = 0; i < PIXELS; i += block) {
+        fine = fineSum(other, i, i + block, fine);
+        if (error + 0.025 * (fine / PIXELS) > limit)
+            return DBL_MAX;
+    }
+    error += 0.025 * (fine / PIXELS);
+
+    double sobel = 0;
+    double contrast = 1 + mSobelTotal + other.mSobelTotal;
+    for (unsigned i = 0; i < PIXELS; i += block) {
+        sobel = sobelSum(other, i, i + block, sobel);
+        if (error + 5.00 * (sobel / contrast) > limit)
+            return DBL_MAX;
+    }
+    error += 5.00 * (sobel / contrast);
 
     return error * 60.0;
 }
 
-double Tile::fineMSE(Tile &other)
+double Tile::errorLowerBound(Tile &other)
 {
     /*
-     * A normal pixel-wise mean squared error metric.
+     * Every term in errorMetric() is non-negative, so its coarse term
+     * alone is a cheap lower bound. This is evaluated in the same order
+     * as errorMetric(), so rounding can't push it above the real thing.
      */
 
-    double error = 0;
+    return 0.450 * coarseMSE(other) * 60.0;
+}
 
-    for (unsigned i = 0; i < PIXELS; i++)
-        error += CIELab(mID.pixels[i]).meanSquaredError(CIELab(other.mID.pixels[i]));
+CIELab Tile::coarseMean()
+{
+    /*
+     * Average color of the 2x2 decimated tile, for spatial indexing.
+     */
+
+    CIELab acc;
+    for (unsigned i = 0; i < 4; i++)
+        acc += mDec4[i];
 
-    return error / PIXELS;
+    acc /= 4;
+    return acc;
+}
+
+double Tile::fineMSE(Tile &other)
+{
+    /*
+     * A normal pixel-wise mean squared error metric.
+     */
+
+    return fineSum(other, 0, PIXELS, 0) / PIXELS;
 }
 
 double Tile::coarseMSE(Tile &other)
@@ -317,11 +377,6 @@ double Tile::coarseMSE(Tile &other)
 
     double error = 0;
 
-    if (!mHasDec4)
-        constructDec4();
-    if (!other.mHasDec4)
-        other.constructDec4();
-
     for (unsigned i = 0; i < 4; i++)
         error += mDec4[i].meanSquaredError(other.mDec4[i]);
 
@@ -335,22 +390,60 @@ double Tile::sobelError(Tile &other)
      * differences using the Sobel operator.
      */
 
-    double error = 0;
+    double error = sobelSum(other, 0, PIXELS, 0);
 
-    if (!mHasSobel)
-        constructSobel();
-    if (!other.mHasSobel)
-        other.constructSobel();
+    // Contrast difference over total contrast
+    return error / (1 + mSobelTotal + other.mSobelTotal);
+}
 
-    for (unsigned i = 0; i < PIXELS; i++) {
+/*
+ * The SSE2 kernels compute two pixels' terms at once, but still add
+ * them to the sum one at a time, in pixel order. That keeps results
+ * bit-identical to the portable loops, so asset output doesn't depend
+ * on the host CPU. 'begin' and 'end' must be even.
+ */
+
+double Tile::fineSum(const Tile &other, unsigned begin, unsigned end, double sum) const
+{
+#ifdef __SSE2__
+    for (unsigned i = begin; i < end; i += 2) {
+        __m128d dL = _mm_sub_pd(_mm_loadu_pd(mLabL + i), _mm_loadu_pd(other.mLabL + i));
+        __m128d da = _mm_sub_pd(_mm_loadu_pd(mLabA + i), _mm_loadu_pd(other.mLabA + i));
+        __m128d db = _mm_sub_pd(_mm_loadu_pd(mLabB + i), _mm_loadu_pd(other.mLabB + i));
+        __m128d t = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dL, dL), _mm_mul_pd(da, da)),
+                               _mm_mul_pd(db, db));
+        sum += _mm_cvtsd_f64(t);
+        sum += _mm_cvtsd_f64(_mm_unpackhi_pd(t, t));
+    }
+#else
+    for (unsigned i = begin; i < end; i++) {
+        double dL = mLabL[i] - other.mLabL[i];
+        double da = mLabA[i] - other.mLabA[i];
+        double db = mLabB[i] - other.mLabB[i];
+        sum += dL * dL + da * da + db * db;
+    }
+#endif
+    return sum;
+}
+
+double Tile::sobelSum(const Tile &other, unsigned begin, unsigned end, double sum) const
+{
+#ifdef __SSE2__
+    for (unsigned i = begin; i < end; i += 2) {
+        __m128d gx = _mm_sub_pd(_mm_loadu_pd(mSobelGx + i), _mm_loadu_pd(other.mSobelGx + i));
+        __m128d gy = _mm_sub_pd(_mm_loadu_pd(mSobelGy + i), _mm_loadu_pd(other.mSobelGy + i));
+        __m128d t = _mm_add_pd(_mm_mul_pd(gx, gx), _mm_mul_pd(gy, gy));
+        sum += _mm_cvtsd_f64(t);
+        sum += _mm_cvtsd_f64(_mm_unpackhi_pd(t, t));
+    }
+#else
+    for (unsigned i = begin; i < end; i++) {
         double gx = mSobelGx[i] - other.mSobelGx[i];
         double gy = mSobelGy[i] - other.mSobelGy[i];
-
-        error += gx * gx + gy * gy;
+        sum += gx * gx + gy * gy;
     }
-    
-    // Contrast difference over total contrast
-    return error / (1 + mSobelTotal + other.mSobelTotal);
+#endif
+    return sum;
 }
 
 TileRef Tile::reduce(ColorReducer &reducer) const
@@ -394,7 +487,7 @@ const char *TilePalette::colorModeName(ColorMode m)
 }
 
 TileStack::TileStack()
-    : index(NO_INDEX), mPinned(false), mLossless(false)
+    : index(NO_INDEX), order(0), gridCell(0), mPinned(false), mLossless(false)
     {}
 
 void TileStack::add(TileRef t)
@@ -471,23 +564,123 @@ void TileStack::computeMedian()
     }
 }
 
+const double TileStackGrid::CELL_SIZE = 4.0;
+
+bool TileStackGrid::orderLess(const TileStack *a, const TileStack *b)
+{
+    return a->order < b->order;
+}
+
+void TileStackGrid::clear()
+{
+    cells.clear();
+    count = 0;
+}
+
+void TileStackGrid::insert(TileStack *s)
+{
+    CIELab mean = s->median()->coarseMean();
+
+    s->gridCell = cellKey(cellCoord(mean.L), cellCoord(mean.a), cellCoord(mean.b));
+    cells[s->gridCell].push_back(s);
+    count++;
+}
+
+void TileStackGrid::remove(TileStack *s)
+{
+    Cell &cell = cells[s->gridCell];
+    Cell::iterator i = std::find(cell.begin(), cell.end(), s);
+
+    assert(i != cell.end());
+    cell.erase(i);
+    count--;
+}
+
+bool TileStackGrid::find(Tile &t, double distance, std::vector<TileStack*> &result)
+{
+    /*
+     * Tile::errorLowerBound() is 27/4 of the squared distance between
+     * two decimated tiles, taken as 12-dimensional vectors. Any stack
+     * within 'distance' therefore has a mean color within
+     * sqrt(distance / 27) of ours on every axis. Pad that slightly
+     * for rounding, and visit only the cells it overlaps.
+     */
+
+    double radius = sqrt(std::max(0.0, distance) / 27.0) * 1.001 + 1e-6;
+    CIELab center = t.coarseMean();
+    double lo[3], hi[3];
+    double numCells = 1;
+
+    for (unsigned i = 0; i < 3; i++) {
+        lo[i] = floor((center.axis[i] - radius) / CELL_SIZE);
+        hi[i] = floor((center.axis[i] + radius) / CELL_SIZE);
+        numCells *= hi[i] - lo[i] + 1;
+    }
+
+    if (numCells > count)
+        return false;
+
+    result.clear();
+
+    for (int l = lo[0]; l <= hi[0]; l++)
+        for (int a = lo[1]; a <= hi[1]; a++)
+            for (int b = lo[2]; b <= hi[2]; b++) {
+                std::tr1::unordered_map<uint64_t, Cell>::iterator i = cells.find(cellKey(l, a, b));
+                if (i != cells.end())
+                    result.insert(result.end(), i->second.begin(), i->second.end());
+            }
+
+    std::sort(result.begin(), result.end(), orderLess);
+    return true;
+}
+
+TileStack* TilePool::newStack(TileRef t)
+{
+    stackList.push_back(TileStack());
+    TileStack *c = &stackList.back();
+
+    c->add(t);
+    c->order = numStacks++;
+    stackGrid.insert(c);
+
+    return c;
+}
+
 TileStack* TilePool::closest(TileRef t, double distance)
 {
     /*
      * Search for the closest tile set for the provided tile image.
      * Returns the tile stack, if any was found which meets the tile's
      * stated maximum MSE requirement.
+     *
+     * Candidates come from stackGrid when it can narrow things down,
+     * and either way they're visited in stackList order. Stacks whose
+     * errorLowerBound() is already over the distance are skipped before
+     * paying for the full errorMetric(). They could never have been
+     * chosen, so the result is identical to a plain linear scan.
      */
 
     const double epsilon = 1e-3;
     TileStack *closest = NULL;
+    std::vector<TileStack*> candidates;
+
+    if (!stackGrid.find(*t, distance, candidates)) {
+        candidates.reserve(stackList.size());
+        for (std::list<TileStack>::iterator i = stackList.begin(); i != stackList.end(); i++)
+            candidates.push_back(&*i);
+    }
+
+    for (std::vector<TileStack*>::iterator i = candidates.begin(); i != candidates.end(); i++) {
+        TileRef median = (*i)->median();
+
+        if (median->errorLowerBound(*t) > distance)
+            continue;
 
-    for (std::list<TileStack>::iterator i = stackList.begin(); i != stackList.end(); i++) {
-        double err = i->median()->errorMetric(*t, distance);
+        double err = median->errorMetric(*t, distance);
 
         if (err <= distance) {
             distance = err;
-            closest = &*i;
+            closest = *i;
 
             if (distance < epsilon) {
                 // Not going to improve on this; early out.
@@ -594,13 +787,12 @@ void TilePool::optimizeFixedTiles(Logger &log)
      */
 
     stackList.clear();
+    stackGrid.clear();
     stackIndex.resize(numFixed);
     stackArray.resize(numFixed);
 
     for (unsigned i = 0; i < numFixed; ++i) {
-        stackList.push_back(TileStack());
-        TileStack *c = &stackList.back();
-        c->add(tiles[i]);
+        TileStack *c = newStack(tiles[i]);
         c->index = i;
         stackArray[i] = c;
         stackIndex[i] = c;
@@ -636,6 +828,7 @@ void TilePool::optimizeFixedTiles(Logger &log)
         }
     }
 
+    stackGrid.clear();
     log.taskEnd();
 }
 
@@ -662,6 +855,7 @@ void TilePool::optimizeTiles(Logger &log)
     std::tr1::unordered_set<TileStack *> activeStacks;
 
     stackList.clear();
+    stackGrid.clear();
     stackIndex.clear();
     stackIndex.resize(tiles.size());
 
@@ -676,6 +870,9 @@ void TilePool::optimizeTiles(Logger &log)
     log.taskBegin("Optimizing tiles");
     optimizeTilesPass(log, activeStacks, false, false);
     log.taskEnd();
+
+    // Later stages modify and reorder stacks; the grid is only for closest()
+    stackGrid.clear();
 }
     
 void TilePool::optimizeTilesPass(Logger &log,
@@ -725,12 +922,11 @@ void TilePool::optimizeTilesPass(Logger &log,
 
             if (!c) {
                 // Need to create a fresh stack
-                stackList.push_back(TileStack());
-                c = &stackList.back();
-                c->add(tr);
+                c = newStack(tr);
             } else if (gather) {
-                // Add to an existing stack
+                // Add to an existing stack, which moves its median
                 c->add(tr);
+                stackGrid.update(c);
             }
 
             if (!gather || pinned) {
@@ -758,8 +954,10 @@ void TilePool::optimizeTilesPass(Logger &log,
             std::list<TileStack>::iterator j = i;
             i++;
 
-            if (!activeStacks.count(&*j))
+            if (!activeStacks.count(&*j)) {
+                stackGrid.remove(&*j);
                 stackList.erase(j);
+            }
         }
     }
 }
@@ -918,9 +1116,9 @@ void TilePool::optimizeOrder(Logger &log)
     log.taskEnd();
 }
 
-void TilePool::encode(std::vector<uint8_t>& out, Logger *log)
+void TilePool::encode(std::vector<uint8_t>& out, Logger *log, double decodeWeight)
 {
-    TileCodec codec(out);
+    TileCodec codec(out, decodeWeight);
 
     if (log) {
         log->taskBegin("Encoding tiles");
@@ -993,5 +1191,99 @@ void TilePool::calculateCRC(std::vector<uint8_t> &crcbuf) const
     }
 }
 
+void TilePool::hashInputs(CacheKey &key) const
+{
+    /*
+     * optimize() depends only on our input tiles, in serial order,
+     * including their per-tile options.
+     */
+
+    key.addValue<uint32_t>(numFixed);
+    key.addValue<uint32_t>(tiles.size());
+
+    for (std::vector<TileRef>::const_iterator i = tiles.begin(); i != tiles.end(); ++i) {
+        const Tile &t = **i;
+        uint16_t pixels[Tile::PIXELS];
+
+        for (unsigned p = 0; p < Tile::PIXELS; p++)
+            pixels[p] = t.pixel(p).value;
+
+        key.add(pixels, sizeof pixels);
+        key.addValue(t.options().quality);
+        key.addValue<uint8_t>(t.options().pinned);
+        key.addValue<uint8_t>(t.options().chromaKey);
+    }
+}
+
+void TilePool::save(CacheBlob &blob) const
+{
+    /*
+     * The optimized pool is just its final tile images, in index
+     * order, plus the index that each serial number maps to.
+     */
+
+    blob.writeValue<uint32_t>(size());
+
+    for (unsigned i = 0; i < size(); i++) {
+        TileRef t = tile(i);
+        for (unsigned p = 0; p < Tile::PIXELS; p++)
+            blob.writeValue<uint16_t>(t->pixel(p).value);
+    }
+
+    std::vector<uint16_t> indices;
+    for (Serial s = 0; s < tiles.size(); s++)
+        indices.push_back(index(s));
+    blob.writeVector(indices);
+}
+
+bool TilePool::load(CacheBlob &blob)
+{
+    /*
+     * Everything is validated before we touch the pool, so on failure
+     * it's left untouched and can still be optimized normally. The
+     * pool must be the last thing in the blob.
+     */
+
+    uint32_t count;
+    std::vector<TileRef> medians;
+    std::vector<uint16_t> indices;
+
+    if (!blob.readValue(count))
+        return false;
+
+    for (unsigned i = 0; i < count; i++) {
+        Tile::Identity id;
+        for (unsigned p = 0; p < Tile::PIXELS; p++)
+            if (!blob.readValue(id.pixels[p].value))
+                return false;
+        medians.push_back(Tile::instance(id));
+    }
+
+    if (!blob.readVector(indices) || !blob.atEnd() || indices.size() != tiles.size())
+        return false;
+    for (unsigned s = 0; s < indices.size(); s++)
+        if (indices[s] >= count)
+            return false;
+
+    stackList.clear();
+    stackGrid.clear();
+    stackArray.clear();
+    stackIndex.clear();
+
+    for (unsigned i = 0; i < count; i++) {
+        stackList.push_back(TileStack());
+        TileStack *c = &stackList.back();
+        c->replace(medians[i]);
+        c->index = i;
+        c->order = i;
+        stackArray.push_back(c);
+    }
+    numStacks = count;
+
+    for (Serial s = 0; s < tiles.size(); s++)
+        stackIndex.push_back(stackArray[indices[s]]);
+
+    return true;
+}
 
 };  // namespace Stir
@@ -30,17 +30,21 @@
 #include <stdint.h>
 #include <float.h>
 #include <string.h>
+#include <math.h>
 #include <tr1/memory>
 #include <tr1/unordered_set>
 #include <tr1/unordered_map>
 
 #include "color.h"
 #include "logger.h"
+#include "threadpool.h"
 
 namespace Stir {
 
 class Tile;
 class TileStack;
+class CacheKey;
+class CacheBlob;
 typedef std::tr1::shared_ptr<Tile> TileRef;
 
 
@@ -172,18 +176,17 @@ class Tile {
         return pixel(x & 7, y & 7);
     }
 
-    const TilePalette &palette() {
-        // Lazily build the palette info
-        if (!mPalette.numColors)
-            constructPalette();
+    const TilePalette &palette() const {
         return mPalette;
-    }   
+    }
 
     const TileOptions &options() const {
         return mID.options;
     }
 
     double errorMetric(Tile &other, double limit=DBL_MAX);
+    double errorLowerBound(Tile &other);
+    CIELab coarseMean();
 
     double fineMSE(Tile &other); 
     double coarseMSE(Tile &other);
@@ -195,18 +198,29 @@ class Tile {
     Tile(const Identity &id);
 
     static std::tr1::unordered_map<Identity, TileRef> instances;
+    static Mutex instancesMutex;
     
     void constructPalette();
+    void constructLab();
     void constructSobel();
     void constructDec4();
 
+    // Error metric kernels. Each adds per-pixel terms for pixels
+    // [begin, end) onto 'sum', strictly in pixel order.
+    double fineSum(const Tile &other, unsigned begin, unsigned end, double sum) const;
+    double sobelSum(const Tile &other, unsigned begin, unsigned end, double sum) const;
+
     friend class TileStack;
-    
-    bool mHasSobel;
-    bool mHasDec4;
+
     TilePalette mPalette;
     Identity mID;
     CIELab mDec4[4];
+
+    // Per-pixel CIELab color, stored as separate planes for SIMD
+    double mLabL[PIXELS];
+    double mLabA[PIXELS];
+    double mLabB[PIXELS];
+
     double mSobelGx[PIXELS];
     double mSobelGy[PIXELS];
     double mSobelTotal;
@@ -259,10 +273,13 @@ class TileStack {
     static const unsigned NO_INDEX = (unsigned)-1;
 
     friend class TilePool;
+    friend class TileStackGrid;
 
     std::vector<TileRef> tiles;
     TileRef cache;
     unsigned index;
+    unsigned order;         // Creation order, matches position in TilePool::stackList
+    uint64_t gridCell;      // Current TileStackGrid cell, valid while indexed
     bool mPinned;
     bool mLossless;
 
@@ -270,6 +287,61 @@ class TileStack {
 };
 
 
+/*
+ * TileStackGrid --
+ *
+ *    A coarse spatial index over TileStack medians, used to prune
+ *    TilePool::closest() searches.
+ *
+ *    Stacks are bucketed on a uniform grid by the mean CIELab color of
+ *    their median's decimated 2x2 image. Tile::errorLowerBound() limits
+ *    how far that mean can move for any stack within a given error
+ *    distance, so a query only has to visit nearby cells. Everything
+ *    else could never have passed errorMetric() anyway.
+ *
+ *    Candidates are returned in creation order, so a search over the
+ *    grid visits stacks in the same order as a linear scan and picks
+ *    exactly the same winner.
+ */
+
+class TileStackGrid {
+ public:
+    TileStackGrid() : count(0) {}
+
+    void clear();
+    void insert(TileStack *s);
+    void remove(TileStack *s);
+
+    void update(TileStack *s) {
+        // The stack's median changed, move it to the right cell
+        remove(s);
+        insert(s);
+    }
+
+    // Returns false if the grid wouldn't beat a linear scan
+    bool find(Tile &t, double distance, std::vector<TileStack*> &result);
+
+ private:
+    static const double CELL_SIZE;
+
+    typedef std::vector<TileStack*> Cell;
+    std::tr1::unordered_map<uint64_t, Cell> cells;
+    unsigned count;
+
+    static bool orderLess(const TileStack *a, const TileStack *b);
+
+    static int cellCoord(double x) {
+        return (int) floor(x / CELL_SIZE);
+    }
+
+    static uint64_t cellKey(int l, int a, int b) {
+        return ((uint64_t)(uint16_t)l << 32) |
+               ((uint64_t)(uint16_t)a << 16) |
+                (uint64_t)(uint16_t)b;
+    }
+};
+
+
 /*
  * TilePool --
  *
@@ -284,11 +356,11 @@ class TilePool {
     // Current value of SysLFS::TILES_PER_ASSET_SLOT from firmware
     static const unsigned MAX_SIZE = 4096;
 
-    TilePool() : numFixed(0) {}
+    TilePool() : numFixed(0), numStacks(0) {}
 
     // Normal optimization flow
     void optimize(Logger &log);
-    void encode(std::vector<uint8_t>& out, Logger *log = NULL);
+    void encode(std::vector<uint8_t>& out, Logger *log = NULL, double decodeWeight = 0);
 
     // All previous tiles are set in stone, no new tiles can be added
     void makeFixed() {
@@ -335,10 +407,18 @@ class TilePool {
 
     void calculateCRC(std::vector<uint8_t> &crcbuf) const;
 
+    // Build cache support. The key covers every input to optimize(),
+    // and a saved pool can be loaded in place of running optimize().
+    void hashInputs(CacheKey &key) const;
+    void save(CacheBlob &blob) const;
+    bool load(CacheBlob &blob);
+
  private:
     unsigned numFixed;
+    unsigned numStacks;                   // Stacks ever created, for TileStack::order
 
     std::list<TileStack> stackList;       // Reorderable list of all stacked tiles
+    TileStackGrid stackGrid;              // Spatial index of 'stackList', during optimizeTiles()
     std::vector<TileStack*> stackArray;   // Vector version of 'stackList', built after indices are known.
     std::vector<TileRef> tiles;           // Current best image for each tile, by Serial
     std::vector<TileStack*> stackIndex;   // Current optimized stack for each tile, by Serial
@@ -352,6 +432,7 @@ class TilePool {
                            std::tr1::unordered_set<TileStack *> &activeStacks,
                            bool gather, bool pinned);
 
+    TileStack *newStack(TileRef t);
     TileStack *closest(TileRef t, double distance);
 };
 
@@ -32,6 +32,30 @@
 
 namespace Stir {
 
+/*
+ * Decoder cost model. These are approximate 8051 cycle counts for the
+ * loadstream state machine in firmware/cube/src/flash_decoder.c,
+ * tallied by hand from its assembly. Flash programming time is the
+ * same for every encoding of a tile, so it isn't counted here.
+ */
+
+static const unsigned CYC_STATE = 14;           // One trip through flash_loop, plus NEXT()
+static const unsigned CYC_DEQUEUE_ST1P = 16;    // flash_dequeue_st1p
+static const unsigned CYC_OPCODE = 29;          // flst_opcode dispatch
+static const unsigned CYC_LUT1 = CYC_OPCODE + 10 + 2 * (CYC_STATE + CYC_DEQUEUE_ST1P);
+static const unsigned CYC_LUT16 = 590;          // Fixed cost, including the 16-entry bitmap walk
+static const unsigned CYC_LUT16_COLOR = 47;     // Each color loaded by LUT16
+static const unsigned CYC_TILE_INIT = 18;       // flash_tile_init, once per tile opcode
+static const unsigned CYC_TILE_BUFFER = 22;     // Re-entering a tile state, once per 16 pixels
+static const unsigned CYC_TILE_P0 = 1064;       // 64 pixels from one LUT entry
+static const unsigned CYC_R4_NYBBLE = 21;       // Un-RLE one nybble from the stream
+static const unsigned CYC_R4_OUT_P1 = 88;       // Output one nybble as 4 pixels
+static const unsigned CYC_R4_OUT_P2 = 47;       // Output one nybble as 2 pixels
+static const unsigned CYC_R4_OUT_P4 = 27;       // Output one nybble as 1 pixel
+static const unsigned CYC_P16_MASK = 13;        // Load one mask byte
+static const unsigned CYC_P16_PIXEL = 20;       // Output one pixel from lut[15]
+static const unsigned CYC_P16_NEW = 33;         // Load a new pixel into lut[15]
+
 TileCodecLUT::TileCodecLUT()
 {
     valid = 0;
@@ -182,28 +206,98 @@ void RLECodec4::encodeRun(std::vector<uint8_t>& out, bool terminal)
     runCount = 0;
 }
 
-TileCodec::TileCodec(std::vector<uint8_t>& buffer)
+TileCodec::TileCodec(std::vector<uint8_t>& buffer, double _decodeWeight)
     : out(buffer), opIsBuffered(false), 
       tileCount(0),
       paddedOutputMin(0), currentAddress(0),
+      decodeWeight(_decodeWeight), totalCycles(0),
       statBucket(TilePalette::CM_INVALID)
 {
     memset(&stats, 0, sizeof stats);
 }
 
+TileCodec::TileCodec(const TileCodec &other, std::vector<uint8_t>& buffer)
+    : out(buffer), dataBuf(other.dataBuf), opIsBuffered(other.opIsBuffered),
+      opcodeBuf(other.opcodeBuf), tileCount(other.tileCount),
+      lut(other.lut), rle(other.rle),
+      paddedOutputMin(other.paddedOutputMin), currentAddress(other.currentAddress),
+      decodeWeight(other.decodeWeight), totalCycles(other.totalCycles),
+      statBucket(other.statBucket)
+{
+    // A fork of another codec's state, writing to a separate buffer.
+    memcpy(&stats, &other.stats, sizeof stats);
+}
+
 void TileCodec::encode(const TileRef tile)
+{
+    /*
+     * Any tile with a color LUT can also be sent as a P16 tile, which
+     * skips the LUT loads and is often cheaper to decode than 4-bit
+     * RLE. Try both on forked codecs, and keep the cheaper one.
+     *
+     * This choice only looks at one tile, and a P16 tile leaves its
+     * colors for later tiles to load. In practice it rarely saves
+     * bytes, so we only consider it when asked to optimize for speed.
+     */
+
+    TilePalette::ColorMode colorMode = tile->palette().colorMode();
+
+    if (decodeWeight > 0 &&
+        (colorMode == TilePalette::CM_LUT2 ||
+         colorMode == TilePalette::CM_LUT4 ||
+         colorMode == TilePalette::CM_LUT16)) {
+
+        unsigned lutBytes, lutCycles, trueBytes, trueCycles;
+        measure(tile, colorMode, lutBytes, lutCycles);
+        measure(tile, TilePalette::CM_TRUE, trueBytes, trueCycles);
+
+        if (isCheaper(trueBytes, trueCycles, lutBytes, lutCycles))
+            colorMode = TilePalette::CM_TRUE;
+    }
+
+    encodeTile(tile, colorMode);
+}
+
+void TileCodec::measure(const TileRef tile, TilePalette::ColorMode colorMode,
+                        unsigned &bytes, unsigned &cycles) const
+{
+    std::vector<uint8_t> scratch;
+    TileCodec fork(*this, scratch);
+
+    fork.encodeTile(tile, colorMode);
+    fork.flushOp();
+
+    bytes = scratch.size();
+    cycles = fork.totalCycles - totalCycles;
+}
+
+bool TileCodec::isCheaper(unsigned bytesA, unsigned cyclesA,
+                          unsigned bytesB, unsigned cyclesB) const
+{
+    double costA = bytesA + cyclesA * decodeWeight * 1e-3;
+    double costB = bytesB + cyclesB * decodeWeight * 1e-3;
+
+    if (costA != costB)
+        return costA < costB;
+    return cyclesA < cyclesB;
+}
+
+void TileCodec::encodeTile(const TileRef tile, TilePalette::ColorMode colorMode)
 {
     currentAddress.linear += FlashAddress::TILE_SIZE;
 
     /*
-     * First off, encode LUT changes.
+     * First off, encode LUT changes. Tiles we're sending as P16
+     * despite having a palette don't need any.
      */
 
     const TilePalette &pal = tile->palette();
-    uint16_t newColors;
-    lut.encode(pal, newColors);
-    if (newColors)
-        encodeLUT(newColors);
+    if (colorMode == pal.colorMode()) {
+        uint16_t newColors;
+        lut.encode(pal, newColors);
+        if (newColors)
+            encodeLUT(newColors);
+    }
 
     /*
      * Now encode the tile bitmap data. We do this in a
@@ -211,7 +305,6 @@ void TileCodec::encode(const TileRef tile)
      * current opcode if we can.
      */
 
-    TilePalette::ColorMode colorMode = pal.colorMode();
     uint8_t tileOpcode;
 
     switch (colorMode) {
@@ -283,6 +376,7 @@ void TileCodec::flushOp()
         }
 
         rle.flush(dataBuf);
+        totalCycles += decodeCycles(opcodeBuf, dataBuf);
 
         out.push_back(opcodeBuf);
         out.insert(out.end(), dataBuf.begin(), dataBuf.end());
@@ -298,11 +392,58 @@ void TileCodec::encodeOp(uint8_t op)
     opcodeBuf = op;
 }
 
+unsigned TileCodec::decodeCycles(uint8_t op, const std::vector<uint8_t> &data)
+{
+    /*
+     * Estimate the decoder's CPU time for one opcode, given all of its
+     * argument bytes. Tile opcodes may cover a run of several tiles.
+     */
+
+    unsigned tiles = (op & FLS_ARG_MASK) + 1;
+    unsigned tileCycles = CYC_OPCODE + CYC_TILE_INIT + tiles * 4 * CYC_TILE_BUFFER;
+    unsigned nybbles = data.size() * 2;
+
+    switch (op & FLS_OP_MASK) {
+    case FLS_OP_LUT1:           return CYC_LUT1;
+    case FLS_OP_LUT16:          return CYC_LUT16 + (data.size() - 2) / 2 * CYC_LUT16_COLOR;
+    case FLS_OP_TILE_P0:        return CYC_OPCODE + CYC_TILE_P0;
+
+    case FLS_OP_TILE_P1_R4:
+        return tileCycles + nybbles * CYC_R4_NYBBLE + tiles * 16 * CYC_R4_OUT_P1;
+    case FLS_OP_TILE_P2_R4:
+        return tileCycles + nybbles * CYC_R4_NYBBLE + tiles * 32 * CYC_R4_OUT_P2;
+    case FLS_OP_TILE_P4_R4:
+        return tileCycles + nybbles * CYC_R4_NYBBLE + tiles * 64 * CYC_R4_OUT_P4;
+
+    case FLS_OP_TILE_P16:
+        return tileCycles + tiles * (8 * CYC_P16_MASK + Tile::PIXELS * CYC_P16_PIXEL)
+            + (data.size() - 8 * tiles) / 2 * CYC_P16_NEW;
+
+    default:                    return CYC_OPCODE;
+    }
+}
+
 void TileCodec::encodeLUT(uint16_t newColors)
 {
-    if (newColors & (newColors - 1)) {
+    /*
+     * A few new colors are both smaller and faster to decode as a
+     * sequence of LUT1 opcodes, since LUT16 has to walk its entire
+     * bitmap. With many colors, LUT16 saves a byte per color.
+     */
+
+    unsigned count = 0;
+    for (unsigned index = 0; index < 16; index++)
+        if (newColors & (1 << index))
+            count++;
+
+    const unsigned lut1Bytes = count * 3;
+    const unsigned lut1Cycles = count * CYC_LUT1;
+    const unsigned lut16Bytes = 3 + count * 2;
+    const unsigned lut16Cycles = CYC_LUT16 + count * CYC_LUT16_COLOR;
+
+    if (isCheaper(lut16Bytes, lut16Cycles, lut1Bytes, lut1Cycles)) {
         /*
-         * More than one new color. Emit FLS_OP_LUT16.
+         * Emit all new colors with one FLS_OP_LUT16.
          */
 
         encodeOp(FLS_OP_LUT16);
@@ -314,14 +455,13 @@ void TileCodec::encodeLUT(uint16_t newColors)
 
     } else {
         /*
-         * Exactly one new color. Use FLS_OP_LUT1.
+         * Emit one FLS_OP_LUT1 per new color.
          */
 
         for (unsigned index = 0; index < 16; index++)
             if (newColors & (1 << index)) {
                 encodeOp(FLS_OP_LUT1 | index);
                 encodeWord(lut.colors[index].value);
-                break;
             }
     }
 }
@@ -441,6 +581,13 @@ void TileCodec::dumpStatistics(Logger &log)
                      ratio);
     }
 
+    unsigned totalTiles = 0;
+    for (int m = 0; m < TilePalette::CM_COUNT; m++)
+        totalTiles += stats[m].tiles;
+
+    log.infoLine("%10s: % 9u cycles, % 5u cycles per tile",
+                 "decoder", totalCycles, totalTiles ? totalCycles / totalTiles : 0);
+
     log.infoEnd();
 }
 
@@ -163,18 +163,32 @@ struct FlashAddress {
  *    format is a "load stream", a sequence of opcodes that can be
  *    sent over the radio to the cube MCU in order to reproduce the
  *    original tile data in flash memory.
+ *
+ *    The cube's 8051 decodes this stream in flash_decoder.c, and
+ *    during asset installation its CPU time is as precious as radio
+ *    bandwidth. We keep a model of the decoder's cycle cost for each
+ *    opcode, and where a tile can be encoded more than one way, we
+ *    pick the encoding with the lowest combined cost. The decodeWeight
+ *    is the number of bytes we're willing to spend in order to save
+ *    1000 decoder cycles. At zero, we optimize for size and use
+ *    cycles only to break ties.
  */
 
 class TileCodec {
  public:
-    TileCodec(std::vector<uint8_t>& buffer);
+    TileCodec(std::vector<uint8_t>& buffer, double decodeWeight = 0);
 
     void encode(const TileRef tile);
     void flush();
 
     void dumpStatistics(Logger &log);
 
+    // Estimated decoder cycles for one complete opcode and its data
+    static unsigned decodeCycles(uint8_t op, const std::vector<uint8_t> &data);
+
  private:
+    TileCodec(const TileCodec &other, std::vector<uint8_t>& buffer);
+
     std::vector<uint8_t>& out;
     std::vector<uint8_t> dataBuf;
 
@@ -185,6 +199,8 @@ class TileCodec {
     RLECodec4 rle;
     unsigned paddedOutputMin;
     FlashAddress currentAddress;
+    double decodeWeight;
+    unsigned totalCycles;
 
     // Stats
     struct {
@@ -196,6 +212,12 @@ class TileCodec {
     
     void newStatsTile(unsigned bucket);
 
+    void encodeTile(const TileRef tile, TilePalette::ColorMode colorMode);
+    void measure(const TileRef tile, TilePalette::ColorMode colorMode,
+                 unsigned &bytes, unsigned &cycles) const;
+    bool isCheaper(unsigned bytesA, unsigned cyclesA,
+                   unsigned bytesB, unsigned cyclesB) const;
+
     void reservePadding(unsigned bytes);
 
     void encodeOp(uint8_t op);
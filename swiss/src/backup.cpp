@@ -27,6 +27,7 @@
 #include "usbprotocol.h"
 #include "progressbar.h"
 #include "swisserror.h"
+#include "basedevice.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -38,7 +39,60 @@
 #endif
 
 
+namespace {
+
+    /*
+     * This is a basic header that describes the geometry of the flash device,
+     * and identifies this file as something that Siftulator knows how to import
+     * with the -F command line option.
+     */
+
+    struct Header {
+        uint64_t    magic;
+        uint32_t    version;
+        uint32_t    fileSize;
+        uint32_t    cube_count;
+        uint32_t    cube_nvmSize;
+        uint32_t    cube_extSize;
+        uint32_t    cube_sectorSize;
+        uint32_t    mc_pageSize;
+        uint32_t    mc_blockSize;
+        uint32_t    mc_capacity;
+        uint32_t    uniqueID;
+        uint32_t    reserved[52];
+    };
+
+    const uint64_t HEADER_MAGIC = 0x534c467974666953LLU;
+
+} // namespace
+
+
 int Backup::run(int argc, char **argv, IODevice &_dev)
+{
+    bool raw = false;
+    const char *path = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--raw")) {
+            raw = true;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = 0;
+            break;
+        }
+    }
+
+    if (!path) {
+        fprintf(stderr, "incorrect args\n");
+        return EINVAL;
+    }
+
+    Backup m(_dev);
+    return m.backup(path, raw);
+}
+
+int Backup::runRestore(int argc, char **argv, IODevice &_dev)
 {
     if (argc != 2) {
         fprintf(stderr, "incorrect args\n");
@@ -46,28 +100,33 @@ int Backup::run(int argc, char **argv, IODevice &_dev)
     }
 
     Backup m(_dev);
-    return m.backup(argv[1]);
+    return m.restore(argv[1]);
 }
 
 Backup::Backup(IODevice &_dev) : dev(_dev) {}
 
-int Backup::backup(const char *path)
+int Backup::backup(const char *path, bool raw)
 {
-    FILE *f = fopen(path, "wb");
-    if (!f) {
+    /*
+     * Backups are compressed by default, in the sparse format Siftulator
+     * reads. Either way, pages the base reports as erased are never
+     * transferred at all.
+     */
+
+    FlashImageWriter image;
+    if (!image.open(path, PAGE_SIZE + DEVICE_SIZE, !raw)) {
         fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
         return ENOENT;
     }
 
     if (!dev.open(IODevice::SIFTEO_VID, IODevice::BASE_PID)) {
+        image.close();
+        unlink(path);
         return ENODEV;
     }
 
-    requestProgress = 0;
-    replyProgress = 0;
-
-    bool success = writeFileHeader(f) && writeFlashContents(f);
-    fclose(f);
+    bool success = writeFileHeader(image) && scanFlash() && writeFlashContents(image);
+    success = image.close() && success;
 
     if (!success) {
         unlink(path);
@@ -77,31 +136,10 @@ int Backup::backup(const char *path)
     return EOK;
 }
 
-bool Backup::writeFileHeader(FILE *f)
+bool Backup::writeFileHeader(FlashImageWriter &image)
 {
-    /*
-     * This is a basic header that describes the geometry of the flash device,
-     * and identifies this file as something that Siftulator knows how to import
-     * with the -F command line option.
-     */
-
-    struct Header {
-        uint64_t    magic;
-        uint32_t    version;
-        uint32_t    fileSize;
-        uint32_t    cube_count;
-        uint32_t    cube_nvmSize;
-        uint32_t    cube_extSize;
-        uint32_t    cube_sectorSize;
-        uint32_t    mc_pageSize;
-        uint32_t    mc_blockSize;
-        uint32_t    mc_capacity;
-        uint32_t    uniqueID;
-        uint32_t    reserved[52];
-    };
-
     static const Header hdr = {
-        0x534c467974666953LLU,      // magic
+        HEADER_MAGIC,               // magic
         1,                          // version
         DEVICE_SIZE + PAGE_SIZE,    // fileSize
         0, 0, 0, 0,                 // (no cubes)
@@ -112,14 +150,111 @@ bool Backup::writeFileHeader(FILE *f)
     };
 
     STATIC_ASSERT(sizeof hdr == PAGE_SIZE);
-    return fwrite(&hdr, sizeof hdr, 1, f) == 1;
+    return image.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof hdr);
+}
+
+bool Backup::sendScanRequest()
+{
+    unsigned address = requestProgress;
+    if (address >= DEVICE_SIZE)
+        return false;
+
+    USBProtocolMsg m(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::FlashDeviceScan;
+    m.append((const uint8_t*) &address, sizeof address);
+
+    requestProgress = address + BLOCK_SIZE;
+
+    dev.writePacket(m.bytes, m.len);
+
+    return true;
+}
+
+bool Backup::readScanReply()
+{
+    USBProtocolMsg m;
+
+    dev.readPacket(m.bytes, m.MAX_LEN, m.len);
+
+    if ((m.header & 0xff) != UsbVolumeManager::FlashDeviceScan && m.payloadLen() == 0) {
+        // Older firmware can't scan. Leave the block marked as in use.
+        replyProgress += BLOCK_SIZE;
+        return true;
+    }
+
+    if ((m.header & 0xff) != UsbVolumeManager::FlashDeviceScan ||
+        m.payloadLen() < sizeof(UsbVolumeManager::FlashDeviceScanReply)) {
+        fprintf(stderr, "\nunexpected response\n");
+        return false;
+    }
+
+    const UsbVolumeManager::FlashDeviceScanReply *reply =
+        m.castPayload<UsbVolumeManager::FlashDeviceScanReply>();
+    if (reply->address >= DEVICE_SIZE || (reply->address % BLOCK_SIZE)) {
+        fprintf(stderr, "\nunexpected response\n");
+        return false;
+    }
+
+    unsigned firstPage = reply->address / PAGE_SIZE;
+    for (unsigned i = 0; i < BLOCK_SIZE / PAGE_SIZE; ++i)
+        erasedPages[firstPage + i] = reply->erasedPages.test(i);
+
+    replyProgress += BLOCK_SIZE;
+    return true;
+}
+
+bool Backup::scanFlash()
+{
+    /*
+     * Find out which pages hold anything at all, one erase block per request.
+     */
+
+    ScopedProgressBar pb(NUM_BLOCKS);
+
+    erasedPages.assign(NUM_PAGES, false);
+    requestProgress = 0;
+    replyProgress = 0;
+
+    for (unsigned i = 0; i < NUM_PENDING_REQUESTS; ++i)
+        sendScanRequest();
+
+    while (1) {
+        dev.processEvents(1);
+
+        while (dev.numPendingINPackets() != 0) {
+            if (!readScanReply())
+                return false;
+
+            pb.update(replyProgress / BLOCK_SIZE);
+            sendScanRequest();
+            if (replyProgress == DEVICE_SIZE)
+                return true;
+        }
+    }
 }
 
 bool Backup::sendRequest()
 {
+    /*
+     * Request the next run of data, skipping over erased pages. A read
+     * may cover the end of one page and the start of the next, as long
+     * as neither is erased.
+     */
+
     unsigned offset = requestProgress;
-    if (offset >= DEVICE_SIZE)
+    while (offset < DEVICE_SIZE && erasedPages[offset / PAGE_SIZE])
+        offset = (offset / PAGE_SIZE + 1) * PAGE_SIZE;
+
+    if (offset >= DEVICE_SIZE) {
+        requestProgress = DEVICE_SIZE;
         return false;
+    }
+
+    unsigned length = std::min(DEVICE_SIZE - offset,
+        USBProtocolMsg::MAX_LEN - USBProtocolMsg::HEADER_BYTES);
+    unsigned nextPage = (offset / PAGE_SIZE + 1) * PAGE_SIZE;
+    if (offset + length > nextPage && erasedPages[nextPage / PAGE_SIZE])
+        length = nextPage - offset;
 
     USBProtocolMsg m(USBProtocol::Installer);
     m.header |= UsbVolumeManager::FlashDeviceRead;
@@ -127,51 +262,178 @@ bool Backup::sendRequest()
         m.zeroCopyAppend<UsbVolumeManager::FlashDeviceReadRequest>();
 
     req->address = offset;
-    req->length = std::min(DEVICE_SIZE - offset,
-        USBProtocolMsg::MAX_LEN - USBProtocolMsg::HEADER_BYTES);
+    req->length = length;
 
-    requestProgress = offset + req->length;
+    requestProgress = offset + length;
+    pendingReads.push_back(offset);
 
     dev.writePacket(m.bytes, m.len);
 
     return true;
 }
 
-bool Backup::writeReply(FILE *f)
+bool Backup::writeReply(FlashImageWriter &image)
 {
     USBProtocolMsg m;
 
     dev.readPacket(m.bytes, m.MAX_LEN, m.len);
-    if ((m.header & 0xff) != UsbVolumeManager::FlashDeviceRead) {
+    if ((m.header & 0xff) != UsbVolumeManager::FlashDeviceRead || pendingReads.empty()) {
         fprintf(stderr, "\nunexpected response\n");
         return false;
     }
 
+    // Erased pages we skipped over get filled in locally
+    unsigned address = pendingReads.front();
+    pendingReads.pop_front();
+    if (!image.fill(0xFF, address - replyProgress))
+        return false;
+
     unsigned len = m.payloadLen();
-    replyProgress += len;
+    replyProgress = address + len;
 
-    return fwrite(m.castPayload<uint8_t>(), len, 1, f) == 1;
+    return image.write(m.castPayload<uint8_t>(), len);
 }
 
-bool Backup::writeFlashContents(FILE *f)
+bool Backup::writeFlashContents(FlashImageWriter &image)
 {
     ScopedProgressBar pb(DEVICE_SIZE);
 
+    requestProgress = 0;
+    replyProgress = 0;
+    pendingReads.clear();
+
     // Queue up the first few reads, respond as results arrive
-    for (unsigned i = 0; i < 3; ++i)
+    for (unsigned i = 0; i < NUM_PENDING_REQUESTS; ++i)
         sendRequest();
 
-    while (1) {
+    while (!pendingReads.empty()) {
         dev.processEvents(1);
 
         while (dev.numPendingINPackets() != 0) {
-            if (!writeReply(f))
+            if (!writeReply(image))
                 return false;
 
             pb.update(replyProgress);
             sendRequest();
-            if (replyProgress == DEVICE_SIZE)
-                return true;
         }
     }
+
+    pb.update(DEVICE_SIZE);
+    return image.fill(0xFF, DEVICE_SIZE - replyProgress);
+}
+
+int Backup::restore(const char *path)
+{
+    /*
+     * Write a backup back onto a base, replacing everything on it.
+     * The base erases its whole flash first, and is rebooted afterwards
+     * so that nothing it cached from before the restore survives.
+     */
+
+    FlashImageReader image;
+    if (!image.open(path)) {
+        fprintf(stderr, "could not read %s\n", path);
+        return ENOENT;
+    }
+
+    if (!readFileHeader(image)) {
+        fprintf(stderr, "%s is not a Sifteo Base backup\n", path);
+        return EINVAL;
+    }
+
+    if (!dev.open(IODevice::SIFTEO_VID, IODevice::BASE_PID)) {
+        return ENODEV;
+    }
+
+    if (!restoreFlashContents(image)) {
+        return EIO;
+    }
+
+    BaseDevice base(dev);
+    if (!base.requestReboot()) {
+        return EIO;
+    }
+
+    return EOK;
+}
+
+bool Backup::readFileHeader(FlashImageReader &image)
+{
+    Header hdr;
+    STATIC_ASSERT(sizeof hdr == PAGE_SIZE);
+
+    // Siftulator's own files are larger, but start the same way
+    return image.size() >= PAGE_SIZE + DEVICE_SIZE
+        && image.read(reinterpret_cast<uint8_t*>(&hdr), sizeof hdr)
+        && hdr.magic == HEADER_MAGIC
+        && hdr.version == 1
+        && hdr.mc_pageSize == PAGE_SIZE
+        && hdr.mc_blockSize == BLOCK_SIZE
+        && hdr.mc_capacity == DEVICE_SIZE;
+}
+
+bool Backup::restoreFlashContents(FlashImageReader &image)
+{
+    BaseDevice base(dev);
+    USBProtocolMsg m(USBProtocol::Installer);
+
+    fprintf(stderr, "erasing, this may take a few minutes...\n");
+    m.header |= UsbVolumeManager::FlashDeviceRestore;
+    if (!base.writeAndWaitForReply(m)) {
+        fprintf(stderr, "base does not support restoring a backup\n");
+        return false;
+    }
+
+    ScopedProgressBar pb(DEVICE_SIZE);
+
+    /*
+     * Erased pages are already erased. Everything else goes out in
+     * packets that never straddle a page, since the flash programs
+     * one page at a time.
+     */
+
+    const unsigned maxChunk = USBProtocolMsg::MAX_PAYLOAD_BYTES - sizeof(uint32_t);
+
+    for (unsigned address = 0; address < DEVICE_SIZE; address += PAGE_SIZE) {
+        uint8_t page[PAGE_SIZE];
+        if (!image.read(page, sizeof page))
+            return false;
+
+        unsigned i = 0;
+        while (i < sizeof page && page[i] == 0xFF)
+            ++i;
+        if (i == sizeof page)
+            continue;
+
+        for (unsigned offset = 0; offset < sizeof page; offset += maxChunk) {
+            uint32_t chunkAddress = address + offset;
+            unsigned len = std::min<unsigned>(maxChunk, sizeof page - offset);
+
+            m.init(USBProtocol::Installer);
+            m.header |= UsbVolumeManager::FlashDeviceWrite;
+            m.append((const uint8_t*) &chunkAddress, sizeof chunkAddress);
+            m.append(page + offset, len);
+
+            if (dev.writePacket(m.bytes, m.len) < 0)
+                return false;
+
+            while (dev.numPendingOUTPackets() > IODevice::MAX_OUTSTANDING_OUT_TRANSFERS) {
+                dev.processEvents(1);
+            }
+        }
+
+        pb.update(address + PAGE_SIZE);
+    }
+
+    pb.update(DEVICE_SIZE);
+
+    // Writes aren't acknowledged. A read that comes back after them does.
+    m.init(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::FlashDeviceRead;
+    UsbVolumeManager::FlashDeviceReadRequest *req =
+        m.zeroCopyAppend<UsbVolumeManager::FlashDeviceReadRequest>();
+    req->address = 0;
+    req->length = sizeof(uint32_t);
+
+    return base.writeAndWaitForReply(m);
 }
@@ -28,8 +28,11 @@
 
 #include "iodevice.h"
 #include "usbvolumemanager.h"
+#include "flashimage.h"
 
 #include <string>
+#include <vector>
+#include <deque>
 
 class Backup
 {
@@ -37,8 +40,10 @@ public:
     Backup(IODevice &_dev);
 
     static int run(int argc, char **argv, IODevice &_dev);
+    static int runRestore(int argc, char **argv, IODevice &_dev);
 
-    int backup(const char *path);
+    int backup(const char *path, bool raw);
+    int restore(const char *path);
 
 private:
     IODevice &dev;
@@ -46,15 +51,33 @@ private:
     unsigned requestProgress;
     unsigned replyProgress;
 
+    // Addresses of the reads in flight, in the order they'll be answered
+    std::deque<unsigned> pendingReads;
+
+    // One flag per page, set if the base reported it as erased
+    std::vector<bool> erasedPages;
+
     static const unsigned DEVICE_SIZE = 16*1024*1024;
     static const unsigned PAGE_SIZE = 256;
     static const unsigned BLOCK_SIZE = 64*1024;
+    static const unsigned NUM_PAGES = DEVICE_SIZE / PAGE_SIZE;
+    static const unsigned NUM_BLOCKS = DEVICE_SIZE / BLOCK_SIZE;
 
-    bool writeFileHeader(FILE *f);
-    bool writeFlashContents(FILE *f);
+    // Read requests kept in flight, so the base always has another one
+    // waiting. Matches the number of IN transfers UsbDevice keeps open.
+    static const unsigned NUM_PENDING_REQUESTS = 16;
 
+    bool writeFileHeader(FlashImageWriter &image);
+    bool scanFlash();
+    bool writeFlashContents(FlashImageWriter &image);
+
+    bool sendScanRequest();
+    bool readScanReply();
     bool sendRequest();
-    bool writeReply(FILE *f);
+    bool writeReply(FlashImageWriter &image);
+
+    bool readFileHeader(FlashImageReader &image);
+    bool restoreFlashContents(FlashImageReader &image);
 };
 
 #endif // BACKUP_H
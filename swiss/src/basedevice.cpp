@@ -147,6 +147,123 @@ UsbVolumeManager::VolumeDetailReply *BaseDevice::getVolumeDetail(USBProtocolMsg
 }
 
 
+std::string BaseDevice::VolumeInventoryEntry::metadataString(unsigned key) const
+{
+    /*
+     * Matches Metadata::getString(): "(none)" for missing keys, and the
+     * value up to its NUL terminator otherwise.
+     */
+
+    std::map<unsigned, std::string>::const_iterator it = metadata.find(key);
+    if (it == metadata.end()) {
+        return "(none)";
+    }
+
+    return std::string(it->second.c_str());
+}
+
+
+bool BaseDevice::getVolumeInventory(UsbVolumeManager::VolumeOverviewReply &overview,
+                                    std::vector<VolumeInventoryEntry> &volumes,
+                                    const uint16_t *keys, unsigned numKeys)
+{
+    /*
+     * Retrieve the overview, volume details, and the given metadata keys
+     * for every installed volume in a single streamed request.
+     *
+     * Returns false if the base doesn't support this (older firmware
+     * replies with an unrelated header), in which case callers should fall
+     * back on querying each volume and key separately.
+     */
+
+    if (numKeys > UsbVolumeManager::MAX_INVENTORY_KEYS) {
+        return false;
+    }
+
+    USBProtocolMsg msg(USBProtocol::Installer);
+    msg.header |= UsbVolumeManager::VolumeInventory;
+
+    UsbVolumeManager::VolumeInventoryRequest *req = msg.zeroCopyAppend<UsbVolumeManager::VolumeInventoryRequest>();
+    memset(req, 0, sizeof *req);
+    req->numKeys = numKeys;
+    memcpy(req->keys, keys, numKeys * sizeof keys[0]);
+
+    uint32_t headerToMatch = msg.header;
+    if (dev.writePacket(msg.bytes, msg.len) < 0) {
+        return false;
+    }
+
+    /*
+     * Once the stream has started, read it through to the end even if a
+     * record looks wrong, so nothing is left over to confuse our next request.
+     */
+
+    bool gotOverview = false;
+    bool valid = true;
+    volumes.clear();
+
+    for (;;) {
+        if (!waitForReply(headerToMatch, msg)) {
+            return false;
+        }
+
+        typedef UsbVolumeManager::InventoryRecordHeader RecordHeader;
+        if (msg.payloadLen() < sizeof(RecordHeader)) {
+            return false;
+        }
+
+        const RecordHeader *hdr = msg.castPayload<RecordHeader>();
+        const uint8_t *data = msg.payload + sizeof *hdr;
+        unsigned dataLen = msg.payloadLen() - sizeof *hdr;
+
+        switch (hdr->type) {
+
+        case UsbVolumeManager::InventoryOverview:
+            if (dataLen < sizeof overview) {
+                valid = false;
+                break;
+            }
+            memcpy(&overview, data, sizeof overview);
+            gotOverview = true;
+            break;
+
+        case UsbVolumeManager::InventoryVolume: {
+            if (dataLen < sizeof(UsbVolumeManager::VolumeDetailReply)) {
+                valid = false;
+                break;
+            }
+            VolumeInventoryEntry entry;
+            entry.volBlockCode = hdr->volume;
+            memcpy(&entry.detail, data, sizeof entry.detail);
+            volumes.push_back(entry);
+            break;
+        }
+
+        case UsbVolumeManager::InventoryMetadata: {
+            if (volumes.empty() || volumes.back().volBlockCode != hdr->volume) {
+                valid = false;
+                break;
+            }
+            std::string &value = volumes.back().metadata[hdr->key];
+            if (value.size() != hdr->offset) {
+                valid = false;
+                break;
+            }
+            value.append(reinterpret_cast<const char*>(data), dataLen);
+            break;
+        }
+
+        case UsbVolumeManager::InventoryEnd:
+            return valid && gotOverview;
+
+        default:
+            valid = false;
+            break;
+        }
+    }
+}
+
+
 bool BaseDevice::volumeCodeForPackage(const std::string & pkg, unsigned &volBlockCode)
 {
     /*
@@ -159,6 +276,21 @@ bool BaseDevice::volumeCodeForPackage(const std::string & pkg, unsigned &volBloc
         return true;
     }
 
+    UsbVolumeManager::VolumeOverviewReply inventoryOverview;
+    std::vector<VolumeInventoryEntry> volumes;
+    const uint16_t key = _SYS_METADATA_PACKAGE_STR;
+
+    if (getVolumeInventory(inventoryOverview, volumes, &key, 1)) {
+        for (unsigned i = 0; i < volumes.size(); ++i) {
+            if (pkg == volumes[i].metadataString(key)) {
+                volBlockCode = volumes[i].volBlockCode;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Older firmware: one request per volume
     Metadata metadata(dev);
 
     USBProtocolMsg m;
@@ -195,6 +327,30 @@ UsbVolumeManager::LFSDetailReply *BaseDevice::getLFSDetail(USBProtocolMsg &msg,
 }
 
 
+const UsbVolumeManager::FlashDeviceScanReply *BaseDevice::flashDeviceScan(USBProtocolMsg &msg, unsigned address)
+{
+    /*
+     * Find out which pages of the erase block at 'address' are blank.
+     * Returns NULL if the base couldn't tell us, including on firmware
+     * too old to know this command.
+     */
+
+    msg.init(USBProtocol::Installer);
+    msg.header |= UsbVolumeManager::FlashDeviceScan;
+    msg.append((uint8_t*) &address, sizeof address);
+
+    if (!writeAndWaitForReply(msg)) {
+        return 0;
+    }
+
+    if (msg.payloadLen() >= sizeof(UsbVolumeManager::FlashDeviceScanReply)) {
+        return msg.castPayload<UsbVolumeManager::FlashDeviceScanReply>();
+    }
+
+    return 0;
+}
+
+
 bool BaseDevice::pairCube(USBProtocolMsg &msg, uint64_t hwid, unsigned slot)
 {
     /*
@@ -30,6 +30,8 @@
 #include "usbvolumemanager.h"
 
 #include <string>
+#include <vector>
+#include <map>
 
 /*
  * Represents the Sifteo Base.
@@ -40,6 +42,19 @@ class BaseDevice
 {
 public:
 
+    /*
+     * One installed volume, as listed by getVolumeInventory(). Metadata
+     * values are raw bytes, keyed by metadata key, and only present for
+     * keys the volume actually has.
+     */
+    struct VolumeInventoryEntry {
+        unsigned volBlockCode;
+        UsbVolumeManager::VolumeDetailReply detail;
+        std::map<unsigned, std::string> metadata;
+
+        std::string metadataString(unsigned key) const;
+    };
+
     BaseDevice(IODevice &iodevice);
 
     bool beginLFSRestore(USBProtocolMsg &m, _SYSVolumeHandle vol, unsigned key, unsigned dataSize, uint32_t crc);
@@ -49,8 +64,12 @@ public:
 
     UsbVolumeManager::VolumeOverviewReply *getVolumeOverview(USBProtocolMsg &msg);
     UsbVolumeManager::VolumeDetailReply *getVolumeDetail(USBProtocolMsg &msg, unsigned volBlockCode);
+    bool getVolumeInventory(UsbVolumeManager::VolumeOverviewReply &overview,
+                            std::vector<VolumeInventoryEntry> &volumes,
+                            const uint16_t *keys, unsigned numKeys);
     bool volumeCodeForPackage(const std::string & pkg, unsigned &volBlockCode);
     UsbVolumeManager::LFSDetailReply *getLFSDetail(USBProtocolMsg &buffer, unsigned volBlockCode);
+    const UsbVolumeManager::FlashDeviceScanReply *flashDeviceScan(USBProtocolMsg &msg, unsigned address);
 
     bool pairCube(USBProtocolMsg &msg, uint64_t hwid, unsigned slot);
     UsbVolumeManager::PairingSlotDetailReply *pairingSlotDetail(USBProtocolMsg &msg, unsigned pairingSlot);
@@ -24,7 +24,6 @@
  */
 
 #include "elfdebuginfo.h"
-#include <cxxabi.h>
 #include "macros.h"
 
 #include <sifteo/abi/elf.h>
@@ -32,13 +31,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
 
 
 /*
  * NOTE: at the moment, this is a slightly modified version of
- * emulator/src/mc_elfdebuginfo.cpp Eventually want to migrate that out of
- * the emulator, and make this available as library code to be shared by
- * both swiss and the emulator (if both end up wanting to use it).
+ * emulator/src/mc_elfdebuginfo.cpp. Symbol lookup is already shared,
+ * via ELFSymbolIndex; the rest may eventually follow.
  */
 
 void ELFDebugInfo::clear()
@@ -46,6 +45,7 @@ void ELFDebugInfo::clear()
     mappedFile.unmap();
     sections.clear();
     sectionMap.clear();
+    symbols.clear();
 }
 
 bool ELFDebugInfo::copyProgramBytes(uint32_t byteOffset, uint8_t *dest, uint32_t length) const
@@ -56,9 +56,8 @@ bool ELFDebugInfo::copyProgramBytes(uint32_t byteOffset, uint8_t *dest, uint32_t
     if (!mappedFile.isMapped())
         return false;
 
-    unsigned avail;
-    uint8_t *p = mappedFile.getData(byteOffset, avail);
-    if (!p || length > avail)
+    const uint8_t *p = mappedFile.getBytes(byteOffset, length);
+    if (!p)
         return false;
 
     memcpy(dest, p, length);
@@ -80,38 +79,59 @@ bool ELFDebugInfo::init(const char *elfPath)
     if (!header)
         return false;
 
-    // First pass, copy out all the headers.
+    // First pass, find all the headers. Truncated ones are left out.
+    const Elf::SectionHeader *strTab = 0;
     for (unsigned i = 0; i < header->e_shnum; i++) {
-        sections.push_back(Elf::SectionHeader());
-        Elf::SectionHeader *pHdr = &sections.back();
         uint32_t off = header->e_shoff + i * header->e_shentsize;
-        if (!copyProgramBytes(off, (uint8_t*)pHdr, sizeof *pHdr))
-            memset(pHdr, 0xFF, sizeof *pHdr);
+        const Elf::SectionHeader *pHdr = mappedFile.getObject<Elf::SectionHeader>(off);
+        if (!pHdr)
+            continue;
+
+        sections.push_back(pHdr);
+        if (i == header->e_shstrndx)
+            strTab = pHdr;
     }
 
     // Read section names, set up sectionMap.
-    if (header->e_shstrndx < sections.size()) {
-        const Elf::SectionHeader *strTab = &sections[header->e_shstrndx];
+    if (strTab) {
         for (unsigned i = 0, e = sections.size(); i != e; ++i) {
-            Elf::SectionHeader *pHdr = &sections[i];
+            const Elf::SectionHeader *pHdr = sections[i];
             sectionMap[readString(strTab, pHdr->sh_name)] = pHdr;
         }
     }
 
+    initSymbols();
     return true;
 }
 
+void ELFDebugInfo::initSymbols()
+{
+    /*
+     * Index the symbol table in place, stopping short if the file is truncated.
+     */
+
+    const Elf::SectionHeader *symTab = findSection(".symtab");
+    const Elf::SectionHeader *strTab = findSection(".strtab");
+    if (!symTab || !strTab)
+        return;
+
+    unsigned symAvail, strAvail;
+    const uint8_t *symData = mappedFile.getData(symTab->sh_offset, symAvail);
+    const uint8_t *strData = mappedFile.getData(strTab->sh_offset, strAvail);
+    if (!symData || !strData)
+        return;
+
+    unsigned count = std::min<unsigned>(symTab->sh_size, symAvail) / sizeof(Elf::Symbol);
+    symbols.init(reinterpret_cast<const Elf::Symbol*>(symData), count,
+        reinterpret_cast<const char*>(strData), std::min<unsigned>(strTab->sh_size, strAvail));
+}
+
 /*
  * FileHeader is located at offset 0, and maps the rest of the ELF.
  */
 const Elf::FileHeader *ELFDebugInfo::getFileHeader() const
 {
-    unsigned avail;
-    uint8_t *fh = mappedFile.getData(0, avail);
-    if (!fh || avail < sizeof(Elf::FileHeader))
-        return 0;
-
-    return reinterpret_cast<Elf::FileHeader*>(fh);
+    return mappedFile.getObject<Elf::FileHeader>(0);
 }
 
 /*
@@ -135,12 +155,7 @@ const Elf::ProgramHeader *ELFDebugInfo::getProgramHeader(const Elf::FileHeader *
     ASSERT(index < fh->e_phnum);
     unsigned offset = fh->e_phoff + index * sizeof(Elf::ProgramHeader);
 
-    unsigned avail;
-    uint8_t *p = mappedFile.getData(offset, avail);
-    if (!p || offset + sizeof(Elf::ProgramHeader) > avail)
-        return 0;
-
-    return reinterpret_cast<Elf::ProgramHeader*>((uint8_t*)fh + offset);
+    return mappedFile.getObject<Elf::ProgramHeader>(offset);
 }
 
 const Elf::ProgramHeader *ELFDebugInfo::getMetadataSegment() const
@@ -162,12 +177,17 @@ const Elf::ProgramHeader *ELFDebugInfo::getMetadataSegment() const
 
 std::string ELFDebugInfo::readString(const Elf::SectionHeader *SI, uint32_t offset) const
 {
-    static char buf[1024];
-    uint32_t size = std::min<uint32_t>(sizeof buf - 1, SI->sh_size - offset);
-    if (!copyProgramBytes(SI->sh_offset + offset, (uint8_t*)buf, size))
-        size = 0;
-    buf[size] = '\0';
-    return buf;
+    if (offset >= SI->sh_size)
+        return "";
+
+    unsigned avail;
+    const char *str = reinterpret_cast<const char*>(mappedFile.getData(SI->sh_offset + offset, avail));
+    if (!str)
+        return "";
+
+    // Strings end at a NUL, the end of their section, or the end of the file
+    uint32_t limit = std::min<uint32_t>(avail, SI->sh_size - offset);
+    return std::string(str, std::find(str, str + limit, '\0'));
 }
 
 std::string ELFDebugInfo::readString(const std::string &section, uint32_t offset) const
@@ -189,36 +209,11 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     // If nothing is found, we still fill in the output buffer and name
     // with "(unknown)" and zeroes, but 'false' is returned.
 
-    const Elf::SectionHeader *SI = findSection(".symtab");
-    if (SI) {
-        Elf::Symbol currentSym;
-        const uint32_t worstOffset = (uint32_t) -1;
-        uint32_t bestOffset = worstOffset;
-
-        for (unsigned index = 0;; index++) {
-            uint32_t tableOffset = index * sizeof currentSym;
-
-            if (tableOffset + sizeof currentSym > SI->sh_size ||
-                !copyProgramBytes(
-                    SI->sh_offset + tableOffset,
-                    (uint8_t*) &currentSym, sizeof currentSym))
-                break;
-
-            // Strip the Thumb bit from function symbols.
-            if ((currentSym.st_info & 0xF) == Elf::STT_FUNC)
-                currentSym.st_value &= ~1;
-
-            uint32_t addrOffset = address - currentSym.st_value;
-            if (addrOffset < currentSym.st_size && addrOffset < bestOffset) {
-                symbol = currentSym;
-                bestOffset = addrOffset;
-            }
-        }
-
-        if (bestOffset != worstOffset) {
-            name = readString(".strtab", symbol.st_name);
-            return true;
-        }
+    const ELFSymbolIndex::Entry *entry = symbols.find(address);
+    if (entry) {
+        symbol = entry->symbol;
+        name = entry->name;
+        return true;
     }
 
     memset(&symbol, 0, sizeof symbol);
@@ -226,11 +221,10 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     return false;
 }
 
-
 bool ELFDebugInfo::metadataString(uint16_t key, std::string &s)
 {
     uint32_t actualSize;
-    uint8_t *m = metadata(key, actualSize);
+    const uint8_t *m = metadata(key, actualSize);
     if (!m)
         return false;
 
@@ -238,7 +232,7 @@ bool ELFDebugInfo::metadataString(uint16_t key, std::string &s)
     return true;
 }
 
-uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
+const uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 {
     const Elf::ProgramHeader *ph = getMetadataSegment();
     if (!ph)
@@ -251,15 +245,13 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 
     bool foundKey = false;
     uint32_t valueOffset = 0;
-    unsigned avail;
 
     while (I <= E) {
 
-        uint8_t *p = mappedFile.getData(I, avail);
-        if (!p)
+        const _SYSMetadataKey *record = mappedFile.getObject<_SYSMetadataKey>(I);
+        if (!record)
             return 0;
 
-        const _SYSMetadataKey *record = reinterpret_cast<const _SYSMetadataKey *>(p);
         I += keySize;
 
         bool isLast = record->stride >> 15;
@@ -278,7 +270,7 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
                 return 0;
 
             // Now we can calculate the address of the value, yay.
-            return mappedFile.getData(valueOffset + I, avail);
+            return mappedFile.getBytes(valueOffset + I, actualSize);
         }
     }
 
@@ -288,12 +280,9 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 
 std::string ELFDebugInfo::formatAddress(uint32_t address) const
 {
-    Elf::Symbol symbol;
-    std::string name;
-
-    findNearestSymbol(address, symbol, name);
-    demangle(name);
-    uint32_t offset = address - symbol.st_value;
+    const ELFSymbolIndex::Entry *entry = symbols.find(address);
+    std::string name = entry ? entry->demangledName : "(unknown)";
+    uint32_t offset = entry ? address - entry->symbol.st_value : address;
 
     if (offset != 0) {
         char buf[16];
@@ -304,19 +293,6 @@ std::string ELFDebugInfo::formatAddress(uint32_t address) const
     return name;
 }
 
-void ELFDebugInfo::demangle(std::string &name)
-{
-    // This uses the demangler built into GCC's libstdc++.
-    // It uses the same name mangling style as clang.
-
-    int status;
-    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
-    if (status == 0) {
-        name = result;
-        free(result);
-    }
-}
-
 bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const
 {
     /*
@@ -326,24 +302,25 @@ bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) co
      */
 
     for (sections_t::const_iterator I = sections.begin(), E = sections.end(); I != E; ++I) {
+        const Elf::SectionHeader *SI = *I;
 
         // Section must be allocated program data
-        if (I->sh_type != Elf::SHT_PROGBITS)
+        if (SI->sh_type != Elf::SHT_PROGBITS)
             continue;
-        if (!(I->sh_flags & Elf::SHF_ALLOC))
+        if (!(SI->sh_flags & Elf::SHF_ALLOC))
             continue;
 
         // Section must not be writeable
-        if (I->sh_flags & Elf::SHF_WRITE)
+        if (SI->sh_flags & Elf::SHF_WRITE)
             continue;
 
         // Address range must be fully contained within the section
-        uint32_t offset = address - I->sh_addr;
-        if (offset > I->sh_size || offset + bytes > I->sh_size)
+        uint32_t offset = address - SI->sh_addr;
+        if (offset > SI->sh_size || offset + bytes > SI->sh_size)
             continue;
 
         // Success, we can read from the ELF
-        return copyProgramBytes(offset, buffer, bytes);
+        return copyProgramBytes(SI->sh_offset + offset, buffer, bytes);
     }
 
     return false;
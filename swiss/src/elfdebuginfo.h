@@ -27,6 +27,7 @@
 #define ELF_DEBUG_INFO_H
 
 #include "elfdefs.h"
+#include "elfsymbolindex.h"
 #include "mappedfile.h"
 
 #include <vector>
@@ -44,18 +45,20 @@ public:
     bool readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const;
 
     bool metadataString(uint16_t key, std::string &s);
-    uint8_t* metadata(uint16_t key, uint32_t &actualSize);
+    const uint8_t* metadata(uint16_t key, uint32_t &actualSize);
 
 private:
-    typedef std::vector<Elf::SectionHeader> sections_t;
-    typedef std::map<std::string, Elf::SectionHeader*> sectionMap_t;
+    // Section headers are used in place, from the mapped file
+    typedef std::vector<const Elf::SectionHeader*> sections_t;
+    typedef std::map<std::string, const Elf::SectionHeader*> sectionMap_t;
 
     MappedFile mappedFile;
 
     sections_t sections;
     sectionMap_t sectionMap;
+    ELFSymbolIndex symbols;
 
-    static void demangle(std::string &name);
+    void initSymbols();
     std::string readString(const Elf::SectionHeader *SI, uint32_t offset) const;
 
     const Elf::FileHeader *getFileHeader() const;
@@ -0,0 +1,268 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * swiss - your Sifteo utility knife
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "flashimage.h"
+#include "lodepng.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+
+FlashImageWriter::~FlashImageWriter()
+{
+    if (f)
+        fclose(f);
+}
+
+bool FlashImageWriter::open(const char *path, uint32_t imageSize, bool sparse)
+{
+    f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    this->sparse = sparse;
+    chunk.clear();
+    if (!sparse)
+        return true;
+
+    /*
+     * The index isn't known until we're done, so leave room for it
+     * and come back to fill it in from close().
+     */
+
+    const uint32_t chunkSize = FlashImageSparseHeader::CHUNK_SIZE;
+
+    header.magic = FlashImageSparseHeader::MAGIC;
+    header.version = FlashImageSparseHeader::CURRENT_VERSION;
+    header.chunkSize = chunkSize;
+    header.numChunks = (imageSize + chunkSize - 1) / chunkSize;
+    header.imageSize = imageSize;
+
+    index.clear();
+    index.reserve(header.numChunks);
+
+    fileOffset = sizeof header + header.numChunks * sizeof(FlashImageSparseIndexEntry);
+    return !fseek(f, fileOffset, SEEK_SET);
+}
+
+bool FlashImageWriter::write(const uint8_t *bytes, unsigned count)
+{
+    if (!sparse)
+        return fwrite(bytes, 1, count, f) == count;
+
+    while (count) {
+        unsigned part = std::min<unsigned>(count, header.chunkSize - chunk.size());
+        chunk.insert(chunk.end(), bytes, bytes + part);
+        bytes += part;
+        count -= part;
+
+        if (chunk.size() == header.chunkSize && !writeChunk())
+            return false;
+    }
+    return true;
+}
+
+bool FlashImageWriter::fill(uint8_t byte, unsigned count)
+{
+    uint8_t buf[256];
+    memset(buf, byte, sizeof buf);
+
+    while (count) {
+        unsigned part = std::min<unsigned>(count, sizeof buf);
+        if (!write(buf, part))
+            return false;
+        count -= part;
+    }
+    return true;
+}
+
+bool FlashImageWriter::writeChunk()
+{
+    FlashImageSparseIndexEntry entry;
+    memset(&entry, 0, sizeof entry);
+
+    const uint8_t *data = &chunk[0];
+    unsigned len = chunk.size();
+
+    if (!memcmp(data, data + 1, len - 1)) {
+        entry.type = FlashImageSparseIndexEntry::CHUNK_FILL;
+        entry.fill = data[0];
+
+    } else {
+        unsigned char *compressed = NULL;
+        size_t compressedSize = 0;
+        bool success;
+
+        entry.offset = fileOffset;
+
+        if (!LodePNG_zlib_compress(&compressed, &compressedSize, data, len,
+                &LodePNG_defaultCompressSettings) && compressedSize < len) {
+            entry.type = FlashImageSparseIndexEntry::CHUNK_ZLIB;
+            entry.length = compressedSize;
+            success = fwrite(compressed, compressedSize, 1, f) == 1;
+        } else {
+            entry.type = FlashImageSparseIndexEntry::CHUNK_RAW;
+            entry.length = len;
+            success = fwrite(data, len, 1, f) == 1;
+        }
+
+        free(compressed);
+        if (!success)
+            return false;
+        fileOffset += entry.length;
+    }
+
+    index.push_back(entry);
+    chunk.clear();
+    return true;
+}
+
+bool FlashImageWriter::close()
+{
+    bool success = true;
+
+    if (sparse) {
+        if (!chunk.empty())
+            success = writeChunk();
+
+        success = success && index.size() == header.numChunks
+            && !fseek(f, 0, SEEK_SET)
+            && fwrite(&header, sizeof header, 1, f) == 1
+            && fwrite(&index[0], sizeof index[0], index.size(), f) == index.size();
+    }
+
+    success = !fclose(f) && success;
+    f = 0;
+    return success;
+}
+
+
+FlashImageReader::~FlashImageReader()
+{
+    close();
+}
+
+bool FlashImageReader::open(const char *path)
+{
+    f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    if (fread(&header, sizeof header, 1, f) != 1)
+        return false;
+    sparse = header.magic == FlashImageSparseHeader::MAGIC;
+
+    if (!sparse) {
+        if (fseek(f, 0, SEEK_END))
+            return false;
+        imageSize = ftell(f);
+        return !fseek(f, 0, SEEK_SET);
+    }
+
+    if (header.version != FlashImageSparseHeader::CURRENT_VERSION
+        || header.chunkSize == 0
+        || header.numChunks != (header.imageSize + header.chunkSize - 1) / header.chunkSize)
+        return false;
+
+    index.resize(header.numChunks);
+    if (!index.empty() && fread(&index[0], sizeof index[0], index.size(), f) != index.size())
+        return false;
+
+    imageSize = header.imageSize;
+    nextChunk = 0;
+    chunkOffset = 0;
+    chunk.clear();
+    return true;
+}
+
+bool FlashImageReader::read(uint8_t *bytes, unsigned count)
+{
+    if (!sparse)
+        return fread(bytes, 1, count, f) == count;
+
+    while (count) {
+        if (chunkOffset == chunk.size() && !readChunk())
+            return false;
+
+        unsigned part = std::min<unsigned>(count, chunk.size() - chunkOffset);
+        memcpy(bytes, &chunk[chunkOffset], part);
+        chunkOffset += part;
+        bytes += part;
+        count -= part;
+    }
+    return true;
+}
+
+bool FlashImageReader::readChunk()
+{
+    if (nextChunk >= header.numChunks)
+        return false;
+
+    const FlashImageSparseIndexEntry &entry = index[nextChunk];
+    unsigned offset = nextChunk * header.chunkSize;
+    unsigned len = std::min<unsigned>(header.chunkSize, header.imageSize - offset);
+
+    nextChunk++;
+    chunkOffset = 0;
+
+    if (entry.type == FlashImageSparseIndexEntry::CHUNK_FILL) {
+        chunk.assign(len, entry.fill);
+        return true;
+    }
+
+    std::vector<uint8_t> stored(entry.length);
+    if (!entry.length || fseek(f, entry.offset, SEEK_SET)
+        || fread(&stored[0], entry.length, 1, f) != 1)
+        return false;
+
+    if (entry.type == FlashImageSparseIndexEntry::CHUNK_RAW) {
+        if (entry.length != len)
+            return false;
+        chunk.swap(stored);
+        return true;
+    }
+
+    if (entry.type == FlashImageSparseIndexEntry::CHUNK_ZLIB) {
+        unsigned char *out = NULL;
+        size_t outSize = 0;
+        unsigned error = LodePNG_zlib_decompress(&out, &outSize, &stored[0],
+            entry.length, &LodePNG_defaultDecompressSettings);
+        bool success = !error && outSize == len;
+        if (success)
+            chunk.assign(out, out + outSize);
+        free(out);
+        return success;
+    }
+
+    return false;
+}
+
+void FlashImageReader::close()
+{
+    if (f)
+        fclose(f);
+    f = 0;
+}
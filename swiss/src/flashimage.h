@@ -0,0 +1,117 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * swiss - your Sifteo utility knife
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FLASHIMAGE_H
+#define FLASHIMAGE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/*
+ * Flash images are read and written sequentially, either as a plain file
+ * or in Siftulator's sparse format: fixed-size chunks which are stored
+ * as one repeated byte, raw, or zlib-compressed. Siftulator's -F option
+ * accepts both.
+ */
+
+struct FlashImageSparseHeader {
+    uint64_t    magic;
+    uint32_t    version;
+    uint32_t    chunkSize;
+    uint32_t    numChunks;
+    uint32_t    imageSize;
+
+    // Must match FlashStorage::SparseHeader in the emulator
+    static const uint64_t MAGIC             = 0x5250537974666953LLU;
+    static const uint32_t CURRENT_VERSION   = 1;
+    static const uint32_t CHUNK_SIZE        = 64 * 1024;
+};
+
+struct FlashImageSparseIndexEntry {
+    uint32_t    offset;
+    uint32_t    length;
+    uint8_t     type;
+    uint8_t     fill;
+    uint16_t    reserved;
+
+    enum Type {
+        CHUNK_FILL = 0,
+        CHUNK_RAW,
+        CHUNK_ZLIB,
+    };
+};
+
+
+class FlashImageWriter
+{
+public:
+    FlashImageWriter() : f(0) {}
+    ~FlashImageWriter();
+
+    bool open(const char *path, uint32_t imageSize, bool sparse);
+    bool write(const uint8_t *bytes, unsigned count);
+    bool fill(uint8_t byte, unsigned count);
+    bool close();
+
+private:
+    FILE *f;
+    bool sparse;
+    FlashImageSparseHeader header;
+    std::vector<FlashImageSparseIndexEntry> index;
+    std::vector<uint8_t> chunk;
+    uint32_t fileOffset;
+
+    bool writeChunk();
+};
+
+
+class FlashImageReader
+{
+public:
+    FlashImageReader() : f(0) {}
+    ~FlashImageReader();
+
+    bool open(const char *path);
+    uint32_t size() const {
+        return imageSize;
+    }
+    bool read(uint8_t *bytes, unsigned count);
+    void close();
+
+private:
+    FILE *f;
+    bool sparse;
+    uint32_t imageSize;
+    FlashImageSparseHeader header;
+    std::vector<FlashImageSparseIndexEntry> index;
+    std::vector<uint8_t> chunk;
+    unsigned nextChunk;
+    unsigned chunkOffset;
+
+    bool readChunk();
+};
+
+#endif // FLASHIMAGE_H
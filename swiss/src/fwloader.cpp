@@ -77,7 +77,7 @@ int FwLoader::run(int argc, char **argv, IODevice &_dev)
 }
 
 FwLoader::FwLoader(IODevice &_dev, bool rpc) :
-    dev(_dev), isRPC(rpc)
+    dev(_dev), isRPC(rpc), bootloaderFeatures(0)
 {
 }
 
@@ -303,6 +303,7 @@ bool FwLoader::bootloaderVersionIsCompatible(unsigned &swVersion, unsigned &hwVe
     // older bootloaders don't send the hardware version,
     // so check the length again to be sure
     hwVersion = (numBytes >= 3) ? usbBuf[2] : DEFAULT_HW_VERSION;
+    bootloaderFeatures = (numBytes >= 4) ? usbBuf[3] : 0;
 
     return ((VERSION_COMPAT_MIN <= swVersion) && (swVersion <= VERSION_COMPAT_MAX));
 }
@@ -360,20 +361,37 @@ bool FwLoader::sendFirmwareFile(FILE *f, uint32_t crc, uint32_t plaintextSize, u
     unsigned progress = 0;
     ScopedProgressBar progressBar(initialBytesToSend);
 
+    /*
+     * Bootloaders that can stream take the whole body as bare packets
+     * after a single CmdWriteStream, so every packet carries a full
+     * 64 bytes of ciphertext rather than 48 after its command byte.
+     */
+    const bool stream = (bootloaderFeatures & Bootloader::FeatureStream) != 0;
+    const unsigned headerBytes = stream ? 0 : 1;
+
+    if (stream) {
+        uint8_t usbBuf[5] = { Bootloader::CmdWriteStream };
+        uint32_t count = initialBytesToSend;
+        memcpy(usbBuf + 1, &count, sizeof count);
+        if (dev.writePacket(usbBuf, sizeof usbBuf) < 0) {
+            return false;
+        }
+    }
+
     /*
      * Payload should be back to back AES128::BLOCK_SIZE chunks.
      */
     while (initialBytesToSend) {
 
         uint8_t usbBuf[IODevice::MAX_EP_SIZE] = { Bootloader::CmdWriteMemory };
-        const unsigned payload = MIN(dev.maxOUTPacketSize() - 1, initialBytesToSend);
+        const unsigned payload = MIN(dev.maxOUTPacketSize() - headerBytes, initialBytesToSend);
         const unsigned chunk = (payload / AES128::BLOCK_SIZE) * AES128::BLOCK_SIZE;
-        const unsigned numBytes = fread(usbBuf + 1, 1, chunk, f);
+        const unsigned numBytes = fread(usbBuf + headerBytes, 1, chunk, f);
         if (numBytes != chunk) {
             return false;
         }
 
-        if (dev.writePacket(usbBuf, numBytes + 1) < 0) {
+        if (dev.writePacket(usbBuf, numBytes + headerBytes) < 0) {
             return false;
         }
 
@@ -421,5 +439,38 @@ bool FwLoader::sendFirmwareFile(FILE *f, uint32_t crc, uint32_t plaintextSize, u
     while (dev.numPendingOUTPackets())
         dev.processEvents(1);
 
+    if (bootloaderFeatures & Bootloader::FeatureVerify) {
+        return waitForVerify();
+    }
+
     return true;
 }
+
+/*
+ * The bootloader CRCs each word as it's programmed, and tells us whether
+ * the image matched once the final block is in.
+ */
+bool FwLoader::waitForVerify()
+{
+    for (unsigned ms = 0; ms < VERIFY_TIMEOUT_MS; ++ms) {
+        if (!dev.numPendingINPackets()) {
+            dev.processEvents(1);
+            continue;
+        }
+
+        uint8_t usbBuf[IODevice::MAX_EP_SIZE];
+        unsigned numBytes;
+        dev.readPacket(usbBuf, sizeof usbBuf, numBytes);
+        if (numBytes < 2 || usbBuf[0] != Bootloader::CmdWriteFinal)
+            continue;
+
+        if (!usbBuf[1]) {
+            fprintf(stderr, "firmware failed verification, please try again\n");
+            return false;
+        }
+        return true;
+    }
+
+    fprintf(stderr, "timed out waiting for firmware verification\n");
+    return false;
+}
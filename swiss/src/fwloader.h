@@ -49,6 +49,9 @@ private:
     // in the wild with this bootloader.
     static const unsigned DEFAULT_HW_VERSION = 2;
 
+    // how long the bootloader gets to check an image once it's all sent
+    static const unsigned VERIFY_TIMEOUT_MS = 5000;
+
     struct Header {
         uint32_t key;
         uint32_t size;
@@ -58,6 +61,7 @@ private:
     void resetBootloader();
     bool checkFileDetails(FILE *f, uint32_t &plainsz, uint32_t &crc, long fileEnd);
     bool sendFirmwareFile(FILE *f, uint32_t crc, uint32_t plaintextSize, unsigned fileSize);
+    bool waitForVerify();
     bool readFirmwareBinaryHeader(FILE *f, uint32_t &hwVersion, uint32_t &fwSize);
 
     int loadSingle(FILE *f);
@@ -67,6 +71,7 @@ private:
 
     IODevice &dev;
     bool isRPC;
+    uint8_t bootloaderFeatures;   // Bootloader::Feature bits
 };
 
 #endif // FW_LOADER_H
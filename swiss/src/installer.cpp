@@ -36,12 +36,14 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <map>
 
 int Installer::run(int argc, char **argv, IODevice &_dev)
 {
     bool launcher = false;
     bool forceLauncher = false;
     bool rpc = false;
+    bool delta = true;
     const char *path = NULL;
 
     for (int i = 1; i < argc; i++) {
@@ -51,6 +53,8 @@ int Installer::run(int argc, char **argv, IODevice &_dev)
             rpc = true;
         } else if (!strcmp(argv[i], "-f")) {
             forceLauncher = true;
+        } else if (!strcmp(argv[i], "--full")) {
+            delta = false;
         } else if (!path) {
             path = argv[i];
         } else {
@@ -65,7 +69,8 @@ int Installer::run(int argc, char **argv, IODevice &_dev)
                              IODevice::BASE_PID,
                              launcher,
                              forceLauncher,
-                             rpc);
+                             rpc,
+                             delta);
 }
 
 Installer::Installer(IODevice &_dev) :
@@ -76,12 +81,15 @@ Installer::Installer(IODevice &_dev) :
  * High level program flow for installation.
  *
  * - Ensure given package has the required metatdata.
+ * - If an older version of this game is installed, try sending only
+ *      what has changed. If that doesn't work out, carry on normally.
  * - Send the header info - device may take a while to process this as it
  *      erases/allocates space for upcoming transfer
  * - Send the content of the application.
  * - Commit the transaction.
  */
-int Installer::install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc)
+int Installer::install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc,
+                       bool delta)
 {
     isRPC = rpc;
     isLauncher = launcher;
@@ -103,8 +111,8 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
         }
     }
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
+    MappedFile elf;
+    if (!elf.map(path)) {
         fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
         return ENOENT;
     }
@@ -113,24 +121,30 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
         return ENODEV;
     }
 
-    unsigned fileSize = getInstallableElfSize(f);
+    unsigned fileSize = getInstallableElfSize(elf);
     if (!fileSize) {
         fprintf(stderr, "not a valid ELF file\n");
         return EINVAL;
     }
 
+    const uint8_t *data = elf.getBytes(0, fileSize);
+
     if (launcher)
         printf("updating launcher (%d bytes)\n", fileSize);
     else
         printf("installing %s, version %s (%d bytes)\n",
             package.c_str(), version.c_str(), fileSize);
 
+    if (delta && !launcher && installDelta(data, fileSize)) {
+        return EOK;
+    }
+
     int rv = sendHeader(fileSize);
     if (rv != 0) {
         return rv;
     }
 
-    bool success = sendFileContents(f, fileSize) && commit();
+    bool success = sendFileContents(data, fileSize) && commit();
     if (!success) {
         return EIO;
     }
@@ -145,27 +159,30 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
  *
  * This works by looking for the end of the last program segment.
  */
-unsigned Installer::getInstallableElfSize(FILE *f)
+unsigned Installer::getInstallableElfSize(const MappedFile &elf)
 {
-    Elf::FileHeader fh;
-    Elf::ProgramHeader ph;
+    const Elf::FileHeader *fh = elf.getObject<Elf::FileHeader>(0);
     unsigned size = 0;
 
-    rewind(f);
-    if (fread(&fh, sizeof fh, 1, f) < 1)
+    if (!fh)
         return 0;
 
-    if (fh.e_ident[0] != Elf::Magic0 || fh.e_ident[1] != Elf::Magic1 ||
-        fh.e_ident[2] != Elf::Magic2 || fh.e_ident[3] != Elf::Magic3)
+    if (fh->e_ident[0] != Elf::Magic0 || fh->e_ident[1] != Elf::Magic1 ||
+        fh->e_ident[2] != Elf::Magic2 || fh->e_ident[3] != Elf::Magic3)
         return 0;
 
-    for (unsigned i = 0; i < fh.e_phnum; ++i) {
-        fseek(f, fh.e_phoff + i * fh.e_phentsize, SEEK_SET);
-        if (fread(&ph, sizeof ph, 1, f) < 1)
+    for (unsigned i = 0; i < fh->e_phnum; ++i) {
+        const Elf::ProgramHeader *ph =
+            elf.getObject<Elf::ProgramHeader>(fh->e_phoff + i * fh->e_phentsize);
+        if (!ph)
             return 0;
-        size = std::max<unsigned>(size, ph.p_offset + ph.p_filesz);
+        size = std::max<unsigned>(size, ph->p_offset + ph->p_filesz);
     }
 
+    // Segments must actually be present in the file
+    if (size > elf.size())
+        return 0;
+
     return size;
 }
 
@@ -235,10 +252,8 @@ int Installer::sendHeader(uint32_t filesz)
  * There are no restrictions on the format of the payload - just fit as much
  * into each packet as we can.
  */
-bool Installer::sendFileContents(FILE *f, uint32_t filesz)
+bool Installer::sendFileContents(const uint8_t *data, uint32_t filesz)
 {
-    rewind(f);
- 
     unsigned progress = 0;
     ScopedProgressBar pb(filesz);
 
@@ -247,7 +262,7 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
         m.header |= UsbVolumeManager::WritePayload;
 
         unsigned chunk = std::min(filesz - progress, m.bytesFree());
-        m.len += chunk;
+        m.append(data + progress, chunk);
         progress += chunk;
         if (isRPC) {
             fprintf(stdout, "::progress:%u:%u\n", progress, filesz); fflush(stdout);
@@ -255,19 +270,10 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
         if (!chunk)
             return true;
 
-        if (fread(m.payload, chunk, 1, f) != 1) {
-            fprintf(stderr, "read error\n");
-            return false;
-        }
-
-        if (dev.writePacket(m.bytes, m.len) < 0) {
+        if (!sendPacket(m)) {
             return false;
         }
 
-        while (dev.numPendingOUTPackets() > IODevice::MAX_OUTSTANDING_OUT_TRANSFERS) {
-            dev.processEvents(1);
-        }
-
         pb.update(progress);
     }
 
@@ -275,13 +281,34 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
     return false;
 }
 
+/*
+ * Send a packet that gets no reply, throttling so we don't get too far
+ * ahead of the base.
+ */
+bool Installer::sendPacket(const USBProtocolMsg &m)
+{
+    if (dev.writePacket(m.bytes, m.len) < 0) {
+        return false;
+    }
+
+    while (dev.numPendingOUTPackets() > IODevice::MAX_OUTSTANDING_OUT_TRANSFERS) {
+        dev.processEvents(1);
+    }
+
+    return true;
+}
+
 /*
  * We're done sending payload data - tell the master to commit this app.
+ * If 'crc' is given, the master checks the whole payload against it first.
  */
-bool Installer::commit()
+bool Installer::commit(const uint32_t *crc)
 {
     USBProtocolMsg m(USBProtocol::Installer);
     m.header |= UsbVolumeManager::WriteCommit;
+    if (crc) {
+        m.append((const uint8_t*)crc, sizeof *crc);
+    }
 
     if (dev.writePacket(m.bytes, m.len) < 0) {
         return false;
@@ -305,3 +332,200 @@ bool Installer::commit()
 
     return true;
 }
+
+/*
+ * Delta install: update an installed game by sending only the parts of
+ * the ELF that changed.
+ *
+ * The base gives us a CRC for each DELTA_BLOCK_SIZE block of the installed
+ * volume. Any block of the new file with a matching CRC is copied on the
+ * base, and everything else is sent as normal payload data. The commit
+ * includes a CRC of the complete file, so a CRC collision costs us a
+ * retry rather than a corrupt install.
+ *
+ * Returns false if a delta install isn't possible or didn't work, in
+ * which case nothing has changed on the base and the caller should do
+ * a normal install.
+ */
+bool Installer::installDelta(const uint8_t *data, uint32_t filesz)
+{
+    const unsigned blockSize = UsbVolumeManager::DELTA_BLOCK_SIZE;
+
+    unsigned baseVolBlockCode;
+    if (!BaseDevice(dev).volumeCodeForPackage(package, baseVolBlockCode)) {
+        return false;
+    }
+
+    std::vector<uint32_t> installed;
+    if (!getInstalledHashes(baseVolBlockCode, installed) || installed.empty()) {
+        return false;
+    }
+
+    // Map each CRC to the first installed block that has it
+    std::map<uint32_t, unsigned> index;
+    for (unsigned i = 0; i < installed.size(); ++i) {
+        index.insert(std::make_pair(installed[i], i));
+    }
+
+    /*
+     * Look for each block of the new file. The last block is padded like
+     * erased flash, so it can match the end of the installed volume.
+     */
+
+    unsigned numBlocks = (filesz + blockSize - 1) / blockSize;
+    std::vector<int> source(numBlocks, -1);
+    unsigned matchedBytes = 0;
+
+    for (unsigned i = 0; i < numBlocks; ++i) {
+        uint8_t block[blockSize];
+        unsigned len = std::min(blockSize, filesz - i * blockSize);
+
+        memset(block, 0xFF, sizeof block);
+        memcpy(block, &data[i * blockSize], len);
+
+        std::map<uint32_t, unsigned>::const_iterator it = index.find(Util::crc32(block, sizeof block));
+        if (it != index.end()) {
+            source[i] = it->second;
+            matchedBytes += len;
+        }
+    }
+
+    if (!matchedBytes) {
+        return false;
+    }
+
+    printf("%u of %u bytes are already installed in volume 0x%x, sending the rest\n",
+        matchedBytes, filesz, baseVolBlockCode);
+
+    if (!sendDeltaHeader(filesz, baseVolBlockCode)) {
+        printf("couldn't start a delta install, sending the whole file\n");
+        return false;
+    }
+
+    /*
+     * Send runs of blocks: consecutive installed blocks as one copy,
+     * and new blocks as payload packets.
+     */
+
+    ScopedProgressBar pb(filesz);
+
+    for (unsigned i = 0; i < numBlocks;) {
+        unsigned j = i + 1;
+        if (source[i] >= 0) {
+            while (j < numBlocks && source[j] == source[j - 1] + 1)
+                j++;
+        } else {
+            while (j < numBlocks && source[j] < 0)
+                j++;
+        }
+
+        unsigned begin = i * blockSize;
+        unsigned end = std::min(j * blockSize, filesz);
+
+        if (source[i] >= 0) {
+            USBProtocolMsg m(USBProtocol::Installer);
+            m.header |= UsbVolumeManager::WriteDeltaCopy;
+
+            UsbVolumeManager::DeltaCopyRequest *req = m.zeroCopyAppend<UsbVolumeManager::DeltaCopyRequest>();
+            req->offset = source[i] * blockSize;
+            req->length = end - begin;
+
+            if (!sendPacket(m)) {
+                return false;
+            }
+        } else {
+            for (unsigned offset = begin; offset < end;) {
+                USBProtocolMsg m(USBProtocol::Installer);
+                m.header |= UsbVolumeManager::WritePayload;
+
+                unsigned chunk = std::min(end - offset, m.bytesFree());
+                m.append(&data[offset], chunk);
+                offset += chunk;
+
+                if (!sendPacket(m)) {
+                    return false;
+                }
+            }
+        }
+
+        if (isRPC) {
+            fprintf(stdout, "::progress:%u:%u\n", end, filesz); fflush(stdout);
+        }
+        pb.update(end);
+        i = j;
+    }
+
+    uint32_t crc = Util::crc32(data, filesz);
+    if (!commit(&crc)) {
+        printf("delta install failed, sending the whole file\n");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Fetch block CRCs for an installed volume, up to its first fully erased
+ * block, which marks the end of the installed ELF.
+ */
+bool Installer::getInstalledHashes(unsigned volBlockCode, std::vector<uint32_t> &hashes)
+{
+    const unsigned blockSize = UsbVolumeManager::DELTA_BLOCK_SIZE;
+
+    uint8_t erased[blockSize];
+    memset(erased, 0xFF, sizeof erased);
+    const uint32_t erasedCrc = Util::crc32(erased, sizeof erased);
+
+    BaseDevice base(dev);
+
+    for (;;) {
+        USBProtocolMsg m(USBProtocol::Installer);
+        m.header |= UsbVolumeManager::DeltaBlockHashes;
+
+        UsbVolumeManager::DeltaHashRequest *req = m.zeroCopyAppend<UsbVolumeManager::DeltaHashRequest>();
+        req->volume = volBlockCode;
+        req->firstBlock = hashes.size();
+
+        if (!base.writeAndWaitForReply(m) ||
+            m.payloadLen() < sizeof(UsbVolumeManager::DeltaHashReply)) {
+            return false;
+        }
+
+        const UsbVolumeManager::DeltaHashReply *r = m.castPayload<UsbVolumeManager::DeltaHashReply>();
+        if (r->firstBlock != hashes.size() || r->count > arraysize(r->crc)) {
+            return false;
+        }
+
+        for (unsigned i = 0; i < r->count; ++i) {
+            if (r->crc[i] == erasedCrc) {
+                return true;
+            }
+            hashes.push_back(r->crc[i]);
+        }
+
+        if (r->count < arraysize(r->crc)) {
+            return true;
+        }
+    }
+}
+
+bool Installer::sendDeltaHeader(uint32_t filesz, unsigned baseVolBlockCode)
+{
+    USBProtocolMsg m(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::WriteGameDeltaHeader;
+
+    uint32_t baseCode = baseVolBlockCode;
+    m.append((uint8_t*)&filesz, sizeof filesz);
+    m.append((uint8_t*)&baseCode, sizeof baseCode);
+
+    if (package.size() + 1 > m.bytesFree()) {
+        return false;
+    }
+    m.append((uint8_t*)package.c_str(), package.size() + 1);
+
+    if (dev.writePacket(m.bytes, m.len) < 0) {
+        return false;
+    }
+
+    return BaseDevice(dev).waitForReply(UsbVolumeManager::WroteHeaderOK, m);
+}
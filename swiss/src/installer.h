@@ -28,8 +28,10 @@
 
 #include "iodevice.h"
 #include "usbvolumemanager.h"
+#include "mappedfile.h"
 
 #include <string>
+#include <vector>
 
 class Installer
 {
@@ -38,15 +40,21 @@ public:
 
     static int run(int argc, char **argv, IODevice &_dev);
 
-    int install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc);
+    int install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc,
+                bool delta = true);
 
-    static unsigned getInstallableElfSize(FILE *f);
+    static unsigned getInstallableElfSize(const MappedFile &elf);
 
 private:
     int sendHeader(uint32_t filesz);
     bool getPackageMetadata(const char *path);
-    bool sendFileContents(FILE *f, uint32_t filesz);
-    bool commit();
+    bool sendFileContents(const uint8_t *data, uint32_t filesz);
+    bool sendPacket(const USBProtocolMsg &m);
+    bool commit(const uint32_t *crc = 0);
+
+    bool installDelta(const uint8_t *data, uint32_t filesz);
+    bool getInstalledHashes(unsigned volBlockCode, std::vector<uint32_t> &hashes);
+    bool sendDeltaHeader(uint32_t filesz, unsigned baseVolBlockCode);
 
     IODevice &dev;
     std::string package, version;
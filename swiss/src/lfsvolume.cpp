@@ -26,6 +26,7 @@
 #include "lfsvolume.h"
 
 #include <map>
+#include <algorithm>
 #include <errno.h>
 
 using namespace std;
@@ -75,42 +76,49 @@ bool SwissLFS::isEmpty(const uint8_t *bytes, unsigned count)
 LFSVolume::LFSVolume(unsigned cacheBlockSize, unsigned blockSize) :
     CacheBlockSize(cacheBlockSize),
     BlockSize(blockSize),
+    header(0),
+    payload(0),
+    payloadSize(0),
     objectDataIndex(0)
 {
 }
 
-bool LFSVolume::init(FILE *f)
+bool LFSVolume::init(const MappedFile &file, unsigned &offset)
 {
-    long pos = ftell(f);
+    /*
+     * Each volume occupies a full BlockSize in the file. 'offset' always
+     * advances past it, so that a bad volume can be skipped.
+     */
 
-    if (fread(&header, sizeof header, 1, f) != 1) {
+    unsigned pos = offset;
+    offset += BlockSize;
+
+    header = file.getObject<FlashVolumeHeader>(pos);
+    if (!header) {
         fprintf(stderr, "couldn't init from file\n");
         return false;
     }
 
-    if (header.type != FlashVolume::T_LFS) {
+    if (header->type != FlashVolume::T_LFS) {
         fprintf(stderr, "not an LFS volume!\n");
         return false;
     }
 
-    if (!header.isHeaderValid()) {
+    if (!header->isHeaderValid()) {
         return false;
     }
 
-    // payload is located CacheBlockSize after the beginning of the header
-    if (fseek(f, pos + CacheBlockSize, SEEK_SET) != 0) {
-        fprintf(stderr, "couldn't seek to payload: %ld %s\n", pos, strerror(errno));
+    // payload is located CacheBlockSize after the beginning of the header,
+    // and the final block in the file may be truncated.
+    unsigned payloadOffset = pos + CacheBlockSize;
+    if (payloadOffset >= file.size()) {
         return false;
     }
 
-    uint8_t buf[BlockSize - CacheBlockSize];
-    int rxed = fread(buf, 1, sizeof buf, f);
-    if (rxed <= 0) {
-        return false;
-    }
-    payload.insert(payload.begin(), buf, buf + rxed);
+    payloadSize = std::min(BlockSize - CacheBlockSize, file.size() - payloadOffset);
+    payload = file.getBytes(payloadOffset, payloadSize);
 
-    return true;
+    return payload != 0;
 }
 
 void LFSVolume::retrieveRecords(SaveData::Records & records)
@@ -120,15 +128,10 @@ void LFSVolume::retrieveRecords(SaveData::Records & records)
      * LFS object data ascends from the beginning of the payload.
      */
 
-    int start = payload.size() - CacheBlockSize;
-
-    unsigned indexRecordCount = 0;
+    int start = payloadSize - CacheBlockSize;
 
     while (start > 0) {
-        vector<uint8_t> block(payload.begin() + start,
-                              payload.begin() + start + CacheBlockSize);
-        bool done = retrieveRecordsFromBlock(records, block);
-        indexRecordCount++;
+        bool done = retrieveRecordsFromBlock(records, payload + start);
         if (done) {
             return;
         }
@@ -137,7 +140,7 @@ void LFSVolume::retrieveRecords(SaveData::Records & records)
     }
 }
 
-bool LFSVolume::retrieveRecordsFromBlock(SaveData::Records &records, vector<uint8_t> &indexBlock)
+bool LFSVolume::retrieveRecordsFromBlock(SaveData::Records &records, const uint8_t *indexBlock)
 {
     /*
      * Return true if we're at the end of valid data.
@@ -151,8 +154,8 @@ bool LFSVolume::retrieveRecordsFromBlock(SaveData::Records &records, vector<uint
      * there may be invalid anchors before we find a good one
      */
 
-    while (idx < indexBlock.size() - 3) {
-        FlashLFSIndexAnchor anchor(&indexBlock[idx]);
+    while (idx < CacheBlockSize - 3) {
+        FlashLFSIndexAnchor anchor(indexBlock + idx);
         idx += 3;
 
         if (anchor.isValid()) {
@@ -170,8 +173,8 @@ bool LFSVolume::retrieveRecordsFromBlock(SaveData::Records &records, vector<uint
      * keep going until we run into unprogrammed territory
      */
 
-    while (idx < indexBlock.size() - 5) {
-        FlashLFSIndexRecord rec(&indexBlock[idx]);
+    while (idx < CacheBlockSize - 5) {
+        FlashLFSIndexRecord rec(indexBlock + idx);
         idx += 5;
 
         if (rec.isEmpty()) {
@@ -182,15 +185,17 @@ bool LFSVolume::retrieveRecordsFromBlock(SaveData::Records &records, vector<uint
             // XXX: recalculate CRC to be sure/paranoid
             unsigned objSize = rec.sizeInBytes();
 
-            vector<uint8_t> objectData(payload.begin() + objectDataIndex,
-                                       payload.begin() + objectDataIndex + objSize);
+            if (objectDataIndex + objSize > payloadSize) {
+                fprintf(stderr, "LFS object extends past end of volume, skipping\n");
+                return true;
+            }
 
-            SaveData::Record r(rec.key, rec.crc16(), objSize, objectData);
+            SaveData::Record r(rec.key, rec.crc16(), objSize, payload + objectDataIndex);
             records[rec.key].push_back(r);
 
             objectDataIndex += objSize;
         }
     }
 
-    return idx < indexBlock.size() - 5;
+    return idx < CacheBlockSize - 5;
 }
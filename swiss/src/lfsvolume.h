@@ -27,6 +27,7 @@
 #define LFSVOLUME_H
 
 #include "savedata.h"
+#include "mappedfile.h"
 #include <vector>
 
 /*
@@ -63,7 +64,7 @@ struct FlashLFSIndexAnchor
     uint8_t offsetHigh;
     uint8_t check;
 
-    FlashLFSIndexAnchor(uint8_t *bytes)
+    FlashLFSIndexAnchor(const uint8_t *bytes)
     {
         offsetLow   = bytes[0];
         offsetHigh  = bytes[1];
@@ -96,7 +97,7 @@ struct FlashLFSIndexRecord
     uint8_t crc[2];     // Unaligned on purpose...
     uint8_t check;      //   to keep the check byte at the end.
 
-    FlashLFSIndexRecord(uint8_t *bytes)
+    FlashLFSIndexRecord(const uint8_t *bytes)
     {
         key     = bytes[0];
         size    = bytes[1];
@@ -131,19 +132,21 @@ class LFSVolume
 public:
     LFSVolume(unsigned cacheBlockSize, unsigned blockSize);
 
-    bool init(FILE *f);
+    bool init(const MappedFile &file, unsigned &offset);
     void retrieveRecords(SaveData::Records & records);
 
 private:
     const unsigned CacheBlockSize;
     const unsigned BlockSize;
 
-    FlashVolumeHeader header;
-    std::vector<uint8_t> payload;
+    // Both point into the mapped savedata file
+    const FlashVolumeHeader *header;
+    const uint8_t *payload;
+    unsigned payloadSize;
 
     unsigned objectDataIndex;
 
-    bool retrieveRecordsFromBlock(SaveData::Records & records, std::vector<uint8_t> &indexBlock);
+    bool retrieveRecordsFromBlock(SaveData::Records & records, const uint8_t *indexBlock);
 };
 
 #endif // LFSVOLUME_H
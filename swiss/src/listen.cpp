@@ -48,6 +48,8 @@ int Listen::run(int argc, char **argv, IODevice &_dev)
 
     // optional out file, defaults to stdout
     char *outpath = NULL;
+    char *rawpath = NULL;
+    char *decodepath = NULL;
     bool flush = false;
     for (int i = 2; i < argc; ++i) {
 
@@ -60,14 +62,29 @@ int Listen::run(int argc, char **argv, IODevice &_dev)
             i++;
         }
 
+        if (i + 1 < argc && !strcmp(argv[i], "--raw")) {
+            rawpath = argv[i + 1];
+            i++;
+        }
+
+        if (i + 1 < argc && !strcmp(argv[i], "--decode")) {
+            decodepath = argv[i + 1];
+            i++;
+        }
+
     }
 
     Listen listener(_dev);
-    return listener.listen(elfpath, outpath, flush);
+    if (decodepath) {
+        return listener.decodeRawFile(elfpath, outpath, decodepath, flush);
+    }
+    return listener.listen(elfpath, outpath, rawpath, flush);
 }
 
 Listen::Listen(IODevice &_dev) :
-    dev(_dev)
+    dev(_dev),
+    fout(NULL),
+    captureDone(false)
 {
 
 }
@@ -95,7 +112,7 @@ bool Listen::getFileOrStdout(FILE **f, const char *path)
     return true;
 }
 
-int Listen::listen(const char *elfpath, const char * outpath, bool flushLogs)
+int Listen::listen(const char *elfpath, const char *outpath, const char *rawpath, bool flushLogs)
 {
     if (!dev.open(IODevice::SIFTEO_VID, IODevice::BASE_PID)) {
         return ENODEV;
@@ -106,19 +123,36 @@ int Listen::listen(const char *elfpath, const char * outpath, bool flushLogs)
         return ENOENT;
     }
 
-    FILE *fout;
+    FILE *fraw = NULL;
+    if (rawpath) {
+        fraw = fopen(rawpath, "wb");
+        if (!fraw) {
+            fprintf(stderr, "can't open %s (%s)\n", rawpath, strerror(errno));
+            return ENOENT;
+        }
+
+        uint64_t magic = RAW_LOG_MAGIC;
+        fwrite(&magic, sizeof magic, 1, fraw);
+    }
+
     if (!getFileOrStdout(&fout, outpath)) {
+        if (fraw) {
+            fclose(fraw);
+        }
         return ENOENT;
     }
 
     logDecoder.init(flushLogs);
+    tthread::thread decoder(decodeThread, this);
 
+    int result = EOK;
     while (!interruptRequested) {
 
         if (dev.numPendingINPackets() == 0) {
             if (dev.processEvents(10) < 0) {
                 fprintf(stderr, "listen: error in processEvents()\n");
-                return EIO;
+                result = EIO;
+                break;
             }
 
             // yield so we can check again for an interrupt request
@@ -137,14 +171,119 @@ int Listen::listen(const char *elfpath, const char * outpath, bool flushLogs)
         }
 
         if (m.subsystem() == USBProtocol::Logger) {
-            if (!writeRecord(fout, m)) {
+            if (fraw && !writeRawRecord(fraw, m)) {
+                fprintf(stderr, "listen: couldn't write %s (%s)\n", rawpath, strerror(errno));
+                result = EIO;
                 break;
             }
+            enqueue(m);
         }
     }
 
+    // Let the decoder drain whatever is still queued, then stop it
+    queueLock.lock();
+    captureDone = true;
+    queueCond.notify_all();
+    queueLock.unlock();
+    decoder.join();
+
+    if (fraw) {
+        fclose(fraw);
+    }
     fclose(fout);
-    return EOK;
+    return result;
+}
+
+int Listen::decodeRawFile(const char *elfpath, const char *outpath, const char *rawpath, bool flushLogs)
+{
+    /*
+     * Offline decode of a log captured with --raw. The device isn't needed,
+     * just the same ELF that was running when the log was captured.
+     */
+
+    if (!dbgInfo.init(elfpath)) {
+        fprintf(stderr, "listen: couldn't initialize elf: %s\n", elfpath);
+        return ENOENT;
+    }
+
+    FILE *fraw = fopen(rawpath, "rb");
+    if (!fraw) {
+        fprintf(stderr, "can't open %s (%s)\n", rawpath, strerror(errno));
+        return ENOENT;
+    }
+
+    uint64_t magic;
+    if (fread(&magic, sizeof magic, 1, fraw) != 1 || magic != RAW_LOG_MAGIC) {
+        fprintf(stderr, "listen: %s is not a raw log file\n", rawpath);
+        fclose(fraw);
+        return EINVAL;
+    }
+
+    if (!getFileOrStdout(&fout, outpath)) {
+        fclose(fraw);
+        return ENOENT;
+    }
+
+    logDecoder.init(flushLogs);
+
+    int result = EOK;
+    uint8_t len;
+    while (!interruptRequested && fread(&len, sizeof len, 1, fraw) == 1) {
+        USBProtocolMsg m;
+        if (len < USBProtocolMsg::HEADER_BYTES || len > USBProtocolMsg::MAX_LEN ||
+            fread(m.bytes, len, 1, fraw) != 1) {
+            fprintf(stderr, "listen: %s is truncated\n", rawpath);
+            result = EINVAL;
+            break;
+        }
+
+        m.len = len;
+        if (!writeRecord(fout, m)) {
+            break;
+        }
+    }
+
+    fclose(fraw);
+    fclose(fout);
+    return result;
+}
+
+void Listen::enqueue(const USBProtocolMsg &m)
+{
+    tthread::lock_guard<tthread::mutex> guard(queueLock);
+    queue.push_back(m);
+    queueCond.notify_one();
+}
+
+void Listen::decodeThread(void *param)
+{
+    Listen *self = static_cast<Listen*>(param);
+
+    for (;;) {
+        USBProtocolMsg m;
+        {
+            tthread::lock_guard<tthread::mutex> guard(self->queueLock);
+            while (self->queue.empty() && !self->captureDone) {
+                self->queueCond.wait(self->queueLock);
+            }
+
+            if (self->queue.empty()) {
+                return;
+            }
+
+            m = self->queue.front();
+            self->queue.pop_front();
+        }
+
+        self->writeRecord(self->fout, m);
+    }
+}
+
+bool Listen::writeRawRecord(FILE *f, const USBProtocolMsg &m)
+{
+    uint8_t len = m.len;
+    return fwrite(&len, sizeof len, 1, f) == 1
+        && fwrite(m.bytes, m.len, 1, f) == 1;
 }
 
 bool Listen::writeRecord(FILE *f, const USBProtocolMsg & m)
@@ -29,8 +29,10 @@
 #include "iodevice.h"
 #include "elfdebuginfo.h"
 #include "logdecoder.h"
+#include "tinythread.h"
 
 #include <signal.h>
+#include <deque>
 
 class Listen
 {
@@ -40,13 +42,32 @@ public:
 private:
     Listen(IODevice &_dev);
 
-    int listen(const char *elfpath, const char *outpath, bool flushLogs=false);
+    int listen(const char *elfpath, const char *outpath, const char *rawpath, bool flushLogs=false);
+    int decodeRawFile(const char *elfpath, const char *outpath, const char *rawpath, bool flushLogs=false);
     bool writeRecord(FILE *f, const USBProtocolMsg &m);
 
+    /*
+     * Decoding runs on its own thread, so that formatting log text
+     * never holds up draining the IN endpoint. The USB loop only copies
+     * packets into 'queue' and, optionally, appends them to a raw log.
+     */
+    static void decodeThread(void *param);
+    void enqueue(const USBProtocolMsg &m);
+
     IODevice &dev;
     ELFDebugInfo dbgInfo;
     LogDecoder logDecoder;
 
+    FILE *fout;
+    std::deque<USBProtocolMsg> queue;
+    tthread::mutex queueLock;
+    tthread::condition_variable queueCond;
+    bool captureDone;
+
+    // Raw log files are RAW_LOG_MAGIC, then <uint8_t len> <len bytes of packet>
+    static const uint64_t RAW_LOG_MAGIC = 0x676f6c776172534cULL;
+    static bool writeRawRecord(FILE *f, const USBProtocolMsg &m);
+
 
     static bool getFileOrStdout(FILE **f, const char *path);
     static void onSignal(int sig);
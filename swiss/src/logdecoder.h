@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include <map>
 
 class LogDecoder {
@@ -51,8 +52,37 @@ public:
     size_t decode(FILE *f, ELFDebugInfo &DI, SvmLogTag tag, const uint32_t *buffer);
 
 private:
+    // One piece of a parsed format string
+    struct FormatStep {
+        enum Type {
+            NONE,
+            LITERAL,        // Copy 'text'
+            POINTER,        // %p
+            SYMBOL,         // %P
+            BINARY,         // %b
+            INTEGER,        // formatInt()
+            PRINTF_INT,     // snprintf() with 'text'
+            PRINTF_FLOAT,   // snprintf() with 'text', single-precision argument
+            CHARS,          // %C
+        } type;
+
+        char conv;
+        bool leadingZero;
+        int width;
+        std::string text;
+    };
+
+    struct FormatPlan {
+        bool found;
+        std::vector<FormatStep> steps;
+    };
+
+    const FormatPlan &getFormat(ELFDebugInfo &DI, uint32_t offset);
+    static void compileFormat(const char *fmt, FormatPlan &plan);
+    static char *formatInt(char *out, char *outEnd, const FormatStep &step, uint32_t value);
+
     void formatLog(ELFDebugInfo &DI, char *out, size_t outSize,
-        char *fmt, const uint32_t *args, size_t argCount);
+        const FormatPlan &plan, const uint32_t *args, size_t argCount);
 
     void writeLog(FILE *f, const char *str);
     void runScript();
@@ -60,6 +90,7 @@ private:
     unsigned scriptType;
     std::string scriptBuffer;
     std::map<unsigned, ScriptHandler> handlers;
+    std::map<uint32_t, FormatPlan> formats;
     bool flushLogs;
 };
 
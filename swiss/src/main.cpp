@@ -37,9 +37,13 @@
 #include "backup.h"
 #include "savedata.h"
 #include "listen.h"
+#include "progressbar.h"
+#include "tinythread.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <string>
+#include <vector>
 
 static const Command commands[] = {
     // Keeping this list in alphabetical order, for lack of a better ordering...
@@ -47,9 +51,15 @@ static const Command commands[] = {
     {
         "backup",
         "create a full backup of a Sifteo Base filesystem",
-        "backup <filesystem.bin>",
+        "backup [--raw] <filesystem.bin>",
         Backup::run
     },
+    {
+        "cycles",
+        "dump task timing and syscall cycle counts from the Sifteo Base",
+        "cycles [--reset]",
+        Profiler::runCycles
+    },
     {
         "delete",
         "delete data from the Sifteo Base",
@@ -65,13 +75,13 @@ static const Command commands[] = {
     {
         "install",
         "install a new game to the Sifteo Base",
-        "install [-l] <app.elf>",
+        "install [-l] [--full] <app.elf>",
         Installer::run
     },
     {
         "listen",
         "listen for and decode log activity from the Sifteo base",
-        "listen <app.elf> [--fout <file.txt> | --flush-logs]",
+        "listen <app.elf> [--fout <file.txt> | --flush-logs | --raw <file.bin> | --decode <file.bin>]",
         Listen::run
     },
     {
@@ -89,7 +99,7 @@ static const Command commands[] = {
     {
         "profile",
         "capture profiling data from an app",
-        "profile <app.elf> <output.txt>",
+        "profile <app.elf> <output.txt> [--stacks] [--folded] [--interval <seconds>] [--period <us>]",
         Profiler::run
     },
     {
@@ -98,10 +108,16 @@ static const Command commands[] = {
         "reboot",
         Reboot::run
     },
+    {
+        "restore",
+        "erase a Sifteo Base and restore a full backup onto it",
+        "restore <filesystem.bin>",
+        Backup::runRestore
+    },
     {
         "savedata",
         "extract or restore an application's save data",
-        "savedata (extract <package> <fout> [--raw] | restore <fin> | delete <pkg>)",
+        "savedata (extract <package> <fout> [--raw] | extract --all <dir> | restore <fin>... | delete <pkg>)",
         SaveData::run
     },
     {
@@ -128,6 +144,11 @@ static void usage()
         unsigned pad = maxUsageLen - strlen(commands[i].usage);
         fprintf(stderr, "  %s:%*s%s\n", commands[i].usage, pad, " ", commands[i].description);
     }
+
+    fprintf(stderr, "global options, before the command:\n");
+    fprintf(stderr, "  --base <n>:        use the nth attached Sifteo Base, counting from 0\n");
+    fprintf(stderr, "  --all-bases:       run the command on every attached Sifteo Base at once,\n"
+                    "                     replacing %%d in its arguments with the base number\n");
 }
 
 static void version()
@@ -158,6 +179,10 @@ static int run(int argc, char **argv, UsbDevice &usbdev)
     return 1;
 }
 
+static int libusbDebugLevel = -1;
+static unsigned baseIndex = 0;
+static bool allBases = false;
+
 static unsigned handleGlobalArgs(int argc, char **argv)
 {
     /*
@@ -174,17 +199,133 @@ static unsigned handleGlobalArgs(int argc, char **argv)
 
             unsigned long level = strtoul(argv[i + 1], NULL, 0);
             Usb::setDebug(level);
+            libusbDebugLevel = level;
+
+            consumed += 2;
+            i++;
+            continue;
+        }
 
+        if (!strcmp(argv[i], "--base") && i + 1 < argc) {
+            baseIndex = strtoul(argv[i + 1], NULL, 0);
             consumed += 2;
             i++;
             continue;
         }
 
+        if (!strcmp(argv[i], "--all-bases")) {
+            allBases = true;
+            consumed++;
+            continue;
+        }
+
+        // anything else belongs to the command
+        break;
     }
 
     return consumed;
 }
 
+static void closeDevice(UsbDevice &usbdev)
+{
+    if (usbdev.isOpen()) {
+        usbdev.close();
+        while (usbdev.isOpen()) {
+            usbdev.processEvents(1);
+        }
+    }
+}
+
+/*
+ * With --all-bases, every attached base gets its own thread running the
+ * same command, each with a private libusb context so that one thread's
+ * event handling never completes another thread's transfers.
+ */
+struct BaseJob {
+    unsigned index;
+    std::vector<std::string> args;
+    std::vector<char*> argv;
+    int result;
+};
+
+static void runBaseJob(void *param)
+{
+    BaseJob *job = static_cast<BaseJob*>(param);
+    ProgressBar::setAggregateSlot(job->index);
+
+    libusb_context *ctx;
+    if (libusb_init(&ctx) < 0) {
+        job->result = 1;
+        return;
+    }
+    if (libusbDebugLevel >= 0)
+        Usb::setDebug(libusbDebugLevel, ctx);
+
+    UsbDevice usbdev(ctx);
+    usbdev.selectDevice(job->index);
+    job->result = run(job->argv.size() - 1, &job->argv[0], usbdev);
+    closeDevice(usbdev);
+
+    libusb_exit(ctx);
+}
+
+static int runAllBases(int argc, char **argv)
+{
+    unsigned numBases = UsbDevice::numAttached(IODevice::SIFTEO_VID, IODevice::BASE_PID);
+    if (numBases == 0) {
+        fprintf(stderr, "device is not attached\n");
+        return 1;
+    }
+
+    std::vector<BaseJob> jobs(numBases);
+    for (unsigned i = 0; i < numBases; ++i) {
+        BaseJob &job = jobs[i];
+        job.index = i;
+        job.result = 1;
+
+        char number[16];
+        sprintf(number, "%u", i);
+
+        for (int a = 0; a < argc; ++a) {
+            std::string arg = argv[a];
+            for (size_t pos = arg.find("%d"); pos != std::string::npos; pos = arg.find("%d", pos))
+                arg.replace(pos, 2, number);
+            job.args.push_back(arg);
+        }
+    }
+
+    // Build argv only once the strings have stopped moving
+    for (unsigned i = 0; i < numBases; ++i) {
+        BaseJob &job = jobs[i];
+        for (unsigned a = 0; a < job.args.size(); ++a)
+            job.argv.push_back(&job.args[a][0]);
+        job.argv.push_back(0);
+    }
+
+    ProgressBar::beginAggregate(numBases);
+
+    std::vector<tthread::thread*> threads;
+    for (unsigned i = 0; i < numBases; ++i)
+        threads.push_back(new tthread::thread(runBaseJob, &jobs[i]));
+
+    for (unsigned i = 0; i < numBases; ++i) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    ProgressBar::endAggregate();
+
+    int rv = 0;
+    for (unsigned i = 0; i < numBases; ++i) {
+        if (jobs[i].result != 0) {
+            fprintf(stderr, "base %u: failed\n", i);
+            rv = jobs[i].result;
+        }
+    }
+
+    return rv;
+}
+
 int main(int argc, char **argv)
 {
     if (argc < 2 || !strcmp(argv[1], "-h")) {
@@ -211,14 +352,14 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    UsbDevice usbdev;
-    int rv = run(argc, argv, usbdev);
-
-    if (usbdev.isOpen()) {
-        usbdev.close();
-        while (usbdev.isOpen()) {
-            usbdev.processEvents(1);
-        }
+    int rv;
+    if (allBases) {
+        rv = runAllBases(argc, argv);
+    } else {
+        UsbDevice usbdev;
+        usbdev.selectDevice(baseIndex);
+        rv = run(argc, argv, usbdev);
+        closeDevice(usbdev);
     }
 
     Usb::deinit();
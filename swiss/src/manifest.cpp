@@ -27,7 +27,6 @@
 #include "usbprotocol.h"
 #include "elfdebuginfo.h"
 #include "tabularlist.h"
-#include "metadata.h"
 #include "swisserror.h"
 
 #include <sifteo/abi/elf.h>
@@ -37,6 +36,13 @@
 #include <string.h>
 #include <iomanip>
 
+// Metadata shown for each volume
+static const uint16_t listedKeys[] = {
+    _SYS_METADATA_PACKAGE_STR,
+    _SYS_METADATA_VERSION_STR,
+    _SYS_METADATA_TITLE_STR,
+};
+
 
 int Manifest::run(int argc, char **argv, IODevice &_dev)
 {
@@ -74,6 +80,7 @@ int Manifest::run(int argc, char **argv, IODevice &_dev)
 Manifest::Manifest(IODevice &_dev, bool rpc) :
     dev(_dev),
     base(_dev),
+    haveInventory(false),
     isRPC(rpc)
 {}
 
@@ -145,10 +152,19 @@ int Manifest::dumpOverview()
 {
     USBProtocolMsg buffer;
 
-    if (UsbVolumeManager::VolumeOverviewReply *o = base.getVolumeOverview(buffer)) {
-        overview = *o;
-    } else {
-        return EIO;
+    /*
+     * Fetch everything we're going to list in one streamed request,
+     * falling back on one request per volume and key for older firmware.
+     */
+
+    haveInventory = base.getVolumeInventory(overview, volumes, listedKeys, arraysize(listedKeys));
+
+    if (!haveInventory) {
+        if (UsbVolumeManager::VolumeOverviewReply *o = base.getVolumeOverview(buffer)) {
+            overview = *o;
+        } else {
+            return EIO;
+        }
     }
 
     printf("System: %d kB  Free: %d kB  Firmware: %s\n",
@@ -163,11 +179,45 @@ int Manifest::dumpOverview()
     return EOK;
 }
 
-void Manifest::dumpVolumes()
+void Manifest::fetchVolumes()
 {
+    /*
+     * Build the same volume list getVolumeInventory() would have,
+     * using separate requests for each volume and metadata key.
+     */
+
     unsigned volBlockCode;
+    volumes.clear();
+
+    while (overview.bits.clearFirst(volBlockCode)) {
+        USBProtocolMsg buffer;
+        BaseDevice::VolumeInventoryEntry entry;
+        entry.volBlockCode = volBlockCode;
+
+        if (UsbVolumeManager::VolumeDetailReply *detail = base.getVolumeDetail(buffer, volBlockCode)) {
+            entry.detail = *detail;
+        } else {
+            memset(&entry.detail, 0, sizeof entry.detail);
+        }
+
+        for (unsigned i = 0; i < arraysize(listedKeys); ++i) {
+            if (base.getMetadata(buffer, volBlockCode, listedKeys[i])) {
+                entry.metadata[listedKeys[i]] = std::string(buffer.castPayload<char>(), buffer.payloadLen());
+            }
+        }
+
+        volumes.push_back(entry);
+    }
+}
+
+void Manifest::dumpVolumes()
+{
     TabularList table;
 
+    if (!haveInventory) {
+        fetchVolumes();
+    }
+
     // Heading
     table.cell() << "VOL";
     table.cell() << "TYPE";
@@ -178,26 +228,16 @@ void Manifest::dumpVolumes()
     table.cell() << "TITLE";
     table.endRow();
 
-    Metadata metadata(dev);
-
     // Volume table
-    while (overview.bits.clearFirst(volBlockCode)) {
-        USBProtocolMsg buffer;
-
-        UsbVolumeManager::VolumeDetailReply *detail = base.getVolumeDetail(buffer, volBlockCode);
-        if (!detail) {
-            static UsbVolumeManager::VolumeDetailReply zero;
-            detail = &zero;
-        }
-        // copy the type, since it appears to get overwritten between here and when
-        // its needed for the RPC message
-        uint16_t cpType = detail->type;
+    for (unsigned i = 0; i < volumes.size(); ++i) {
+        const BaseDevice::VolumeInventoryEntry &vol = volumes[i];
+        const UsbVolumeManager::VolumeDetailReply *detail = &vol.detail;
 
-        std::string package = metadata.getString(volBlockCode, _SYS_METADATA_PACKAGE_STR);
-        std::string version = metadata.getString(volBlockCode, _SYS_METADATA_VERSION_STR);
-        std::string title   = metadata.getString(volBlockCode, _SYS_METADATA_TITLE_STR);
+        std::string package = vol.metadataString(_SYS_METADATA_PACKAGE_STR);
+        std::string version = vol.metadataString(_SYS_METADATA_VERSION_STR);
+        std::string title   = vol.metadataString(_SYS_METADATA_TITLE_STR);
 
-        table.cell() << std::setiosflags(std::ios::hex) << std::setw(2) << std::setfill('0') << volBlockCode;
+        table.cell() << std::setiosflags(std::ios::hex) << std::setw(2) << std::setfill('0') << vol.volBlockCode;
         table.cell() << getVolumeTypeString(detail->type);
         table.cell(table.RIGHT) << (detail->selfBytes / 1024);
         table.cell(table.RIGHT) << (detail->childBytes / 1024);
@@ -212,8 +252,8 @@ void Manifest::dumpVolumes()
             std::string titleRPC = title == "(none)" ? "" : title;
             
             fprintf(stdout, "::volume:%u:%u:%u:%u:%s:%s:%s\n",
-                volBlockCode,
-                cpType,
+                vol.volBlockCode,
+                detail->type,
                 detail->selfBytes,
                 detail->childBytes,
                 packageRPC.c_str(),
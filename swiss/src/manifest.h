@@ -32,6 +32,7 @@
 #include "basedevice.h"
 
 #include <string>
+#include <vector>
 
 class Manifest
 {
@@ -44,10 +45,13 @@ private:
     int dumpBaseSysInfo();
     int dumpOverview();
     void dumpVolumes();
+    void fetchVolumes();
 
     const char *getVolumeTypeString(unsigned type);
 
     UsbVolumeManager::VolumeOverviewReply overview;
+    std::vector<BaseDevice::VolumeInventoryEntry> volumes;
+    bool haveInventory;
     IODevice &dev;
     BaseDevice base;
     char volTypeBuffer[16];
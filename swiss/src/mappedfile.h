@@ -28,6 +28,11 @@
 
 #include <stdint.h>
 
+/*
+ * Read-only view of an entire file. Parsers read headers and payloads
+ * in place, rather than copying them out with fread().
+ */
+
 class MappedFile
 {
 public:
@@ -38,13 +43,35 @@ public:
         filesz(0)
     {}
 
+    ~MappedFile() {
+        unmap();
+    }
+
     int map(const char *path);
     void unmap();
     bool isMapped() const;
 
-    uint8_t* getData(unsigned offset, unsigned &available) const;
+    unsigned size() const {
+        return filesz;
+    }
+
+    const uint8_t* getData(unsigned offset, unsigned &available) const;
+
+    /// The 'length' bytes at 'offset', or NULL if the file is too short.
+    const uint8_t* getBytes(unsigned offset, unsigned length) const;
+
+    /// 'count' consecutive T's at 'offset', or NULL if the file is too short.
+    template <typename T>
+    const T* getObject(unsigned offset, unsigned count = 1) const {
+        if (count > filesz / sizeof(T))
+            return 0;
+        return reinterpret_cast<const T*>(getBytes(offset, count * sizeof(T)));
+    }
 
 private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
     uintptr_t fileHandle;
     uintptr_t mappingHandle;
     uint8_t *pData;
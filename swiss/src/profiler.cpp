@@ -26,14 +26,19 @@
 #include "profiler.h"
 #include "elfdebuginfo.h"
 #include "usbprotocol.h"
+#include "tabularlist.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <set>
+#include <sstream>
+#include <time.h>
 
 sig_atomic_t Profiler::interruptRequested;
 ELFDebugInfo Profiler::dbgInfo;
+std::tr1::unordered_map<Profiler::Addr, std::string> Profiler::symbolCache;
 
 int Profiler::run(int argc, char **argv, IODevice &_dev)
 {
@@ -42,13 +47,48 @@ int Profiler::run(int argc, char **argv, IODevice &_dev)
         return 1;
     }
 
+    Options opts;
+    for (int i = 3; i < argc; ++i) {
+        if (!strcmp(argv[i], "--stacks")) {
+            opts.stacks = true;
+        } else if (!strcmp(argv[i], "--folded")) {
+            opts.format = FormatFolded;
+        } else if (!strcmp(argv[i], "--interval") && i + 1 < argc) {
+            opts.intervalSec = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--period") && i + 1 < argc) {
+            opts.periodUS = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "unrecognized argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
     if (signal(SIGINT, onSignal) == SIG_ERR) {
         fputs("An error occurred while setting a signal handler.\n", stderr);
         return 1;
     }
 
     Profiler profiler(_dev);
-    bool success = profiler.profile(argv[1], argv[2]);
+    bool success = profiler.profile(argv[1], argv[2], opts);
+
+    return success ? 0 : 1;
+}
+
+int Profiler::runCycles(int argc, char **argv, IODevice &_dev)
+{
+    bool reset = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--reset")) {
+            reset = true;
+        } else {
+            fprintf(stderr, "unrecognized argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Profiler profiler(_dev);
+    bool success = profiler.dumpStats(reset);
 
     return success ? 0 : 1;
 }
@@ -64,27 +104,18 @@ void Profiler::onSignal(int sig) {
     }
 }
 
-static bool myfunction (uint64_t i,uint64_t j) { return (i<j); }
-
-bool Profiler::profile(const char *elfPath, const char *outPath)
+bool Profiler::profile(const char *elfPath, const char *outPath, const Options &opts)
 {
     dbgInfo.clear();
+    symbolCache.clear();
     if (!dbgInfo.init(elfPath)) {
         fprintf(stderr, "couldn't open %s: %s\n", elfPath, strerror(errno));
         return false;
     }
 
-    FILE *fout;
-    if (!strcmp(outPath, "stderr")) {
-        fout = stderr;
-    } else if (!strcmp(outPath, "stdout")) {
-        fout = stderr;
-    }
-    else {
-        if (!(fout = fopen(outPath, "w"))) {
-            fprintf(stderr, "could not open %s: %s\n", outPath, strerror(errno));
-            return false;
-        }
+    if (opts.intervalSec && (!strcmp(outPath, "stderr") || !strcmp(outPath, "stdout"))) {
+        fprintf(stderr, "--interval needs an output file\n");
+        return false;
     }
 
     if (!dev.open(IODevice::SIFTEO_VID, IODevice::BASE_PID))
@@ -92,39 +123,56 @@ bool Profiler::profile(const char *elfPath, const char *outPath)
 
     {
         USBProtocolMsg m(USBProtocol::Profiler);
-        m.append(0);    // profiler enabled command
-        m.append(1);    // enable
+        m.append(SetProfilingEnabled);
+        m.append(opts.stacks ? Stacks : PCOnly);
+        if (opts.periodUS) {
+            // The firmware clamps this to what it can sustain
+            unsigned period = std::min(opts.periodUS, 0xFFFFu);
+            m.append(period & 0xFF);
+            m.append(period >> 8);
+        }
         dev.writePacket(m.bytes, m.len);
     }
 
-    std::map<Addr, Count> addresses;
+    /*
+     * 'session' covers the whole run. With --interval, 'snapshot' only
+     * holds samples since the last snapshot was written, to <out>.<n>.
+     */
+    Samples session, snapshot;
+    unsigned snapshotCount = 0;
+    time_t lastSnapshot = time(NULL);
     interruptRequested = false;
-    uint64_t totalSamples = 0;
 
     while (!interruptRequested) {
 
-        while (!dev.numPendingINPackets())
+        while (!dev.numPendingINPackets() && !interruptRequested)
             dev.processEvents(1);
 
+        if (opts.intervalSec && time(NULL) - lastSnapshot >= time_t(opts.intervalSec)) {
+            std::ostringstream path;
+            path << outPath << "." << snapshotCount++;
+            writeSamples(snapshot, opts.format, path.str().c_str());
+            snapshot.clear();
+            lastSnapshot = time(NULL);
+        }
+
+        if (!dev.numPendingINPackets())
+            continue;
+
         USBProtocolMsg m;
         dev.readPacket(m.bytes, m.MAX_LEN, m.len);
-        if (!m.len)
+        if (!m.len || m.subsystem() != USBProtocol::Profiler)
             continue;
 
-        unsigned numSamples = m.payloadLen() / sizeof(uint32_t);
-        const uint32_t *address = reinterpret_cast<uint32_t*>(m.payload);
-
-        for (unsigned i = 0; i < numSamples; ++i) {
-            addresses[*address]++;
-            totalSamples++;
-            address++;
-        }
+        session.add(m, opts.stacks);
+        if (opts.intervalSec)
+            snapshot.add(m, opts.stacks);
     }
 
     {
         USBProtocolMsg m(USBProtocol::Profiler);
-        m.append(0);    // profiler enabled command
-        m.append(0);    // disable
+        m.append(SetProfilingEnabled);
+        m.append(Disabled);
         dev.writePacket(m.bytes, m.len);
 
         while (dev.numPendingOUTPackets())
@@ -132,13 +180,378 @@ bool Profiler::profile(const char *elfPath, const char *outPath)
     }
 
     fprintf(stderr, "interrupt received, writing sample data...");
-    prettyPrintSamples(addresses, totalSamples, fout);
+    bool success = writeSamples(session, opts.format, outPath);
     fprintf(stderr, "done\n");
 
+    if (!dumpSampleStats())
+        fprintf(stderr, "no subsystem histogram, base firmware may be too old\n");
+
+    return success;
+}
+
+void Profiler::Samples::add(const USBProtocolMsg &m, bool stacks)
+{
+    /*
+     * Without --stacks every word is a separate PC sample. With it, the
+     * whole packet is one stack, and its first word is the PC.
+     */
+
+    unsigned numWords = m.payloadLen() / sizeof(uint32_t);
+    if (!numWords)
+        return;
+
+    const uint32_t *words = reinterpret_cast<const uint32_t*>(m.payload);
+
+    if (stacks) {
+        std::string key(reinterpret_cast<const char*>(words), numWords * sizeof(uint32_t));
+        this->stacks[key]++;
+        addresses[words[0]]++;
+        total++;
+    } else {
+        for (unsigned i = 0; i < numWords; ++i) {
+            addresses[words[i]]++;
+            total++;
+        }
+    }
+}
+
+void Profiler::Samples::clear()
+{
+    addresses.clear();
+    stacks.clear();
+    total = 0;
+}
+
+bool Profiler::writeSamples(const Samples &samples, OutputFormat format, const char *path)
+{
+    FILE *f;
+    if (!strcmp(path, "stderr")) {
+        f = stderr;
+    } else if (!strcmp(path, "stdout")) {
+        f = stdout;
+    } else if (!(f = fopen(path, "w"))) {
+        fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    if (format == FormatFolded)
+        writeFoldedStacks(samples, f);
+    else
+        prettyPrintSamples(samples.addresses, samples.total, f);
+
+    if (f != stderr && f != stdout)
+        fclose(f);
+
+    return true;
+}
+
+bool Profiler::dumpStats(bool reset)
+{
+    if (!dev.open(IODevice::SIFTEO_VID, IODevice::BASE_PID))
+        return false;
+
+    /*
+     * Ask for both sets of stats at once. The base answers in order:
+     * one TaskStatsReply per task, then any cycle counters, then a
+     * cycle reply marking the end.
+     */
+    USBProtocolMsg m(USBProtocol::Profiler);
+    m.append(GetTaskStats);
+    m.append(reset);
+    dev.writePacket(m.bytes, m.len);
+
+    m.init(USBProtocol::Profiler);
+    m.append(GetCycleStats);
+    m.append(reset);
+    dev.writePacket(m.bytes, m.len);
+
+    std::vector<StatRow> taskTimes, taskCycles, syscallCycles;
+
+    for (;;) {
+        if (!readReply(m)) {
+            fprintf(stderr, "timed out waiting for stats, base firmware may be too old\n");
+            return false;
+        }
+
+        if (m.subsystem() != USBProtocol::Profiler)
+            continue;
+
+        if (m.payloadLen() == sizeof(TaskStatsReply) && m.payload[0] == GetTaskStats) {
+            const TaskStatsReply *r = m.castPayload<TaskStatsReply>();
+            if (r->runs) {
+                StatRow row(taskName(r->task), r->runs, uint64_t(r->totalMS) * 1000, r->maxUS);
+                taskTimes.push_back(row);
+            }
+            continue;
+        }
+
+        if (m.payloadLen() == sizeof(CycleStatsReply) && m.payload[0] == GetCycleStats) {
+            const CycleStatsReply *r = m.castPayload<CycleStatsReply>();
+            uint64_t total = (uint64_t(r->totalCyclesHigh) << 32) | r->totalCyclesLow;
+
+            if (r->table == EndOfTables)
+                break;
+
+            if (r->table == TaskCycles) {
+                taskCycles.push_back(StatRow(taskName(r->index), r->calls, total, r->maxCycles));
+            } else if (r->table == SyscallCycles) {
+                std::ostringstream name;
+                name << "_SC(" << r->index << ")";
+                syscallCycles.push_back(StatRow(name.str(), r->calls, total, r->maxCycles));
+            }
+        }
+    }
+
+    printStats("Task time", "US", taskTimes);
+
+    if (taskCycles.empty() && syscallCycles.empty()) {
+        fprintf(stderr, "\nno cycle counts, rebuild the firmware with CYCLE_PROFILER=1\n");
+    } else {
+        printStats("Task cycles", "CYC", taskCycles);
+        printStats("Syscall cycles", "CYC", syscallCycles);
+    }
+
+    if (!dumpDmaStats(reset))
+        fprintf(stderr, "\nno DMA stats, base firmware may be too old\n");
+
+    if (!dumpAudioStats(reset))
+        fprintf(stderr, "\nno audio stats, base firmware may be too old\n");
+
+    return true;
+}
+
+bool Profiler::dumpDmaStats(bool reset)
+{
+    // The base sends one DmaStatsReply per channel
+    USBProtocolMsg m(USBProtocol::Profiler);
+    m.append(GetDmaStats);
+    m.append(reset);
+    dev.writePacket(m.bytes, m.len);
+
+    std::vector<DmaStatsReply> channels;
+    while (channels.size() < NUM_DMA_CHANNELS) {
+        if (!readReply(m))
+            return false;
+
+        if (m.subsystem() == USBProtocol::Profiler &&
+            m.payloadLen() == sizeof(DmaStatsReply) && m.payload[0] == GetDmaStats)
+            channels.push_back(*m.castPayload<DmaStatsReply>());
+    }
+
+    fprintf(stdout, "\n******** DMA channels ********\n\n");
+
+    TabularList table;
+
+    table.cell() << "CHANNEL";
+    table.cell(table.RIGHT) << "TRANSFERS";
+    table.cell(table.RIGHT) << "HALF";
+    table.cell(table.RIGHT) << "ERRORS";
+    table.cell(table.RIGHT) << "CONTENDED";
+    table.cell(table.RIGHT) << "CONFLICTS";
+    table.endRow();
+
+    for (unsigned i = 0; i < channels.size(); ++i) {
+        const DmaStatsReply &r = channels[i];
+        if (!(r.transfers | r.halfTransfers | r.errors | r.conflicts))
+            continue;
+
+        // Named like the reference manual, with channels counted from 1
+        bool dma1 = r.channel < NUM_DMA1_CHANNELS;
+        unsigned ch = dma1 ? r.channel : r.channel - NUM_DMA1_CHANNELS;
+
+        table.cell() << (dma1 ? "DMA1" : "DMA2") << "_Channel" << (ch + 1);
+        table.cell(table.RIGHT) << r.transfers;
+        table.cell(table.RIGHT) << r.halfTransfers;
+        table.cell(table.RIGHT) << r.errors;
+        table.cell(table.RIGHT) << r.contended;
+        table.cell(table.RIGHT) << r.conflicts;
+        table.endRow();
+    }
+
+    table.end();
+    return true;
+}
+
+bool Profiler::dumpAudioStats(bool reset)
+{
+    USBProtocolMsg m(USBProtocol::Profiler);
+    m.append(GetAudioStats);
+    m.append(reset);
+    dev.writePacket(m.bytes, m.len);
+
+    for (;;) {
+        if (!readReply(m))
+            return false;
+
+        if (m.subsystem() == USBProtocol::Profiler &&
+            m.payloadLen() == sizeof(AudioStatsReply) && m.payload[0] == GetAudioStats)
+            break;
+    }
+
+    const AudioStatsReply &r = *m.castPayload<AudioStatsReply>();
+
+    fprintf(stdout, "\n******** Audio output ********\n\n");
+
+    TabularList table;
+
+    table.cell() << "INTERRUPTS";
+    table.cell(table.RIGHT) << "UNDERRUNS";
+    table.cell(table.RIGHT) << "MIN FILL";
+    table.cell(table.RIGHT) << "MAX FILL";
+    table.cell(table.RIGHT) << "CAPACITY";
+    table.endRow();
+
+    table.cell() << r.interrupts;
+    table.cell(table.RIGHT) << r.underruns;
+    table.cell(table.RIGHT) << r.minFill;
+    table.cell(table.RIGHT) << r.maxFill;
+    table.cell(table.RIGHT) << r.capacity;
+    table.endRow();
+
+    table.end();
+    return true;
+}
+
+bool Profiler::dumpSampleStats()
+{
+    /*
+     * The base counts every sample it takes, including ones it had to
+     * drop, so this is the most accurate picture of where time went.
+     * Sample packets still in flight are skipped while we wait.
+     */
+
+    USBProtocolMsg m(USBProtocol::Profiler);
+    m.append(GetSampleStats);
+    m.append(0);
+    dev.writePacket(m.bytes, m.len);
+
+    for (;;) {
+        if (!readReply(m))
+            return false;
+
+        if (m.subsystem() == USBProtocol::Profiler &&
+            m.payloadLen() >= offsetof(SampleStatsReply, samples) &&
+            m.payload[0] == GetSampleStats)
+            break;
+    }
+
+    SampleStatsReply r;
+    memset(&r, 0, sizeof r);
+    memcpy(&r, m.payload, std::min<unsigned>(m.payloadLen(), sizeof r));
+
+    uint64_t total = r.dropped;
+    for (unsigned i = 0; i < NumSubsystems; ++i)
+        total += r.samples[i];
+    if (!total)
+        return true;
+
+    fprintf(stdout, "\n******** Subsystem histogram ********\n\n");
+
+    TabularList table;
+
+    table.cell() << "SUBSYSTEM";
+    table.cell(table.RIGHT) << "SAMPLES";
+    table.cell(table.RIGHT) << "PERCENT";
+    table.endRow();
+
+    for (unsigned i = 0; i < NumSubsystems; ++i) {
+        char percent[16];
+        snprintf(percent, sizeof percent, "%.2f%%", r.samples[i] * 100.0 / total);
+
+        table.cell() << (i == None ? "None" : subSystemName(SubSystem(i)));
+        table.cell(table.RIGHT) << r.samples[i];
+        table.cell(table.RIGHT) << percent;
+        table.endRow();
+    }
+
+    table.end();
+
+    if (r.dropped)
+        fprintf(stderr, "\n%u samples dropped, try a longer --period\n\n", r.dropped);
+
     return true;
 }
 
-void Profiler::prettyPrintSamples(const std::map<Addr, Count> &addresses, uint64_t total, FILE *f)
+bool Profiler::readReply(USBProtocolMsg &m)
+{
+    for (unsigned ms = 0; ms < REPLY_TIMEOUT_MS; ++ms) {
+        if (dev.numPendingINPackets()) {
+            dev.readPacket(m.bytes, m.MAX_LEN, m.len);
+            return true;
+        }
+        dev.processEvents(1);
+    }
+
+    return false;
+}
+
+void Profiler::printStats(const char *title, const char *units, const std::vector<StatRow> &rows)
+{
+    std::multiset<StatRow> sorted(rows.begin(), rows.end());
+
+    uint64_t grandTotal = 0;
+    for (std::multiset<StatRow>::const_iterator i = sorted.begin(); i != sorted.end(); ++i)
+        grandTotal += i->total;
+
+    fprintf(stdout, "\n******** %s ********\n\n", title);
+
+    TabularList table;
+
+    table.cell() << "NAME";
+    table.cell(table.RIGHT) << "CALLS";
+    table.cell(table.RIGHT) << "TOTAL-" << units;
+    table.cell(table.RIGHT) << "AVG-" << units;
+    table.cell(table.RIGHT) << "MAX-" << units;
+    table.cell(table.RIGHT) << "SHARE";
+    table.endRow();
+
+    for (std::multiset<StatRow>::const_iterator i = sorted.begin(); i != sorted.end(); ++i) {
+        float percent = grandTotal ? (float(i->total) / float(grandTotal)) * 100 : 0;
+
+        table.cell() << i->name;
+        table.cell(table.RIGHT) << i->calls;
+        table.cell(table.RIGHT) << i->total;
+        table.cell(table.RIGHT) << (i->calls ? i->total / i->calls : 0);
+        table.cell(table.RIGHT) << i->max;
+        table.cell(table.RIGHT) << unsigned(percent + 0.5f) << "%";
+        table.endRow();
+    }
+
+    table.end();
+}
+
+std::string Profiler::taskName(unsigned id)
+{
+    // Must match the order of Tasks::TaskID in the firmware
+    static const char *names[] = {
+        "PowerManager",
+        "UsbOUT",
+        "AudioPull",
+        "FaultLogger",
+        "Debugger",
+        "AssetLoader",
+        "Pause",
+        "CubeConnector",
+        "BluetoothDriver",
+        "BluetoothProtocol",
+        "Heartbeat",
+        "UsbIN",
+        "Profiler",
+        "TestJig",
+        "FactoryTest",
+        "PreEraser",
+        "SysLFSWriter",
+    };
+
+    if (id < arraysize(names))
+        return names[id];
+
+    std::ostringstream name;
+    name << "Task" << id;
+    return name.str();
+}
+
+void Profiler::prettyPrintSamples(const AddrCounts &addresses, uint64_t total, FILE *f)
 {
     /*
      * Collapse multiple samples from different offsets within the same
@@ -155,12 +568,11 @@ void Profiler::prettyPrintSamples(const std::map<Addr, Count> &addresses, uint64
     // a better solution...
 
     std::map<std::string, FuncInfo> samples;
-    for (std::map<Addr, Count>::const_iterator i = addresses.begin();
+    for (AddrCounts::const_iterator i = addresses.begin();
          i != addresses.end(); ++i)
     {
         Addr a = i->first;
-        std::string s = dbgInfo.formatAddress(a & 0xfffffff);
-        std::string base = s.substr(0, s.find('+'));
+        const std::string &base = functionName(a & 0xfffffff);
 
         if (a < samples[base].address || samples[base].address == 0) {
             samples[base].address = a;
@@ -179,6 +591,8 @@ void Profiler::prettyPrintSamples(const std::map<Addr, Count> &addresses, uint64
          i != samples.end(); ++i)
     {
         unsigned subsystem = i->second.address >> 28;
+        if (subsystem >= NumSubsystems)
+            subsystem = None;
         samplesets[subsystem].insert(Entry(i->first, i->second.address, i->second.count));
     }
 
@@ -194,6 +608,71 @@ void Profiler::prettyPrintSamples(const std::map<Addr, Count> &addresses, uint64
     fflush(f);
 }
 
+void Profiler::writeFoldedStacks(const Samples &samples, FILE *f)
+{
+    /*
+     * Folded stacks, as read by flamegraph.pl and speedscope: frames
+     * outermost first, separated by ';', then the sample count. The
+     * subsystem is the root frame.
+     *
+     * Device stacks are a scan for likely return addresses, so runs of
+     * the same function are collapsed. Return addresses point after
+     * their call, so we back up into the calling instruction.
+     */
+
+    std::map<std::string, Count> folded;
+
+    if (samples.stacks.empty()) {
+        // PC-only samples are just one-frame stacks
+        for (AddrCounts::const_iterator i = samples.addresses.begin();
+             i != samples.addresses.end(); ++i)
+        {
+            std::string line = subSystemName(SubSystem(i->first >> 28));
+            line += ";" + functionName(i->first & 0xfffffff);
+            folded[line] += i->second;
+        }
+    }
+
+    for (StackCounts::const_iterator i = samples.stacks.begin();
+         i != samples.stacks.end(); ++i)
+    {
+        unsigned depth = i->first.size() / sizeof(uint32_t);
+        std::vector<uint32_t> words(depth);
+        memcpy(&words[0], i->first.data(), depth * sizeof(uint32_t));
+
+        std::vector<const std::string *> frames;
+        for (unsigned d = 0; d < depth; ++d) {
+            Addr a = d ? (words[d] & ~1) - 1 : (words[d] & 0xfffffff);
+            const std::string &name = functionName(a);
+            if (frames.empty() || *frames.back() != name)
+                frames.push_back(&name);
+        }
+
+        std::string line = subSystemName(SubSystem(words[0] >> 28));
+        for (unsigned d = frames.size(); d > 0; --d)
+            line += ";" + *frames[d - 1];
+
+        folded[line] += i->second;
+    }
+
+    for (std::map<std::string, Count>::const_iterator i = folded.begin();
+         i != folded.end(); ++i)
+        fprintf(f, "%s %u\n", i->first.c_str(), i->second);
+
+    fflush(f);
+}
+
+const std::string &Profiler::functionName(Addr a)
+{
+    // Symbol lookups are slow, and the same few addresses recur constantly
+    std::tr1::unordered_map<Addr, std::string>::iterator i = symbolCache.find(a);
+    if (i != symbolCache.end())
+        return i->second;
+
+    std::string s = dbgInfo.formatAddress(a);
+    return symbolCache[a] = s.substr(0, s.find('+'));
+}
+
 const char *Profiler::subSystemName(SubSystem s)
 {
     switch (s) {
@@ -201,6 +680,8 @@ const char *Profiler::subSystemName(SubSystem s)
     case AudioPull: return "AudioPull";
     case SVCISR:    return "SVCISR";
     case RFISR:     return "RFISR";
+    case BluetoothISR: return "BluetoothISR";
+    case NeighborISR: return "NeighborISR";
     default:        return "Uncategorized";
     }
 }
@@ -32,6 +32,9 @@
 #include <signal.h>
 #include <stdio.h>
 #include <map>
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
 
 class Profiler
 {
@@ -41,11 +44,43 @@ public:
     // entry point for the 'profile' command
     static int run(int argc, char **argv, IODevice &_dev);
 
-    bool profile(const char *elfPath, const char *outPath);
+    // entry point for the 'cycles' command
+    static int runCycles(int argc, char **argv, IODevice &_dev);
+
+    enum OutputFormat {
+        FormatText,
+        FormatFolded,   // one "frame;frame;frame count" line per stack
+    };
+
+    struct Options {
+        bool stacks;
+        unsigned intervalSec;   // write a snapshot this often, 0 for never
+        unsigned periodUS;      // sample period, 0 for the firmware's default
+        OutputFormat format;
+
+        Options() : stacks(false), intervalSec(0), periodUS(0), format(FormatText) {}
+    };
+
+    bool profile(const char *elfPath, const char *outPath, const Options &opts);
+    bool dumpStats(bool reset);
 
 private:
     typedef uint32_t Addr;
     typedef unsigned Count;
+    typedef std::tr1::unordered_map<Addr, Count> AddrCounts;
+
+    // Stacks are keyed by their raw sample bytes, innermost frame first
+    typedef std::tr1::unordered_map<std::string, Count> StackCounts;
+
+    struct Samples {
+        AddrCounts addresses;
+        StackCounts stacks;
+        uint64_t total;
+
+        Samples() : total(0) {}
+        void add(const USBProtocolMsg &m, bool stacks);
+        void clear();
+    };
 
     enum SubSystem {
         None,
@@ -53,6 +88,8 @@ private:
         AudioPull,
         SVCISR,
         RFISR,
+        BluetoothISR,
+        NeighborISR,
         NumSubsystems   // must be last
     };
 
@@ -76,12 +113,118 @@ private:
         }
     };
 
+    /*
+     * Commands and replies, must match SampleProfiler in the firmware.
+     */
+    enum Command {
+        SetProfilingEnabled,
+        GetTaskStats,
+        GetCycleStats,
+        GetDmaStats,
+        GetAudioStats,
+        GetSampleStats
+    };
+
+    enum SampleMode {
+        Disabled,
+        PCOnly,
+        Stacks
+    };
+
+    enum CycleTable {
+        TaskCycles,
+        SyscallCycles,
+        EndOfTables = 0xFF
+    };
+
+    struct TaskStatsReply {
+        uint8_t command;
+        uint8_t task;
+        uint8_t reserved[2];
+        uint32_t runs;
+        uint32_t overruns;
+        uint32_t maxUS;
+        uint32_t totalMS;
+    };
+
+    struct CycleStatsReply {
+        uint8_t command;
+        uint8_t table;
+        uint16_t index;
+        uint32_t calls;
+        uint32_t maxCycles;
+        uint32_t totalCyclesLow;
+        uint32_t totalCyclesHigh;
+    };
+
+    struct DmaStatsReply {
+        uint8_t command;
+        uint8_t channel;
+        uint8_t reserved[2];
+        uint32_t transfers;
+        uint32_t halfTransfers;
+        uint32_t errors;
+        uint32_t contended;
+        uint32_t conflicts;
+    };
+
+    struct AudioStatsReply {
+        uint8_t command;
+        uint8_t reserved[3];
+        uint32_t interrupts;
+        uint32_t underruns;
+        uint16_t minFill;
+        uint16_t maxFill;
+        uint16_t capacity;
+        uint16_t reserved2;
+    };
+
+    struct SampleStatsReply {
+        uint8_t command;
+        uint8_t numSubsystems;
+        uint8_t reserved[2];
+        uint32_t dropped;
+        uint32_t samples[NumSubsystems];
+    };
+
+    // Must match Dma in the firmware
+    static const unsigned NUM_DMA1_CHANNELS = 7;
+    static const unsigned NUM_DMA_CHANNELS = 12;
+
+    struct StatRow {
+        std::string name;
+        uint64_t calls;
+        uint64_t total;
+        uint64_t max;
+
+        StatRow(const std::string &n, uint64_t c, uint64_t t, uint64_t m) :
+            name(n), calls(c), total(t), max(m) {}
+
+        // sort in descending order of total cost
+        bool operator< (const StatRow &other) const {
+            return other.total < total;
+        }
+    };
+
+    static const unsigned REPLY_TIMEOUT_MS = 2000;
+
+    bool readReply(USBProtocolMsg &m);
+    static void printStats(const char *title, const char *units, const std::vector<StatRow> &rows);
+    bool dumpDmaStats(bool reset);
+    bool dumpAudioStats(bool reset);
+    bool dumpSampleStats();
+    static std::string taskName(unsigned id);
+
     static void onSignal(int sig);
-    static void prettyPrintSamples(const std::map<Addr, Count> &addresses, uint64_t total, FILE *f);
+    static bool writeSamples(const Samples &samples, OutputFormat format, const char *path);
+    static void prettyPrintSamples(const AddrCounts &addresses, uint64_t total, FILE *f);
+    static void writeFoldedStacks(const Samples &samples, FILE *f);
+    static const std::string &functionName(Addr a);
     static const char *subSystemName(SubSystem s);
 
     static sig_atomic_t interruptRequested;
     static ELFDebugInfo dbgInfo;
+    static std::tr1::unordered_map<Addr, std::string> symbolCache;
     IODevice &dev;
 };
 
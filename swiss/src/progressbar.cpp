@@ -24,22 +24,43 @@
  */
 
 #include "progressbar.h"
+#include "tinythread.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace {
+
+    struct Aggregate {
+        tthread::mutex mutex;
+        std::map<tthread::thread::id, unsigned> slots;
+        std::vector<unsigned> percent;
+    };
+
+    Aggregate aggregate;
+
+} // namespace
 
 
 void ProgressBar::begin()
 {
-    redraw();
+    if (!reportAggregate(0))
+        redraw();
 }
 
 void ProgressBar::end()
 {
-    fprintf(stdout, "\n");
+    tthread::lock_guard<tthread::mutex> guard(aggregate.mutex);
+    if (aggregate.percent.empty())
+        fprintf(stdout, "\n");
 }
 
 void ProgressBar::update(unsigned amount)
 {
+    if (reportAggregate(amount))
+        return;
+
     unsigned next = (uint64_t(amount) * width) / totalAmount;
     if (next != quantized) {
         quantized = next;
@@ -57,3 +78,46 @@ void ProgressBar::redraw()
     fprintf(stdout, "]");
     fflush(stdout);
 }
+
+bool ProgressBar::reportAggregate(unsigned amount)
+{
+    tthread::lock_guard<tthread::mutex> guard(aggregate.mutex);
+
+    std::map<tthread::thread::id, unsigned>::iterator i =
+        aggregate.slots.find(tthread::this_thread::get_id());
+    if (i == aggregate.slots.end())
+        return false;
+
+    unsigned next = (uint64_t(amount) * 100) / totalAmount;
+    if (next == aggregate.percent[i->second])
+        return true;
+    aggregate.percent[i->second] = next;
+
+    fprintf(stdout, "\r");
+    for (unsigned slot = 0; slot < aggregate.percent.size(); ++slot)
+        fprintf(stdout, "[base %u: %3u%%] ", slot, aggregate.percent[slot]);
+    fflush(stdout);
+
+    return true;
+}
+
+void ProgressBar::beginAggregate(unsigned numSlots)
+{
+    tthread::lock_guard<tthread::mutex> guard(aggregate.mutex);
+    aggregate.percent.assign(numSlots, 0);
+}
+
+void ProgressBar::setAggregateSlot(unsigned slot)
+{
+    tthread::lock_guard<tthread::mutex> guard(aggregate.mutex);
+    aggregate.slots[tthread::this_thread::get_id()] = slot;
+}
+
+void ProgressBar::endAggregate()
+{
+    tthread::lock_guard<tthread::mutex> guard(aggregate.mutex);
+    if (!aggregate.percent.empty())
+        fprintf(stdout, "\n");
+    aggregate.slots.clear();
+    aggregate.percent.clear();
+}
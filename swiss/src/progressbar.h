@@ -37,12 +37,22 @@ public:
     void update(unsigned amount);
     void end();
 
+    /*
+     * When several bases are being worked on at once, each worker thread
+     * claims a slot, and its progress bars are folded into one shared
+     * status line instead of drawing over each other.
+     */
+    static void beginAggregate(unsigned numSlots);
+    static void setAggregateSlot(unsigned slot);
+    static void endAggregate();
+
 private:
     unsigned width;
     unsigned totalAmount;
     unsigned quantized;
 
     void redraw();
+    bool reportAggregate(unsigned amount);
 };
 
 
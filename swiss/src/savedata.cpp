@@ -33,7 +33,7 @@
 #include "swisserror.h"
 
 #include <string>
-#include <sstream>
+#include <deque>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -55,19 +55,26 @@ int SaveData::run(int argc, char **argv, IODevice &_dev)
         char *pkgStr = 0;
         bool raw = false;
         bool rpc = false;
+        bool all = false;
 
         for (int i = 2; i < argc; ++i) {
             if (!strcmp(argv[i], "--rpc")) {
                 rpc = true;
             } else if (!strcmp(argv[i], "--raw")) {
                 raw = true;
-            } else if (!pkgStr) {
+            } else if (!strcmp(argv[i], "--all")) {
+                all = true;
+            } else if (!pkgStr && !all) {
                 pkgStr = argv[i];
             } else {
                 path = argv[i];
             }
         }
 
+        if (all && path) {
+            return saveData.extractAll(path, rpc);
+        }
+
         if (!path || !pkgStr) {
             fprintf(stderr, "incorrect args\n");
             return EINVAL;
@@ -77,8 +84,14 @@ int SaveData::run(int argc, char **argv, IODevice &_dev)
     }
 
     if (argc >= 3 && !strcmp(argv[1], "restore")) {
-        const char *path = argv[2];
-        return saveData.restore(path);
+        // Restore each file in turn, e.g. everything from 'extract --all'
+        for (int i = 2; i < argc; ++i) {
+            int rv = saveData.restore(argv[i]);
+            if (rv != EOK) {
+                return rv;
+            }
+        }
+        return EOK;
     }
 
     if (argc >= 4 && !strcmp(argv[1], "normalize")) {
@@ -146,11 +159,10 @@ int SaveData::extract(const char *pkgStr, const char *filepath, bool raw, bool r
         return ENOENT;
     }
 
-    if (!writeFileHeader(fraw, volume, reply->count)) {
-        return EIO;
-    }
-
-    if (!writeVolumes(reply, fraw, rpc)) {
+    bool success = writeFileHeader(fraw, volume, reply->count) &&
+                   writeVolumes(reply, fraw, rpc);
+    success = !fclose(fraw) && success;
+    if (!success) {
         return EIO;
     }
 
@@ -158,7 +170,6 @@ int SaveData::extract(const char *pkgStr, const char *filepath, bool raw, bool r
         return EOK;
     }
 
-    fclose(fraw);
     int rv = normalize(rawfilepath, filepath);
     remove(rawfilepath);
 
@@ -169,27 +180,68 @@ int SaveData::extract(const char *pkgStr, const char *filepath, bool raw, bool r
 }
 
 
-int SaveData::restore(const char *filepath)
+int SaveData::extractAll(const char *dirpath, bool rpc)
 {
     /*
-     * please implement me. thank you in advance.
+     * Extract raw savedata for every installed game that has any, to
+     * <dirpath>/<package>.bin. These can all go straight back to
+     * another base with 'restore'.
      */
 
-    FILE *fin = fopen(filepath, "rb");
-    if (!fin) {
+    BaseDevice base(dev);
+    Metadata metadata(dev);
+
+    USBProtocolMsg m;
+    UsbVolumeManager::VolumeOverviewReply *overview = base.getVolumeOverview(m);
+    if (!overview) {
+        return EIO;
+    }
+
+    // 'overview' lives in 'm', which the loop below would reuse
+    BitVector<256> volumes = overview->bits;
+    unsigned volBlockCode;
+
+    while (volumes.clearFirst(volBlockCode)) {
+        USBProtocolMsg detailBuf;
+        UsbVolumeManager::VolumeDetailReply *detail = base.getVolumeDetail(detailBuf, volBlockCode);
+        if (!detail || detail->type != FlashVolume::T_GAME || !detail->childBytes) {
+            continue;
+        }
+
+        std::string pkg = metadata.getString(volBlockCode, _SYS_METADATA_PACKAGE_STR);
+        if (pkg.empty()) {
+            continue;
+        }
+
+        std::string path = std::string(dirpath) + "/" + pkg + ".bin";
+        printf("%s -> %s\n", pkg.c_str(), path.c_str());
+
+        int rv = extract(pkg.c_str(), path.c_str(), true, rpc);
+        if (rv != EOK) {
+            return rv;
+        }
+    }
+
+    return EOK;
+}
+
+
+int SaveData::restore(const char *filepath)
+{
+    MappedFile fin;
+    if (!fin.map(filepath)) {
         fprintf(stderr, "couldn't open %s: %s\n", filepath, strerror(errno));
         return ENOENT;
     }
 
     int fileVersion;
     if (!getValidFileVersion(fin, fileVersion)) {
-        fclose(fin);
         return EINVAL;
     }
 
     HeaderCommon hdr;
-    if (!readHeader(fileVersion, hdr, fin)) {
-        fclose(fin);
+    unsigned offset = 0;
+    if (!readHeader(fileVersion, hdr, fin, offset)) {
         return EINVAL;
     }
 
@@ -201,8 +253,7 @@ int SaveData::restore(const char *filepath)
     }
 
     Records records;
-    if (!retrieveRecords(records, hdr, fin)) {
-        fclose(fin);
+    if (!retrieveRecords(records, hdr, fin, offset)) {
         return EIO;
     }
 
@@ -215,8 +266,8 @@ int SaveData::restore(const char *filepath)
 
 int SaveData::normalize(const char *inpath, const char *outpath)
 {
-    FILE *fin = fopen(inpath, "rb");
-    if (!fin) {
+    MappedFile fin;
+    if (!fin.map(inpath)) {
         fprintf(stderr, "couldn't open %s: %s\n", inpath, strerror(errno));
         return ENOENT;
     }
@@ -229,23 +280,26 @@ int SaveData::normalize(const char *inpath, const char *outpath)
 
     int fileVersion;
     if (!getValidFileVersion(fin, fileVersion)) {
-        fclose(fin);
+        fclose(fout);
         return EINVAL;
     }
 
     HeaderCommon hdr;
-    if (!readHeader(fileVersion, hdr, fin)) {
-        fclose(fin);
+    unsigned offset = 0;
+    if (!readHeader(fileVersion, hdr, fin, offset)) {
+        fclose(fout);
         return EINVAL;
     }
 
     Records records;
-    if (!retrieveRecords(records, hdr, fin)) {
-        fclose(fin);
+    if (!retrieveRecords(records, hdr, fin, offset)) {
+        fclose(fout);
         return EINVAL;
     }
 
-    if (!writeNormalizedRecords(records, hdr, fout)) {
+    bool success = writeNormalizedRecords(records, hdr, fout);
+    success = !fclose(fout) && success;
+    if (!success) {
         return EIO;
     }
 
@@ -286,8 +340,16 @@ int SaveData::del(const char *pkgStr)
 
 bool SaveData::restoreRecords(unsigned vol, const Records &records)
 {
+    /*
+     * Records are streamed back to back. The base handles them in order,
+     * and a failed header leaves nothing for the following payload to
+     * write into, so rather than waiting on each object's header reply we
+     * keep sending and tally the replies as they arrive.
+     */
+
     ScopedProgressBar pb(records.size());
     unsigned progress = 0;
+    unsigned pendingReplies = 0;
 
     for (Records::const_iterator it = records.begin(); it != records.end(); it++) {
 
@@ -298,41 +360,76 @@ bool SaveData::restoreRecords(unsigned vol, const Records &records)
             if (!restoreItem(vol, recs.back())) {
                 return false;
             }
+            pendingReplies++;
+        }
+
+        while (dev.numPendingINPackets() && pendingReplies) {
+            if (!readRestoreReply()) {
+                return false;
+            }
+            pendingReplies--;
         }
 
         progress++;
         pb.update(progress);
     }
 
+    while (pendingReplies) {
+        if (!readRestoreReply()) {
+            return false;
+        }
+        pendingReplies--;
+    }
+
     while (dev.numPendingOUTPackets())
         dev.processEvents(1);
 
     return true;
 }
 
+bool SaveData::readRestoreReply()
+{
+    BaseDevice base(dev);
+    USBProtocolMsg m(USBProtocol::Installer);
+
+    if (!base.waitForReply(m.header | UsbVolumeManager::WriteLFSObjectHeader, m)) {
+        fprintf(stderr, "\nbase couldn't store a record, it may be out of space\n");
+        return false;
+    }
+
+    return true;
+}
+
 bool SaveData::restoreItem(unsigned parentVol, const Record & record)
 {
     /*
-     * Restore a single key-value pair.
+     * Send a single key-value pair. The header's reply is collected
+     * later, by restoreRecords().
      */
 
-    BaseDevice base(dev);
+    USBProtocolMsg m(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::WriteLFSObjectHeader;
 
-    USBProtocolMsg m;
-    if (!base.beginLFSRestore(m, parentVol, record.key, record.payload.size(), record.crc)) {
+    UsbVolumeManager::LFSObjectHeader *req = m.zeroCopyAppend<UsbVolumeManager::LFSObjectHeader>();
+    req->vh = parentVol;
+    req->crc = record.crc;
+    req->key = record.key;
+    req->dataSize = record.size;
+
+    if (dev.writePacket(m.bytes, m.len) < 0) {
         return false;
     }
 
     unsigned progress = 0;
 
-    while (progress < record.payload.size()) {
+    while (progress < record.size) {
         m.init(USBProtocol::Installer);
         m.header |= UsbVolumeManager::WriteLFSObjectPayload;
 
-        unsigned chunk = std::min(unsigned(record.payload.size() - progress), m.bytesFree());
+        unsigned chunk = std::min(record.size - progress, m.bytesFree());
         ASSERT(chunk != 0);
 
-        m.append(&record.payload[progress], chunk);
+        m.append(record.payload + progress, chunk);
         progress += chunk;
 
         if (dev.writePacket(m.bytes, m.len) < 0) {
@@ -346,7 +443,7 @@ bool SaveData::restoreItem(unsigned parentVol, const Record & record)
 }
 
 
-bool SaveData::getValidFileVersion(FILE *f, int &version)
+bool SaveData::getValidFileVersion(const MappedFile &file, int &version)
 {
     /*
      * Retrieve this file's version and ensure it's valid.
@@ -355,20 +452,16 @@ bool SaveData::getValidFileVersion(FILE *f, int &version)
     struct MiniHeader {
         uint64_t    magic;
         uint32_t    version;
-    } minihdr;
-
-    if (fread(&minihdr, sizeof minihdr, 1, f) != 1) {
-        fprintf(stderr, "i/o error: %s\n", strerror(errno));
-        return false;
-    }
+    };
 
-    if (minihdr.magic != MAGIC) {
+    const MiniHeader *minihdr = reinterpret_cast<const MiniHeader*>(
+        file.getBytes(0, sizeof(MiniHeader)));
+    if (!minihdr || minihdr->magic != MAGIC) {
         fprintf(stderr, "not a recognized savedata file\n");
         return false;
     }
 
-    rewind(f);
-    version = minihdr.version;
+    version = minihdr->version;
 
     switch (version) {
     case 0x1:
@@ -381,35 +474,37 @@ bool SaveData::getValidFileVersion(FILE *f, int &version)
         return true;
 
     default:
-        fprintf(stderr, "unsupported savedata file version: 0x%x\n", minihdr.version);
+        fprintf(stderr, "unsupported savedata file version: 0x%x\n", minihdr->version);
         return false;
     }
 }
 
 
-bool SaveData::readHeader(int version, HeaderCommon &h, FILE *f)
+bool SaveData::readHeader(int version, HeaderCommon &h, const MappedFile &file, unsigned &offset)
 {
     /*
      * Given the version, convert this file's header into HeaderCommon.
+     * On success, 'offset' is left just past the header.
      */
 
     if (version == 2) {
-        HeaderV2 v2;
-        if (fread(&v2, sizeof v2, 1, f) != 1) {
-            fprintf(stderr, "i/o error: %s\n", strerror(errno));
+        const HeaderV2 *v2 = file.getObject<HeaderV2>(offset);
+        if (!v2) {
+            fprintf(stderr, "savedata file is truncated\n");
             return false;
         }
+        offset += sizeof *v2;
 
-        h.numBlocks     = v2.numBlocks;
-        h.mc_blockSize  = v2.mc_blockSize;
-        h.mc_pageSize   = v2.mc_pageSize;
+        h.numBlocks     = v2->numBlocks;
+        h.mc_blockSize  = v2->mc_blockSize;
+        h.mc_pageSize   = v2->mc_pageSize;
 
-        memcpy(h.appUUID.bytes, v2.appUUID.bytes, sizeof(h.appUUID.bytes));
-        memcpy(h.baseUniqueID, v2.baseUniqueID, sizeof(h.baseUniqueID));
+        memcpy(h.appUUID.bytes, v2->appUUID.bytes, sizeof(h.appUUID.bytes));
+        memcpy(h.baseUniqueID, v2->baseUniqueID, sizeof(h.baseUniqueID));
 
-        if (!readStr(h.baseFirmwareVersionStr, f) ||
-            !readStr(h.packageStr, f) ||
-            !readStr(h.versionStr, f))
+        if (!readStr(h.baseFirmwareVersionStr, file, offset) ||
+            !readStr(h.packageStr, file, offset) ||
+            !readStr(h.versionStr, file, offset))
         {
             return false;
         }
@@ -421,7 +516,8 @@ bool SaveData::readHeader(int version, HeaderCommon &h, FILE *f)
 }
 
 
-bool SaveData::retrieveRecords(Records &records, const HeaderCommon &details, FILE *f)
+bool SaveData::retrieveRecords(Records &records, const HeaderCommon &details,
+    const MappedFile &file, unsigned offset)
 {
     /*
      * Common implementation for all savedata file versions.
@@ -430,7 +526,7 @@ bool SaveData::retrieveRecords(Records &records, const HeaderCommon &details, FI
     for (unsigned b = 0; b < details.numBlocks; ++b) {
 
         LFSVolume volume(details.mc_pageSize, details.mc_blockSize);
-        if (!volume.init(f)) {
+        if (!volume.init(file, offset)) {
             fprintf(stderr, "couldn't init volume, skipping\n");
             continue;
         }
@@ -442,16 +538,21 @@ bool SaveData::retrieveRecords(Records &records, const HeaderCommon &details, FI
 }
 
 
-void SaveData::writeNormalizedItem(stringstream & ss, uint8_t key, uint32_t len, const void *data)
+bool SaveData::writeNormalizedItem(FILE *f, uint8_t key, uint32_t len, const void *data)
 {
     /*
      * Each header item in a simplified savedata file looks like:
      * <uint8_t key> <uint32_t bloblen> <bloblen bytes of payload>
      */
 
-    ss << key;
-    ss.write((const char*)&len, sizeof(len));
-    ss.write((const char*)data, len);
+    return fwrite(&key, sizeof key, 1, f) == 1
+        && fwrite(&len, sizeof len, 1, f) == 1
+        && (len == 0 || fwrite(data, len, 1, f) == 1);
+}
+
+uint32_t SaveData::normalizedItemSize(uint32_t len)
+{
+    return sizeof(uint8_t) + sizeof(uint32_t) + len;
 }
 
 
@@ -463,29 +564,31 @@ bool SaveData::writeNormalizedRecords(Records &records, const HeaderCommon &deta
     }
 
     /*
-     * Write headers section
+     * Write headers section. Items go straight to the file, so each
+     * section's length is added up beforehand.
      */
 
-    stringstream hs;
-    writeNormalizedItem(hs, PackageString, details.packageStr.length(), details.packageStr.c_str());
-    writeNormalizedItem(hs, VersionString, details.versionStr.length(), details.versionStr.c_str());
-    writeNormalizedItem(hs, UUID, sizeof(details.appUUID), &details.appUUID);
-    writeNormalizedItem(hs, BaseHWID, sizeof(details.baseUniqueID), &details.baseUniqueID);
-    writeNormalizedItem(hs, BaseFirmwareVersion, details.baseFirmwareVersionStr.length(), details.baseFirmwareVersionStr.c_str());
-
     struct NormalizedSectionHeader {
         uint32_t type;
         uint32_t length;
     } section;
 
     section.type = SectionHeader;
-    section.length = hs.tellp();
+    section.length = normalizedItemSize(details.packageStr.length())
+                   + normalizedItemSize(details.versionStr.length())
+                   + normalizedItemSize(sizeof(details.appUUID))
+                   + normalizedItemSize(sizeof(details.baseUniqueID))
+                   + normalizedItemSize(details.baseFirmwareVersionStr.length());
 
     if (fwrite(&section, sizeof section, 1, f) != 1) {
         return false;
     }
 
-    if (fwrite(hs.str().c_str(), section.length, 1, f) != 1) {
+    if (!writeNormalizedItem(f, PackageString, details.packageStr.length(), details.packageStr.c_str()) ||
+        !writeNormalizedItem(f, VersionString, details.versionStr.length(), details.versionStr.c_str()) ||
+        !writeNormalizedItem(f, UUID, sizeof(details.appUUID), &details.appUUID) ||
+        !writeNormalizedItem(f, BaseHWID, sizeof(details.baseUniqueID), &details.baseUniqueID) ||
+        !writeNormalizedItem(f, BaseFirmwareVersion, details.baseFirmwareVersionStr.length(), details.baseFirmwareVersionStr.c_str())) {
         return false;
     }
 
@@ -493,25 +596,28 @@ bool SaveData::writeNormalizedRecords(Records &records, const HeaderCommon &deta
      * Write records section
      */
 
-    stringstream rs;
+    section.type = SectionRecords;
+    section.length = 0;
     for (Records::const_iterator it = records.begin(); it != records.end(); it++) {
-
         const std::vector<Record> &recs = it->second;
-
         for (std::vector<Record>::const_iterator r = recs.begin(); r != recs.end(); r++) {
-            writeNormalizedItem(rs, r->key, r->payload.size(), &(r->payload[0]));
+            section.length += normalizedItemSize(r->size);
         }
     }
 
-    section.type = SectionRecords;
-    section.length = rs.tellp();
-
     if (fwrite(&section, sizeof section, 1, f) != 1) {
         return false;
     }
 
-    if (fwrite(rs.str().c_str(), section.length, 1, f) != 1) {
-        return false;
+    for (Records::const_iterator it = records.begin(); it != records.end(); it++) {
+
+        const std::vector<Record> &recs = it->second;
+
+        for (std::vector<Record>::const_iterator r = recs.begin(); r != recs.end(); r++) {
+            if (!writeNormalizedItem(f, r->key, r->size, r->payload)) {
+                return false;
+            }
+        }
     }
 
     return true;
@@ -576,64 +682,129 @@ bool SaveData::writeVolumes(UsbVolumeManager::LFSDetailReply *reply, FILE *f, bo
     unsigned progTotal = reply->count * BLOCK_SIZE;
     unsigned overallProgress = 0;
 
+    std::vector<uint8_t> volume(BLOCK_SIZE);
+
     /*
      * For each block, request all of its data, and write it out to our file.
      */
 
     for (unsigned i = 0; i < reply->count; ++i) {
 
-        unsigned baseAddress = reply->records[i].address;
-        unsigned requestProgress = 0, replyProgress = 0;
+        if (!readVolume(reply->records[i].address, &volume[0], pb, overallProgress, progTotal, rpc)) {
+            return false;
+        }
 
-        // Queue up the first few reads, respond as results arrive
-        for (unsigned b = 0; b < 3; ++b) {
-            sendRequest(baseAddress, requestProgress);
+        if (fwrite(&volume[0], BLOCK_SIZE, 1, f) != 1) {
+            return false;
         }
 
-        while (replyProgress < BLOCK_SIZE) {
-            dev.processEvents(1);
+        overallProgress += BLOCK_SIZE;
+    }
 
-            while (dev.numPendingINPackets() != 0) {
-                if (!writeReply(f, replyProgress)) {
-                    return false;
-                }
+    return true;
+}
 
-                pb.update(overallProgress + replyProgress);
-                if (rpc) {
-                    fprintf(stdout, "::progress:%u:%u\n", overallProgress + replyProgress, progTotal); fflush(stdout);
-                }
-                sendRequest(baseAddress, requestProgress);
+
+bool SaveData::readVolume(unsigned baseAddr, uint8_t *buffer, ScopedProgressBar &pb,
+    unsigned overallProgress, unsigned progTotal, bool rpc)
+{
+    /*
+     * LFS volumes are mostly empty in the middle: object data grows up from
+     * the start and index blocks grow down from the end. Ask the base which
+     * pages are blank, fill those in with 0xFF here, and only read the rest.
+     */
+
+    BaseDevice base(dev);
+    std::vector<bool> erasedPages(BLOCK_SIZE / PAGE_SIZE, false);
+
+    for (unsigned b = 0; b < BLOCK_SIZE; b += ERASE_BLOCK_SIZE) {
+        USBProtocolMsg m;
+        const UsbVolumeManager::FlashDeviceScanReply *scan = base.flashDeviceScan(m, baseAddr + b);
+        if (!scan) {
+            // Older firmware; read the whole volume
+            break;
+        }
+
+        for (unsigned p = 0; p < ERASE_BLOCK_SIZE / PAGE_SIZE; ++p) {
+            if (scan->erasedPages.test(p)) {
+                erasedPages[(b / PAGE_SIZE) + p] = true;
+                memset(buffer + b + p * PAGE_SIZE, 0xFF, PAGE_SIZE);
             }
         }
-        overallProgress += BLOCK_SIZE;
+    }
+
+    unsigned requestProgress = 0, replyProgress = 0;
+    std::deque<unsigned> pendingReads;
+
+    // Keep a few reads queued up, respond as results arrive
+    for (unsigned r = 0; r < NUM_PENDING_REQUESTS; ++r) {
+        sendRequest(baseAddr, requestProgress, erasedPages, pendingReads);
+    }
+
+    while (!pendingReads.empty()) {
+        dev.processEvents(1);
+
+        while (dev.numPendingINPackets() != 0 && !pendingReads.empty()) {
+            USBProtocolMsg m(USBProtocol::Installer);
+            if (!base.waitForReply(m.header | UsbVolumeManager::FlashDeviceRead, m)) {
+                return false;
+            }
+
+            unsigned offset = pendingReads.front();
+            pendingReads.pop_front();
+
+            unsigned len = std::min(m.payloadLen(), BLOCK_SIZE - offset);
+            memcpy(buffer + offset, m.castPayload<uint8_t>(), len);
+            replyProgress = offset + len;
+
+            pb.update(overallProgress + replyProgress);
+            if (rpc) {
+                fprintf(stdout, "::progress:%u:%u\n", overallProgress + replyProgress, progTotal); fflush(stdout);
+            }
+            sendRequest(baseAddr, requestProgress, erasedPages, pendingReads);
+        }
     }
 
     return true;
 }
 
 
-bool SaveData::sendRequest(unsigned baseAddr, unsigned & progress)
+bool SaveData::sendRequest(unsigned baseAddr, unsigned &progress,
+    const std::vector<bool> &erasedPages, std::deque<unsigned> &pendingReads)
 {
     /*
      * Request another chunk of data, maintaining progress within
-     * the current block.
+     * the current block. Erased pages are skipped, and a read never
+     * runs on into an erased page.
      */
 
     unsigned offset = progress;
+    while (offset < BLOCK_SIZE && erasedPages[offset / PAGE_SIZE]) {
+        offset = (offset / PAGE_SIZE + 1) * PAGE_SIZE;
+    }
+
     if (offset >= BLOCK_SIZE) {
+        progress = BLOCK_SIZE;
         return false;
     }
 
+    unsigned length = std::min(BLOCK_SIZE - offset,
+        USBProtocolMsg::MAX_LEN - USBProtocolMsg::HEADER_BYTES);
+    unsigned nextPage = (offset / PAGE_SIZE + 1) * PAGE_SIZE;
+    if (offset + length > nextPage && erasedPages[nextPage / PAGE_SIZE]) {
+        length = nextPage - offset;
+    }
+
     USBProtocolMsg m(USBProtocol::Installer);
     m.header |= UsbVolumeManager::FlashDeviceRead;
     UsbVolumeManager::FlashDeviceReadRequest *req =
         m.zeroCopyAppend<UsbVolumeManager::FlashDeviceReadRequest>();
 
     req->address = baseAddr + offset;
-    req->length = std::min(BLOCK_SIZE - offset,
-        USBProtocolMsg::MAX_LEN - USBProtocolMsg::HEADER_BYTES);
+    req->length = length;
 
-    progress = offset + req->length;
+    progress = offset + length;
+    pendingReads.push_back(offset);
 
     dev.writePacket(m.bytes, m.len);
 
@@ -641,27 +812,6 @@ bool SaveData::sendRequest(unsigned baseAddr, unsigned & progress)
 }
 
 
-bool SaveData::writeReply(FILE *f, unsigned & progress)
-{
-    /*
-     * Read the pending reply from the device and write it out to our file.
-     */
-
-    USBProtocolMsg m(USBProtocol::Installer);
-    BaseDevice base(dev);
-
-    uint32_t header = m.header | UsbVolumeManager::FlashDeviceRead;
-    if (!base.waitForReply(header, m)) {
-        return false;
-    }
-
-    unsigned len = m.payloadLen();
-    progress += len;
-
-    return fwrite(m.castPayload<uint8_t>(), len, 1, f) == 1;
-}
-
-
 bool SaveData::writeStr(const std::string &s, FILE *f)
 {
     uint32_t length = s.length();
@@ -676,37 +826,29 @@ bool SaveData::writeStr(const std::string &s, FILE *f)
 }
 
 
-bool SaveData::readStr(std::string &s, FILE *f)
+bool SaveData::readStr(std::string &s, const MappedFile &file, unsigned &offset)
 {
     /*
      * strings are preceded by their uint32_t length.
-     * a little stupid to allocate and free the intermediate buffer, but
-     * handy to be able to return a std::string.
      */
 
-    uint32_t length;
-
-    if (fread(&length, sizeof length, 1, f) != 1) {
+    const uint32_t *length = file.getObject<uint32_t>(offset);
+    if (!length) {
         return false;
     }
 
-    char *buf = (char*)malloc(length);
-    if (!buf) {
+    const uint8_t *bytes = file.getBytes(offset + sizeof *length, *length);
+    if (!bytes) {
         return false;
     }
 
-    if (fread(buf, length, 1, f) != 1) {
-        return false;
-    }
-
-    s.assign(buf, length);
+    s.assign(reinterpret_cast<const char*>(bytes), *length);
+    offset += sizeof *length + *length;
 
     // trim any junk on the end
-    while (s.at(s.length() - 1) == '\0') {
+    while (!s.empty() && s[s.length() - 1] == '\0') {
         s.erase(s.length() - 1);
     }
 
-    free(buf);
-
     return true;
 }
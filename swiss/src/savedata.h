@@ -28,10 +28,14 @@
 
 #include "iodevice.h"
 #include "usbvolumemanager.h"
+#include "mappedfile.h"
 
 #include <string>
 #include <map>
 #include <vector>
+#include <deque>
+
+class ScopedProgressBar;
 
 class SaveData
 {
@@ -57,15 +61,18 @@ public:
     /*
      * We capture all records for a given key, and make sure they're
      * ordered chronologically.
+     *
+     * Payloads point into the mapped savedata file they came from,
+     * and are only valid while it stays mapped.
      */
 
     struct Record {
         unsigned key;
         unsigned crc;
         unsigned size;
-        std::vector<uint8_t> payload;
+        const uint8_t *payload;
 
-        Record(unsigned k, unsigned c, unsigned s, const std::vector<uint8_t> &p) :
+        Record(unsigned k, unsigned c, unsigned s, const uint8_t *p) :
             key(k),
             crc(c),
             size(s),
@@ -80,6 +87,7 @@ public:
     static int run(int argc, char **argv, IODevice &_dev);
 
     int extract(const char *pkgStr, const char *filepath, bool raw, bool rpc);
+    int extractAll(const char *dirpath, bool rpc);
     int restore(const char *filepath);
     int normalize(const char *inpath, const char *outpath);
     int del(const char *pkgStr);
@@ -87,6 +95,10 @@ public:
 private:
     static const unsigned PAGE_SIZE = 256;
     static const unsigned BLOCK_SIZE = 128 * 1024;
+    static const unsigned ERASE_BLOCK_SIZE = 64 * 1024;
+
+    // Reads kept in flight while pulling a volume off the base
+    static const unsigned NUM_PENDING_REQUESTS = 16;
     static const uint64_t MAGIC = 0x4556415374666953LLU;
     static const uint64_t NORMALIZED_MAGIC = 0x4C4D524E74666953LLU;
 
@@ -124,20 +136,24 @@ private:
     bool writeFileHeader(FILE *f, unsigned volBlockCode, unsigned numVolumes);
 
     bool writeVolumes(UsbVolumeManager::LFSDetailReply *reply, FILE *f, bool rpc=false);
-    bool sendRequest(unsigned baseAddr, unsigned &progress);
-    bool writeReply(FILE *f, unsigned &progress);
+    bool readVolume(unsigned baseAddr, uint8_t *buffer, ScopedProgressBar &pb,
+        unsigned overallProgress, unsigned progTotal, bool rpc);
+    bool sendRequest(unsigned baseAddr, unsigned &progress,
+        const std::vector<bool> &erasedPages, std::deque<unsigned> &pendingReads);
 
-    bool getValidFileVersion(FILE *f, int &version);
-    bool readHeader(int version, HeaderCommon &h, FILE *f);
-    bool retrieveRecords(Records &records, const HeaderCommon &details, FILE *f);
+    bool getValidFileVersion(const MappedFile &file, int &version);
+    bool readHeader(int version, HeaderCommon &h, const MappedFile &file, unsigned &offset);
+    bool retrieveRecords(Records &records, const HeaderCommon &details, const MappedFile &file, unsigned offset);
 
     bool restoreRecords(unsigned vol, const Records &records);
     bool restoreItem(unsigned parentVol, const Record &record);
+    bool readRestoreReply();
 
     static bool writeStr(const std::string &s, FILE *f);
-    static bool readStr(std::string &s, FILE *f);
+    static bool readStr(std::string &s, const MappedFile &file, unsigned &offset);
 
-    static void writeNormalizedItem(std::stringstream & ss, uint8_t key, uint32_t len, const void *data);
+    static bool writeNormalizedItem(FILE *f, uint8_t key, uint32_t len, const void *data);
+    static uint32_t normalizedItemSize(uint32_t len);
     bool writeNormalizedRecords(Records &records, const HeaderCommon &details, FILE *f);
 
     IODevice &dev;
@@ -26,6 +26,7 @@
 #include "usbdevice.h"
 #include "libusb.h"
 #include <assert.h>
+#include <algorithm>
 
 #if 0
 #define USB_TRACE(_x)   printf _x
@@ -34,7 +35,10 @@
 #endif
 
 
-UsbDevice::UsbDevice() :
+UsbDevice::UsbDevice(libusb_context *ctx) :
+    mOutPacketsInFlight(0),
+    mContext(ctx),
+    mDeviceIndex(0),
     mInterface(-1),
     mHandle(0)
 {
@@ -44,14 +48,15 @@ bool UsbDevice::open(uint16_t vendorId, uint16_t productId, uint8_t interface)
 {
     /*
      * Iterate all connected devices, and open the first device we see that
-     * matches the given vid/pid.
+     * matches the given vid/pid, after skipping mDeviceIndex of them.
      */
 
     USB_TRACE(("USB: Starting open()\n"));
 
     bool foundAnyDevice = false;
+    unsigned matchIndex = 0;
     libusb_device **devs;
-    int deviceCount = libusb_get_device_list(NULL, &devs);
+    int deviceCount = libusb_get_device_list(mContext, &devs);
     if (deviceCount < 0)
         return false;
 
@@ -67,6 +72,8 @@ bool UsbDevice::open(uint16_t vendorId, uint16_t productId, uint8_t interface)
 
         if (desc.idVendor != vendorId || desc.idProduct != productId)
             continue;
+        if (matchIndex++ != mDeviceIndex)
+            continue;
         foundAnyDevice = true;
 
         USB_TRACE(("USB: Starting libusb_open()\n"));
@@ -127,6 +134,26 @@ bool UsbDevice::open(uint16_t vendorId, uint16_t productId, uint8_t interface)
     return true;
 }
 
+unsigned UsbDevice::numAttached(uint16_t vendorId, uint16_t productId)
+{
+    libusb_device **devs;
+    int deviceCount = libusb_get_device_list(NULL, &devs);
+    if (deviceCount < 0)
+        return 0;
+
+    unsigned count = 0;
+    for (int i = 0; i < deviceCount; ++i) {
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(devs[i], &desc) < 0)
+            continue;
+        if (desc.idVendor == vendorId && desc.idProduct == productId)
+            count++;
+    }
+
+    libusb_free_device_list(devs, 1);
+    return count;
+}
+
 /*
  * Verify this device looks like what we expect,
  * and retrieve its endpoint details.
@@ -205,6 +232,8 @@ void UsbDevice::close()
 
     releaseTransfers(mInEndpoint);
     releaseTransfers(mOutEndpoint);
+    mOutBuffer.clear();
+    mOutPacketsInFlight = 0;
 }
 
 void UsbDevice::releaseTransfers(Endpoint &ep)
@@ -252,29 +281,64 @@ int UsbDevice::readPacketSync(uint8_t *buf, int maxlen, int *transferred, unsign
 
 int UsbDevice::writePacket(const uint8_t *buf, unsigned len)
 {
+    /*
+     * Queue a packet to be sent. Full-size packets may wait here, to be
+     * sent along with the packets after them, until the next short
+     * packet, a full transfer's worth, or processEvents().
+     */
+
     USB_TRACE(("USB: Write %d bytes, %02x%02x%02x%02x %02x%02x%02x%02x ...\n",
         len, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]));
 
+    unsigned size = len < mOutEndpoint.maxPacketSize ? len : mOutEndpoint.maxPacketSize;
+    mOutBuffer.insert(mOutBuffer.end(), buf, buf + size);
+
+    if (size < mOutEndpoint.maxPacketSize ||
+        mOutBuffer.size() >= MAX_PACKETS_PER_OUT_TRANSFER * mOutEndpoint.maxPacketSize) {
+        int r = flushOUTPackets();
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    return size;
+}
+
+int UsbDevice::flushOUTPackets()
+{
+    /*
+     * Submit any buffered OUT packets as a single transfer.
+     */
+
+    if (mOutBuffer.empty()) {
+        return 0;
+    }
+
     libusb_transfer *txfer = libusb_alloc_transfer(0);
     if (!txfer) {
         return -1;
     }
 
-    int size = len < mOutEndpoint.maxPacketSize ? len : mOutEndpoint.maxPacketSize;
+    unsigned size = mOutBuffer.size();
     unsigned char *transferBuf = (unsigned char*)malloc(size);
     if (!transferBuf) {
+        libusb_free_transfer(txfer);
         return -1;
     }
-    memcpy(transferBuf, buf, size);
+    memcpy(transferBuf, &mOutBuffer[0], size);
+    mOutBuffer.clear();
 
     libusb_fill_bulk_transfer(txfer, mHandle, mOutEndpoint.address, transferBuf, size, onTxComplete, this, 0);
 
     int r = libusb_submit_transfer(txfer);
     if (r < 0) {
+        free(transferBuf);
+        libusb_free_transfer(txfer);
         return r;
     }
 
     mOutEndpoint.pendingTransfers.push_back(txfer);
+    mOutPacketsInFlight += (size + mOutEndpoint.maxPacketSize - 1) / mOutEndpoint.maxPacketSize;
     return size;
 }
 
@@ -283,6 +347,12 @@ int UsbDevice::writePacketSync(const uint8_t *buf, int maxlen, int *transferred,
     USB_TRACE(("USB: Sync write %d bytes, %02x%02x%02x%02x %02x%02x%02x%02x ...\n",
         maxlen, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]));
 
+    // Anything we've buffered has to go first
+    int r = flushOUTPackets();
+    if (r < 0) {
+        return r;
+    }
+
     return libusb_bulk_transfer(mHandle, mOutEndpoint.address, (unsigned char*)buf, maxlen, transferred, timeout);
 }
 
@@ -310,6 +380,9 @@ void UsbDevice::handleTx(libusb_transfer *t)
 {
     USB_TRACE(("USB: TX status %d\n", t->status));
 
+    unsigned packets = (t->length + mOutEndpoint.maxPacketSize - 1) / mOutEndpoint.maxPacketSize;
+    mOutPacketsInFlight -= std::min(packets, mOutPacketsInFlight);
+
     removeTransfer(mOutEndpoint, t);
 
 #if 0
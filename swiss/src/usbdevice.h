@@ -30,6 +30,7 @@
 #include "iodevice.h"
 
 #include <list>
+#include <vector>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,7 +46,7 @@ namespace Usb {
         libusb_exit(NULL);
     }
 
-    static void setDebug(unsigned level) {
+    static void setDebug(unsigned level, libusb_context *ctx = NULL) {
 
         // older versions of libusb.h don't define LIBUSB_LOG_LEVEL_DEBUG
         // so do it here to work around
@@ -53,7 +54,7 @@ namespace Usb {
         if (level > LOG_LEVEL_DEBUG) {
             level = LOG_LEVEL_DEBUG;
         }
-        libusb_set_debug(NULL, level);
+        libusb_set_debug(ctx, level);
     }
 
 } // namespace Usb
@@ -61,16 +62,30 @@ namespace Usb {
 
 class UsbDevice : public IODevice {
 public:
-    UsbDevice();
+    UsbDevice(libusb_context *ctx = NULL);
 
     int processEvents(unsigned timeoutMillis = 0) {
+        int r = flushOUTPackets();
+        if (r < 0)
+            return r;
+
         struct timeval tv = {
             0,                      // tv_sec
             timeoutMillis * 1000    // tv_usec
         };
-        return libusb_handle_events_timeout_completed(0, &tv, 0);
+        return libusb_handle_events_timeout_completed(mContext, &tv, 0);
+    }
+
+    /*
+     * With more than one base attached, open() picks the Nth matching
+     * device in enumeration order. Defaults to the first.
+     */
+    void selectDevice(unsigned index) {
+        mDeviceIndex = index;
     }
 
+    static unsigned numAttached(uint16_t vendorId, uint16_t productId);
+
     bool open(uint16_t vendorId, uint16_t productId, uint8_t interface = 0);
     void close();
     bool isOpen() const;
@@ -90,16 +105,19 @@ public:
     int readPacketSync(uint8_t *buf, int maxlen, int *transferred, unsigned timeout = -1);
 
     unsigned numPendingOUTPackets() const {
-        return mOutEndpoint.pendingTransfers.size();
+        unsigned buffered = mOutBuffer.empty() ? 0 : mOutBuffer.size() / mOutEndpoint.maxPacketSize;
+        return mOutPacketsInFlight + buffered;
     }
     int writePacket(const uint8_t *buf, unsigned len);
     int writePacketSync(const uint8_t *buf, int maxlen, int *transferred, unsigned timeout = -1);
 
 private:
     static const unsigned NUM_CONCURRENT_IN_TRANSFERS = 16;
+    static const unsigned MAX_PACKETS_PER_OUT_TRANSFER = 16;
 
     bool populateDeviceInfo(libusb_config_descriptor *cfg);
     bool submitINTransfer();
+    int flushOUTPackets();
 
     static void LIBUSB_CALL onRxComplete(libusb_transfer *);
     static void LIBUSB_CALL onTxComplete(libusb_transfer *);
@@ -116,9 +134,19 @@ private:
     Endpoint mInEndpoint;
     Endpoint mOutEndpoint;
 
+    /*
+     * Full-size OUT packets are coalesced into multi-packet transfers,
+     * which the device still sees as individual packets. A short packet
+     * ends a transfer, so it's always sent right away.
+     */
+    std::vector<uint8_t> mOutBuffer;
+    unsigned mOutPacketsInFlight;
+
     void removeTransfer(Endpoint &ep, libusb_transfer *t);
     void releaseTransfers(Endpoint &ep);
 
+    libusb_context *mContext;
+    unsigned mDeviceIndex;
     int mInterface;
     libusb_device_handle *mHandle;
 
@@ -70,4 +70,30 @@ const char *filepathBase(const char *path)
     return p + 1;
 }
 
+uint32_t crc32(const uint8_t *bytes, unsigned count)
+{
+    /*
+     * Software version of the base's hardware CRC (see Crc32 in the
+     * firmware): CRC-32 over little-endian 32-bit words, fed in most
+     * significant bit first, with no final XOR. A partial last word is
+     * padded with 0xFF, like erased flash.
+     */
+
+    uint32_t crc = 0xffffffff;
+
+    for (unsigned i = 0; i < count; i += 4) {
+        uint32_t word = 0;
+        for (unsigned j = 0; j < 4; ++j) {
+            uint32_t b = i + j < count ? bytes[i + j] : 0xFF;
+            word |= b << (8 * j);
+        }
+
+        crc ^= word;
+        for (unsigned bit = 0; bit < 32; ++bit)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+    }
+
+    return crc;
+}
+
 } // namespace Util
@@ -26,12 +26,16 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <stdint.h>
+
 namespace Util {
 
 bool parseVolumeCode(const char *str, unsigned &code);
 
 const char *filepathBase(const char *path);
 
+uint32_t crc32(const uint8_t *bytes, unsigned count);
+
 } // namespace Util
 
 #endif // UTIL_H
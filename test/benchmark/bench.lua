@@ -0,0 +1,46 @@
+--[[
+    Benchmark driver for Siftulator, run by runbench.py as:
+
+        siftulator --headless -T -n CUBES -e bench.lua -l GAME.elf
+
+    Runs the game for BENCH_WARMUP virtual seconds, then measures it for
+    BENCH_SECONDS more, and prints one "BENCH" line of key=value counter
+    deltas for the runner to parse.
+]]--
+
+sys = System()
+
+local warmup = tonumber(os.getenv("BENCH_WARMUP") or "2")
+local seconds = tonumber(os.getenv("BENCH_SECONDS") or "10")
+
+sys:init()
+sys:start()
+sys:vsleep(warmup)
+
+local function snapshot()
+    local s = { vclock = sys:vclock(), counters = sys:counters(), frames = {} }
+    for i = 0, sys:numCubes() - 1 do
+        s.frames[i] = Cube(i):lcdFrameCount()
+    end
+    return s
+end
+
+local first = snapshot()
+sys:vsleep(seconds)
+local last = snapshot()
+
+local fields = {
+    string.format("vseconds=%.6f", last.vclock - first.vclock),
+    string.format("cubes=%d", sys:numCubes()),
+}
+
+for key, value in pairs(last.counters) do
+    table.insert(fields, string.format("%s=%.0f", key, value - first.counters[key]))
+end
+
+for i = 0, sys:numCubes() - 1 do
+    -- The frame counter is 32 bits, and can wrap between snapshots
+    table.insert(fields, string.format("frames%d=%d", i, (last.frames[i] - first.frames[i]) % 4294967296))
+end
+
+print("BENCH " .. table.concat(fields, " "))
@@ -0,0 +1,54 @@
+/*
+ * Synthetic benchmark workload: every frame, redraw the whole BG0_ROM
+ * screen on every cube and run a fixed chunk of arithmetic. This keeps
+ * the radio and the SVM interpreter as busy as they'll go, with no
+ * assets to install first.
+ */
+
+#include <sifteo.h>
+using namespace Sifteo;
+
+static const unsigned NUM_CUBES = 3;
+static const unsigned CPU_ITERATIONS = 2000;
+
+static Metadata M = Metadata()
+    .title("Paint storm benchmark")
+    .cubeRange(NUM_CUBES);
+
+static VideoBuffer vid[NUM_CUBES];
+
+static uint32_t cpuWork(uint32_t seed)
+{
+    // Multiply, shift and branch, like a typical game's inner loops
+    uint32_t x = seed;
+    for (unsigned i = 0; i < CPU_ITERATIONS; ++i) {
+        x = x * 1103515245 + 12345;
+        if (x & 0x10000)
+            x ^= x >> 7;
+    }
+    return x;
+}
+
+void main()
+{
+    for (unsigned i = 0; i < NUM_CUBES; ++i) {
+        vid[i].initMode(BG0_ROM);
+        vid[i].attach(i);
+    }
+
+    uint32_t seed = 1;
+    for (unsigned frame = 0;; ++frame) {
+        for (unsigned i = 0; i < NUM_CUBES; ++i) {
+            char line[17];
+            for (unsigned y = 0; y < 16; ++y) {
+                for (unsigned x = 0; x < 16; ++x)
+                    line[x] = ' ' + (x + y + frame + i) % 95;
+                line[16] = 0;
+                vid[i].bg0rom.text(vec(0U, y), line);
+            }
+        }
+
+        seed = cpuWork(seed);
+        System::paint();
+    }
+}
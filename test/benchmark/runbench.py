@@ -0,0 +1,175 @@
+#!/usr/bin/env python
+#
+# End-to-end performance benchmarks for the firmware, SDK and emulator.
+#
+# Builds a few SDK examples plus synthetic workloads, runs each one headless
+# in Siftulator for a fixed amount of virtual time, and reports frames per
+# cube, radio packets, SVM instructions per second, block cache hit rate,
+# audio underruns and host wall time. Results are written as JSON, so runs
+# from different trees can be compared by script.
+#
+# Benchmarks run one at a time, since wall time is one of the results.
+#
+# Copyright (c) 2012 Sifteo, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+from __future__ import print_function
+
+import json
+import optparse
+import os
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+TC_DIR = os.path.abspath(os.path.join(BENCH_DIR, '..', '..'))
+SDK_DIR = os.path.join(TC_DIR, 'sdk')
+MAKE = os.environ.get('MAKE', 'make')
+
+# (name, directory, number of cubes)
+BENCHMARKS = [
+    ('mandelbrot',  os.path.join(SDK_DIR, 'examples', 'mandelbrot'), 1),
+    ('membrane',    os.path.join(SDK_DIR, 'examples', 'membrane'), 3),
+    ('stars',       os.path.join(SDK_DIR, 'examples', 'stars'), 2),
+    ('synth',       os.path.join(SDK_DIR, 'examples', 'synth'), 1),
+    ('paintstorm',  os.path.join(BENCH_DIR, 'paintstorm'), 3),
+]
+
+
+def toolEnv():
+    env = dict(os.environ)
+    env['PATH'] = os.pathsep.join([os.path.join(SDK_DIR, 'bin'), env.get('PATH', '')])
+    env['TC_DIR'] = TC_DIR
+    env['SDK_DIR'] = SDK_DIR
+    return env
+
+
+def build(directory):
+    subprocess.check_call([MAKE, '-C', directory], env=toolEnv())
+
+
+def parseBenchLine(output):
+    for line in output.splitlines():
+        if line.startswith('BENCH '):
+            return dict(field.split('=', 1) for field in line.split()[1:])
+    return None
+
+
+def runOne(name, directory, cubes, opts):
+    elf = os.path.join(directory, name + '.elf')
+    env = toolEnv()
+    env['BENCH_SECONDS'] = str(opts.seconds)
+    env['BENCH_WARMUP'] = str(opts.warmup)
+
+    cmd = [opts.siftulator, '--headless', '-T', '-n', str(cubes),
+           '-e', os.path.join(BENCH_DIR, 'bench.lua'), '-l', elf]
+
+    start = time.time()
+    p = subprocess.Popen(cmd, env=env, cwd=directory,
+                         stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = p.communicate()[0].decode('utf-8', 'replace')
+    wall = time.time() - start
+
+    fields = parseBenchLine(output)
+    if p.returncode != 0 or fields is None:
+        print(output, file=sys.stderr)
+        raise RuntimeError('benchmark %s failed (exit status %d)' % (name, p.returncode))
+
+    vseconds = float(fields['vseconds'])
+    numCubes = int(fields['cubes'])
+    frames = [int(fields['frames%d' % i]) for i in range(numCubes)]
+    accesses = int(fields['cacheAccesses'])
+    misses = int(fields['cacheMisses'])
+
+    return {
+        'name': name,
+        'cubes': numCubes,
+        'virtualSeconds': vseconds,
+        'wallSeconds': wall,
+        'framesPerCube': frames,
+        'fpsPerCube': [f / vseconds for f in frames],
+        'radioPackets': int(fields['radioAcks']),
+        'svmInstructions': int(fields['svmInstructions']),
+        'svmInstructionsPerSec': int(fields['svmInstructions']) / vseconds,
+        'cacheAccesses': accesses,
+        'cacheMisses': misses,
+        'cacheHitRate': accesses and float(accesses - misses) / accesses or None,
+        'audioUnderruns': int(fields['audioUnderruns']),
+    }
+
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] [BENCHMARK ...]')
+    parser.add_option('-o', '--output', metavar='FILE',
+                      help='write JSON results to FILE instead of stdout')
+    parser.add_option('-s', '--seconds', type='float', default=10.0,
+                      help='virtual seconds to measure each benchmark for (default: 10)')
+    parser.add_option('-w', '--warmup', type='float', default=2.0,
+                      help='virtual seconds to run before measuring (default: 2)')
+    parser.add_option('--siftulator', default='siftulator',
+                      help='Siftulator binary to benchmark')
+    parser.add_option('--no-build', action='store_true',
+                      help="don't rebuild the benchmark games first")
+    parser.add_option('-l', '--list', action='store_true',
+                      help='list the available benchmarks, and exit')
+    opts, args = parser.parse_args()
+
+    if opts.list:
+        for name, directory, cubes in BENCHMARKS:
+            print(name)
+        return 0
+
+    selected = [b for b in BENCHMARKS if not args or b[0] in args]
+    unknown = set(args) - set(b[0] for b in BENCHMARKS)
+    if unknown:
+        parser.error('unknown benchmark(s): %s' % ', '.join(sorted(unknown)))
+
+    results = []
+    for name, directory, cubes in selected:
+        if not opts.no_build:
+            build(directory)
+        result = runOne(name, directory, cubes, opts)
+        print('%-12s %8.1f fps %12.0f inst/s %6s hit %4d underruns %7.1fs wall' % (
+            name, sum(result['fpsPerCube']) / result['cubes'],
+            result['svmInstructionsPerSec'],
+            result['cacheHitRate'] is None and '-' or '%.1f%%' % (100 * result['cacheHitRate']),
+            result['audioUnderruns'], result['wallSeconds']), file=sys.stderr)
+        results.append(result)
+
+    report = json.dumps({
+        'virtualSeconds': opts.seconds,
+        'warmupSeconds': opts.warmup,
+        'benchmarks': results,
+    }, indent=2, sort_keys=True)
+
+    if opts.output:
+        f = open(opts.output, 'w')
+        f.write(report + '\n')
+        f.close()
+    else:
+        print(report)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
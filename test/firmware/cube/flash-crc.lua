@@ -57,9 +57,13 @@ function flashCRC(cube, addr, numBlocks)
         local crc = 0xFF
         addr = bit.band(addr, 0xFFFFFF80)
 
+        -- Each block only samples from the 16 tiles that follow it
+        local base = addr
+        local data = cube:fRead(base, 16 * 0x80)
+
         for tile = 1, 16 do
             for sample = 1, 4 do
-                crc = bit.bxor(gf84[1 + crc], cube:fbPeek(addr))
+                crc = bit.bxor(gf84[1 + crc], data:byte(1 + addr - base))
                 addr = bit.bor(bit.band(addr, 0xFFFFFF80), bit.rshift(crc, 1))
             end
 
@@ -64,6 +64,7 @@ VM_BG0_BG1         = 0x1c    -- BG0, plus overlay BG1: 16x16 bitmap + 144 indice
 VM_BG0_SPR_BG1     = 0x20    -- BG0, multiple linear sprites, then BG1
 VM_BG2             = 0x24    -- Background BG2: 16x16 grid with affine transform
 VM_STAMP           = 0x28    -- Reconfigurable 16-color framebuffer with transparency
+VM_BG0_PATCH       = 0x2c    -- BG0, plus a small direct-color patch
 
 -- Important VRAM addresses
 
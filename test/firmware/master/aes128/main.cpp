@@ -132,42 +132,56 @@ unsigned decrypt(uint8_t *plainbuf, const uint8_t *cipherbuf, unsigned cipherlen
     const uint32_t key[4] = AES_TEST_KEY;
     AES128::expandKey(expkey, key);
 
-    // cipherBuf holds the cipher in progress - starts with initialization vector
-    uint8_t cipher[AES128::BLOCK_SIZE] = AES_TEST_IV;
-    uint8_t *plainstart = plainbuf;
-
-    while (cipherlen > AES128::BLOCK_SIZE) {
-        AES128::encryptBlock(plainbuf, cipher, expkey);
-
-        memcpy(cipher, cipherbuf, AES128::BLOCK_SIZE);
-        cipherbuf += AES128::BLOCK_SIZE;
-        cipherlen -= AES128::BLOCK_SIZE;
-
-        AES128::xorBlock(plainbuf, cipher);
-        plainbuf += AES128::BLOCK_SIZE;
-    }
+    // feedback register - starts with initialization vector
+    uint8_t iv[AES128::BLOCK_SIZE] = AES_TEST_IV;
 
     // assume the ciphertext was padded, so should always be block aligned
-    ASSERT(cipherlen == AES128::BLOCK_SIZE && "bad pad size");
+    ASSERT(cipherlen >= AES128::BLOCK_SIZE && "bad pad size");
+    ASSERT((cipherlen % AES128::BLOCK_SIZE) == 0 && "bad pad size");
 
-    // output of the last cipher is run through the encryption block
-    AES128::encryptBlock(plainbuf, cipher, expkey);
-    memcpy(cipher, cipherbuf, AES128::BLOCK_SIZE);
-    // XXX: slightly bogus to expect there to be a full block available at plainbuf
-    // to write into here, but would require an additional copy otherwise
-    AES128::xorBlock(plainbuf, cipher);
+    // everything up to the final block, in one batch
+    unsigned numBlocks = cipherlen / AES128::BLOCK_SIZE - 1;
+    AES128::cfbDecrypt(plainbuf, cipherbuf, numBlocks, iv, expkey);
+    plainbuf += numBlocks * AES128::BLOCK_SIZE;
+    cipherbuf += numBlocks * AES128::BLOCK_SIZE;
+
+    // final block, decrypted in place after the feedback carried over
+    uint8_t finalBlock[AES128::BLOCK_SIZE];
+    memcpy(finalBlock, cipherbuf, AES128::BLOCK_SIZE);
+    AES128::cfbDecrypt(finalBlock, finalBlock, 1, iv, expkey);
 
     // look for pad value at the end of the last block
-    uint8_t padvalue = plainbuf[15];
+    uint8_t padvalue = finalBlock[15];
     ASSERT(padvalue <= AES128::BLOCK_SIZE);
 
     unsigned lastBlockPlainSize = AES128::BLOCK_SIZE - padvalue;
     // verify that all the padded bytes are the pad value (PKCS)
-    uint8_t *p = plainbuf + lastBlockPlainSize;
+    uint8_t *p = finalBlock + lastBlockPlainSize;
     for (unsigned i = 0; i < padvalue; ++i)
         ASSERT(p[i] == padvalue);
 
-    return plainbuf - plainstart + lastBlockPlainSize;
+    memcpy(plainbuf, finalBlock, lastBlockPlainSize);
+    return numBlocks * AES128::BLOCK_SIZE + lastBlockPlainSize;
+}
+
+static void knownAnswer()
+{
+    /*
+     * Encryption of the test IV under the test key, as produced by the
+     * original Sbox-only implementation. Guards the table-driven rounds.
+     */
+    static const uint8_t expected[AES128::BLOCK_SIZE] = {
+        0x07, 0xdc, 0x7e, 0x91, 0xd5, 0xb8, 0xa5, 0x5e,
+        0x4a, 0x6d, 0xa0, 0xc2, 0x75, 0x81, 0x08, 0x98
+    };
+
+    uint32_t expkey[44];
+    const uint32_t key[4] = AES_TEST_KEY;
+    AES128::expandKey(expkey, key);
+
+    uint8_t block[AES128::BLOCK_SIZE] = AES_TEST_IV;
+    AES128::encryptBlock(block, block, expkey);
+    ASSERT(memcmp(block, expected, sizeof expected) == 0);
 }
 
 static void roundtrip()
@@ -177,7 +191,7 @@ static void roundtrip()
     unsigned cipherlen = encrypt(cipherbuf, testdata, sizeof testdata);
     ASSERT(cipherlen >= sizeof testdata);
     
-    uint8_t decryptbuf[sizeof cipherbuf];
+    uint8_t decryptbuf[sizeof testdata];
     unsigned decryptlen = decrypt(decryptbuf, cipherbuf, cipherlen);
 
     ASSERT(decryptlen == sizeof testdata);
@@ -186,6 +200,7 @@ static void roundtrip()
 
 int main()
 {
+    knownAnswer();
     roundtrip();
     
     LOG(("aes128: Success.\n"));
@@ -0,0 +1,814 @@
+/*
+ * CubeCodec compression benchmark.
+ *
+ * Replays sequences of _SYSVideoBuffer updates through CubeCodec::encodeVRAM
+ * exactly the way CubeSlot::radioProduce() does, one radio packet at a time,
+ * and reports what each sequence cost on the air: payload bytes, packets per
+ * frame, and encoder time. Every packet is also run through a host model of
+ * the cube's radio ISR decoder, and the decoded VRAM must match the buffer
+ * after every frame.
+ *
+ * Usage: codecbench [-w] [-b baseline] [corpus files...]
+ *
+ * With no corpus files, a built-in set of synthetic scenes is replayed. These
+ * are modelled on the VRAM traffic of the SDK demos: full BG0 redraws,
+ * tile-column scrolling, text consoles, sprites, BG1 overlays, framebuffer
+ * painting, immediate-mode redraws, and incompressible noise.
+ *
+ * Each scene is encoded four ways: greedy, with CubeCodec::lookahead, with
+ * lookahead plus a _SYSVideoShadow of the cube's VRAM, and with lookahead
+ * plus a _SYSVideoChangeLog on the buffer. The resulting byte counts are compared against the baseline file (default
+ * "baseline.txt"), and any scene that grew fails the run. Use -w to rewrite
+ * the baseline after an intentional change.
+ *
+ * Corpus syntax, one operation per line. '#' starts a comment.
+ *
+ *   frame                      End of a frame; flush it over the radio
+ *   poke <addr> <word>         Write a 16-bit word at a word address
+ *   pokeb <addr> <byte>        Write a byte at a byte address
+ *   fill <addr> <count> <word> Write one word repeatedly
+ *
+ * Numbers may be decimal or 0x-prefixed hex.
+ */
+
+#include "cubecodec.h"
+#include "vram.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+static const char *defaultBaseline = "baseline.txt";
+
+
+/***********************************************************************
+ * Timing
+ */
+
+static inline uint64_t cycles()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (uint64_t(hi) << 32) | lo;
+#else
+    // No cycle counter; clock() ticks are the best we can do.
+    return clock();
+#endif
+}
+
+
+/***********************************************************************
+ * Cube-side decoder
+ */
+
+/**
+ * Host model of the nybble-stream decoder in the cube's radio ISR
+ * (firmware/cube/src/radio_isr.c). It keeps the same registers and
+ * states as the 8051 code, including state which carries across full
+ * packets, so any encoder output the cube would misinterpret shows up
+ * here as a VRAM mismatch.
+ */
+class CubeDecoder {
+public:
+    uint8_t vram[_SYS_VRAM_BYTES];
+
+    CubeDecoder() : resetPending(true), sample(0), diff(RF_VRAM_DIFF_BASE) {
+        memset(vram, 0, sizeof vram);
+    }
+
+    void packet(const PacketBuffer &buf);
+
+private:
+    enum State {
+        S_DEFAULT,
+        S_RLE,
+        S_DIFF,
+        S_LITERAL_0,
+        S_LITERAL_1,
+        S_LITERAL_2,
+        S_WRDELTA,
+        S_WORD9_0,
+        S_WORD9_1,
+        S_WORD16_0,
+        S_WORD16_1,
+        S_WORD16_2,
+        S_WORD16_3,
+    };
+
+    bool resetPending;
+    State state;
+    unsigned ptr;       // VRAM byte address
+    uint8_t sample;
+    uint8_t diff;
+    uint8_t low;
+    uint8_t high;
+
+    void writeDeltas(unsigned count);
+    void writeWord(uint8_t l, uint8_t h);
+    bool nybble(uint8_t n);
+};
+
+void CubeDecoder::packet(const PacketBuffer &buf)
+{
+    // Packets shorter than the maximum reset the state machine after they end
+    if (resetPending) {
+        state = S_DEFAULT;
+        ptr = 0;
+    }
+    resetPending = buf.len != PacketBuffer::MAX_LEN;
+
+    // Escape codes end the packet early, by returning false
+    for (unsigned i = 0; i < buf.len; ++i) {
+        if (!nybble(buf.bytes[i] & 0xF) || !nybble(buf.bytes[i] >> 4))
+            break;
+    }
+}
+
+void CubeDecoder::writeWord(uint8_t l, uint8_t h)
+{
+    vram[ptr] = l;
+    vram[ptr + 1] = h;
+    ptr = (ptr + 2) & _SYS_VRAM_BYTE_MASK;
+}
+
+void CubeDecoder::writeDeltas(unsigned count)
+{
+    static const unsigned offsets[] = {
+        RF_VRAM_SAMPLE_0, RF_VRAM_SAMPLE_1, RF_VRAM_SAMPLE_2, RF_VRAM_SAMPLE_3
+    };
+
+    unsigned src = (ptr - offsets[sample & 3] * 2) & _SYS_VRAM_BYTE_MASK;
+    uint8_t delta = ((diff & 0xF) - 7) << 1;
+
+    while (count--) {
+        // Same carry rules as the 8051 loop: the low byte's carry (or
+        // borrow) moves into bit 1 of the high byte.
+
+        unsigned l = vram[src] + delta;
+        uint8_t h = vram[src + 1];
+        if (delta & 0x80) {
+            if (!(l & 0x100))
+                h += 0xFE;
+        } else if (l & 0x100) {
+            h += 2;
+        }
+
+        src = (src + 2) & _SYS_VRAM_BYTE_MASK;
+        writeWord(l, h);
+    }
+}
+
+bool CubeDecoder::nybble(uint8_t n)
+{
+    switch (state) {
+
+    case S_DEFAULT:
+        switch (n & 0xC) {
+        case 0x0:
+            low = n;
+            state = S_RLE;
+            return true;
+        case 0x4:
+            sample = n;
+            diff = RF_VRAM_DIFF_BASE;
+            writeDeltas(1);
+            return true;
+        case 0x8:
+            sample = n;
+            state = S_DIFF;
+            return true;
+        default:
+            high = (n << 6) & 0xC0;
+            sample = 0;
+            diff = RF_VRAM_DIFF_BASE;
+            state = S_LITERAL_0;
+            return true;
+        }
+
+    case S_DIFF:
+        state = S_DEFAULT;
+        if (n == 7) {
+            // Escape codes. None of them carry more VRAM data.
+            return false;
+        }
+        diff = n;
+        writeDeltas(1);
+        return true;
+
+    case S_LITERAL_0:
+        low = n;
+        state = S_LITERAL_1;
+        return true;
+
+    case S_LITERAL_1:
+        low |= n << 4;
+        state = S_LITERAL_2;
+        return true;
+
+    case S_LITERAL_2:
+        writeWord(low << 1, high | (n << 2) | ((low >> 6) & 2));
+        state = S_DEFAULT;
+        return true;
+
+    case S_RLE:
+        if (n & 0xC) {
+            // Plain run, then reprocess this nybble
+            state = S_DEFAULT;
+            writeDeltas((low & 3) + 1);
+            return nybble(n);
+        }
+        if (!(low & 2)) {
+            // Skip
+            ptr = (ptr + (((n << 1) | (low & 1)) & 7) * 2 + 2) & _SYS_VRAM_BYTE_MASK;
+            state = S_DEFAULT;
+            return true;
+        }
+        if (!(low & 1)) {
+            low = (n & 3) << 4;
+            state = S_WRDELTA;
+            return true;
+        }
+        if (!(n & 2)) {
+            high = n & 1;
+            state = S_WORD9_0;
+            return true;
+        }
+        if (!(n & 1)) {
+            state = S_WORD16_0;
+            return true;
+        }
+        // Flash escape, consumes the rest of the packet
+        state = S_DEFAULT;
+        return false;
+
+    case S_WRDELTA:
+        state = S_DEFAULT;
+        writeDeltas((low | n) + 5);
+        return true;
+
+    case S_WORD9_0:
+        low = n;
+        state = S_WORD9_1;
+        return true;
+
+    case S_WORD9_1:
+        ptr = ((high << 8) | (n << 4) | low) * 2;
+        state = S_DEFAULT;
+        return true;
+
+    case S_WORD16_0:
+        low = n;
+        state = S_WORD16_1;
+        return true;
+
+    case S_WORD16_1:
+        low |= n << 4;
+        state = S_WORD16_2;
+        return true;
+
+    case S_WORD16_2:
+        high = n;
+        state = S_WORD16_3;
+        return true;
+
+    case S_WORD16_3:
+        writeWord(low, high | (n << 4));
+        sample = 0;
+        diff = RF_VRAM_DIFF_BASE;
+        state = S_DEFAULT;
+        return true;
+    }
+
+    return false;
+}
+
+
+/***********************************************************************
+ * Scenes
+ */
+
+class Scene {
+public:
+    virtual ~Scene() {}
+    virtual const char *name() const = 0;
+    virtual unsigned numFrames() const = 0;
+
+    /// Rewind any internal state, so the scene can be replayed
+    virtual void begin() {}
+
+    /// Make this frame's changes. Frame zero starts from a zeroed VRAM.
+    virtual void frame(_SYSVideoBuffer &vb, unsigned n) = 0;
+
+protected:
+    static uint32_t random(uint32_t &seed) {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    }
+
+    static void tile(_SYSVideoBuffer &vb, uint16_t addr, unsigned index) {
+        VRAM::poke(vb, addr, _SYS_TILE77(index));
+    }
+
+    static void mode(_SYSVideoBuffer &vb, uint8_t m) {
+        VRAM::pokeb(vb, _SYS_VA_MODE, m);
+        VRAM::pokeb(vb, _SYS_VA_NUM_LINES, 128);
+    }
+};
+
+/// Slideshow of full-screen BG0 images, as in the stars and sensors demos
+class BG0RedrawScene : public Scene {
+public:
+    const char *name() const { return "bg0-redraw"; }
+    unsigned numFrames() const { return 24; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        mode(vb, _SYS_VM_BG0);
+        unsigned base = 0x100 + (n % 6) * 256;
+        for (unsigned y = 0; y < 16; ++y)
+            for (unsigned x = 0; x < 16; ++x)
+                tile(vb, y * _SYS_VRAM_BG0_WIDTH + x, base + y * 16 + x);
+    }
+};
+
+/// Side-scrolling map: pan every frame, stream in a new column every 8 pixels
+class BG0ScrollScene : public Scene {
+public:
+    const char *name() const { return "bg0-scroll"; }
+    unsigned numFrames() const { return 256; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        mode(vb, _SYS_VM_BG0);
+        if (n == 0) {
+            for (unsigned x = 0; x < _SYS_VRAM_BG0_WIDTH; ++x)
+                column(vb, x, x);
+        } else if ((n & 7) == 0) {
+            unsigned col = n / 8 + _SYS_VRAM_BG0_WIDTH - 1;
+            column(vb, col % _SYS_VRAM_BG0_WIDTH, col);
+        }
+        VRAM::pokeb(vb, _SYS_VA_BG0_XY, n % (_SYS_VRAM_BG0_WIDTH * 8));
+    }
+
+private:
+    // A tiled level: ground, sky, and a few repeating 4x2 structures
+    void column(_SYSVideoBuffer &vb, unsigned x, unsigned mapX) {
+        for (unsigned y = 0; y < _SYS_VRAM_BG0_WIDTH; ++y) {
+            unsigned index;
+            if (y >= 15)
+                index = 0x40 + (mapX & 1);
+            else if (y >= 11 && (mapX % 12) < 4)
+                index = 0x80 + (y - 11) * 4 + (mapX % 12);
+            else
+                index = 0x20;
+            tile(vb, y * _SYS_VRAM_BG0_WIDTH + x, index);
+        }
+    }
+};
+
+/// Text console, as in the text and menus demos: a few characters per frame
+class TextScene : public Scene {
+public:
+    const char *name() const { return "text"; }
+    unsigned numFrames() const { return 200; }
+    void begin() { seed = 1; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        mode(vb, _SYS_VM_BG0_ROM);
+        if (n == 0) {
+            for (unsigned i = 0; i < _SYS_VRAM_BG0_WIDTH * _SYS_VRAM_BG0_WIDTH; ++i)
+                tile(vb, i, 0);
+        }
+
+        // Type four characters, with a line feed every 16
+        for (unsigned i = 0; i < 4; ++i) {
+            unsigned pos = (n * 4 + i) % (16 * 16);
+            unsigned ch = 'a' + random(seed) % 26;
+            if (random(seed) % 6 == 0)
+                ch = ' ';
+            tile(vb, (pos / 16) * _SYS_VRAM_BG0_WIDTH + (pos % 16), ch - ' ');
+        }
+    }
+
+private:
+    uint32_t seed;
+};
+
+/// Eight sprites bouncing over a static BG0, as in the sprites demo
+class SpriteScene : public Scene {
+public:
+    const char *name() const { return "sprites"; }
+    unsigned numFrames() const { return 300; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        if (n == 0) {
+            mode(vb, _SYS_VM_BG0_SPR_BG1);
+            for (unsigned y = 0; y < 16; ++y)
+                for (unsigned x = 0; x < 16; ++x)
+                    tile(vb, y * _SYS_VRAM_BG0_WIDTH + x, 0x200 + y * 16 + x);
+        }
+
+        for (unsigned i = 0; i < _SYS_VRAM_SPRITES; ++i) {
+            unsigned base = offsetof(_SYSVideoRAM, spr[0]) + i * sizeof(_SYSSpriteInfo);
+            unsigned t = n + i * 19;
+            int x = (t * (i + 1)) % 224;
+            int y = (t * (8 - i)) % 224;
+            if (x >= 112) x = 224 - x;
+            if (y >= 112) y = 224 - y;
+
+            VRAM::pokeb(vb, base + offsetof(_SYSSpriteInfo, mask_y), -16);
+            VRAM::pokeb(vb, base + offsetof(_SYSSpriteInfo, mask_x), -16);
+            VRAM::pokeb(vb, base + offsetof(_SYSSpriteInfo, pos_y), -y);
+            VRAM::pokeb(vb, base + offsetof(_SYSSpriteInfo, pos_x), -x);
+            tile(vb, (base + offsetof(_SYSSpriteInfo, tile)) / 2,
+                0x1000 + i * 16 + ((n / 4) % 4) * 4);
+        }
+    }
+};
+
+/// A BG1 overlay window that grows and shrinks, with its tiles redrawn
+class BG1Scene : public Scene {
+public:
+    const char *name() const { return "bg1-overlay"; }
+    unsigned numFrames() const { return 64; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        if (n == 0) {
+            mode(vb, _SYS_VM_BG0_BG1);
+            for (unsigned i = 0; i < _SYS_VRAM_BG0_WIDTH * _SYS_VRAM_BG0_WIDTH; ++i)
+                tile(vb, i, 0x300 + i % 32);
+        }
+
+        unsigned size = 2 + (n % 16 < 8 ? n % 8 : 8 - n % 8);
+        unsigned count = 0;
+        for (unsigned y = 0; y < _SYS_VRAM_BG1_WIDTH; ++y) {
+            uint16_t row = y < size ? (1 << size) - 1 : 0;
+            VRAM::poke(vb, _SYS_VA_BG1_BITMAP / 2 + y, row);
+            for (unsigned x = 0; x < size && y < size; ++x)
+                tile(vb, _SYS_VA_BG1_TILES / 2 + count++, 0x400 + (n & 1) * 64 + y * 8 + x);
+        }
+        VRAM::pokeb(vb, _SYS_VA_BG1_XY, -int(n % 32));
+    }
+};
+
+/// Freehand painting on the FB32 framebuffer, a few pixels per frame
+class PaintScene : public Scene {
+public:
+    const char *name() const { return "fb32-paint"; }
+    unsigned numFrames() const { return 200; }
+
+    void begin() {
+        seed = 7;
+        x = y = 16;
+    }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        if (n == 0) {
+            mode(vb, _SYS_VM_FB32);
+            for (unsigned i = 0; i < 16; ++i)
+                VRAM::poke(vb, _SYS_VA_COLORMAP / 2 + i, i * 0x1111);
+        }
+
+        for (unsigned i = 0; i < 6; ++i) {
+            x = (x + random(seed) % 3 - 1) & 31;
+            y = (y + random(seed) % 3 - 1) & 31;
+            unsigned addr = y * 16 + x / 2;
+            uint8_t color = 1 + (n / 20) % 15;
+            uint8_t b = VRAM::peekb(vb, addr);
+            if (x & 1)
+                b = (b & 0x0F) | (color << 4);
+            else
+                b = (b & 0xF0) | color;
+            VRAM::pokeb(vb, addr, b);
+        }
+    }
+
+private:
+    uint32_t seed;
+    unsigned x, y;
+};
+
+/// Immediate-mode game: clear the playfield and redraw everything each frame
+class ImmediateScene : public Scene {
+public:
+    const char *name() const { return "bg0-immediate"; }
+    unsigned numFrames() const { return 120; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        mode(vb, _SYS_VM_BG0);
+
+        for (unsigned y = 0; y < 16; ++y)
+            for (unsigned x = 0; x < 16; ++x)
+                tile(vb, y * _SYS_VRAM_BG0_WIDTH + x, y == 15 ? 0x40 : 0x20);
+
+        // 4-digit score, ticking up slowly
+        unsigned score = n / 8;
+        for (unsigned i = 0; i < 4; ++i, score /= 10)
+            tile(vb, 3 - i, 0x10 + score % 10);
+
+        // 2x2 player, walking along the ground
+        unsigned px = (n / 2) % 14;
+        for (unsigned i = 0; i < 4; ++i)
+            tile(vb, (13 + i / 2) * _SYS_VRAM_BG0_WIDTH + px + i % 2, 0x60 + i);
+    }
+};
+
+/// Random words everywhere. Nothing to compress; a worst-case bound.
+class NoiseScene : public Scene {
+public:
+    const char *name() const { return "noise"; }
+    unsigned numFrames() const { return 8; }
+    void begin() { seed = 3; }
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        for (unsigned i = 0; i < _SYS_VA_BG1_TILES / 2; ++i)
+            VRAM::poke(vb, i, random(seed));
+    }
+
+private:
+    uint32_t seed;
+};
+
+/// Frames loaded from a corpus file
+class CorpusScene : public Scene {
+public:
+    CorpusScene(const char *filename) : filename(filename) {}
+    const char *name() const { return filename; }
+    unsigned numFrames() const { return frames.size(); }
+
+    bool load();
+
+    void frame(_SYSVideoBuffer &vb, unsigned n) {
+        const std::vector<Write> &f = frames[n];
+        for (unsigned i = 0; i < f.size(); ++i) {
+            if (f[i].byte)
+                VRAM::pokeb(vb, f[i].addr, f[i].value);
+            else
+                VRAM::poke(vb, f[i].addr, f[i].value);
+        }
+    }
+
+private:
+    struct Write {
+        uint16_t addr;
+        uint16_t value;
+        bool byte;
+    };
+
+    const char *filename;
+    std::vector< std::vector<Write> > frames;
+};
+
+bool CorpusScene::load()
+{
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return false;
+    }
+
+    std::vector<Write> current;
+    char line[256];
+    unsigned lineNum = 0;
+
+    while (fgets(line, sizeof line, f)) {
+        lineNum++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        char op[16];
+        unsigned a = 0, b = 0, c = 0;
+        int n = sscanf(line, "%15s %i %i %i", op, &a, &b, &c);
+        if (n <= 0)
+            continue;
+
+        Write w;
+        w.addr = a;
+        w.value = b;
+        w.byte = false;
+
+        if (!strcmp(op, "frame") && n == 1) {
+            frames.push_back(current);
+            current.clear();
+        } else if (!strcmp(op, "poke") && n == 3 && a < _SYS_VRAM_WORDS) {
+            current.push_back(w);
+        } else if (!strcmp(op, "pokeb") && n == 3 && a < _SYS_VRAM_BYTES) {
+            w.byte = true;
+            current.push_back(w);
+        } else if (!strcmp(op, "fill") && n == 4 && a + b <= _SYS_VRAM_WORDS) {
+            w.value = c;
+            for (unsigned i = 0; i < b; ++i, ++w.addr)
+                current.push_back(w);
+        } else {
+            fprintf(stderr, "%s:%u: syntax error\n", filename, lineNum);
+            fclose(f);
+            return false;
+        }
+    }
+
+    if (!current.empty())
+        frames.push_back(current);
+
+    fclose(f);
+    return true;
+}
+
+
+/***********************************************************************
+ * Benchmark driver
+ */
+
+enum Mode { GREEDY, LOOKAHEAD, SHADOW, LOG };
+static const char *modeNames[] = { "greedy", "lookahead", "shadow", "log" };
+
+struct Result {
+    unsigned frames;
+    unsigned packets;
+    unsigned maxPackets;
+    unsigned words;
+    uint64_t bytes;
+    uint64_t cycles;
+};
+
+static bool runScene(Scene &scene, Mode mode, Result &r)
+{
+    _SYSVideoBuffer vb;
+    _SYSVideoShadow shadow;
+    _SYSVideoChangeLog log;
+    CubeCodec codec;
+    CubeDecoder cube;
+
+    // CubeSlots live in zeroed static memory; start the codec the same way
+    memset(&codec, 0, sizeof codec);
+    memset(&vb, 0, sizeof vb);
+    memset(&shadow, 0, sizeof shadow);
+    memset(&r, 0, sizeof r);
+    VRAM::init(vb);
+    codec.stateReset();
+    CubeCodec::lookahead = mode != GREEDY;
+    if (mode == LOG)
+        VRAMChangeLog::attach(&vb, &log);
+    scene.begin();
+
+    for (unsigned n = 0; n < scene.numFrames(); ++n) {
+        scene.frame(vb, n);
+        VRAM::unlock(vb);
+
+        for (unsigned i = 0; i < arraysize(vb.cm1); ++i)
+            r.words += __builtin_popcount(vb.cm1[i]);
+
+        // One packet at a time, like CubeSlot::radioProduce()
+        unsigned packets = 0;
+        bool more;
+        do {
+            uint8_t bytes[PacketBuffer::MAX_LEN];
+            PacketBuffer buf(bytes);
+
+            uint64_t start = cycles();
+            codec.encodeVRAM(buf, &vb, mode == SHADOW ? &shadow : 0);
+            codec.endPacket(buf);
+            r.cycles += cycles() - start;
+
+            cube.packet(buf);
+            r.bytes += buf.len;
+            packets++;
+
+            more = buf.isFull() || vb.cm16;
+        } while (more);
+
+        r.frames++;
+        r.packets += packets;
+        r.maxPackets = MAX(r.maxPackets, packets);
+
+        if (memcmp(cube.vram, vb.vram.bytes, sizeof cube.vram)) {
+            for (unsigned i = 0; i < _SYS_VRAM_WORDS; ++i) {
+                uint16_t w = cube.vram[i*2] | (cube.vram[i*2+1] << 8);
+                if (w != vb.vram.words[i]) {
+                    fprintf(stderr, "%s: frame %u, %s: cube VRAM word %03x is %04x, expected %04x\n",
+                        scene.name(), n, modeNames[mode],
+                        i, w, vb.vram.words[i]);
+                    break;
+                }
+            }
+            VRAMChangeLog::detachAll();
+            return false;
+        }
+    }
+
+    VRAMChangeLog::detachAll();
+    return true;
+}
+
+static void report(const char *name, const char *mode, const Result &r)
+{
+    printf("  %-16s %-9s %5u %7.2f %4u %9u %8.1f %6.2f %10.0f\n",
+        name, mode, r.frames,
+        double(r.packets) / r.frames, r.maxPackets,
+        unsigned(r.bytes), double(r.bytes) / r.frames,
+        r.words ? 8.0 * r.bytes / r.words : 0.0,
+        double(r.cycles) / r.frames);
+}
+
+static void loadBaseline(const char *filename, std::map<std::string, unsigned> &baseline)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f)
+        return;
+
+    char key[256];
+    unsigned bytes;
+    while (fscanf(f, "%255s %u", key, &bytes) == 2)
+        baseline[key] = bytes;
+
+    fclose(f);
+}
+
+static bool saveBaseline(const char *filename, const std::map<std::string, unsigned> &baseline)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        perror(filename);
+        return false;
+    }
+
+    for (std::map<std::string, unsigned>::const_iterator i = baseline.begin();
+         i != baseline.end(); ++i)
+        fprintf(f, "%s %u\n", i->first.c_str(), i->second);
+
+    fclose(f);
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *baselineFile = defaultBaseline;
+    bool writeBaseline = false;
+    std::vector<Scene*> scenes;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-w")) {
+            writeBaseline = true;
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            baselineFile = argv[++i];
+        } else {
+            CorpusScene *scene = new CorpusScene(argv[i]);
+            if (!scene->load())
+                return 1;
+            scenes.push_back(scene);
+        }
+    }
+
+    if (scenes.empty()) {
+        scenes.push_back(new BG0RedrawScene);
+        scenes.push_back(new BG0ScrollScene);
+        scenes.push_back(new TextScene);
+        scenes.push_back(new SpriteScene);
+        scenes.push_back(new BG1Scene);
+        scenes.push_back(new PaintScene);
+        scenes.push_back(new ImmediateScene);
+        scenes.push_back(new NoiseScene);
+    }
+
+    std::map<std::string, unsigned> baseline, results;
+    loadBaseline(baselineFile, baseline);
+
+    printf("  %-16s %-9s %5s %7s %4s %9s %8s %6s %10s\n",
+        "scene", "encoder", "frms", "pkt/frm", "max",
+        "bytes", "B/frm", "b/word", "cyc/frm");
+
+    bool success = true;
+    for (unsigned i = 0; i < scenes.size(); ++i) {
+        for (unsigned mode = 0; mode < arraysize(modeNames); ++mode) {
+            const char *modeName = modeNames[mode];
+            Result r;
+
+            if (!runScene(*scenes[i], Mode(mode), r)) {
+                success = false;
+                continue;
+            }
+            report(scenes[i]->name(), modeName, r);
+
+            std::string key = std::string(scenes[i]->name()) + "/" + modeName;
+            results[key] = r.bytes;
+
+            std::map<std::string, unsigned>::iterator b = baseline.find(key);
+            if (!writeBaseline && b != baseline.end() && r.bytes > b->second) {
+                fprintf(stderr, "%s: %u bytes, baseline is %u\n",
+                    key.c_str(), unsigned(r.bytes), b->second);
+                success = false;
+            }
+        }
+
+        delete scenes[i];
+    }
+
+    if (writeBaseline && success && !saveBaseline(baselineFile, results))
+        return 1;
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,451 @@
+/*
+ * Flash stack benchmark.
+ *
+ * Replays simple text traces (boot, install, save-game churn) against the
+ * master firmware's flash stack, running on a RAM-backed FlashDevice, and
+ * reports what each trace cost: block cache hit rates, device traffic,
+ * erase counts, and wall time. Intended for comparing cache and GC changes.
+ *
+ * Usage: flashbench [trace files...]
+ *
+ * With no arguments, the default traces in this directory are replayed.
+ *
+ * Trace syntax, one operation per line. '#' starts a comment.
+ *
+ *   format                     Physically erase, and rebuild the erase log
+ *   reboot                     Cold caches, as after a power cycle
+ *   mark                       Start measuring here; earlier ops are setup
+ *   install <name> <bytes>     Write a new game volume, replacing <name>
+ *   delete <name>              Delete a game and its children
+ *   boot                       Enumerate volumes, touch each game's header
+ *   read <name> <bytes>        Sequential read through a game's payload
+ *   write <name> <key> <bytes> Store an LFS object belonging to <name>
+ *   load <name> <key>          Read back and verify an LFS object
+ *   repeat <count> ... end     Loop over the enclosed operations
+ */
+
+#include "flashbench.h"
+#include "flash_stack.h"
+#include "flash_blockcache.h"
+#include "flash_volume.h"
+#include "flash_recycler.h"
+#include "flash_lfs.h"
+#include "crc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+static const char *defaultTraces[] = {
+    "boot.trace",
+    "install.trace",
+    "savegame.trace",
+};
+
+struct Op {
+    std::string name;
+    std::vector<std::string> args;
+    unsigned line;
+};
+
+struct Object {
+    uint32_t seed;
+    unsigned size;
+};
+
+struct Game {
+    Game() : vol(FlashMapBlock::invalid()) {}
+
+    FlashVolume vol;
+    std::map<unsigned, Object> objects;
+};
+
+class Bench {
+public:
+    Bench(const char *filename) : filename(filename), numOps(0) {}
+
+    bool load();
+    bool run();
+    void report();
+
+private:
+    const char *filename;
+    std::vector<Op> ops;
+    std::map<std::string, Game> games;
+    unsigned numOps;
+
+    // Baselines captured by 'mark'
+    clock_t startTime;
+    BenchCacheStats cacheBase;
+    BenchDevice deviceBase;
+
+    bool exec(unsigned &pc);
+    void mark();
+
+    bool opInstall(const Op &op, const std::string &name, unsigned bytes);
+    bool opBoot(const Op &op);
+    bool opRead(const Op &op, Game &game, unsigned bytes);
+    bool opWrite(const Op &op, Game &game, unsigned key, unsigned bytes);
+    bool opLoad(const Op &op, Game &game, unsigned key);
+
+    bool fail(const Op &op, const char *msg);
+    Game *findGame(const Op &op, const std::string &name);
+
+    static void fillPattern(uint8_t *buf, unsigned len, uint32_t seed);
+    static unsigned parseNumber(const std::string &s);
+};
+
+
+bool Bench::load()
+{
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "flashbench: can't open '%s'\n", filename);
+        return false;
+    }
+
+    char buf[256];
+    unsigned line = 0;
+
+    while (fgets(buf, sizeof buf, f)) {
+        line++;
+
+        char *comment = strchr(buf, '#');
+        if (comment)
+            *comment = '\0';
+
+        Op op;
+        op.line = line;
+        for (char *tok = strtok(buf, " \t\r\n"); tok; tok = strtok(0, " \t\r\n")) {
+            if (op.name.empty())
+                op.name = tok;
+            else
+                op.args.push_back(tok);
+        }
+
+        if (!op.name.empty())
+            ops.push_back(op);
+    }
+
+    fclose(f);
+    return true;
+}
+
+bool Bench::run()
+{
+    // Every trace starts from a blank device and cold caches
+    gDevice.reset();
+    FlashStack::init();
+    games.clear();
+    mark();
+
+    unsigned pc = 0;
+    while (pc < ops.size())
+        if (!exec(pc))
+            return false;
+
+    return true;
+}
+
+bool Bench::exec(unsigned &pc)
+{
+    const Op &op = ops[pc++];
+    const std::vector<std::string> &a = op.args;
+
+    if (op.name == "repeat" && a.size() == 1) {
+        unsigned count = parseNumber(a[0]);
+        unsigned body = pc;
+
+        for (unsigned i = 0; i < count; ++i) {
+            pc = body;
+            while (true) {
+                if (pc >= ops.size())
+                    return fail(op, "missing 'end'");
+                if (ops[pc].name == "end")
+                    break;
+                if (!exec(pc))
+                    return false;
+            }
+        }
+
+        pc++;   // Skip 'end'
+        return true;
+    }
+
+    numOps++;
+
+    if (op.name == "format" && a.empty()) {
+        FlashStack::reformatDevice();
+        games.clear();
+        return true;
+    }
+
+    if (op.name == "reboot" && a.empty()) {
+        FlashStack::init();
+        return true;
+    }
+
+    if (op.name == "mark" && a.empty()) {
+        mark();
+        return true;
+    }
+
+    if (op.name == "install" && a.size() == 2)
+        return opInstall(op, a[0], parseNumber(a[1]));
+
+    if (op.name == "delete" && a.size() == 1) {
+        Game *game = findGame(op, a[0]);
+        if (!game)
+            return false;
+        game->vol.deleteTree();
+        games.erase(a[0]);
+        return true;
+    }
+
+    if (op.name == "boot" && a.empty())
+        return opBoot(op);
+
+    if (op.name == "read" && a.size() == 2) {
+        Game *game = findGame(op, a[0]);
+        return game && opRead(op, *game, parseNumber(a[1]));
+    }
+
+    if (op.name == "write" && a.size() == 3) {
+        Game *game = findGame(op, a[0]);
+        return game && opWrite(op, *game, parseNumber(a[1]), parseNumber(a[2]));
+    }
+
+    if (op.name == "load" && a.size() == 2) {
+        Game *game = findGame(op, a[0]);
+        return game && opLoad(op, *game, parseNumber(a[1]));
+    }
+
+    return fail(op, "unrecognized operation");
+}
+
+void Bench::mark()
+{
+    startTime = clock();
+    cacheBase = gCacheStats;
+    deviceBase = gDevice;
+    numOps = 0;
+}
+
+bool Bench::opInstall(const Op &op, const std::string &name, unsigned bytes)
+{
+    std::map<std::string, Game>::iterator existing = games.find(name);
+    if (existing != games.end()) {
+        existing->second.vol.deleteTree();
+        games.erase(existing);
+    }
+
+    FlashBlockRecycler recycler;
+    FlashVolumeWriter writer;
+    if (!writer.begin(recycler, FlashVolume::T_GAME, bytes))
+        return fail(op, "out of space");
+
+    // Same chunk size as a USB install
+    uint8_t chunk[64];
+    uint32_t seed = bytes;
+
+    for (unsigned offset = 0; offset < bytes; offset += sizeof chunk) {
+        unsigned len = MIN(sizeof chunk, bytes - offset);
+        fillPattern(chunk, len, seed++);
+        writer.appendPayload(chunk, len);
+    }
+
+    writer.commit();
+    games[name].vol = writer.volume;
+    return true;
+}
+
+bool Bench::opBoot(const Op &op)
+{
+    // Roughly what the launcher does: find every game, peek at its header.
+
+    FlashVolumeIter vi;
+    FlashVolume vol;
+    unsigned numGames = 0;
+
+    vi.begin();
+    while (vi.next(vol)) {
+        if (vol.getType() != FlashVolume::T_GAME)
+            continue;
+
+        FlashBlockRef mapRef, dataRef;
+        FlashMapSpan span = vol.getPayload(mapRef);
+        if (!span.getBlock(dataRef, 0))
+            return fail(op, "can't read game payload");
+        numGames++;
+    }
+
+    if (numGames != games.size())
+        return fail(op, "wrong number of games found");
+
+    return true;
+}
+
+bool Bench::opRead(const Op &op, Game &game, unsigned bytes)
+{
+    FlashBlockRef mapRef, dataRef;
+    FlashMapSpan span = game.vol.getPayload(mapRef);
+
+    for (unsigned offset = 0; offset < bytes; offset += FlashBlock::BLOCK_SIZE)
+        if (!span.getBlock(dataRef, offset))
+            return fail(op, "read past end of payload");
+
+    return true;
+}
+
+bool Bench::opWrite(const Op &op, Game &game, unsigned key, unsigned bytes)
+{
+    // Mirrors SysLFS::write()
+
+    if (!FlashLFSIndexRecord::isKeyAllowed(key) ||
+        !FlashLFSIndexRecord::isSizeAllowed(bytes))
+        return fail(op, "bad key or size");
+
+    uint8_t data[FlashLFSIndexRecord::MAX_SIZE];
+    uint32_t seed = (key << 16) ^ numOps;
+    fillPattern(data, bytes, seed);
+
+    CrcStream cs;
+    cs.reset();
+    cs.addBytes(data, bytes);
+    uint32_t crc = cs.get(FlashLFSIndexRecord::SIZE_UNIT);
+
+    FlashLFS &lfs = FlashLFSCache::get(game.vol);
+    FlashLFSObjectAllocator allocator(lfs, key, bytes, crc);
+
+    if (!allocator.allocateAndCollectGarbage())
+        return fail(op, "out of space");
+
+    FlashBlock::invalidate(allocator.address(), allocator.address() + bytes);
+    FlashDevice::write(allocator.address(), data, bytes);
+
+    Object &obj = game.objects[key];
+    obj.seed = seed;
+    obj.size = bytes;
+    return true;
+}
+
+bool Bench::opLoad(const Op &op, Game &game, unsigned key)
+{
+    // Mirrors _SYS_fs_objectRead(), including the key cache
+
+    std::map<unsigned, Object>::iterator obj = game.objects.find(key);
+    if (obj == game.objects.end())
+        return fail(op, "object was never written");
+
+    uint8_t buffer[FlashLFSIndexRecord::MAX_SIZE];
+    FlashLFS &lfs = FlashLFSCache::get(game.vol);
+
+    int size = lfs.keyCache.read(key, buffer, sizeof buffer);
+    if (size < 0) {
+        size = 0;
+        FlashLFSObjectIter iter(lfs);
+        while (iter.previous(FlashLFSKeyQuery(key))) {
+            unsigned recSize = iter.record()->getSizeInBytes();
+            if (iter.readAndCheck(buffer, recSize)) {
+                lfs.keyCache.store(key, iter.address(), iter.record());
+                size = recSize;
+                break;
+            }
+        }
+    }
+
+    // Sizes are rounded up to the allocation unit
+    unsigned objSize = obj->second.size;
+    if (size < int(objSize))
+        return fail(op, "object not found");
+
+    uint8_t expected[FlashLFSIndexRecord::MAX_SIZE];
+    fillPattern(expected, objSize, obj->second.seed);
+    if (memcmp(buffer, expected, objSize))
+        return fail(op, "object data mismatch");
+
+    return true;
+}
+
+void Bench::report()
+{
+    double seconds = double(clock() - startTime) / CLOCKS_PER_SEC;
+
+    unsigned total = gCacheStats.total - cacheBase.total;
+    unsigned same = gCacheStats.hitSame - cacheBase.hitSame;
+    unsigned misses = gCacheStats.miss - cacheBase.miss;
+
+    uint64_t reads = gDevice.traffic.reads - deviceBase.traffic.reads;
+    uint64_t bytesRead = gDevice.traffic.bytesRead - deviceBase.traffic.bytesRead;
+    uint64_t writes = gDevice.traffic.writes - deviceBase.traffic.writes;
+    uint64_t bytesWritten = gDevice.traffic.bytesWritten - deviceBase.traffic.bytesWritten;
+    uint64_t erases = gDevice.traffic.erases - deviceBase.traffic.erases;
+
+    unsigned ecMin = (unsigned)-1, ecMax = 0, ecTotal = 0;
+    for (unsigned i = 0; i < BenchDevice::NUM_SECTORS; ++i) {
+        unsigned ec = gDevice.eraseCounts[i];
+        ecMin = MIN(ecMin, ec);
+        ecMax = MAX(ecMax, ec);
+        ecTotal += ec;
+    }
+
+    printf("\n%s: %u ops in %.3f s\n", filename, numOps, seconds);
+    printf("  cache    %8u accesses, %5.1f%% hit, %u same-block, %u misses\n",
+        total, total ? 100.0 * (total - misses) / total : 0.0, same, misses);
+    printf("  read     %8u ops, %10.1f kB\n", unsigned(reads), bytesRead / 1024.0);
+    printf("  write    %8u ops, %10.1f kB\n", unsigned(writes), bytesWritten / 1024.0);
+    printf("  erase    %8u blocks; wear min/avg/max %u / %.2f / %u\n",
+        unsigned(erases), ecMin, double(ecTotal) / BenchDevice::NUM_SECTORS, ecMax);
+}
+
+bool Bench::fail(const Op &op, const char *msg)
+{
+    fprintf(stderr, "%s:%u: %s: %s\n", filename, op.line, op.name.c_str(), msg);
+    return false;
+}
+
+Game *Bench::findGame(const Op &op, const std::string &name)
+{
+    std::map<std::string, Game>::iterator i = games.find(name);
+    if (i == games.end()) {
+        fail(op, "no such game");
+        return 0;
+    }
+    return &i->second;
+}
+
+void Bench::fillPattern(uint8_t *buf, unsigned len, uint32_t seed)
+{
+    uint32_t x = seed * 2654435761u + 1;
+    for (unsigned i = 0; i < len; ++i) {
+        x = x * 1103515245 + 12345;
+        buf[i] = x >> 16;
+    }
+}
+
+unsigned Bench::parseNumber(const std::string &s)
+{
+    return strtoul(s.c_str(), 0, 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<const char *> traces;
+    for (int i = 1; i < argc; ++i)
+        traces.push_back(argv[i]);
+    if (traces.empty())
+        traces.assign(defaultTraces, defaultTraces + arraysize(defaultTraces));
+
+    for (unsigned i = 0; i < traces.size(); ++i) {
+        Bench bench(traces[i]);
+        if (!bench.load() || !bench.run())
+            return 1;
+        bench.report();
+    }
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Host-side environment for the flash stack benchmark.
+ *
+ * This gives the master firmware's flash stack a RAM-backed FlashDevice
+ * with traffic counters, a software CRC, and no-op versions of the few
+ * SVM, event, and SysLFS hooks that the volume layer calls into.
+ */
+
+#include "flashbench.h"
+#include "flash_device.h"
+#include "flash_blockcache.h"
+#include "flash_volume.h"
+#include "flash_syslfs.h"
+#include "svmdebugger.h"
+#include "svmcpu.h"
+#include "svmloader.h"
+#include "faultlogger.h"
+#include "event.h"
+#include "tasks.h"
+#include "crc.h"
+#include "systime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+BenchDevice gDevice;
+BenchCacheStats gCacheStats;
+
+static uint8_t gFlash[FlashDevice::CAPACITY];
+
+
+/***********************************************************************
+ * FlashDevice
+ */
+
+void BenchDevice::reset()
+{
+    memset(gFlash, 0xFF, sizeof gFlash);
+    memset(eraseCounts, 0, sizeof eraseCounts);
+    memset(&traffic, 0, sizeof traffic);
+}
+
+void FlashDevice::init()
+{
+    // Nothing to do
+}
+
+void FlashDevice::read(uint32_t address, uint8_t *buf, unsigned len)
+{
+    ASSERT(address + len <= CAPACITY);
+    memcpy(buf, gFlash + address, len);
+    gDevice.traffic.reads++;
+    gDevice.traffic.bytesRead += len;
+}
+
+bool FlashDevice::readAsync(uint32_t address, uint8_t *buf, unsigned len)
+{
+    read(address, buf, len);
+    return true;
+}
+
+bool FlashDevice::asyncDone()
+{
+    return true;
+}
+
+bool FlashDevice::finishAsync()
+{
+    return true;
+}
+
+void FlashDevice::write(uint32_t address, const uint8_t *buf, unsigned len)
+{
+    ASSERT(address + len <= CAPACITY);
+
+    // Program bits from 1 to 0 only.
+    for (unsigned i = 0; i < len; ++i)
+        gFlash[address + i] &= buf[i];
+
+    gDevice.traffic.writes++;
+    gDevice.traffic.bytesWritten += len;
+}
+
+void FlashDevice::verify(uint32_t address, const uint8_t *buf, unsigned len)
+{
+    ASSERT(address + len <= CAPACITY);
+    ASSERT(0 == memcmp(buf, gFlash + address, len));
+}
+
+void FlashDevice::setStealthIO(int counter)
+{
+    // All benchmark I/O is counted
+}
+
+void FlashDevice::eraseBlock(uint32_t address)
+{
+    ASSERT(address < CAPACITY);
+    unsigned sector = address / ERASE_BLOCK_SIZE;
+
+    memset(gFlash + sector * ERASE_BLOCK_SIZE, 0xFF, ERASE_BLOCK_SIZE);
+    gDevice.eraseCounts[sector]++;
+    gDevice.traffic.erases++;
+}
+
+void FlashDevice::eraseAll()
+{
+    for (unsigned i = 0; i < CAPACITY; i += ERASE_BLOCK_SIZE)
+        eraseBlock(i);
+}
+
+bool FlashDevice::busy()
+{
+    return false;
+}
+
+void FlashDevice::readId(JedecID *id)
+{
+    id->manufacturerID = MACRONIX_MFGR_ID;
+    id->memoryType = 0x20;
+    id->memoryDensity = 0x18;
+}
+
+
+/***********************************************************************
+ * FlashBlock statistics
+ *
+ * These normally live in the simulator, where they're tied to its
+ * command line options. Here we just keep the running totals.
+ */
+
+FlashBlock::FlashStats FlashBlock::stats;
+
+bool FlashBlock::isAddrValid(uintptr_t pa)
+{
+    uintptr_t offset = reinterpret_cast<uint8_t*>(pa) - &mem[0][0];
+    return offset < sizeof mem;
+}
+
+void FlashBlock::verify()
+{
+    FlashDevice::verify(address, getData(), BLOCK_SIZE);
+}
+
+// Totals from earlier intervals; FlashBlock::init() resets the counters
+static BenchCacheStats carried;
+
+void FlashBlock::resetStats()
+{
+    carried = gCacheStats;
+    memset(&stats.periodic, 0, sizeof stats.periodic);
+}
+
+void FlashBlock::countBlockMiss(uint32_t blockAddr)
+{
+    stats.periodic.blockMiss++;
+}
+
+void FlashBlock::dumpStats()
+{
+    // Called after every block access. Publish the running totals.
+    gCacheStats.total = carried.total + stats.periodic.blockTotal;
+    gCacheStats.hitSame = carried.hitSame + stats.periodic.blockHitSame;
+    gCacheStats.hitOther = carried.hitOther + stats.periodic.blockHitOther;
+    gCacheStats.miss = carried.miss + stats.periodic.blockMiss;
+    gCacheStats.preload = carried.preload + stats.periodic.blockPreload;
+}
+
+
+/***********************************************************************
+ * CRC32, bit-serial version of the same polynomial as the hardware
+ */
+
+static uint32_t gCrc;
+
+void Crc32::init() {}
+void Crc32::deinit() {}
+
+void Crc32::reset()
+{
+    gCrc = 0xffffffff;
+}
+
+uint32_t Crc32::get()
+{
+    return gCrc;
+}
+
+void Crc32::add(uint32_t word)
+{
+    gCrc ^= word;
+    for (unsigned i = 0; i < 32; ++i)
+        gCrc = (gCrc & 0x80000000) ? ((gCrc << 1) ^ 0x04c11db7) : (gCrc << 1);
+}
+
+void Crc32::addInline(uint32_t word)
+{
+    add(word);
+}
+
+void Crc32::addUniqueness()
+{
+    add(0x5ad5eed5);
+}
+
+
+/***********************************************************************
+ * Hooks from the flash stack into the rest of the system
+ */
+
+FlashVolume SvmLoader::mapVols[SvmMemory::NUM_FLASH_SEGMENTS];
+uint32_t Tasks::watchdogCounter;
+
+SysTime::Ticks SysTime::ticks()
+{
+    return clock() * (sTicks(1) / CLOCKS_PER_SEC);
+}
+
+void SvmDebugger::patchFlashBlock(uint32_t blockAddr, uint8_t *data) {}
+void SvmCpu::invalidateDecodeCache(unsigned blockID) {}
+void Event::setBasePending(PriorityID pid, uint32_t param) {}
+void SysLFS::invalidateClients() {}
+void SysLFS::cleanupDeletedVolumes() {}
+
+void FaultLogger::internalError(unsigned code)
+{
+    fprintf(stderr, "flashbench: internal error %d\n", code);
+    abort();
+}
@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+#
+# Parallel runner for the unit tests in this directory.
+#
+# Runs each entry from TESTS in the Makefile as its own "make" job, several
+# at a time, and reports the results as they finish. Each job gets its own
+# temporary directory, and optionally its own GDB server port for every
+# siftulator instance it launches. Siftulator's flash is in-memory unless a
+# test asks otherwise, and each test builds in its own directory, so jobs
+# don't share any state.
+#
+# Optionally writes a JUnit XML report, for continuous integration.
+#
+# Copyright (c) 2012 Sifteo, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+from __future__ import print_function
+
+import multiprocessing
+import optparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from xml.sax.saxutils import escape, quoteattr
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+MAKE = os.environ.get('MAKE', 'make')
+
+
+class TestJob:
+    def __init__(self, name, index):
+        self.name = name
+        self.index = index
+        self.status = None
+        self.output = ''
+        self.seconds = 0.0
+
+    def passed(self):
+        return self.status == 0
+
+    def run(self, opts):
+        env = dict(os.environ)
+        tmp = tempfile.mkdtemp(prefix='tc-test-')
+        env['TMPDIR'] = tmp
+
+        if opts.gdb_port_base:
+            env['TEST_SIFTULATOR_FLAGS'] = '-P %d' % (opts.gdb_port_base + self.index)
+
+        start = time.time()
+        try:
+            p = subprocess.Popen([MAKE, '-C', TEST_DIR, self.name], env=env,
+                                 stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            self.output = p.communicate()[0].decode('utf-8', 'replace')
+            self.status = p.returncode
+        finally:
+            self.seconds = time.time() - start
+            shutil.rmtree(tmp, ignore_errors=True)
+
+
+def listTests():
+    out = subprocess.Popen([MAKE, '-s', '-C', TEST_DIR, 'list-tests'],
+                           stdout=subprocess.PIPE).communicate()[0]
+    return out.decode('utf-8').split()
+
+
+def runAll(jobs, opts):
+    # Simple worker pool; each worker pulls the next job off the list.
+
+    pending = list(jobs)
+    lock = threading.Lock()
+
+    def worker():
+        while True:
+            with lock:
+                if not pending:
+                    return
+                job = pending.pop(0)
+
+            job.run(opts)
+
+            with lock:
+                print('%-4s %-36s %7.1fs' % (
+                    job.passed() and 'ok' or 'FAIL', job.name, job.seconds))
+                sys.stdout.flush()
+
+    threads = [threading.Thread(target=worker) for i in range(opts.jobs)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+
+def writeJUnit(filename, jobs, seconds):
+    failures = [job for job in jobs if not job.passed()]
+
+    f = open(filename, 'w')
+    f.write('<?xml version="1.0" encoding="UTF-8"?>\n')
+    f.write('<testsuite name="thundercracker" tests="%d" failures="%d" time="%.2f">\n' % (
+        len(jobs), len(failures), seconds))
+
+    for job in jobs:
+        classname, _, name = job.name.rpartition('/')
+        f.write('  <testcase classname=%s name=%s time="%.2f">\n' % (
+            quoteattr(classname.replace('/', '.')), quoteattr(name), job.seconds))
+        if not job.passed():
+            f.write('    <failure message=%s/>\n' % quoteattr(
+                'make exited with status %d' % job.status))
+        f.write('    <system-out>%s</system-out>\n' % escape(job.output))
+        f.write('  </testcase>\n')
+
+    f.write('</testsuite>\n')
+    f.close()
+
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] [TEST ...]')
+    parser.add_option('-j', '--jobs', type='int', default=multiprocessing.cpu_count(),
+                      help='number of tests to run at once (default: one per CPU)')
+    parser.add_option('--junit', metavar='FILE',
+                      help='write a JUnit XML report to FILE')
+    parser.add_option('--gdb-port-base', type='int', metavar='PORT', default=0,
+                      help='give each test a GDB server port, starting at PORT')
+    opts, args = parser.parse_args()
+    opts.jobs = max(1, opts.jobs)
+
+    names = args or listTests()
+    jobs = [TestJob(name, i) for i, name in enumerate(names)]
+
+    start = time.time()
+    runAll(jobs, opts)
+    seconds = time.time() - start
+
+    failures = [job for job in jobs if not job.passed()]
+    for job in failures:
+        print('\n================= Output of failed test: %s\n' % job.name)
+        print(job.output)
+
+    print('\n%d of %d tests passed in %.1fs' % (
+        len(jobs) - len(failures), len(jobs), seconds))
+
+    if opts.junit:
+        writeJUnit(opts.junit, jobs, seconds)
+
+    return failures and 1 or 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,135 @@
+#include <sifteo/arena.h>
+#include <sifteo/array.h>
+#include <sifteo/cube.h>
+#include <sifteo/video/tilebuffer.h>
+using namespace Sifteo;
+
+struct Item {
+    int a, b;
+};
+
+void arenaBasics()
+{
+    Arena<64> arena;
+
+    ASSERT(arena.capacity() == 64);
+    ASSERT(arena.used() == 0);
+
+    uint8_t *b = static_cast<uint8_t*>(arena.alloc(3, 1));
+    ASSERT(b != 0);
+    ASSERT(arena.contains(b));
+    ASSERT(arena.used() == 3);
+
+    // Alignment padding
+    uint32_t *w = arena.alloc<uint32_t>();
+    ASSERT((reinterpret_cast<uintptr_t>(w) & 3) == 0);
+    ASSERT(arena.used() == 8);
+
+    uint64_t *q = arena.alloc<uint64_t>();
+    ASSERT((reinterpret_cast<uintptr_t>(q) & 7) == 0);
+    ASSERT(arena.used() == 16);
+
+    // Exhaustion leaves the arena alone
+    ASSERT(arena.allocArray<Item>(7) == 0);
+    ASSERT(arena.used() == 16);
+    Item *items = arena.allocArray<Item>(6);
+    ASSERT(items != 0);
+    ASSERT(arena.remaining() == 0);
+    ASSERT(arena.alloc(1, 1) == 0);
+    ASSERT(arena.allocArray<Item>(0x40000000) == 0);
+
+    arena.reset();
+    ASSERT(arena.used() == 0);
+    ASSERT(arena.alloc(64) == b);
+}
+
+void arenaScopes()
+{
+    Arena<256> arena;
+    arena.alloc(12);
+    unsigned base = arena.used();
+
+    {
+        ArenaScope<256> outer(arena);
+        arena.alloc(100);
+        {
+            ArenaScope<256> inner(arena);
+            arena.alloc(100);
+            ASSERT(arena.used() > 200);
+        }
+        ASSERT(arena.used() == base + 100);
+    }
+    ASSERT(arena.used() == base);
+
+    Arena<256>::Marker m = arena.mark();
+    arena.alloc(50);
+    arena.rewind(m);
+    ASSERT(arena.used() == base);
+}
+
+void arenaContainers()
+{
+    Arena<1024> arena;
+    ArenaScope<1024> frame(arena);
+
+    Array<Item, 8> *list = arena.alloc< Array<Item, 8> >();
+    list->clear();
+    Item i = { 1, 2 };
+    list->append(i);
+    ASSERT(list->count() == 1);
+    ASSERT((*list)[0].b == 2);
+
+    TileBuffer<4, 4> *buffer = arena.alloc< TileBuffer<4, 4> >();
+    buffer->init();
+    buffer->setCube(0);
+    ASSERT(buffer->tileWidth() == 4);
+    ASSERT(buffer->sys.image.pData == reinterpret_cast<uint32_t>(&buffer->tiles[0]));
+}
+
+void poolBasics()
+{
+    Pool<Item, 4> pool;
+
+    ASSERT(pool.capacity() == 4);
+    ASSERT(pool.empty());
+
+    Item *p[4];
+    for (unsigned i = 0; i < 4; ++i) {
+        p[i] = pool.alloc();
+        ASSERT(p[i] != 0);
+        ASSERT(pool.indexOf(p[i]) == i);
+        p[i]->a = i;
+    }
+    ASSERT(pool.full());
+    ASSERT(pool.alloc() == 0);
+
+    // Freed objects are reused, most recent first
+    pool.free(p[1]);
+    pool.free(p[3]);
+    ASSERT(pool.count() == 2);
+    ASSERT(pool.alloc() == p[3]);
+    ASSERT(pool.alloc() == p[1]);
+    ASSERT(pool.alloc() == 0);
+
+    // Untouched objects survive
+    ASSERT(p[0]->a == 0);
+    ASSERT(p[2]->a == 2);
+
+    Item other;
+    ASSERT(!pool.contains(&other));
+    ASSERT(!pool.contains(reinterpret_cast<Item*>(reinterpret_cast<uint8_t*>(p[0]) + 1)));
+
+    pool.reset();
+    ASSERT(pool.empty());
+    ASSERT(pool.alloc() == p[0]);
+}
+
+void main()
+{
+    arenaBasics();
+    arenaScopes();
+    arenaContainers();
+    poolBasics();
+
+    LOG("Success.\n");
+}
@@ -312,6 +312,76 @@ void rangeBitIter()
     ASSERT(br7.words[0] == 0xf0000000);
 }
 
+void eraseUnorderedAndBulkAppend()
+{
+    static const uint16_t src[] = { 20, 21, 22 };
+
+    Array<uint16_t, 6, uint8_t> a;
+    a.append(ob(10));
+    a.append(src, ob(3u));
+    ASSERT(4 == a.count());
+    ASSERT(10 == a[0]);
+    ASSERT(22 == a[3]);
+
+    a.erase_unordered(ob(0u));  // 22 moves into slot 0
+    ASSERT(3 == a.count());
+    ASSERT(22 == a[0]);
+    ASSERT(20 == a[1]);
+    ASSERT(21 == a[2]);
+
+    a.erase_unordered(ob(2u));  // Last element, nothing moves
+    ASSERT(2 == a.count());
+    ASSERT(22 == a[0]);
+    ASSERT(20 == a[1]);
+
+    a.erase_unordered(a.find(ob(99)));
+    ASSERT(2 == a.count());
+}
+
+void bitArrayRangeOps()
+{
+    BitArray<32> a;
+    a.mark(ob(4u), ob(8u));
+    ASSERT(a.words[0] == 0x0f000000);
+    a.clear(ob(5u), ob(7u));
+    ASSERT(a.words[0] == 0x09000000);
+
+    BitArray<80> b;
+    b.mark(ob(30u), ob(70u));
+    ASSERT(b.words[0] == 0x00000003);
+    ASSERT(b.words[1] == 0xffffffff);
+    ASSERT(b.words[2] == 0xfc000000);
+    ASSERT(b.count() == 40);
+    ASSERT(b == BitArray<80>(30, 70));
+
+    b.clear(ob(31u), ob(65u));
+    ASSERT(b.words[0] == 0x00000002);
+    ASSERT(b.words[1] == 0x00000000);
+    ASSERT(b.words[2] == 0x7c000000);
+
+    b.mark(ob(10u), ob(10u));
+    ASSERT(b.count() == 6);
+
+    unsigned index;
+    ASSERT(b.findFirst(index, ob(0u), ob(80u)) && index == 30);
+    ASSERT(b.findFirst(index, ob(31u), ob(80u)) && index == 65);
+    ASSERT(!b.findFirst(index, ob(31u), ob(65u)));
+    ASSERT(b.findFirst(index, ob(66u), ob(70u)) && index == 66);
+    ASSERT(!b.findFirst(index, ob(70u), ob(80u)));
+
+    BitArray<80> c(60, 75);
+    BitArray<80> d = b;
+    d &= c;
+    ASSERT(d == (b & c));
+    ASSERT(d.count() == 5);
+    d = b;
+    d |= c;
+    ASSERT(d == (b | c));
+    d ^= c;
+    ASSERT(d != b);
+    ASSERT(d == (b & ~c));
+}
+
 void main()
 {
     arrayOfObjects();
@@ -325,6 +395,8 @@ void main()
     bitArrayIter();
     rangeArrayIter();
     rangeBitIter();
+    eraseUnorderedAndBulkAppend();
+    bitArrayRangeOps();
     
     LOG("Success.\n");
 }
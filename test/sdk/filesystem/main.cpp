@@ -226,6 +226,73 @@ void testFsInfo()
     ASSERT(info.selfElfUnits == fi.selfElfUnits());
 }
 
+void testRepeatedReads()
+{
+    LOG("Testing repeated object reads\n");
+
+    StoredObject key = StoredObject::allocate();
+    uint32_t value = 0;
+
+    // Missing keys stay missing, until written
+    ASSERT(0 == key.read(value));
+    ASSERT(0 == key.read(value));
+
+    for (unsigned i = 0; i < 10; ++i) {
+        ASSERT(sizeof value == key.write(i));
+
+        // Repeat reads, with exact and oversized buffers. Oversized reads
+        // see the object padded out to a whole allocation unit.
+        for (unsigned j = 0; j < 4; ++j) {
+            uint32_t longValue[4] = { 0 };
+            value = -1;
+            ASSERT(sizeof value == key.read(value));
+            ASSERT(value == i);
+            ASSERT(sizeof longValue == key.read(longValue));
+            ASSERT(longValue[0] == i);
+            ASSERT(longValue[3] == 0xFFFFFFFF);
+        }
+    }
+
+    // Erasing a cached key
+    ASSERT(0 == key.erase());
+    ASSERT(0 == key.read(value));
+}
+
+void testPrefetch()
+{
+    LOG("Testing object prefetch\n");
+
+    StoredObject keys[3] = {
+        StoredObject::allocate(),
+        StoredObject::allocate(),
+        StoredObject::allocate(),
+    };
+    uint32_t value;
+
+    ASSERT(sizeof value == keys[0].write(100));
+    ASSERT(sizeof value == keys[2].write(102));
+
+    // Prefetching never changes what we read
+    StoredObject::prefetch(keys, arraysize(keys));
+    ASSERT(sizeof value == keys[0].read(value) && value == 100);
+    ASSERT(0 == keys[1].read(value));
+    ASSERT(sizeof value == keys[2].read(value) && value == 102);
+
+    // Writes after a prefetch are still seen
+    keys[1].prefetch();
+    ASSERT(sizeof value == keys[1].write(101));
+    ASSERT(sizeof value == keys[1].read(value) && value == 101);
+
+    // Prefetching keys that are already known is harmless
+    ASSERT(0 == StoredObject::prefetch(keys, arraysize(keys)));
+    ASSERT(sizeof value == keys[1].read(value) && value == 101);
+
+    for (unsigned i = 0; i < arraysize(keys); ++i)
+        ASSERT(0 == keys[i].erase());
+    StoredObject::prefetch(keys, arraysize(keys));
+    ASSERT(0 == keys[0].read(value));
+}
+
 void main()
 {
     // Initialization
@@ -253,5 +320,9 @@ void main()
     // Test _SYS_fs_info() a bit
     testFsInfo();
 
+    // Reads that should be served from the LFS key cache
+    testRepeatedReads();
+    testPrefetch();
+
     LOG("Success.\n");
 }
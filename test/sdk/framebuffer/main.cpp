@@ -0,0 +1,120 @@
+#include <sifteo.h>
+using namespace Sifteo;
+
+/*
+ * The word-packing span, fill and bitmap paths are checked against a
+ * reference built one pixel at a time with plot(), in a second
+ * VideoBuffer. Neither buffer is attached to a cube.
+ */
+
+static VideoBuffer vidFast, vidRef;
+static Random rng(1234);
+static uint8_t bitmapData[32 * 16];
+
+static unsigned randint(unsigned limit)
+{
+    return rng.raw() % limit;
+}
+
+static void compare()
+{
+    for (unsigned i = 0; i < _SYS_VRAM_WORDS; ++i)
+        ASSERT(vidFast.sys.vbuf.vram.words[i] == vidRef.sys.vbuf.vram.words[i]);
+}
+
+static unsigned bitmapPixel(unsigned bpp, const uint8_t *data, unsigned x)
+{
+    unsigned bit = x * bpp;
+    return (data[bit / 8] >> (bit % 8)) & ((1 << bpp) - 1);
+}
+
+template <typename T>
+static void testMode(VideoMode mode, T &fast, T &ref)
+{
+    vidFast.initMode(mode);
+    vidRef.initMode(mode);
+    fast.fill(0);
+    ref.fill(0);
+
+    const unsigned bpp = T::bitsPerPixel();
+
+    for (unsigned iter = 0; iter < 200; ++iter) {
+        UInt2 pos = vec(randint(T::width()), randint(T::height()));
+        UInt2 size = vec(1 + randint(T::width() - pos.x),
+                         1 + randint(T::height() - pos.y));
+        unsigned color = randint(T::numColors());
+
+        switch (randint(3)) {
+
+            case 0:
+                fast.span(pos, size.x, color);
+                for (unsigned x = 0; x < size.x; ++x)
+                    ref.plot(vec(pos.x + x, pos.y), color);
+                break;
+
+            case 1:
+                fast.fill(pos, size, color);
+                for (unsigned y = 0; y < size.y; ++y)
+                    for (unsigned x = 0; x < size.x; ++x)
+                        ref.plot(vec(pos.x + x, pos.y + y), color);
+                break;
+
+            case 2: {
+                unsigned stride = 1 + randint(8);
+                size.y = MIN(size.y, sizeof bitmapData / stride);
+                size.x = MIN(size.x, stride * 8 / bpp);
+                for (unsigned i = 0; i < sizeof bitmapData; ++i)
+                    bitmapData[i] = rng.raw();
+
+                fast.bitmap(pos, size, bitmapData, stride);
+                for (unsigned y = 0; y < size.y; ++y)
+                    for (unsigned x = 0; x < size.x; ++x)
+                        ref.plot(vec(pos.x + x, pos.y + y),
+                            bitmapPixel(bpp, bitmapData + y * stride, x));
+                break;
+            }
+        }
+
+        compare();
+    }
+
+    // Full-width fills take their own path
+    fast.fill(vec(0U, 1U), vec(T::width(), 3U), 1);
+    for (unsigned y = 1; y < 4; ++y)
+        for (unsigned x = 0; x < T::width(); ++x)
+            ref.plot(vec(x, y), 1);
+    compare();
+}
+
+static void testAffine()
+{
+    // Fixed-point matrices pack to the same words as the float version
+    AffineMatrix fm = AffineMatrix::identity();
+    fm.translate(12.5f, 3.25f);
+    fm.scale(2.0f);
+
+    FixedAffineMatrix xm = FixedAffineMatrix::identity();
+    xm.translate(FixedVec2::create(Fixed16::fromFloat(12.5f), Fixed16::fromFloat(3.25f)));
+    xm.scale(Fixed16::fromFloat(0.5f));
+
+    vidFast.initMode(BG2);
+    vidRef.initMode(BG2);
+    vidFast.bg2.setMatrix(xm);
+    vidRef.bg2.setMatrix(fm);
+    compare();
+
+    _SYSAffine a = BG2Drawable::packMatrix(FixedAffineMatrix::rotation(2048));
+    ASSERT(a.cx == 0 && a.cy == 0);
+    ASSERT(a.xx == 0 && a.yy == 0);
+    ASSERT(a.xy == 256 && a.yx == -256);
+}
+
+void main()
+{
+    testMode(FB32, vidFast.fb32, vidRef.fb32);
+    testMode(FB64, vidFast.fb64, vidRef.fb64);
+    testMode(FB128, vidFast.fb128, vidRef.fb128);
+    testAffine();
+
+    LOG("Success.\n");
+}
@@ -253,6 +253,18 @@ void testTrigTables()
     ASSERT(tcosi(-0x1daa) == 0xe58b);
     ASSERT(tcosi(0xffb) == -0x10000);
 
+    int angles[64];
+    Int2 unit[64];
+    FixedVec2 fixedUnit[64];
+    for (unsigned i = 0; i < arraysize(angles); ++i)
+        angles[i] = b(int(i * 0x1f3 - 0x2000));
+    tsincosi(unit, angles, arraysize(angles));
+    fsincos(fixedUnit, angles, arraysize(angles));
+    for (unsigned i = 0; i < arraysize(angles); ++i) {
+        ASSERT(unit[i] == vec(tcosi(angles[i]), tsini(angles[i])));
+        ASSERT(fixedUnit[i].x.raw == unit[i].x && fixedUnit[i].y.raw == unit[i].y);
+    }
+
     for (unsigned i = 0; i < 10000; ++i) {
         float r = i * 0.001f;
         ASSERT(almostEqual(sin(r), tsin(r), 1e-3f));
@@ -260,6 +272,74 @@ void testTrigTables()
     }
 }
 
+void testFixed()
+{
+    /*
+     * Fixed-point arithmetic, rounding, and batch transforms
+     */
+
+    Fixed16 half = Fixed16::fromRaw(b(0x8000));
+    Fixed16 three = Fixed16::fromInt(b(3));
+
+    ASSERT((three * half).raw == 0x18000);
+    ASSERT((-three * half).raw == -0x18000);
+    ASSERT((-three * -half).raw == 0x18000);
+    ASSERT((three * three).floor() == 9);
+    ASSERT((Fixed16::fromRaw(b(-0x12345)) * Fixed16::fromRaw(b(0x23456))).raw == -0x28216);
+    ASSERT((Fixed16::fromRaw(b(0x7fff1234)) * Fixed16::fromRaw(b(0x10000))).raw == 0x7fff1234);
+
+    ASSERT((three + half).round() == 4);
+    ASSERT((-three - half).round() == -3);
+    ASSERT((-three - half).floor() == -4);
+    ASSERT((-three - half).ceil() == -3);
+    ASSERT((-three - half).frac() == half);
+    ASSERT(Fixed8::fromFixed(three + half).raw == 0x380);
+    ASSERT(Fixed16::fromFloat(b(1.25f)).raw == 0x14000);
+    ASSERT(almostEqual(Fixed16::fromRaw(b(0x14000)).toFloat(), 1.25f, 1e-6f));
+
+    Fixed8 a8 = Fixed8::fromRaw(b(-0x1234));
+    ASSERT((a8 * Fixed8::fromRaw(b(0x280))).raw == -0x2d82);
+
+    ASSERT(fsin(b(0x800)).raw == 0x10000);
+    ASSERT(fcos(b(0x800)).raw == 0);
+
+    FixedVec2 v = FixedVec2::fromInt(vec(b(10), b(-4)));
+    ASSERT(v.rotate(b(0x800)).round() == vec(4, 10));
+    ASSERT(dot(v, v).floor() == 116);
+
+    FixedAffineMatrix m = FixedAffineMatrix::translation(FixedVec2::fromInt(vec(b(100), b(50))));
+    m.rotate(b(0x1000));
+    m.scale(half);
+
+    FixedVec2 points[3];
+    points[0] = FixedVec2::fromInt(vec(b(0), b(0)));
+    points[1] = FixedVec2::fromInt(vec(b(8), b(0)));
+    points[2] = FixedVec2::fromInt(vec(b(-6), b(2)));
+
+    Int2 rounded[3];
+    transformPoints(m, points, rounded, 3);
+    ASSERT(rounded[0] == vec(100, 50));
+    ASSERT(rounded[1] == vec(96, 50));
+    ASSERT(rounded[2] == vec(103, 49));
+
+    FixedVec2 expected[3];
+    for (unsigned i = 0; i < 3; ++i)
+        expected[i] = m.transform(points[i]);
+
+    transformPoints(m, points, points, 3);
+    for (unsigned i = 0; i < 3; ++i) {
+        ASSERT(points[i] == expected[i]);
+        ASSERT(points[i].round() == rounded[i]);
+    }
+
+    for (int angle = 0; angle < 8192; angle += 97) {
+        Float2 f = vec(12.5f, -3.25f).rotate(angle * float(M_TAU / 8192));
+        Float2 g = FixedVec2::fromFloat(vec(12.5f, -3.25f)).rotate(angle).toFloat();
+        ASSERT(almostEqual(f.x, g.x, 1e-2f));
+        ASSERT(almostEqual(f.y, g.y, 1e-2f));
+    }
+}
+
 void main()
 {
     testClamp();
@@ -272,6 +352,7 @@ void main()
     testBits();
     testTrig();
     testTrigTables();
+    testFixed();
 
     LOG("Success.\n");
 }
\ No newline at end of file
@@ -41,6 +41,66 @@ static void testTileBuffer()
     SCRIPT(LUA, util:assertScreenshot(cube, 'test0'));
 }
 
+static void testDirtyFlush()
+{
+    /*
+     * flush() copies only what changed since the last flush, and
+     * leaves the buffer clean.
+     */
+
+    vid.initMode(BG0);
+    vid.bg0.erase(0);
+
+    TileBuffer<4, 3> tb(cube);
+    tb.erase(1);
+    ASSERT(tb.isDirty());
+    tb.flush(vid.bg0, vec(2, 5));
+    ASSERT(!tb.isDirty());
+
+    for (unsigned y = 0; y < 3; ++y)
+        for (unsigned x = 0; x < 4; ++x)
+            ASSERT(vid.bg0.tile(vec(x + 2, y + 5)) == 1);
+    ASSERT(vid.bg0.tile(vec(1, 5)) == 0);
+    ASSERT(vid.bg0.tile(vec(6, 5)) == 0);
+
+    // Plotting the same value again leaves the buffer clean
+    tb.plot(vec(1, 1), 1);
+    ASSERT(!tb.isDirty());
+
+    /*
+     * Change one tile in the buffer and a different one behind its back
+     * on BG0. Only the first gets written; the second is left alone.
+     */
+
+    tb.plot(vec(1, 1), 7);
+    vid.bg0.plot(vec(2, 5), 9);
+    ASSERT(tb.isDirty());
+    tb.flush(vid.bg0, vec(2, 5));
+    ASSERT(!tb.isDirty());
+    ASSERT(vid.bg0.tile(vec(3, 6)) == 7);
+    ASSERT(vid.bg0.tile(vec(2, 5)) == 9);
+
+    // markDirty() forces a full copy
+    tb.markDirty();
+    tb.flush(vid.bg0, vec(2, 5));
+    ASSERT(vid.bg0.tile(vec(2, 5)) == 1);
+    ASSERT(vid.bg0.tile(vec(3, 6)) == 7);
+
+    // Spans on adjacent rows, merged into one op
+    tb.span(vec(0, 1), 4, 3U);
+    tb.span(vec(0, 2), 4, 4U);
+    TileBuffer<18, 2> wide(cube);
+    wide.erase(5);
+    wide.flush(vid.bg0, vec(0, 10));
+    tb.flush(vid.bg0, vec(2, 5));
+    for (unsigned x = 0; x < 4; ++x) {
+        ASSERT(vid.bg0.tile(vec(x + 2, 6)) == 3);
+        ASSERT(vid.bg0.tile(vec(x + 2, 7)) == 4);
+    }
+    for (unsigned x = 0; x < 18; ++x)
+        ASSERT(vid.bg0.tile(vec(x, 10)) == 5 && vid.bg0.tile(vec(x, 11)) == 5);
+}
+
 void main()
 {
     // Bootstrapping that would normally be done by the Launcher
@@ -63,6 +123,7 @@ void main()
     );
 
     testTileBuffer();
+    testDirtyFlush();
 
     LOG("Success.\n");
 }
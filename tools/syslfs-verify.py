@@ -19,6 +19,7 @@ NUM_TOTAL_ASSET_SLOTS   = NUM_PAIRINGS * ASSET_SLOTS_PER_CUBE
 NUM_FAULTS              = 16
 
 # Keys
+kPairingHints   = 0x0d
 kFaultBase      = 0x16
 kPairingMRU     = kFaultBase + NUM_FAULTS
 kPairingID      = kPairingMRU + 1
@@ -48,6 +49,9 @@ def keyDetail(key):
     Return a string suitable for printing that describes the given key
     """
 
+    if key == kPairingHints:
+        return "0x%x - PairingHints key" % key
+
     if key < kFaultBase:
         return "0x%x - reserved key  " % key
 
@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+
+#
+# Convert a binary cube trace (trace.bin, from siftulator -B) into the
+# same trace.vcd and trace.txt files that siftulator writes when tracing
+# in its normal text mode.
+#
+# usage: trace-convert.py trace.bin [trace.vcd] [trace.txt]
+#
+# See emulator/src/tracewriter.h for a description of the file format.
+#
+
+import sys, struct, zlib
+
+FILE_HEADER_FORMAT = "<QIIII"
+RECORD_FORMAT = "<BBHIQ"
+CHUNK_HEADER_FORMAT = "<II"
+
+MAGIC = 0x4352547974666953
+VERSION = 1
+
+T_SIGNAL = 0
+T_TEXT = 1
+T_CLOCK = 2
+
+
+def readChunks(f):
+    """Yield each decompressed chunk of records"""
+    headerSize = struct.calcsize(CHUNK_HEADER_FORMAT)
+    while True:
+        header = f.read(headerSize)
+        if len(header) < headerSize:
+            return
+        rawSize, compressedSize = struct.unpack(CHUNK_HEADER_FORMAT, header)
+        data = zlib.decompress(f.read(compressedSize))
+        if len(data) != rawSize:
+            raise ValueError("corrupted trace chunk")
+        yield data
+
+
+def convert(inFile, vcdFile, textFile):
+    f = open(inFile, 'rb')
+
+    magic, version, vcdHeaderSize, signalTableSize, reserved = struct.unpack(
+        FILE_HEADER_FORMAT, f.read(struct.calcsize(FILE_HEADER_FORMAT)))
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a binary trace file, or unsupported version")
+
+    vcd = open(vcdFile, 'w')
+    text = open(textFile, 'w')
+    vcd.write(f.read(vcdHeaderSize).decode('ascii'))
+
+    signals = []
+    for line in f.read(signalTableSize).decode('ascii').splitlines():
+        bits, identifier = line.split()
+        signals.append((int(bits), identifier))
+
+    # Signal values start out as all ones, just like VCDWriter
+    values = [(1 << 64) - 1] * len(signals)
+    recordSize = struct.calcsize(RECORD_FORMAT)
+    clock = 0
+    vcdTick = None
+
+    for chunk in readChunks(f):
+        offset = 0
+        while offset < len(chunk):
+            rtype, cube, signal, clockDelta, value = struct.unpack_from(
+                RECORD_FORMAT, chunk, offset)
+            offset += recordSize
+            clock += clockDelta
+
+            if rtype == T_CLOCK:
+                clock = value
+
+            elif rtype == T_TEXT:
+                padded = (value + recordSize - 1) // recordSize * recordSize
+                line = chunk[offset : offset + value].decode('ascii', 'replace')
+                offset += padded
+                text.write("[%02d t=%d] %s\n" % (cube, clock, line))
+
+            elif rtype == T_SIGNAL:
+                values[signal] ^= value
+                bits, identifier = signals[signal]
+                if clock != vcdTick:
+                    vcd.write("#%d\n" % clock)
+                    vcdTick = clock
+                binary = bin(values[signal] & ((1 << bits) - 1))[2:].zfill(bits)
+                if bits > 1:
+                    vcd.write("b%s %s\n" % (binary, identifier))
+                else:
+                    vcd.write("%s %s\n" % (binary, identifier))
+
+            else:
+                raise ValueError("unknown record type %d" % rtype)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.stderr.write("usage: %s trace.bin [trace.vcd] [trace.txt]\n" % sys.argv[0])
+        sys.exit(1)
+
+    args = sys.argv[1:] + ['trace.vcd', 'trace.txt'][len(sys.argv) - 2:]
+    convert(*args[:3])
@@ -46,16 +46,34 @@
  *
  * This uses a simple algorithm that always makes forward progress. The
  * required 16-bit instruction opening prior to an otherwise-unaligned 32-bit
- * instruction is termed an "align slot". We scan forward (never backward) to
- * find a candidate instruction to move into the align slot. We never cross
- * a funtion call, syscall, or basic block boundary, and we keep track of
- * register dependencies. If no candidate instruction can be found, we give
- * up and insert a no-op.
+ * instruction is termed an "align slot". We scan forward to find a candidate
+ * instruction to move into the align slot, then backward over the 16-bit
+ * instructions since the last aligned point. We never cross a funtion call,
+ * syscall, or basic block boundary, and we keep track of register
+ * dependencies. If no candidate instruction can be found, we give up and
+ * insert a no-op.
+ *
+ * We also weigh MOVWi16 against LDRpc here, since only now do we know the
+ * real cost of each. Every 16-bit instruction costs the interpreter about
+ * the same to execute, and a literal load never leaves the current flash
+ * block. So:
+ *
+ *   - A MOVWi16 that would need a no-op costs 6 bytes and two instructions.
+ *     An LDRpc costs at most the same 6 bytes (2 plus a 4-byte literal),
+ *     but only one instruction. Always use the LDRpc.
+ *
+ *   - An aligned MOVWi16 costs 4 bytes. An LDRpc whose literal is already
+ *     in this function's constant pool costs 2. Use it when we can.
  */
 
+#define DEBUG_TYPE "svm-align"
 #include "SVM.h"
 #include "SVMTargetMachine.h"
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineConstantPool.h"
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
@@ -63,6 +81,10 @@
 #include "llvm/CodeGen/MachineFunctionPass.h"
 using namespace llvm;
 
+STATISTIC(NumNopsInserted, "Number of align slots filled with a no-op");
+STATISTIC(NumBackwardFills, "Number of align slots filled from earlier instructions");
+STATISTIC(NumLiteralLoads, "Number of MOVWi16 instructions turned into LDRpc");
+
 namespace {
 
     class SVMAlignPass : public MachineFunctionPass {
@@ -86,6 +108,13 @@ namespace {
 
         MachineBasicBlock::iterator findAlignSlotFiller(
             MachineBasicBlock &MBB, MachineBasicBlock::iterator I);
+        MachineBasicBlock::iterator findPriorAlignSlotFiller(
+            MachineBasicBlock &MBB, MachineBasicBlock::iterator I);
+        bool isFillerCandidate(const MachineInstr &MI);
+
+        int findLiteral(MachineFunction &MF, const MachineInstr &MI);
+        MachineBasicBlock::iterator convertToLiteralLoad(
+            MachineBasicBlock &MBB, MachineBasicBlock::iterator I, int CPI);
 
         bool isRegInSet(RegSet_t &RegSet, unsigned Reg);
         void insertRegDefsUses(const MachineInstr &MI,
@@ -132,20 +161,43 @@ bool SVMAlignPass::runOnMachineBasicBlock(MachineBasicBlock &MBB)
         int Size = Desc.getSize();
         assert(Size == 0 || Size == 2 || Size == 4);
         
+        if (Size == 4 && I->getOpcode() == SVM::MOVWi16 && I->getOperand(1).isImm()) {
+            // Already have this value as a literal? A 16-bit load is cheaper.
+            int CPI = findLiteral(*MBB.getParent(), *I);
+            if (CPI >= 0) {
+                I = convertToLiteralLoad(MBB, I, CPI);
+                Size = 2;
+                Changed = true;
+            }
+        }
+
         if (Size == 4 && (halfwordCount & 1)) {
             // This is an align slot. Fill it! (And count the filler instruction)
             MachineBasicBlock::iterator D = findAlignSlotFiller(MBB, I);
-            
             if (D == MBB.end()) {
-                BuildMI(MBB, I, I->getDebugLoc(), TII.get(SVM::NOP));
-            } else {
+                D = findPriorAlignSlotFiller(MBB, I);
+                if (D != MBB.end())
+                    ++NumBackwardFills;
+            }
+
+            if (D != MBB.end()) {
                 assert(D->getDesc().getSize() == 2);
                 MBB.splice(I, &MBB, D);
+                halfwordCount++;
+
+            } else if (I->getOpcode() == SVM::MOVWi16 && I->getOperand(1).isImm()) {
+                // A literal load costs no more space than MOVW plus NOP
+                I = convertToLiteralLoad(MBB, I, -1);
+                Size = 2;
+
+            } else {
+                BuildMI(MBB, I, I->getDebugLoc(), TII.get(SVM::NOP));
+                ++NumNopsInserted;
+                halfwordCount++;
             }
             
             Changed = true;
-            halfwordCount++;
-            assert((halfwordCount & 1) == 0);
+            assert(Size == 2 || (halfwordCount & 1) == 0);
 
         } else if ((I->getOpcode() == SVM::CALL || I->getOpcode() == SVM::CALLr)
             && !(halfwordCount & 1)) {
@@ -251,9 +303,7 @@ MachineBasicBlock::iterator SVMAlignPass::findAlignSlotFiller(
             break;
 
         // Can this instruction be a filler?
-        if (!I->isDebugValue() && Desc.getSize() == 2 &&
-            !Desc.mayLoad() && !Desc.mayStore() &&
-            !hasRegHazard(*I, RegDefs, RegUses))
+        if (isFillerCandidate(*I) && !hasRegHazard(*I, RegDefs, RegUses))
             return I;
 
         insertRegDefsUses(*I, RegDefs, RegUses);
@@ -261,3 +311,88 @@ MachineBasicBlock::iterator SVMAlignPass::findAlignSlotFiller(
 
     return MBB.end();
 }
+
+MachineBasicBlock::iterator SVMAlignPass::findPriorAlignSlotFiller(
+    MachineBasicBlock &MBB, MachineBasicBlock::iterator I)
+{
+    /*
+     * Look backwards from the align slot at 'I' for an instruction we can
+     * move down into it. Everything we pass over moves up by one halfword,
+     * so we can only pass over plain 16-bit instructions. Anything with
+     * alignment needs of its own ends the search, as does anything the
+     * forward search wouldn't cross.
+     */
+
+    RegSet_t RegDefs, RegUses;
+
+    while (I != MBB.begin()) {
+        --I;
+        const MCInstrDesc &Desc = I->getDesc();
+
+        if (I->isDebugValue())
+            continue;
+
+        if (Desc.getSize() != 2 || I->getOpcode() == SVM::NOP ||
+            I->hasUnmodeledSideEffects() || I->isInlineAsm() ||
+            I->isLabel() || Desc.isCall() || Desc.isBranch() || Desc.isReturn())
+            break;
+
+        if (isFillerCandidate(*I) && !hasRegHazard(*I, RegDefs, RegUses))
+            return I;
+
+        insertRegDefsUses(*I, RegDefs, RegUses);
+    }
+
+    return MBB.end();
+}
+
+bool SVMAlignPass::isFillerCandidate(const MachineInstr &MI)
+{
+    const MCInstrDesc &Desc = MI.getDesc();
+    return !MI.isDebugValue() && Desc.getSize() == 2 &&
+        !Desc.mayLoad() && !Desc.mayStore();
+}
+
+int SVMAlignPass::findLiteral(MachineFunction &MF, const MachineInstr &MI)
+{
+    // Index of a constant pool entry that already holds MI's immediate, or -1.
+
+    const MachineConstantPool *MCP = MF.getConstantPool();
+    const std::vector<MachineConstantPoolEntry> &CP = MCP->getConstants();
+    uint64_t Value = MI.getOperand(1).getImm();
+
+    for (unsigned i = 0, e = CP.size(); i != e; ++i) {
+        if (CP[i].isMachineConstantPoolEntry())
+            continue;
+        const ConstantInt *CI = dyn_cast<ConstantInt>(CP[i].Val.ConstVal);
+        if (CI && CI->getBitWidth() == 32 && CI->getZExtValue() == Value)
+            return i;
+    }
+
+    return -1;
+}
+
+MachineBasicBlock::iterator SVMAlignPass::convertToLiteralLoad(
+    MachineBasicBlock &MBB, MachineBasicBlock::iterator I, int CPI)
+{
+    // Replace a MOVWi16 with an LDRpc, adding a constant pool entry if needed
+
+    MachineFunction &MF = *MBB.getParent();
+    const TargetInstrInfo &TII = *TM.getInstrInfo();
+    const MachineOperand &Dest = I->getOperand(0);
+
+    if (CPI < 0) {
+        Type *i32 = Type::getInt32Ty(MF.getFunction()->getContext());
+        CPI = MF.getConstantPool()->getConstantPoolIndex(
+            ConstantInt::get(i32, I->getOperand(1).getImm()), 4);
+    }
+
+    MachineBasicBlock::iterator LDR = BuildMI(MBB, I, I->getDebugLoc(),
+        TII.get(SVM::LDRpc))
+        .addReg(Dest.getReg(), RegState::Define | getDeadRegState(Dest.isDead()))
+        .addConstantPoolIndex(CPI);
+
+    I->eraseFromParent();
+    ++NumLiteralLoads;
+    return LDR;
+}
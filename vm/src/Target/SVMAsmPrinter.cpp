@@ -43,8 +43,19 @@
  * ARMConstantIslandPass, since we already know exactly where the splits go,
  * and we have no BB reshuffing or branch rewriting to take care of at this
  * point.
+ *
+ * By default every function starts a new block. With -pack-functions, a
+ * function that fits entirely in the space left at the end of the previous
+ * function's last block is placed there instead, and the two share that
+ * block's constant pool. Calls between functions in one block then never
+ * leave the flash cache block they started in. This is a simple next-fit
+ * packing in module order, so it works best together with -profile-layout,
+ * which places hot callees right after their callers.
  */
 
+// For metadata key definitions
+#include <sifteo/abi.h>
+
 #include "SVM.h"
 #include "SVMInstrInfo.h"
 #include "SVMTargetMachine.h"
@@ -53,19 +64,146 @@
 #include "SVMAsmPrinter.h"
 #include "SVMConstantPoolValue.h"
 #include "SVMSymbolDecoration.h"
+#include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MCExpr.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Target/TargetLoweringObjectFile.h"
 using namespace llvm;
 
+static cl::opt<bool> PackFunctions("pack-functions",
+    cl::desc("Let small functions share flash blocks"));
+
+static cl::list<std::string> BinaryFiles("binary",
+    cl::desc("Link a raw binary file into read-only data"),
+    cl::value_desc("filename"));
+
 extern "C" void LLVMInitializeSVMAsmPrinter() { 
     RegisterAsmPrinter<SVMAsmPrinter> X(TheSVMTarget);
 }
 
+bool SVMAsmPrinter::runOnMachineFunction(MachineFunction &MF)
+{
+    // Decide before the function header is emitted, while we're still
+    // in the open block's section.
+    PackCurrentFunction = OpenBlockSection && functionFitsInOpenBlock(MF);
+    if (OpenBlockSection && !PackCurrentFunction)
+        closeOpenBlock();
+
+    StackBound.addFunction(MF);
+    return AsmPrinter::runOnMachineFunction(MF);
+}
+
+bool SVMAsmPrinter::doFinalization(Module &M)
+{
+    if (OpenBlockSection)
+        closeOpenBlock();
+
+    // Must happen before the base class emits global variables
+    emitStackBound(M);
+    emitBinaryFiles();
+
+    return AsmPrinter::doFinalization(M);
+}
+
+void SVMAsmPrinter::emitStackBound(Module &M)
+{
+    /*
+     * Now that every function has been emitted, we know the stack bound.
+     * Store it in the _SYS_METADATA_STACK_BYTES placeholder that
+     * MetadataCollector left for us, and publish it as an MC symbol so
+     * the ELF writer can compare it against the RAM left over after data.
+     *
+     * The packed metadata struct starts with (stride, key) pairs, the
+     * last of which has bit 15 set in its stride. After that, values are
+     * the struct-typed members, in key order, separated by i8 padding.
+     */
+
+    uint32_t Bound = StackBound.compute(M);
+    OutContext.GetOrCreateSymbol(StringRef(SVMStackBound::SYMBOL))->setVariableValue(
+        MCConstantExpr::Create(Bound, OutContext));
+
+    GlobalVariable *GV = M.getGlobalVariable(SVMDecorations::META, true);
+    if (!GV || !GV->hasInitializer())
+        return;
+    ConstantStruct *CS = dyn_cast<ConstantStruct>(GV->getInitializer());
+    if (!CS)
+        return;
+
+    unsigned NumOps = CS->getNumOperands();
+    unsigned NumKeys = 0, KeyIndex = ~0U;
+    while (2 * NumKeys + 1 < NumOps) {
+        uint64_t Stride = cast<ConstantInt>(CS->getOperand(2 * NumKeys))->getZExtValue();
+        uint64_t Key = cast<ConstantInt>(CS->getOperand(2 * NumKeys + 1))->getZExtValue();
+        if (Key == _SYS_METADATA_STACK_BYTES)
+            KeyIndex = NumKeys;
+        NumKeys++;
+        if (Stride & 0x8000)
+            break;
+    }
+
+    SmallVector<Constant*, 32> Members;
+    for (unsigned i = 0; i < NumOps; ++i)
+        Members.push_back(CS->getOperand(i));
+
+    for (unsigned i = 2 * NumKeys, Value = 0; i < NumOps; ++i) {
+        if (!Members[i]->getType()->isStructTy())
+            continue;
+        if (Value++ != KeyIndex)
+            continue;
+
+        Constant *Word = ConstantInt::get(Type::getInt32Ty(M.getContext()), Bound);
+        Members[i] = ConstantStruct::getAnon(M.getContext(), Word);
+        assert(Members[i]->getType() == CS->getOperand(i)->getType());
+        GV->setInitializer(ConstantStruct::get(CS->getType(), Members));
+        return;
+    }
+}
+
+void SVMAsmPrinter::emitBinaryFiles()
+{
+    /*
+     * Raw binary inputs go straight into read-only data, without ever
+     * being represented as LLVM constants. This is much faster than
+     * compiling large asset arrays. Like GNU ld's binary input format,
+     * each file is bracketed by _binary_NAME_start and _binary_NAME_end,
+     * where NAME is the file's base name with any non-alphanumeric
+     * characters replaced by underscores.
+     */
+
+    for (unsigned i = 0, e = BinaryFiles.size(); i != e; ++i) {
+        StringRef Filename = BinaryFiles[i];
+        OwningPtr<MemoryBuffer> Buffer;
+        if (error_code ec = MemoryBuffer::getFile(Filename, Buffer))
+            report_fatal_error("Can't read binary file '" + Twine(Filename)
+                + "': " + ec.message());
+
+        std::string Name = "_binary_";
+        StringRef Base = sys::path::filename(Filename);
+        for (unsigned j = 0, je = Base.size(); j != je; ++j)
+            Name += isalnum((unsigned char) Base[j]) ? Base[j] : '_';
+
+        OutStreamer.SwitchSection(getObjFileLowering().getSectionForConstant(
+            SectionKind::getReadOnly()));
+        EmitAlignment(2);
+        OutStreamer.EmitLabel(OutContext.GetOrCreateSymbol(StringRef(Name + "_start")));
+        OutStreamer.EmitBytes(Buffer->getBuffer(), 0);
+        OutStreamer.EmitLabel(OutContext.GetOrCreateSymbol(StringRef(Name + "_end")));
+    }
+}
+
 void SVMAsmPrinter::EmitInstruction(const MachineInstr *MI)
 {
     SVMMCInstLower MCInstLowering(Mang, *MF, *this);
@@ -108,8 +246,18 @@ void SVMAsmPrinter::EmitFunctionEntryLabel()
 {
     OutStreamer.ForceCodeRegion();
 
-    // XXX: For now, all functions start in new blocks
-    emitBlockBegin();
+    // MBB pointers may be recycled between functions
+    CurrentMBB = 0;
+
+    if (PackCurrentFunction) {
+        // Padding after the previous function's terminator is never executed
+        OutStreamer.EmitValueToAlignment(SVMTargetMachine::getBundleSize(),
+            SVMTargetMachine::getPaddingByte());
+        BSA.beginFunction();
+        OpenBlockSection = 0;
+    } else {
+        emitBlockBegin();
+    }
 
     emitFunctionLabelImpl(CurrentFnSym);
 }
@@ -125,8 +273,51 @@ void SVMAsmPrinter::EmitConstantPool()
 
 void SVMAsmPrinter::EmitFunctionBodyEnd()
 {
-    // XXX: For now, all functions end a block
+    if (PackFunctions) {
+        // Leave the block open; the next function may fit in what's left
+        OpenBlockSection = OutStreamer.getCurrentSection();
+    } else {
+        emitBlockEnd();
+    }
+}
+
+void SVMAsmPrinter::closeOpenBlock()
+{
+    assert(OpenBlockSection);
+    OutStreamer.SwitchSection(OpenBlockSection);
     emitBlockEnd();
+    OpenBlockSection = 0;
+}
+
+bool SVMAsmPrinter::functionFitsInOpenBlock(const MachineFunction &MF)
+{
+    /*
+     * Measure the whole function as if it were appended to the open block,
+     * using the same accounting EmitInstruction() will check it against.
+     * Functions that were split across blocks always start a new one.
+     */
+
+    const MCSection *Section = getObjFileLowering().SectionForGlobal(
+        MF.getFunction(), Mang, TM);
+    if (Section != OpenBlockSection)
+        return false;
+
+    SVMBlockSizeAccumulator Trial = BSA;
+    Trial.beginFunction();
+
+    for (MachineFunction::const_iterator MBB = MF.begin(), E = MF.end();
+        MBB != E; ++MBB) {
+        Trial.InstrAlign(MBB->getAlignment());
+
+        for (MachineBasicBlock::const_iterator MI = MBB->begin(), ME = MBB->end();
+            MI != ME; ++MI) {
+            if (MI->getOpcode() == SVM::SPLIT)
+                return false;
+            Trial.AddInstr(MI);
+        }
+    }
+
+    return Trial.getByteCount() <= SVMTargetMachine::getBlockSize();
 }
 
 void SVMAsmPrinter::emitFunctionLabelImpl(MCSymbol *Sym)
@@ -167,6 +358,11 @@ void SVMAsmPrinter::emitBlockSplit(const MachineInstr *MI)
 void SVMAsmPrinter::EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV)
 {
     int Size = TM.getTargetData()->getTypeAllocSize(MCPV->getType());
+    OutStreamer.EmitValue(lowerConstantPoolValue(MCPV), Size);
+}
+
+const MCExpr *SVMAsmPrinter::lowerConstantPoolValue(MachineConstantPoolValue *MCPV)
+{
     const SVMConstantPoolValue *SCPV = static_cast<SVMConstantPoolValue*>(MCPV);
     MCSymbol *MCSym;
 
@@ -197,8 +393,7 @@ void SVMAsmPrinter::EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV)
         break;
     }
     
-    const MCExpr *Expr = MCSymbolRefExpr::Create(MCDecoratedSym, OutContext);
-    OutStreamer.EmitValue(Expr, Size);  
+    return MCSymbolRefExpr::Create(MCDecoratedSym, OutContext);
 }
 
 void SVMAsmPrinter::emitConstRefComment(const MachineOperand &MO)
@@ -249,9 +444,11 @@ void SVMAsmPrinter::rewriteConstForCurrentBlock(const MachineOperand &MO, MCOper
      * new MCSymbolRefExpr referring to the entry that we'll emit later in
      * emitBlockConstPool().
      *
-     * For convenience, we internally unique the per-block CP entries according
-     * to this original MCSymbol, since LLVM has already gone to the trouble to
-     * unique these.
+     * Within a function, LLVM has already gone to the trouble to unique
+     * these, so we key machine-specific entries on the original MCSymbol.
+     * Plain constants are keyed on the Constant itself, which LLVM also
+     * uniques, so that every function packed into this block shares one
+     * copy. This must agree with SVMBlockSizeAccumulator::AddConstantsForInstr.
      */
 
     assert(MO.isCPI());
@@ -262,13 +459,25 @@ void SVMAsmPrinter::rewriteConstForCurrentBlock(const MachineOperand &MO, MCOper
 
     const MCSymbolRefExpr *SRE = dyn_cast<MCSymbolRefExpr>(MCO.getExpr());
     assert(SRE);
-    const MCSymbol *Key = &SRE->getSymbol();
+
+    const MachineConstantPoolEntry &MCPE = CP[MO.getIndex()];
+    const void *Key = MCPE.isMachineConstantPoolEntry()
+        ? (const void*) &SRE->getSymbol() : (const void*) MCPE.Val.ConstVal;
 
     BlockConstPoolTy::iterator I = BlockConstPool.find(Key);
     if (I == BlockConstPool.end()) {
         // Add a new constant to this block's pool
-        CPEInfo Info(OutContext.CreateTempSymbol(), &CP[MO.getIndex()]);
-        I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        MCSymbol *Sym = OutContext.CreateTempSymbol();
+
+        if (MCPE.isMachineConstantPoolEntry()) {
+            MachineConstantPoolValue *MCPV = MCPE.Val.MachineCPVal;
+            CPEInfo Info(Sym, lowerConstantPoolValue(MCPV),
+                TM.getTargetData()->getTypeAllocSize(MCPV->getType()));
+            I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        } else {
+            CPEInfo Info(Sym, MCPE.Val.ConstVal);
+            I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        }
     }
 
     MCO.setExpr(MCSymbolRefExpr::Create(I->second.Symbol, OutContext));
@@ -288,9 +497,9 @@ void SVMAsmPrinter::emitBlockConstPool()
 
         OutStreamer.EmitLabel(Info.Symbol);
 
-        if (Info.MCPE->isMachineConstantPoolEntry())
-            EmitMachineConstantPoolValue(Info.MCPE->Val.MachineCPVal);
+        if (Info.Expr)
+            OutStreamer.EmitValue(Info.Expr, Info.Size);
         else
-            EmitGlobalConstant(Info.MCPE->Val.ConstVal);
+            EmitGlobalConstant(Info.ConstVal);
     }
 }
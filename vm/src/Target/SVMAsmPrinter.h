@@ -29,6 +29,7 @@
 
 #include "SVMMCInstLower.h"
 #include "SVMBlockSizeAccumulator.h"
+#include "SVMStackBound.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/CodeGen/MachineInstr.h"
@@ -38,12 +39,15 @@ namespace llvm {
     class SVMAsmPrinter : public AsmPrinter {
     public:
         explicit SVMAsmPrinter(TargetMachine &TM, MCStreamer &Streamer)
-            : AsmPrinter(TM, Streamer), CurrentMBB(0) {}
+            : AsmPrinter(TM, Streamer), CurrentMBB(0),
+              OpenBlockSection(0), PackCurrentFunction(false) {}
 
         const char *getPassName() const {
             return "SVM Assembly Printer";
         }
 
+        bool runOnMachineFunction(MachineFunction &MF);
+        bool doFinalization(Module &M);
         void EmitInstruction(const MachineInstr *MI);
         void EmitFunctionEntryLabel();
         void EmitConstantPool();
@@ -51,27 +55,50 @@ namespace llvm {
         void EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV);
 
     private:
+        /*
+         * A block's constant pool may be emitted after the function that
+         * created it is gone, so we can't hold on to MachineConstantPool
+         * entries. Machine-specific values are lowered to an MCExpr early.
+         */
         struct CPEInfo {
-            CPEInfo(MCSymbol *Symbol, const MachineConstantPoolEntry *MCPE)
-                : Symbol(Symbol), MCPE(MCPE) {}
+            CPEInfo(MCSymbol *Symbol, const Constant *ConstVal)
+                : Symbol(Symbol), ConstVal(ConstVal), Expr(0), Size(0) {}
+
+            CPEInfo(MCSymbol *Symbol, const MCExpr *Expr, unsigned Size)
+                : Symbol(Symbol), ConstVal(0), Expr(Expr), Size(Size) {}
 
             MCSymbol *Symbol;
-            const MachineConstantPoolEntry *MCPE;
+            const Constant *ConstVal;
+            const MCExpr *Expr;
+            unsigned Size;
         };
 
-        typedef DenseMap<const MCSymbol*, CPEInfo> BlockConstPoolTy;
+        // Keyed by Constant for plain constants, so functions packed into
+        // one block share them, and by LLVM's CPI symbol for anything else.
+        typedef DenseMap<const void*, CPEInfo> BlockConstPoolTy;
         BlockConstPoolTy BlockConstPool;
 
         SVMBlockSizeAccumulator BSA;
+        SVMStackBound StackBound;
         const MachineBasicBlock *CurrentMBB;
 
+        // Section of a block that the next function may share, or zero
+        const MCSection *OpenBlockSection;
+        bool PackCurrentFunction;
+
         void emitBlockBegin();
         void emitBlockEnd();
         void emitBlockSplit(const MachineInstr *MI);
+        void closeOpenBlock();
+        bool functionFitsInOpenBlock(const MachineFunction &MF);
         void emitFunctionLabelImpl(MCSymbol *Sym);
         void emitBlockOffsetComment();
 
+        void emitStackBound(Module &M);
+        void emitBinaryFiles();
+
         void emitBlockConstPool();
+        const MCExpr *lowerConstantPoolValue(MachineConstantPoolValue *MCPV);
         void emitConstRefComment(const MachineOperand &MO);
         void rewriteConstForCurrentBlock(const MachineOperand &MO, MCOperand &MCO);
     };
@@ -44,6 +44,16 @@ void SVMBlockSizeAccumulator::clear()
     InstrSuffixTotal = 0;
     ConstAlignment = 1;
     UsedCPI.clear();
+    UsedConstVal.clear();
+}
+
+void SVMBlockSizeAccumulator::beginFunction()
+{
+    // Another function sharing this block. Its entry point must be
+    // bundle-aligned, and its constant pool indices start over. Plain
+    // constants it has in common with earlier functions are still shared.
+    InstrAlign(SVMTargetMachine::getBundleSize());
+    UsedCPI.clear();
 }
 
 unsigned SVMBlockSizeAccumulator::getByteCount() const
@@ -125,9 +135,13 @@ void SVMBlockSizeAccumulator::AddConstantsForInstr(const MachineInstr *MI)
         if (UsedCPI.count(CPI))
             continue;
         
-        // Found a new constant
+        // Found a new constant. Plain constants are uniqued by LLVM, so
+        // other functions in this block may already have pooled this one.
         UsedCPI.insert(CPI);
-        AddConstant(*TD, Constants[CPI]);
+        const MachineConstantPoolEntry &CPE = Constants[CPI];
+        if (!CPE.isMachineConstantPoolEntry() && !UsedConstVal.insert(CPE.Val.ConstVal))
+            continue;
+        AddConstant(*TD, CPE);
     }
 }
 
@@ -36,6 +36,7 @@
 #ifndef SVM_BLOCKSIZEACCUMULATOR_H
 #define SVM_BLOCKSIZEACCUMULATOR_H
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -44,10 +45,12 @@ namespace llvm {
     class TargetData;
     class MachineInstr;
     class MachineConstantPoolEntry;
+    class Constant;
 
     class SVMBlockSizeAccumulator {
     public:
         void clear();
+        void beginFunction();
         unsigned getByteCount() const;
         
         void describe(raw_ostream &OS);
@@ -68,6 +71,7 @@ namespace llvm {
         unsigned ConstSizeTotal;
         unsigned ConstAlignment; 
         SmallSet<unsigned, 128> UsedCPI;
+        SmallPtrSet<const Constant*, 64> UsedConstVal;
     };
 
 }
@@ -27,15 +27,26 @@
 #include "SVMELFProgramWriter.h"
 #include "SVMMCAsmBackend.h"
 #include "SVMTargetMachine.h"
+#include "SVMStackBound.h"
+#include "Support/ErrorReporter.h"
+#include "../../../firmware/master/common/svmvalidator.h"
+#include "llvm/MC/MCELFSymbolFlags.h"
 #include "llvm/Support/CommandLine.h"
 #include "fastlz.h"
+#include <algorithm>
 using namespace llvm;
 
 cl::opt<bool> ELFDebug("g",
     cl::desc("Include debug information in generated ELF files"));
 
+static cl::opt<bool> ValidateCode("validate-code",
+    cl::desc("Check every function entry with the runtime's SVM validator"));
+
+static cl::opt<bool> RWZeroRuns("rwdata-zero-runs",
+    cl::desc("Allow RWDATA to skip zero runs (requires a newer OS)"));
+
 SVMELFProgramWriter::SVMELFProgramWriter(raw_ostream &OS)
-    : MCObjectWriter(OS, true) {}
+    : MCObjectWriter(OS, true), RWType(SVMELF::PT_LOAD_FASTLZ) {}
 
 
 void SVMELFProgramWriter::WriteObject(MCAssembler &Asm,
@@ -51,6 +62,10 @@ void SVMELFProgramWriter::WriteObject(MCAssembler &Asm,
     // Now we can know the final binary image of the RWDATA segments. Compress them.
     rwCompress(Asm, Layout, ML);
     ML.AllocateSections(Asm, Layout);
+    checkStackBound(Asm);
+
+    if (ValidateCode)
+        validateCode(Asm, Layout);
 
     if (ELFDebug) {
         // Allocate all debug sections last
@@ -159,7 +174,7 @@ void SVMELFProgramWriter::writeProgramHeader(SVMProgramSection S)
 
     case SPS_RW_Z:
         Flags |= ELF::PF_W;
-        Type = SVMELF::PT_LOAD_FASTLZ;
+        Type = RWType;
         break;
 
     case SPS_META:
@@ -325,8 +340,19 @@ void SVMELFProgramWriter::rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout
         plaintext.push_back(0);
 
     // Compress using FastLZ level 1
-    std::vector<uint8_t> compressed(plaintext.size() * 2);
-    compressed.resize(fastlz_compress_level(1, &plaintext[0], plaintext.size(), &compressed[0]));
+    std::vector<uint8_t> compressed;
+    rwCompressLZ(plaintext, 0, plaintext.size(), compressed);
+    RWType = SVMELF::PT_LOAD_FASTLZ;
+
+    // Optionally try skipping zero runs instead, and keep whichever is smaller.
+    if (RWZeroRuns) {
+        std::vector<uint8_t> zruns;
+        rwCompressZeroRuns(plaintext, zruns);
+        if (zruns.size() < compressed.size()) {
+            compressed.swap(zruns);
+            RWType = SVMELF::PT_LOAD_ZRUNS;
+        }
+    }
 
     // Create the new section
     const MCSectionELF *LZSection =
@@ -344,6 +370,169 @@ void SVMELFProgramWriter::rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout
     F->getContents().append(compressed.begin(), compressed.end());
 }
 
+void SVMELFProgramWriter::checkStackBound(const MCAssembler &Asm)
+{
+    /*
+     * The stack gets all RAM above RWDATA and BSS. If SVMAsmPrinter could
+     * bound the stack depth, make sure that's enough.
+     */
+
+    MCSymbol *S = Asm.getContext().LookupSymbol(SVMStackBound::SYMBOL);
+    int64_t Bound;
+    if (!S || !S->isVariable() || !S->getVariableValue()->EvaluateAsAbsolute(Bound) || !Bound)
+        return;
+
+    uint32_t DataEnd = ML.getSectionMemAddress(SPS_END);
+    uint32_t RAMEnd = SVMTargetMachine::getRAMBase() + SVMTargetMachine::getRAMSize();
+    uint32_t Available = RAMEnd > DataEnd ? RAMEnd - DataEnd : 0;
+
+    if (Bound > Available)
+        report_warning("Worst-case stack usage is " + Twine(Bound)
+            + " bytes, but only " + Twine(Available)
+            + " bytes of RAM are left after static data.");
+}
+
+void SVMELFProgramWriter::validateCode(const MCAssembler &Asm, const MCAsmLayout &Layout)
+{
+    /*
+     * Run the runtime's validator over every flash block of the RO
+     * segment, exactly as it will be installed, and make sure each
+     * function entry point lands in the block's valid prefix. A failure
+     * here would otherwise be a fault the first time that function runs.
+     */
+
+    const uint32_t blockSize = SVMTargetMachine::getBlockSize();
+    uint32_t base = ML.getSectionDiskOffset(SPS_RO);
+    uint32_t size = RoundUpToAlignment(ML.getSectionDiskSize(SPS_RO), blockSize);
+    std::vector<uint32_t> image(size / sizeof(uint32_t));
+    memset(&image[0], SVMTargetMachine::getPaddingByte(), size);
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(&image[0]);
+
+    // Flatten the RO segment
+    for (MCAssembler::const_iterator IS = Asm.begin(), ES = Asm.end(); IS != ES; ++IS) {
+        const MCSectionData *SD = &*IS;
+        if (ML.getSectionKind(SD) != SPS_RO)
+            continue;
+
+        uint32_t secOffset = ML.getSectionDiskOffset(SD) - base;
+        for (MCSectionData::const_iterator IF = SD->begin(), EF = SD->end(); IF != EF; ++IF) {
+            const MCFragment *F = &*IF;
+            uint32_t offset = secOffset + Layout.getFragmentOffset(F);
+            const char *data = 0;
+            unsigned len = 0;
+
+            if (const MCDataFragment *DF = dyn_cast<MCDataFragment>(F)) {
+                data = DF->getContents().data();
+                len = DF->getContents().size();
+            } else if (const MCInstFragment *InstF = dyn_cast<MCInstFragment>(F)) {
+                data = InstF->getCode().data();
+                len = InstF->getCode().size();
+            }
+
+            assert(offset + len <= size);
+            if (len)
+                memcpy(bytes + offset, data, len);
+        }
+    }
+
+    // Check every function against its block's validator result
+    std::vector<int> validBundles(size / blockSize, -1);
+
+    for (MCAssembler::const_symbol_iterator I = Asm.symbol_begin(), E = Asm.symbol_end(); I != E; ++I) {
+        const MCSymbolData &Data = *I;
+        if (!(Data.getFlags() & ELF_Other_ThumbFunc) || !Data.getFragment())
+            continue;
+
+        const MCSectionData *SD = Data.getFragment()->getParent();
+        if (ML.getSectionKind(SD) != SPS_RO)
+            continue;
+
+        uint32_t offset = ML.getSectionDiskOffset(SD) - base + Layout.getSymbolOffset(&Data);
+        unsigned block = offset / blockSize;
+        int &valid = validBundles[block];
+        if (valid < 0)
+            valid = SvmValidator::findValidBundles(&image[block * blockSize / sizeof(uint32_t)]);
+
+        unsigned bundle = (offset % blockSize) / 4;
+        if (bundle >= unsigned(valid))
+            report_fatal_error("Function '" + Twine(Data.getSymbol().getName())
+                + "' fails SVM validation: bundle " + Twine(bundle)
+                + " of a block with only " + Twine(valid) + " valid bundles");
+    }
+}
+
+void SVMELFProgramWriter::rwCompressLZ(const std::vector<uint8_t> &plaintext,
+    unsigned begin, unsigned end, std::vector<uint8_t> &out)
+{
+    // FastLZ wants an output buffer at least 5% larger than the input,
+    // and no smaller than 66 bytes.
+    unsigned len = end - begin;
+    std::vector<uint8_t> buffer(std::max(len * 2, 66u));
+    buffer.resize(fastlz_compress_level(1, &plaintext[begin], len, &buffer[0]));
+    out.insert(out.end(), buffer.begin(), buffer.end());
+}
+
+void SVMELFProgramWriter::rwCompressZeroRuns(const std::vector<uint8_t> &plaintext,
+    std::vector<uint8_t> &out)
+{
+    /*
+     * RAM is zeroed before RWDATA is loaded, so long runs of zeroes can be
+     * skipped outright instead of making the loader decompress them. Each
+     * record is a 16-bit zero count, a 16-bit region length, and a 16-bit
+     * stored length, followed by the stored data. Regions are FastLZ
+     * compressed when that helps, and copied verbatim when it doesn't.
+     *
+     * Short zero runs aren't worth a record header, and FastLZ handles
+     * them fine, so we only split regions at runs of at least
+     * MinZeroRun bytes.
+     */
+
+    const unsigned MinZeroRun = 16;
+    const unsigned MaxLen = 0xFFFF;
+    unsigned size = plaintext.size();
+    unsigned i = 0;
+
+    while (i < size) {
+        unsigned zeroes = 0;
+        while (i < size && zeroes < MaxLen && plaintext[i] == 0) {
+            zeroes++;
+            i++;
+        }
+
+        // Trailing zeroes need no record at all
+        if (i == size)
+            break;
+
+        unsigned begin = i;
+        unsigned run = 0;
+        while (i < size && i - begin < MaxLen) {
+            if (plaintext[i] == 0) {
+                if (++run == MinZeroRun) {
+                    i -= MinZeroRun - 1;
+                    break;
+                }
+            } else {
+                run = 0;
+            }
+            i++;
+        }
+        unsigned end = i;
+
+        std::vector<uint8_t> packed;
+        if (end - begin >= 16)
+            rwCompressLZ(plaintext, begin, end, packed);
+        if (packed.empty() || packed.size() >= end - begin)
+            packed.assign(plaintext.begin() + begin, plaintext.begin() + end);
+
+        uint16_t hdr[3] = { zeroes, end - begin, packed.size() };
+        for (unsigned j = 0; j < 3; ++j) {
+            out.push_back(hdr[j]);
+            out.push_back(hdr[j] >> 8);
+        }
+        out.insert(out.end(), packed.begin(), packed.end());
+    }
+}
+
 MCObjectWriter *llvm::createSVMELFProgramWriter(raw_ostream &OS)
 {
     return new SVMELFProgramWriter(OS);
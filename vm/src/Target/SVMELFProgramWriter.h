@@ -87,6 +87,7 @@ namespace llvm {
         SVMMemoryLayout ML;
         SVMELFMetadataBuilder EMB;
         uint32_t SHOffset;
+        uint32_t RWType;
 
         void writePadding(unsigned N);
         void padToOffset(uint32_t O);
@@ -97,7 +98,13 @@ namespace llvm {
         void writeSectionHeader(const MCAsmLayout &Layout, const MCSectionData *SD);  
         void writeDebugMessage();
 
+        void checkStackBound(const MCAssembler &Asm);
+        void validateCode(const MCAssembler &Asm, const MCAsmLayout &Layout);
         void rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout, SVMMemoryLayout &ML);
+        static void rwCompressLZ(const std::vector<uint8_t> &plaintext,
+            unsigned begin, unsigned end, std::vector<uint8_t> &out);
+        static void rwCompressZeroRuns(const std::vector<uint8_t> &plaintext,
+            std::vector<uint8_t> &out);
     };
 
 }  // end namespace
@@ -89,6 +89,7 @@ namespace llvm {
         enum PT {
             PT_METADATA = 0x7000f001,
             PT_LOAD_FASTLZ = 0x7000f002,
+            PT_LOAD_ZRUNS = 0x7000f003,
         };
 
         // Program header layout
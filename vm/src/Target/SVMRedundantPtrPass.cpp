@@ -0,0 +1,187 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Every load and store in SVM goes through the base pointer register,
+ * which is only ever set by the validating "s.ptr" SVC. Instruction
+ * selection emits one of these ahead of each memory access, and while
+ * MachineCSE catches some duplicates, register allocation and spilling
+ * often leave us with back-to-back accesses through the same address
+ * that each re-validate it. Every one of those is a full SVC round-trip
+ * into the runtime.
+ *
+ * This pass walks each basic block forward, remembering which general
+ * purpose registers hold the address that BP was last validated from.
+ * A PTR whose source is one of those registers is redundant, and we
+ * remove it. Anything that might change BP behind our back (every other
+ * SVC, calls, instructions with unmodeled side effects) or that redefines
+ * one of the tracked registers forgets that fact. Register copies extend
+ * the set, so a spill/reload shuffle through MOVr doesn't defeat us.
+ *
+ * This is deliberately conservative: we only reason about exact register
+ * equality within a block, since loads and stores always use BP at offset
+ * zero. We never try to prove that a different address lands inside the
+ * same validated region.
+ *
+ * Removing instructions changes code size, so this must run before
+ * SVMAlignPass.
+ */
+
+#define DEBUG_TYPE "svm-redundant-ptr"
+#include "SVM.h"
+#include "SVMTargetMachine.h"
+#include "SVMInstrInfo.h"
+#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+using namespace llvm;
+
+STATISTIC(NumPtrRemoved, "Number of redundant s.ptr instructions removed");
+
+namespace {
+
+    class SVMRedundantPtrPass : public MachineFunctionPass {
+        SVMTargetMachine& TM;
+
+    public:
+        static char ID;
+        explicit SVMRedundantPtrPass(SVMTargetMachine &tm)
+            : MachineFunctionPass(ID), TM(tm) {}
+
+        bool runOnMachineFunction(MachineFunction &MF);
+
+        const char *getPassName() const {
+            return "SVM redundant pointer validation pass";
+        }
+
+    private:
+        typedef SmallSet<unsigned, 8> RegSet_t;
+
+        bool runOnMachineBasicBlock(MachineBasicBlock &MBB);
+        void forgetRegDefs(const MachineInstr &MI, RegSet_t &Regs);
+    };
+
+    char SVMRedundantPtrPass::ID = 0;
+}
+
+FunctionPass *llvm::createSVMRedundantPtrPass(SVMTargetMachine &TM)
+{
+    return new SVMRedundantPtrPass(TM);
+}
+
+bool SVMRedundantPtrPass::runOnMachineFunction(MachineFunction &MF)
+{
+    bool Changed = false;
+
+    for (MachineFunction::iterator I = MF.begin(), E = MF.end(); I != E; ++I)
+        if (runOnMachineBasicBlock(*I))
+            Changed = true;
+
+    return Changed;
+}
+
+bool SVMRedundantPtrPass::runOnMachineBasicBlock(MachineBasicBlock &MBB)
+{
+    // Registers known to hold the address BP was last validated from.
+    // Empty if BP's contents are unknown, as on entry to any block.
+    RegSet_t Validated;
+
+    // Last instruction that read BP. If it carries a kill flag and we
+    // remove a later PTR, that value is now live past it.
+    MachineInstr *LastBPUse = 0;
+
+    bool Changed = false;
+
+    for (MachineBasicBlock::iterator I = MBB.begin(), E = MBB.end(); I != E;) {
+        MachineInstr *MI = I++;
+
+        if (MI->isDebugValue())
+            continue;
+
+        if (MI->getOpcode() == SVM::PTR) {
+            unsigned Rs = MI->getOperand(1).getReg();
+
+            if (Validated.count(Rs)) {
+                if (LastBPUse)
+                    for (unsigned i = 0, e = LastBPUse->getNumOperands(); i != e; ++i) {
+                        MachineOperand &MO = LastBPUse->getOperand(i);
+                        if (MO.isReg() && MO.isUse() && MO.getReg() == SVM::BP)
+                            MO.setIsKill(false);
+                    }
+
+                MI->eraseFromParent();
+                NumPtrRemoved++;
+                Changed = true;
+                continue;
+            }
+
+            Validated.clear();
+            Validated.insert(Rs);
+            LastBPUse = 0;
+            continue;
+        }
+
+        if (MI->getDesc().isCall() || MI->hasUnmodeledSideEffects() ||
+            MI->modifiesRegister(SVM::BP, 0)) {
+            Validated.clear();
+            LastBPUse = 0;
+            continue;
+        }
+
+        if (MI->readsRegister(SVM::BP))
+            LastBPUse = MI;
+
+        if (Validated.empty())
+            continue;
+
+        if (MI->getOpcode() == SVM::MOVr) {
+            unsigned Rd = MI->getOperand(0).getReg();
+            unsigned Rs = MI->getOperand(1).getReg();
+            bool Tracked = Validated.count(Rs);
+
+            forgetRegDefs(*MI, Validated);
+            if (Tracked)
+                Validated.insert(Rd);
+            continue;
+        }
+
+        forgetRegDefs(*MI, Validated);
+    }
+
+    return Changed;
+}
+
+void SVMRedundantPtrPass::forgetRegDefs(const MachineInstr &MI, RegSet_t &Regs)
+{
+    for (unsigned i = 0, e = MI.getNumOperands(); i != e; ++i) {
+        const MachineOperand &MO = MI.getOperand(i);
+        if (MO.isReg() && MO.isDef())
+            Regs.erase(MO.getReg());
+    }
+}
@@ -0,0 +1,123 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SVMStackBound.h"
+#include "llvm/Module.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/InlineAsm.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include <algorithm>
+using namespace llvm;
+
+const char SVMStackBound::SYMBOL[] = "_stack$bound";
+
+void SVMStackBound::addFunction(const MachineFunction &MF)
+{
+    // Frame lowering has already run, so this is the final frame size
+    FrameSizes[MF.getFunction()] = MF.getFrameInfo()->getStackSize();
+}
+
+uint32_t SVMStackBound::compute(const Module &M)
+{
+    const Function *Main = M.getFunction("main");
+    if (!Main || Main->isDeclaration())
+        return 0;
+
+    uint32_t Bound = getDepth(Main);
+
+    // Room for one event handler, invoked from the deepest syscall
+    uint32_t Handlers = getAddressTakenDepth(M);
+    if (Handlers)
+        Bound = addDepth(Bound, addDepth(CALL_FRAME_SIZE, Handlers));
+
+    return Bound == UNKNOWN ? 0 : Bound;
+}
+
+uint32_t SVMStackBound::addDepth(uint32_t a, uint32_t b)
+{
+    if (a == UNKNOWN || b == UNKNOWN)
+        return UNKNOWN;
+    return a + b;
+}
+
+uint32_t SVMStackBound::getAddressTakenDepth(const Module &M)
+{
+    if (AddressTakenDone)
+        return AddressTakenDepth;
+
+    // An indirect call reachable from an address-taken function may
+    // call that same function again.
+    if (AddressTakenVisiting)
+        return UNKNOWN;
+    AddressTakenVisiting = true;
+
+    uint32_t Depth = 0;
+    for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+        if (!F->isDeclaration() && F->hasAddressTaken())
+            Depth = std::max(Depth, getDepth(F));
+
+    AddressTakenVisiting = false;
+    AddressTakenDone = true;
+    return AddressTakenDepth = Depth;
+}
+
+uint32_t SVMStackBound::getDepth(const Function *F)
+{
+    // Syscalls and intrinsics don't run on the user stack
+    if (F->isDeclaration())
+        return 0;
+
+    FnMap_t::iterator I = Depths.find(F);
+    if (I != Depths.end())
+        return I->second;
+
+    if (Visiting.count(F))
+        return UNKNOWN;
+    Visiting.insert(F);
+
+    uint32_t Deepest = 0;
+    for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+        for (BasicBlock::const_iterator II = BB->begin(), IE = BB->end(); II != IE; ++II) {
+            ImmutableCallSite CS(II);
+            if (!CS || isa<InlineAsm>(CS.getCalledValue()))
+                continue;
+
+            const Function *Callee = dyn_cast<Function>(
+                CS.getCalledValue()->stripPointerCasts());
+            uint32_t Depth = Callee ? getDepth(Callee)
+                : getAddressTakenDepth(*F->getParent());
+
+            Deepest = std::max(Deepest, addDepth(CALL_FRAME_SIZE, Depth));
+        }
+
+    Visiting.erase(F);
+    uint32_t Depth = addDepth(FrameSizes.lookup(F), Deepest);
+    Depths[F] = Depth;
+    return Depth;
+}
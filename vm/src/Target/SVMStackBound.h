@@ -0,0 +1,85 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * The SVMStackBound is a utility object that calculates a worst-case bound
+ * on user stack usage, from the final frame size of every function and
+ * the call graph that's left after inlining.
+ *
+ * The runtime dispatches at most one event at a time, on the user stack,
+ * from inside any syscall. So on top of the deepest call chain from main(),
+ * we leave room for the deepest chain from any function whose address was
+ * taken. Those same functions are also the only possible targets of an
+ * indirect call.
+ *
+ * Recursion makes the bound unknown, which we report as zero.
+ */
+
+#ifndef SVM_STACKBOUND_H
+#define SVM_STACKBOUND_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace llvm {
+
+    class Function;
+    class Module;
+    class MachineFunction;
+
+    class SVMStackBound {
+    public:
+        SVMStackBound()
+            : AddressTakenDepth(0), AddressTakenDone(false), AddressTakenVisiting(false) {}
+
+        void addFunction(const MachineFunction &MF);
+        uint32_t compute(const Module &M);
+
+        // MC symbol whose value is the bound, for SVMELFProgramWriter
+        static const char SYMBOL[];
+
+    private:
+        static const uint32_t UNKNOWN = 0xFFFFFFFF;
+
+        // Size of the SVM CallFrame, pushed by the runtime on every call
+        static const uint32_t CALL_FRAME_SIZE = 8 * sizeof(uint32_t);
+
+        typedef DenseMap<const Function*, uint32_t> FnMap_t;
+        FnMap_t FrameSizes;
+        FnMap_t Depths;
+        SmallPtrSet<const Function*, 16> Visiting;
+        uint32_t AddressTakenDepth;
+        bool AddressTakenDone;
+        bool AddressTakenVisiting;
+
+        uint32_t getDepth(const Function *F);
+        uint32_t getAddressTakenDepth(const Module &M);
+        static uint32_t addDepth(uint32_t a, uint32_t b);
+    };
+
+}
+
+#endif
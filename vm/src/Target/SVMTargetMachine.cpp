@@ -52,6 +52,11 @@ bool SVMTargetMachine::addInstSelector(PassManagerBase &PM, CodeGenOpt::Level Op
 
 bool SVMTargetMachine::addPreEmitPass(PassManagerBase &PM, CodeGenOpt::Level OptLevel)
 {
+    // Drop repeated pointer validations. This removes instructions, so it
+    // must happen before we measure anything in the AlignPass.
+    if (OptLevel != CodeGenOpt::None)
+        PM.add(createSVMRedundantPtrPass(*this));
+
     // The Alignment pass may change the size of functions by inserting no-ops,
     // so it must come before the LateFunctionSplitPass.
     PM.add(createSVMAlignPass(*this));
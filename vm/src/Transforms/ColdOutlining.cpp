@@ -0,0 +1,238 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Cold path outlining.
+ *
+ * Code that only runs on the way to a fault, like a failed ASSERT() or an
+ * explicit abort, still takes up room in the flash blocks of the function
+ * it lives in. A hot loop that would fit in one 256-byte block can end up
+ * split across two just because of an error path it never takes.
+ *
+ * We call a basic block cold if every path out of it ends in 'unreachable',
+ * i.e. in a call to a noreturn function. Each maximal single-entry region
+ * of cold blocks is extracted into a new internal function, which lands at
+ * the end of the module, far away from the hot code. The call that's left
+ * behind is much smaller than the region it replaces.
+ *
+ * Tiny regions aren't worth a call, and the entry block is never outlined.
+ * Outlined functions are marked noinline and optsize, so later inlining
+ * doesn't simply undo our work.
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Module.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/FunctionUtils.h"
+#include <vector>
+using namespace llvm;
+
+static cl::opt<unsigned> ColdRegionThreshold("cold-region-threshold",
+    cl::desc("Smallest cold code region to outline, in IR instructions"),
+    cl::init(8), cl::Hidden);
+
+namespace llvm {
+    ModulePass *createColdOutliningPass();
+}
+
+namespace {
+    class ColdOutliningPass : public ModulePass {
+    public:
+        static char ID;
+        ColdOutliningPass()
+            : ModulePass(ID) {}
+
+        virtual bool runOnModule(Module &M);
+
+        virtual const char *getPassName() const {
+            return "Cold path outlining";
+        }
+
+    private:
+        typedef SmallPtrSet<BasicBlock*, 32> BlockSet;
+
+        bool runOnFunction(Function &F);
+        void findColdBlocks(Function &F, BlockSet &Cold);
+        bool isEligible(BasicBlock *BB);
+        unsigned regionSize(const std::vector<BasicBlock*> &Region);
+    };
+}
+
+char ColdOutliningPass::ID = 0;
+
+ModulePass *llvm::createColdOutliningPass()
+{
+    return new ColdOutliningPass();
+}
+
+bool ColdOutliningPass::runOnModule(Module &M)
+{
+    // Snapshot the function list; outlining appends new functions to it.
+    std::vector<Function*> Functions;
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+        if (!I->isDeclaration())
+            Functions.push_back(I);
+
+    bool Changed = false;
+    for (std::vector<Function*>::iterator I = Functions.begin(),
+        E = Functions.end(); I != E; ++I)
+        Changed |= runOnFunction(**I);
+
+    return Changed;
+}
+
+bool ColdOutliningPass::isEligible(BasicBlock *BB)
+{
+    // Things the code extractor can't move into another function
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+        if (isa<InvokeInst>(I) || isa<LandingPadInst>(I) || isa<VAArgInst>(I))
+            return false;
+        if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I))
+            if (II->getIntrinsicID() == Intrinsic::vastart)
+                return false;
+    }
+    return true;
+}
+
+void ColdOutliningPass::findColdBlocks(Function &F, BlockSet &Cold)
+{
+    /*
+     * Seed with blocks that end in 'unreachable', then grow backwards:
+     * a block whose successors are all cold is cold too. Iterate to a
+     * fixed point, since loops can't be cold by this definition anyway.
+     */
+
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+        if (isa<UnreachableInst>(BB->getTerminator()) && isEligible(BB))
+            Cold.insert(BB);
+
+    bool Changed;
+    do {
+        Changed = false;
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+            if (Cold.count(BB) || !isEligible(BB))
+                continue;
+
+            succ_iterator SI = succ_begin(BB), SE = succ_end(BB);
+            if (SI == SE)
+                continue;
+
+            bool AllCold = true;
+            for (; SI != SE; ++SI)
+                if (!Cold.count(*SI)) {
+                    AllCold = false;
+                    break;
+                }
+
+            if (AllCold) {
+                Cold.insert(BB);
+                Changed = true;
+            }
+        }
+    } while (Changed);
+}
+
+unsigned ColdOutliningPass::regionSize(const std::vector<BasicBlock*> &Region)
+{
+    unsigned Size = 0;
+    for (std::vector<BasicBlock*>::const_iterator I = Region.begin(),
+        E = Region.end(); I != E; ++I)
+        for (BasicBlock::iterator II = (*I)->begin(), IE = (*I)->end(); II != IE; ++II)
+            if (!isa<DbgInfoIntrinsic>(II) && !isa<PHINode>(II))
+                Size++;
+    return Size;
+}
+
+bool ColdOutliningPass::runOnFunction(Function &F)
+{
+    BlockSet Cold;
+    findColdBlocks(F, Cold);
+
+    // A function that always faults has nothing hot to make room for
+    BasicBlock *Entry = &F.getEntryBlock();
+    if (Cold.empty() || Cold.count(Entry))
+        return false;
+
+    /*
+     * Region headers are cold blocks with at least one hot predecessor.
+     * Since cold blocks only lead to other cold blocks, everything a header
+     * dominates within the cold set is only reachable through that header.
+     */
+
+    std::vector<BasicBlock*> Headers;
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+        if (!Cold.count(BB))
+            continue;
+        for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE; ++PI)
+            if (!Cold.count(*PI)) {
+                Headers.push_back(BB);
+                break;
+            }
+    }
+
+    bool Changed = false;
+    BlockSet Taken;
+
+    for (std::vector<BasicBlock*>::iterator H = Headers.begin(),
+        HE = Headers.end(); H != HE; ++H) {
+
+        // Already part of an earlier region, or outlined along with it
+        if (Taken.count(*H))
+            continue;
+
+        // Extraction rewrites the CFG, so start each region with a fresh tree
+        DominatorTree DT;
+        DT.runOnFunction(F);
+
+        std::vector<BasicBlock*> Region;
+        Region.push_back(*H);
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            if (&*BB != *H && Cold.count(BB) && !Taken.count(BB)
+                && DT.dominates(*H, BB))
+                Region.push_back(BB);
+
+        if (regionSize(Region) < ColdRegionThreshold)
+            continue;
+
+        if (Function *Outlined = ExtractCodeRegion(DT, Region)) {
+            Outlined->addFnAttr(Attribute::NoInline);
+            Outlined->addFnAttr(Attribute::OptimizeForSize);
+            Changed = true;
+        }
+
+        for (std::vector<BasicBlock*>::iterator I = Region.begin(),
+            E = Region.end(); I != E; ++I)
+            Taken.insert(*I);
+    }
+
+    return Changed;
+}
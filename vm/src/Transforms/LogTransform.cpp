@@ -32,6 +32,11 @@
  * which get included in _SYS_log() calls. The string literals are included
  * in a new log-specific string table section, and information about the log
  * is packed along with a string table offset into a single 32-bit parameter.
+ *
+ * This runs after all modules are linked, so the string table is global.
+ * Identical strings are stored once, and a string which is the tail of
+ * another one is stored as an offset into it. Since the offset is all that
+ * goes into the log record, sharing costs nothing at runtime.
  */
 
 #include "Target/SVMRuntime.inc"
@@ -114,8 +119,51 @@ namespace {
             return ConstantInt::get(i32, flags);
         }
 
-        Value *createLogString()
+        static bool isLogString(const GlobalVariable *GV, std::string &str)
+        {
+            if (!GV->hasSection() || GV->getSection() != ".debug_logstr")
+                return false;
+            const ConstantArray *CA = dyn_cast<ConstantArray>(GV->getInitializer());
+            if (!CA || !CA->isString())
+                return false;
+            str = CA->getAsString();
+            return true;
+        }
+
+        static bool isSuffix(const std::string &suffix, const std::string &str)
+        {
+            return str.size() >= suffix.size() &&
+                !str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+        }
+
+        Constant *getStringPointer(GlobalVariable *GV, unsigned offset)
+        {
+            Constant *Idx[] = {
+                ConstantInt::get(i32, 0),
+                ConstantInt::get(i32, offset)
+            };
+            return ConstantExpr::getInBoundsGetElementPtr(GV, Idx);
+        }
+
+        Constant *getLogString()
         {
+            // The string as stored, including its NUL terminator
+            std::string str = fmt;
+            str += '\0';
+
+            // Can we reuse an existing string? Either an identical one,
+            // or one that ends with our string.
+            SmallVector<GlobalVariable*, 4> suffixes;
+            for (Module::global_iterator G = M->global_begin(), E = M->global_end(); G != E; ++G) {
+                std::string existing;
+                if (!isLogString(G, existing))
+                    continue;
+                if (isSuffix(str, existing))
+                    return getStringPointer(G, existing.size() - str.size());
+                if (isSuffix(existing, str))
+                    suffixes.push_back(G);
+            }
+
             // Create a new string in our special section
             Constant *StrConstant = ConstantArray::get(Ctx, fmt, true);
             GlobalVariable *GV = new GlobalVariable(*M, StrConstant->getType(),
@@ -125,8 +173,23 @@ namespace {
             GV->setName("logstr");
             GV->setSection(".debug_logstr");
 
+            // Any existing strings that are tails of this one can go away.
+            for (unsigned i = 0, e = suffixes.size(); i != e; ++i) {
+                GlobalVariable *Old = suffixes[i];
+                unsigned offset = str.size() - cast<ArrayType>(
+                    Old->getType()->getElementType())->getNumElements();
+                Old->replaceAllUsesWith(ConstantExpr::getBitCast(
+                    getStringPointer(GV, offset), Old->getType()));
+                Old->eraseFromParent();
+            }
+
+            return getStringPointer(GV, 0);
+        }
+
+        Value *createLogString()
+        {
             // Cast from pointer to integer, then add our flags word
-            Value *castV = CastInst::CreatePointerCast(GV, i32, "", I);
+            Value *castV = CastInst::CreatePointerCast(getLogString(), i32, "", I);
             Value *flagsV = createFlagsWord(0, args.size());
             return BinaryOperator::CreateAdd(castV, flagsV, "", I);
         }
@@ -194,6 +194,12 @@ void MetadataCollectorPass::collectValues(Module &M)
         ++I;
         GV->eraseFromParent();
     }
+
+    // Placeholder for the stack bound, which SVMAsmPrinter fills in
+    // once every function's frame size is known.
+    if (!Dict.count(_SYS_METADATA_STACK_BYTES))
+        Dict[_SYS_METADATA_STACK_BYTES].append(
+            ConstantInt::get(Type::getInt32Ty(M.getContext()), 0));
 }
 
 void MetadataCollectorPass::checkValues(Module &M)
@@ -0,0 +1,255 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Profile-guided function layout.
+ *
+ * What we choose here is the order functions are laid out in. The runtime
+ * starts preloading the next sequential code block whenever it branches
+ * into a new one, so a hot caller placed directly before its hottest callee
+ * tends to find that callee already in the cache by the time it's called.
+ * With -pack-functions, a small callee placed right after its caller may
+ * even end up in the very same block.
+ *
+ * The profile may come from Siftulator ("--svm-profile", folded stacks)
+ * or from the hardware sampling profiler in swiss (flat per-function
+ * counts). We seed a chain with the hottest function not yet placed, then
+ * keep appending the heaviest not-yet-placed callee of the chain's tail.
+ * Flat profiles have no call edges, and simply sort by weight. Functions
+ * that never appear in the profile keep their original relative order,
+ * after everything that does.
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Module.h"
+#include "llvm/Function.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+using namespace llvm;
+
+namespace llvm {
+    ModulePass *createProfileLayoutPass(StringRef Filename);
+}
+
+namespace {
+    class ProfileLayoutPass : public ModulePass {
+    public:
+        static char ID;
+        ProfileLayoutPass(StringRef Filename)
+            : ModulePass(ID), Filename(Filename.str()) {}
+
+        virtual bool runOnModule(Module &M);
+
+        virtual const char *getPassName() const {
+            return "Profile-guided function layout";
+        }
+
+    private:
+        typedef std::map<Function*, uint64_t> WeightMap;
+
+        std::string Filename;
+        StringMap<Function*> FunctionsByName;
+        std::map<Function*, unsigned> Position;
+        WeightMap Weights;
+        std::map<Function*, WeightMap> Edges;
+
+        void indexFunctions(Module &M);
+        void readProfile();
+        void addFoldedStack(StringRef Stack, uint64_t Count);
+        void addFlatSample(StringRef Name, uint64_t Count);
+        Function *lookup(StringRef Name);
+        Function *hottestUnplaced(const WeightMap &W,
+            const SmallPtrSet<Function*, 64> &Placed);
+    };
+}
+
+char ProfileLayoutPass::ID = 0;
+
+ModulePass *llvm::createProfileLayoutPass(StringRef Filename)
+{
+    return new ProfileLayoutPass(Filename);
+}
+
+bool ProfileLayoutPass::runOnModule(Module &M)
+{
+    indexFunctions(M);
+    readProfile();
+    if (Weights.empty())
+        return false;
+
+    // Build the new order: profiled chains first, then everything else.
+    std::vector<Function*> Order;
+    SmallPtrSet<Function*, 64> Placed;
+
+    while (Function *F = hottestUnplaced(Weights, Placed)) {
+        do {
+            Order.push_back(F);
+            Placed.insert(F);
+            F = hottestUnplaced(Edges[F], Placed);
+        } while (F);
+    }
+
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+        if (!Placed.count(I))
+            Order.push_back(I);
+
+    // Relink the function list. remove() unlinks without deleting.
+    Module::FunctionListType &FL = M.getFunctionList();
+    for (std::vector<Function*>::iterator I = Order.begin(), E = Order.end();
+        I != E; ++I) {
+        FL.remove(*I);
+        FL.push_back(*I);
+    }
+
+    return true;
+}
+
+void ProfileLayoutPass::indexFunctions(Module &M)
+{
+    /*
+     * Profiles name functions the way the debugger prints them:
+     * demangled with the same libstdc++ demangler Siftulator uses.
+     */
+
+    unsigned Index = 0;
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+        Position[I] = Index++;
+        if (I->isDeclaration())
+            continue;
+
+        std::string Name = I->getName();
+        int Status;
+        char *Demangled = abi::__cxa_demangle(Name.c_str(), 0, 0, &Status);
+        if (Status == 0) {
+            Name = Demangled;
+            free(Demangled);
+        }
+
+        // First definition wins, if a demangled name is ambiguous
+        if (!FunctionsByName.count(Name))
+            FunctionsByName[Name] = I;
+    }
+}
+
+Function *ProfileLayoutPass::lookup(StringRef Name)
+{
+    StringMap<Function*>::iterator I = FunctionsByName.find(Name.trim());
+    return I == FunctionsByName.end() ? 0 : I->second;
+}
+
+void ProfileLayoutPass::readProfile()
+{
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code ec = MemoryBuffer::getFile(Filename, Buffer))
+        report_fatal_error("Can't read profile '" + Filename + "': " + ec.message());
+
+    StringRef Rest = Buffer->getBuffer();
+    while (!Rest.empty()) {
+        std::pair<StringRef, StringRef> Split = Rest.split('\n');
+        StringRef Line = Split.first.trim();
+        Rest = Split.second;
+
+        if (Line.empty() || Line.startswith("*"))
+            continue;
+
+        if (Line.startswith("0x")) {
+            // swiss: "0xaddress, count, percent%, name"
+            SmallVector<StringRef, 4> Fields;
+            Line.split(Fields, ", ", 3);
+            uint64_t Count;
+            if (Fields.size() == 4 && !Fields[1].getAsInteger(10, Count))
+                addFlatSample(Fields[3], Count);
+
+        } else {
+            // Folded stacks: "subsystem;outer;...;inner count"
+            std::pair<StringRef, StringRef> Parts = Line.rsplit(' ');
+            uint64_t Count;
+            if (!Parts.second.getAsInteger(10, Count))
+                addFoldedStack(Parts.first, Count);
+        }
+    }
+}
+
+void ProfileLayoutPass::addFlatSample(StringRef Name, uint64_t Count)
+{
+    if (Function *F = lookup(Name))
+        Weights[F] += Count;
+}
+
+void ProfileLayoutPass::addFoldedStack(StringRef Stack, uint64_t Count)
+{
+    // Skip the subsystem name; everything after it is an SVM frame.
+    StringRef Rest = Stack.split(';').second;
+    Function *Caller = 0;
+    SmallPtrSet<Function*, 16> Seen;
+
+    while (!Rest.empty()) {
+        std::pair<StringRef, StringRef> Split = Rest.split(';');
+        Rest = Split.second;
+
+        Function *F = lookup(Split.first);
+        if (!F) {
+            // Unknown frame (a raw address, or code we didn't link)
+            Caller = 0;
+            continue;
+        }
+
+        // Inclusive weight, counting recursive frames only once
+        if (Seen.insert(F))
+            Weights[F] += Count;
+
+        if (Caller && Caller != F)
+            Edges[Caller][F] += Count;
+        Caller = F;
+    }
+}
+
+Function *ProfileLayoutPass::hottestUnplaced(const WeightMap &W,
+    const SmallPtrSet<Function*, 64> &Placed)
+{
+    Function *Best = 0;
+    uint64_t BestWeight = 0;
+
+    // Ties go to the earlier function, so the layout is reproducible.
+    for (WeightMap::const_iterator I = W.begin(), E = W.end(); I != E; ++I) {
+        if (Placed.count(I->first) || I->second == 0 || I->second < BestWeight)
+            continue;
+        if (Best && I->second == BestWeight && Position[I->first] > Position[Best])
+            continue;
+        Best = I->first;
+        BestWeight = I->second;
+    }
+
+    return Best;
+}
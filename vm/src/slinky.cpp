@@ -76,6 +76,8 @@ extern "C" void LLVMInitializeSVMTargetInfo();
 namespace llvm {
     ModulePass *createInlineGlobalCtorsPass();
     ModulePass *createMetadataCollectorPass();
+    ModulePass *createProfileLayoutPass(StringRef Filename);
+    ModulePass *createColdOutliningPass();
     BasicBlockPass *createEarlyLTIPass();
     BasicBlockPass *createLateLTIPass();
     BasicBlockPass *createMisalignStackPass();
@@ -152,6 +154,10 @@ Verbose("v", cl::desc("Print information about actions taken"));
 static cl::opt<bool>
 DisableInline("disable-inlining", cl::desc("Do not run the inliner pass"));
 
+static cl::opt<bool>
+DisableColdOutlining("disable-cold-outlining",
+    cl::desc("Keep code that always ends in a fault inside its function"));
+
 // Determine optimization level.
 static cl::opt<char>
 OptLevel("O",
@@ -164,6 +170,11 @@ OptLevel("O",
 cl::opt<bool> AsmOutput("asm",
     cl::desc("Emit VM assembly output"));
 
+static cl::opt<std::string>
+ProfileLayout("profile-layout",
+    cl::desc("Order functions for flash cache locality, using an SVM profile"),
+    cl::value_desc("filename"));
+
 cl::opt<bool> NoVerify("disable-verify", cl::Hidden,
     cl::desc("Do not verify input module"));
 
@@ -331,11 +342,21 @@ static void AddPasses(PassManagerBase &PM,
     // and generate a fully assembled metadata table ready to emit to ELF.
     PM.add(createMetadataCollectorPass());
 
+    // Move paths that can only end in a fault out of line, so they
+    // don't crowd hot code out of its flash blocks.
+    if (OLvl > 0 && !DisableColdOutlining)
+        PM.add(createColdOutliningPass());
+
     // Final optimization pass
     AddOptimizationPasses(PM, FPM, OLvl);
 
     // Just before code generation, make all stack allocations static.
     PM.add(createStaticAllocaPass());
+
+    // Functions are emitted in module order. With a profile, put hot
+    // call chains next to each other in flash.
+    if (!ProfileLayout.empty())
+        PM.add(createProfileLayoutPass(ProfileLayout));
 }
 
 int main(int argc, char **argv)